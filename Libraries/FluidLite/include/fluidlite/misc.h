@@ -47,6 +47,15 @@ FLUIDSYNTH_API int fluid_is_soundfont(char* filename);
  */
 FLUIDSYNTH_API int fluid_is_midifile(char* filename);
 
+/**
+ * fluid_set_sample_cache_dir sets the directory where the decoded
+ * samples of compressed (.sf3) soundfonts are cached, so they only get
+ * decoded once. The cache files are memory-mapped, which lets all
+ * synths in the process share one copy of a soundfont's samples.
+ * Pass NULL to turn the cache off again, which is the default.
+ */
+FLUIDSYNTH_API void fluid_set_sample_cache_dir(const char* dir);
+
 
 
 
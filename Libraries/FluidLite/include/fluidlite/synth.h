@@ -391,6 +391,21 @@ FLUIDSYNTH_API int fluid_synth_set_polyphony(fluid_synth_t* synth, int polyphony
   /** Get the polyphony limit (FluidSynth >= 1.0.6) */
 FLUIDSYNTH_API int fluid_synth_get_polyphony(fluid_synth_t* synth);
 
+  /** The number of voices that are playing, including the ones that are releasing */
+FLUIDSYNTH_API int fluid_synth_get_active_voice_count(fluid_synth_t* synth);
+
+  /** Limit the number of voices that play at once, below the polyphony, 0 for no limit.
+      Unlike the polyphony, this can be changed while playing: when there are more voices
+      playing than the budget allows, the least important ones are stopped, and new notes
+      take the place of the least important voice instead of starting another one. */
+FLUIDSYNTH_API void fluid_synth_set_voice_budget(fluid_synth_t* synth, int budget);
+
+  /** Get the voice budget, 0 means there is no limit */
+FLUIDSYNTH_API int fluid_synth_get_voice_budget(fluid_synth_t* synth);
+
+  /** The number of playing voices that were stopped early, to stay within the polyphony or the voice budget */
+FLUIDSYNTH_API unsigned int fluid_synth_get_stolen_voice_count(fluid_synth_t* synth);
+
   /** Get the internal buffer size. The internal buffer size if not the
       same thing as the buffer size specified in the
       settings. Internally, the synth *always* uses a specific buffer
@@ -67,6 +67,7 @@
 
 #include "fluid_chorus.h"
 #include "fluid_sys.h"
+#include "fluid_simd.h"
 
 #define MAX_CHORUS	99
 #define MAX_DELAY	100
@@ -102,6 +103,19 @@
 */
 #define INTERPOLATION_SAMPLES 5
 
+/* The delay line is processed a block at a time: the block is written
+ * first, then every output sample is interpolated from what was written
+ * up to that sample. To keep the interpolation taps of a sample next to
+ * each other in memory, the last INTERPOLATION_SAMPLES-1 samples of the
+ * circular buffer are also kept in front of its start. */
+#define DELAY_LINE_GUARD (INTERPOLATION_SAMPLES - 1)
+
+/* The longest delay that can't be overwritten by the rest of its block */
+#define MAX_DEPTH_SAMPLES (MAX_SAMPLES - FLUID_BUFSIZE - INTERPOLATION_SAMPLES)
+
+/* Each row of the interpolation table is padded to a multiple of 4, so its first 4 taps are one vector */
+#define INTERPOLATION_ROW 8
+
 /* Private data for SKEL file */
 struct _fluid_chorus_t {
   /* Store the values between fluid_chorus_set_xxx and fluid_chorus_update
@@ -125,13 +139,17 @@ struct _fluid_chorus_t {
 
   fluid_real_t *chorusbuf;
   int counter;
+  /* Once the input has been silent for longer than the delay, processing stops */
+  int tail_samples;
+  int silent_samples;
   long phase[MAX_CHORUS];
   long modulation_period_samples;
   int *lookup_tab;
   fluid_real_t sample_rate;
 
-  /* sinc lookup table */
-  fluid_real_t sinc_table[INTERPOLATION_SAMPLES][INTERPOLATION_SUBSAMPLES];
+  /* sinc lookup table, sinc_table[ii][j] weighs the sample at
+   * (pos_samples - INTERPOLATION_SAMPLES + 1 + j) for subsample position ii */
+  fluid_real_t sinc_table[INTERPOLATION_SUBSAMPLES][INTERPOLATION_ROW];
 };
 
 void fluid_chorus_triangle(int *buf, int len, int depth);
@@ -166,12 +184,12 @@ new_fluid_chorus(fluid_real_t sample_rate)
       if (fabs(i_shifted) < 0.000001) {
 	/* sinc(0) cannot be calculated straightforward (limit needed
 	   for 0/0) */
-	chorus->sinc_table[i][ii] = (fluid_real_t)1.;
+	chorus->sinc_table[ii][INTERPOLATION_SAMPLES - 1 - i] = (fluid_real_t)1.;
 
       } else {
-	chorus->sinc_table[i][ii] = (fluid_real_t)sin(i_shifted * M_PI) / (M_PI * i_shifted);
+	chorus->sinc_table[ii][INTERPOLATION_SAMPLES - 1 - i] = (fluid_real_t)sin(i_shifted * M_PI) / (M_PI * i_shifted);
 	/* Hamming window */
-	chorus->sinc_table[i][ii] *= (fluid_real_t)0.5 * (1.0 + cos(2.0 * M_PI * i_shifted / (fluid_real_t)INTERPOLATION_SAMPLES));
+	chorus->sinc_table[ii][INTERPOLATION_SAMPLES - 1 - i] *= (fluid_real_t)0.5 * (1.0 + cos(2.0 * M_PI * i_shifted / (fluid_real_t)INTERPOLATION_SAMPLES));
       };
     };
   };
@@ -185,7 +203,7 @@ new_fluid_chorus(fluid_real_t sample_rate)
 
   /* allocate sample buffer */
 
-  chorus->chorusbuf = FLUID_ARRAY(fluid_real_t, MAX_SAMPLES);
+  chorus->chorusbuf = FLUID_ARRAY(fluid_real_t, DELAY_LINE_GUARD + MAX_SAMPLES);
   if (chorus->chorusbuf == NULL) {
     fluid_log(FLUID_PANIC, "chorus: Out of memory");
     goto error_recovery;
@@ -208,9 +226,10 @@ fluid_chorus_init(fluid_chorus_t* chorus)
 {
   int i;
 
-  for (i = 0; i < MAX_SAMPLES; i++) {
+  for (i = 0; i < DELAY_LINE_GUARD + MAX_SAMPLES; i++) {
     chorus->chorusbuf[i] = 0.0;
   }
+  chorus->silent_samples = 0;
 
   /* initialize the chorus with the default settings */
   fluid_chorus_set_nr(chorus, FLUID_CHORUS_DEFAULT_N);
@@ -375,11 +394,14 @@ fluid_chorus_update(fluid_chorus_t* chorus)
     (chorus->new_depth_ms / 1000.0  /* convert modulation depth in ms to s*/
      * chorus->sample_rate);
 
-  if (modulation_depth_samples > MAX_SAMPLES) {
-    fluid_log(FLUID_WARN, "chorus: Too high depth. Setting it to max (%d).", MAX_SAMPLES);
-    modulation_depth_samples = MAX_SAMPLES;
+  if (modulation_depth_samples > MAX_DEPTH_SAMPLES) {
+    fluid_log(FLUID_WARN, "chorus: Too high depth. Setting it to max (%d).", MAX_DEPTH_SAMPLES);
+    modulation_depth_samples = MAX_DEPTH_SAMPLES;
   }
 
+  /* After that long, the delay line holds nothing but silence */
+  chorus->tail_samples = modulation_depth_samples + INTERPOLATION_SAMPLES;
+
   /* initialize LFO table */
   if (chorus->type == FLUID_CHORUS_MOD_SINE) {
     fluid_chorus_sine(chorus->lookup_tab, chorus->modulation_period_samples,
@@ -423,139 +445,146 @@ fluid_chorus_update(fluid_chorus_t* chorus)
 }
 
 
-void fluid_chorus_processmix(fluid_chorus_t* chorus, fluid_real_t *in,
-			    fluid_real_t *left_out, fluid_real_t *right_out)
+/* Returns 1 when the input has been silent for longer than the longest
+ * delay, then the whole delay line is silent and the block can be skipped */
+static int
+fluid_chorus_skip_block(fluid_chorus_t* chorus, fluid_real_t *in)
 {
-  int sample_index;
-  int i;
-  fluid_real_t d_in, d_out;
-
-  for (sample_index = 0; sample_index < FLUID_BUFSIZE; sample_index++) {
-
-    d_in = in[sample_index];
-    d_out = 0.0f;
-
-# if 0
-    /* Debug: Listen to the chorus signal only */
-    left_out[sample_index]=0;
-    right_out[sample_index]=0;
-#endif
-
-    /* Write the current sample into the circular buffer */
-    chorus->chorusbuf[chorus->counter] = d_in;
-
-    for (i = 0; i < chorus->number_blocks; i++) {
-      int ii;
-      /* Calculate the delay in subsamples for the delay line of chorus block nr. */
-
-      /* The value in the lookup table is so, that this expression
-       * will always be positive.  It will always include a number of
-       * full periods of MAX_SAMPLES*INTERPOLATION_SUBSAMPLES to
-       * remain positive at all times. */
-      int pos_subsamples = (INTERPOLATION_SUBSAMPLES * chorus->counter
-			    - chorus->lookup_tab[chorus->phase[i]]);
-
-      int pos_samples = pos_subsamples/INTERPOLATION_SUBSAMPLES;
-
-      /* modulo divide by INTERPOLATION_SUBSAMPLES */
-      pos_subsamples &= INTERPOLATION_SUBSAMPLES_ANDMASK;
-
-      for (ii = 0; ii < INTERPOLATION_SAMPLES; ii++){
-	/* Add the delayed signal to the chorus sum d_out Note: The
-	 * delay in the delay line moves backwards for increasing
-	 * delay!*/
-
-	/* The & in chorusbuf[...] is equivalent to a division modulo
-	   MAX_SAMPLES, only faster. */
-	d_out += chorus->chorusbuf[pos_samples & MAX_SAMPLES_ANDMASK]
-	  * chorus->sinc_table[ii][pos_subsamples];
+  if (!fluid_simd_is_silent(in, FLUID_BUFSIZE)) {
+    chorus->silent_samples = 0;
+    return 0;
+  }
 
-	pos_samples--;
-      };
-      /* Cycle the phase of the modulating LFO */
-      chorus->phase[i]++;
-      chorus->phase[i] %= (chorus->modulation_period_samples);
-    } /* foreach chorus block */
+  if (chorus->silent_samples < chorus->tail_samples) {
+    chorus->silent_samples += FLUID_BUFSIZE;
+    return 0;
+  }
 
-    d_out *= chorus->level;
+  return 1;
+}
 
-    /* Add the chorus sum d_out to output */
-    left_out[sample_index] += d_out;
-    right_out[sample_index] += d_out;
+/* Where chorus block i reads for the next output sample, and at which
+ * subsample. Cycles the phase of the modulating LFO. */
+static inline const fluid_real_t*
+fluid_chorus_next_tap(fluid_chorus_t* chorus, int i, int counter, const fluid_real_t** coeffs)
+{
+  /* The value in the lookup table is so, that this expression
+   * will always be positive.  It will always include a number of
+   * full periods of MAX_SAMPLES*INTERPOLATION_SUBSAMPLES to
+   * remain positive at all times. */
+  int pos_subsamples = (INTERPOLATION_SUBSAMPLES * counter
+			- chorus->lookup_tab[chorus->phase[i]]);
+  int pos_samples = pos_subsamples / INTERPOLATION_SUBSAMPLES;
+
+  if (++chorus->phase[i] >= chorus->modulation_period_samples) {
+    chorus->phase[i] = 0;
+  }
 
-    /* Move forward in circular buffer */
-    chorus->counter++;
-    chorus->counter %= MAX_SAMPLES;
+  /* modulo divide by INTERPOLATION_SUBSAMPLES */
+  *coeffs = chorus->sinc_table[pos_subsamples & INTERPOLATION_SUBSAMPLES_ANDMASK];
 
-  } /* foreach sample */
+  /* The delay in the delay line moves backwards for increasing delay,
+   * the taps are the INTERPOLATION_SAMPLES samples up to pos_samples.
+   * The & is equivalent to a division modulo MAX_SAMPLES, only faster. */
+  return chorus->chorusbuf + DELAY_LINE_GUARD + (pos_samples & MAX_SAMPLES_ANDMASK) - (INTERPOLATION_SAMPLES - 1);
 }
 
-/* Duplication of code ... (replaces sample data instead of mixing) */
-void fluid_chorus_processreplace(fluid_chorus_t* chorus, fluid_real_t *in,
-				fluid_real_t *left_out, fluid_real_t *right_out)
+/* Runs a block through the chorus, writes the chorus sum (before the level) to out */
+static void
+fluid_chorus_process_block(fluid_chorus_t* chorus, fluid_real_t *in, fluid_real_t *out)
 {
+  fluid_real_t* line = chorus->chorusbuf + DELAY_LINE_GUARD;
   int sample_index;
   int i;
-  fluid_real_t d_in, d_out;
 
+  /* Write the block into the circular buffer. The delay is never
+   * negative, so every sample only reads what was written before it,
+   * and the depth is limited so the rest of the block doesn't overwrite
+   * what it reads */
   for (sample_index = 0; sample_index < FLUID_BUFSIZE; sample_index++) {
+    int pos = (chorus->counter + sample_index) & MAX_SAMPLES_ANDMASK;
+    line[pos] = in[sample_index];
+    if (pos >= MAX_SAMPLES - DELAY_LINE_GUARD) {
+      line[pos - MAX_SAMPLES] = in[sample_index];
+    }
+  }
 
-    d_in = in[sample_index];
-    d_out = 0.0f;
+  FLUID_MEMSET(out, 0, FLUID_BUFSIZE * sizeof(fluid_real_t));
 
-# if 0
-    /* Debug: Listen to the chorus signal only */
-    left_out[sample_index]=0;
-    right_out[sample_index]=0;
+  for (i = 0; i < chorus->number_blocks; i++) {
+    sample_index = 0;
+
+#ifdef FLUID_SIMD
+    /* Four output samples at once, the first four taps of each are one vector */
+    for (; sample_index < FLUID_BUFSIZE; sample_index += 4) {
+      const fluid_real_t* taps[4];
+      const fluid_real_t* coeffs[4];
+      fluid_real_t last[4];
+      fluid_simd_t sum;
+      int j;
+
+      for (j = 0; j < 4; j++) {
+	taps[j] = fluid_chorus_next_tap(chorus, i, chorus->counter + sample_index + j, &coeffs[j]);
+	last[j] = taps[j][INTERPOLATION_SAMPLES - 1] * coeffs[j][INTERPOLATION_SAMPLES - 1];
+      }
+
+      sum = fluid_simd_sum4(fluid_simd_mul(fluid_simd_load(taps[0]), fluid_simd_load(coeffs[0])),
+			    fluid_simd_mul(fluid_simd_load(taps[1]), fluid_simd_load(coeffs[1])),
+			    fluid_simd_mul(fluid_simd_load(taps[2]), fluid_simd_load(coeffs[2])),
+			    fluid_simd_mul(fluid_simd_load(taps[3]), fluid_simd_load(coeffs[3])));
+      sum = fluid_simd_add(sum, fluid_simd_load(last));
+      fluid_simd_store(out + sample_index, fluid_simd_add(fluid_simd_load(out + sample_index), sum));
+    }
 #endif
 
-    /* Write the current sample into the circular buffer */
-    chorus->chorusbuf[chorus->counter] = d_in;
-
-    for (i = 0; i < chorus->number_blocks; i++) {
+    for (; sample_index < FLUID_BUFSIZE; sample_index++) {
+      const fluid_real_t* coeffs;
+      const fluid_real_t* taps = fluid_chorus_next_tap(chorus, i, chorus->counter + sample_index, &coeffs);
       int ii;
-      /* Calculate the delay in subsamples for the delay line of chorus block nr. */
 
-      /* The value in the lookup table is so, that this expression
-       * will always be positive.  It will always include a number of
-       * full periods of MAX_SAMPLES*INTERPOLATION_SUBSAMPLES to
-       * remain positive at all times. */
-      int pos_subsamples = (INTERPOLATION_SUBSAMPLES * chorus->counter
-			    - chorus->lookup_tab[chorus->phase[i]]);
+      for (ii = 0; ii < INTERPOLATION_SAMPLES; ii++) {
+	out[sample_index] += taps[ii] * coeffs[ii];
+      }
+    }
+  } /* foreach chorus block */
 
-      int pos_samples = pos_subsamples / INTERPOLATION_SUBSAMPLES;
-
-      /* modulo divide by INTERPOLATION_SUBSAMPLES */
-      pos_subsamples &= INTERPOLATION_SUBSAMPLES_ANDMASK;
+  /* Move forward in circular buffer */
+  chorus->counter = (chorus->counter + FLUID_BUFSIZE) & MAX_SAMPLES_ANDMASK;
+}
 
-      for (ii = 0; ii < INTERPOLATION_SAMPLES; ii++){
-	/* Add the delayed signal to the chorus sum d_out Note: The
-	 * delay in the delay line moves backwards for increasing
-	 * delay!*/
+void fluid_chorus_processmix(fluid_chorus_t* chorus, fluid_real_t *in,
+			    fluid_real_t *left_out, fluid_real_t *right_out)
+{
+  fluid_real_t d_out[FLUID_BUFSIZE];
 
-	/* The & in chorusbuf[...] is equivalent to a division modulo
-	   MAX_SAMPLES, only faster. */
-	d_out += chorus->chorusbuf[pos_samples & MAX_SAMPLES_ANDMASK]
-	  * chorus->sinc_table[ii][pos_subsamples];
+  if (fluid_chorus_skip_block(chorus, in)) {
+    return;
+  }
 
-	pos_samples--;
-      };
-      /* Cycle the phase of the modulating LFO */
-      chorus->phase[i]++;
-      chorus->phase[i] %= (chorus->modulation_period_samples);
-    } /* foreach chorus block */
+  fluid_chorus_process_block(chorus, in, d_out);
 
-    d_out *= chorus->level;
+  /* Add the chorus sum d_out to output */
+  fluid_simd_mix_centered(left_out, right_out, d_out, chorus->level, FLUID_BUFSIZE);
+}
 
-    /* Store the chorus sum d_out to output */
-    left_out[sample_index] = d_out;
-    right_out[sample_index] = d_out;
+/* Same as fluid_chorus_processmix, but replaces the sample data instead of mixing */
+void fluid_chorus_processreplace(fluid_chorus_t* chorus, fluid_real_t *in,
+				fluid_real_t *left_out, fluid_real_t *right_out)
+{
+  fluid_real_t d_out[FLUID_BUFSIZE];
+  int skip = fluid_chorus_skip_block(chorus, in);
 
-    /* Move forward in circular buffer */
-    chorus->counter++;
-    chorus->counter %= MAX_SAMPLES;
+  /* 'in' can be the same buffer as left_out, it's been read completely before this */
+  if (!skip) {
+    fluid_chorus_process_block(chorus, in, d_out);
+  }
 
-  } /* foreach sample */
+  /* Store the chorus sum d_out to output */
+  FLUID_MEMSET(left_out, 0, sizeof(d_out));
+  FLUID_MEMSET(right_out, 0, sizeof(d_out));
+  if (!skip) {
+    fluid_simd_mix_centered(left_out, right_out, d_out, chorus->level, FLUID_BUFSIZE);
+  }
 }
 
 /* Purpose:
@@ -27,6 +27,19 @@
 /* Todo: Get rid of that 'include' */
 #include "fluid_sys.h"
 
+#if SF3_SUPPORT
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static void fluid_defsfont_load_pcm_cache(fluid_defsfont_t* sfont);
+static void fluid_pcm_cache_unmap(fluid_defsfont_t* sfont);
+#endif
+
 #if SF3_SUPPORT == SF3_XIPH_VORBIS
 #include "vorbis/codec.h"
 #include "vorbis/vorbisenc.h"
@@ -355,6 +368,8 @@ fluid_defsfont_t* new_fluid_defsfont()
   sfont->samplesize = 0;
   sfont->sample = NULL;
   sfont->sampledata = NULL;
+  sfont->pcm_cache = NULL;
+  sfont->pcm_cache_size = 0;
   sfont->preset = NULL;
 
   return sfont;
@@ -393,6 +408,10 @@ int delete_fluid_defsfont(fluid_defsfont_t* sfont)
     FLUID_FREE(sfont->sampledata);
   }
 
+#if SF3_SUPPORT
+  fluid_pcm_cache_unmap(sfont);
+#endif
+
   preset = sfont->preset;
   while (preset != NULL) {
     sfont->preset = preset->next;
@@ -469,6 +488,11 @@ int fluid_defsfont_load(fluid_defsfont_t* sfont, const char* file, fluid_fileapi
     p = fluid_list_next(p);
   }
 
+#if SF3_SUPPORT
+  /* Use the decoded samples from the cache, if there is one */
+  fluid_defsfont_load_pcm_cache(sfont);
+#endif
+
   /* Load all the presets */
   p = sfdata->preset;
   while (p != NULL) {
@@ -586,87 +610,391 @@ fluid_defsfont_load_sampledata(fluid_defsfont_t* sfont, fluid_fileapi_t* fapi)
   return FLUID_OK;
 }
 
+#if SF3_SUPPORT
 /*
- * fluid_defsfont_get_sample
+ * fluid_sample_decode_vorbis
+ *
+ * Decodes a compressed sample, returns the PCM data and sets frames to its length
  */
-fluid_sample_t* fluid_defsfont_get_sample(fluid_defsfont_t* sfont, char *s)
+static short* fluid_sample_decode_vorbis(fluid_sample_t* sample, int* frames)
 {
+  short *sampledata = NULL;
+  int sampleframes = 0;
+
+#if SF3_SUPPORT == SF3_XIPH_VORBIS
+  int sampledata_size = 0;
+  OggVorbis_File vf;
+
+  vorbisData.pos  = 0;
+  vorbisData.data = (char*)sample->data + sample->start;
+  vorbisData.datasize = sample->end + 1 - sample->start;
+
+  if (ov_open_callbacks(&vorbisData, &vf, 0, 0, ovCallbacks) == 0) {
+#define BUFFER_SIZE 4096
+    int bytes_read = 0;
+    int section = 0;
+    for (;;) {
+      // allocate additional memory for samples
+      sampledata = realloc(sampledata, sampledata_size + BUFFER_SIZE);
+      bytes_read = ov_read(&vf, (char*)sampledata + sampledata_size, BUFFER_SIZE, 0, sizeof(short), 1, &section);
+      if (bytes_read > 0) {
+        sampledata_size += bytes_read;
+      } else {
+        // shrink sampledata to actual size
+        sampledata = realloc(sampledata, sampledata_size);
+        break;
+      }
+    }
+
+    ov_clear(&vf);
+  }
+
+  // because we actually need num of frames so we should divide num of bytes to frame size
+  sampleframes = sampledata_size / sizeof(short);
+#endif
+
+#if SF3_SUPPORT == SF3_STB_VORBIS
+  const uint8 *data = (uint8*)sample->data + sample->start;
+  const int datasize = sample->end + 1 - sample->start;
+
+  int channels;
+  sampleframes = stb_vorbis_decode_memory(data, datasize, &channels, NULL, &sampledata);
+#endif
+
+  *frames = sampleframes;
+  return sampledata;
+}
+
+/*
+ * fluid_sample_set_unpacked
+ *
+ * Points a compressed sample at its decoded data. Data that comes from the
+ * PCM cache is mapped, and doesn't belong to the sample.
+ */
+static void fluid_sample_set_unpacked(fluid_sample_t* sample, short* sampledata, int sampleframes, int cached)
+{
+  // point sample data to uncompressed data stream
+  sample->data = sampledata;
+  sample->start = 0;
+  sample->end = sampleframes - 1;
+
+  /* loop is fowled?? (cluck cluck :) */
+  if (sample->loopend > sample->end ||
+      sample->loopstart >= sample->loopend ||
+      sample->loopstart <= sample->start) {
+    /* can pad loop by 8 samples and ensure at least 4 for loop (2*8+4) */
+    if ((sample->end - sample->start) >= 20) {
+      sample->loopstart = sample->start + 8;
+      sample->loopend = sample->end - 8;
+    } else { /* loop is fowled, sample is tiny (can't pad 8 samples) */
+      sample->loopstart = sample->start + 1;
+      sample->loopend = sample->end - 1;
+    }
+  }
+
+  sample->sampletype &= ~FLUID_SAMPLETYPE_OGG_VORBIS;
+  sample->sampletype |= FLUID_SAMPLETYPE_OGG_VORBIS_UNPACKED;
+  if (cached) sample->sampletype |= FLUID_SAMPLETYPE_OGG_VORBIS_CACHED;
+
+  fluid_voice_optimize_sample(sample);
+}
+
+/***************************************************************
+ *
+ *                           PCM CACHE
+ *
+ * Decoding all samples of a .sf3 file takes a while, and every synth that
+ * loads it used to keep its own decoded copy. When a cache directory is
+ * set, the decoded samples are written to "<dir>/<hash>.pcm" the first time
+ * a soundfont is loaded, the hash being that of the compressed sample data.
+ * After that, the file is mapped into memory instead of decoding again, so
+ * all synths in the process that use the same soundfont share its pages.
+ *
+ * The file starts with a header, followed by the start offset and length
+ * of every compressed sample in the order they appear in the soundfont,
+ * followed by the PCM data of these samples. It's written in native byte
+ * order, the cache is never shared between computers.
+ */
+
+#define FLUID_PCM_CACHE_MAGIC    "FLPCM\0\0\1"
+#define FLUID_PCM_CACHE_MAX_PATH 4096
+
+typedef struct {
+  char magic[8];
+  unsigned int count;       /* number of samples in the cache */
+  unsigned int reserved;
+} fluid_pcm_cache_header_t;
+
+typedef struct {
+  unsigned int start;       /* offset of the compressed sample in the sample data */
+  unsigned int frames;      /* length of the decoded sample */
+} fluid_pcm_cache_entry_t;
+
+static char fluid_pcm_cache_dir[FLUID_PCM_CACHE_MAX_PATH] = { 0 };
+
+void fluid_set_sample_cache_dir(const char* dir)
+{
+  if (dir == NULL || FLUID_STRLEN(dir) + 32 >= FLUID_PCM_CACHE_MAX_PATH) {
+    fluid_pcm_cache_dir[0] = 0;
+    return;
+  }
+  FLUID_STRCPY(fluid_pcm_cache_dir, dir);
+}
+
+/* 64 bit FNV-1a */
+static unsigned long long fluid_pcm_cache_hash(const unsigned char* data, unsigned int size)
+{
+  unsigned long long hash = 0xcbf29ce484222325ULL;
+  unsigned int i;
+  for (i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static int fluid_pcm_cache_map(fluid_defsfont_t* sfont, const char* path)
+{
+#ifdef _WIN32
+  HANDLE file, mapping;
+  LARGE_INTEGER size;
+
+  file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) return FLUID_FAILED;
+
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return FLUID_FAILED;
+  }
+
+  mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if (mapping == NULL) return FLUID_FAILED;
+
+  sfont->pcm_cache = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (sfont->pcm_cache == NULL) return FLUID_FAILED;
+
+  sfont->pcm_cache_size = (size_t) size.QuadPart;
+#else
+  struct stat st;
+  void* data;
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) return FLUID_FAILED;
+
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return FLUID_FAILED;
+  }
+
+  data = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) return FLUID_FAILED;
+
+  sfont->pcm_cache = data;
+  sfont->pcm_cache_size = (size_t) st.st_size;
+#endif
+  return FLUID_OK;
+}
+
+static void fluid_pcm_cache_unmap(fluid_defsfont_t* sfont)
+{
+  if (sfont->pcm_cache == NULL) return;
+#ifdef _WIN32
+  UnmapViewOfFile(sfont->pcm_cache);
+#else
+  munmap(sfont->pcm_cache, sfont->pcm_cache_size);
+#endif
+  sfont->pcm_cache = NULL;
+  sfont->pcm_cache_size = 0;
+}
+
+/* Decodes all compressed samples into the cache file. It's written under a
+   temporary name first, so other synths never map a half-written cache. */
+static int fluid_pcm_cache_write(fluid_defsfont_t* sfont, const char* path, unsigned int count)
+{
+  char temp_path[FLUID_PCM_CACHE_MAX_PATH + 32];
+  fluid_pcm_cache_header_t header;
+  fluid_pcm_cache_entry_t* entries;
   fluid_list_t* list;
   fluid_sample_t* sample;
+  unsigned int i = 0;
+  int ok = 1;
+  int length;
+  FILE* file;
+
+#ifdef _WIN32
+  length = FLUID_SNPRINTF(temp_path, sizeof(temp_path), "%s.%lu-%p.tmp", path, (unsigned long) GetCurrentProcessId(), (void*) sfont);
+#else
+  length = FLUID_SNPRINTF(temp_path, sizeof(temp_path), "%s.%lu-%p.tmp", path, (unsigned long) getpid(), (void*) sfont);
+#endif
+  if (length < 0 || length >= (int) sizeof(temp_path)) {
+    return FLUID_FAILED;
+  }
+
+  entries = FLUID_ARRAY(fluid_pcm_cache_entry_t, count);
+  if (entries == NULL) {
+    FLUID_LOG(FLUID_ERR, "Out of memory");
+    return FLUID_FAILED;
+  }
+  FLUID_MEMSET(entries, 0, count * sizeof(fluid_pcm_cache_entry_t));
+
+  file = FLUID_FOPEN(temp_path, "wb");
+  if (file == NULL) {
+    FLUID_FREE(entries);
+    return FLUID_FAILED;
+  }
+
+  FLUID_MEMCPY(header.magic, FLUID_PCM_CACHE_MAGIC, sizeof(header.magic));
+  header.count = count;
+  header.reserved = 0;
+
+  /* The entries are filled in once we know the length of every sample */
+  ok = fwrite(&header, sizeof(header), 1, file) == 1
+    && fwrite(entries, sizeof(fluid_pcm_cache_entry_t), count, file) == count;
+
+  for (list = sfont->sample; ok && list; list = fluid_list_next(list)) {
+    short* sampledata;
+    int sampleframes = 0;
+
+    sample = (fluid_sample_t*) fluid_list_get(list);
+    if (!(sample->sampletype & FLUID_SAMPLETYPE_OGG_VORBIS)) continue;
+
+    sampledata = fluid_sample_decode_vorbis(sample, &sampleframes);
+    if (sampleframes < 0) sampleframes = 0;
+
+    entries[i].start = sample->start;
+    entries[i].frames = sampleframes;
+    i++;
+
+    if (sampleframes > 0)
+      ok = fwrite(sampledata, sizeof(short), sampleframes, file) == (size_t) sampleframes;
 
+    if (sampledata != NULL) FLUID_FREE(sampledata);
+  }
+
+  ok = ok && FLUID_FSEEK(file, sizeof(header), SEEK_SET) == 0
+    && fwrite(entries, sizeof(fluid_pcm_cache_entry_t), count, file) == count;
+  ok = (FLUID_FCLOSE(file) == 0) && ok;
+  FLUID_FREE(entries);
+
+  /* If renaming fails, another synth probably finished the same cache in the meantime */
+  if (!ok || rename(temp_path, path) != 0) remove(temp_path);
+
+  return ok ? FLUID_OK : FLUID_FAILED;
+}
+
+/* Points every compressed sample into the mapped cache, returns FLUID_FAILED if the cache doesn't match the soundfont */
+static int fluid_pcm_cache_apply(fluid_defsfont_t* sfont, unsigned int count)
+{
+  const fluid_pcm_cache_header_t* header = (const fluid_pcm_cache_header_t*) sfont->pcm_cache;
+  const fluid_pcm_cache_entry_t* entries = (const fluid_pcm_cache_entry_t*) (header + 1);
+  size_t offset = sizeof(fluid_pcm_cache_header_t) + count * sizeof(fluid_pcm_cache_entry_t);
+  fluid_list_t* list;
+  fluid_sample_t* sample;
+  unsigned int i = 0;
+
+  if (sfont->pcm_cache_size < offset
+      || FLUID_MEMCMP(header->magic, FLUID_PCM_CACHE_MAGIC, sizeof(header->magic)) != 0
+      || header->count != count) {
+    return FLUID_FAILED;
+  }
+
+  /* Check the whole table first, we can't undo pointing a sample into the cache */
   for (list = sfont->sample; list; list = fluid_list_next(list)) {
+    sample = (fluid_sample_t*) fluid_list_get(list);
+    if (!(sample->sampletype & FLUID_SAMPLETYPE_OGG_VORBIS)) continue;
+
+    if (entries[i].start != sample->start) return FLUID_FAILED;
+    offset += entries[i].frames * sizeof(short);
+    i++;
+  }
+  if (offset != sfont->pcm_cache_size) return FLUID_FAILED;
 
+  offset = sizeof(fluid_pcm_cache_header_t) + count * sizeof(fluid_pcm_cache_entry_t);
+  i = 0;
+  for (list = sfont->sample; list; list = fluid_list_next(list)) {
     sample = (fluid_sample_t*) fluid_list_get(list);
+    if (!(sample->sampletype & FLUID_SAMPLETYPE_OGG_VORBIS)) continue;
 
-    if (FLUID_STRCMP(sample->name, s) == 0) {
+    fluid_sample_set_unpacked(sample, (short*) ((char*) sfont->pcm_cache + offset), entries[i].frames, 1);
+    offset += entries[i].frames * sizeof(short);
+    i++;
+  }
+  return FLUID_OK;
+}
 
-#if SF3_SUPPORT
-      if (sample->sampletype & FLUID_SAMPLETYPE_OGG_VORBIS) {
-        short *sampledata = NULL;
-        int sampleframes = 0;
+/*
+ * fluid_defsfont_load_pcm_cache
+ *
+ * Loads the decoded samples from the cache, decoding them into it first if
+ * needed. If anything goes wrong, the samples stay compressed and are
+ * decoded on their own when they're first used.
+ */
+static void fluid_defsfont_load_pcm_cache(fluid_defsfont_t* sfont)
+{
+  char path[FLUID_PCM_CACHE_MAX_PATH + 32];
+  unsigned long long hash;
+  unsigned int count = 0;
+  int length;
+  fluid_list_t* list;
 
-#if SF3_SUPPORT == SF3_XIPH_VORBIS
-        int sampledata_size = 0;
-        OggVorbis_File vf;
+  if (fluid_pcm_cache_dir[0] == 0) return;
 
-        vorbisData.pos  = 0;
-        vorbisData.data = (char*)sample->data + sample->start;
-        vorbisData.datasize = sample->end + 1 - sample->start;
+  for (list = sfont->sample; list; list = fluid_list_next(list)) {
+    if (((fluid_sample_t*) fluid_list_get(list))->sampletype & FLUID_SAMPLETYPE_OGG_VORBIS) count++;
+  }
+  if (count == 0) return;
 
-        if (ov_open_callbacks(&vorbisData, &vf, 0, 0, ovCallbacks) == 0) {
-#define BUFFER_SIZE 4096
-          int bytes_read = 0;
-          int section = 0;
-          for (;;) {
-            // allocate additional memory for samples
-            sampledata = realloc(sampledata, sampledata_size + BUFFER_SIZE);
-            bytes_read = ov_read(&vf, (char*)sampledata + sampledata_size, BUFFER_SIZE, 0, sizeof(short), 1, &section);
-            if (bytes_read > 0) {
-              sampledata_size += bytes_read;
-            } else {
-              // shrink sampledata to actual size
-              sampledata = realloc(sampledata, sampledata_size);
-              break;
-            }
-          }
-
-          ov_clear(&vf);
-        }
+  hash = fluid_pcm_cache_hash((const unsigned char*) sfont->sampledata, sfont->samplesize);
+  length = FLUID_SNPRINTF(path, sizeof(path), "%s/%08x%08x-%u.pcm", fluid_pcm_cache_dir,
+                          (unsigned int) (hash >> 32), (unsigned int) hash, sfont->samplesize);
+  if (length < 0 || length >= (int) sizeof(path)) return;
 
-        // because we actually need num of frames so we should divide num of bytes to frame size
-        sampleframes = sampledata_size / sizeof(short);
-#endif
+  if (fluid_pcm_cache_map(sfont, path) == FLUID_OK) {
+    if (fluid_pcm_cache_apply(sfont, count) == FLUID_OK) return;
 
-#if SF3_SUPPORT == SF3_STB_VORBIS
-        const uint8 *data = (uint8*)sample->data + sample->start;
-        const int datasize = sample->end + 1 - sample->start;
+    /* Left behind by an older version, or cut short: write it again */
+    fluid_pcm_cache_unmap(sfont);
+    remove(path);
+  }
 
-        int channels;
-        sampleframes = stb_vorbis_decode_memory(data, datasize, &channels, NULL, &sampledata);
+  if (fluid_pcm_cache_write(sfont, path, count) != FLUID_OK
+      || fluid_pcm_cache_map(sfont, path) != FLUID_OK) {
+    FLUID_LOG(FLUID_WARN, "Couldn't write the sample cache %s", path);
+    return;
+  }
+
+  if (fluid_pcm_cache_apply(sfont, count) != FLUID_OK) {
+    FLUID_LOG(FLUID_WARN, "Ignoring sample cache %s: it doesn't match the soundfont", path);
+    fluid_pcm_cache_unmap(sfont);
+  }
+}
+#else
+void fluid_set_sample_cache_dir(const char* dir)
+{
+}
 #endif
-        // point sample data to uncompressed data stream
-        sample->data = sampledata;
-        sample->start = 0;
-        sample->end = sampleframes - 1;
-
-        /* loop is fowled?? (cluck cluck :) */
-        if (sample->loopend > sample->end ||
-            sample->loopstart >= sample->loopend ||
-            sample->loopstart <= sample->start) {
-          /* can pad loop by 8 samples and ensure at least 4 for loop (2*8+4) */
-          if ((sample->end - sample->start) >= 20) {
-            sample->loopstart = sample->start + 8;
-            sample->loopend = sample->end - 8;
-          } else { /* loop is fowled, sample is tiny (can't pad 8 samples) */
-            sample->loopstart = sample->start + 1;
-            sample->loopend = sample->end - 1;
-          }
-        }
 
-        sample->sampletype &= ~FLUID_SAMPLETYPE_OGG_VORBIS;
-        sample->sampletype |= FLUID_SAMPLETYPE_OGG_VORBIS_UNPACKED;
+/*
+ * fluid_defsfont_get_sample
+ */
+fluid_sample_t* fluid_defsfont_get_sample(fluid_defsfont_t* sfont, char *s)
+{
+  fluid_list_t* list;
+  fluid_sample_t* sample;
+
+  for (list = sfont->sample; list; list = fluid_list_next(list)) {
+
+    sample = (fluid_sample_t*) fluid_list_get(list);
 
-        fluid_voice_optimize_sample(sample);
+    if (FLUID_STRCMP(sample->name, s) == 0) {
+
+#if SF3_SUPPORT
+      if (sample->sampletype & FLUID_SAMPLETYPE_OGG_VORBIS) {
+        int sampleframes = 0;
+        short *sampledata = fluid_sample_decode_vorbis(sample, &sampleframes);
+        fluid_sample_set_unpacked(sample, sampledata, sampleframes, 0);
       }
 #endif
 
@@ -1808,7 +2136,8 @@ int
 delete_fluid_sample(fluid_sample_t* sample)
 {
 #if SF3_SUPPORT
-  if (sample->sampletype & FLUID_SAMPLETYPE_OGG_VORBIS_UNPACKED) {
+  if ((sample->sampletype & FLUID_SAMPLETYPE_OGG_VORBIS_UNPACKED)
+      && !(sample->sampletype & FLUID_SAMPLETYPE_OGG_VORBIS_CACHED)) {
     if (sample->data != NULL) FLUID_FREE(sample->data);
   }
 #endif
@@ -480,6 +480,8 @@ struct _fluid_defsfont_t
   unsigned int samplepos;   /* the position in the file at which the sample data starts */
   unsigned int samplesize;  /* the size of the sample data */
   short* sampledata;        /* the sample data, loaded in ram */
+  void* pcm_cache;          /* the mapped cache of decoded samples, if any */
+  size_t pcm_cache_size;    /* the size of the mapped cache */
   fluid_list_t* sample;      /* the samples in this soundfont */
   fluid_defpreset_t* preset; /* the presets of this soundfont */
 
@@ -594,6 +596,9 @@ fluid_sample_t* fluid_inst_zone_get_sample(fluid_inst_zone_t* zone);
 
 
 
+/* Set on unpacked samples whose data is mapped from the PCM cache, so it isn't freed with the sample */
+#define FLUID_SAMPLETYPE_OGG_VORBIS_CACHED 0x40
+
 fluid_sample_t* new_fluid_sample(void);
 int delete_fluid_sample(fluid_sample_t* sample);
 int fluid_sample_import_sfont(fluid_sample_t* sample, SFSample* sfsample, fluid_defsfont_t* sfont);
@@ -46,6 +46,7 @@
 #include "fluidsynth_priv.h"
 #include "fluid_synth.h"
 #include "fluid_voice.h"
+#include "fluid_simd.h"
 
 
 /* Interpolation (find a value between two samples of the original waveform) */
@@ -347,6 +348,29 @@ fluid_dsp_float_interpolate_4th_order (fluid_voice_t *voice)
       dsp_amp += dsp_amp_incr;
     }
 
+#ifdef FLUID_SIMD
+    /* interpolate four points at a time, while the last of them is still in the sequence */
+    while (dsp_i + 4 <= FLUID_BUFSIZE
+	   && fluid_phase_index (dsp_phase + 3 * dsp_phase_incr) <= end_index)
+    {
+      const short int *points[4];
+      const fluid_real_t *rows[4];
+      int k;
+
+      for (k = 0; k < 4; k++)
+      {
+	points[k] = dsp_data + fluid_phase_index (dsp_phase) - 1;
+	rows[k] = interp_coeff[fluid_phase_fract_to_tablerow (dsp_phase)];
+	fluid_phase_incr (dsp_phase, dsp_phase_incr);
+      }
+
+      fluid_simd_interpolate_4th_order (dsp_buf + dsp_i, points, rows, dsp_amp, dsp_amp_incr);
+      dsp_amp += 4 * dsp_amp_incr;
+      dsp_i += 4;
+    }
+    dsp_phase_index = fluid_phase_index (dsp_phase);
+#endif
+
     /* interpolate the sequence of sample points */
     for ( ; dsp_i < FLUID_BUFSIZE && dsp_phase_index <= end_index; dsp_i++)
     {
@@ -562,6 +586,29 @@ fluid_dsp_float_interpolate_7th_order (fluid_voice_t *voice)
     start_index -= 2;	/* set back to original start index */
 
 
+#ifdef FLUID_SIMD
+    /* interpolate four points at a time, while the last of them is still in the sequence */
+    while (dsp_i + 4 <= FLUID_BUFSIZE
+	   && fluid_phase_index (dsp_phase + 3 * dsp_phase_incr) <= end_index)
+    {
+      const short int *points[4];
+      const fluid_real_t *rows[4];
+      int k;
+
+      for (k = 0; k < 4; k++)
+      {
+	points[k] = dsp_data + fluid_phase_index (dsp_phase) - 3;
+	rows[k] = sinc_table7[fluid_phase_fract_to_tablerow (dsp_phase)];
+	fluid_phase_incr (dsp_phase, dsp_phase_incr);
+      }
+
+      fluid_simd_interpolate_7th_order (dsp_buf + dsp_i, points, rows, dsp_amp, dsp_amp_incr);
+      dsp_amp += 4 * dsp_amp_incr;
+      dsp_i += 4;
+    }
+    dsp_phase_index = fluid_phase_index (dsp_phase);
+#endif
+
     /* interpolate the sequence of sample points */
     for ( ; dsp_i < FLUID_BUFSIZE && dsp_phase_index <= end_index; dsp_i++)
     {
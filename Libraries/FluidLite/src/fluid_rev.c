@@ -10,6 +10,7 @@
 */
 
 #include "fluid_rev.h"
+#include "fluid_simd.h"
 
 /***************************************************************
  *
@@ -107,17 +108,47 @@ fluid_allpass_getfeedback(fluid_allpass* allpass)
   return allpass->feedback;
 }
 
-#define fluid_allpass_process(_allpass, _input) \
-{ \
-  fluid_real_t output; \
-  fluid_real_t bufout; \
-  bufout = _allpass.buffer[_allpass.bufidx]; \
-  output = bufout-_input; \
-  _allpass.buffer[_allpass.bufidx] = _input + (bufout * _allpass.feedback); \
-  if (++_allpass.bufidx >= _allpass.bufsize) { \
-    _allpass.bufidx = 0; \
-  } \
-  _input = output; \
+/* Runs a block through the allpass, in place.
+ * The allpass is longer than a block, so nothing it reads in this block
+ * was written in this block, and all samples can be done at once. */
+static void
+fluid_allpass_process_block(fluid_allpass* allpass, fluid_real_t* io)
+{
+  int k = 0;
+
+  while (k < FLUID_BUFSIZE) {
+    fluid_real_t* buf = allpass->buffer + allpass->bufidx;
+    int run = allpass->bufsize - allpass->bufidx;
+    int j = 0;
+
+    if (run > FLUID_BUFSIZE - k) {
+      run = FLUID_BUFSIZE - k;
+    }
+
+#ifdef FLUID_SIMD
+    {
+      fluid_simd_t feedback = fluid_simd_set1(allpass->feedback);
+      for (; j + 4 <= run; j += 4) {
+        fluid_simd_t bufout = fluid_simd_load(buf + j);
+        fluid_simd_t input = fluid_simd_load(io + k + j);
+        fluid_simd_store(buf + j, fluid_simd_add(input, fluid_simd_mul(bufout, feedback)));
+        fluid_simd_store(io + k + j, fluid_simd_sub(bufout, input));
+      }
+    }
+#endif
+    for (; j < run; j++) {
+      fluid_real_t bufout = buf[j];
+      fluid_real_t input = io[k + j];
+      buf[j] = input + (bufout * allpass->feedback);
+      io[k + j] = bufout - input;
+    }
+
+    k += run;
+    allpass->bufidx += run;
+    if (allpass->bufidx >= allpass->bufsize) {
+      allpass->bufidx = 0;
+    }
+  }
 }
 
 /*  fluid_real_t fluid_allpass_process(fluid_allpass* allpass, fluid_real_t input) */
@@ -196,15 +227,108 @@ fluid_comb_getfeedback(fluid_comb* comb)
   return comb->feedback;
 }
 
-#define fluid_comb_process(_comb, _input, _output) \
-{ \
-  fluid_real_t _tmp = _comb.buffer[_comb.bufidx]; \
-  _comb.filterstore = (_tmp * _comb.damp2) + (_comb.filterstore * _comb.damp1); \
-  _comb.buffer[_comb.bufidx] = _input + (_comb.filterstore * _comb.feedback); \
-  if (++_comb.bufidx >= _comb.bufsize) { \
-    _comb.bufidx = 0; \
-  } \
-  _output += _tmp; \
+/* The combs are processed a block at a time, in banks of four: one comb
+ * in each lane of a vector. Every comb is longer than a block, so what a
+ * comb reads in a block was written before the block started. Only the
+ * damping filter depends on the previous sample, and the four combs of a
+ * bank run that filter side by side. */
+#define FLUID_COMB_BANK 4
+
+/* Copies the next FLUID_BUFSIZE samples of a delay line to dst[0], dst[stride], ... */
+static void
+fluid_comb_read_block(fluid_comb* comb, fluid_real_t* dst, int stride)
+{
+  int run = comb->bufsize - comb->bufidx;
+  int k;
+
+  if (run > FLUID_BUFSIZE) {
+    run = FLUID_BUFSIZE;
+  }
+  for (k = 0; k < run; k++) {
+    dst[k * stride] = comb->buffer[comb->bufidx + k];
+  }
+  for (; k < FLUID_BUFSIZE; k++) {
+    dst[k * stride] = comb->buffer[k - run];
+  }
+}
+
+/* Replaces the samples that were read with src[0], src[stride], ... and moves on by a block */
+static void
+fluid_comb_write_block(fluid_comb* comb, const fluid_real_t* src, int stride)
+{
+  int run = comb->bufsize - comb->bufidx;
+  int k;
+
+  if (run > FLUID_BUFSIZE) {
+    run = FLUID_BUFSIZE;
+  }
+  for (k = 0; k < run; k++) {
+    comb->buffer[comb->bufidx + k] = src[k * stride];
+  }
+  for (; k < FLUID_BUFSIZE; k++) {
+    comb->buffer[k - run] = src[k * stride];
+  }
+
+  comb->bufidx += FLUID_BUFSIZE;
+  if (comb->bufidx >= comb->bufsize) {
+    comb->bufidx -= comb->bufsize;
+  }
+}
+
+/* Runs FLUID_COMB_BANK combs in parallel and adds their sum to output */
+static void
+fluid_comb_bank_process_block(fluid_comb* combs, const fluid_real_t* input, fluid_real_t* output)
+{
+  /* taps[k * FLUID_COMB_BANK + c] is what comb c reads for sample k, feed is what it writes back */
+  fluid_real_t taps[FLUID_BUFSIZE * FLUID_COMB_BANK];
+  fluid_real_t feed[FLUID_BUFSIZE * FLUID_COMB_BANK];
+  fluid_real_t filterstore[FLUID_COMB_BANK], damp1[FLUID_COMB_BANK], damp2[FLUID_COMB_BANK], feedback[FLUID_COMB_BANK];
+  int c, k;
+
+  for (c = 0; c < FLUID_COMB_BANK; c++) {
+    fluid_comb_read_block(&combs[c], taps + c, FLUID_COMB_BANK);
+    filterstore[c] = combs[c].filterstore;
+    damp1[c] = combs[c].damp1;
+    damp2[c] = combs[c].damp2;
+    feedback[c] = combs[c].feedback;
+  }
+
+#ifdef FLUID_SIMD
+  {
+    fluid_simd_t store = fluid_simd_load(filterstore);
+    fluid_simd_t d1 = fluid_simd_load(damp1);
+    fluid_simd_t d2 = fluid_simd_load(damp2);
+    fluid_simd_t fb = fluid_simd_load(feedback);
+
+    for (k = 0; k < FLUID_BUFSIZE; k++) {
+      store = fluid_simd_add(fluid_simd_mul(fluid_simd_load(taps + k * FLUID_COMB_BANK), d2), fluid_simd_mul(store, d1));
+      fluid_simd_store(feed + k * FLUID_COMB_BANK, fluid_simd_add(fluid_simd_set1(input[k]), fluid_simd_mul(store, fb)));
+    }
+    fluid_simd_store(filterstore, store);
+
+    for (k = 0; k < FLUID_BUFSIZE; k += 4) {
+      fluid_simd_t sum = fluid_simd_sum4(fluid_simd_load(taps + k * FLUID_COMB_BANK),
+                                         fluid_simd_load(taps + (k + 1) * FLUID_COMB_BANK),
+                                         fluid_simd_load(taps + (k + 2) * FLUID_COMB_BANK),
+                                         fluid_simd_load(taps + (k + 3) * FLUID_COMB_BANK));
+      fluid_simd_store(output + k, fluid_simd_add(fluid_simd_load(output + k), sum));
+    }
+  }
+#else
+  for (k = 0; k < FLUID_BUFSIZE; k++) {
+    for (c = 0; c < FLUID_COMB_BANK; c++) {
+      fluid_real_t tmp = taps[k * FLUID_COMB_BANK + c];
+      filterstore[c] = (tmp * damp2[c]) + (filterstore[c] * damp1[c]);
+      feed[k * FLUID_COMB_BANK + c] = input[k] + (filterstore[c] * feedback[c]);
+      output[k] += tmp;
+    }
+  }
+#endif
+
+  for (c = 0; c < FLUID_COMB_BANK; c++) {
+    fluid_comb_write_block(&combs[c], feed + c, FLUID_COMB_BANK);
+    combs[c].filterstore = filterstore[c];
+  }
 }
 
 /* fluid_real_t fluid_comb_process(fluid_comb* comb, fluid_real_t input) */
@@ -268,12 +392,19 @@ fluid_comb_getfeedback(fluid_comb* comb)
 #define allpasstuningL4 225
 #define allpasstuningR4 225 + stereospread
 
+#if FLUID_BUFSIZE > allpasstuningL4 || (numcombs % FLUID_COMB_BANK) != 0
+#error "The reverb processes a block at a time: every delay line has to be longer than a block, and the combs have to fill whole banks"
+#endif
+
 struct _fluid_revmodel_t {
   fluid_real_t roomsize;
   fluid_real_t damp;
   fluid_real_t wet, wet1, wet2;
   fluid_real_t width;
   fluid_real_t gain;
+  /* Once the input has been silent for longer than the reverb rings, processing stops */
+  int tail_samples;
+  int silent_samples;
   /*
    The following are all declared inline
    to remove the need for dynamic allocation
@@ -386,6 +517,7 @@ void
 fluid_revmodel_init(fluid_revmodel_t* rev)
 {
   int i;
+  rev->silent_samples = 0;
   for (i = 0; i < numcombs;i++) {
     fluid_comb_init(&rev->combL[i]);
     fluid_comb_init(&rev->combR[i]);
@@ -402,80 +534,102 @@ fluid_revmodel_reset(fluid_revmodel_t* rev)
   fluid_revmodel_init(rev);
 }
 
-void
-fluid_revmodel_processreplace(fluid_revmodel_t* rev, fluid_real_t *in,
-			     fluid_real_t *left_out, fluid_real_t *right_out)
+/* Returns 1 when the input has been silent for longer than the reverb
+ * rings, then there's nothing left to hear and the block can be skipped.
+ * What's left in the delay lines is far below the noise floor, and just
+ * carries on once the input comes back. */
+static int
+fluid_revmodel_skip_block(fluid_revmodel_t* rev, fluid_real_t *in)
 {
-  int i, k = 0;
-  fluid_real_t outL, outR, input;
+  if (!fluid_simd_is_silent(in, FLUID_BUFSIZE)) {
+    rev->silent_samples = 0;
+    return 0;
+  }
 
-  for (k = 0; k < FLUID_BUFSIZE; k++) {
+  if (rev->silent_samples < rev->tail_samples) {
+    rev->silent_samples += FLUID_BUFSIZE;
+    return 0;
+  }
 
-    outL = outR = 0;
+  return 1;
+}
 
-    /* The original Freeverb code expects a stereo signal and 'input'
-     * is set to the sum of the left and right input sample. Since
-     * this code works on a mono signal, 'input' is set to twice the
-     * input sample. */
-    input = (2 * in[k] + DC_OFFSET) * rev->gain;
+/* Runs a block through the reverb, the output of the left and right
+ * channel is written to outL and outR before the wet/width mixing */
+static void
+fluid_revmodel_process_block(fluid_revmodel_t* rev, fluid_real_t *in,
+			     fluid_real_t *outL, fluid_real_t *outR)
+{
+  fluid_real_t input[FLUID_BUFSIZE];
+  int i, k;
 
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-      fluid_comb_process(rev->combL[i], input, outL);
-      fluid_comb_process(rev->combR[i], input, outR);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      fluid_allpass_process(rev->allpassL[i], outL);
-      fluid_allpass_process(rev->allpassR[i], outR);
-    }
+  /* The original Freeverb code expects a stereo signal and 'input'
+   * is set to the sum of the left and right input sample. Since
+   * this code works on a mono signal, 'input' is set to twice the
+   * input sample. */
+  for (k = 0; k < FLUID_BUFSIZE; k++) {
+    input[k] = (2 * in[k] + DC_OFFSET) * rev->gain;
+    outL[k] = outR[k] = 0;
+  }
 
-    /* Remove the DC offset */
-    outL -= DC_OFFSET;
-    outR -= DC_OFFSET;
+  /* Accumulate comb filters in parallel */
+  for (i = 0; i < numcombs; i += FLUID_COMB_BANK) {
+    fluid_comb_bank_process_block(&rev->combL[i], input, outL);
+    fluid_comb_bank_process_block(&rev->combR[i], input, outR);
+  }
+  /* Feed through allpasses in series */
+  for (i = 0; i < numallpasses; i++) {
+    fluid_allpass_process_block(&rev->allpassL[i], outL);
+    fluid_allpass_process_block(&rev->allpassR[i], outR);
+  }
 
-    /* Calculate output REPLACING anything already there */
-    left_out[k] = outL * rev->wet1 + outR * rev->wet2;
-    right_out[k] = outR * rev->wet1 + outL * rev->wet2;
+  /* Remove the DC offset */
+  for (k = 0; k < FLUID_BUFSIZE; k++) {
+    outL[k] -= DC_OFFSET;
+    outR[k] -= DC_OFFSET;
   }
 }
 
 void
-fluid_revmodel_processmix(fluid_revmodel_t* rev, fluid_real_t *in,
-			 fluid_real_t *left_out, fluid_real_t *right_out)
+fluid_revmodel_processreplace(fluid_revmodel_t* rev, fluid_real_t *in,
+			     fluid_real_t *left_out, fluid_real_t *right_out)
 {
-  int i, k = 0;
-  fluid_real_t outL, outR, input;
+  fluid_real_t outL[FLUID_BUFSIZE], outR[FLUID_BUFSIZE];
+  int skip = fluid_revmodel_skip_block(rev, in);
 
-  for (k = 0; k < FLUID_BUFSIZE; k++) {
+  /* 'in' can be the same buffer as left_out, it's been read completely before this */
+  if (!skip) {
+    fluid_revmodel_process_block(rev, in, outL, outR);
+  }
 
-    outL = outR = 0;
+  /* Calculate output REPLACING anything already there */
+  FLUID_MEMSET(left_out, 0, sizeof(outL));
+  FLUID_MEMSET(right_out, 0, sizeof(outR));
+  if (!skip) {
+    fluid_simd_mix(left_out, outL, rev->wet1, FLUID_BUFSIZE);
+    fluid_simd_mix(left_out, outR, rev->wet2, FLUID_BUFSIZE);
+    fluid_simd_mix(right_out, outR, rev->wet1, FLUID_BUFSIZE);
+    fluid_simd_mix(right_out, outL, rev->wet2, FLUID_BUFSIZE);
+  }
+}
 
-    /* The original Freeverb code expects a stereo signal and 'input'
-     * is set to the sum of the left and right input sample. Since
-     * this code works on a mono signal, 'input' is set to twice the
-     * input sample. */
-    input = (2 * in[k] + DC_OFFSET) * rev->gain;
+void
+fluid_revmodel_processmix(fluid_revmodel_t* rev, fluid_real_t *in,
+			 fluid_real_t *left_out, fluid_real_t *right_out)
+{
+  fluid_real_t outL[FLUID_BUFSIZE], outR[FLUID_BUFSIZE];
 
-    /* Accumulate comb filters in parallel */
-    for (i = 0; i < numcombs; i++) {
-	    fluid_comb_process(rev->combL[i], input, outL);
-	    fluid_comb_process(rev->combR[i], input, outR);
-    }
-    /* Feed through allpasses in series */
-    for (i = 0; i < numallpasses; i++) {
-      fluid_allpass_process(rev->allpassL[i], outL);
-      fluid_allpass_process(rev->allpassR[i], outR);
-    }
+  if (fluid_revmodel_skip_block(rev, in)) {
+    return;
+  }
 
-    /* Remove the DC offset */
-    outL -= DC_OFFSET;
-    outR -= DC_OFFSET;
+  fluid_revmodel_process_block(rev, in, outL, outR);
 
-    /* Calculate output MIXING with anything already there */
-    left_out[k] += outL * rev->wet1 + outR * rev->wet2;
-    right_out[k] += outR * rev->wet1 + outL * rev->wet2;
-  }
+  /* Calculate output MIXING with anything already there */
+  fluid_simd_mix(left_out, outL, rev->wet1, FLUID_BUFSIZE);
+  fluid_simd_mix(left_out, outR, rev->wet2, FLUID_BUFSIZE);
+  fluid_simd_mix(right_out, outR, rev->wet1, FLUID_BUFSIZE);
+  fluid_simd_mix(right_out, outL, rev->wet2, FLUID_BUFSIZE);
 }
 
 void
@@ -487,6 +641,19 @@ fluid_revmodel_update(fluid_revmodel_t* rev)
   rev->wet1 = rev->wet * (rev->width / 2 + 0.5f);
   rev->wet2 = rev->wet * ((1 - rev->width) / 2);
 
+  /* The combs lose at least 1 - roomsize per round trip, the tail ends
+   * when the longest one has decayed by 96 dB and passed the allpasses */
+  if (rev->roomsize <= 0) {
+    rev->tail_samples = (combtuningR8);
+  } else if (rev->roomsize < 1) {
+    double trips = log(1.6e-5) / log(rev->roomsize) + 1;
+    double tail = trips * (combtuningR8) + (allpasstuningR1) + (allpasstuningR2) + (allpasstuningR3) + (allpasstuningR4);
+    rev->tail_samples = tail < INT_MAX / 2 ? (int) tail : INT_MAX / 2;
+  } else {
+    /* Rings forever */
+    rev->tail_samples = INT_MAX / 2;
+  }
+
   for (i = 0; i < numcombs; i++) {
     fluid_comb_setfeedback(&rev->combL[i], rev->roomsize);
     fluid_comb_setfeedback(&rev->combR[i], rev->roomsize);
@@ -0,0 +1,209 @@
+/* FluidSynth - A Software Synthesizer
+ *
+ * Copyright (C) 2003  Peter Hanappe and others.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public License
+ * as published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the Free
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA
+ * 02111-1307, USA
+ */
+
+#ifndef _FLUID_SIMD_H
+#define _FLUID_SIMD_H
+
+#include "fluidsynth_priv.h"
+
+/* Purpose:
+ *
+ * Vectorised kernels for the voice dsp: interpolating four output samples
+ * at once, and mixing a voice into the output and effect buffers. The
+ * reverb and chorus use the same operations for their delay lines.
+ *
+ * SSE2 is part of every x86-64 cpu and NEON of every 64-bit ARM cpu, so the
+ * kernel is picked when compiling and nothing has to be detected at run time.
+ * Other targets, and builds with double precision samples, keep using the
+ * scalar loops.
+ */
+
+#if defined(WITH_FLOAT) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FLUID_SIMD_SSE 1
+#include <emmintrin.h>
+#elif defined(WITH_FLOAT) && (defined(__aarch64__) || defined(_M_ARM64))
+#define FLUID_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(FLUID_SIMD_SSE) || defined(FLUID_SIMD_NEON)
+#define FLUID_SIMD 1
+#endif
+
+#ifdef FLUID_SIMD_SSE
+
+typedef __m128 fluid_simd_t;
+
+/* 4 sample points, converted to float */
+static inline fluid_simd_t fluid_simd_load_points (const short int *points)
+{
+  __m128i s = _mm_loadl_epi64 ((const __m128i *) points);
+  return _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (s, s), 16));
+}
+
+#define fluid_simd_load(p)          _mm_loadu_ps (p)
+#define fluid_simd_store(p, v)      _mm_storeu_ps (p, v)
+#define fluid_simd_set1(x)          _mm_set1_ps (x)
+#define fluid_simd_add(a, b)        _mm_add_ps (a, b)
+#define fluid_simd_sub(a, b)        _mm_sub_ps (a, b)
+#define fluid_simd_mul(a, b)        _mm_mul_ps (a, b)
+
+/* Returns { sum(a), sum(b), sum(c), sum(d) } */
+static inline fluid_simd_t fluid_simd_sum4 (fluid_simd_t a, fluid_simd_t b, fluid_simd_t c, fluid_simd_t d)
+{
+  _MM_TRANSPOSE4_PS (a, b, c, d);
+  return _mm_add_ps (_mm_add_ps (a, b), _mm_add_ps (c, d));
+}
+
+/* Returns { x, x + incr, x + 2 * incr, x + 3 * incr } */
+static inline fluid_simd_t fluid_simd_ramp (fluid_real_t x, fluid_real_t incr)
+{
+  return _mm_add_ps (_mm_set1_ps (x), _mm_mul_ps (_mm_set1_ps (incr), _mm_setr_ps (0.0f, 1.0f, 2.0f, 3.0f)));
+}
+
+/* Sets the first lane to zero */
+static inline fluid_simd_t fluid_simd_clear_first (fluid_simd_t a)
+{
+  return _mm_castsi128_ps (_mm_slli_si128 (_mm_srli_si128 (_mm_castps_si128 (a), 4), 4));
+}
+
+#elif defined(FLUID_SIMD_NEON)
+
+typedef float32x4_t fluid_simd_t;
+
+static inline fluid_simd_t fluid_simd_load_points (const short int *points)
+{
+  return vcvtq_f32_s32 (vmovl_s16 (vld1_s16 (points)));
+}
+
+#define fluid_simd_load(p)          vld1q_f32 (p)
+#define fluid_simd_store(p, v)      vst1q_f32 (p, v)
+#define fluid_simd_set1(x)          vdupq_n_f32 (x)
+#define fluid_simd_add(a, b)        vaddq_f32 (a, b)
+#define fluid_simd_sub(a, b)        vsubq_f32 (a, b)
+#define fluid_simd_mul(a, b)        vmulq_f32 (a, b)
+
+static inline fluid_simd_t fluid_simd_sum4 (fluid_simd_t a, fluid_simd_t b, fluid_simd_t c, fluid_simd_t d)
+{
+  return vpaddq_f32 (vpaddq_f32 (a, b), vpaddq_f32 (c, d));
+}
+
+static inline fluid_simd_t fluid_simd_ramp (fluid_real_t x, fluid_real_t incr)
+{
+  static const float steps[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+  return vmlaq_n_f32 (vdupq_n_f32 (x), vld1q_f32 (steps), incr);
+}
+
+static inline fluid_simd_t fluid_simd_clear_first (fluid_simd_t a)
+{
+  return vsetq_lane_f32 (0.0f, a, 0);
+}
+
+#endif
+
+#ifdef FLUID_SIMD
+
+/* 4th order interpolation of four output samples
+ * points[k] points at the first of the 4 sample points of output k, coeffs[k] at its row of the coefficient table */
+static inline void
+fluid_simd_interpolate_4th_order (fluid_real_t *out, const short int *points[4], const fluid_real_t *coeffs[4],
+				  fluid_real_t amp, fluid_real_t amp_incr)
+{
+  fluid_simd_t r0 = fluid_simd_mul (fluid_simd_load (coeffs[0]), fluid_simd_load_points (points[0]));
+  fluid_simd_t r1 = fluid_simd_mul (fluid_simd_load (coeffs[1]), fluid_simd_load_points (points[1]));
+  fluid_simd_t r2 = fluid_simd_mul (fluid_simd_load (coeffs[2]), fluid_simd_load_points (points[2]));
+  fluid_simd_t r3 = fluid_simd_mul (fluid_simd_load (coeffs[3]), fluid_simd_load_points (points[3]));
+
+  fluid_simd_store (out, fluid_simd_mul (fluid_simd_sum4 (r0, r1, r2, r3), fluid_simd_ramp (amp, amp_incr)));
+}
+
+/* One output of the 7th order interpolation, as 8 products where the 4th point is counted once
+ * The first half covers points 0..3, the second half points 3..6 with point 3 masked out */
+static inline fluid_simd_t
+fluid_simd_products_7th_order (const short int *points, const fluid_real_t *coeffs)
+{
+  fluid_simd_t low = fluid_simd_mul (fluid_simd_load (coeffs), fluid_simd_load_points (points));
+  fluid_simd_t high = fluid_simd_mul (fluid_simd_load (coeffs + 3), fluid_simd_load_points (points + 3));
+  return fluid_simd_add (low, fluid_simd_clear_first (high));
+}
+
+/* 7th order interpolation of four output samples, points[k] points at the first of the 7 sample points of output k */
+static inline void
+fluid_simd_interpolate_7th_order (fluid_real_t *out, const short int *points[4], const fluid_real_t *coeffs[4],
+				  fluid_real_t amp, fluid_real_t amp_incr)
+{
+  fluid_simd_t r0 = fluid_simd_products_7th_order (points[0], coeffs[0]);
+  fluid_simd_t r1 = fluid_simd_products_7th_order (points[1], coeffs[1]);
+  fluid_simd_t r2 = fluid_simd_products_7th_order (points[2], coeffs[2]);
+  fluid_simd_t r3 = fluid_simd_products_7th_order (points[3], coeffs[3]);
+
+  fluid_simd_store (out, fluid_simd_mul (fluid_simd_sum4 (r0, r1, r2, r3), fluid_simd_ramp (amp, amp_incr)));
+}
+
+#endif
+
+/* dst[i] += gain * src[i] */
+static inline void
+fluid_simd_mix (fluid_real_t *dst, const fluid_real_t *src, fluid_real_t gain, int count)
+{
+  int i = 0;
+#ifdef FLUID_SIMD
+  fluid_simd_t g = fluid_simd_set1 (gain);
+  for (; i + 4 <= count; i += 4)
+    fluid_simd_store (dst + i, fluid_simd_add (fluid_simd_load (dst + i), fluid_simd_mul (g, fluid_simd_load (src + i))));
+#endif
+  for (; i < count; i++)
+    dst[i] += gain * src[i];
+}
+
+/* left[i] += gain * src[i], right[i] += gain * src[i] */
+static inline void
+fluid_simd_mix_centered (fluid_real_t *left, fluid_real_t *right, const fluid_real_t *src, fluid_real_t gain, int count)
+{
+  int i = 0;
+#ifdef FLUID_SIMD
+  fluid_simd_t g = fluid_simd_set1 (gain);
+  for (; i + 4 <= count; i += 4)
+  {
+    fluid_simd_t v = fluid_simd_mul (g, fluid_simd_load (src + i));
+    fluid_simd_store (left + i, fluid_simd_add (fluid_simd_load (left + i), v));
+    fluid_simd_store (right + i, fluid_simd_add (fluid_simd_load (right + i), v));
+  }
+#endif
+  for (; i < count; i++)
+  {
+    fluid_real_t v = gain * src[i];
+    left[i] += v;
+    right[i] += v;
+  }
+}
+
+/* Returns 1 if all samples are zero, like an effect send that no voice wrote to */
+static inline int
+fluid_simd_is_silent (const fluid_real_t *buf, int count)
+{
+  int i;
+  for (i = 0; i < count; i++)
+    if (buf[i] != 0)
+      return 0;
+  return 1;
+}
+
+#endif /* _FLUID_SIMD_H */
@@ -2311,31 +2311,15 @@ fluid_synth_one_block(fluid_synth_t* synth, int do_not_mix_fx_to_out)
 
 
 /*
- * fluid_synth_free_voice_by_kill
+ * fluid_synth_voice_priority
  *
- * selects a voice for killing. the selection algorithm is a refinement
- * of the algorithm previously in fluid_synth_alloc_voice.
+ * how important a playing voice is, the voice with the lowest priority
+ * is the first one to be killed.
  */
-fluid_voice_t*
-fluid_synth_free_voice_by_kill(fluid_synth_t* synth)
+static fluid_real_t
+fluid_synth_voice_priority(fluid_synth_t* synth, fluid_voice_t* voice)
 {
-  int i;
-  fluid_real_t best_prio = 999999.;
-  fluid_real_t this_voice_prio;
-  fluid_voice_t* voice;
-  int best_voice_index=-1;
-
-/*   fluid_mutex_lock(synth->busy); /\* Don't interfere with the audio thread *\/ */
-/*   fluid_mutex_unlock(synth->busy); */
-
-  for (i = 0; i < synth->polyphony; i++) {
-
-    voice = synth->voice[i];
-
-    /* safeguard against an available voice. */
-    if (_AVAILABLE(voice)) {
-      return voice;
-    }
+    fluid_real_t this_voice_prio;
 
     /* Determine, how 'important' a voice is.
      * Start with an arbitrary number */
@@ -2377,6 +2361,38 @@ fluid_synth_free_voice_by_kill(fluid_synth_t* synth)
       this_voice_prio += voice->volenv_val * 1000.;
     }
 
+    return this_voice_prio;
+}
+
+/*
+ * fluid_synth_free_voice_by_kill
+ *
+ * selects a voice for killing. the selection algorithm is a refinement
+ * of the algorithm previously in fluid_synth_alloc_voice.
+ */
+fluid_voice_t*
+fluid_synth_free_voice_by_kill(fluid_synth_t* synth)
+{
+  int i;
+  fluid_real_t best_prio = 999999.;
+  fluid_real_t this_voice_prio;
+  fluid_voice_t* voice;
+  int best_voice_index=-1;
+
+/*   fluid_mutex_lock(synth->busy); /\* Don't interfere with the audio thread *\/ */
+/*   fluid_mutex_unlock(synth->busy); */
+
+  for (i = 0; i < synth->polyphony; i++) {
+
+    voice = synth->voice[i];
+
+    /* safeguard against an available voice. */
+    if (_AVAILABLE(voice)) {
+      return voice;
+    }
+
+    this_voice_prio = fluid_synth_voice_priority(synth, voice);
+
     /* check if this voice has less priority than the previous candidate. */
     if (this_voice_prio < best_prio)
       best_voice_index = i,
@@ -2389,10 +2405,90 @@ fluid_synth_free_voice_by_kill(fluid_synth_t* synth)
 
   voice = synth->voice[best_voice_index];
   fluid_voice_off(voice);
+  synth->stolen_voices++;
 
   return voice;
 }
 
+/*
+ * fluid_synth_get_active_voice_count
+ */
+int
+fluid_synth_get_active_voice_count(fluid_synth_t* synth)
+{
+  int i, count = 0;
+
+  for (i = 0; i < synth->polyphony; i++) {
+    if (!_AVAILABLE(synth->voice[i])) {
+      count++;
+    }
+  }
+
+  return count;
+}
+
+/*
+ * fluid_synth_kill_least_important_voice
+ */
+static void
+fluid_synth_kill_least_important_voice(fluid_synth_t* synth)
+{
+  int i;
+  fluid_real_t best_prio = 999999.;
+  fluid_real_t this_voice_prio;
+  int best_voice_index = -1;
+
+  for (i = 0; i < synth->polyphony; i++) {
+    if (_AVAILABLE(synth->voice[i])) {
+      continue;
+    }
+
+    this_voice_prio = fluid_synth_voice_priority(synth, synth->voice[i]);
+    if (this_voice_prio < best_prio) {
+      best_voice_index = i;
+      best_prio = this_voice_prio;
+    }
+  }
+
+  if (best_voice_index >= 0) {
+    fluid_voice_off(synth->voice[best_voice_index]);
+    synth->stolen_voices++;
+  }
+}
+
+/*
+ * fluid_synth_set_voice_budget
+ */
+void fluid_synth_set_voice_budget(fluid_synth_t* synth, int budget)
+{
+  int playing;
+
+  synth->voice_budget = (budget > 0 && budget < synth->polyphony) ? budget : 0;
+  if (synth->voice_budget == 0) {
+    return;
+  }
+
+  for (playing = fluid_synth_get_active_voice_count(synth); playing > synth->voice_budget; playing--) {
+    fluid_synth_kill_least_important_voice(synth);
+  }
+}
+
+/*
+ * fluid_synth_get_voice_budget
+ */
+int fluid_synth_get_voice_budget(fluid_synth_t* synth)
+{
+  return synth->voice_budget;
+}
+
+/*
+ * fluid_synth_get_stolen_voice_count
+ */
+unsigned int fluid_synth_get_stolen_voice_count(fluid_synth_t* synth)
+{
+  return synth->stolen_voices;
+}
+
 /*
  * fluid_synth_alloc_voice
  */
@@ -2406,6 +2502,11 @@ fluid_synth_alloc_voice(fluid_synth_t* synth, fluid_sample_t* sample, int chan,
 /*   fluid_mutex_lock(synth->busy); /\* Don't interfere with the audio thread *\/ */
 /*   fluid_mutex_unlock(synth->busy); */
 
+  /* over the voice budget, the new note takes the place of the least important voice */
+  if (synth->voice_budget > 0 && fluid_synth_get_active_voice_count(synth) >= synth->voice_budget) {
+    fluid_synth_kill_least_important_voice(synth);
+  }
+
   /* check if there's an available synthesis process */
   for (i = 0; i < synth->polyphony; i++) {
     if (_AVAILABLE(synth->voice[i])) {
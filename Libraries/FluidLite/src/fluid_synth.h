@@ -87,6 +87,8 @@ struct _fluid_synth_t
   /* fluid_settings_old_t settings_old;  the old synthesizer settings */
   fluid_settings_t* settings;         /** the synthesizer settings */
   int polyphony;                     /** maximum polyphony */
+  int voice_budget;                  /** maximum number of playing voices while the CPU is busy, 0 for no limit */
+  unsigned int stolen_voices;        /** number of playing voices that were stopped early to make room */
   char with_reverb;                  /** Should the synth use the built-in reverb unit? */
   char with_chorus;                  /** Should the synth use the built-in chorus unit? */
   char verbose;                      /** Turn verbose mode on? */
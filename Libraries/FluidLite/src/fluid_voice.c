@@ -26,6 +26,7 @@
 #include "fluid_synth.h"
 #include "fluid_sys.h"
 #include "fluid_sfont.h"
+#include "fluid_simd.h"
 
 /* used for filter turn off optimization - if filter cutoff is above the
    specified value and filter q is below the other value, turn filter off */
@@ -660,7 +661,6 @@ fluid_voice_effects (fluid_voice_t *voice, int count,
 
   fluid_real_t dsp_centernode;
   int dsp_i;
-  float v;
 
   /* filter (implement the voice filter according to SoundFont standard) */
 
@@ -711,41 +711,24 @@ fluid_voice_effects (fluid_voice_t *voice, int count,
   if ((-0.5 < voice->pan) && (voice->pan < 0.5))
   {
     /* The voice is centered. Use voice->amp_left twice. */
-    for (dsp_i = 0; dsp_i < count; dsp_i++)
-    {
-      v = voice->amp_left * dsp_buf[dsp_i];
-      dsp_left_buf[dsp_i] += v;
-      dsp_right_buf[dsp_i] += v;
-    }
+    fluid_simd_mix_centered (dsp_left_buf, dsp_right_buf, dsp_buf, voice->amp_left, count);
   }
   else	/* The voice is not centered. Stereo samples have one side zero. */
   {
     if (voice->amp_left != 0.0)
-    {
-      for (dsp_i = 0; dsp_i < count; dsp_i++)
-	dsp_left_buf[dsp_i] += voice->amp_left * dsp_buf[dsp_i];
-    }
+      fluid_simd_mix (dsp_left_buf, dsp_buf, voice->amp_left, count);
 
     if (voice->amp_right != 0.0)
-    {
-      for (dsp_i = 0; dsp_i < count; dsp_i++)
-	dsp_right_buf[dsp_i] += voice->amp_right * dsp_buf[dsp_i];
-    }
+      fluid_simd_mix (dsp_right_buf, dsp_buf, voice->amp_right, count);
   }
 
   /* reverb send. Buffer may be NULL. */
   if ((dsp_reverb_buf != NULL) && (voice->amp_reverb != 0.0))
-  {
-    for (dsp_i = 0; dsp_i < count; dsp_i++)
-      dsp_reverb_buf[dsp_i] += voice->amp_reverb * dsp_buf[dsp_i];
-  }
+    fluid_simd_mix (dsp_reverb_buf, dsp_buf, voice->amp_reverb, count);
 
   /* chorus send. Buffer may be NULL. */
   if ((dsp_chorus_buf != NULL) && (voice->amp_chorus != 0))
-  {
-    for (dsp_i = 0; dsp_i < count; dsp_i++)
-      dsp_chorus_buf[dsp_i] += voice->amp_chorus * dsp_buf[dsp_i];
-  }
+    fluid_simd_mix (dsp_chorus_buf, dsp_buf, voice->amp_chorus, count);
 
   voice->hist1 = dsp_hist1;
   voice->hist2 = dsp_hist2;
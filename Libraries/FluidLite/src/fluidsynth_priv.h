@@ -167,6 +167,7 @@ typedef FILE*  fluid_file;
 #define FLUID_FTELL(_f)              ftell(_f)
 #define FLUID_MEMCPY(_dst,_src,_n)   memcpy(_dst,_src,_n)
 #define FLUID_MEMSET(_s,_c,_n)       memset(_s,_c,_n)
+#define FLUID_MEMCMP(_s,_t,_n)       memcmp(_s,_t,_n)
 #define FLUID_STRLEN(_s)             strlen(_s)
 #define FLUID_STRCMP(_s,_t)          strcmp(_s,_t)
 #define FLUID_STRNCMP(_s,_t,_n)      strncmp(_s,_t,_n)
@@ -174,6 +175,7 @@ typedef FILE*  fluid_file;
 #define FLUID_STRCHR(_s,_c)          strchr(_s,_c)
 #define FLUID_STRDUP(s)              FLUID_STRCPY((char*)FLUID_MALLOC(FLUID_STRLEN(s) + 1), s)
 #define FLUID_SPRINTF                sprintf
+#define FLUID_SNPRINTF               snprintf
 #define FLUID_FPRINTF                fprintf
 
 #define fluid_clip(_val, _min, _max) \
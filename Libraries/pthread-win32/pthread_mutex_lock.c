@@ -47,6 +47,42 @@
 #include "pthread.h"
 #include "implement.h"
 
+/*
+ * plugdata: spin for a short while before blocking on the mutex event.
+ * pd's lock is usually only held for a short time by the GUI or the audio thread,
+ * so going straight to WaitForSingleObject made a kernel transition out of almost every contended lock.
+ * The lock is taken as -1 (locked, possibly with waiters) because the non-recursive fast path
+ * may already have overwritten that state, this way unlocking will still wake any waiter.
+ */
+static int
+ptw32_mutex_spin_acquire (pthread_mutex_t mx)
+{
+  static LONG spinCount = -1;
+  LONG i;
+
+  if (spinCount < 0)
+    {
+      SYSTEM_INFO info;
+      GetSystemInfo (&info);
+      spinCount = info.dwNumberOfProcessors > 1 ? 4000 : 0;
+    }
+
+  for (i = 0; i < spinCount; i++)
+    {
+      if (*(volatile LONG*) &mx->lock_idx == 0
+          && (PTW32_INTERLOCKED_LONG) PTW32_INTERLOCKED_COMPARE_EXCHANGE_LONG(
+                 (PTW32_INTERLOCKED_LONGPTR) &mx->lock_idx,
+                 (PTW32_INTERLOCKED_LONG) -1,
+                 (PTW32_INTERLOCKED_LONG) 0) == 0)
+        {
+          return 1;
+        }
+      YieldProcessor ();
+    }
+
+  return 0;
+}
+
 int
 pthread_mutex_lock (pthread_mutex_t * mutex)
 {
@@ -86,7 +122,8 @@ pthread_mutex_lock (pthread_mutex_t * mutex)
         {
           if ((PTW32_INTERLOCKED_LONG) PTW32_INTERLOCKED_EXCHANGE_LONG(
 		       (PTW32_INTERLOCKED_LONGPTR) &mx->lock_idx,
-		       (PTW32_INTERLOCKED_LONG) 1) != 0)
+		       (PTW32_INTERLOCKED_LONG) 1) != 0
+              && !ptw32_mutex_spin_acquire (mx))
 	    {
 	      while ((PTW32_INTERLOCKED_LONG) PTW32_INTERLOCKED_EXCHANGE_LONG(
                               (PTW32_INTERLOCKED_LONGPTR) &mx->lock_idx,
@@ -127,16 +164,19 @@ pthread_mutex_lock (pthread_mutex_t * mutex)
 	        }
 	      else
 	        {
-	          while ((PTW32_INTERLOCKED_LONG) PTW32_INTERLOCKED_EXCHANGE_LONG(
-                                  (PTW32_INTERLOCKED_LONGPTR) &mx->lock_idx,
-			          (PTW32_INTERLOCKED_LONG) -1) != 0)
-		    {
-	              if (WAIT_OBJECT_0 != WaitForSingleObject (mx->event, INFINITE))
+	          if (!ptw32_mutex_spin_acquire (mx))
+	            {
+	              while ((PTW32_INTERLOCKED_LONG) PTW32_INTERLOCKED_EXCHANGE_LONG(
+                                      (PTW32_INTERLOCKED_LONGPTR) &mx->lock_idx,
+			              (PTW32_INTERLOCKED_LONG) -1) != 0)
 		        {
-	                  result = EINVAL;
-		          break;
+	                  if (WAIT_OBJECT_0 != WaitForSingleObject (mx->event, INFINITE))
+		            {
+	                      result = EINVAL;
+		              break;
+		            }
 		        }
-		    }
+	            }
 
 	          if (0 == result)
 		    {
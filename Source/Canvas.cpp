@@ -8,6 +8,7 @@
 #include "Utility/Fonts.h"
 
 #include "Sidebar/Sidebar.h"
+#include "Sidebar/SearchIndex.h"
 #include "Statusbar.h"
 #include "Canvas.h"
 #include "Object.h"
@@ -23,6 +24,7 @@
 #include "Dialogs/Dialogs.h"
 #include "Components/GraphArea.h"
 #include "Utility/RateReducer.h"
+#include "Utility/TraceRecorder.h"
 
 extern "C" {
 void canvas_setgraph(t_glist* x, int flag, int nogoprect);
@@ -37,6 +39,7 @@ Canvas::Canvas(PluginEditor* parent, pd::Patch::Ptr p, Component* parentGraph)
     , canvasOrigin(Point<int>(infiniteCanvasSize / 2, infiniteCanvasSize / 2))
     , graphArea(nullptr)
     , pathUpdater(new ConnectionPathUpdater(this))
+    , connectionAnimator(new ConnectionAnimator(this))
     , globalMouseListener(this)
 {
 
@@ -56,6 +59,9 @@ Canvas::Canvas(PluginEditor* parent, pd::Patch::Ptr p, Component* parentGraph)
 
     pd->registerMessageListener(patch.getUncheckedPointer(), this);
 
+    // Object implementations look up the canvas that shows their patch
+    pd->updateObjectImplementations();
+
     isGraphChild.addListener(this);
     hideNameAndArgs.addListener(this);
     xRange.addListener(this);
@@ -94,6 +100,10 @@ Canvas::Canvas(PluginEditor* parent, pd::Patch::Ptr p, Component* parentGraph)
         canvasViewport->setViewedComponent(this, false);
 
         canvasViewport->onScroll = [this]() {
+            updateObjectsInView();
+            // Create the objects that just scrolled into view, instead of waiting for their chunk
+            if (isLoadingObjects())
+                synchronise();
             if (suggestor) {
                 suggestor->updateBounds();
             }
@@ -139,10 +149,14 @@ Canvas::Canvas(PluginEditor* parent, pd::Patch::Ptr p, Component* parentGraph)
     } else {
         presentationMode = false;
     }
+
+    loadStartTicks = Time::getHighResolutionTicks();
+    loadingObjects = viewport && patch.getObjects().size() > progressiveLoadThreshold;
+    auto const loadsProgressively = loadingObjects;
     performSynchronise();
 
     // Start in unlocked mode if the patch is empty
-    if (objects.isEmpty()) {
+    if (objects.isEmpty() && !isLoadingObjects()) {
         locked = false;
         patch.getPointer()->gl_edit = false;
     } else {
@@ -169,7 +183,18 @@ Canvas::Canvas(PluginEditor* parent, pd::Patch::Ptr p, Component* parentGraph)
     parameters.addParamInt("Width", cDimensions, &patchWidth, 527, onInteractionFn);
     parameters.addParamInt("Height", cDimensions, &patchHeight, 327, onInteractionFn);
 
-    updatePatchSnapshot();
+    // Lets a subpatch run at its own block size or rate, without having to oversample the whole patch
+    if (patch.getPointer()->gl_owner) {
+        parameters.addParamCombo("Block size", cGeneral, &dspBlockSize, { "Parent", "32", "64", "128", "256", "512", "1024", "2048" }, 1);
+        parameters.addParamCombo("Oversampling", cGeneral, &dspUpsampling, { "None", "2x", "4x", "8x", "16x" }, 1);
+        updateDSPContext();
+        dspBlockSize.addListener(this);
+        dspUpsampling.addListener(this);
+    }
+
+    // Otherwise, this happens once all objects are there
+    if (!loadsProgressively)
+        updatePatchSnapshot();
     
     patch.setVisible(true);
 }
@@ -185,19 +210,35 @@ Canvas::~Canvas()
     zoomScale.removeListener(this);
     editor->removeModifierKeyListener(this);
     pd->unregisterMessageListener(patch.getUncheckedPointer(), this);
+    pd->updateObjectImplementations();
+
+    pd->dspProfiler->removeChangeListener(this);
+    pd->dspProfiler->setProfilingWanted(this, false);
 }
 
 bool Canvas::updateFramebuffers(NVGcontext* nvg, Rectangle<int> invalidRegion, int maxUpdateTimeMs)
 {
     auto pixelScale = getRenderScale();
-    auto zoom = getValue<float>(zoomScale);
+    auto zoom = zoomScale.get();
 
     int const logicalIoletsSize = 16 * 4;
     int const ioletBufferSize = logicalIoletsSize * pixelScale * zoom;
 
+    Colour const ioletColours[4] = {
+        findColour(PlugDataColour::dataColourId),
+        findColour(PlugDataColour::signalColourId),
+        findColour(PlugDataColour::gemColourId),
+        findColour(PlugDataColour::canvasBackgroundColourId).contrasting(0.5f)
+    };
+    auto const ioletOutlineColour = findColour(PlugDataColour::objectOutlineColourId);
+
+    auto& resourceCache = editor->nvgSurface.getResourceCache();
+
     // First, check if we need to update our iolet buffer
-    if (ioletBuffer.needsUpdate(ioletBufferSize, ioletBufferSize)) {
-        ioletBuffer.renderToFramebuffer(nvg, ioletBufferSize, ioletBufferSize, [this, zoom, ioletBufferSize, pixelScale](NVGcontext* nvg) {
+    auto const ioletVariant = NVGResourceCache::getVariant({ ioletColours[0].getARGB(), ioletColours[1].getARGB(), ioletColours[2].getARGB(), ioletColours[3].getARGB(), ioletOutlineColour.getARGB(), static_cast<uint32>(PlugDataLook::getUseSquareIolets()) });
+    auto const ioletKey = NVGResourceCache::Key { NVGResourceCache::Iolets, ioletBufferSize, ioletBufferSize, ioletVariant };
+
+    if (resourceCache.updateFramebuffer(nvg, ioletBuffer, ioletKey, [zoom, ioletBufferSize, pixelScale, &ioletColours, ioletOutlineColour](NVGcontext* nvg) {
             nvgViewport(0, 0, ioletBufferSize, ioletBufferSize);
             nvgClear(nvg);
 
@@ -225,14 +266,7 @@ bool Canvas::updateFramebuffers(NVGcontext* nvg, Rectangle<int> invalidRegion, i
                 }
             };
 
-            auto ioletColours = std::vector<Colour> {
-                findColour(PlugDataColour::dataColourId),
-                findColour(PlugDataColour::signalColourId),
-                findColour(PlugDataColour::gemColourId),
-                findColour(PlugDataColour::canvasBackgroundColourId).contrasting(0.5f)
-            };
-
-            auto outlineColour = findNVGColour(PlugDataColour::objectOutlineColourId);
+            auto outlineColour = convertColour(ioletOutlineColour);
             for (int i = 0; i < 4; i++) {
                 auto backgroundColour = convertColour(ioletColours[i]);
                 auto ioletRow = Rectangle<float>(0, i * 16 + 0.5f, logicalIoletsSize, 12.5f);
@@ -241,17 +275,16 @@ bool Canvas::updateFramebuffers(NVGcontext* nvg, Rectangle<int> invalidRegion, i
             }
 
             nvgEndFrame(nvg);
-        });
-
+        })) {
         editor->nvgSurface.invalidateAll();
     }
 
     int const resizerLogicalSize = 9;
     int const resizerBufferSize = resizerLogicalSize * pixelScale * zoom;
 
-    auto updateResizeHandleIfNeeded = [this, resizerBufferSize, pixelScale, zoom, nvg](NVGImage& handleImage, Colour colour) {
-        if (handleImage.needsUpdate(resizerBufferSize, resizerBufferSize)) {
-            handleImage = NVGImage(nvg, resizerBufferSize, resizerBufferSize, [pixelScale, zoom, colour](Graphics &g) {
+    auto updateResizeHandleIfNeeded = [this, &resourceCache, resizerBufferSize, pixelScale, zoom, nvg](NVGResourceCache::Handle<NVGImage>& handleImage, NVGResourceCache::Kind kind, Colour colour) {
+        auto const key = NVGResourceCache::Key { kind, resizerBufferSize, resizerBufferSize, NVGResourceCache::getVariant({ colour.getARGB() }) };
+        if (resourceCache.updateImage(nvg, handleImage, key, [pixelScale, zoom, colour](Graphics &g) {
                 g.addTransform(AffineTransform::scale(pixelScale * zoom, pixelScale * zoom));
                 auto b = Rectangle<int>(0, 0, 9, 9);
                 // use the path with a hole in it to exclude the inner rounded rect from painting
@@ -268,24 +301,24 @@ bool Canvas::updateFramebuffers(NVGcontext* nvg, Rectangle<int> invalidRegion, i
 
                 g.setColour(colour);
                 g.fillRoundedRectangle(0.0f, 0.0f, 9.0f, 9.0f, Corners::resizeHanleCornerRadius);
-            });
+            })) {
             editor->nvgSurface.invalidateAll();
         }
     };
 
-    updateResizeHandleIfNeeded(resizeHandleImage, findColour(PlugDataColour::objectSelectedOutlineColourId));
-    updateResizeHandleIfNeeded(resizeGOPHandleImage, findColour(PlugDataColour::graphAreaColourId));
+    updateResizeHandleIfNeeded(resizeHandleImage, NVGResourceCache::ResizeHandle, findColour(PlugDataColour::objectSelectedOutlineColourId));
+    updateResizeHandleIfNeeded(resizeGOPHandleImage, NVGResourceCache::GOPResizeHandle, findColour(PlugDataColour::graphAreaColourId));
 
-    auto updateObjectFlagIfNeeded = [this, nvg](NVGImage& flagImage, Colour colour) {
+    auto updateObjectFlagIfNeeded = [this, &resourceCache, nvg](NVGResourceCache::Handle<NVGImage>& flagImage, NVGResourceCache::Kind kind, Colour colour) {
         const float flagSize = 9;
 
         const auto pixelScale = getRenderScale();
-        const auto zoom = isZooming ? 2.0f : getValue<float>(zoomScale);
+        const auto zoom = isZooming ? 2.0f : zoomScale.get();
 
         int const flagArea = flagSize * pixelScale * zoom;
 
-        if (flagImage.needsUpdate(flagArea, flagArea)) {
-            flagImage = NVGImage(nvg, flagArea, flagArea, [pixelScale, zoom, colour, flagSize](Graphics &g) {
+        auto const key = NVGResourceCache::Key { kind, flagArea, flagArea, NVGResourceCache::getVariant({ colour.getARGB() }) };
+        if (resourceCache.updateImage(nvg, flagImage, key, [pixelScale, zoom, colour, flagSize](Graphics &g) {
                 g.addTransform(AffineTransform::scale(pixelScale * zoom, pixelScale * zoom));
                 Path outerArea;
                 outerArea.addRoundedRectangle(0, 0, flagSize, flagSize, Corners::objectCornerRadius, Corners::objectCornerRadius, 0, 1, 0, 0);
@@ -301,28 +334,124 @@ bool Canvas::updateFramebuffers(NVGcontext* nvg, Rectangle<int> invalidRegion, i
 
                 g.setColour(colour);
                 g.fillPath(flagA);
-            });
+            })) {
             editor->nvgSurface.invalidateAll();
         }
     };
 
-    updateObjectFlagIfNeeded(objectFlag, findColour(PlugDataColour::guiObjectInternalOutlineColour));
-    updateObjectFlagIfNeeded(objectFlagSelected, findColour(PlugDataColour::objectSelectedOutlineColourId));
+    updateObjectFlagIfNeeded(objectFlag, NVGResourceCache::ObjectFlag, findColour(PlugDataColour::guiObjectInternalOutlineColour));
+    updateObjectFlagIfNeeded(objectFlagSelected, NVGResourceCache::ObjectFlagSelected, findColour(PlugDataColour::objectSelectedOutlineColourId));
 
-    return true;
+    // Thumbnails for the low detail look, as many as we can fit in the time we have left
+    auto const startTime = Time::getMillisecondCounter();
+    while (!pendingThumbnails.isEmpty() && static_cast<int>(Time::getMillisecondCounter() - startTime) < maxUpdateTimeMs) {
+        if (auto* object = pendingThumbnails.removeAndReturn(0).getComponent())
+            object->updateThumbnail(nvg, pixelScale, zoom);
+    }
+
+    // Offscreen caches of objects, like the interior of graphs
+    while (!pendingCachedRenders.isEmpty() && static_cast<int>(Time::getMillisecondCounter() - startTime) < maxUpdateTimeMs) {
+        if (auto* object = pendingCachedRenders.removeAndReturn(0).getComponent())
+            object->updateCachedRender(nvg, pixelScale, zoom);
+    }
+
+    return pendingThumbnails.isEmpty() && pendingCachedRenders.isEmpty();
+}
+
+void Canvas::requestThumbnailUpdate(Object* object)
+{
+    pendingThumbnails.addIfNotAlreadyThere(object);
+}
+
+void Canvas::requestCachedRenderUpdate(ObjectBase* object)
+{
+    pendingCachedRenders.addIfNotAlreadyThere(object);
 }
 
 // Callback from canvasViewport to perform actual rendering
+void Canvas::updateObjectsInView()
+{
+    if (!viewport)
+        return;
+
+    std::vector<Object*> found;
+    objectIndex.query(getViewAreaWithMargin(), found);
+    for (auto* object : found)
+        object->catchUpGui();
+}
+
+Rectangle<int> Canvas::getViewAreaWithMargin() const
+{
+    return (viewport->getViewArea() / zoomScale.get()).expanded(Object::margin * 4);
+}
+
+bool Canvas::isAreaInView(Rectangle<int> area)
+{
+    if (viewport)
+        return getViewAreaWithMargin().intersects(area);
+
+    // The inside of a graph can be seen when the object that shows it can
+    if (auto* parentObject = findParentComponentOfClass<Object>())
+        return parentObject->cnv->isAreaInView(parentObject->getBounds());
+
+    // In plugin mode, only the part inside the window can be seen
+    if (auto* parent = getParentComponent())
+        return getLocalArea(parent, parent->getLocalBounds()).intersects(area);
+
+    return true;
+}
+
+void Canvas::updateZoomSnapshot(NVGcontext* nvg)
+{
+    if (!viewport)
+        return;
+
+    // Until a zoom starts, keep track of what the last frame was rendered with
+    if (!isZooming) {
+        hasZoomSnapshot = false;
+        zoomSnapshotScale = zoomScale.get();
+        zoomSnapshotPosition = viewport->getViewPosition();
+        return;
+    }
+
+    if (hasZoomSnapshot)
+        return;
+
+    auto& surface = editor->nvgSurface;
+    surface.copyToFramebuffer(zoomSnapshot, surface.getLocalArea(viewport.get(), viewport->getLocalBounds()));
+    hasZoomSnapshot = zoomSnapshot.isValid();
+}
+
 void Canvas::performRender(NVGcontext* nvg, Rectangle<int> invalidRegion)
 {
+    NVGResourceUsage::ScopedOwner scopedOwner(this);
+
     auto const halfSize = infiniteCanvasSize / 2;
-    auto const zoom = getValue<float>(zoomScale);
+    auto const zoom = zoomScale.get();
 
     auto background = findColour(PlugDataColour::canvasBackgroundColourId);
     auto backgroundColour = convertColour(background);
+
+    // Scale the snapshot from when the zoom started, we'll render everything sharply once the gesture settles
+    if (viewport && isZooming && hasZoomSnapshot && zoomSnapshotScale > 0.0f) {
+        auto const scale = zoom / zoomSnapshotScale;
+        auto const origin = zoomSnapshotPosition.toFloat() * scale - viewport->getViewPosition().toFloat();
+
+        nvgFillColor(nvg, backgroundColour);
+        nvgFillRect(nvg, invalidRegion.getX(), invalidRegion.getY(), invalidRegion.getWidth(), invalidRegion.getHeight());
+
+        nvgBeginPath(nvg);
+        nvgFillPaint(nvg, nvgImagePattern(nvg, origin.x, origin.y, viewport->getWidth() * scale, viewport->getHeight() * scale, 0, zoomSnapshot.getImage(), 1));
+        nvgFillRect(nvg, origin.x, origin.y, viewport->getWidth() * scale, viewport->getHeight() * scale);
+
+        reinterpret_cast<CanvasViewport*>(viewport.get())->render(nvg);
+        return;
+    }
     auto borderLinesColour = convertColour(findColour(PlugDataColour::canvasDotsColourId).interpolatedWith(background, 0.2f));
     auto& dotsColour = borderLinesColour;
 
+    renderingLowDetail = viewport && zoom * getRenderScale() < lowDetailPixelScale;
+
     nvgSave(nvg);
 
     if (viewport) {
@@ -342,7 +471,7 @@ void Canvas::performRender(NVGcontext* nvg, Rectangle<int> invalidRegion)
 
         auto gridSize = objectGrid.gridSize ? objectGrid.gridSize : 25;
 
-        if (getValue<float>(zoomScale) >= 1.0f) {
+        if (zoomScale.get() >= 1.0f) {
             NVGScopedState scopedState(nvg);
             nvgTranslate(nvg, canvasOrigin.x % gridSize, canvasOrigin.y % gridSize); // Make sure grid aligns with origin
             NVGpaint dots = nvgDotPattern(nvg, dotsColour, nvgRGBA(0, 0, 0, 0), objectGrid.gridSize, 0.8f, 0.0f);
@@ -394,12 +523,12 @@ void Canvas::performRender(NVGcontext* nvg, Rectangle<int> invalidRegion)
         }
     }
     auto drawBorder = [this, nvg, backgroundColour, zoom, borderLinesColour](bool bg, bool fg) {
-        if (viewport && (showOrigin || showBorder) && !::getValue<bool>(presentationMode)) {
+        if (viewport && (showOrigin || showBorder) && !presentationMode.get()) {
             NVGScopedState scopedState(nvg);
             nvgBeginPath(nvg);
 
-            const auto borderWidth = getValue<float>(patchWidth);
-            const auto borderHeight = getValue<float>(patchHeight);
+            const auto borderWidth = patchWidth.get();
+            const auto borderHeight = patchHeight.get();
             const auto pos = Point<int>(halfSize, halfSize);
 
             auto scaledStrokeSize = zoom < 1.0f ? jmap(zoom, 1.0f, 0.25f, 1.5f, 4.0f) : 1.5f;
@@ -486,14 +615,14 @@ void Canvas::performRender(NVGcontext* nvg, Rectangle<int> invalidRegion)
         }
     }
 
-    if (::getValue<bool>(presentationMode) || isGraph) {
+    if (presentationMode.get() || isGraph) {
         renderAllObjects(nvg, invalidRegion);
         // render presentation mode as clipped 'virtual' plugin view
-        if (::getValue<bool>(presentationMode)) {
-            auto const borderWidth = getValue<float>(patchWidth);
-            auto const borderHeight = getValue<float>(patchHeight);
+        if (presentationMode.get()) {
+            auto const borderWidth = patchWidth.get();
+            auto const borderHeight = patchHeight.get();
             auto const pos = Point<int>(halfSize, halfSize);
-            auto const scale = getValue<float>(zoomScale);
+            auto const scale = zoomScale.get();
             auto const windowCorner = Corners::windowCornerRadius / scale;
 
             auto const bgColour = convertColour(findColour(PlugDataColour::presentationBackgroundColourId));
@@ -572,11 +701,40 @@ void Canvas::performRender(NVGcontext* nvg, Rectangle<int> invalidRegion)
         drawBorder(false, true);
 
     nvgRestore(nvg);
-    
+
+    if (isLoadingObjects())
+        renderLoadingIndicator(nvg);
+
     // Draw scrollbars
     if (viewport) {
         reinterpret_cast<CanvasViewport*>(viewport.get())->render(nvg);
     }
+
+    if (!firstFrameRendered) {
+        firstFrameRendered = true;
+        TraceRecorder::recordSince("Canvas::timeToFirstFrame", loadStartTicks, objects.size());
+
+        // Now that the objects in view are on screen, start creating the rest
+        if (isLoadingObjects())
+            synchronise();
+    }
+}
+
+void Canvas::renderLoadingIndicator(NVGcontext* nvg)
+{
+    auto const numLoaded = objects.size();
+    auto const text = "Loading objects: " + String(numLoaded) + " / " + String(numLoaded + numObjectsToLoad);
+    auto const bounds = Rectangle<float>(0, 0, 180, 26).withCentre({ viewport->getWidth() / 2.0f, viewport->getHeight() - 40.0f });
+
+    auto const backgroundColour = convertColour(findColour(PlugDataColour::toolbarBackgroundColourId));
+    auto const outlineColour = convertColour(findColour(PlugDataColour::toolbarOutlineColourId));
+    nvgDrawRoundedRect(nvg, bounds.getX(), bounds.getY(), bounds.getWidth(), bounds.getHeight(), backgroundColour, outlineColour, bounds.getHeight() / 2.0f);
+
+    nvgFontFace(nvg, "Inter-Regular");
+    nvgFontSize(nvg, 12.0f);
+    nvgTextAlign(nvg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
+    nvgFillColor(nvg, convertColour(findColour(PlugDataColour::toolbarTextColourId)));
+    nvgText(nvg, bounds.getCentreX(), bounds.getCentreY(), text.toRawUTF8(), nullptr);
 }
 
 float Canvas::getRenderScale() const
@@ -622,18 +780,35 @@ void Canvas::updatePatchSnapshot()
 
 void Canvas::renderAllObjects(NVGcontext* nvg, Rectangle<int> area)
 {
-    for (auto* obj : objects) {
+    auto& profiler = editor->nvgSurface.getFrameProfiler();
+    FrameProfiler::Scope scope(&profiler, FrameProfiler::RenderObjects);
+
+    std::vector<Object*> objectsToRender;
+    objectIndex.query(area, objectsToRender);
+    std::sort(objectsToRender.begin(), objectsToRender.end(), [](Object* a, Object* b) {
+        return a->drawOrder < b->drawOrder;
+    });
+
+    for (auto* obj : objectsToRender) {
         auto b = obj->getBounds();
         {
             NVGScopedState scopedState(nvg);
             nvgTranslate(nvg, b.getX(), b.getY());
             if (b.intersects(area) && obj->isVisible()) {
-                obj->render(nvg);
+                if (scope.isCounted()) {
+                    auto const start = Time::getHighResolutionTicks();
+                    obj->render(nvg);
+                    profiler.addObjectTime(obj, Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000.0, [obj]() {
+                        return obj->getType();
+                    });
+                } else {
+                    obj->render(nvg);
+                }
             }
         }
         
         // Draw label in canvas coordinates
-        obj->renderLabel(nvg);
+        obj->renderLabel(nvg, area);
     }
 }
 void Canvas::renderAllConnections(NVGcontext* nvg, Rectangle<int> area)
@@ -641,6 +816,8 @@ void Canvas::renderAllConnections(NVGcontext* nvg, Rectangle<int> area)
     if (!connectionLayer.isVisible())
         return;
 
+    FrameProfiler::Scope scope(&editor->nvgSurface.getFrameProfiler(), FrameProfiler::RenderConnections);
+
     //TODO: Can we clean this up? We will want to have selected connections in-front,
     // and take precedence over non-selected for resize handles
 
@@ -648,17 +825,28 @@ void Canvas::renderAllConnections(NVGcontext* nvg, Rectangle<int> area)
     Array<Connection*> connectionsToDrawSelected;
     Connection* hovered = nullptr;
 
-    for (auto* connection : connections) {
+    // Group connections by cable type, so connections that use the same paint get drawn after each other
+    // Within a group, sort to keep the order stable between frames
+    std::vector<Connection*> visibleConnections;
+    connectionIndex.query(area, visibleConnections);
+    std::sort(visibleConnections.begin(), visibleConnections.end(), [](Connection* a, Connection* b) {
+        return a->cableType != b->cableType ? a->cableType < b->cableType : a < b;
+    });
+
+    {
+        // Connection::render saves and restores its own state, so we only need to do that once for the whole batch
         NVGScopedState scopedState(nvg);
-        if (connection->intersectsRectangle(area) && connection->isVisible()) {
-            if (connection->isMouseHovering())
-                hovered = connection;
-            else if (!connection->isSelected())
-                connection->render(nvg);
-            else
-                connectionsToDrawSelected.add(connection);
-            if (showConnectionOrder) {
-                connectionsToDraw.add(connection);
+        for (auto* connection : visibleConnections) {
+            if (connection->intersectsRectangle(area) && connection->isVisible()) {
+                if (connection->isMouseHovering())
+                    hovered = connection;
+                else if (!connection->isSelected())
+                    connection->render(nvg);
+                else
+                    connectionsToDrawSelected.add(connection);
+                if (showConnectionOrder) {
+                    connectionsToDraw.add(connection);
+                }
             }
         }
     }
@@ -724,6 +912,17 @@ bool Canvas::shouldShowConnectionActivity()
     return showConnectionActivity;
 }
 
+bool Canvas::shouldShowDSPLoad()
+{
+    return showDSPLoad && !presentationMode.getValue();
+}
+
+void Canvas::changeListenerCallback(ChangeBroadcaster* source)
+{
+    // New DSP load measurements came in
+    repaint();
+}
+
 int Canvas::getOverlays() const
 {
     int overlayState = 0;
@@ -760,12 +959,39 @@ void Canvas::updateOverlays()
     showIndex = overlayState & Index;
     showConnectionDirection = overlayState & Direction;
     showConnectionActivity = overlayState & ConnectionActivity;
+    showDSPLoad = overlayState & DSPLoad;
+
+    if (shouldShowDSPLoad() && !isGraph) {
+        pd->dspProfiler->addChangeListener(this);
+        pd->dspProfiler->setProfilingWanted(this, true);
+    } else {
+        pd->dspProfiler->removeChangeListener(this);
+        pd->dspProfiler->setProfilingWanted(this, false);
+    }
+
+    if ((shouldShowObjectActivity() || shouldShowConnectionActivity()) && !isGraph) {
+        editor->frameScheduler.addPoller(this, 1000 / ACTIVITY_UPDATE_RATE);
+    } else {
+        editor->frameScheduler.removePoller(this);
+    }
 
     orderConnections();
 
     repaint();
 }
 
+void Canvas::pollFrame()
+{
+    for (auto* connection : connections) {
+        connection->updateActivity();
+    }
+}
+
+bool Canvas::shouldPoll()
+{
+    return isShowing();
+}
+
 void Canvas::jumpToOrigin()
 {
     if (viewport)
@@ -785,7 +1011,7 @@ void Canvas::saveViewportState()
 {
     if (viewport) {
         patch.lastViewportPosition = viewport->getViewPosition().transformedBy(getTransform().inverted()) - canvasOrigin;
-        patch.lastViewportScale = getValue<float>(zoomScale);
+        patch.lastViewportScale = zoomScale.get();
     }
 }
 
@@ -794,9 +1020,9 @@ void Canvas::zoomToFitAll()
     if (objects.isEmpty() || !viewport)
         return;
 
-    auto scale = getValue<float>(zoomScale);
+    auto scale = zoomScale.get();
 
-    auto regionOfInterest = Rectangle<int>(canvasOrigin.x, canvasOrigin.y, getValue<float>(patchWidth), getValue<float>(patchHeight));
+    auto regionOfInterest = Rectangle<int>(canvasOrigin.x, canvasOrigin.y, patchWidth.get(), patchHeight.get());
 
     if (!presentationMode.getValue()) {
         for (auto* object : objects) {
@@ -839,6 +1065,9 @@ void Canvas::tabChanged()
     synchronise();
     updateDrawables();
 
+    // Catch up on what objects on this canvas missed while it was hidden
+    pd->messageDispatcher->resumePausedListeners();
+
     for (auto* obj : objects) {
         if (!obj->gui)
             continue;
@@ -894,16 +1123,200 @@ void Canvas::saveAs(std::function<void()> const& nestedCallback)
         "*.pd", "Patch", this);
 }
 
-void Canvas::handleAsyncUpdate()
+void Canvas::hibernate()
 {
+    if (hibernating || isGraph || !viewport)
+        return;
+
+    saveViewportState();
+    hideAllActiveEditors();
+    hideSuggestions();
+    selectedComponents.deselectAll();
+
+    fullSyncPending = false;
+    pendingObjectSyncs.clear();
+    pendingThumbnails.clear();
+    pendingCachedRenders.clear();
+    numObjectsToLoad = 0;
+
+    // Set this first, so the subpatch objects we delete leave the tabs of their subpatches open
+    hibernating = true;
+
+    connections.clear();
+    objects.clear();
+
+    editor->nvgSurface.makeContextActive();
+    zoomSnapshot.evict();
+    hasZoomSnapshot = false;
+    presentationShadowImage = NVGImage();
+}
+
+void Canvas::wakeUp()
+{
+    if (!hibernating)
+        return;
+
+    hibernating = false;
+
+    // Objects in view are created before the next frame, the rest follow in chunks
+    loadStartTicks = Time::getHighResolutionTicks();
+    loadingObjects = true;
+    firstFrameRendered = false;
     performSynchronise();
+    restoreViewportState();
+}
+
+void Canvas::loadAllObjects()
+{
+    wakeUp();
+
+    if (!loadingObjects)
+        return;
+
+    // Without the progressive loading, a sync creates everything at once
+    loadingObjects = false;
+    performSynchronise();
+    finishLoadingObjects();
+}
+
+void CanvasSyncScheduler::flush()
+{
+    // Syncing can ask for another sync, like when loading a big patch in chunks. That one gets its own update
+    if (flushing)
+        return;
+
+    ScopedValueSetter<bool> scopedFlushing(flushing, true);
+
+    auto canvases = std::move(pending);
+    pending.clear();
+
+    // Group the canvases by the patch they show
+    std::vector<std::pair<void*, Array<Canvas*>>> canvasesByPatch;
+    for (auto& canvas : canvases) {
+        if (!canvas || canvas->isHibernating())
+            continue;
+
+        canvas->cancelPendingUpdate();
+
+        auto* patchPtr = canvas->patch.getUncheckedPointer();
+        auto it = std::find_if(canvasesByPatch.begin(), canvasesByPatch.end(), [patchPtr](auto const& entry) { return entry.first == patchPtr; });
+        if (it == canvasesByPatch.end())
+            canvasesByPatch.push_back({ patchPtr, { canvas.getComponent() } });
+        else
+            it->second.add(canvas.getComponent());
+    }
+
+    if (canvasesByPatch.empty())
+        return;
+
+    pd->sendMessagesFromQueue();
+
+    for (auto& [patchPtr, patchCanvases] : canvasesByPatch) {
+        auto& patch = patchCanvases.getFirst()->patch;
+        if (!patch.getPointer())
+            continue;
+
+        patch.setCurrent();
+        auto const pdObjects = patch.getObjects();
+
+        for (auto* canvas : patchCanvases) {
+            canvas->synchroniseWith(pdObjects);
+        }
+    }
+}
+
+void Canvas::handleAsyncUpdate()
+{
+    if (hibernating)
+        return;
+
+    pd->canvasSyncScheduler->flush();
 }
 
 void Canvas::synchronise()
 {
+    fullSyncPending = true;
+    pd->canvasSyncScheduler->schedule(this);
+    triggerAsyncUpdate();
+}
+
+void Canvas::synchroniseObject(Object* object)
+{
+    pendingObjectSyncs.addIfNotAlreadyThere(object);
+    pd->canvasSyncScheduler->schedule(this);
     triggerAsyncUpdate();
 }
 
+void Canvas::synchroniseWith(std::vector<pd::WeakReference> const& pdObjects)
+{
+    if (fullSyncPending || pendingObjectSyncs.isEmpty()) {
+        performSynchronise(pdObjects);
+    } else {
+        performIncrementalSynchronise(pdObjects);
+    }
+}
+
+void Canvas::performIncrementalSynchronise(std::vector<pd::WeakReference> const& pdObjects)
+{
+    auto changedObjects = pendingObjectSyncs;
+    pendingObjectSyncs.clear();
+
+    std::unordered_map<void*, int> pdObjectIndices;
+    pdObjectIndices.reserve(pdObjects.size());
+    for (int i = 0; i < static_cast<int>(pdObjects.size()); i++) {
+        pdObjectIndices[pdObjects[i].getRawUnchecked<void>()] = i;
+    }
+
+    // If pd created or deleted objects behind our back, we need to look at everything
+    if (pdObjects.size() != static_cast<size_t>(objects.size())) {
+        performSynchronise(pdObjects);
+        return;
+    }
+
+    std::unordered_map<void*, Object*> objectsByPointer;
+    objectsByPointer.reserve(objects.size());
+    for (auto* object : objects) {
+        if (!object->getPointer() || !pdObjectIndices.count(object->getPointer())) {
+            performSynchronise(pdObjects);
+            return;
+        }
+        objectsByPointer[object->getPointer()] = object;
+    }
+
+    std::unordered_set<t_gobj*> changedPointers;
+    for (auto& object : changedObjects) {
+        if (!object)
+            continue;
+
+        changedPointers.insert(object->getPointer());
+
+        object->updateIolets();
+        object->updateBounds();
+        if (object->gui)
+            object->gui->update();
+    }
+
+    // Remove connections that pd deleted, or that lost their iolets
+    for (int n = connections.size() - 1; n >= 0; n--) {
+        if (!connections[n]->getPointer() || !connections[n]->inlet || !connections[n]->outlet) {
+            connections.remove(n);
+        }
+    }
+
+    updateObjectOrder(pdObjects, pdObjectIndices);
+    updateConnections(objectsByPointer, [&changedPointers](t_object* inobj, t_object* outobj) {
+        return (inobj && changedPointers.count(&inobj->te_g)) || (outobj && changedPointers.count(&outobj->te_g));
+    });
+
+    editor->updateCommandStatus();
+    repaint();
+
+    needsSearchUpdate = true;
+    pd->searchIndex->markDirty(patch.getUncheckedPointer());
+
+    pd->updateObjectImplementations(patch.getUncheckedPointer());
+}
+
 void Canvas::synchroniseAllCanvases()
 {
     for (auto* editorWindow : pd->getEditors()){
@@ -924,14 +1337,32 @@ void Canvas::synchroniseSplitCanvas()
 // Used for loading and for complicated actions like undo/redo
 void Canvas::performSynchronise()
 {
+    // Everything gets read again when it wakes up
+    if (hibernating) {
+        fullSyncPending = false;
+        pendingObjectSyncs.clear();
+        return;
+    }
+
     if(auto patchPtr = patch.getPointer()) {
         patch.setCurrent();
         pd->sendMessagesFromQueue();
     }
     else {
+        fullSyncPending = false;
+        pendingObjectSyncs.clear();
         return;
     }
 
+    performSynchronise(patch.getObjects());
+}
+
+void Canvas::performSynchronise(std::vector<pd::WeakReference> const& pdObjects)
+{
+    TraceRecorder::Scope trace("Canvas::performSynchronise");
+    fullSyncPending = false;
+    pendingObjectSyncs.clear();
+
     // Remove deleted connections
     for (int n = connections.size() - 1; n >= 0; n--) {
         if (!connections[n]->getPointer()) {
@@ -939,17 +1370,31 @@ void Canvas::performSynchronise()
         }
     }
 
+    // Index everything by pd pointer, so that syncing scales linearly with the size of the patch
+    std::unordered_map<void*, int> pdObjectIndices;
+    pdObjectIndices.reserve(pdObjects.size());
+    for (int i = 0; i < static_cast<int>(pdObjects.size()); i++) {
+        pdObjectIndices[pdObjects[i].getRawUnchecked<void>()] = i;
+    }
+
     // Remove deleted objects
     for (int n = objects.size() - 1; n >= 0; n--) {
         auto* object = objects[n];
 
         // If the object is showing it's initial editor, meaning no object was assigned yet, allow it to exist without pointing to an object
-        if ((!object->getPointer() || patch.objectWasDeleted(object->getPointer())) && !object->isInitialEditorShown()) {
+        if ((!object->getPointer() || !pdObjectIndices.count(object->getPointer())) && !object->isInitialEditorShown()) {
             setSelected(object, false, false);
             objects.remove(n);
         }
     }
 
+    std::unordered_map<void*, Object*> objectsByPointer;
+    objectsByPointer.reserve(objects.size());
+    for (auto* object : objects) {
+        if (object->getPointer())
+            objectsByPointer[object->getPointer()] = object;
+    }
+
     // Check for connections that need to be remade because of invalid iolets
     for (int n = connections.size() - 1; n >= 0; n--) {
         if (!connections[n]->inlet || !connections[n]->outlet) {
@@ -957,68 +1402,197 @@ void Canvas::performSynchronise()
         }
     }
 
-    auto pdObjects = patch.getObjects();
+    // While loading a big patch, objects out of view are only created once the first frame is on screen, a chunk per sync
+    auto loadBudget = firstFrameRendered ? objectsPerLoadChunk : 0;
+    numObjectsToLoad = 0;
 
-    for (auto object : pdObjects) {
-        auto* it = std::find_if(objects.begin(), objects.end(), [&object](Object* b) { return b->getPointer() && b->getPointer() == object.getRawUnchecked<void>(); });
-        if (!object.isValid())
-            continue;
+    // In big patches, most objects are out of view, so we only sync the guis that can be seen
+    // The others catch up once they scroll into view
+    // All the pd reads in this pass share one lock, which we only let go of between objects
+    {
+        pd::WeakReference::BatchLock batchLock(pd);
+        for (auto object : pdObjects) {
+            batchLock.yield();
+            if (!object.isValid())
+                continue;
 
-        if (it == objects.end()) {
-            auto* newObject = objects.add(new Object(object, this));
-            newObject->toFront(false);
+            auto it = objectsByPointer.find(object.getRawUnchecked<void>());
+            if (it == objectsByPointer.end()) {
+                if (loadingObjects) {
+                    int x, y, w, h;
+                    pd::Interface::getObjectBounds(patch.getUncheckedPointer(), object.getRawUnchecked<t_gobj>(), &x, &y, &w, &h);
+                    if (!isAreaInView(Rectangle<int>(x, y, w, h) + canvasOrigin) && loadBudget-- <= 0) {
+                        numObjectsToLoad++;
+                        continue;
+                    }
+                }
 
-            if (newObject->gui && newObject->gui->getLabel())
-                newObject->gui->getLabel()->toFront(false);
-        } else {
-            auto* object = *it;
+                auto* newObject = objects.add(new Object(object, this));
 
-            // Check if number of inlets/outlets is correct
-            object->updateIolets();
-            object->updateBounds();
+                if (newObject->getPointer())
+                    objectsByPointer[newObject->getPointer()] = newObject;
+            } else {
+                auto* object = it->second;
+
+                // Check if number of inlets/outlets is correct
+                object->updateIolets();
+                object->updateBounds();
 
+                if (object->gui && !object->guiInitialisePending) {
+                    object->guiUpdatePending = !isAreaInView(object->getBounds()) && !object->isSelected();
+                    if (!object->guiUpdatePending)
+                        object->gui->update();
+                }
+            }
+        }
+    }
+
+    updateObjectOrder(pdObjects, pdObjectIndices);
+
+    // Bring objects to the front in pd's order, but only if they're not already in that order
+    // Every reorder repaints and sends a fake mouse move, that adds up quickly in big patches
+    auto const& children = objectLayer.getChildren();
+    auto const inOrder = children.size() >= objects.size() && std::equal(objects.begin(), objects.end(), children.end() - objects.size());
+    if (!inOrder) {
+        for (auto* object : objects) {
             object->toFront(false);
             if (object->gui && object->gui->getLabel())
                 object->gui->getLabel()->toFront(false);
-            if (object->gui)
-                object->gui->update();
         }
     }
 
-    // Make sure objects have the same order
-    std::sort(objects.begin(), objects.end(),
-        [&pdObjects](Object* first, Object* second) mutable {
-            size_t idx1 = std::find(pdObjects.begin(), pdObjects.end(), first->getPointer()) - pdObjects.begin();
-            size_t idx2 = std::find(pdObjects.begin(), pdObjects.end(), second->getPointer()) - pdObjects.begin();
-
-            return idx1 < idx2;
+    if (isLoadingObjects()) {
+        // Connections to objects that don't exist yet are made when the object is created
+        updateConnections(objectsByPointer, [&objectsByPointer](t_object* inObj, t_object* outObj) {
+            return inObj && outObj && objectsByPointer.count(&inObj->te_g) && objectsByPointer.count(&outObj->te_g);
         });
+    } else {
+        updateConnections(objectsByPointer, [](t_object*, t_object*) { return true; });
+    }
 
+    if (!isGraph) {
+        setTransform(AffineTransform().scaled(zoomScale.get()));
+    }
+
+    if (graphArea)
+        graphArea->updateBounds();
+
+    updateDSPContext();
+
+    editor->updateCommandStatus();
+    repaint();
+
+    needsSearchUpdate = true;
+    pd->searchIndex->markDirty(patch.getUncheckedPointer());
+
+    // An edit inside a subpatch can change whether the subpatch compiles with heavy, so check it again on the canvases that show it
+    if (SettingsFile::getInstance()->getProperty<bool>("hvcc_mode")) {
+        if (auto glist = patch.getPointer()) {
+            auto isInside = [glist = glist.get()](void* subpatch) {
+                for (auto* owner = glist; owner; owner = owner->gl_owner) {
+                    if (owner == subpatch)
+                        return true;
+                }
+                return false;
+            };
+
+            for (auto* otherEditor : pd->getEditors()) {
+                for (auto* canvas : otherEditor->getCanvases()) {
+                    for (auto* object : canvas->objects) {
+                        if (object->gui && object->gui->getPatch() && isInside(object->getPointer()))
+                            object->updateHvccCompatibility();
+                    }
+                }
+            }
+        }
+    }
+
+    pd->updateObjectImplementations(patch.getUncheckedPointer());
+
+    if (loadingObjects) {
+        if (!isLoadingObjects())
+            finishLoadingObjects();
+        else if (firstFrameRendered)
+            synchronise();
+    }
+}
+
+void Canvas::finishLoadingObjects()
+{
+    loadingObjects = false;
+    TraceRecorder::recordSince("Canvas::timeToInteractive", loadStartTicks, objects.size());
+
+    updatePatchSnapshot();
+    repaint();
+}
+
+// Make sure objects have the same order as in pd, objects that don't exist in pd yet go last
+void Canvas::updateObjectOrder(std::vector<pd::WeakReference> const& pdObjects, std::unordered_map<void*, int> const& pdObjectIndices)
+{
+    std::vector<Object*> orderedObjects(pdObjects.size(), nullptr);
+    std::vector<Object*> unorderedObjects;
+    for (auto* object : objects) {
+        auto it = pdObjectIndices.find(object->getPointer());
+        if (it != pdObjectIndices.end() && !orderedObjects[it->second]) {
+            orderedObjects[it->second] = object;
+        } else {
+            unorderedObjects.push_back(object);
+        }
+    }
+
+    auto* sorted = objects.begin();
+    for (auto* object : orderedObjects) {
+        if (object)
+            *sorted++ = object;
+    }
+    for (auto* object : unorderedObjects) {
+        *sorted++ = object;
+    }
+
+    for (int i = 0; i < objects.size(); i++) {
+        objects[i]->drawOrder = i;
+    }
+}
+
+// Creates or remakes the connection components for every pd connection that passes the filter
+void Canvas::updateConnections(std::unordered_map<void*, Object*> const& objectsByPointer, std::function<bool(t_object*, t_object*)> const& shouldUpdate)
+{
+    std::unordered_map<t_outconnect*, Connection*> connectionsByPointer;
+    connectionsByPointer.reserve(connections.size());
+    for (auto* connection : connections) {
+        connectionsByPointer[connection->getPointer()] = connection;
+    }
+
+    // We hold on to raw pd pointers in here, so the lock stays taken for the whole pass
+    pd::WeakReference::BatchLock batchLock(pd);
     auto pdConnections = patch.getConnections();
 
     for (auto& connection : pdConnections) {
         auto& [ptr, inno, inobj, outno, outobj] = connection;
 
+        if (!shouldUpdate(inobj, outobj))
+            continue;
+
         Iolet *inlet = nullptr, *outlet = nullptr;
 
         // Find the objects that this connection is connected to
-        for (auto* obj : objects) {
-            if (outobj && &outobj->te_g == obj->getPointer()) {
+        if (outobj) {
+            if (auto it = objectsByPointer.find(&outobj->te_g); it != objectsByPointer.end()) {
+                auto* obj = it->second;
 
                 // Check if we have enough outlets, should never return false
                 if (isPositiveAndBelow(obj->numInputs + outno, obj->iolets.size())) {
                     outlet = obj->iolets[obj->numInputs + outno];
-                } else {
-                    break;
                 }
             }
-            if (inobj && &inobj->te_g == obj->getPointer()) {
+        }
+        if (inobj) {
+            if (auto it = objectsByPointer.find(&inobj->te_g); it != objectsByPointer.end()) {
+                auto* obj = it->second;
 
                 // Check if we have enough inlets, should never return false
                 if (isPositiveAndBelow(inno, obj->iolets.size())) {
                     inlet = obj->iolets[inno];
-                } else {
-                    break;
                 }
             }
         }
@@ -1029,41 +1603,24 @@ void Canvas::performSynchronise()
             continue;
         }
 
-        auto* it = std::find_if(connections.begin(), connections.end(),
-            [c_ptr = ptr](auto* c) {
-                return c_ptr == c->getPointer();
-            });
+        auto it = connectionsByPointer.find(ptr);
 
-        if (it == connections.end()) {
-            connections.add(new Connection(this, inlet, outlet, ptr));
+        if (it == connectionsByPointer.end()) {
+            connectionsByPointer[ptr] = connections.add(new Connection(this, inlet, outlet, ptr));
         } else {
-            auto& c = *(*it);
+            auto& c = *it->second;
 
             // This is necessary to make resorting a subpatchers iolets work
             // And it can't hurt to check if the connection is valid anyway
             if (c.inlet != inlet || c.outlet != outlet) {
-                int idx = connections.indexOf(*it);
-                connections.removeObject(*it);
-                connections.insert(idx, new Connection(this, inlet, outlet, ptr));
+                int idx = connections.indexOf(it->second);
+                connections.removeObject(it->second);
+                it->second = connections.insert(idx, new Connection(this, inlet, outlet, ptr));
             } else {
                 c.popPathState();
             }
         }
     }
-
-    if (!isGraph) {
-        setTransform(AffineTransform().scaled(getValue<float>(zoomScale)));
-    }
-
-    if (graphArea)
-        graphArea->updateBounds();
-
-    editor->updateCommandStatus();
-    repaint();
-
-    needsSearchUpdate = true;
-
-    pd->updateObjectImplementations();
 }
 
 void Canvas::updateDrawables()
@@ -1144,10 +1701,20 @@ void Canvas::altKeyChanged(bool isHeld)
     SettingsFile::getInstance()->getValueTree().getChildWithName("Overlays").setProperty("alt_mode", isHeld, nullptr);
 }
 
+bool Canvas::keyStateChanged(bool isKeyDown)
+{
+    if (!isKeyDown)
+        patch.finishUndoGesture();
+
+    return false;
+}
+
 void Canvas::mouseDown(MouseEvent const& e)
 {
     PopupMenu::dismissAllActiveMenus();
 
+    patch.finishUndoGesture();
+
     if (checkPanDragMode())
         return;
 
@@ -1204,7 +1771,7 @@ bool Canvas::hitTest(int x, int y)
         return true;
 
     // disregard mouse drag if outside of patch
-    if (::getValue<bool>(presentationMode)) {
+    if (presentationMode.get()) {
         if (isPointOutsidePluginArea(Point<int>(x, y)))
             return false;
     }
@@ -1348,12 +1915,8 @@ void Canvas::updateSidebarSelection()
     if (lassoSelection.size() > 0) {
         Array<ObjectParameters> allParameters;
         for (auto* object : lassoSelection) {
-            if (!object->gui)
-                continue;
-            auto parameters = object->gui ? object->gui->getParameters() : ObjectParameters();
-            auto showOnSelect = object->gui && object->gui->showParametersWhenSelected();
-            if (showOnSelect) {
-                allParameters.add(parameters);
+            if (object->gui && object->gui->showParametersWhenSelected()) {
+                allParameters.add(object->gui->getParameters());
             }
         }
 
@@ -1392,6 +1955,8 @@ bool Canvas::keyPressed(KeyPress const& key)
             }
         }
 
+        // Nudges made while holding the arrow keys become a single undo step
+        patch.continueUndoGesture("Move");
         patch.moveObjects(pdObjects, x, y);
 
         // Update object bounds and store the total bounds of the selection
@@ -1403,7 +1968,7 @@ bool Canvas::keyPressed(KeyPress const& key)
 
         // TODO: consider calculating the totalBounds with object->getBounds().reduced(Object::margin)
         // then adding viewport padding in screen pixels so it's consistent regardless of scale
-        auto scale = ::getValue<float>(zoomScale);
+        auto scale = zoomScale.get();
         auto viewportPadding = 10;
 
         auto viewX = viewport->getViewPositionX() / scale;
@@ -1512,6 +2077,8 @@ void Canvas::focusGained(FocusChangeType cause)
 
 void Canvas::focusLost(FocusChangeType cause)
 {
+    patch.finishUndoGesture();
+
     pd->enqueueFunctionAsync([_this = SafePointer(this), this, focused = hasKeyboardFocus(true)]() {
         if (!_this) return;
         auto* glist = patch.getPointer().get();
@@ -1550,11 +2117,7 @@ void Canvas::dragAndDropPaste(String const& patchString, Point<int> mousePos, in
     patch.startUndoSequence(undoText);
 
     auto patchSize = Point<int>(patchWidth, patchHeight);
-    String translatedObjects = pd::Patch::translatePatchAsString(patchString, mousePos - (patchSize / 2.0f));
-
-    if (auto patchPtr = patch.getPointer()) {
-        pd::Interface::paste(patchPtr.get(), translatedObjects.toRawUTF8());
-    }
+    patch.paste(patchString, mousePos - (patchSize / 2.0f));
 
     deselectAll();
 
@@ -2014,32 +2577,23 @@ void Canvas::encapsulateSelection()
 
     pd::Interface::removeObjects(patchPtr, objects);
 
-    auto replacement = copypasta.replace("$$_COPY_HERE_$$", copied);
-
-    pd::Interface::paste(patchPtr, replacement.toRawUTF8());
-    auto lastObject = patch.getObjects().back();
-    if (!lastObject.isValid())
-        return;
-
-    auto* newObject = pd::Interface::checkObject(lastObject.getRaw<t_pd>());
-    if (!newObject) {
-        patch.endUndoSequence("Encapsulate");
-        pd->unlockAudioThread();
-        return;
-    }
+    // The subpatch and its connections to the rest of the patch are created in one go
+    pd::Patch::ObjectBatch batch;
+    auto subpatch = batch.addPatchText(copypasta.replace("$$_COPY_HERE_$$", copied));
 
     for (auto& [idx, iolets] : newExternalConnections) {
         for (auto* iolet : iolets) {
             if (auto* externalObject = reinterpret_cast<t_object*>(iolet->object->getPointer())) {
                 if (iolet->isInlet) {
-                    pd::Interface::createConnection(patchPtr, newObject, idx - numIn, externalObject, iolet->ioletIdx);
+                    batch.connect(subpatch, idx - numIn, externalObject, iolet->ioletIdx);
                 } else {
-                    pd::Interface::createConnection(patchPtr, externalObject, iolet->ioletIdx, newObject, idx);
+                    batch.connect(externalObject, iolet->ioletIdx, subpatch, idx);
                 }
             }
         }
     }
 
+    patch.createObjects(batch, "Encapsulate");
     patch.endUndoSequence("Encapsulate");
 
     pd->unlockAudioThread();
@@ -2272,12 +2826,26 @@ void Canvas::redo()
     updateSidebarSelection();
 }
 
+void Canvas::updateDSPContext()
+{
+    auto const context = patch.getDSPContext();
+
+    // Both combo boxes go up in powers of 2, anything else that was typed in doesn't match an entry
+    auto const upsampling = context.resampling >= 1.0f ? roundToInt(context.resampling) : 0;
+    auto const blockSize = context.blockSize / std::max(upsampling, 1);
+    auto const upsamplingIndex = upsampling > 0 && isPowerOfTwo(upsampling) && upsampling <= 16 ? findHighestSetBit(upsampling) + 1 : 0;
+    auto const blockSizeIndex = blockSize == 0 ? 1 : (isPowerOfTwo(blockSize) && blockSize >= 32 && blockSize <= 2048 ? findHighestSetBit(blockSize) - 3 : 0);
+
+    setValueExcludingListener(dspBlockSize, blockSizeIndex, this);
+    setValueExcludingListener(dspUpsampling, upsamplingIndex, this);
+}
+
 void Canvas::valueChanged(Value& v)
 {
     // Update zoom
     if (v.refersToSameSourceAs(zoomScale)) {
         editor->statusbar->updateZoomLevel();
-        patch.lastViewportScale = getValue<float>(zoomScale);
+        patch.lastViewportScale = zoomScale.get();
         hideSuggestions();
     } else if (v.refersToSameSourceAs(patchWidth)) {
         // limit canvas width to smallest object (11px)
@@ -2337,6 +2905,14 @@ void Canvas::valueChanged(Value& v)
     else if (v.refersToSameSourceAs(presentationMode)) {
         connectionLayer.setVisible(!getValue<bool>(presentationMode));
         deselectAll();
+    } else if (v.refersToSameSourceAs(dspBlockSize) || v.refersToSameSourceAs(dspUpsampling)) {
+        auto const blockSizeIndex = getValue<int>(dspBlockSize);
+        auto const upsamplingIndex = getValue<int>(dspUpsampling);
+        if (blockSizeIndex < 1 || upsamplingIndex < 1)
+            return;
+
+        patch.setDSPContext(blockSizeIndex == 1 ? 0 : 1 << (blockSizeIndex + 3), 1 << (upsamplingIndex - 1));
+        synchronise();
     } else if (v.refersToSameSourceAs(hideNameAndArgs)) {
         if (!patch.getPointer())
             return;
@@ -2415,6 +2991,10 @@ void Canvas::setSelected(Component* component, bool shouldNowBeSelected, bool up
         selectedComponents.deselect(component);
     } else {
         selectedComponents.addToSelection(component);
+
+        // Selected objects can be inspected, so their gui needs to be up to date
+        if (auto* object = dynamic_cast<Object*>(component))
+            object->catchUpGui();
     }
 
     if (updateCommandStatus) {
@@ -2446,8 +3026,8 @@ bool Canvas::setPanDragMode(bool shouldPan)
 
 bool Canvas::isPointOutsidePluginArea(Point<int> point)
 {
-    auto const borderWidth = getValue<float>(patchWidth);
-    auto const borderHeight = getValue<float>(patchHeight);
+    auto const borderWidth = patchWidth.get();
+    auto const borderHeight = patchHeight.get();
     auto const halfSize = infiniteCanvasSize / 2;
     auto const pos = Point<int>(halfSize, halfSize);
 
@@ -2468,21 +3048,26 @@ void Canvas::findLassoItemsInArea(Array<WeakReference<Component>>& itemsFound, R
         }
     }
 
-    for (auto& connection : connections) {
-        // If total bounds don't intersect, there can't be an intersection with the line
-        // This is cheaper than checking the path intersection, so do this first
-        if (!connection->getBounds().intersects(lassoBounds)) {
-            setSelected(connection, false, false);
-            continue;
-        }
+    // Only connections whose bounds overlap the lasso can intersect it, the spatial index finds those for us
+    std::vector<Connection*> nearbyConnections;
+    connectionIndex.query(lassoBounds, nearbyConnections);
 
-        // Check if path intersects with lasso
+    std::set<Connection*> connectionsInLasso;
+    for (auto* connection : nearbyConnections) {
         if (connection->intersects(lassoBounds.toFloat())) {
             itemsFound.add(connection);
-        } else if (!ModifierKeys::getCurrentModifiers().isAnyModifierKeyDown()) {
-            setSelected(connection, false, false);
+            connectionsInLasso.insert(connection);
         }
     }
+
+    for (auto* connection : connections) {
+        if (connectionsInLasso.count(connection))
+            continue;
+
+        // Connections that the lasso only passes near keep their selection while a modifier is down
+        if (!connection->getBounds().intersects(lassoBounds) || !ModifierKeys::getCurrentModifiers().isAnyModifierKeyDown())
+            setSelected(connection, false, false);
+    }
 }
 
 ObjectParameters& Canvas::getInspectorParameters()
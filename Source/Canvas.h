@@ -18,6 +18,7 @@ using namespace juce::gl;
 #include "ObjectGrid.h"          // move to impl
 #include "Utility/RateReducer.h" // move to impl
 #include "Utility/ModifierKeyListener.h"
+#include "Utility/FrameScheduler.h"
 #include "Components/CheckedTooltip.h"
 #include "Pd/MessageListener.h"
 #include "Pd/Patch.h"
@@ -25,6 +26,8 @@ using namespace juce::gl;
 #include "Objects/ObjectParameters.h"
 #include "NVGSurface.h"
 #include "Utility/GlobalMouseListener.h"
+#include "Utility/SpatialIndex.h"
+#include "Utility/ConnectionPathPlanner.h"
 
 namespace pd {
 class Patch;
@@ -34,10 +37,12 @@ class SuggestionComponent;
 class GraphArea;
 class Iolet;
 class Object;
+class ObjectBase;
 class Connection;
 class PluginEditor;
 class PluginProcessor;
 class ConnectionPathUpdater;
+class ConnectionAnimator;
 class ConnectionBeingCreated;
 class TabComponent;
 
@@ -63,6 +68,8 @@ class Canvas : public Component
     , public ModifierKeyListener
     , public pd::MessageListener
     , public AsyncUpdater
+    , public ChangeListener
+    , public FrameScheduler::Poller
     , public NVGComponent {
 public:
     Canvas(PluginEditor* parent, pd::Patch::Ptr patch, Component* parentGraph = nullptr);
@@ -88,6 +95,12 @@ public:
     void focusLost(FocusChangeType cause) override;
 
     bool updateFramebuffers(NVGcontext* nvg, Rectangle<int> invalidRegion, int maxUpdateTimeMs);
+    void updateZoomSnapshot(NVGcontext* nvg);
+
+    // Catches up on syncing the guis of objects that scrolled into view
+    void updateObjectsInView();
+    bool isAreaInView(Rectangle<int> area);
+    Rectangle<int> getViewAreaWithMargin() const;
     void performRender(NVGcontext* nvg, Rectangle<int> invalidRegion);
 
     void resized() override;
@@ -97,11 +110,18 @@ public:
 
     int getOverlays() const;
     void updateOverlays();
+    void changeListenerCallback(ChangeBroadcaster* source) override;
 
     bool shouldShowObjectActivity();
     bool shouldShowIndex();
     bool shouldShowConnectionDirection();
     bool shouldShowConnectionActivity();
+    bool shouldShowDSPLoad();
+
+    // True while rendering at a zoom level where text and details are too small to see
+    bool isRenderingLowDetail() const { return renderingLowDetail; }
+    void requestThumbnailUpdate(Object* object);
+    void requestCachedRenderUpdate(ObjectBase* object);
 
     void save(std::function<void()> const& nestedCallback = []() {});
     void saveAs(std::function<void()> const& nestedCallback = []() {});
@@ -109,12 +129,33 @@ public:
     void synchroniseAllCanvases();
     void synchroniseSplitCanvas();
     void synchronise();
+    // Only resyncs this object and the connections around it, for edits that don't touch the rest of the patch
+    void synchroniseObject(Object* object);
     void performSynchronise();
     void handleAsyncUpdate() override;
 
+    // Syncs with objects that were already read from pd, by the CanvasSyncScheduler
+    void synchroniseWith(std::vector<pd::WeakReference> const& pdObjects);
+
+    // Reads the block size and upsampling from the block~ in this patch into the inspector
+    void updateDSPContext();
+
+    // Big patches only create the objects in view before the first frame, the rest follow in chunks after that
+    bool isLoadingObjects() const { return numObjectsToLoad > 0; }
+
+    // A tab that wasn't looked at for a while lets go of its objects, connections and render caches
+    // Only the viewport state stays, waking up creates the objects again the same way a big patch is loaded
+    void hibernate();
+    void wakeUp();
+    bool isHibernating() const { return hibernating; }
+
+    // Wakes the canvas up and creates every object that's still waiting to be loaded, for code that looks objects up
+    void loadAllObjects();
+
     void updateDrawables();
 
     bool keyPressed(KeyPress const& key) override;
+    bool keyStateChanged(bool isKeyDown) override;
     void valueChanged(Value& v) override;
 
     void tabChanged();
@@ -179,6 +220,10 @@ public:
 
     void receiveMessage(t_symbol* symbol, pd::Atom const atoms[8], int numAtoms) override;
 
+    // Samples the message counters of our connections, while the activity overlays are on
+    void pollFrame() override;
+    bool shouldPoll() override;
+
     template<typename T>
     Array<T*> getSelectionOfType()
     {
@@ -206,13 +251,18 @@ public:
 
     // Needs to be allocated before object and connection so they can deselect themselves in the destructor
     SelectedItemSet<WeakReference<Component>> selectedComponents;
+
+    // Bounds of all objects and connections, so rendering only has to look at what's inside the invalidated area
+    // Same as above, these need to be allocated first so objects and connections can remove themselves
+    SpatialIndex<Object> objectIndex;
+    SpatialIndex<Connection> connectionIndex;
     OwnedArray<Object> objects;
     OwnedArray<Connection> connections;
     OwnedArray<ConnectionBeingCreated> connectionsBeingCreated;
 
     Value locked = SynchronousValue();
     Value commandLocked;
-    Value presentationMode;
+    TypedValue<bool> presentationMode { var(), false };
 
     bool showOrigin = false;
     bool showBorder = false;
@@ -223,9 +273,16 @@ public:
 
     bool showConnectionDirection = false;
     bool showConnectionActivity = false;
+    bool showDSPLoad = false;
 
     bool isZooming = false;
 
+    // While zooming, we scale what was on screen when the gesture started, instead of drawing every object at every step
+    NVGFramebuffer zoomSnapshot;
+    bool hasZoomSnapshot = false;
+    float zoomSnapshotScale = 1.0f;
+    Point<int> zoomSnapshotPosition;
+
     bool isGraph = false;
     bool isDraggingLasso = false;
 
@@ -235,10 +292,15 @@ public:
     Value hideNameAndArgs = SynchronousValue(var(false));
     Value xRange = SynchronousValue();
     Value yRange = SynchronousValue();
-    Value patchWidth = SynchronousValue();
-    Value patchHeight = SynchronousValue();
+    TypedValue<float> patchWidth;
+    TypedValue<float> patchHeight;
+
+    // The block size and upsampling that this subpatch's block~ sets, as combo box indices
+    Value dspBlockSize = SynchronousValue(var(1));
+    Value dspUpsampling = SynchronousValue(var(1));
 
-    Value zoomScale;
+    // Read while rendering, so it also keeps its value as a float
+    TypedValue<float> zoomScale { var(), false };
 
     ObjectGrid objectGrid = ObjectGrid(this);
 
@@ -253,6 +315,8 @@ public:
     Point<int> pastedPadding;
 
     std::unique_ptr<ConnectionPathUpdater> pathUpdater;
+    std::unique_ptr<ConnectionAnimator> connectionAnimator;
+    ConnectionPathPlanner pathPlanner;
     RateReducer objectRateReducer = RateReducer(90);
 
     ObjectDragState dragState;
@@ -262,17 +326,45 @@ public:
     Component objectLayer;
     Component connectionLayer;
 
-    NVGFramebuffer ioletBuffer;
-    NVGImage resizeHandleImage;
-    NVGImage resizeGOPHandleImage;
+    // Shared with the other canvases on this editor, see NVGResourceCache
+    NVGResourceCache::Handle<NVGFramebuffer> ioletBuffer;
+    NVGResourceCache::Handle<NVGImage> resizeHandleImage;
+    NVGResourceCache::Handle<NVGImage> resizeGOPHandleImage;
     NVGImage presentationShadowImage;
 
-    NVGImage objectFlag;
-    NVGImage objectFlagSelected;
+    NVGResourceCache::Handle<NVGImage> objectFlag;
+    NVGResourceCache::Handle<NVGImage> objectFlagSelected;
 
     Array<juce::WeakReference<NVGComponent>> drawables;
 
 private:
+    void performSynchronise(std::vector<pd::WeakReference> const& pdObjects);
+    void performIncrementalSynchronise(std::vector<pd::WeakReference> const& pdObjects);
+    void updateObjectOrder(std::vector<pd::WeakReference> const& pdObjects, std::unordered_map<void*, int> const& pdObjectIndices);
+    void updateConnections(std::unordered_map<void*, Object*> const& objectsByPointer, std::function<bool(t_object*, t_object*)> const& shouldUpdate);
+
+    // Edits since the last sync: either a full resync, or just the objects in this list
+    bool fullSyncPending = false;
+    Array<Component::SafePointer<Object>> pendingObjectSyncs;
+
+    void renderLoadingIndicator(NVGcontext* nvg);
+    void finishLoadingObjects();
+
+    // Patches with more objects than this are loaded progressively
+    static constexpr int progressiveLoadThreshold = 500;
+    static constexpr int objectsPerLoadChunk = 250;
+    bool loadingObjects = false;
+    bool hibernating = false;
+    bool firstFrameRendered = false;
+    int numObjectsToLoad = 0;
+    int64 loadStartTicks = 0;
+
+    // Below this many screen pixels per canvas pixel, we switch to the low detail look
+    static constexpr float lowDetailPixelScale = 0.5f;
+    bool renderingLowDetail = false;
+    Array<Component::SafePointer<Object>> pendingThumbnails;
+    Array<Component::SafePointer<ObjectBase>> pendingCachedRenders;
+
     GlobalMouseListener globalMouseListener;
 
     bool dimensionsAreBeingEdited = false;
@@ -287,3 +379,26 @@ private:
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Canvas)
 };
+
+// Collects the canvases that want to sync with pd, so every patch is only read from pd once per sync, no matter how many
+// editors or split views show it. Every canvas still triggers its own async update, the first one to run syncs them all
+// One per plugdata instance
+class CanvasSyncScheduler {
+public:
+    explicit CanvasSyncScheduler(PluginProcessor* processor)
+        : pd(processor)
+    {
+    }
+
+    void schedule(Canvas* canvas)
+    {
+        pending.addIfNotAlreadyThere(canvas);
+    }
+
+    void flush();
+
+private:
+    PluginProcessor* pd;
+    Array<Component::SafePointer<Canvas>> pending;
+    bool flushing = false;
+};
@@ -281,6 +281,24 @@ class CanvasViewport : public Viewport
         int inset;
     };
 
+    // When the canvas moves, JUCE repaints the whole viewport before visibleAreaChanged tells us it was a scroll
+    // Those repaints get deferred, so that the scroll can cancel them and reuse what's already on screen
+    class ViewportInvalidationListener : public NVGSurface::InvalidationListener {
+    public:
+        using InvalidationListener::InvalidationListener;
+
+        bool invalidate(Rectangle<int> const& rect) override
+        {
+            if (!rect.contains(originComponent->getLocalBounds()))
+                return InvalidationListener::invalidate(rect);
+
+            if (originComponent->isVisible())
+                surface.invalidateAreaUnlessScrolled(surface.getLocalArea(originComponent, originComponent->getLocalBounds()));
+
+            return passEvents;
+        }
+    };
+
 public:
     CanvasViewport(PluginEditor* parent, Canvas* cnv)
         : NVGComponent(this)
@@ -301,7 +319,7 @@ public:
         addAndMakeVisible(hbar);
 
         cnv->setCachedComponentImage(new NVGSurface::InvalidationListener(editor->nvgSurface, cnv));
-        setCachedComponentImage(new NVGSurface::InvalidationListener(editor->nvgSurface, this));
+        setCachedComponentImage(new ViewportInvalidationListener(editor->nvgSurface, this));
     }
 
     ~CanvasViewport()
@@ -429,13 +447,30 @@ public:
 
     void visibleAreaChanged(Rectangle<int> const& r) override
     {
+        auto const delta = lastViewPosition - getViewPosition();
+        lastViewPosition = getViewPosition();
+
         if(scaleChanged) {
             cnv->isZooming = true;
             startTimer(150);
         }
         onScroll();
         adjustScrollbarBounds();
-        editor->nvgSurface.invalidateAll();
+
+        auto& surface = editor->nvgSurface;
+        auto const area = surface.getLocalArea(this, getLocalBounds());
+        if (scaleChanged || cnv->isZooming) {
+            surface.invalidateAll();
+        } else {
+            // Only panned, so we can reuse the last frame, shifted by how far we scrolled
+            surface.scrollArea(area, delta);
+
+            // These stay where they are while the content moves, so draw them again
+            surface.invalidateArea(surface.getLocalArea(this, vbar.getBounds()));
+            surface.invalidateArea(surface.getLocalArea(this, hbar.getBounds()));
+            for (auto edge : { area.withWidth(edgeSize), area.withHeight(edgeSize), area.withTrimmedLeft(area.getWidth() - edgeSize), area.withTrimmedTop(area.getHeight() - edgeSize) })
+                surface.invalidateArea(edge);
+        }
     }
 
     void timerCallback() override
@@ -506,4 +541,8 @@ private:
     ViewportScrollBar vbar = ViewportScrollBar(true, this);
     ViewportScrollBar hbar = ViewportScrollBar(false, this);
     bool scaleChanged = false;
+    Point<int> lastViewPosition;
+
+    // The outline of the active split is drawn over the edges of the viewport
+    static constexpr int edgeSize = 4;
 };
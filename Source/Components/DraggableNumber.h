@@ -38,6 +38,9 @@ protected:
 
     std::unique_ptr<NanoVGGraphicsContext> nvgCtx;
 
+    // Numbers are drawn with the same letter spacing as all other text
+    static constexpr float letterSpacing = -0.275f;
+
 public:
     std::function<void(double)> onValueChange = [](double) {};
     std::function<void()> dragStart = []() {};
@@ -288,6 +291,9 @@ public:
 
     void render(NVGcontext* nvg)
     {
+        if (!isBeingEdited() && renderNumber(nvg))
+            return;
+
         if (!nvgCtx || nvgCtx->getContext() != nvg)
             nvgCtx = std::make_unique<NanoVGGraphicsContext>(nvg);
         nvgCtx->setPhysicalPixelScaleFactor(2.0f);
@@ -297,6 +303,82 @@ public:
         }
     }
 
+    // Draws the number straight from nanovg's glyph atlas, which already holds the digits of every font we use
+    // A new value doesn't need a glyph layout or a new image that way, which matters for numbers that change at control rate
+    // Returns false if it can't draw the number like paint() would, in which case we draw through JUCE
+    virtual bool renderNumber(NVGcontext* nvg)
+    {
+        auto const font = getFont();
+        auto fontFace = font.getTypefacePtr()->getName();
+        fontFace = fontFace.contains(" ") ? fontFace.replace(" ", "-") : fontFace + "-" + font.getTypefaceStyle();
+        if (nvgFindFont(nvg, fontFace.toRawUTF8()) < 0)
+            return false;
+
+        auto textArea = getBorderSize().subtractedFrom(getLocalBounds()).toFloat();
+        String numberText, extraNumberText;
+        auto const numberTextLength = getDisplayedText(textArea, numberText, extraNumberText);
+
+        // JUCE would cut the text off with an ellipsis
+        if (showEllipses && numberTextLength > textArea.getWidth())
+            return false;
+
+        if (hoveredDecimal >= 0) {
+            auto const colour = findColour(ComboBox::outlineColourId).withAlpha(isMouseButtonDown() ? 0.5f : 0.3f);
+            nvgFillColor(nvg, nvgRGBA(colour.getRed(), colour.getGreen(), colour.getBlue(), colour.getAlpha()));
+            nvgBeginPath(nvg);
+            nvgRoundedRect(nvg, hoveredDecimalPosition.getX(), hoveredDecimalPosition.getY(), hoveredDecimalPosition.getWidth(), hoveredDecimalPosition.getHeight(), 2.5f);
+            nvgFill(nvg);
+        }
+
+        nvgSave(nvg);
+        nvgIntersectScissor(nvg, 0, 0, getWidth(), getHeight());
+        nvgFontFace(nvg, fontFace.toRawUTF8());
+        nvgFontSize(nvg, font.getHeight() * 0.862f);
+        nvgTextLetterSpacing(nvg, letterSpacing);
+        nvgTextAlign(nvg, NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE);
+
+        // Same baseline as JUCE uses when it centres a line of text vertically
+        auto const baseline = textArea.getCentreY() - font.getHeight() * 0.5f + font.getAscent();
+        auto const textColour = findColour(Label::textColourId);
+        nvgFillColor(nvg, nvgRGBA(textColour.getRed(), textColour.getGreen(), textColour.getBlue(), textColour.getAlpha()));
+        nvgText(nvg, textArea.getX(), baseline, numberText.toRawUTF8(), nullptr);
+
+        if (dragMode == Regular && extraNumberText.isNotEmpty()) {
+            nvgFillColor(nvg, nvgRGBA(textColour.getRed(), textColour.getGreen(), textColour.getBlue(), static_cast<uint8>(textColour.getAlpha() * 0.4f)));
+            nvgText(nvg, textArea.getX() + numberTextLength, baseline, extraNumberText.toRawUTF8(), nullptr);
+        }
+
+        nvgRestore(nvg);
+        return true;
+    }
+
+    // The number as we show it, and the zeros we show after it while hovering decimals. Returns the width of the number
+    float getDisplayedText(Rectangle<float> textArea, String& numberText, String& extraNumberText)
+    {
+        auto font = getFont();
+        numberText = formatNumber(getText().getDoubleValue(), decimalDrag);
+        extraNumberText = String();
+        auto numDecimals = numberText.fromFirstOccurrenceOf(".", false, false).length();
+        auto numberTextLength = CachedFontStringWidth::get()->calculateNumberWidth(font, numberText, letterSpacing);
+
+        for (int i = 0; i < std::min(hoveredDecimal - decimalDrag, 7 - numDecimals); ++i)
+            extraNumberText += "0";
+
+        // If show ellipses is false, only show ">" when integers are too large to fit
+        if (!showEllipses && numDecimals == 0) {
+            int i = 0;
+            while (numberTextLength > textArea.getWidth() + 3 && i < 5) {
+                numberText = numberText.trimCharactersAtEnd(".>");
+                numberText = numberText.dropLastCharacters(1);
+                numberText += ">";
+                numberTextLength = CachedFontStringWidth::get()->calculateNumberWidth(font, numberText, letterSpacing);
+                i++;
+            }
+        }
+
+        return numberTextLength;
+    }
+
     void paint(Graphics& g) override
     {
         if (hoveredDecimal >= 0) {
@@ -308,25 +390,8 @@ public:
         auto font = getFont();
         if (!isBeingEdited()) {
             auto textArea = getBorderSize().subtractedFrom(getLocalBounds()).toFloat();
-            auto numberText = formatNumber(getText().getDoubleValue(), decimalDrag);
-            auto extraNumberText = String();
-            auto numDecimals = numberText.fromFirstOccurrenceOf(".", false, false).length();
-            auto numberTextLength = CachedFontStringWidth::get()->calculateSingleLineWidth(font, numberText);
-
-            for (int i = 0; i < std::min(hoveredDecimal - decimalDrag, 7 - numDecimals); ++i)
-                extraNumberText += "0";
-
-            // If show ellipses is false, only show ">" when integers are too large to fit
-            if (!showEllipses && numDecimals == 0) {
-                int i = 0;
-                while (numberTextLength > textArea.getWidth() + 3 && i < 5) {
-                    numberText = numberText.trimCharactersAtEnd(".>");
-                    numberText = numberText.dropLastCharacters(1);
-                    numberText += ">";
-                    numberTextLength = CachedFontStringWidth::get()->calculateSingleLineWidth(font, numberText);
-                    i++;
-                }
-            }
+            String numberText, extraNumberText;
+            auto numberTextLength = getDisplayedText(textArea, numberText, extraNumberText);
 
             g.setFont(font);
             g.setColour(findColour(Label::textColourId));
@@ -471,6 +536,12 @@ struct DraggableListNumber : public DraggableNumber {
         setEditableOnClick(true);
     }
 
+    // Lists have their own way of drawing, which goes through paint()
+    bool renderNumber(NVGcontext* nvg) override
+    {
+        return false;
+    }
+
     void mouseDown(MouseEvent const& e) override
     {
         if (isBeingEdited())
@@ -395,9 +395,33 @@ protected:
         return parseHexColourStatic(s, defaultColour);
     }
 
+    // Laying out text is the slow part of showing a document, so the layouts for the last few widths are kept
+    // That way measuring, painting and finding links at the same width only lays out once, and resizing back and forth is cheap
+    TextLayout& getLayout(float width)
+    {
+        for (auto& [layoutWidth, layout] : layoutCache) {
+            if (layoutWidth == width)
+                return layout;
+        }
+
+        if (layoutCache.size() >= 4)
+            layoutCache.erase(layoutCache.begin());
+
+        auto& [layoutWidth, layout] = layoutCache.emplace_back(width, TextLayout());
+        layout.createLayout(attributedString, width);
+        return layout;
+    }
+
+    void setAttributedString(AttributedString newString)
+    {
+        attributedString = std::move(newString);
+        layoutCache.clear();
+    }
+
     AttributedString attributedString;
 
 private:
+    std::vector<std::pair<float, TextLayout>> layoutCache;
     Array<std::pair<String, Rectangle<float>>> linkBounds;
     Array<std::tuple<String, int, int>> links;
 };
@@ -406,28 +430,22 @@ class TextBlock : public Block {
 public:
     void parseMarkup(StringArray const& lines, Font font) override
     {
-        attributedString = parsePureText(lines, font);
+        setAttributedString(parsePureText(lines, font));
     }
 
     float getHeightRequired(float width) override
     {
-        TextLayout layout;
-        layout.createLayout(attributedString, width);
-        return layout.getHeight();
+        return getLayout(width).getHeight();
     }
 
     void paint(Graphics& g) override
     {
-        TextLayout layout;
-        layout.createLayout(attributedString, getWidth());
-        layout.draw(g, getLocalBounds().toFloat());
+        getLayout(getWidth()).draw(g, getLocalBounds().toFloat());
     }
 
     void resized() override
     {
-        TextLayout layout;
-        layout.createLayout(attributedString, getWidth());
-        updateLinkBounds(layout);
+        updateLinkBounds(getLayout(getWidth()));
     }
 
 private:
@@ -453,7 +471,7 @@ public:
         } else if (line.startsWith("WARNING: ")) {
             type = warning;
         }
-        attributedString = parsePureText(line.fromFirstOccurrenceOf(": ", false, false), font);
+        setAttributedString(parsePureText(line.fromFirstOccurrenceOf(": ", false, false), font));
         this->iconsize = iconsize;
         this->margin = margin;
         this->linewidth = linewidth;
@@ -461,9 +479,7 @@ public:
 
     float getHeightRequired(float width) override
     {
-        TextLayout layout;
-        layout.createLayout(attributedString, width - iconsize - 2 * (margin + linewidth));
-        return jmax(layout.getHeight(), (float)iconsize);
+        return jmax(getLayout(width - iconsize - 2 * (margin + linewidth)).getHeight(), (float)iconsize);
     }
 
     void paint(Graphics& g) override
@@ -495,7 +511,8 @@ public:
         // draw lines left and right
         g.fillRect(Rectangle<int>(iconsize, 0, linewidth, getHeight()));
         g.fillRect(Rectangle<int>(getWidth() - linewidth, 0, linewidth, getHeight()));
-        attributedString.draw(g, Rectangle<float>(iconsize + margin + linewidth, 0, getWidth() - iconsize - 2 * (margin + linewidth), getHeight()));
+        auto textWidth = static_cast<float>(getWidth() - iconsize - 2 * (margin + linewidth));
+        getLayout(textWidth).draw(g, Rectangle<float>(iconsize + margin + linewidth, 0, textWidth, getHeight()));
     }
 
 private:
@@ -543,7 +560,7 @@ public:
                     TextLayout layout;
                     layout.createLayout(attributedString, 1.0e7f);
                     updateLinkBounds(layout);
-                    row->add(new Cell { attributedString, isHeader, layout.getWidth(), layout.getHeight() });
+                    row->add(new Cell { attributedString, isHeader, layout.getWidth(), layout.getHeight(), layout });
                 }
             }
             table.cells.add(row);
@@ -615,6 +632,7 @@ private:
         bool isHeader;
         float width;
         float height;
+        TextLayout layout; // cells don't wrap, so this is laid out once when parsing
     } Cell;
     class InnerViewport : public Viewport {
     public:
@@ -663,7 +681,7 @@ private:
                 float x = leftmargin;             // X coordinate of cell's top left corner
                 OwnedArray<Cell>* row = cells[i]; // get current row
                 for (int j = 0; j < row->size(); j++) {
-                    Cell c = *((*row)[j]);     // get current cell
+                    auto const& c = *((*row)[j]); // get current cell
                     if (c.isHeader) {          // if it's a header cell...
                         g.setColour(bgHeader); // ...set header background colour
                     } else {                   // otherwise...
@@ -672,7 +690,7 @@ private:
                     // fill background
                     g.fillRect(x, y, columnwidths[j] + 2 * cellmargin, rowheights[i] + 2 * cellmargin);
                     // draw cell text
-                    c.s.draw(g, Rectangle<float>(x + cellmargin, y + cellmargin, columnwidths[j], rowheights[i]));
+                    c.layout.draw(g, Rectangle<float>(x + cellmargin, y + cellmargin, columnwidths[j], rowheights[i]));
                     // move one cell to the right
                     x += columnwidths[j] + 2 * cellmargin + cellgap;
                 }
@@ -806,7 +824,7 @@ public:
         if (dotidx > 0 && lbl.containsOnly("0123456789")) { // ...and at least one number.
             label.append(lbl + ".", font, defaultColour);   // create label
             // parse item text (everything after the dot)
-            attributedString = parsePureText(line.substring(dotidx + 2).trimStart(), font);
+            setAttributedString(parsePureText(line.substring(dotidx + 2).trimStart(), font));
             // use number of whitespace characters to determine indent
             indent = indentPerSpace * (beforedot.length() - lbl.length());
         } else {                                                // otherwise try unordered list:
@@ -814,36 +832,33 @@ public:
             String beforehyphen = line.substring(0, hyphenidx); // find out if before the hyphen...
             if (!beforehyphen.containsNonWhitespaceChars()) {   // ...there's only whitespace.
                 // parse item text (everything after the hyphen)
-                attributedString = parsePureText(line.substring(hyphenidx + 2).trimStart(), font);
+                setAttributedString(parsePureText(line.substring(hyphenidx + 2).trimStart(), font));
                 // use number of whitespace characters to determine indent
                 indent = indentPerSpace * beforehyphen.length();
                 // create label TODO: have bullet character depend on indent
                 label.append(CharPointer_UTF8("•"), font, defaultColour);
             } else { // if everything fails, interpret as regular text without label
                 indent = 0;
-                attributedString = parsePureText(line, font);
+                setAttributedString(parsePureText(line, font));
             }
         }
     }
 
     float getHeightRequired(float width) override
     {
-        TextLayout layout;
-        layout.createLayout(attributedString, width - indent - gap);
-        return layout.getHeight();
+        return getLayout(width - indent - gap).getHeight();
     }
 
     void paint(Graphics& g) override
     {
+        auto textBounds = getLocalBounds().withTrimmedLeft(indent + gap).toFloat();
         label.draw(g, getLocalBounds().withTrimmedLeft(indent).toFloat());
-        attributedString.draw(g, getLocalBounds().withTrimmedLeft(indent + gap).toFloat());
+        getLayout(textBounds.getWidth()).draw(g, textBounds);
     }
 
     void resized() override
     {
-        TextLayout layout;
-        layout.createLayout(attributedString, getWidth() - indent - gap);
-        updateLinkBounds(layout);
+        updateLinkBounds(getLayout(getWidth() - indent - gap));
     }
 
 private:
@@ -920,6 +935,13 @@ public:
     // clear the background
     void resized() override
     {
+        viewport.setBounds(getLocalBounds());
+
+        // The blocks only depend on the width, so there is nothing to reflow when just the height changes
+        if (getWidth() == layoutWidth)
+            return;
+        layoutWidth = getWidth();
+
         // let's keep the relative vertical position
         double relativeScrollPosition = static_cast<double>(viewport.getViewPositionY()) / content.getHeight();
         // compute content height
@@ -935,7 +957,6 @@ public:
             h += bh;
         }
         // set new bounds
-        viewport.setBounds(getLocalBounds());
         content.setBounds(0, 0, getWidth(), h + margin);
         // set vertical scroll position
         int newScrollY = static_cast<int>(relativeScrollPosition * content.getHeight());
@@ -1039,7 +1060,13 @@ public:
 
     void setMarkupString(String s)
     {
+        // Showing the same document again keeps the blocks and their layouts
+        if (s == markupString && blocks.size())
+            return;
+        markupString = s;
+
         blocks.clear();
+        layoutWidth = -1;
 
         StringArray lines;
         lines.addLines(s);
@@ -1149,6 +1176,8 @@ private:
     int adlinewidth;               // admonition line width in pixels
     FileSource* fileSource;        // data source for image files, etc.
     Font font;                     // default font for regular text
+    String markupString;           // the document that the blocks were parsed from
+    int layoutWidth = -1;          // width that the blocks were last laid out for
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MarkupDisplayComponent)
 };
@@ -11,6 +11,7 @@
 #include "Heavy/CompatibleObjects.h"
 #include "Utility/NanoVGGraphicsContext.h"
 #include "Components/BouncingViewport.h"
+#include "Utility/BackgroundTasks.h"
 
 extern "C" {
 int is_gem_object(char const* sym);
@@ -154,7 +155,8 @@ private:
 // Suggestions component that shows up when objects are edited
 class SuggestionComponent : public Component
     , public KeyListener
-    , public ComponentListener {
+    , public ComponentListener
+    , private AsyncUpdater {
 
     class Suggestion : public TextButton {
 
@@ -296,6 +298,8 @@ public:
 
     ~SuggestionComponent() override
     {
+        tasks.cancelAndWait();
+        cancelPendingUpdate();
         buttons.clear();
     }
 
@@ -384,6 +388,11 @@ public:
 
         openedEditor = nullptr;
         currentObject = nullptr;
+
+        // Results for this editor that are still on their way shouldn't show up in the next one
+        ++latestQuery;
+        tasks.cancelPendingJobs();
+        cancelPendingUpdate();
     }
 
     void componentBeingDeleted(Component& component) override
@@ -483,66 +492,6 @@ public:
         
         auto& library = currentObject->cnv->pd->objectLibrary;
 
-        class ObjectSorter {
-        public:
-            ObjectSorter(String searchQuery)
-                : query(searchQuery)
-            {
-            }
-
-            int compareElements(String const& a, String const& b) const
-            {
-                // Check if suggestion exacly matches query
-                if (a == query && b != query) {
-                    return -1;
-                }
-
-                if (b == query && a != query) {
-                    return 1;
-                }
-                
-                // Check if suggestion is equal to query with "~" appended
-                if (a == (query + "~") && b != query && b != (query + "~")) {
-                    return -1;
-                }
-
-                if (b == (query + "~") && a != query && a != (query + "~")) {
-                    return 1;
-                }
-
-                // Check if suggestion is equal to query with "." appended
-                if (a.startsWith(query + ".") && b != query && b != (query + "~") && !b.startsWith(query + ".")) {
-                    return -1;
-                }
-
-                if (b.startsWith(query + ".") && a != query && a != (query + "~") && !a.startsWith(query + ".")) {
-                    return 1;
-                }
-                
-                if(a.startsWith(query) && !b.startsWith(query))
-                {
-                    return -1;
-                }
-                
-                if(b.startsWith(query) && !a.startsWith(query))
-                {
-                    return 1;
-                }
-                
-                return 0;
-            }
-            String const query;
-        };
-
-        auto sortSuggestions = [](String query, StringArray suggestions) -> StringArray {
-            if (query.length() == 0)
-                return suggestions;
-
-            auto sorter = ObjectSorter(query);
-            suggestions.strings.sort(sorter, true);
-            return suggestions;
-        };
-
         if (currentObject->gui && currentObject->getType(false) == "msg") {
             auto nearbyMethods = findNearbyMethods(currentText);
 
@@ -635,6 +584,114 @@ public:
             buttons[currentidx]->setToggleState(true, dontSendNotification);
         }
 
+        auto patchDir = currentObject->cnv->patch.getPatchFile().getParentDirectory();
+        if (!patchDir.isDirectory() || patchDir == File::getSpecialLocation(File::tempDirectory))
+            patchDir = File();
+
+        // With all libraries loaded, looking up and fuzzy searching the names takes long enough to make typing lag
+        // So that runs on a worker, and only the latest query gets shown: queries that didn't start yet are dropped when a new one comes in
+        auto const query = ++latestQuery;
+        tasks.cancelPendingJobs();
+        tasks.addJob("SuggestionComponent::autocomplete", [this, library = library.get(), currentText, patchDir, query]() {
+            if (latestQuery.load() != query)
+                return;
+
+            auto found = library->autocomplete(currentText, patchDir);
+
+            ScopedLock lock(resultLock);
+            if (latestQuery.load() != query)
+                return;
+
+            resultQuery = query;
+            resultText = currentText;
+            resultObjects = std::move(found);
+            triggerAsyncUpdate();
+        }, BackgroundTasks::High);
+    }
+
+private:
+    void handleAsyncUpdate() override
+    {
+        int query;
+        String currentText;
+        StringArray found;
+        {
+            ScopedLock lock(resultLock);
+            query = resultQuery;
+            currentText = resultText;
+            found.swapWith(resultObjects);
+        }
+
+        if (query != latestQuery.load() || currentText != lastText || !currentObject || !openedEditor)
+            return;
+
+        showObjectSuggestions(currentText, found);
+    }
+
+    void showObjectSuggestions(String const& currentText, StringArray found)
+    {
+        auto& library = currentObject->cnv->pd->objectLibrary;
+
+        class ObjectSorter {
+        public:
+            ObjectSorter(String searchQuery)
+                : query(searchQuery)
+            {
+            }
+
+            int compareElements(String const& a, String const& b) const
+            {
+                // Check if suggestion exacly matches query
+                if (a == query && b != query) {
+                    return -1;
+                }
+
+                if (b == query && a != query) {
+                    return 1;
+                }
+                
+                // Check if suggestion is equal to query with "~" appended
+                if (a == (query + "~") && b != query && b != (query + "~")) {
+                    return -1;
+                }
+
+                if (b == (query + "~") && a != query && a != (query + "~")) {
+                    return 1;
+                }
+
+                // Check if suggestion is equal to query with "." appended
+                if (a.startsWith(query + ".") && b != query && b != (query + "~") && !b.startsWith(query + ".")) {
+                    return -1;
+                }
+
+                if (b.startsWith(query + ".") && a != query && a != (query + "~") && !a.startsWith(query + ".")) {
+                    return 1;
+                }
+                
+                if(a.startsWith(query) && !b.startsWith(query))
+                {
+                    return -1;
+                }
+                
+                if(b.startsWith(query) && !a.startsWith(query))
+                {
+                    return 1;
+                }
+                
+                return 0;
+            }
+            String const query;
+        };
+
+        auto sortSuggestions = [](String query, StringArray suggestions) -> StringArray {
+            if (query.length() == 0)
+                return suggestions;
+
+            auto sorter = ObjectSorter(query);
+            suggestions.strings.sort(sorter, true);
+            return suggestions;
+        };
+
         auto filterObjects = [_this = SafePointer(this), &library](StringArray& toFilter) {
             if (!_this || !_this->currentObject)
                 return;
@@ -672,13 +729,6 @@ public:
                 }
             }
         };
-        auto patchDir = currentObject->cnv->patch.getPatchFile().getParentDirectory();
-        if (!patchDir.isDirectory() || patchDir == File::getSpecialLocation(File::tempDirectory))
-            patchDir = File();
-
-        // Update suggestions
-        auto found = library->autocomplete(currentText, patchDir);
-
         filterObjects(found);
 
         if (found.isEmpty() || !found[0].startsWith(currentText)) {
@@ -744,7 +794,6 @@ public:
         }
     }
 
-private:
     void mouseDown(MouseEvent const& e) override
     {
         if (openedEditor)
@@ -768,9 +817,7 @@ private:
         if (!canBeTransparent()) {
             g.fillAll(findColour(PlugDataColour::canvasBackgroundColourId));
         } else {
-            Path localPath;
-            localPath.addRoundedRectangle(b.toFloat().reduced(6.0f), Corners::defaultCornerRadius);
-            StackShadow::renderDropShadow(g, localPath, Colour(0, 0, 0).withAlpha(0.6f), 13, { 0, 1 });
+            StackShadow::renderDropShadow(g, b.toFloat().reduced(6.0f), Corners::defaultCornerRadius, Colour(0, 0, 0).withAlpha(0.6f), 13, { 0, 1 });
         }
 
         g.setColour(findColour(PlugDataColour::popupMenuBackgroundColourId));
@@ -934,6 +981,17 @@ private:
     SafePointer<Object> currentObject = nullptr;
     String lastText;
 
+    // Every query gets a number, results are only shown if no newer query came in since
+    std::atomic<int> latestQuery = 0;
+
+    // Written by the worker, read on the message thread in handleAsyncUpdate
+    CriticalSection resultLock;
+    int resultQuery = -1;
+    String resultText;
+    StringArray resultObjects;
+
+    BackgroundTasks::TaskGroup tasks;
+
     StringArray excludeList = {
         "number~", // appears before numbox~ alphabetically, but is worse in every way
         "allpass_unit",
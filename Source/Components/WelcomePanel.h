@@ -20,6 +20,8 @@ class WelcomePanel : public Component
         bool isHovered = false;
         String tileName, tileSubtitle;
         std::unique_ptr<Drawable> snapshot = nullptr;
+        Colour snapshotColour;
+        bool waitingForSnapshot = false;
         NVGImage titleImage, subtitleImage;
         
     public:
@@ -32,14 +34,29 @@ class WelcomePanel : public Component
             , snapshotScale(scale)
             , tileName(name)
             , tileSubtitle(subtitle)
+            , snapshotColour(iconColour)
             , isFavourited(favourited)
         {
+            setSnapshot(svgImage);
+        }
+
+        // Shows a placeholder until the snapshot has been generated in the background
+        void setWaitingForSnapshot()
+        {
+            waitingForSnapshot = true;
+            repaint();
+        }
+
+        void setSnapshot(String const& svgImage)
+        {
+            waitingForSnapshot = false;
             snapshot = Drawable::createFromImageData(svgImage.toRawUTF8(), svgImage.getNumBytesAsUTF8());
             if (snapshot) {
-                snapshot->replaceColour(Colours::black, iconColour);
+                snapshot->replaceColour(Colours::black, snapshotColour);
             }
 
             resized();
+            repaint();
         }
 
         void paint(Graphics& g) override
@@ -56,6 +73,11 @@ class WelcomePanel : public Component
 
             if (snapshot) {
                 snapshot->drawAt(g, 0, 0, 1.0f);
+            } else if (waitingForSnapshot) {
+                auto placeholderBounds = bounds.withTrimmedBottom(44).toFloat();
+                placeholderBounds = placeholderBounds.withSizeKeepingCentre(placeholderBounds.getWidth() * 0.5f, placeholderBounds.getHeight() * 0.4f);
+                g.setColour(snapshotColour.withMultipliedAlpha(0.5f));
+                g.fillRoundedRectangle(placeholderBounds, Corners::objectCornerRadius);
             }
 
             Path textAreaPath;
@@ -263,9 +285,8 @@ public:
                 auto snapshotColour = LookAndFeel::getDefaultLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId).withAlpha(0.3f);
 
                 String silhoutteSvg;
-                if (patchImage.isEmpty() && patchFile.existsAsFile()) {
-                    silhoutteSvg = OfflineObjectRenderer::patchToSVG(patchFile.loadFileAsString());
-                } else {
+                bool generateSnapshot = patchImage.isEmpty() && patchFile.existsAsFile();
+                if (!generateSnapshot) {
                     MemoryOutputStream ostream;
                     Base64::convertFromBase64(ostream, patchImage);
                     MemoryInputStream istream(ostream.getMemoryBlock());
@@ -295,6 +316,13 @@ public:
                 String timeDescription = date + ", " + time;
 
                 auto* tile = tiles.add(new WelcomePanelTile(*this, patchFile.getFileName(), timeDescription, silhoutteSvg, snapshotColour, 1.0f, favourited));
+                if (generateSnapshot) {
+                    tile->setWaitingForSnapshot();
+                    OfflineObjectRenderer::patchFileToSVGAsync(patchFile, [tile = Component::SafePointer<WelcomePanelTile>(tile)](String const& svg) {
+                        if (tile)
+                            tile->setSnapshot(svg);
+                    });
+                }
                 tile->onClick = [this, patchFile]() mutable {
                     if(patchFile.existsAsFile()) {
                         editor->autosave->checkForMoreRecentAutosave(patchFile, editor, [this, patchFile]() {
@@ -93,7 +93,8 @@ Connection::Connection(Canvas* parent, Iolet* s, Iolet* e, t_outconnect* oc)
 
 Connection::~Connection()
 {
-    cnv->pd->unregisterMessageListener(ptr.getRawUnchecked<void>(), this);
+    cnv->connectionIndex.remove(this);
+    cnv->pd->messageDispatcher->removeActivityTarget(ptr.getRawUnchecked<void>());
     cnv->selectedComponents.removeChangeListener(this);
 
     if (outlet) {
@@ -166,6 +167,20 @@ void Connection::render(NVGcontext* nvg)
         connectionColour.b *= 1.2f;
     }
 
+    // Far zoomed out, the curve and cable shading can't be seen anyway, so a straight line will do
+    if (cnv->isRenderingLowDetail() && inlet && outlet) {
+        auto const start = outlet->getCanvasBounds().getCentre().toFloat();
+        auto const end = inlet->getCanvasBounds().getCentre().toFloat();
+
+        nvgBeginPath(nvg);
+        nvgMoveTo(nvg, start.x, start.y);
+        nvgLineTo(nvg, end.x, end.y);
+        nvgStrokeColor(nvg, connectionColour);
+        nvgStrokeWidth(nvg, getPathWidth());
+        nvgStroke(nvg);
+        return;
+    }
+
     nvgSave(nvg);
     nvgTranslate(nvg, getX(), getY());
 
@@ -196,6 +211,7 @@ void Connection::render(NVGcontext* nvg)
         nvgFillColor(nvg, connectionColour);
         nvgCircle(nvg, startPoint.x, startPoint.y, cableThickness * 0.25f);
         nvgFill(nvg);
+        nvgRestore(nvg);
         return;
     }
 
@@ -418,8 +434,10 @@ void Connection::setPointer(t_outconnect* newPtr)
     if (originalPointer != newPtr) {
         ptr = pd::WeakReference(newPtr, cnv->pd);
 
-        cnv->pd->unregisterMessageListener(originalPointer, this);
-        cnv->pd->registerMessageListener(newPtr, this);
+        // We don't need every message, only to know that messages went through, so we sample a counter each frame
+        cnv->pd->messageDispatcher->removeActivityTarget(originalPointer);
+        cnv->pd->messageDispatcher->addActivityTarget(newPtr);
+        lastActivityCount = cnv->pd->messageDispatcher->getActivityCount(newPtr);
     }
 }
 
@@ -450,11 +468,6 @@ bool Connection::hitTest(int x, int y)
 
     Point<float> position = Point<float>(static_cast<float>(x), static_cast<float>(y)) + getPosition().toFloat();
 
-    Point<float> nearestPoint;
-
-    auto path = getPath();
-    path.getNearestPoint(position, nearestPoint);
-
     // Get outlet and inlet point
     auto pstart = getStartPoint();
     auto pend = getEndPoint();
@@ -468,33 +481,43 @@ bool Connection::hitTest(int x, int y)
     if (pstart.getDistanceFrom(position) < 8.0f || pend.getDistanceFrom(position) < 8.0f)
         return false;
 
-    return nearestPoint.getDistanceFrom(position) < 3;
+    return isNearPath(position, 3.0f);
 }
 
-bool Connection::intersects(Rectangle<float> toCheck, int accuracy) const
+std::vector<Connection::FlattenedSegment> const& Connection::getFlattenedPath() const
 {
-    PathFlatteningIterator i(getPath());
-
-    while (i.next()) {
-        auto point1 = Point<float>(i.x1, i.y1);
-
-        // Skip points to reduce accuracy a bit for better performance
-        // We can only skip points if there are many points!
-        if (!PlugDataLook::getUseStraightConnections()) {
-            for (int n = 0; n < accuracy; n++) {
-                auto next = i.next();
-                if (!next)
-                    break;
-            }
-         }
+    if (!flattenedPathIsValid) {
+        flattenedPath.clear();
+
+        PathFlatteningIterator i(getPath());
+        while (i.next()) {
+            auto const line = Line<float>(i.x1, i.y1, i.x2, i.y2);
+            // Expanded a little, so horizontal and vertical lines don't get empty bounds
+            flattenedPath.push_back({ line, Rectangle<float>(line.getStart(), line.getEnd()).expanded(1.0f) });
+        }
 
-        auto point2 = Point<float>(i.x2, i.y2);
+        flattenedPathIsValid = true;
+    }
 
-        auto currentLine = Line<float>(point1, point2);
+    return flattenedPath;
+}
 
-        if (toCheck.intersects(currentLine)) {
+bool Connection::isNearPath(Point<float> position, float maxDistance) const
+{
+    Point<float> nearestPoint;
+    for (auto const& segment : getFlattenedPath()) {
+        if (segment.bounds.expanded(maxDistance).contains(position) && segment.line.getDistanceFromPoint(position, nearestPoint) < maxDistance)
+            return true;
+    }
+
+    return false;
+}
+
+bool Connection::intersects(Rectangle<float> toCheck) const
+{
+    for (auto const& segment : getFlattenedPath()) {
+        if (segment.bounds.intersects(toCheck) && toCheck.intersects(segment.line))
             return true;
-        }
     }
 
     return false;
@@ -581,21 +604,6 @@ void Connection::mouseMove(MouseEvent const& e)
     }
 }
 
-void Connection::timerCallback(int ID)
-{
-    switch (ID) {
-    case StopAnimation:
-        stopTimer(Animation);
-        stopTimer(StopAnimation);
-        break;
-    case Animation:
-        animate();
-        break;
-    default:
-        break;
-    }
-}
-
 void Connection::animate()
 {
     offset += 0.1f;
@@ -606,6 +614,8 @@ void Connection::animate()
 
 StringArray Connection::getMessageFormated()
 {
+    cnv->pd->messageDispatcher->getLatestMessage(ptr.getRawUnchecked<void>(), lastSelector, lastValue, lastNumArgs);
+
     auto args = lastValue;
     auto name = lastSelector ? String::fromUTF8(lastSelector->s_name) : "";
 
@@ -793,9 +803,11 @@ int Connection::getClosestLineIdx(Point<float> const& position, PathPlan const&
 
 void Connection::pathChanged()
 {
+    flattenedPathIsValid = false;
     strokePath.clear();
     strokeType.createStrokedPath (strokePath, path, AffineTransform(), 1.0f);
     setBoundsToEnclose (getDrawableBounds());
+    cnv->connectionIndex.update(this, getBounds());
     repaint();
 }
 
@@ -1024,22 +1036,6 @@ int Connection::getMultiConnectNumber()
     return -1;
 }
 
-int Connection::getSignalData(t_float* output, int maxChannels)
-{
-    if (auto oc = ptr.get<t_outconnect>()) {
-        if (auto* signal = outconnect_get_signal(oc.get())) {
-            auto numChannels = std::min(signal->s_nchans, maxChannels - 1);
-            auto* samples = signal->s_vec;
-            if (!samples)
-                return 0;
-            std::copy(samples, samples + (DEFDACBLKSIZE * numChannels), output);
-            return numChannels;
-        }
-    }
-
-    return 0;
-}
-
 int Connection::getNumSignalChannels()
 {
     if (auto oc = ptr.get<t_outconnect>()) {
@@ -1136,73 +1132,77 @@ bool Connection::intersectsRectangle(Rectangle<int> rectToIntersect)
 }
 
 void Connection::applyBestPath()
-{
-    segmented = true;
-    findPath();
-    updatePath();
-    repaint();
-}
-
-void Connection::findPath()
 {
     if (!outlet || !inlet)
         return;
 
-    auto pstart = getStartPoint();
-    auto pend = getEndPoint();
-
-    auto pathStack = PathPlan();
-    auto bestPath = PathPlan();
-
-    pathStack.reserve(8);
-
-    auto numFound = 0;
+    // Plan on the worker thread, so auto-routing a large selection doesn't block the UI
+    cnv->pathPlanner.planAsync(getPathRequest(), [_this = SafePointer(this), pstart = getStartPoint(), pend = getEndPoint()](PathPlan const& plan) {
+        if (!_this || !_this->outlet || !_this->inlet)
+            return;
 
-    float incrementX, incrementY;
+        _this->segmented = true;
 
-    auto distance = pstart.getDistanceFrom(pend);
-    auto distanceX = std::abs(pstart.x - pend.x);
-    auto distanceY = std::abs(pstart.y - pend.y);
+        // The connection moved while we were planning, so this plan no longer fits
+        if (_this->getStartPoint() != pstart || _this->getEndPoint() != pend)
+            _this->findPath();
+        else
+            _this->applyPathPlan(plan);
 
-    int maxXResolution = std::clamp<int>(distanceX / 10, 6, 14);
-    int maxYResolution = std::clamp<int>(distanceY / 10, 6, 14);
+        _this->updatePath();
+        _this->repaint();
+    });
+}
 
-    int resolutionX = 6;
-    int resolutionY = 6;
+ConnectionPathPlanner::Request Connection::getPathRequest()
+{
+    ConnectionPathPlanner::Request request;
+    request.start = getStartPoint();
+    request.end = getEndPoint();
 
-    auto obstacles = Array<Rectangle<float>>();
-    auto searchBounds = Rectangle<float>(pstart, pend);
+    std::vector<Object*> nearbyObjects;
+    cnv->objectIndex.query(Rectangle<float>(request.start, request.end).expanded(40.0f).getSmallestIntegerContainer(), nearbyObjects);
 
-    for (auto* object : cnv->objects) {
-        if (object->getBounds().toFloat().intersects(searchBounds)) {
-            obstacles.add(object->getBounds().toFloat());
-        }
+    for (auto* object : nearbyObjects) {
+        if (object != outobj && object != inobj)
+            request.obstacles.push_back(object->getBounds().toFloat());
     }
 
-    // Look for paths at an increasing resolution
-    while (!numFound && resolutionX < maxXResolution && distance > 40) {
-
-        // Find paths on a resolution*resolution lattice ObjectGrid
-        incrementX = std::max<float>(1, distanceX / resolutionX);
-        incrementY = std::max<float>(1, distanceY / resolutionY);
+    // Keep the order stable, so the same layout always gives the same cached plan
+    std::sort(request.obstacles.begin(), request.obstacles.end(), [](auto const& a, auto const& b) {
+        return a.getX() != b.getX() ? a.getX() < b.getX() : a.getY() < b.getY();
+    });
 
-        numFound = findLatticePaths(bestPath, pathStack, pend, pstart, { incrementX, incrementY });
+    return request;
+}
 
-        if (resolutionX < maxXResolution)
-            resolutionX++;
-        if (resolutionY < maxXResolution)
-            resolutionY++;
+void Connection::findPath()
+{
+    if (!outlet || !inlet)
+        return;
 
-        if (resolutionX > maxXResolution || resolutionY > maxYResolution)
-            break;
+    auto const pstart = getStartPoint();
+    auto const pend = getEndPoint();
 
-        pathStack.clear();
+    // Very short connections don't need to go around anything
+    if (pstart.getDistanceFrom(pend) <= 40) {
+        applyPathPlan({});
+        return;
     }
 
+    applyPathPlan(cnv->pathPlanner.getPlan(getPathRequest()));
+}
+
+// Turns a planned path, which goes from the inlet to the outlet through every cell, into the points of a segmented connection
+void Connection::applyPathPlan(PathPlan const& bestPath)
+{
+    auto pstart = getStartPoint();
+    auto pend = getEndPoint();
+
     PathPlan simplifiedPath;
 
     bool direction;
-    if (!bestPath.empty()) {
+    if (bestPath.size() > 1) {
         simplifiedPath.push_back(bestPath.front());
 
         direction = approximatelyEqual(bestPath[0].x, bestPath[1].x);
@@ -1246,125 +1246,65 @@ void Connection::findPath()
     pushPathState();
 }
 
-int Connection::findLatticePaths(PathPlan& bestPath, PathPlan& pathStack, Point<float> pstart, Point<float> pend, Point<float> increment)
+void ConnectionAnimator::animate(Connection* connection)
 {
-
-    auto obstacles = Array<Object*>();
-    auto searchBounds = Rectangle<float>(pstart, pend);
-
-    for (auto* object : cnv->objects) {
-        if (object->getBounds().toFloat().intersects(searchBounds)) {
-            obstacles.add(object);
+    auto const stopTime = Time::getMillisecondCounter() + 1000 / 8;
+    for (auto& entry : animating) {
+        if (entry.connection == connection) {
+            entry.stopTime = stopTime;
+            return;
         }
     }
 
-    // Stop after we've found a path
-    if (!bestPath.empty())
-        return 0;
-
-    // Add point to path
-    pathStack.push_back(pstart);
+    if (animating.empty())
+        canvas->editor->frameScheduler.addPoller(this, 1000 / 60);
 
-    // Check if it intersects any object
-    if (pathStack.size() > 1 && straightLineIntersectsObject(Line<float>(pathStack.back(), *(pathStack.end() - 2)), obstacles)) {
-        return 0;
-    }
+    animating.push_back({ connection, stopTime });
+    connection->animate();
+}
 
-    bool endVertically = pathStack[0].y > pend.y;
+void ConnectionAnimator::pollFrame()
+{
+    auto const now = Time::getMillisecondCounter();
+    std::erase_if(animating, [now](auto const& entry) {
+        return !entry.connection || static_cast<int32>(now - entry.stopTime) >= 0;
+    });
 
-    // Check if we've reached the destination
-    if (std::abs(pstart.x - pend.x) < (increment.x * 0.5) && std::abs(pstart.y - pend.y) < (increment.y * 0.5)) {
-        bestPath = pathStack;
-        return 1;
+    for (auto& entry : animating) {
+        entry.connection->animate();
     }
 
-    // Count the number of found paths
-    int count = 0;
-
-    // Get current stack to revert to after each trial
-    auto pathCopy = pathStack;
-
-    auto followLine = [this, &count, &pathCopy, &bestPath, &pathStack, &increment](Point<float> currentOutlet, Point<float> currentInlet, bool isX) {
-        auto& coord1 = isX ? currentOutlet.x : currentOutlet.y;
-        auto& coord2 = isX ? currentInlet.x : currentInlet.y;
-        auto& incr = isX ? increment.x : increment.y;
-
-        if (std::abs(coord1 - coord2) >= incr) {
-            coord1 > coord2 ? coord1 -= incr : coord1 += incr;
-            count += findLatticePaths(bestPath, pathStack, currentOutlet, currentInlet, increment);
-            pathStack = pathCopy;
-        }
-    };
-
-    // If we're halfway on the axis, change preferred direction by inverting search order
-    // This will make it do a staircase effect
-    if (endVertically) {
-        if (std::abs(pstart.y - pend.y) >= std::abs(pathStack[0].y - pend.y) * 0.5) {
-            followLine(pstart, pend, false);
-            followLine(pstart, pend, true);
-        } else {
-            followLine(pstart, pend, true);
-            followLine(pstart, pend, false);
-        }
-    } else {
-        if (std::abs(pstart.x - pend.x) >= std::abs(pathStack[0].x - pend.x) * 0.5) {
-            followLine(pstart, pend, true);
-            followLine(pstart, pend, false);
-        } else {
-            followLine(pstart, pend, false);
-            followLine(pstart, pend, true);
-        }
-    }
-
-    return count;
+    if (animating.empty())
+        canvas->editor->frameScheduler.removePoller(this);
 }
 
-bool Connection::straightLineIntersectsObject(Line<float> toCheck, Array<Object*>& objects)
+void ConnectionPathUpdater::timerCallback()
 {
+    stopTimer();
 
-    for (auto const& object : objects) {
-        auto bounds = object->getBounds().expanded(1);
-
-        if (object == outobj || object == inobj || !bounds.intersects(getBounds()))
-            continue;
-
-        auto intersectV = [](Line<float> first, Line<float> second) {
-            if (first.getStartY() > first.getEndY()) {
-                first = { first.getEnd(), first.getStart() };
-            }
-
-            return first.getStartX() > second.getStartX() && first.getStartX() < second.getEndX() && second.getStartY() > first.getStartY() && second.getStartY() < first.getEndY();
-        };
-
-        auto intersectH = [](Line<float> first, Line<float> second) {
-            if (first.getStartX() > first.getEndX()) {
-                first = { first.getEnd(), first.getStart() };
-            }
-
-            return first.getStartY() > second.getStartY() && first.getStartY() < second.getEndY() && second.getStartX() > first.getStartX() && second.getStartX() < first.getEndX();
-        };
-
-        bool intersectsV = toCheck.isVertical() && (intersectV(toCheck, Line<float>(bounds.getTopLeft().toFloat(), bounds.getTopRight().toFloat())) || intersectV(toCheck, Line<float>(bounds.getBottomRight().toFloat(), bounds.getBottomLeft().toFloat())));
+    std::pair<Component::SafePointer<Connection>, t_symbol*> currentConnection;
 
-        bool intersectsH = toCheck.isHorizontal() && (intersectH(toCheck, Line<float>(bounds.getTopRight().toFloat(), bounds.getBottomRight().toFloat())) || intersectH(toCheck, Line<float>(bounds.getTopLeft().toFloat(), bounds.getBottomLeft().toFloat())));
-        if (intersectsV || intersectsH) {
-            return true;
-        }
+    struct ConnectionInfo {
+        t_object* outObj;
+        int outIdx;
+        t_object* inObj;
+        int inIdx;
+    };
 
-        /*
-         if(bounds.toFloat().intersects(toCheck.toFloat())) {
-         return true;
-         } TODO: benchmark these two options */
-        // TODO: possible mark areas that have already been visited?
+    auto patch = canvas->patch.getPointer();
+    if (!patch) {
+        while (connectionUpdateQueue.try_dequeue(currentConnection)) { }
+        return;
     }
-    return false;
-}
 
-void ConnectionPathUpdater::timerCallback()
-{
-    stopTimer();
+    // Look up all connections in a single pass, instead of walking the whole patch for every connection we update
+    std::unordered_map<t_outconnect*, ConnectionInfo> connectionInfo;
 
-    std::pair<Component::SafePointer<Connection>, t_symbol*> currentConnection;
+    t_linetraverser t;
+    linetraverser_start(&t, patch.get());
+    while (auto* oc = linetraverser_next_nosize(&t)) {
+        connectionInfo[oc] = { t.tr_ob, t.tr_outno, t.tr_ob2, t.tr_inno };
+    }
 
     canvas->patch.startUndoSequence("SetConnectionPaths");
 
@@ -1375,59 +1315,38 @@ void ConnectionPathUpdater::timerCallback()
         if (!connection)
             continue;
 
-        bool found = false;
-        t_linetraverser t;
+        auto it = connectionInfo.find(connection->ptr.getRaw<t_outconnect>());
+        if (it == connectionInfo.end())
+            continue;
 
-        t_object* outObj;
-        int outIdx;
-        t_object* inObj;
-        int inIdx;
+        auto const info = it->second;
+        if (auto oc = connection->ptr.get<t_outconnect>()) {
+            t_symbol* oldPathState = outconnect_get_path_data(oc.get());
+            auto* newConnection = connection->cnv->patch.setConnctionPath(info.outObj, info.outIdx, info.inObj, info.inIdx, oldPathState, newPathState);
+            connection->setPointer(newConnection);
 
-        if(auto patch = connection->cnv->patch.getPointer()) {
-            
-            // Get connections from pd
-            linetraverser_start(&t, patch.get());
-            
-            while (auto* oc = linetraverser_next_nosize(&t)) {
-                
-                if (oc == connection->ptr.getRaw<t_outconnect>()) {
-                    
-                    outObj = t.tr_ob;
-                    outIdx = t.tr_outno;
-                    inObj = t.tr_ob2;
-                    inIdx = t.tr_inno;
-                    
-                    found = true;
-                    break;
-                }
-            }
-            
-            if (!found)
-                continue;
-            
-            if (auto oc = connection->ptr.get<t_outconnect>()) {
-                t_symbol* oldPathState = outconnect_get_path_data(oc.get());
-                auto* newConnection = connection->cnv->patch.setConnctionPath(outObj, outIdx, inObj, inIdx, oldPathState, newPathState);
-                connection->setPointer(newConnection);
-            }
+            // Setting the path recreates the connection, so the same connection can be found again if it's queued twice
+            connectionInfo.erase(it);
+            if (newConnection)
+                connectionInfo[newConnection] = info;
         }
     }
 
     canvas->patch.endUndoSequence("SetConnectionPaths");
 }
 
-void Connection::receiveMessage(t_symbol* symbol, pd::Atom const atoms[8], int numAtoms)
+void Connection::updateActivity()
 {
+    auto const activityCount = cnv->pd->messageDispatcher->getActivityCount(ptr.getRawUnchecked<void>());
+    if (activityCount == lastActivityCount)
+        return;
+
+    lastActivityCount = activityCount;
+
     if (cnv->shouldShowConnectionActivity()) {
-        startTimer(StopAnimation, 1000 / 8.0f);
-        if (!isTimerRunning(Animation)) {
-            startTimer(Animation, 1000 / 60.0f);
-            animate();
-        }
+        cnv->connectionAnimator->animate(this);
     }
 
-    outobj->triggerOverlayActiveState();
-    std::copy(atoms, atoms + numAtoms, lastValue);
-    lastNumArgs = numAtoms;
-    lastSelector = symbol;
+    if (outobj)
+        outobj->triggerOverlayActiveState();
 }
@@ -16,6 +16,8 @@
 #include "Pd/MessageListener.h"
 #include "Utility/RateReducer.h"
 #include "Utility/ModifierKeyListener.h"
+#include "Utility/ConnectionPathPlanner.h"
+#include "Utility/FrameScheduler.h"
 #include "NVGSurface.h"
 #include "LookAndFeel.h"
 
@@ -25,9 +27,7 @@ class Canvas;
 class Connection : public DrawablePath
     , public ComponentListener
     , public ChangeListener
-    , public pd::MessageListener
-    , public NVGComponent
-    , public MultiTimer {
+    , public NVGComponent {
 public:
     int inIdx;
     int outIdx;
@@ -76,7 +76,7 @@ public:
 
     void reconnect(Iolet* target);
 
-    bool intersects(Rectangle<float> toCheck, int accuracy = 4) const;
+    bool intersects(Rectangle<float> toCheck) const;
     int getClosestLineIdx(Point<float> const& position, PathPlan const& plan);
 
     void setPointer(t_outconnect* ptr);
@@ -89,31 +89,27 @@ public:
     void componentMovedOrResized(Component& component, bool wasMoved, bool wasResized) override;
 
     // Pathfinding
-    int findLatticePaths(PathPlan& bestPath, PathPlan& pathStack, Point<float> start, Point<float> end, Point<float> increment);
+    ConnectionPathPlanner::Request getPathRequest();
 
     void findPath();
 
     void applyBestPath();
 
-    bool straightLineIntersectsObject(Line<float> toCheck, Array<Object*>& objects);
+    void applyPathPlan(PathPlan const& bestPath);
 
-    void receiveMessage(t_symbol* symbol, pd::Atom const atoms[8], int numAtoms) override;
+    // Checks if messages went through since the last frame, and shows that on the overlays
+    void updateActivity();
 
     bool isSelected() const;
 
     bool isMouseHovering() const { return isHovering; };
 
     StringArray getMessageFormated();
-    int getSignalData(t_float* output, int maxChannels);
-
-private:
-    enum Timer { StopAnimation,
-        Animation };
-
-    void timerCallback(int ID) override;
 
+    // Moves the activity dashes one step, called by the ConnectionAnimator
     void animate();
 
+private:
     int getMultiConnectNumber();
     int getNumSignalChannels();
     int getNumberOfConnections();
@@ -124,6 +120,18 @@ private:
 
     const float getPathWidth();
 
+    // The path as straight lines, each with its own bounds, so hit-testing only has to look at the lines that are close
+    // Built the first time it's needed after the path changed, so moving a lot of connections at once doesn't flatten them all
+    struct FlattenedSegment {
+        Line<float> line;
+        Rectangle<float> bounds;
+    };
+    std::vector<FlattenedSegment> const& getFlattenedPath() const;
+    bool isNearPath(Point<float> position, float maxDistance) const;
+
+    mutable std::vector<FlattenedSegment> flattenedPath;
+    mutable bool flattenedPathIsValid = false;
+
     Array<SafePointer<Connection>> reconnecting;
     Rectangle<float> startReconnectHandle, endReconnectHandle;
 
@@ -164,6 +172,7 @@ private:
     pd::Atom lastValue[8];
     int lastNumArgs = 0;
     t_symbol* lastSelector = nullptr;
+    uint32 lastActivityCount = 0;
 
     float offset = 0.0f;
     float pathLength = 0.0f;
@@ -311,6 +320,29 @@ public:
     RateReducer rateReducer = RateReducer(90);
 };
 
+// Drives the activity animation of all connections in a canvas from the frame scheduler
+// Only connections that are animating are in the list, and while none are, it doesn't get polled at all
+class ConnectionAnimator : public FrameScheduler::Poller {
+    Canvas* canvas;
+
+    struct AnimatingConnection {
+        Component::SafePointer<Connection> connection;
+        uint32 stopTime;
+    };
+    std::vector<AnimatingConnection> animating;
+
+    void pollFrame() override;
+
+public:
+    explicit ConnectionAnimator(Canvas* cnv)
+        : canvas(cnv)
+    {
+    }
+
+    // Keeps the connection animating for a little while, or starts it
+    void animate(Connection* connection);
+};
+
 // Helper class to group connection path changes together into undoable/redoable actions
 class ConnectionPathUpdater : public Timer {
     Canvas* canvas;
@@ -343,6 +343,7 @@ enum CommandIDs {
     ShowHelp,
     OpenObjectBrowser,
     ToggleDSP,
+    ToggleFrameProfiler,
     NumItems
 };
 
@@ -406,7 +407,8 @@ enum Overlay {
     ConnectionActivity = 1 << 5,
     Order = 1 << 6,
     Direction = 1 << 7,
-    Behind = 1 << 8
+    Behind = 1 << 8,
+    DSPLoad = 1 << 9
 };
 
 enum Align {
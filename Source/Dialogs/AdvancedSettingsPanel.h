@@ -5,6 +5,10 @@
  */
 #include "LookAndFeel.h"
 #include "Utility/Autosave.h"
+#include "Utility/TraceRecorder.h"
+#include "Utility/LockProfiler.h"
+#include "Utility/StartupProfiler.h"
+#include "Pd/ExprCompiler.h"
 #pragma once
 
 class AdvancedSettingsPanel : public SettingsDialogPanel
@@ -129,9 +133,72 @@ public:
         patchDownwardsOnly = settingsFile->getPropertyAsValue("patch_downwards_only");
         otherProperties.add(new PropertiesPanel::BoolComponent("Patch downwards only", patchDownwardsOnly, { "No", "Yes" }));
 
+        multiCoreDSP.referTo(settingsFile->getPropertyAsValue("multicore_dsp"));
+        multiCoreDSP.addListener(this);
+        otherProperties.add(new PropertiesPanel::BoolComponent("Run parallel patches on multiple cores", multiCoreDSP, { "No", "Yes" }));
+
+        smoothDSPRebuilds.referTo(settingsFile->getPropertyAsValue("smooth_dsp_rebuild"));
+        smoothDSPRebuilds.addListener(this);
+        otherProperties.add(new PropertiesPanel::BoolComponent("Fade around DSP rebuilds instead of waiting", smoothDSPRebuilds, { "No", "Yes" }));
+
+        compileExpr.referTo(settingsFile->getPropertyAsValue("compile_expr"));
+        compileExpr.addListener(this);
+        otherProperties.add(new PropertiesPanel::BoolComponent("Compile expr~ expressions", compileExpr, { "No", "Yes" }));
+
+        // Read once when plugdata is loaded, hosts don't expect the number of parameters to change
+        fixedParameterCount = settingsFile->getPropertyAsValue("fixed_parameter_count");
+        otherProperties.add(new PropertiesPanel::BoolComponent("Always give the host 512 parameters", fixedParameterCount, { "No", "Yes" }));
+
+        if (ProjectInfo::isFx) {
+            sleepWhenSilent.referTo(settingsFile->getPropertyAsValue("sleep_when_silent"));
+            sleepWhenSilent.addListener(this);
+            otherProperties.add(new PropertiesPanel::BoolComponent("Stop DSP when input is silent", sleepWhenSilent, { "No", "Yes" }));
+        }
+
+        // Not saved in the settings, recording is only meant to run while reproducing a problem
+        Array<PropertiesPanelProperty*> diagnosticsProperties;
+        recordTrace = TraceRecorder::isRecording();
+        recordTrace.addListener(this);
+        diagnosticsProperties.add(new PropertiesPanel::BoolComponent("Record performance trace", recordTrace, { "No", "Yes" }));
+        diagnosticsProperties.add(new PropertiesPanel::ActionComponent([editor]() {
+            if (auto* pluginEditor = dynamic_cast<PluginEditor*>(editor))
+                pluginEditor->pd->printMemoryReport();
+        },
+            Icons::Console, "Print memory report"));
+
+        profileLocks = LockProfiler::isEnabled();
+        profileLocks.addListener(this);
+        diagnosticsProperties.add(new PropertiesPanel::BoolComponent("Measure lock contention", profileLocks, { "No", "Yes" }));
+        diagnosticsProperties.add(new PropertiesPanel::ActionComponent([editor]() {
+            if (auto* pluginEditor = dynamic_cast<PluginEditor*>(editor)) {
+                pluginEditor->pd->logMessage("Lock contention report:");
+                for (auto const& line : LockProfiler::getReport())
+                    pluginEditor->pd->logMessage(line);
+            }
+        },
+            Icons::Console, "Print lock contention report"));
+
+        diagnosticsProperties.add(new PropertiesPanel::ActionComponent([editor]() {
+            if (auto* pluginEditor = dynamic_cast<PluginEditor*>(editor)) {
+                pluginEditor->pd->logMessage("Startup times of the last launches:");
+                for (auto const& line : StartupProfiler::getReport())
+                    pluginEditor->pd->logMessage(line);
+            }
+        },
+            Icons::Console, "Print startup times"));
+        diagnosticsProperties.add(new PropertiesPanel::ActionComponent([]() {
+            // To attach to a bug report
+            auto startupFile = ProjectInfo::appDataDir.getChildFile("Traces").getChildFile("startup-" + Time::getCurrentTime().formatted("%Y-%m-%d_%H-%M-%S") + ".json");
+            startupFile.getParentDirectory().createDirectory();
+            if (StartupProfiler::exportTo(startupFile))
+                startupFile.revealToUser();
+        },
+            Icons::Save, "Export startup times"));
+
         propertiesPanel.addSection("Interface", interfaceProperties);
         propertiesPanel.addSection("Autosave", autosaveProperties);
         propertiesPanel.addSection("Other", otherProperties);
+        propertiesPanel.addSection("Diagnostics", diagnosticsProperties);
 
         addAndMakeVisible(propertiesPanel);
     }
@@ -173,6 +240,40 @@ public:
             SettingsFile::getInstance()->setProperty("default_zoom", zoom);
             defaultZoom = zoom;
         }
+        if (v.refersToSameSourceAs(multiCoreDSP)) {
+            if (auto* pluginEditor = dynamic_cast<PluginEditor*>(editor)) {
+                pluginEditor->pd->setMultiCoreDSP(getValue<bool>(multiCoreDSP));
+            }
+        }
+        if (v.refersToSameSourceAs(smoothDSPRebuilds)) {
+            if (auto* pluginEditor = dynamic_cast<PluginEditor*>(editor)) {
+                pluginEditor->pd->setSmoothDSPRebuilds(getValue<bool>(smoothDSPRebuilds));
+            }
+        }
+        if (v.refersToSameSourceAs(compileExpr)) {
+            pd::ExprCompiler::setEnabled(getValue<bool>(compileExpr));
+        }
+        if (v.refersToSameSourceAs(sleepWhenSilent)) {
+            if (auto* pluginEditor = dynamic_cast<PluginEditor*>(editor)) {
+                pluginEditor->pd->setSleepWhenSilent(getValue<bool>(sleepWhenSilent));
+            }
+        }
+        if (v.refersToSameSourceAs(profileLocks)) {
+            LockProfiler::setEnabled(getValue<bool>(profileLocks));
+        }
+        if (v.refersToSameSourceAs(recordTrace)) {
+            if (getValue<bool>(recordTrace)) {
+                TraceRecorder::startRecording();
+            } else if (TraceRecorder::isRecording()) {
+                TraceRecorder::stopRecording();
+
+                // Open the trace in ui.perfetto.dev or chrome://tracing
+                auto traceFile = ProjectInfo::appDataDir.getChildFile("Traces").getChildFile("trace-" + Time::getCurrentTime().formatted("%Y-%m-%d_%H-%M-%S") + ".json");
+                traceFile.getParentDirectory().createDirectory();
+                if (TraceRecorder::writeTo(traceFile))
+                    traceFile.revealToUser();
+            }
+        }
     }
     Component* editor;
 
@@ -191,6 +292,13 @@ public:
     Value autosaveEnabled;
 
     Value patchDownwardsOnly;
+    Value multiCoreDSP;
+    Value sleepWhenSilent;
+    Value smoothDSPRebuilds;
+    Value compileExpr;
+    Value fixedParameterCount;
+    Value recordTrace;
+    Value profileLocks;
 
     PropertiesPanel propertiesPanel;
 
@@ -116,12 +116,126 @@ private:
     TextButton four = TextButton("3db");
 };
 
+class OversampleQualitySettings : public Component {
+public:
+    std::function<void(int)> onChange = [](int) {};
+
+    explicit OversampleQualitySettings(int currentSelection)
+    {
+        fast.setConnectedEdges(Button::ConnectedOnRight);
+        steep.setConnectedEdges(Button::ConnectedOnLeft | Button::ConnectedOnRight);
+        linear.setConnectedEdges(Button::ConnectedOnLeft);
+
+        fast.setTooltip("IIR filters with the lowest latency");
+        steep.setTooltip("Steeper IIR filters, uses more CPU");
+        linear.setTooltip("Linear phase FIR filters, adds the most latency");
+
+        auto buttons = Array<TextButton*> { &fast, &steep, &linear };
+
+        int i = 0;
+        for (auto* button : buttons) {
+            button->setRadioGroupId(hash("oversampling_quality_selector"));
+            button->setClickingTogglesState(true);
+            button->onClick = [this, i]() {
+                onChange(i);
+            };
+
+            button->setColour(TextButton::textColourOffId, findColour(PlugDataColour::popupMenuTextColourId));
+            button->setColour(TextButton::textColourOnId, findColour(PlugDataColour::popupMenuTextColourId));
+            button->setColour(TextButton::buttonColourId, findColour(PlugDataColour::popupMenuBackgroundColourId).contrasting(0.04f));
+            button->setColour(TextButton::buttonOnColourId, findColour(PlugDataColour::popupMenuBackgroundColourId).contrasting(0.075f));
+            button->setColour(ComboBox::outlineColourId, Colours::transparentBlack);
+
+            addAndMakeVisible(button);
+            i++;
+        }
+
+        buttons[std::clamp(currentSelection, 0, 2)]->setToggleState(true, dontSendNotification);
+
+        setSize(180, 50);
+    }
+
+private:
+    void resized() override
+    {
+        auto b = getLocalBounds().reduced(4, 4);
+        auto buttonWidth = b.getWidth() / 3;
+
+        fast.setBounds(b.removeFromLeft(buttonWidth));
+        steep.setBounds(b.removeFromLeft(buttonWidth).expanded(1, 0));
+        linear.setBounds(b.removeFromLeft(buttonWidth).expanded(1, 0));
+    }
+
+    TextButton fast = TextButton("Fast");
+    TextButton steep = TextButton("Steep");
+    TextButton linear = TextButton("Linear");
+};
+
+// Throughput mode: lets pd run several blocks per engine block, so messages and MIDI are only handled once every 256 or 512 samples
+class EngineBlockSizeSettings : public Component {
+
+public:
+    std::function<void(int)> onChange = [](int) {};
+
+    explicit EngineBlockSizeSettings(int currentBlockSize)
+    {
+        normal.setConnectedEdges(Button::ConnectedOnRight);
+        medium.setConnectedEdges(Button::ConnectedOnLeft | Button::ConnectedOnRight);
+        large.setConnectedEdges(Button::ConnectedOnLeft);
+
+        normal.setTooltip("Handle messages every 64 samples, like regular pd");
+        medium.setTooltip("Handle messages every 256 samples, for faster mixdowns");
+        large.setTooltip("Handle messages every 512 samples, for the fastest mixdowns and offline rendering");
+
+        auto buttons = Array<TextButton*> { &normal, &medium, &large };
+        auto blockSizes = Array<int> { 64, 256, 512 };
+
+        for (int i = 0; i < buttons.size(); i++) {
+            auto* button = buttons[i];
+            button->setRadioGroupId(hash("engine_block_size_selector"));
+            button->setClickingTogglesState(true);
+            button->onClick = [this, blockSize = blockSizes[i]]() {
+                onChange(blockSize);
+            };
+
+            button->setColour(TextButton::textColourOffId, findColour(PlugDataColour::popupMenuTextColourId));
+            button->setColour(TextButton::textColourOnId, findColour(PlugDataColour::popupMenuTextColourId));
+            button->setColour(TextButton::buttonColourId, findColour(PlugDataColour::popupMenuBackgroundColourId).contrasting(0.04f));
+            button->setColour(TextButton::buttonOnColourId, findColour(PlugDataColour::popupMenuBackgroundColourId).contrasting(0.075f));
+            button->setColour(ComboBox::outlineColourId, Colours::transparentBlack);
+
+            addAndMakeVisible(button);
+        }
+
+        buttons[std::max(0, blockSizes.indexOf(currentBlockSize))]->setToggleState(true, dontSendNotification);
+
+        setSize(180, 50);
+    }
+
+private:
+    void resized() override
+    {
+        auto b = getLocalBounds().reduced(4, 4);
+        auto buttonWidth = b.getWidth() / 3;
+
+        normal.setBounds(b.removeFromLeft(buttonWidth));
+        medium.setBounds(b.removeFromLeft(buttonWidth).expanded(1, 0));
+        large.setBounds(b.removeFromLeft(buttonWidth).expanded(1, 0));
+    }
+
+    TextButton normal = TextButton("64");
+    TextButton medium = TextButton("256");
+    TextButton large = TextButton("512");
+};
+
 class AudioOutputSettings : public Component {
 
 public:
     AudioOutputSettings(PluginProcessor* pd)
         : limiterSettings(SettingsFile::getInstance()->getProperty<int>("limiter_threshold"))
         , oversampleSettings(SettingsFile::getInstance()->getProperty<int>("oversampling"))
+        , oversampleQualitySettings(SettingsFile::getInstance()->getProperty<int>("oversampling_quality"))
+        , engineBlockSizeSettings(SettingsFile::getInstance()->getProperty<int>("engine_block_size"))
     {
         addAndMakeVisible(limiterSettings);
         limiterSettings.onChange = [pd](int value) {
@@ -133,7 +247,17 @@ public:
             pd->setOversampling(value);
         };
 
-        setSize(170, 125);
+        addAndMakeVisible(oversampleQualitySettings);
+        oversampleQualitySettings.onChange = [pd](int value) {
+            pd->setOversamplingQuality(value);
+        };
+
+        addAndMakeVisible(engineBlockSizeSettings);
+        engineBlockSizeSettings.onChange = [pd](int value) {
+            pd->setEngineBlockSize(value);
+        };
+
+        setSize(170, 245);
     }
 
     ~AudioOutputSettings()
@@ -149,6 +273,12 @@ public:
 
         bounds.removeFromTop(32);
         oversampleSettings.setBounds(bounds.removeFromTop(28));
+
+        bounds.removeFromTop(32);
+        oversampleQualitySettings.setBounds(bounds.removeFromTop(28));
+
+        bounds.removeFromTop(32);
+        engineBlockSizeSettings.setBounds(bounds.removeFromTop(28));
     }
 
     void paint(Graphics& g) override
@@ -166,6 +296,20 @@ public:
 
         g.setColour(findColour(PlugDataColour::toolbarOutlineColourId));
         g.drawLine(4, 84, getWidth() - 8, 84);
+
+        g.setColour(findColour(PlugDataColour::popupMenuTextColourId));
+        g.setFont(Fonts::getBoldFont().withHeight(15));
+        g.drawText("Oversampling Quality", 0, 116, getWidth(), 24, Justification::centred);
+
+        g.setColour(findColour(PlugDataColour::toolbarOutlineColourId));
+        g.drawLine(4, 144, getWidth() - 8, 144);
+
+        g.setColour(findColour(PlugDataColour::popupMenuTextColourId));
+        g.setFont(Fonts::getBoldFont().withHeight(15));
+        g.drawText("Engine Block Size", 0, 176, getWidth(), 24, Justification::centred);
+
+        g.setColour(findColour(PlugDataColour::toolbarOutlineColourId));
+        g.drawLine(4, 204, getWidth() - 8, 204);
     }
 
     static void show(PluginEditor* editor, Rectangle<int> bounds)
@@ -184,4 +328,6 @@ private:
 
     LimiterSettings limiterSettings;
     OversampleSettings oversampleSettings;
+    OversampleQualitySettings oversampleQualitySettings;
+    EngineBlockSizeSettings engineBlockSizeSettings;
 };
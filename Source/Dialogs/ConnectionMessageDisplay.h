@@ -32,9 +32,10 @@ public:
         setBufferedToImage(true);
     }
 
-    ~ConnectionMessageDisplay()
-        override
-        = default;
+    ~ConnectionMessageDisplay() override
+    {
+        setSignalTap(nullptr);
+    }
         
 
     // Activate the current connection info display overlay, to hide give it a nullptr
@@ -46,8 +47,6 @@ public:
             return;
 
         auto clearSignalDisplayBuffer = [this]() {
-            SignalBlock sample;
-            while (sampleQueue.try_dequeue(sample)) { }
             for (int ch = 0; ch < 8; ch++) {
                 std::fill(lastSamples[ch], lastSamples[ch] + signalBlockSize, 0.0f);
                 cycleLength[ch] = 0.0f;
@@ -64,11 +63,11 @@ public:
             stopTimer(MouseHoverExitDelay);
             if (isSignalDisplay) {
                 clearSignalDisplayBuffer();
-                auto* pd = activeConnection->outobj->cnv->pd;
-                pd->connectionListener = this;
+                setSignalTap(activeConnection.getComponent());
                 startTimer(RepaintTimer, 1000 / 5);
                 updateSignalGraph();
             } else {
+                setSignalTap(nullptr);
                 startTimer(RepaintTimer, 1000 / 60);
                 updateTextString(true);
             }
@@ -81,18 +80,22 @@ public:
         }
     }
 
-    void updateSignalData()
+private:
+    // Subscribes to the signal that goes through the connection, the audio thread collects it for us in blocks of signalBlockSize samples
+    void setSignalTap(Connection* connection)
     {
-        if (!activeConnection)
-            return;
+        if (signalTap) {
+            signalTapBus->unsubscribe(signalTap);
+            signalTap = nullptr;
+            signalTapBus = nullptr;
+        }
 
-        float output[DEFDACBLKSIZE * 8];
-        if (auto numChannels = activeConnection->getSignalData(output, 8)) {
-            sampleQueue.try_enqueue(SignalBlock(output, numChannels));
+        if (connection) {
+            signalTapBus = connection->outobj->cnv->pd->signalTaps.get();
+            signalTap = signalTapBus->subscribe(connection->getPointer(), pd::SignalTapBus::readConnection, signalBlockSize);
         }
     }
 
-private:
     void updateTextString(bool isHoverEntered = false)
     {
         messageItemsWithFormat.clear();
@@ -168,16 +171,11 @@ private:
     void updateSignalGraph()
     {
         if (activeConnection) {
-            int i = 0;
-            SignalBlock block;
-            while (sampleQueue.try_dequeue(block)) {
-                if (i < numBlocks) {
-                    lastNumChannels = std::min(block.numChannels, 7);
-                    for (int ch = 0; ch < lastNumChannels; ch++) {
-                        std::copy(block.samples + ch * DEFDACBLKSIZE, block.samples + ch * DEFDACBLKSIZE + DEFDACBLKSIZE, lastSamples[ch] + (i * DEFDACBLKSIZE));
-                    }
+            if (auto const* snapshot = signalTap ? signalTap->getNewSnapshot() : nullptr) {
+                lastNumChannels = std::min(snapshot->numChannels, 7);
+                for (int ch = 0; ch < lastNumChannels; ch++) {
+                    std::copy_n(snapshot->getChannel(ch), snapshot->numSamples, lastSamples[ch]);
                 }
-                i++;
             }
 
             auto newBounds = Rectangle<int>(130, jmap<int>(lastNumChannels, 1, 8, 50, 150));
@@ -188,10 +186,7 @@ private:
 
     void hideDisplay()
     {
-        if (activeConnection) {
-            auto* pd = activeConnection->outobj->cnv->pd;
-            pd->connectionListener = nullptr;
-        }
+        setSignalTap(nullptr);
         stopTimer(RepaintTimer);
         setVisible(false);
         activeConnection = nullptr;
@@ -373,42 +368,11 @@ private:
         MouseHoverExitDelay };
     Rectangle<int> constrainedBounds = { 0, 0, 0, 0 };
 
-    struct SignalBlock {
-        SignalBlock()
-            : numChannels(0)
-        {
-        }
-
-        SignalBlock(float const* input, int channels)
-            : numChannels(channels)
-        {
-            std::copy(input, input + (numChannels * DEFDACBLKSIZE), samples);
-        }
-
-        SignalBlock(SignalBlock&& toMove) noexcept
-        {
-            numChannels = toMove.numChannels;
-            std::copy(toMove.samples, toMove.samples + (numChannels * DEFDACBLKSIZE), samples);
-        }
-
-        SignalBlock& operator=(SignalBlock&& toMove) noexcept
-        {
-            if (&toMove != this) {
-                numChannels = toMove.numChannels;
-                std::copy(toMove.samples, toMove.samples + (numChannels * DEFDACBLKSIZE), samples);
-            }
-            return *this;
-        }
-
-        float samples[32 * DEFDACBLKSIZE];
-        int numChannels;
-    };
-
     Image oscilloscopeImage;
     static constexpr int signalBlockSize = 1024;
-    static constexpr int numBlocks = 1024 / 64;
-    // 32*64 samples gives us space for 1024 samples across 8 channels
-    moodycamel::ReaderWriterQueue<SignalBlock> sampleQueue = moodycamel::ReaderWriterQueue<SignalBlock>(numBlocks);
+
+    pd::SignalTapBus* signalTapBus = nullptr;
+    pd::SignalTapBus::Tap* signalTap = nullptr;
 
     float cycleLength[8] = { 0.0f };
     float lastSamples[8][1024] = { { 0.0f } };
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <condition_variable>
+
 struct Spinner : public Component
     , public Timer {
 
@@ -82,24 +84,12 @@ public:
         PackageManager& manager;
         PackageInfo packageInfo;
 
-        std::unique_ptr<InputStream> instream;
-
         DownloadTask(PackageManager& m, PackageInfo& info)
             : Thread("Download Thread")
             , manager(m)
             , packageInfo(info)
         {
-            int statusCode = 0;
-            instream = URL(info.url).createInputStream(URL::InputStreamOptions(URL::ParameterHandling::inAddress)
-                                                           .withConnectionTimeoutMs(10000)
-                                                           .withStatusCode(&statusCode));
-
-            if (instream != nullptr && statusCode == 200) {
-                startThread();
-            } else {
-                finish(Result::fail("Failed to start download"));
-                return;
-            }
+            startThread();
         }
 
         ~DownloadTask() override
@@ -109,44 +99,39 @@ public:
 
         void run() override
         {
-            MemoryBlock dekData;
+            // The archive is downloaded to a hidden file next to the packages, if a download gets interrupted, that file is kept
+            // The next attempt then only asks the server for the part we don't have yet
+            auto const partialFile = filesystem.getChildFile("." + String::toHexString(packageInfo.packageId.hashCode64()) + ".part");
+
+            for (int attempt = 0;; attempt++) {
+                auto result = download(partialFile);
+                if (result.wasOk())
+                    break;
 
-            int64 totalBytes = instream->getTotalLength();
-            int64 bytesDownloaded = 0;
+                if (threadShouldExit() || attempt >= maxRetries) {
+                    finish(result);
+                    return;
+                }
 
-            MemoryOutputStream mo(dekData, true);
+                wait(1000 * (attempt + 1));
+            }
 
-            while (true) {
+            // Only a few packages get extracted at once, since it's mostly bound by the disk. Other downloads continue in the meantime
+            while (!extractionSlots.tryAcquireFor(std::chrono::milliseconds(100))) {
                 if (threadShouldExit()) {
                     finish(Result::fail("Download cancelled"));
                     return;
                 }
-
-                auto written = mo.writeFromInputStream(*instream, 8192);
-
-                if (written == 0)
-                    break;
-
-                bytesDownloaded += written;
-
-                float progress = static_cast<long double>(bytesDownloaded) / static_cast<long double>(totalBytes);
-
-                MessageManager::callAsync([this, progress]() mutable {
-                    onProgress(progress);
-                });
             }
 
-            MemoryInputStream input(dekData, false);
-            ZipFile zip(input);
-
-            /* This check produces false positives sometimes, so I've disabled it
-             if (zip.getNumEntries() == 0) {
-             finish(Result::fail("The downloaded file was not a valid Deken package"));
-             return;
-             } */
-
+            /* ZipFile::getNumEntries() == 0 produces false positives sometimes, so we don't check if it's a valid Deken package */
             auto extractedPath = filesystem.getChildFile(packageInfo.name).getFullPathName();
-            auto result = zip.uncompressTo(filesystem);
+            auto result = ZipFile(partialFile).uncompressTo(filesystem);
+            extractionSlots.release();
+
+            // If it was broken, the next attempt starts over
+            partialFile.deleteFile();
+            getValidatorFile(partialFile).deleteFile();
 
             if (!result.wasOk()) {
                 finish(result);
@@ -159,21 +144,138 @@ public:
             finish(Result::ok());
         }
 
+        // The ETag or Last-Modified date of the archive that partialFile is part of
+        static File getValidatorFile(File const& partialFile)
+        {
+            return partialFile.withFileExtension("validator");
+        }
+
+        // Appends the rest of the archive to partialFile
+        Result download(File const& partialFile)
+        {
+            auto const validatorFile = getValidatorFile(partialFile);
+            auto const validator = validatorFile.loadFileAsString().trim();
+
+            // Without a way to tell if the archive changed on the server, we can't continue where we left off
+            auto const resumeFrom = validator.isNotEmpty() ? partialFile.getSize() : 0;
+
+            int statusCode = 0;
+            StringPairArray responseHeaders;
+            auto options = URL::InputStreamOptions(URL::ParameterHandling::inAddress)
+                               .withConnectionTimeoutMs(10000)
+                               .withStatusCode(&statusCode)
+                               .withResponseHeaders(&responseHeaders);
+
+            // If-Range makes the server send the whole archive again if it's not the one we have a part of
+            if (resumeFrom > 0)
+                options = options.withExtraHeaders("Range: bytes=" + String(resumeFrom) + "-\r\nIf-Range: " + validator);
+
+            auto instream = URL(packageInfo.url).createInputStream(options);
+            if (instream == nullptr || (statusCode != 200 && statusCode != 206))
+                return Result::fail("Failed to start download");
+
+            // Servers that don't support ranges send the whole file again
+            auto const bytesAlreadyDownloaded = statusCode == 206 ? resumeFrom : 0;
+            if (bytesAlreadyDownloaded == 0) {
+                partialFile.deleteFile();
+
+                // Weak ETags can't be used for ranges
+                auto newValidator = responseHeaders["ETag"].trim();
+                if (newValidator.isEmpty() || newValidator.startsWith("W/"))
+                    newValidator = responseHeaders["Last-Modified"].trim();
+
+                if (newValidator.isNotEmpty())
+                    validatorFile.replaceWithText(newValidator);
+                else
+                    validatorFile.deleteFile();
+            }
+
+            FileOutputStream output(partialFile);
+            if (!output.openedOk())
+                return Result::fail("Couldn't write to " + partialFile.getFullPathName());
+
+            auto const streamLength = instream->getTotalLength();
+            auto const totalBytes = bytesAlreadyDownloaded + streamLength;
+            auto bytesDownloaded = bytesAlreadyDownloaded;
+
+            while (true) {
+                if (threadShouldExit())
+                    return Result::fail("Download cancelled");
+
+                auto written = output.writeFromInputStream(*instream, 8192);
+
+                if (written <= 0)
+                    break;
+
+                bytesDownloaded += written;
+
+                if (totalBytes > 0) {
+                    float progress = static_cast<long double>(bytesDownloaded) / static_cast<long double>(totalBytes);
+
+                    MessageManager::callAsync([this, progress]() mutable {
+                        if (onProgress)
+                            onProgress(progress);
+                    });
+                }
+            }
+
+            output.flush();
+
+            if (streamLength >= 0 && bytesDownloaded < totalBytes)
+                return Result::fail("Download was interrupted");
+
+            return Result::ok();
+        }
+
         void finish(Result result)
         {
             MessageManager::callAsync(
-                [this, result, finishCopy = onFinish]() mutable {
+                [this, result]() mutable {
                     waitForThreadToExit(-1);
 
+                    // The row can attach to the download after it started, so only look at the callback now
+                    auto finishCopy = onFinish;
+
                     // Self-destruct
                     manager.downloads.removeObject(this);
 
-                    finishCopy(result);
+                    if (finishCopy)
+                        finishCopy(result);
                 });
         }
 
         std::function<void(float)> onProgress;
         std::function<void(Result)> onFinish;
+
+        static constexpr int maxRetries = 3;
+
+        // std::counting_semaphore isn't available on older macOS versions
+        struct ExtractionSlots {
+            bool tryAcquireFor(std::chrono::milliseconds timeout)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!available.wait_for(lock, timeout, [this] { return numFree > 0; }))
+                    return false;
+
+                numFree--;
+                return true;
+            }
+
+            void release()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    numFree++;
+                }
+                available.notify_one();
+            }
+
+            std::mutex mutex;
+            std::condition_variable available;
+            int numFree = 2;
+        };
+
+        static inline ExtractionSlots extractionSlots;
     };
 
     PackageManager()
@@ -228,17 +330,51 @@ public:
         auto triplet = os + "-" + machine + "-" + floatsize;
         auto repoForArchitecture = "https://raw.githubusercontent.com/plugdata-team/plugdata-deken/main/bin/" + triplet + ".bin";
 
+        // The last index we got is kept on disk, together with its ETag and Last-Modified headers
+        // The server then only has to send it again if it changed, and without a connection, we can still show the packages we know of
+        auto const cacheFile = filesystem.getChildFile(".index-" + triplet + ".bin");
+        auto const cacheHeadersFile = filesystem.getChildFile(".index-" + triplet + ".headers");
+        auto cacheHeaders = StringArray::fromLines(cacheHeadersFile.loadFileAsString());
+        cacheHeaders.removeEmptyStrings();
+
+        String requestHeaders;
+        if (cacheFile.existsAsFile()) {
+            for (auto const& line : cacheHeaders) {
+                if (line.startsWithIgnoreCase("ETag:"))
+                    requestHeaders << "If-None-Match:" << line.fromFirstOccurrenceOf(":", false, false) << "\r\n";
+                else if (line.startsWithIgnoreCase("Last-Modified:"))
+                    requestHeaders << "If-Modified-Since:" << line.fromFirstOccurrenceOf(":", false, false) << "\r\n";
+            }
+        }
+
         webstream = std::make_unique<WebInputStream>(URL(repoForArchitecture), false);
+        webstream->withExtraHeaders(requestHeaders);
         webstream->connect(nullptr);
 
-        if (webstream->isError()) {
+        auto const statusCode = webstream->isError() ? 0 : webstream->getStatusCode();
+
+        MemoryBlock block;
+        if (statusCode == 200) {
+            webstream->readIntoMemoryBlock(block);
+
+            StringArray newCacheHeaders;
+            auto responseHeaders = webstream->getResponseHeaders();
+            for (auto const* header : { "ETag", "Last-Modified" }) {
+                if (responseHeaders.containsKey(header))
+                    newCacheHeaders.add(String(header) + ": " + responseHeaders[header].trim());
+            }
+
+            cacheFile.replaceWithData(block.getData(), block.getSize());
+            cacheHeadersFile.replaceWithText(newCacheHeaders.joinIntoString("\n"));
+        } else if (statusCode == 304 || cacheFile.existsAsFile()) {
+            cacheFile.loadFileAsData(block);
+        }
+
+        if (block.isEmpty()) {
             sendActionMessage("Failed to connect to server");
             return {};
         }
 
-        MemoryBlock block;
-        webstream->readIntoMemoryBlock(block);
-
         // Parse tree that was downloaded
         auto tree = ValueTree::readFromData(block.getData(), block.getSize());
 
@@ -134,7 +134,7 @@ void Dialogs::appendTextToTextEditorDialog(Component* dialog, String const& text
         return;
 
     auto& editor = dynamic_cast<TextEditorDialog*>(dialog)->editor;
-    editor.setText(editor.getText() + text);
+    editor.appendText(text);
 }
 
 void Dialogs::showAskToSaveDialog(std::unique_ptr<Dialog>* target, Component* centre, String const& filename, std::function<void(int)> callback, int margin, bool withLogo)
@@ -244,6 +244,21 @@ void Dialogs::showMainMenu(PluginEditor* editor, Component* centre)
                 Dialogs::showHeavyExportDialog(&editor->openedDialog, editor);
                 break;
             }
+            case MainMenu::MenuItem::RunCompiled: {
+                auto& preview = editor->pd->heavyPreview;
+                if (preview.isActive()) {
+                    preview.stop();
+                } else if (auto* cnv = editor->getCurrentCanvas()) {
+                    auto searchPaths = editor->pd->getSearchPaths();
+                    auto const patchFile = cnv->patch.getCurrentFile();
+                    if (patchFile.existsAsFile())
+                        searchPaths.insert(0, patchFile.getParentDirectory().getFullPathName());
+
+                    auto const sampleRate = editor->pd->getSampleRate() * (1 << editor->pd->oversampling);
+                    preview.start(cnv->patch.getCanvasContent(), searchPaths, sampleRate);
+                }
+                break;
+            }
             case MainMenu::MenuItem::FindExternals: {
                 Dialogs::showDeken(editor);
                 break;
@@ -172,9 +172,7 @@ public:
         // auto sidebarBounds = b.removeFromLeft(200);
 
         if (ProjectInfo::canUseSemiTransparentWindows()) {
-            auto shadowPath = Path();
-            shadowPath.addRoundedRectangle(getLocalBounds().reduced(20), Corners::windowCornerRadius);
-            StackShadow::renderDropShadow(g, shadowPath, Colour(0, 0, 0).withAlpha(0.6f), 13.0f);
+            StackShadow::renderDropShadow(g, getLocalBounds().reduced(20).toFloat(), Corners::windowCornerRadius, Colour(0, 0, 0).withAlpha(0.6f), 13);
         }
 
         float cornerRadius = ProjectInfo::canUseSemiTransparentWindows() ? Corners::windowCornerRadius : 0.0f;
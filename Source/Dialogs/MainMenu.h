@@ -83,11 +83,42 @@ public:
 
         addCustomItem(getMenuItemID(MenuItem::State), std::unique_ptr<IconMenuItem>(menuItems[getMenuItemIndex(MenuItem::State)]), std::unique_ptr<PopupMenu const>(plugdataState), "Workspace");
 
+        // Without PDINSTANCE, all instances would share pd's global state
+        if (pd::Instance::hasMultipleInstances()) {
+            // Patches that run in their own pd instance, on a DSP worker thread, mixed with the main output
+            // Useful for running several unrelated heavy patches side by side, like the channels of an installation
+            auto parallelPatches = new PopupMenu();
+            parallelPatches->addItem("Open on a separate core...", [editor]() mutable {
+                static auto openChooser = std::make_unique<FileChooser>("Choose patch to run on a separate core", File(SettingsFile::getInstance()->getProperty<String>("last_filechooser_path")), "*.pd", SettingsFile::getInstance()->wantsNativeDialog());
+
+                openChooser->launchAsync(FileBrowserComponent::openMode | FileBrowserComponent::canSelectFiles, [editor](FileChooser const& f) {
+                    auto file = f.getResult();
+                    if (file.existsAsFile())
+                        editor->pd->openParallelPatch(file);
+                });
+            });
+
+            auto runningPatches = editor->pd->getParallelPatches();
+            if (!runningPatches.isEmpty())
+                parallelPatches->addSeparator();
+
+            for (auto const& patchFile : runningPatches) {
+                // Ticked while running, clicking it stops the patch
+                parallelPatches->addItem(patchFile.getFileName(), true, true, [editor, patchFile]() {
+                    editor->pd->closeParallelPatch(patchFile);
+                });
+            }
+
+            addCustomItem(getMenuItemID(MenuItem::Parallel), std::unique_ptr<IconMenuItem>(menuItems[getMenuItemIndex(MenuItem::Parallel)]), std::unique_ptr<PopupMenu const>(parallelPatches), "Separate cores");
+            menuItems[getMenuItemIndex(MenuItem::Parallel)]->isActive = editor->pd->multiCoreDSP.load();
+        }
+
         addSeparator();
 
 #if !JUCE_IOS
         addCustomItem(getMenuItemID(MenuItem::CompiledMode), std::unique_ptr<IconMenuItem>(menuItems[getMenuItemIndex(MenuItem::CompiledMode)]), nullptr, "Compiled mode");
         addCustomItem(getMenuItemID(MenuItem::Compile), std::unique_ptr<IconMenuItem>(menuItems[getMenuItemIndex(MenuItem::Compile)]), nullptr, "Compile...");
+        addCustomItem(getMenuItemID(MenuItem::RunCompiled), std::unique_ptr<IconMenuItem>(menuItems[getMenuItemIndex(MenuItem::RunCompiled)]), nullptr, "Run compiled");
 #endif
 
         addSeparator();
@@ -107,6 +138,10 @@ public:
         menuItems[getMenuItemIndex(MenuItem::SaveAs)]->isActive = hasCanvas;
 
         menuItems[getMenuItemIndex(MenuItem::CompiledMode)]->isTicked = hvccModeEnabled;
+
+        // Runs the current patch compiled with heavy, instead of pd's DSP
+        menuItems[getMenuItemIndex(MenuItem::RunCompiled)]->isTicked = editor->pd->heavyPreview.isActive();
+        menuItems[getMenuItemIndex(MenuItem::RunCompiled)]->isActive = hasCanvas || editor->pd->heavyPreview.isActive();
     }
 
     class IconMenuItem : public PopupMenu::CustomComponent {
@@ -274,8 +309,10 @@ public:
         Save,
         SaveAs,
         State,
+        Parallel,
         CompiledMode,
         Compile,
+        RunCompiled,
         FindExternals,
         Settings,
         About
@@ -303,9 +340,11 @@ public:
         new IconMenuItem(Icons::SaveAs, "Save patch as...", false, false),
 
         new IconMenuItem(Icons::ExportState, "Workspace", true, false),
+        new IconMenuItem(Icons::CPU, "Separate cores", true, false),
 
         new IconMenuItem("", "Compiled mode", false, true),
         new IconMenuItem(Icons::DevTools, "Compile...", false, false),
+        new IconMenuItem("", "Run compiled", false, true),
 
         new IconMenuItem(Icons::Externals, "Find externals...", false, false),
         // new IconMenuItem(Icons::Compass, "Discover...", false, false),
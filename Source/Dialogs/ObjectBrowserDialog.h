@@ -12,6 +12,7 @@
 #include "ObjectReferenceDialog.h"
 #include "Canvas.h"
 #include "Dialogs.h"
+#include "Utility/BackgroundTasks.h"
 
 class CategoriesListBox : public ListBox
     , public ListBoxModel {
@@ -181,7 +182,7 @@ class ObjectsListBox : public ListBox
     std::function<void(bool shouldFade)> dismiss;
 
 public:
-    explicit ObjectsListBox(PluginEditor* editor, pd::Library& library, std::function<void(bool shouldFade)> dismissMenu)
+    explicit ObjectsListBox(PluginEditor* editor, std::function<void(bool shouldFade)> dismissMenu)
         : bouncer(getViewport())
         , dismiss(dismissMenu)
         , editor(editor)
@@ -193,13 +194,11 @@ public:
 
         setColour(ListBox::backgroundColourId, Colours::transparentBlack);
         setColour(ListBox::outlineColourId, Colours::transparentBlack);
+    }
 
-        for (auto const& object : library.getAllObjects()) {
-            auto info = library.getObjectInfo(object);
-            if (info.isValid() && info.hasProperty("name") && info.hasProperty("description")) {
-                descriptions[info.getProperty("name").toString()] = info.getProperty("description").toString();
-            }
-        }
+    void setDescriptions(std::unordered_map<String, String> newDescriptions)
+    {
+        descriptions = std::move(newDescriptions);
     }
 
     int getNumRows() override
@@ -788,26 +787,11 @@ class ObjectBrowserDialog : public Component {
 public:
     ObjectBrowserDialog(Component* pluginEditor, Dialog* parent)
         : editor(dynamic_cast<PluginEditor*>(pluginEditor))
-        , objectsList(editor, *editor->pd->objectLibrary, [this](bool shouldFade) { dismiss(shouldFade); })
+        , objectsList(editor, [this](bool shouldFade) { dismiss(shouldFade); })
         , objectReference(editor, true)
         , objectViewer(editor, objectReference, [this](bool shouldFade) { dismiss(shouldFade); })
         , objectSearch(*editor->pd->objectLibrary)
     {
-        auto& library = *editor->pd->objectLibrary;
-
-        for (auto& object : library.getAllObjects()) {
-            auto info = library.getObjectInfo(object);
-            if (!info.isValid())
-                continue;
-
-            auto categoriesTree = info.getChildWithName("categories");
-
-            for (auto category : categoriesTree) {
-                auto cat = category.getProperty("name").toString();
-                objectsByCategory[cat].add(object);
-            }
-        }
-
         searchButton.setClickingTogglesState(true);
         searchButton.onClick = [this]() {
             if (searchButton.getToggleState()) {
@@ -824,9 +808,65 @@ public:
         addAndMakeVisible(searchButton);
         addChildComponent(objectReference);
 
-        objectsByCategory["All"] = StringArray();
+        categoriesList.changeCallback = [this](String const& category) {
+            objectsList.showObjects(catalogue ? catalogue->objectsByCategory[category] : StringArray());
+        };
+
+        objectsList.changeCallback = [this](String const& object) {
+            objectViewer.showObject(object);
+        };
 
+        objectSearch.changeCallback = [this](String const& object) {
+            objectViewer.showObject(object);
+        };
+
+        // Looking up the documentation for every object takes a while, so do it in the background and fill in the lists when it's done
+        catalogueTasks.addJob("ObjectBrowser::buildCatalogue", [_this = SafePointer(this), library = editor->pd->objectLibrary.get()]() {
+            auto newCatalogue = buildCatalogue(*library);
+            MessageManager::callAsync([_this, newCatalogue]() {
+                if (_this) {
+                    _this->catalogue = newCatalogue;
+                    _this->objectsList.setDescriptions(newCatalogue->descriptions);
+                    _this->categoriesList.initialise(newCatalogue->categories);
+                }
+            });
+        });
+    }
+
+    struct Catalogue {
+        std::unordered_map<String, StringArray> objectsByCategory;
+        std::unordered_map<String, String> descriptions;
         StringArray categories;
+    };
+
+    static std::shared_ptr<Catalogue> buildCatalogue(pd::Library& library)
+    {
+        auto catalogue = std::make_shared<Catalogue>();
+        auto& objectsByCategory = catalogue->objectsByCategory;
+        auto& categories = catalogue->categories;
+
+        library.waitForInitialisationToFinish();
+
+        auto allObjects = library.getAllObjects();
+        for (auto& object : allObjects) {
+            auto info = library.getObjectInfo(object);
+            if (!info.isValid())
+                continue;
+
+            if (info.hasProperty("name") && info.hasProperty("description")) {
+                catalogue->descriptions[info.getProperty("name").toString()] = info.getProperty("description").toString();
+            }
+
+            auto categoriesTree = info.getChildWithName("categories");
+
+            for (auto category : categoriesTree) {
+                auto cat = category.getProperty("name").toString();
+                objectsByCategory[cat].add(object);
+            }
+        }
+
+        objectsByCategory["All"] = StringArray();
+
         for (auto& [category, objects] : objectsByCategory) {
             // Sort alphabetically
             objects.sort(true);
@@ -841,7 +881,7 @@ public:
         }
 
         // Also include undocumented objects
-        objectsByCategory["All"].addArray(library.getAllObjects());
+        objectsByCategory["All"].addArray(allObjects);
         objectsByCategory["All"].removeDuplicates(true);
 
         // First sort alphabetically
@@ -874,19 +914,7 @@ public:
         std::cout << "Percentage done:" << percentage << std::endl;
 #endif */
 
-        categoriesList.changeCallback = [this](String const& category) {
-            objectsList.showObjects(objectsByCategory[category]);
-        };
-
-        objectsList.changeCallback = [this](String const& object) {
-            objectViewer.showObject(object);
-        };
-
-        objectSearch.changeCallback = [this](String const& object) {
-            objectViewer.showObject(object);
-        };
-
-        categoriesList.initialise(categories);
+        return catalogue;
     }
 
     void dismiss(bool shouldFade)
@@ -951,5 +979,6 @@ private:
 
     ComponentAnimator animator;
 
-    std::unordered_map<String, StringArray> objectsByCategory;
+    std::shared_ptr<Catalogue> catalogue;
+    BackgroundTasks::TaskGroup catalogueTasks;
 };
@@ -48,8 +48,9 @@ public:
         if (map.contains(argument)) {
             return map.getReference(argument);
         }
-        map.set(argument, f(argument));
-        return this->operator()(argument);
+        auto value = f(argument);
+        map.set(argument, value);
+        return value;
     }
     FunctionType f;
     mutable HashMap<ArgType, DataType> map;
@@ -232,19 +233,32 @@ private:
 /**
  This class wraps a StringArray and memoizes the evaluation of glyph
  arrangements derived from the associated strings.
+ Lines are stored by pointer, so inserting or removing lines in a long
+ document only moves pointers, and the cached glyphs and tokens of all
+ other lines stay where they are.
  */
 class GlyphArrangementArray {
 public:
     int size() const { return lines.size(); }
     void clear() { lines.clear(); }
-    void add(String const& string) { lines.add(string); }
-    void insert(int index, String const& string) { lines.insert(index, string); }
+    void add(String const& string) { lines.add(new Entry(string)); }
+    void insert(int index, String const& string) { lines.insert(index, new Entry(string)); }
+    void insert(int index, StringArray const& strings);
+    void set(int index, String const& string);
     void removeRange(int startIndex, int numberToRemove) { lines.removeRange(startIndex, numberToRemove); }
     String const& operator[](int index) const;
 
+    /** Return the horizontal extent of a line, laying it out if it hasn't been yet. */
+    Range<float> getHorizontalExtent(int index) const;
+
     int getToken(int row, int col, int defaultIfOutOfBounds) const;
     void clearTokens(int index);
     void applyTokens(int index, Selection zone);
+
+    /** Tokens are only recomputed for lines that changed since they were last applied. */
+    bool tokensAreDirty(Range<int> rows) const;
+    void markTokensClean(Range<int> rows);
+    void invalidateTokensFrom(int index);
     GlyphArrangement getGlyphs(int index,
         float baseline,
         int token,
@@ -268,11 +282,12 @@ private:
         String string;
         GlyphArrangement glyphsWithTrailingSpace;
         GlyphArrangement glyphs;
+        Range<float> extent;
         Array<int> tokens;
         bool glyphsAreDirty = true;
         bool tokensAreDirty = true;
     };
-    mutable Array<Entry> lines;
+    mutable OwnedArray<Entry> lines;
 };
 
 class TextDocument {
@@ -371,6 +386,8 @@ public:
     {
         font = fontToUse;
         lines.font = fontToUse;
+        lines.invalidateAll();
+        cachedBounds = {};
     }
 
     StringArray getText() const;
@@ -378,6 +395,9 @@ public:
     /** Replace the whole document content. */
     void replaceAll(String const& content);
 
+    /** Add text to the end of the document, without touching the lines before it. */
+    void append(String const& content);
+
     /** Replace the list of selections with a new one. */
     void setSelections(Array<Selection> const& newSelections) { selections = newSelections; }
 
@@ -510,6 +530,9 @@ public:
     /** Apply tokens from a set of zones to a range of rows. */
     void applyTokens(Range<int> rows, Array<Selection> const& zones);
 
+    /** Return true if any of these rows changed since tokens were last applied to them. */
+    bool tokensAreDirty(Range<int> rows) const { return lines.tokensAreDirty(rows); }
+
 private:
     friend class PlugDataTextEditor;
 
@@ -584,6 +607,7 @@ public:
     void setFont(Font const& font);
 
     void setText(String const& text);
+    void appendText(String const& text);
     String getText() const;
 
     void translateView(float dx, float dy);
@@ -986,19 +1010,51 @@ void Selection::push(Point<int>& index) const
 String const& GlyphArrangementArray::operator[](int index) const
 {
     if (isPositiveAndBelow(index, lines.size())) {
-        return lines.getReference(index).string;
+        return lines.getUnchecked(index)->string;
     }
 
     static String empty;
     return empty;
 }
 
+void GlyphArrangementArray::insert(int index, StringArray const& strings)
+{
+    Array<Entry*> entries;
+    entries.ensureStorageAllocated(strings.size());
+
+    for (auto const& string : strings) {
+        entries.add(new Entry(string));
+    }
+
+    lines.insertArray(index, entries.getRawDataPointer(), entries.size());
+}
+
+void GlyphArrangementArray::set(int index, String const& string)
+{
+    if (!isPositiveAndBelow(index, lines.size()))
+        return;
+
+    auto* entry = lines.getUnchecked(index);
+    entry->string = string;
+    entry->glyphsAreDirty = true;
+    entry->tokensAreDirty = true;
+}
+
+Range<float> GlyphArrangementArray::getHorizontalExtent(int index) const
+{
+    if (!isPositiveAndBelow(index, lines.size()))
+        return {};
+
+    ensureValid(index);
+    return lines.getUnchecked(index)->extent;
+}
+
 int GlyphArrangementArray::getToken(int row, int col, int defaultIfOutOfBounds) const
 {
     if (!isPositiveAndBelow(row, lines.size())) {
         return defaultIfOutOfBounds;
     }
-    return lines.getReference(row).tokens[col];
+    return lines.getUnchecked(row)->tokens[col];
 }
 
 void GlyphArrangementArray::clearTokens(int index)
@@ -1006,7 +1062,7 @@ void GlyphArrangementArray::clearTokens(int index)
     if (!isPositiveAndBelow(index, lines.size()))
         return;
 
-    auto& entry = lines.getReference(index);
+    auto& entry = *lines.getUnchecked(index);
 
     ensureValid(index);
 
@@ -1020,16 +1076,39 @@ void GlyphArrangementArray::applyTokens(int index, Selection zone)
     if (!isPositiveAndBelow(index, lines.size()))
         return;
 
-    auto& entry = lines.getReference(index);
-    auto range = zone.getColumnRangeOnRow(index, entry.tokens.size());
-
     ensureValid(index);
 
+    auto& entry = *lines.getUnchecked(index);
+    auto range = zone.getColumnRangeOnRow(index, entry.tokens.size());
+
     for (int col = range.getStart(); col < range.getEnd(); ++col) {
         entry.tokens.setUnchecked(col, zone.token);
     }
 }
 
+bool GlyphArrangementArray::tokensAreDirty(Range<int> rows) const
+{
+    for (int n = jmax(0, rows.getStart()); n < jmin(rows.getEnd(), lines.size()); ++n) {
+        if (lines.getUnchecked(n)->tokensAreDirty)
+            return true;
+    }
+    return false;
+}
+
+void GlyphArrangementArray::markTokensClean(Range<int> rows)
+{
+    for (int n = jmax(0, rows.getStart()); n < jmin(rows.getEnd(), lines.size()); ++n) {
+        lines.getUnchecked(n)->tokensAreDirty = false;
+    }
+}
+
+void GlyphArrangementArray::invalidateTokensFrom(int index)
+{
+    for (int n = jmax(0, index); n < lines.size(); ++n) {
+        lines.getUnchecked(n)->tokensAreDirty = true;
+    }
+}
+
 GlyphArrangement GlyphArrangementArray::getGlyphs(int index,
     float baseline,
     int token,
@@ -1045,8 +1124,8 @@ GlyphArrangement GlyphArrangementArray::getGlyphs(int index,
     }
     ensureValid(index);
 
-    auto& entry = lines.getReference(index);
-    auto glyphSource = withTrailingSpace ? entry.glyphsWithTrailingSpace : entry.glyphs;
+    auto const& entry = *lines.getUnchecked(index);
+    auto const& glyphSource = withTrailingSpace ? entry.glyphsWithTrailingSpace : entry.glyphs;
     auto glyphs = GlyphArrangement();
 
     for (int n = 0; n < glyphSource.getNumGlyphs(); ++n) {
@@ -1064,31 +1143,52 @@ void GlyphArrangementArray::ensureValid(int index) const
     if (!isPositiveAndBelow(index, lines.size()))
         return;
 
-    auto& entry = lines.getReference(index);
+    auto& entry = *lines.getUnchecked(index);
 
     if (entry.glyphsAreDirty) {
         entry.tokens.resize(entry.string.length());
+        entry.glyphs.clear();
         entry.glyphs.addLineOfText(font, entry.string, 0.f, 0.f);
+        entry.glyphsWithTrailingSpace.clear();
         entry.glyphsWithTrailingSpace.addLineOfText(font, entry.string + " ", 0.f, 0.f);
+
+        auto box = entry.glyphsWithTrailingSpace.getBoundingBox(0, std::max(1, entry.string.length()), true);
+        entry.extent = Range<float>(box.getX(), box.getRight()) + TEXT_INDENT;
         entry.glyphsAreDirty = !cacheGlyphArrangement;
     }
 }
 
 void GlyphArrangementArray::invalidateAll()
 {
-    for (auto& entry : lines) {
-        entry.glyphsAreDirty = true;
-        entry.tokensAreDirty = true;
+    for (auto* entry : lines) {
+        entry->glyphsAreDirty = true;
+        entry->tokensAreDirty = true;
     }
 }
 
 void TextDocument::replaceAll(String const& content)
 {
+    cachedBounds = {};
+
     lines.clear();
+    lines.insert(0, StringArray::fromLines(content));
+}
+
+void TextDocument::append(String const& content)
+{
+    auto newLines = StringArray::fromLines(content);
+    if (newLines.isEmpty())
+        return;
+
+    cachedBounds = {};
 
-    for (auto const& line : StringArray::fromLines(content)) {
-        lines.add(line);
+    // The first new line continues the last line of the document, like it would with replaceAll(getText() + content)
+    if (lines.size() > 0) {
+        lines.set(lines.size() - 1, lines[lines.size() - 1] + newLines[0]);
+        newLines.remove(0);
     }
+
+    lines.insert(lines.size(), newLines);
 }
 
 StringArray TextDocument::getText() const
@@ -1171,13 +1271,17 @@ Array<Rectangle<float>> TextDocument::getSelectionRegion(Selection selection, Re
 
 Rectangle<float> TextDocument::getBounds() const
 {
-    if (cachedBounds.isEmpty()) {
-        auto bounds = Rectangle<float>();
+    if (cachedBounds.isEmpty() && getNumRows() > 0) {
+        // Only the line widths are needed here, which are cached with the glyphs of every line
+        auto extent = lines.getHorizontalExtent(0);
 
-        for (int n = 0; n < getNumRows(); ++n) {
-            bounds = bounds.getUnion(getBoundsOnRow(n, Range<int>(0, std::max(1, getNumColumns(n)))));
+        for (int n = 1; n < getNumRows(); ++n) {
+            extent = extent.getUnionWith(lines.getHorizontalExtent(n));
         }
-        return cachedBounds = bounds;
+
+        auto top = getVerticalPosition(0, Metric::top);
+        auto bottom = getVerticalPosition(getNumRows() - 1, Metric::bottom);
+        return cachedBounds = Rectangle<float>(extent.getStart(), top, extent.getLength(), bottom - top);
     }
     return cachedBounds;
 }
@@ -1481,14 +1585,18 @@ Transaction TextDocument::fulfill(Transaction const& transaction)
         existingSelection.pushBy(Selection(t.content).startingFrom(s.head));
     }
 
-    lines.removeRange(s.head.x, s.tail.x - s.head.x + 1);
-    int row = s.head.x;
-
+    auto newLines = StringArray::fromLines(M);
     if (M.isEmpty()) {
-        lines.insert(row++, String());
+        newLines.add(String());
     }
-    for (auto const& line : StringArray::fromLines(M)) {
-        lines.insert(row++, line);
+
+    // Replace the affected lines in one go, so the rest of the document is only shifted once
+    lines.removeRange(s.head.x, s.tail.x - s.head.x + 1);
+    lines.insert(s.head.x, newLines);
+
+    // A block comment can change the highlighting of every line after it, anything else only affects the new lines
+    if (L.contains("/*") || L.contains("*/") || t.content.contains("/*") || t.content.contains("*/")) {
+        lines.invalidateTokensFrom(s.head.x);
     }
 
     using D = Transaction::Direction;
@@ -1519,6 +1627,7 @@ void TextDocument::applyTokens(Range<int> rows, Array<Selection> const& zones)
             }
         }
     }
+    lines.markTokensClean(rows);
 }
 
 class Transaction::Undoable : public UndoableAction {
@@ -1612,6 +1721,12 @@ void PlugDataTextEditor::setText(String const& text)
     repaint();
 }
 
+void PlugDataTextEditor::appendText(String const& text)
+{
+    document.append(text);
+    repaint();
+}
+
 String PlugDataTextEditor::getText() const
 {
     return document.getText().joinIntoString("\r");
@@ -1957,16 +2072,19 @@ void PlugDataTextEditor::renderTextUsingAttributedStringSingle(Graphics& g)
     AttributedString s;
     s.setLineSpacing((document.getLineSpacing() - 1.f) * font.getHeight());
 
-    CppTokeniserFunctions::StringIterator si(content);
-    auto previous = si.t;
+    if (!enableSyntaxHighlighting) {
+        s.append(content, font, findColour(PlugDataColour::panelTextColourId));
+    } else {
+        CppTokeniserFunctions::StringIterator si(content);
+        auto previous = si.t;
 
-    while (!si.isEOF()) {
-        auto tokenType = CppTokeniserFunctions::readNextToken(si);
-        auto colour = enableSyntaxHighlighting ? colourScheme.types[tokenType].colour : findColour(PlugDataColour::panelTextColourId);
-        auto token = String(previous, si.t);
+        while (!si.isEOF()) {
+            auto tokenType = CppTokeniserFunctions::readNextToken(si);
+            auto token = String(previous, si.t);
 
-        previous = si.t;
-        s.append(token, font, colour);
+            previous = si.t;
+            s.append(token, font, colourScheme.types[tokenType].colour);
+        }
     }
 
     if (allowCoreGraphics) {
@@ -2032,20 +2150,24 @@ void PlugDataTextEditor::renderTextUsingGlyphArrangement(Graphics& g)
     if (enableSyntaxHighlighting) {
         auto colourScheme = CPlusPlusCodeTokeniser().getDefaultColourScheme();
         auto rows = document.getRangeOfRowsIntersecting(g.getClipBounds().toFloat());
-        auto index = Point<int>(rows.getStart(), 0);
-        document.navigate(index, TextDocument::Target::token, TextDocument::Direction::backwardRow);
 
-        auto it = TextDocument::Iterator(document, index);
-        auto previous = it.getIndex();
-        auto zones = Array<Selection>();
+        // Only tokenise again if some of the visible lines were edited since they were last highlighted
+        if (document.tokensAreDirty(rows)) {
+            auto index = Point<int>(rows.getStart(), 0);
+            document.navigate(index, TextDocument::Target::token, TextDocument::Direction::backwardRow);
+
+            auto it = TextDocument::Iterator(document, index);
+            auto previous = it.getIndex();
+            auto zones = Array<Selection>();
 
-        while (it.getIndex().x < rows.getEnd() && !it.isEOF()) {
-            auto tokenType = CppTokeniserFunctions::readNextToken(it);
-            zones.add(Selection(previous, it.getIndex()).withStyle(tokenType));
-            previous = it.getIndex();
+            while (it.getIndex().x < rows.getEnd() && !it.isEOF()) {
+                auto tokenType = CppTokeniserFunctions::readNextToken(it);
+                zones.add(Selection(previous, it.getIndex()).withStyle(tokenType));
+                previous = it.getIndex();
+            }
+            document.clearTokens(rows);
+            document.applyTokens(rows, zones);
         }
-        document.clearTokens(rows);
-        document.applyTokens(rows, zones);
 
         for (int n = 0; n < colourScheme.types.size(); ++n) {
             g.setColour(colourScheme.types[n].colour);
@@ -2133,9 +2255,7 @@ struct TextEditorDialog : public Component {
     void paint(Graphics& g) override
     {
         if (ProjectInfo::canUseSemiTransparentWindows()) {
-            auto shadowPath = Path();
-            shadowPath.addRoundedRectangle(getLocalBounds().reduced(20), Corners::windowCornerRadius);
-            StackShadow::renderDropShadow(g, shadowPath, Colour(0, 0, 0).withAlpha(0.6f), 13.0f);
+            StackShadow::renderDropShadow(g, getLocalBounds().reduced(20).toFloat(), Corners::windowCornerRadius, Colour(0, 0, 0).withAlpha(0.6f), 13);
         }
 
         auto radius = ProjectInfo::canUseSemiTransparentWindows() ? Corners::windowCornerRadius : 0.0f;
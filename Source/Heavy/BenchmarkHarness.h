@@ -0,0 +1,195 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen and Wasted Audio
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Writes a small host-side benchmark next to the sources heavy generated
+// It runs the patch for a while with noise as input, and prints the time per sample, stack depth and context size as JSON
+// That way you can compare heavy versions and compiler flags before putting the patch on a Daisy or Bela
+struct HeavyBenchmarkHarness {
+    struct Settings {
+        int blockSize = 64;
+        int sampleRate = 48000;
+        int seconds = 10;
+    };
+
+    // Expects heavy's C/C++ output in outputDirectory/c
+    static void write(File const& outputDirectory, String const& name, Settings const& settings)
+    {
+        outputDirectory.getChildFile("benchmark").createDirectory();
+        outputDirectory.getChildFile("benchmark").getChildFile("main.cpp").replaceWithText(fillIn(mainTemplate, name, settings), false, false, "\n");
+        outputDirectory.getChildFile("benchmark").getChildFile("CMakeLists.txt").replaceWithText(fillIn(cmakeTemplate, name, settings), false, false, "\n");
+    }
+
+    static String getTargetName(String const& name)
+    {
+        return name + "_benchmark";
+    }
+
+private:
+    static String fillIn(char const* text, String const& name, Settings const& settings)
+    {
+        return String(text)
+            .replace("${NAME}", name)
+            .replace("${BLOCK_SIZE}", String(settings.blockSize))
+            .replace("${SAMPLE_RATE}", String(settings.sampleRate))
+            .replace("${SECONDS}", String(settings.seconds));
+    }
+
+    static constexpr char const* cmakeTemplate = R"(# Benchmark for the heavy patch "${NAME}", generated by plugdata
+cmake_minimum_required(VERSION 3.15)
+project(${NAME}_benchmark LANGUAGES C CXX)
+
+set(CMAKE_CXX_STANDARD 17)
+if(NOT CMAKE_BUILD_TYPE)
+    set(CMAKE_BUILD_TYPE Release)
+endif()
+
+file(GLOB HEAVY_SOURCES ${CMAKE_CURRENT_SOURCE_DIR}/../c/*.c ${CMAKE_CURRENT_SOURCE_DIR}/../c/*.cpp)
+add_executable(${NAME}_benchmark main.cpp ${HEAVY_SOURCES})
+target_include_directories(${NAME}_benchmark PRIVATE ${CMAKE_CURRENT_SOURCE_DIR}/../c)
+
+if(NOT MSVC)
+    target_link_libraries(${NAME}_benchmark PRIVATE m)
+endif()
+)";
+
+    static constexpr char const* mainTemplate = R"(// Benchmark for the heavy patch "${NAME}", generated by plugdata
+// Build it with: cmake -S . -B build && cmake --build build --config Release
+// Run it with: ${NAME}_benchmark [--seconds ${SECONDS}] [--block-size ${BLOCK_SIZE}] [--sample-rate ${SAMPLE_RATE}]
+
+#include "Heavy_${NAME}.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <vector>
+
+// Counts C++ allocations made while processing, heavy itself should never allocate after it's created
+static bool countAllocations = false;
+static long long numAllocations = 0;
+
+void* operator new(std::size_t size)
+{
+    if (countAllocations)
+        numAllocations++;
+
+    if (auto* ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+#if defined(_MSC_VER)
+#    define BENCHMARK_NOINLINE __declspec(noinline)
+#else
+#    define BENCHMARK_NOINLINE __attribute__((noinline))
+#endif
+
+// Fills the stack below main with a pattern before processing, the deepest byte that changed tells us how much stack the patch used
+// This is an estimate, it also counts the timing code around the process call
+static constexpr std::size_t stackProbeSize = 256 * 1024;
+static constexpr unsigned char stackPattern = 0xA5;
+
+BENCHMARK_NOINLINE static void paintStack()
+{
+    volatile unsigned char probe[stackProbeSize];
+    for (std::size_t i = 0; i < stackProbeSize; i++)
+        probe[i] = stackPattern;
+}
+
+BENCHMARK_NOINLINE static std::size_t measureStack()
+{
+    volatile unsigned char probe[stackProbeSize];
+    std::size_t untouched = 0;
+    while (untouched < stackProbeSize && probe[untouched] == stackPattern)
+        untouched++;
+    return stackProbeSize - untouched;
+}
+
+static double getPercentile(std::vector<double> const& sorted, double percentile)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    return sorted[static_cast<std::size_t>(percentile * static_cast<double>(sorted.size() - 1) + 0.5)];
+}
+
+int main(int argc, char** argv)
+{
+    double seconds = ${SECONDS};
+    int blockSize = ${BLOCK_SIZE};
+    double sampleRate = ${SAMPLE_RATE};
+
+    for (int i = 1; i + 1 < argc; i++) {
+        if (!std::strcmp(argv[i], "--seconds"))
+            seconds = std::atof(argv[++i]);
+        else if (!std::strcmp(argv[i], "--block-size"))
+            blockSize = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--sample-rate"))
+            sampleRate = std::atof(argv[++i]);
+    }
+
+    Heavy_${NAME} context(sampleRate);
+
+    auto const numInputs = std::max(context.getNumInputChannels(), 1);
+    auto const numOutputs = std::max(context.getNumOutputChannels(), 1);
+
+    // The same noise every time, so runs are comparable
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+
+    std::vector<std::vector<float>> inputs(numInputs, std::vector<float>(blockSize));
+    std::vector<std::vector<float>> outputs(numOutputs, std::vector<float>(blockSize));
+    std::vector<float*> inputPointers, outputPointers;
+    for (auto& input : inputs) {
+        std::generate(input.begin(), input.end(), [&]() { return noise(random); });
+        inputPointers.push_back(input.data());
+    }
+    for (auto& output : outputs)
+        outputPointers.push_back(output.data());
+
+    auto const numBlocks = std::max(1, static_cast<int>(seconds * sampleRate / blockSize));
+    std::vector<double> blockTimes;
+    blockTimes.reserve(numBlocks);
+
+    paintStack();
+    countAllocations = true;
+    for (int block = 0; block < numBlocks; block++) {
+        auto const start = std::chrono::high_resolution_clock::now();
+        context.process(inputPointers.data(), outputPointers.data(), blockSize);
+        auto const end = std::chrono::high_resolution_clock::now();
+        blockTimes.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+    countAllocations = false;
+    auto const stackBytes = measureStack();
+
+    double totalTime = 0.0;
+    for (auto time : blockTimes)
+        totalTime += time;
+    std::sort(blockTimes.begin(), blockTimes.end());
+
+    auto const nsPerSample = totalTime / (static_cast<double>(numBlocks) * blockSize);
+
+    std::printf("{\"patch\":\"${NAME}\",\"sample_rate\":%g,\"block_size\":%d,\"seconds\":%g,", sampleRate, blockSize, seconds);
+    std::printf("\"ns_per_sample\":%.3f,\"realtime_factor\":%.2f,", nsPerSample, 1e9 / (sampleRate * nsPerSample));
+    std::printf("\"block_us_p50\":%.3f,\"block_us_p99\":%.3f,\"block_us_max\":%.3f,", getPercentile(blockTimes, 0.5) / 1000.0, getPercentile(blockTimes, 0.99) / 1000.0, getPercentile(blockTimes, 1.0) / 1000.0);
+    std::printf("\"context_bytes\":%d,\"stack_bytes\":%zu,\"allocations\":%lld}\n", context.getSize(), stackBytes, numAllocations);
+
+    return 0;
+}
+)";
+};
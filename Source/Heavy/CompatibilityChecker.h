@@ -0,0 +1,94 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen and Wasted Audio
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "CompatibleObjects.h"
+
+// Looks inside subpatches and abstractions to find objects that heavy can't compile
+// That way, Compiled Mode can mark a subpatch on the canvas when something inside it won't export, instead of only the objects you can see
+// Abstractions are checked once per file, and checked again when the file, or an abstraction it uses, changes on disk
+// Message thread only
+struct HeavyCompatibilityChecker {
+
+    // Returns the first object inside the glist that isn't supported, as a path like "pd filter -> delread4~", or an empty string if it compiles
+    static String findIncompatibleObject(t_glist* glist)
+    {
+        Dependencies dependencies;
+        return findIncompatibleObject(glist, dependencies);
+    }
+
+private:
+    using Dependencies = std::vector<std::pair<File, Time>>;
+
+    struct CachedResult {
+        Dependencies dependencies;
+        String incompatibleObject;
+
+        bool isUpToDate() const
+        {
+            for (auto const& [file, modificationTime] : dependencies) {
+                if (file.getLastModificationTime() != modificationTime)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    static String findIncompatibleObject(t_glist* glist, Dependencies& dependencies)
+    {
+        for (t_gobj* y = glist->gl_list; y; y = y->g_next) {
+            auto const type = String::fromUTF8(pd::Interface::getObjectClassName(&y->g_pd));
+
+            if (type != "canvas" && type != "graph") {
+                if (!HeavyCompatibleObjects::getAllCompatibleObjects().contains(type))
+                    return type;
+                continue;
+            }
+
+            auto* child = reinterpret_cast<t_glist*>(y);
+
+            char* text = nullptr;
+            int size = 0;
+            pd::Interface::getObjectText(&child->gl_obj, &text, &size);
+            auto const objectText = String::fromUTF8(text, size);
+            freebytes(static_cast<void*>(text), static_cast<size_t>(size) * sizeof(char));
+
+            // Subpatches that are implemented by heavy itself
+            if (objectText.startsWith("pd @hv_obj"))
+                continue;
+
+            auto const incompatibleObject = canvas_isabstraction(child) ? checkAbstraction(child, dependencies) : findIncompatibleObject(child, dependencies);
+            if (incompatibleObject.isNotEmpty())
+                return objectText + " -> " + incompatibleObject;
+        }
+
+        return {};
+    }
+
+    static String checkAbstraction(t_glist* abstraction, Dependencies& dependencies)
+    {
+        // If this instance was edited, it's no longer the same as the file
+        if (abstraction->gl_dirty)
+            return findIncompatibleObject(abstraction, dependencies);
+
+        auto const file = File(String::fromUTF8(canvas_getdir(abstraction)->s_name)).getChildFile(String::fromUTF8(abstraction->gl_name->s_name));
+        auto const key = file.getFullPathName();
+
+        auto it = abstractionCache.find(key);
+        if (it == abstractionCache.end() || !it->second.isUpToDate()) {
+            CachedResult result;
+            result.dependencies.emplace_back(file, file.getLastModificationTime());
+            result.incompatibleObject = findIncompatibleObject(abstraction, result.dependencies);
+            it = abstractionCache.insert_or_assign(key, std::move(result)).first;
+        }
+
+        dependencies.insert(dependencies.end(), it->second.dependencies.begin(), it->second.dependencies.end());
+        return it->second.incompatibleObject;
+    }
+
+    static inline std::unordered_map<String, CachedResult> abstractionCache;
+};
@@ -6,9 +6,29 @@
 
 class CppExporter : public ExporterBase {
 public:
+    Value benchmarkValue = SynchronousValue(var(0));
+    Value benchmarkBlocksizeValue = SynchronousValue(var(64));
+    Value benchmarkSamplerateValue = SynchronousValue(var(48000));
+    Value benchmarkSecondsValue = SynchronousValue(var(10));
+
     CppExporter(PluginEditor* editor, ExportingProgressView* exportingView)
         : ExporterBase(editor, exportingView)
     {
+        Array<PropertiesPanelProperty*> properties;
+        properties.add(new PropertiesPanel::BoolComponent("Benchmark harness", benchmarkValue, { "No", "Yes" }));
+
+        auto blocksizeProperty = new PropertiesPanel::EditableComponent<int>("Blocksize", benchmarkBlocksizeValue);
+        blocksizeProperty->setRangeMin(1);
+        blocksizeProperty->setRangeMax(4096);
+        properties.add(blocksizeProperty);
+        properties.add(new PropertiesPanel::EditableComponent<int>("Samplerate", benchmarkSamplerateValue));
+        properties.add(new PropertiesPanel::EditableComponent<int>("Seconds", benchmarkSecondsValue));
+
+        for (auto* property : properties) {
+            property->setPreferredHeight(28);
+        }
+
+        panel.addSection("Benchmark", properties);
     }
 
     ValueTree getState() override
@@ -17,6 +37,10 @@ public:
         stateTree.setProperty("inputPatchValue", getValue<String>(inputPatchValue), nullptr);
         stateTree.setProperty("projectNameValue", getValue<String>(projectNameValue), nullptr);
         stateTree.setProperty("projectCopyrightValue", getValue<String>(projectCopyrightValue), nullptr);
+        stateTree.setProperty("benchmarkValue", getValue<int>(benchmarkValue), nullptr);
+        stateTree.setProperty("benchmarkBlocksizeValue", getValue<int>(benchmarkBlocksizeValue), nullptr);
+        stateTree.setProperty("benchmarkSamplerateValue", getValue<int>(benchmarkSamplerateValue), nullptr);
+        stateTree.setProperty("benchmarkSecondsValue", getValue<int>(benchmarkSecondsValue), nullptr);
         return stateTree;
     }
 
@@ -26,6 +50,13 @@ public:
         inputPatchValue = tree.getProperty("inputPatchValue");
         projectNameValue = tree.getProperty("projectNameValue");
         projectCopyrightValue = tree.getProperty("projectCopyrightValue");
+
+        if (tree.hasProperty("benchmarkValue")) {
+            benchmarkValue = tree.getProperty("benchmarkValue");
+            benchmarkBlocksizeValue = tree.getProperty("benchmarkBlocksizeValue");
+            benchmarkSamplerateValue = tree.getProperty("benchmarkSamplerateValue");
+            benchmarkSecondsValue = tree.getProperty("benchmarkSecondsValue");
+        }
     }
 
     bool performExport(String pdPatch, String outdir, String name, String copyright, StringArray searchPaths) override
@@ -54,21 +85,20 @@ public:
         if (shouldQuit)
             return true;
 
-        start(args.joinIntoString(" "));
-
-        waitForProcessToFinish(-1);
-        exportingView->flushConsole();
+        auto outputFile = File(outdir);
+        auto const exitCode = runHeavy(args, pdPatch, searchPaths, outputFile);
 
         if (shouldQuit)
             return true;
 
-        auto outputFile = File(outdir);
         outputFile.getChildFile("ir").deleteRecursively();
         outputFile.getChildFile("hv").deleteRecursively();
 
-        // Delay to get correct exit code
-        Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 300);
+        if (!exitCode && getValue<int>(benchmarkValue)) {
+            HeavyBenchmarkHarness::write(outputFile, name, { std::max(1, getValue<int>(benchmarkBlocksizeValue)), std::max(1, getValue<int>(benchmarkSamplerateValue)), std::max(1, getValue<int>(benchmarkSecondsValue)) });
+            exportingView->logToConsole("Added benchmark harness, build it with CMake from the \"benchmark\" folder\n");
+        }
 
-        return getExitCode();
+        return exitCode;
     }
 };
@@ -188,15 +188,14 @@ public:
         if (shouldQuit)
             return true;
 
-        start(args.joinIntoString(" "));
+        auto outputFile = File(outdir);
+        SourceSnapshot snapshot(outputFile);
 
-        waitForProcessToFinish(-1);
-        exportingView->flushConsole();
+        bool generationExitCode = runHeavy(args, pdPatch, searchPaths, outputFile);
 
         if (shouldQuit)
             return true;
 
-        auto outputFile = File(outdir);
         outputFile.getChildFile("ir").deleteRecursively();
         outputFile.getChildFile("hv").deleteRecursively();
         outputFile.getChildFile("c").deleteRecursively();
@@ -204,10 +203,8 @@ public:
         auto DPF = Toolchain::dir.getChildFile("lib").getChildFile("dpf");
         DPF.copyDirectoryTo(outputFile.getChildFile("dpf"));
 
-        // Delay to get correct exit code
-        Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 300);
+        snapshot.restoreUnchangedFiles(outputFile);
 
-        bool generationExitCode = getExitCode();
         // Check if we need to compile
         if (!generationExitCode && exportType == 1) {
             auto workingDir = File::getCurrentWorkingDirectory();
@@ -219,20 +216,20 @@ public:
             auto makefile = outputFile.getChildFile("Makefile");
 
 #if JUCE_MAC
-            Toolchain::startShellScript("make -j4 -f " + makefile.getFullPathName(), this);
+            Toolchain::startShellScript("make" + getMakeJobsFlag() + "-f " + makefile.getFullPathName(), this);
 #elif JUCE_WINDOWS
             auto path = "export PATH=\"$PATH:" + Toolchain::dir.getChildFile("bin").getFullPathName().replaceCharacter('\\', '/') + "\"\n";
             auto cc = "CC=" + Toolchain::dir.getChildFile("bin").getChildFile("gcc.exe").getFullPathName().replaceCharacter('\\', '/') + " ";
             auto cxx = "CXX=" + Toolchain::dir.getChildFile("bin").getChildFile("g++.exe").getFullPathName().replaceCharacter('\\', '/') + " ";
 
-            Toolchain::startShellScript(path + cc + cxx + make.getFullPathName().replaceCharacter('\\', '/') + " -j4 -f " + makefile.getFullPathName().replaceCharacter('\\', '/'), this);
+            Toolchain::startShellScript(path + cc + cxx + make.getFullPathName().replaceCharacter('\\', '/') + getMakeJobsFlag() + "-f " + makefile.getFullPathName().replaceCharacter('\\', '/'), this);
 
 #else // Linux or BSD
             auto prepareEnvironmentScript = Toolchain::dir.getChildFile("scripts").getChildFile("anywhere-setup.sh").getFullPathName() + "\n";
 
             auto buildScript = prepareEnvironmentScript
                 + make.getFullPathName()
-                + " -j4 -f " + makefile.getFullPathName();
+                + getMakeJobsFlag() + "-f " + makefile.getFullPathName();
 
             // For some reason we need to do this again
             outputFile.getChildFile("dpf").getChildFile("utils").getChildFile("generate-ttl.sh").setExecutePermission(true);
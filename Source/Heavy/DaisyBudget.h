@@ -0,0 +1,137 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen and Wasted Audio
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Works out whether a Daisy build fits on the board
+// Memory use comes from the linker map of the firmware, the CPU use is estimated from running the patch on this computer
+struct DaisyBudget {
+    struct Region {
+        String name;
+        uint64 origin = 0;
+        uint64 length = 0;
+        uint64 used = 0;
+    };
+
+    // Memory regions from the "Memory Configuration" table, with the size of every output section added to the region it ends up in
+    static Array<Region> parseLinkerMap(File const& mapFile)
+    {
+        Array<Region> regions;
+        StringArray lines;
+        mapFile.readLines(lines);
+
+        auto parseNumber = [](String const& text) {
+            return static_cast<uint64>(text.trim().fromFirstOccurrenceOf("0x", false, true).getHexValue64());
+        };
+
+        auto findRegion = [&regions](uint64 address) -> Region* {
+            for (auto& region : regions) {
+                if (region.length && address >= region.origin && address < region.origin + region.length)
+                    return &region;
+            }
+            return nullptr;
+        };
+
+        int line = lines.indexOf("Memory Configuration");
+        if (line < 0)
+            return regions;
+
+        for (line += 1; line < lines.size(); line++) {
+            auto tokens = StringArray::fromTokens(lines[line], true);
+            if (lines[line].startsWith("Linker script and memory map"))
+                break;
+            if (tokens.size() < 3 || !tokens[1].startsWith("0x") || tokens[0] == "*default*")
+                continue;
+
+            regions.add({ tokens[0], parseNumber(tokens[1]), parseNumber(tokens[2]) });
+        }
+
+        // Output sections start at the beginning of a line, long names put the address and size on the next line
+        for (; line < lines.size(); line++) {
+            auto const& text = lines[line];
+            if (!text.startsWithChar('.'))
+                continue;
+
+            auto tokens = StringArray::fromTokens(text, true);
+            if (tokens.size() == 1 && line + 1 < lines.size()) {
+                tokens.addTokens(lines[line + 1], true);
+                line++;
+            }
+
+            if (tokens.size() < 3 || !tokens[1].startsWith("0x") || !tokens[2].startsWith("0x"))
+                continue;
+
+            auto const address = parseNumber(tokens[1]);
+            auto const size = parseNumber(tokens[2]);
+            if (!size)
+                continue;
+
+            auto* region = findRegion(address);
+            if (region)
+                region->used += size;
+
+            // Initialised data also takes up space where it's loaded from
+            if (auto const loadIndex = tokens.indexOf("load"); loadIndex > 0 && loadIndex + 2 < tokens.size()) {
+                auto* loadRegion = findRegion(parseNumber(tokens[loadIndex + 2]));
+                if (loadRegion && loadRegion != region)
+                    loadRegion->used += size;
+            }
+        }
+
+        regions.removeIf([](Region const& region) { return !region.length; });
+        return regions;
+    }
+
+    // Builds the benchmark harness for this computer and runs it, returns its JSON result, or an empty var if it failed
+    // Expects heavy's C/C++ output in outputDirectory/c
+    static var runHostBenchmark(File const& outputDirectory, String const& name, int blockSize, int sampleRate)
+    {
+        HeavyBenchmarkHarness::write(outputDirectory, name, { blockSize, sampleRate, 2 });
+
+        auto const benchmarkDirectory = outputDirectory.getChildFile("benchmark");
+#if JUCE_WINDOWS
+        auto const executable = benchmarkDirectory.getChildFile("benchmark.exe");
+#else
+        auto const executable = benchmarkDirectory.getChildFile("benchmark");
+#endif
+
+        // The M7 doesn't have the SIMD instructions heavy uses on desktop, so we leave them out here too
+        auto const buildScript = Toolchain::getHostBuildScript({ outputDirectory.getChildFile("c"), benchmarkDirectory }, executable, false, "-DHV_SIMD_NONE");
+
+        ChildProcess build;
+        Toolchain::startShellScript(buildScript, &build);
+        build.readAllProcessOutput();
+        if (build.getExitCode() != 0 || !executable.existsAsFile())
+            return {};
+
+        ChildProcess run;
+        if (!run.start(executable.getFullPathName()))
+            return {};
+
+        auto const output = run.readAllProcessOutput();
+        return JSON::parse(output.fromFirstOccurrenceOf("{", true, false).upToLastOccurrenceOf("}", true, false));
+    }
+
+    // Rough estimate of the cycles the Seed's Cortex-M7 needs per sample, or 0 if we don't know the clock speed of this computer
+    // We scale the cycles the patch takes here, a desktop core gets about three times as much done per cycle
+    static double estimateCyclesPerSample(double hostNanosecondsPerSample)
+    {
+        return hostNanosecondsPerSample * SystemStats::getCpuSpeedInMegahertz() / 1000.0 * instructionsPerCycleRatio;
+    }
+
+    static String formatBytes(uint64 bytes)
+    {
+        if (bytes >= 1024 * 1024)
+            return String(static_cast<double>(bytes) / (1024.0 * 1024.0), 2) + " MB";
+        if (bytes >= 1024)
+            return String(static_cast<double>(bytes) / 1024.0, 1) + " KB";
+
+        return String(static_cast<int64>(bytes)) + " B";
+    }
+
+    static constexpr double daisyClockSpeed = 480e6;
+    static constexpr double instructionsPerCycleRatio = 3.0;
+};
@@ -268,23 +268,18 @@ public:
 
         args.add(paths);
 
-        start(args.joinIntoString(" "));
-        waitForProcessToFinish(-1);
-        exportingView->flushConsole();
+        auto outputFile = File(outdir);
+        SourceSnapshot snapshot(outputFile);
+
+        bool heavyExitCode = runHeavy(args, pdPatch, searchPaths, outputFile);
 
         exportingView->logToConsole("Compiling for " + board + "...\n");
 
         if (shouldQuit)
             return true;
 
-        // Delay to get correct exit code
-        Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 300);
-
-        auto outputFile = File(outdir);
         auto sourceDir = outputFile.getChildFile("daisy").getChildFile("source");
 
-        bool heavyExitCode = getExitCode();
-
         if (compile) {
 
             auto bin = Toolchain::dir.getChildFile("bin");
@@ -294,10 +289,21 @@ public:
 
             libDaisy.copyDirectoryTo(outputFile.getChildFile("libdaisy"));
 
+            // Run the patch on this computer before the generic sources are removed, to estimate the CPU usage on the board
+            auto const sampleRate = Array { 8000, 16000, 32000, 48000, 96000 }[rate];
+            var hostBenchmark;
+            if (!heavyExitCode) {
+                exportingView->logToConsole("Estimating CPU usage...\n");
+                hostBenchmark = DaisyBudget::runHostBenchmark(outputFile, name, blocksize, sampleRate);
+                outputFile.getChildFile("benchmark").deleteRecursively();
+            }
+
             outputFile.getChildFile("ir").deleteRecursively();
             outputFile.getChildFile("hv").deleteRecursively();
             outputFile.getChildFile("c").deleteRecursively();
 
+            snapshot.restoreUnchangedFiles(outputFile);
+
             auto workingDir = File::getCurrentWorkingDirectory();
 
             sourceDir.setAsCurrentWorkingDirectory();
@@ -307,7 +313,7 @@ public:
 
 #if JUCE_WINDOWS
             auto buildScript = make.getFullPathName().replaceCharacter('\\', '/')
-                + " -j4 -f "
+                + getMakeJobsFlag() + "-f "
                 + sourceDir.getChildFile("Makefile").getFullPathName().replaceCharacter('\\', '/')
                 + " GCC_PATH="
                 + gccPath.replaceCharacter('\\', '/')
@@ -316,7 +322,7 @@ public:
             Toolchain::startShellScript(buildScript, this);
 #else
             String buildScript = make.getFullPathName()
-                + " -j4 -f " + sourceDir.getChildFile("Makefile").getFullPathName()
+                + getMakeJobsFlag() + "-f " + sourceDir.getChildFile("Makefile").getFullPathName()
                 + " GCC_PATH=" + gccPath
                 + " PROJECT_NAME=" + name;
 
@@ -333,6 +339,9 @@ public:
             Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 300);
 
             auto compileExitCode = getExitCode();
+            if (!compileExitCode)
+                showBudget(sourceDir.getChildFile("build"), name, hostBenchmark, blocksize, sampleRate);
+
             if (flash && !compileExitCode) {
 
                 auto dfuUtil = bin.getChildFile("dfu-util" + exeSuffix);
@@ -437,4 +446,33 @@ public:
             return heavyExitCode;
         }
     }
+
+    // Shows how much of the board's memory and CPU the patch needs, so you can pick a memory layout that fits
+    void showBudget(File const& buildDir, String const& name, var const& hostBenchmark, int blocksize, int sampleRate)
+    {
+        auto mapFile = buildDir.getChildFile("HeavyDaisy_" + name + ".map");
+        if (!mapFile.existsAsFile())
+            mapFile = buildDir.findChildFiles(File::findFiles, false, "*.map").getFirst();
+
+        Array<StringArray> rows = { { "Region", "Used", "Size", "Usage" } };
+        for (auto const& region : DaisyBudget::parseLinkerMap(mapFile)) {
+            auto const usage = static_cast<double>(region.used) / static_cast<double>(region.length) * 100.0;
+            rows.add({ region.name, DaisyBudget::formatBytes(region.used), DaisyBudget::formatBytes(region.length), String(usage, 1) + "%" });
+        }
+
+        // Heavy allocates its context on the heap when the patch starts, so it isn't in the linker map
+        if (auto const contextSize = static_cast<int64>(hostBenchmark.getProperty("context_bytes", 0)))
+            rows.add({ "Heavy context (heap)", DaisyBudget::formatBytes(static_cast<uint64>(contextSize)), "", "" });
+
+        if (auto const cycles = DaisyBudget::estimateCyclesPerSample(hostBenchmark.getProperty("ns_per_sample", 0.0))) {
+            auto const usage = cycles * sampleRate / DaisyBudget::daisyClockSpeed * 100.0;
+            rows.add({ "CPU (estimate)", String(roundToInt(cycles * blocksize)) + " cycles/block", "", String(usage, 1) + "%" });
+        }
+
+        if (rows.size() == 1)
+            return;
+
+        exportingView->logToConsole("\nBudget:\n");
+        exportingView->logTable(rows);
+    }
 };
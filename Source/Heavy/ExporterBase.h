@@ -26,7 +26,7 @@ struct ExporterBase : public Component
     inline static String const exeSuffix = "";
 #endif
 
-    inline static File heavyExecutable = Toolchain::dir.getChildFile("bin").getChildFile("Heavy").getChildFile("Heavy" + exeSuffix);
+    inline static File heavyExecutable = Toolchain::heavyExecutable;
 
     bool validPatchSelected = false;
 
@@ -212,6 +212,94 @@ struct ExporterBase : public Component
         exportButton.setBounds(getLocalBounds().removeFromBottom(23).removeFromRight(80).translated(-10, -10));
     }
 
+    // Heavy writes every source file again on each export, and we copy the libraries into the project again too
+    // That makes make rebuild everything, even if only a single object changed
+    // So before exporting, we remember what the sources looked like, and afterwards, files that didn't change get their old modification time back
+    // Together with the build folder that's already in the output directory, exporting the same patch again only compiles what changed
+    struct SourceSnapshot {
+        std::unordered_map<String, std::pair<uint64, Time>> files;
+
+        explicit SourceSnapshot(File const& directory)
+        {
+            if (!directory.isDirectory())
+                return;
+
+            for (auto const& entry : RangedDirectoryIterator(directory, true, sourcePatterns, File::findFiles)) {
+                auto const& file = entry.getFile();
+                files[file.getFullPathName()] = { getContentHash(file), file.getLastModificationTime() };
+            }
+        }
+
+        // Returns how many files were unchanged
+        int restoreUnchangedFiles(File const& directory) const
+        {
+            int numUnchanged = 0;
+            if (files.empty() || !directory.isDirectory())
+                return numUnchanged;
+
+            for (auto const& entry : RangedDirectoryIterator(directory, true, sourcePatterns, File::findFiles)) {
+                auto const& file = entry.getFile();
+                auto it = files.find(file.getFullPathName());
+                if (it == files.end() || it->second.first != getContentHash(file))
+                    continue;
+
+                file.setLastModificationTime(it->second.second);
+                numUnchanged++;
+            }
+
+            return numUnchanged;
+        }
+
+        static uint64 getContentHash(File const& file)
+        {
+            MemoryBlock content;
+            file.loadFileAsData(content);
+
+            uint64 hash = 14695981039346656037ull;
+            auto const* data = static_cast<uint8 const*>(content.getData());
+            for (size_t i = 0; i < content.getSize(); i++) {
+                hash = (hash ^ data[i]) * 1099511628211ull;
+            }
+            return hash;
+        }
+
+        static inline String const sourcePatterns = "*.c;*.cpp;*.cc;*.h;*.hpp;*.s;*.S;*.a;*.ld;*.mk;Makefile";
+    };
+
+    // Runs heavy, unless it already generated code for the same patch and settings before, then that is written again
+    int runHeavy(StringArray const& args, String const& pdPatch, StringArray const& searchPaths, File const& outputDirectory)
+    {
+        auto const key = HeavyCompiler::getKey(args, File(pdPatch), searchPaths);
+        if (HeavyCompiler::restore(key, outputDirectory)) {
+            exportingView->logToConsole("Patch didn't change since heavy last generated it, reusing its output\n");
+            return 0;
+        }
+
+        auto const generationStart = Time::getCurrentTime();
+        start(args.joinIntoString(" "));
+
+        waitForProcessToFinish(-1);
+        exportingView->flushConsole();
+
+        if (shouldQuit)
+            return 1;
+
+        // Delay to get correct exit code
+        Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 300);
+
+        auto const exitCode = static_cast<int>(getExitCode());
+        if (!exitCode)
+            HeavyCompiler::store(key, outputDirectory, generationStart);
+
+        return exitCode;
+    }
+
+    // Use all cores for compiling
+    static String getMakeJobsFlag()
+    {
+        return " -j" + String(SystemStats::getNumCpus()) + " ";
+    }
+
     static String createMetaJson(DynamicObject::Ptr metaJson)
     {
         auto metadata = File::createTempFile(".json");
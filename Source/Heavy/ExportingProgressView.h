@@ -133,6 +133,36 @@ public:
         }
     }
 
+    // Logs rows as a table with aligned columns, the first row is the header
+    void logTable(Array<StringArray> const& rows)
+    {
+        Array<int> widths;
+        for (auto const& row : rows) {
+            for (int column = 0; column < row.size(); column++) {
+                if (column >= widths.size())
+                    widths.add(0);
+                widths.set(column, std::max(widths[column], row[column].length()));
+            }
+        }
+
+        String table;
+        for (int i = 0; i < rows.size(); i++) {
+            for (int column = 0; column < rows[i].size(); column++) {
+                table << rows[i][column].paddedRight(' ', widths[column] + 2);
+            }
+            table = table.trimEnd() + "\n";
+
+            if (i == 0) {
+                int totalWidth = 0;
+                for (auto width : widths)
+                    totalWidth += width + 2;
+                table << String::repeatedString("-", totalWidth - 2) << "\n";
+            }
+        }
+
+        logToConsole(table);
+    }
+
     void paint(Graphics& g) override
     {
         auto b = getLocalBounds();
@@ -0,0 +1,178 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen and Wasted Audio
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <set>
+
+// Heavy is a separate program, and starting it takes longer than generating the code for a small patch
+// It can't stay running between exports, so instead we skip it when we can: what it generates only depends on its arguments and the patches it reads
+// After every successful run, we keep the files it wrote, keyed by the content of the patch, every abstraction it loads, and the metadata
+// When none of those changed on the next export or preview, those files are written again and heavy doesn't run at all
+// Used from the export and preview threads
+struct HeavyCompiler {
+    // Returns 0 when we can't tell what heavy would read
+    static uint64 getKey(StringArray const& args, File const& patch, StringArray const& searchPaths)
+    {
+        if (!patch.existsAsFile() || args.isEmpty())
+            return 0;
+
+        // A new toolchain can generate different code from the same patch
+        auto const heavy = File(args[0].unquoted());
+        uint64 key = hashString(14695981039346656037ull, heavy.getFullPathName() + String(heavy.getLastModificationTime().toMilliseconds()) + String(heavy.getSize()));
+
+        for (int i = 1; i < args.size(); i++) {
+            auto const& arg = args[i];
+            if (arg == patch.getFullPathName() || arg.startsWith("-o"))
+                continue; // Patches are exported from a temporary copy, and the output directory doesn't change what's generated
+
+            if (arg.startsWith("-m"))
+                key = hashString(key, File(arg.substring(2)).loadFileAsString()); // Metadata is written to a new temporary file every time
+            else
+                key = hashString(key, arg);
+        }
+
+        std::set<String> visited;
+        key = hashPatch(key, patch, searchPaths, visited);
+        return key ? key : 1;
+    }
+
+    // Writes the files heavy generated for this key before, returns false if we don't have them
+    static bool restore(uint64 const key, File const& outputDirectory)
+    {
+        if (!key)
+            return false;
+
+        ScopedLock lock(cacheLock);
+
+        auto const entry = getEntry(key);
+        if (!entry.isDirectory())
+            return false;
+
+        for (auto const& file : RangedDirectoryIterator(entry, true, "*", File::findFiles)) {
+            auto const target = outputDirectory.getChildFile(file.getFile().getRelativePathFrom(entry));
+            target.getParentDirectory().createDirectory();
+            if (!file.getFile().copyFileTo(target))
+                return false;
+        }
+
+        return true;
+    }
+
+    // Keeps every file in outputDirectory that heavy wrote since generationStart
+    static void store(uint64 const key, File const& outputDirectory, Time const& generationStart)
+    {
+        if (!key)
+            return;
+
+        // Copy outside the lock, and only make it visible once it's complete
+        auto const incomplete = getCacheDirectory().getNonexistentChildFile("incomplete", "", false);
+
+        // Not every file system stores modification times precisely
+        auto const since = generationStart - RelativeTime::seconds(2);
+        for (auto const& file : RangedDirectoryIterator(outputDirectory, true, "*", File::findFiles)) {
+            if (file.getModificationTime() < since)
+                continue;
+
+            auto const target = incomplete.getChildFile(file.getFile().getRelativePathFrom(outputDirectory));
+            target.getParentDirectory().createDirectory();
+            if (!file.getFile().copyFileTo(target)) {
+                incomplete.deleteRecursively();
+                return;
+            }
+        }
+
+        ScopedLock lock(cacheLock);
+
+        auto const entry = getEntry(key);
+        entry.deleteRecursively();
+        if (!incomplete.moveFileTo(entry)) {
+            incomplete.deleteRecursively();
+            return;
+        }
+
+        removeOldEntries();
+    }
+
+private:
+    static File getCacheDirectory()
+    {
+        return ProjectInfo::appDataDir.getChildFile("HeavyCache");
+    }
+
+    static File getEntry(uint64 const key)
+    {
+        return getCacheDirectory().getChildFile(String::toHexString(static_cast<int64>(key)));
+    }
+
+    static void removeOldEntries()
+    {
+        auto entries = getCacheDirectory().findChildFiles(File::findDirectories, false);
+        if (entries.size() <= maxEntries)
+            return;
+
+        std::sort(entries.begin(), entries.end(), [](File const& a, File const& b) {
+            return a.getCreationTime() > b.getCreationTime();
+        });
+
+        for (int i = maxEntries; i < entries.size(); i++)
+            entries[i].deleteRecursively();
+    }
+
+    static uint64 hashString(uint64 hash, String const& text)
+    {
+        for (auto const* c = text.toRawUTF8(); *c; c++)
+            hash = (hash ^ static_cast<uint8>(*c)) * 1099511628211ull;
+
+        return (hash ^ 0xff) * 1099511628211ull; // So "ab" + "c" differs from "a" + "bc"
+    }
+
+    // Hashes the patch, and every abstraction it could load, the same way pd looks for them
+    static uint64 hashPatch(uint64 hash, File const& patch, StringArray searchPaths, std::set<String>& visited)
+    {
+        if (!visited.insert(patch.getFullPathName()).second)
+            return hash;
+
+        auto const content = patch.loadFileAsString();
+        auto const patchDirectory = patch.getParentDirectory();
+        hash = hashString(hash, patch.getFileName() + content);
+
+        StringArray names;
+        for (auto const& message : StringArray::fromTokens(content, ";", "")) {
+            auto const tokens = StringArray::fromTokens(message.trim(), true);
+            if (tokens.size() >= 5 && tokens[0] == "#X" && tokens[1] == "obj") {
+                names.addIfNotAlreadyThere(tokens[4].trimCharactersAtEnd(","));
+            } else if (tokens.size() >= 4 && tokens[0] == "#X" && tokens[1] == "declare") {
+                for (int i = 2; i < tokens.size() - 1; i++) {
+                    if (tokens[i] == "-path")
+                        searchPaths.add(File::isAbsolutePath(tokens[i + 1]) ? tokens[i + 1] : patchDirectory.getChildFile(tokens[i + 1]).getFullPathName());
+                }
+            }
+        }
+
+        searchPaths.insert(0, patchDirectory.getFullPathName());
+
+        for (auto const& name : names) {
+            for (auto const& path : searchPaths) {
+                if (!File::isAbsolutePath(path))
+                    continue;
+
+                auto const abstraction = File(path).getChildFile(name + ".pd");
+                if (abstraction.existsAsFile()) {
+                    // Where it was found matters too, a new file earlier in the search path would replace it
+                    hash = hashString(hash, abstraction.getFullPathName());
+                    hash = hashPatch(hash, abstraction, searchPaths, visited);
+                    break;
+                }
+            }
+        }
+
+        return hash;
+    }
+
+    static constexpr int maxEntries = 32;
+    inline static CriticalSection cacheLock;
+};
@@ -16,8 +16,11 @@
 #include "Utility/OSUtils.h"
 
 #include "Toolchain.h"
+#include "HeavyCompiler.h"
 #include "ExportingProgressView.h"
 #include "ExporterBase.h"
+#include "BenchmarkHarness.h"
+#include "DaisyBudget.h"
 #include "CppExporter.h"
 #include "DPFExporter.h"
 #include "DaisyExporter.h"
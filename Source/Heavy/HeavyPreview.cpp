@@ -0,0 +1,295 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen and Wasted Audio
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+#include "Utility/Config.h"
+
+#include "Pd/Instance.h"
+#include "Toolchain.h"
+#include "HeavyCompiler.h"
+#include "HeavyPreview.h"
+
+// Heavy's C API, these are exported by every patch heavy generates
+struct HeavyPreview::Context {
+    using CreateFunction = void* (*)(double);
+    using ProcessFunction = int (*)(void*, float**, float**, int);
+    using DeleteFunction = void (*)(void*);
+    using ChannelCountFunction = int (*)(void*);
+
+    ~Context()
+    {
+        if (heavy)
+            destroy(heavy);
+        library.close();
+    }
+
+    bool open(File const& file)
+    {
+        if (!library.open(file.getFullPathName()))
+            return false;
+
+        create = reinterpret_cast<CreateFunction>(library.getFunction("hv_" + symbolName + "_new"));
+        process = reinterpret_cast<ProcessFunction>(library.getFunction("hv_process"));
+        destroy = reinterpret_cast<DeleteFunction>(library.getFunction("hv_delete"));
+        getNumInputs = reinterpret_cast<ChannelCountFunction>(library.getFunction("hv_getNumInputChannels"));
+        getNumOutputs = reinterpret_cast<ChannelCountFunction>(library.getFunction("hv_getNumOutputChannels"));
+
+        return create && process && destroy && getNumInputs && getNumOutputs;
+    }
+
+    // Called when the patch is loaded, and from prepareToPlay when the sample rate changes
+    void createInstance(double sampleRate)
+    {
+        if (heavy)
+            destroy(heavy);
+
+        heavy = create(sampleRate);
+        numInputs = getNumInputs(heavy);
+        numOutputs = getNumOutputs(heavy);
+
+        auto const blockSize = pd::Instance::getBlockSize();
+        inputs.setSize(std::max(numInputs, 1), blockSize);
+        outputs.setSize(std::max(numOutputs, 1), blockSize);
+    }
+
+    // The patch is always compiled under this name, so we know which constructor to look for
+    static inline String const symbolName = "plugdata_preview";
+
+    DynamicLibrary library;
+    CreateFunction create = nullptr;
+    ProcessFunction process = nullptr;
+    DeleteFunction destroy = nullptr;
+    ChannelCountFunction getNumInputs = nullptr;
+    ChannelCountFunction getNumOutputs = nullptr;
+
+    void* heavy = nullptr;
+    int numInputs = 0, numOutputs = 0;
+    AudioBuffer<float> inputs, outputs;
+};
+
+HeavyPreview::HeavyPreview(pd::Instance* instance)
+    : Thread("Heavy Preview")
+    , pd(instance)
+{
+}
+
+HeavyPreview::~HeavyPreview()
+{
+    stopBuild();
+}
+
+void HeavyPreview::start(String const& patchContent, StringArray const& searchPaths, double sampleRate)
+{
+    stop();
+
+    content = patchContent;
+    paths = searchPaths;
+    buildSampleRate = sampleRate;
+    enabled = true;
+
+    log("Compiling patch with heavy...", false);
+    startThread();
+}
+
+void HeavyPreview::stop()
+{
+    enabled = false;
+    stopBuild();
+
+    std::unique_ptr<Context> oldContext;
+    {
+        ScopedLock lock(contextLock);
+        std::swap(context, oldContext);
+        loaded = false;
+    }
+}
+
+void HeavyPreview::stopBuild()
+{
+    signalThreadShouldExit();
+    {
+        ScopedLock lock(processLock);
+        if (runningProcess)
+            runningProcess->kill();
+    }
+
+    // The thread only waits for the process, so once that is gone it exits right away
+    stopThread(5000);
+}
+
+String HeavyPreview::waitForProcess(ChildProcess& process)
+{
+    {
+        ScopedLock lock(processLock);
+        runningProcess = &process;
+
+        // stopBuild() might have come before we got here
+        if (threadShouldExit())
+            process.kill();
+    }
+
+    auto output = process.readAllProcessOutput();
+
+    ScopedLock lock(processLock);
+    runningProcess = nullptr;
+    return output;
+}
+
+void HeavyPreview::prepare(double sampleRate)
+{
+    buildSampleRate = sampleRate;
+
+    ScopedLock lock(contextLock);
+    if (context)
+        context->createInstance(sampleRate);
+}
+
+bool HeavyPreview::process(float* const* channels, int numChannels, int offset, int numSamples)
+{
+    // If the message thread is swapping in a new patch, let pd process this block
+    ScopedTryLock lock(contextLock);
+    if (!lock.isLocked() || !context || !context->heavy)
+        return false;
+
+    auto& inputs = context->inputs;
+    auto& outputs = context->outputs;
+    for (int ch = 0; ch < context->numInputs; ch++) {
+        if (ch < numChannels)
+            FloatVectorOperations::copy(inputs.getWritePointer(ch), channels[ch] + offset, numSamples);
+        else
+            FloatVectorOperations::clear(inputs.getWritePointer(ch), numSamples);
+    }
+
+    context->process(context->heavy, inputs.getArrayOfWritePointers(), outputs.getArrayOfWritePointers(), numSamples);
+
+    for (int ch = 0; ch < numChannels; ch++) {
+        if (ch < context->numOutputs)
+            FloatVectorOperations::copy(channels[ch] + offset, outputs.getReadPointer(ch), numSamples);
+        else
+            FloatVectorOperations::clear(channels[ch] + offset, numSamples);
+    }
+
+    return true;
+}
+
+void HeavyPreview::run()
+{
+    // Every build gets its own directory, a library that's still loaded can't always be overwritten
+    auto const buildDirectory = File::getSpecialLocation(File::tempDirectory).getChildFile("plugdata-heavy-preview").getNonexistentChildFile("build", "", false);
+    buildDirectory.createDirectory();
+    Toolchain::deleteTempFileLater(buildDirectory);
+
+#if JUCE_WINDOWS
+    auto const library = buildDirectory.getChildFile("preview.dll");
+#elif JUCE_MAC
+    auto const library = buildDirectory.getChildFile("preview.dylib");
+#else
+    auto const library = buildDirectory.getChildFile("preview.so");
+#endif
+
+    auto result = generate(buildDirectory);
+    if (result.wasOk() && !threadShouldExit())
+        result = compile(buildDirectory.getChildFile("c"), library);
+
+    if (threadShouldExit())
+        return;
+
+    MessageManager::callAsync([_this = WeakReference<HeavyPreview>(this), result, library]() {
+        if (!_this || !_this->enabled)
+            return;
+
+        if (result.failed()) {
+            _this->enabled = false;
+            _this->log(result.getErrorMessage(), true);
+            return;
+        }
+
+        _this->load(library);
+    });
+}
+
+Result HeavyPreview::generate(File const& outputDirectory)
+{
+    auto const patchFile = outputDirectory.getChildFile("preview.pd");
+    patchFile.replaceWithText(content, false, false, "\n");
+
+    auto const& heavy = Toolchain::heavyExecutable;
+    if (!heavy.existsAsFile())
+        return Result::fail("Can't find heavy, install the toolchain from the \"Compile...\" dialog first");
+
+    StringArray args = { heavy.getFullPathName(), patchFile.getFullPathName(), "-o" + outputDirectory.getFullPathName(), "-n" + Context::symbolName };
+
+    String searchPaths = "-p";
+    for (auto& path : paths) {
+        searchPaths += " " + path;
+    }
+    args.add(searchPaths);
+
+    // Tweaking one patch while the preview is on often leaves the abstractions unchanged, or comes back to an earlier version
+    auto const key = HeavyCompiler::getKey(args, patchFile, paths);
+    if (HeavyCompiler::restore(key, outputDirectory))
+        return Result::ok();
+
+    auto const generationStart = Time::getCurrentTime();
+
+    ChildProcess process;
+    if (!process.start(args.joinIntoString(" ")))
+        return Result::fail("Failed to start heavy");
+
+    auto const output = waitForProcess(process);
+    if (threadShouldExit())
+        return Result::fail("Cancelled");
+
+    if (process.getExitCode() != 0)
+        return Result::fail("Heavy failed to compile the patch:\n" + output);
+
+    HeavyCompiler::store(key, outputDirectory, generationStart);
+    return Result::ok();
+}
+
+Result HeavyPreview::compile(File const& sourceDirectory, File const& library)
+{
+    auto const script = Toolchain::getHostBuildScript({ sourceDirectory }, library, true);
+
+    ChildProcess process;
+    Toolchain::startShellScript(script, &process);
+
+    auto const output = waitForProcess(process);
+    if (process.getExitCode() != 0 || !library.existsAsFile())
+        return Result::fail("Failed to build the compiled patch:\n" + output);
+
+    return Result::ok();
+}
+
+void HeavyPreview::load(File const& library)
+{
+    auto newContext = std::make_unique<Context>();
+    if (!newContext->open(library)) {
+        enabled = false;
+        log("Failed to load the compiled patch", true);
+        return;
+    }
+
+    newContext->createInstance(buildSampleRate);
+
+    // The old patch gets deleted outside of the lock, so the audio thread only misses a block at most
+    {
+        ScopedLock lock(contextLock);
+        std::swap(context, newContext);
+        loaded = true;
+    }
+
+    log("Running compiled patch, pd's DSP is paused until you turn it off again", false);
+}
+
+void HeavyPreview::log(String const& message, bool isError)
+{
+    if (isError)
+        pd->logError(message);
+    else
+        pd->logMessage(message);
+}
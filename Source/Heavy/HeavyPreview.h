@@ -0,0 +1,74 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen and Wasted Audio
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+namespace pd {
+class Instance;
+}
+
+// Compiles a patch with heavy and runs it inside plugdata, in place of pd's own DSP
+// That way you can hear whether the compiled patch sounds the same, and compare the CPU meter with and without it
+// The patch is built with the exporter toolchain into a shared library, once it's loaded we swap it in between two blocks
+// While the compiled patch runs, pd keeps handling clocks and messages, only its DSP is skipped
+class HeavyPreview final : private Thread {
+public:
+    explicit HeavyPreview(pd::Instance* instance);
+    ~HeavyPreview() override;
+
+    // Message thread: compiles the patch in the background, and switches over once it's loaded
+    void start(String const& patchContent, StringArray const& searchPaths, double sampleRate);
+
+    // Message thread: goes back to pd's DSP
+    void stop();
+
+    // Running, or still compiling
+    bool isActive() const { return enabled.load(std::memory_order_relaxed); }
+    bool isLoaded() const { return loaded.load(std::memory_order_relaxed); }
+
+    // The compiled patch needs to be created again when the sample rate changes
+    void prepare(double sampleRate);
+
+    // Audio thread: processes one pd block with the compiled patch
+    // Returns false when nothing is loaded, pd should process the block itself then
+    bool process(float* const* channels, int numChannels, int offset, int numSamples);
+
+private:
+    struct Context;
+
+    void run() override;
+
+    Result generate(File const& outputDirectory);
+    Result compile(File const& sourceDirectory, File const& library);
+    void load(File const& library);
+
+    // Kills heavy or the compiler if they're running, and waits a limited time for the build thread to exit
+    void stopBuild();
+
+    // Reads the output of a process until it exits, while stopBuild() is able to kill it
+    String waitForProcess(ChildProcess& process);
+
+    void log(String const& message, bool isError);
+
+    pd::Instance* pd;
+
+    // Set by start(), read by the build thread
+    String content;
+    StringArray paths;
+    double buildSampleRate = 44100.0;
+
+    CriticalSection processLock;
+    ChildProcess* runningProcess = nullptr;
+
+    std::unique_ptr<Context> context;
+    CriticalSection contextLock;
+    std::atomic<bool> enabled = false;
+    std::atomic<bool> loaded = false;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(HeavyPreview)
+};
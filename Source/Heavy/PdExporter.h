@@ -87,22 +87,19 @@ public:
         if (shouldQuit)
             return true;
 
-        start(args.joinIntoString(" "));
+        auto outputFile = File(outdir);
+        SourceSnapshot snapshot(outputFile);
 
-        waitForProcessToFinish(-1);
-        exportingView->flushConsole();
+        bool generationExitCode = runHeavy(args, pdPatch, searchPaths, outputFile);
 
         if (shouldQuit)
             return true;
 
-        auto outputFile = File(outdir);
         outputFile.getChildFile("ir").deleteRecursively();
         outputFile.getChildFile("hv").deleteRecursively();
 
-        // Delay to get correct exit code
-        Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 300);
+        snapshot.restoreUnchangedFiles(outputFile);
 
-        bool generationExitCode = getExitCode();
         // Check if we need to compile
         if (!generationExitCode && getValue<int>(exportTypeValue) == 2) {
             auto workingDir = File::getCurrentWorkingDirectory();
@@ -114,7 +111,7 @@ public:
             auto makefile = outputFile.getChildFile("Makefile");
 
 #if JUCE_MAC
-            Toolchain::startShellScript("make -j4", this);
+            Toolchain::startShellScript("make" + getMakeJobsFlag(), this);
 #elif JUCE_WINDOWS
             File pdDll;
             if (ProjectInfo::isStandalone) {
@@ -128,14 +125,14 @@ public:
             auto cxx = "CXX=" + Toolchain::dir.getChildFile("bin").getChildFile("g++.exe").getFullPathName().replaceCharacter('\\', '/') + " ";
             auto pdbindir = "PDBINDIR=" + pdDll.getFullPathName().replaceCharacter('\\', '/') + " ";
 
-            Toolchain::startShellScript(path + cc + cxx + pdbindir + make.getFullPathName().replaceCharacter('\\', '/') + " -j4", this);
+            Toolchain::startShellScript(path + cc + cxx + pdbindir + make.getFullPathName().replaceCharacter('\\', '/') + getMakeJobsFlag(), this);
 
 #else // Linux or BSD
             auto prepareEnvironmentScript = Toolchain::dir.getChildFile("scripts").getChildFile("anywhere-setup.sh").getFullPathName() + "\n";
 
             auto buildScript = prepareEnvironmentScript
                 + make.getFullPathName()
-                + " -j4";
+                + getMakeJobsFlag();
 
             Toolchain::startShellScript(buildScript, this);
 #endif
@@ -11,8 +11,10 @@
 struct Toolchain {
 #if JUCE_WINDOWS
     static inline File const dir = ProjectInfo::appDataDir.getChildFile("Toolchain").getChildFile("usr");
+    static inline File const heavyExecutable = dir.getChildFile("bin").getChildFile("Heavy").getChildFile("Heavy.exe");
 #else
     static inline File const dir = ProjectInfo::appDataDir.getChildFile("Toolchain");
+    static inline File const heavyExecutable = dir.getChildFile("bin").getChildFile("Heavy").getChildFile("Heavy");
 #endif
 
     static void deleteTempFileLater(File script)
@@ -81,6 +83,48 @@ struct Toolchain {
         return process.readAllProcessOutput();
     }
 
+    // Script that builds heavy's C/C++ output for this computer, instead of for the exported target
+    // Used for running compiled patches inside plugdata, and for benchmarking them on the host
+    static String getHostBuildScript(Array<File> const& sourceDirectories, File const& output, bool sharedLibrary, String const& extraFlags = {})
+    {
+        auto const flags = " -O3 -ffast-math -fPIC -DNDEBUG " + extraFlags + " ";
+        auto const objectDirectory = output.getParentDirectory().getChildFile("obj-" + output.getFileNameWithoutExtension());
+
+#if JUCE_MAC
+        String script;
+        auto const cc = String("cc");
+        auto const cxx = String("c++");
+#elif JUCE_WINDOWS
+        auto const bin = dir.getChildFile("bin");
+        String script = "export PATH=\"$PATH:" + bin.getFullPathName().replaceCharacter('\\', '/') + "\"\n";
+        auto const cc = bin.getChildFile("gcc.exe").getFullPathName().replaceCharacter('\\', '/');
+        auto const cxx = bin.getChildFile("g++.exe").getFullPathName().replaceCharacter('\\', '/');
+#else // Linux or BSD
+        String script = dir.getChildFile("scripts").getChildFile("anywhere-setup.sh").getFullPathName() + "\n";
+        auto const cc = String("cc");
+        auto const cxx = String("c++");
+#endif
+
+        auto toShellPath = [](File const& file) {
+            return "\"" + file.getFullPathName().replaceCharacter('\\', '/') + "\"";
+        };
+
+        String includes;
+        for (auto const& directory : sourceDirectories)
+            includes << " -I" << toShellPath(directory);
+
+        script << "mkdir -p " << toShellPath(objectDirectory) << " && cd " << toShellPath(objectDirectory) << " || exit 1\n";
+        for (auto const& directory : sourceDirectories) {
+            if (directory.getNumberOfChildFiles(File::findFiles, "*.c"))
+                script << cc << " -std=c11" << flags << includes << " -c " << toShellPath(directory) << "/*.c || exit 1\n";
+            if (directory.getNumberOfChildFiles(File::findFiles, "*.cpp"))
+                script << cxx << " -std=c++17" << flags << includes << " -c " << toShellPath(directory) << "/*.cpp || exit 1\n";
+        }
+        script << cxx << (sharedLibrary ? " -shared" : "") << " -o " << toShellPath(output) << " *.o\n";
+
+        return script;
+    }
+
 private:
     inline static Array<File> tempFilesToDelete;
 };
@@ -147,7 +191,7 @@ public:
             downloadLocation += "Heavy-Linux-x64.zip";
 #endif
 
-            instream = URL(downloadLocation).createInputStream(URL::InputStreamOptions(URL::ParameterHandling::inAddress).withConnectionTimeoutMs(10000).withStatusCode(&statusCode));
+            downloadUrl = downloadLocation;
             startThread();
         };
     }
@@ -205,63 +249,44 @@ public:
 
     void run() override
     {
-        MemoryBlock toolchainData;
-
-        if (!instream)
-            return; // error!
-
-        int64 totalBytes = instream->getTotalLength();
-        int64 bytesDownloaded = 0;
+        // The archive is downloaded to a file instead of into memory, if the download gets interrupted that file is kept
+        // Retrying, or even restarting plugdata, then only downloads the part we don't have yet
+        auto const partialFile = ProjectInfo::appDataDir.getChildFile(".toolchain-" + String::toHexString(downloadUrl.hashCode64()) + ".part");
 
-        MemoryOutputStream mo(toolchainData, false);
-
-        // pre-allocate memory to improve download speed
-#if JUCE_MAC
-        mo.preallocate(1024 * 1024 * 128);
-#else
-        mo.preallocate(1024 * 1024 * 256);
-#endif
-
-        while (true) {
+        for (int attempt = 0;; attempt++) {
+            auto result = download(partialFile);
+            if (result.wasOk())
+                break;
 
-            // If app or windows gets closed
             if (threadShouldExit())
                 return;
 
-            // Download blocks of 1mb at a time
-            auto written = mo.writeFromInputStream(*instream, 1024 * 1024);
-
-            if (written == 0)
-                break;
-
-            bytesDownloaded += written;
-
-            float progress = static_cast<long double>(bytesDownloaded) / static_cast<long double>(totalBytes);
-
-            if (threadShouldExit())
+            if (attempt >= maxRetries) {
+                MessageManager::callAsync([this]() {
+                    installButton.topText = "Try Again";
+                    errorMessage = "Error: Could not download files (possibly no network connection)";
+                    installProgress = 0.0f;
+                    repaint();
+                });
                 return;
+            }
 
-            MessageManager::callAsync([_this = SafePointer(this), progress]() mutable {
-                if (!_this)
-                    return;
-                _this->installProgress = progress;
-                _this->repaint();
-            });
+            wait(1000 * (attempt + 1));
         }
 
         startTimer(25);
 
-        MemoryInputStream input(toolchainData, false);
-        ZipFile zip(input);
-
         auto toolchainDir = ProjectInfo::appDataDir.getChildFile("Toolchain");
 
         if (toolchainDir.exists())
             toolchainDir.deleteRecursively();
 
-        auto result = zip.uncompressTo(toolchainDir);
+        auto result = extract(partialFile, toolchainDir);
+
+        // If the archive was broken, the next attempt starts over
+        partialFile.deleteFile();
 
-        if (!result.wasOk() || (statusCode >= 400)) {
+        if (!result.wasOk()) {
             MessageManager::callAsync([this]() {
                 installButton.topText = "Try Again";
                 errorMessage = "Error: Could not extract downloaded package";
@@ -328,10 +353,118 @@ public:
         });
     }
 
+    // Appends the rest of the archive to partialFile
+    Result download(File const& partialFile)
+    {
+        auto const resumeFrom = partialFile.getSize();
+
+        int statusCode = 0;
+        auto options = URL::InputStreamOptions(URL::ParameterHandling::inAddress)
+                           .withConnectionTimeoutMs(10000)
+                           .withStatusCode(&statusCode);
+        if (resumeFrom > 0)
+            options = options.withExtraHeaders("Range: bytes=" + String(resumeFrom) + "-");
+
+        auto instream = URL(downloadUrl).createInputStream(options);
+        if (instream == nullptr || (statusCode != 200 && statusCode != 206))
+            return Result::fail("Failed to start download");
+
+        // Servers that don't support ranges send the whole file again
+        auto const bytesAlreadyDownloaded = statusCode == 206 ? resumeFrom : 0;
+        if (bytesAlreadyDownloaded == 0)
+            partialFile.deleteFile();
+
+        FileOutputStream output(partialFile);
+        if (!output.openedOk())
+            return Result::fail("Couldn't write to " + partialFile.getFullPathName());
+
+        auto const streamLength = instream->getTotalLength();
+        auto const totalBytes = bytesAlreadyDownloaded + streamLength;
+        auto bytesDownloaded = bytesAlreadyDownloaded;
+
+        while (true) {
+            // If app or windows gets closed
+            if (threadShouldExit())
+                return Result::fail("Download cancelled");
+
+            // Download blocks of 1mb at a time
+            auto written = output.writeFromInputStream(*instream, 1024 * 1024);
+
+            if (written <= 0)
+                break;
+
+            bytesDownloaded += written;
+
+            if (totalBytes <= 0)
+                continue;
+
+            float progress = static_cast<long double>(bytesDownloaded) / static_cast<long double>(totalBytes);
+
+            MessageManager::callAsync([_this = SafePointer(this), progress]() mutable {
+                if (!_this)
+                    return;
+                _this->installProgress = progress;
+                _this->repaint();
+            });
+        }
+
+        output.flush();
+
+        if (streamLength >= 0 && bytesDownloaded < totalBytes)
+            return Result::fail("Download was interrupted");
+
+        return Result::ok();
+    }
+
+    // Zip entries are compressed separately, so we can inflate them on all cores
+    // Every worker opens the archive itself, a ZipFile isn't safe to read from several threads
+    // Zip keeps its table of contents at the end of the file, so we can't start before the download is complete
+    static Result extract(File const& archive, File const& targetDirectory)
+    {
+        ZipFile index(archive);
+        auto const numEntries = index.getNumEntries();
+        if (numEntries == 0)
+            return Result::fail("Empty or broken archive");
+
+        // Create the directories first, otherwise two workers could race to create the same one
+        for (int entry = 0; entry < numEntries; entry++) {
+            auto const target = targetDirectory.getChildFile(index.getEntry(entry)->filename);
+
+            // An entry like "../x" or an absolute path would end up outside the toolchain directory
+            if (!target.isAChildOf(targetDirectory))
+                return Result::fail("Archive entry outside of the target directory: " + index.getEntry(entry)->filename);
+
+            if (!(index.getEntry(entry)->filename.endsWithChar('/') ? target : target.getParentDirectory()).createDirectory())
+                return Result::fail("Couldn't create " + target.getFullPathName());
+        }
+
+        auto const numWorkers = std::clamp(SystemStats::getNumCpus(), 1, 8);
+        std::atomic<int> nextEntry = 0;
+        std::atomic<bool> failed = false;
+
+        ThreadPool pool(numWorkers);
+        for (int worker = 0; worker < numWorkers; worker++) {
+            pool.addJob([&]() {
+                ZipFile zip(archive);
+                for (int entry = nextEntry++; entry < numEntries && !failed; entry = nextEntry++) {
+                    if (!zip.uncompressEntry(entry, targetDirectory).wasOk())
+                        failed = true;
+                }
+            });
+        }
+
+        while (pool.getNumJobs() > 0)
+            Thread::sleep(20);
+
+        return failed ? Result::fail("Could not extract downloaded package") : Result::ok();
+    }
+
     float installProgress = 0.0f;
 
     bool needsUpdate = false;
-    int statusCode;
+    String downloadUrl;
+
+    static constexpr int maxRetries = 3;
 
 #if JUCE_WINDOWS
     String downloadSize = "720 MB";
@@ -394,7 +527,6 @@ public:
 
     String errorMessage;
 
-    std::unique_ptr<InputStream> instream;
 
     PluginEditor* editor;
     Dialog* dialog;
@@ -478,9 +478,7 @@ void PlugDataLook::drawPopupMenuBackgroundWithOptions(Graphics& g, int width, in
     // which makes it really hard to decide whether they can be transparent or not!
     // We can check it in this function by checking options.getParentComponent, but unfortunately not everywhere
     if (Desktop::canUseSemiTransparentWindows()) {
-        Path shadowPath;
-        shadowPath.addRoundedRectangle(Rectangle<float>(0.0f, 0.0f, width, height).reduced(10.0f), Corners::defaultCornerRadius);
-        StackShadow::renderDropShadow(g, shadowPath, Colour(0, 0, 0).withAlpha(0.6f), 11, { 0, 1 });
+        StackShadow::renderDropShadow(g, Rectangle<float>(0.0f, 0.0f, width, height).reduced(10.0f), Corners::defaultCornerRadius, Colour(0, 0, 0).withAlpha(0.6f), 11, { 0, 1 });
 
         g.setColour(background);
 
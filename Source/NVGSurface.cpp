@@ -15,66 +15,17 @@ using namespace juce::gl;
 #endif
 
 #include "NVGSurface.h"
+#include "Utility/TraceRecorder.h"
+#include "Utility/StartupProfiler.h"
 
 #include "PluginEditor.h"
 #include "PluginProcessor.h"
 
-#define ENABLE_FPS_COUNT 0
-
-class FrameTimer {
-public:
-    FrameTimer()
-    {
-        startTime = getNow();
-        prevTime = startTime;
-    }
-
-    void render(NVGcontext* nvg)
-    {
-        nvgFillColor(nvg, nvgRGBA(40, 40, 40, 255));
-        nvgFillRect(nvg, 0, 0, 40, 22);
-
-        nvgFontSize(nvg, 20.0f);
-        nvgTextAlign(nvg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
-        nvgFillColor(nvg, nvgRGBA(240, 240, 240, 255));
-        char fpsBuf[16];
-        snprintf(fpsBuf, 16, "%d", static_cast<int>(round(1.0f / getAverageFrameTime())));
-        nvgText(nvg, 7, 2, fpsBuf, nullptr);
-    }
-    void addFrameTime()
-    {
-        auto timeSeconds = getTime();
-        auto dt = timeSeconds - prevTime;
-        perf_head = (perf_head + 1) % 32;
-        frame_times[perf_head] = dt;
-        prevTime = timeSeconds;
-    }
-
-    double getTime() { return getNow() - startTime; }
-
-private:
-    double getNow()
-    {
-        auto ticks = Time::getHighResolutionTicks();
-        return Time::highResolutionTicksToSeconds(ticks);
-    }
-
-    float getAverageFrameTime()
-    {
-        float avg = 0;
-        for (int i = 0; i < 32; i++) {
-            avg += frame_times[i];
-        }
-        return avg / (float)32;
-    }
-
-    float frame_times[32] = {};
-    int perf_head = 0;
-    double startTime = 0, prevTime = 0;
-};
+#define ENABLE_GPU_MEMORY_OVERLAY 0
 
 NVGSurface::NVGSurface(PluginEditor* e)
     : editor(e)
+    , resourceCache(std::make_unique<NVGResourceCache>())
 {
 #ifdef NANOVG_GL_IMPLEMENTATION
     glContext = std::make_unique<OpenGLContext>();
@@ -86,10 +37,6 @@ NVGSurface::NVGSurface(PluginEditor* e)
     glContext->setSwapInterval(0);
 #endif
 
-#if ENABLE_FPS_COUNT
-    frameTimer = std::make_unique<FrameTimer>();
-#endif
-
     setInterceptsMouseClicks(false, false);
     setWantsKeyboardFocus(false);
 
@@ -181,17 +128,67 @@ void NVGSurface::updateBufferSize()
     int scaledWidth = getWidth() * pixelScale;
     int scaledHeight = getHeight() * pixelScale;
 
-    if (fbWidth != scaledWidth || fbHeight != scaledHeight || !mainFBO) {
+#if NANOVG_GL_IMPLEMENTATION
+    auto const width = getFramebufferSizeClass(scaledWidth);
+    auto const height = getFramebufferSizeClass(scaledHeight);
+    auto const shrinkDelay = framebufferShrinkDelayMs;
+#else
+    // Metal draws the frame over the whole framebuffer, whatever its size, so it has to match the surface
+    auto const width = scaledWidth;
+    auto const height = scaledHeight;
+    auto const shrinkDelay = 0u;
+#endif
+
+    auto const tooSmall = width > fbWidth || height > fbHeight;
+    auto const tooLarge = width < fbWidth || height < fbHeight;
+
+    if (!tooLarge || tooSmall) {
+        framebufferShrinkTime = 0;
+    } else if (framebufferShrinkTime == 0) {
+        framebufferShrinkTime = jmax<uint32>(1, Time::getMillisecondCounter());
+    }
+
+    auto const shrink = framebufferShrinkTime != 0 && Time::getMillisecondCounter() - framebufferShrinkTime >= shrinkDelay;
+    if (tooSmall || shrink || !mainFBO) {
         if (invalidFBO)
             nvgDeleteFramebuffer(invalidFBO);
         if (mainFBO)
             nvgDeleteFramebuffer(mainFBO);
-        mainFBO = nvgCreateFramebuffer(nvg, scaledWidth, scaledHeight, NVG_IMAGE_PREMULTIPLIED);
-        invalidFBO = nvgCreateFramebuffer(nvg, scaledWidth, scaledHeight, NVG_IMAGE_PREMULTIPLIED);
-        fbWidth = scaledWidth;
-        fbHeight = scaledHeight;
-        invalidArea = getLocalBounds();
+        mainFBO = nvgCreateFramebuffer(nvg, width, height, NVG_IMAGE_PREMULTIPLIED);
+        invalidFBO = nvgCreateFramebuffer(nvg, width, height, NVG_IMAGE_PREMULTIPLIED);
+        fbWidth = width;
+        fbHeight = height;
+        framebufferShrinkTime = 0;
+        invalidTiles = RectangleList<int>(getLocalBounds());
     }
+
+    fbViewWidth = scaledWidth;
+    fbViewHeight = scaledHeight;
+}
+
+int NVGSurface::getFramebufferSizeClass(int size)
+{
+    // Four classes between every power of two, so at most a fifth of a framebuffer goes unused
+    auto const step = jmax(64, nextPowerOfTwo(jmax(size, 1)) / 8);
+    return (size + step - 1) / step * step;
+}
+
+void NVGSurface::setFramebufferViewport(int viewWidth, int viewHeight)
+{
+#if NANOVG_GL_IMPLEMENTATION
+    // Framebuffer images are flipped, so the top of the surface is at the top of the framebuffer
+    nvgViewport(0, fbHeight - viewHeight, viewWidth, viewHeight);
+#else
+    nvgViewport(0, 0, viewWidth, viewHeight);
+#endif
+}
+
+NVGpaint NVGSurface::getFramebufferPattern(NVGframebuffer* framebuffer, float x, float y)
+{
+    // The whole framebuffer, in the same units as the surface
+    auto const width = fbViewWidth > 0 ? getWidth() * static_cast<float>(fbWidth) / fbViewWidth : getWidth();
+    auto const height = fbViewHeight > 0 ? getHeight() * static_cast<float>(fbHeight) / fbViewHeight : getHeight();
+    return nvgImagePattern(nvg, x, y, width, height, 0, framebuffer->image, 1);
 }
 
 #ifdef NANOVG_GL_IMPLEMENTATION
@@ -205,6 +202,8 @@ void NVGSurface::timerCallback()
 
 void NVGSurface::lookAndFeelChanged()
 {
+    themeColours.update(*this);
+
     if (makeContextActive()) {
         NVGFramebuffer::clearAll(nvg);
         NVGImage::clearAll(nvg);
@@ -267,6 +266,9 @@ void NVGSurface::updateBounds(Rectangle<int> bounds)
 
 void NVGSurface::resized()
 {
+    // Make sure the next frame picks up the new buffer size
+    invalidateAll();
+
 #ifdef NANOVG_METAL_IMPLEMENTATION
     if (auto* view = getView()) {
         auto renderScale = getRenderScale();
@@ -279,28 +281,221 @@ void NVGSurface::resized()
 
 void NVGSurface::invalidateAll()
 {
-    invalidArea = invalidArea.getUnion(getLocalBounds());
+    invalidTiles.add(getLocalBounds());
+}
+
+void NVGSurface::toggleFrameProfiler()
+{
+    frameProfiler.setEnabled(!frameProfiler.isEnabled());
+
+    // The overlay is drawn over the finished frame, so to remove it we only need to swap again
+    needsBufferSwap = true;
+}
+
+void NVGSurface::scrollArea(Rectangle<int> area, Point<int> delta)
+{
+    area = area.getIntersection(getLocalBounds());
+    deferredInvalidations.subtract(area);
+
+    if (area.isEmpty() || delta.isOrigin())
+        return;
+
+    // We can only shift one area per frame, and there's nothing to reuse if it scrolled further than its own size
+    auto const totalDelta = scrollDelta + delta;
+    if ((!scrollDelta.isOrigin() && area != scrollingArea) || std::abs(totalDelta.x) >= area.getWidth() || std::abs(totalDelta.y) >= area.getHeight()) {
+        if (area == scrollingArea)
+            scrollDelta = {};
+        invalidateArea(area);
+        return;
+    }
+
+    scrollingArea = area;
+    scrollDelta = totalDelta;
+
+    // Tiles that were still waiting to be drawn move along with the content
+    RectangleList<int> movedTiles;
+    for (auto const& tile : invalidTiles) {
+        if (tile.intersects(area))
+            movedTiles.addWithoutMerging(tile.translated(delta.x, delta.y).getIntersection(area));
+    }
+
+    // And the strips that scrolled into view need to be drawn
+    RectangleList<int> exposed(area);
+    exposed.subtract(area.translated(delta.x, delta.y));
+    movedTiles.addList(exposed);
+
+    for (auto const& tile : movedTiles)
+        invalidateArea(tile);
+}
+
+void NVGSurface::invalidateAreaUnlessScrolled(Rectangle<int> area)
+{
+    deferredInvalidations.add(area);
+}
+
+void NVGSurface::copyToFramebuffer(NVGFramebuffer& target, Rectangle<int> area)
+{
+    if (!mainFBO || area.isEmpty())
+        return;
+
+    auto const pixelScale = getRenderScale();
+    auto const desktopScale = Desktop::getInstance().getGlobalScaleFactor();
+    auto const devicePixelScale = pixelScale / desktopScale;
+    int const width = area.getWidth() * pixelScale;
+    int const height = area.getHeight() * pixelScale;
+
+    target.renderToFramebuffer(nvg, width, height, [this, area, width, height, desktopScale, devicePixelScale](NVGcontext* nvg) {
+        nvgViewport(0, 0, width, height);
+        nvgClear(nvg);
+        nvgBeginFrame(nvg, area.getWidth() * desktopScale, area.getHeight() * desktopScale, devicePixelScale);
+        nvgScale(nvg, desktopScale, desktopScale);
+        nvgBeginPath(nvg);
+        nvgFillPaint(nvg, getFramebufferPattern(mainFBO, -area.getX(), -area.getY()));
+        nvgFillRect(nvg, 0, 0, area.getWidth(), area.getHeight());
+        nvgEndFrame(nvg);
+    });
+}
+
+void NVGSurface::renderScrolledArea(int viewWidth, int viewHeight, float desktopScale, float devicePixelScale)
+{
+    auto const delta = std::exchange(scrollDelta, {});
+    if (delta.isOrigin() || invalidTiles.containsRectangle(scrollingArea))
+        return;
+
+    // Shifting by a fraction of a pixel would blur everything, so just draw it again
+    auto const physicalDelta = delta.toFloat() * devicePixelScale * desktopScale;
+    if (!approximatelyEqual(physicalDelta.x, std::round(physicalDelta.x)) || !approximatelyEqual(physicalDelta.y, std::round(physicalDelta.y))) {
+        invalidateArea(scrollingArea);
+        return;
+    }
+
+    auto const destination = scrollingArea.getIntersection(scrollingArea.translated(delta.x, delta.y));
+
+    // Framebuffers can't be drawn onto themselves, so go through invalidFBO
+    nvgBindFramebuffer(invalidFBO);
+    setFramebufferViewport(viewWidth, viewHeight);
+    nvgClear(nvg);
+    nvgBeginFrame(nvg, getWidth() * desktopScale, getHeight() * desktopScale, devicePixelScale);
+    nvgScale(nvg, desktopScale, desktopScale);
+    nvgBeginPath(nvg);
+    nvgScissor(nvg, destination.getX(), destination.getY(), destination.getWidth(), destination.getHeight());
+    nvgFillPaint(nvg, getFramebufferPattern(mainFBO, delta.x, delta.y));
+    nvgFillRect(nvg, destination.getX(), destination.getY(), destination.getWidth(), destination.getHeight());
+    nvgEndFrame(nvg);
+
+    nvgBindFramebuffer(mainFBO);
+#if NANOVG_GL_IMPLEMENTATION
+    setFramebufferViewport(viewWidth, viewHeight);
+    nvgBeginFrame(nvg, getWidth(), getHeight(), devicePixelScale);
+#else
+    nvgBeginFrame(nvg, getWidth() * desktopScale, getHeight() * desktopScale, devicePixelScale);
+    nvgScale(nvg, desktopScale, desktopScale);
+#endif
+    nvgBeginPath(nvg);
+    nvgScissor(nvg, destination.getX(), destination.getY(), destination.getWidth(), destination.getHeight());
+    nvgFillPaint(nvg, getFramebufferPattern(invalidFBO, 0, 0));
+    nvgFillRect(nvg, destination.getX(), destination.getY(), destination.getWidth(), destination.getHeight());
+    nvgEndFrame(nvg);
+
+    nvgBindFramebuffer(nullptr);
+    needsBufferSwap = true;
 }
 
 void NVGSurface::invalidateArea(Rectangle<int> area)
 {
-    invalidArea = invalidArea.getUnion(area);
+    if (area.isEmpty())
+        return;
+
+    // Snap to the tile grid, so that small repaints that are close together end up in the same tile
+    auto const left = (area.getX() >= 0 ? area.getX() / tileSize : (area.getX() - tileSize + 1) / tileSize) * tileSize;
+    auto const top = (area.getY() >= 0 ? area.getY() / tileSize : (area.getY() - tileSize + 1) / tileSize) * tileSize;
+    auto const right = ((area.getRight() + tileSize - 1) / tileSize) * tileSize;
+    auto const bottom = ((area.getBottom() + tileSize - 1) / tileSize) * tileSize;
+
+    auto const tiles = Rectangle<int>::leftTopRightBottom(left, top, right, bottom).getIntersection(getLocalBounds());
+    if (!tiles.isEmpty())
+        invalidTiles.add(tiles);
+}
+
+uint32 NVGSurface::getMinimumFrameInterval()
+{
+    // With many editors open, only the one that's being used needs to run at full speed
+    if (!Process::isForegroundProcess())
+        return backgroundFrameInterval;
+
+    auto* focused = Component::getCurrentlyFocusedComponent();
+    if (editor->isMouseOverOrDragging(true) || (focused && (focused == editor || editor->isParentOf(focused))))
+        return 0;
+
+    return backgroundFrameInterval;
+}
+
+bool NVGSurface::needsRender()
+{
+    if (!nvg || resizing)
+        return true;
+
+    if (Time::getMillisecondCounter() - lastFrameTime < getMinimumFrameInterval())
+        return false;
+
+    if (!invalidTiles.isEmpty() || needsBufferSwap || framebuffersPending || frameProfiler.isEnabled())
+        return true;
+
+    if (editor->pd->messageDispatcher->hasPendingMessages())
+        return true;
+
+    // Moved to a screen with a different scale
+    return std::abs(lastRenderScale - calculateRenderScale()) > 0.1f;
 }
 
 void NVGSurface::render()
 {
-    // Flush message queue before rendering, to make sure all GUIs are up-to-date
-    editor->pd->flushMessageQueue();
-    
-#if ENABLE_FPS_COUNT
-    frameTimer->addFrameTime();
-#endif
+    if (!getPeer())
+        return;
 
-    auto startTime = Time::getMillisecondCounter();
-    
-    if(!getPeer()) {
+    // Let object GUIs that poll pd update right before we render
+    editor->frameScheduler.tick();
+
+    for (auto const& area : deferredInvalidations)
+        invalidateArea(area);
+    deferredInvalidations.clear();
+
+    // Hidden windows don't render, but still empty the message queue now and then so it doesn't keep growing
+    if (!isShowing() || getPeer()->isMinimised()) {
+        if (editor->pd->messageDispatcher->hasPendingMessages() && Time::getMillisecondCounter() - lastFrameTime >= backgroundFrameInterval) {
+            lastFrameTime = Time::getMillisecondCounter();
+            editor->pd->flushMessageQueue();
+        }
+        wasHidden = true;
         return;
     }
+
+    // Objects in this window were paused while it was minimised
+    if (wasHidden) {
+        wasHidden = false;
+        editor->pd->setThis();
+        editor->pd->messageDispatcher->resumePausedListeners();
+        invalidateAll();
+    }
+
+    // Nothing changed, so don't wake up the GPU
+    if (!needsRender())
+        return;
+
+    lastFrameTime = Time::getMillisecondCounter();
+    TraceRecorder::Scope trace("NVGSurface::render");
+
+    if (frameProfiler.isEnabled())
+        frameProfiler.startFrame();
+
+    // Flush message queue before rendering, to make sure all GUIs are up-to-date
+    {
+        FrameProfiler::Scope scope(&frameProfiler, FrameProfiler::FlushMessages);
+        editor->pd->flushMessageQueue();
+    }
+
+    auto startTime = Time::getMillisecondCounter();
+    NVGResourceUsage::currentFrame++;
     
     if (!nvg) {
         initialise();
@@ -315,8 +510,18 @@ void NVGSurface::render()
     
     if(std::abs(lastRenderScale - pixelScale) > 0.1f)
     {
+#if NANOVG_GL_IMPLEMENTATION
+        // Moved to a screen with a different scale. The context and its fonts don't depend on the scale,
+        // only the images we drew at the old scale do. The framebuffers are resized below if they have to be
+        lastRenderScale = pixelScale;
+        NVGFramebuffer::clearAll(nvg);
+        NVGImage::clearAll(nvg);
+        invalidateAll();
+#else
+        // The Metal layer gets its scale when the context is created
         detachContext();
         return; // Render on next frame
+#endif
     }
     
 #if NANOVG_METAL_IMPLEMENTATION
@@ -332,44 +537,82 @@ void NVGSurface::render()
 #endif
     
     updateBufferSize();
+
+    renderScrolledArea(viewWidth, viewHeight, desktopScale, devicePixelScale);
+
+    // Zoom gestures start from a copy of what's on screen right now, so take it before we draw anything over it
+    for (auto* cnv : editor->getTabComponent().getVisibleCanvases())
+        cnv->updateZoomSnapshot(nvg);
     
-    if (!invalidArea.isEmpty()) {
-        // First, draw only the invalidated region to a separate framebuffer
+    if (!invalidTiles.isEmpty()) {
+        invalidTiles.consolidate();
+
+        // Every tile walks the canvas again, so if a lot of the surface changed, it's cheaper to render bigger areas at once
+        // We still cut it into bands, so that we can stop halfway if drawing takes too long
+        if (invalidTiles.getNumRectangles() > maxTilesPerFrame) {
+            auto area = invalidTiles.getBounds();
+            invalidTiles.clear();
+            while (!area.isEmpty())
+                invalidTiles.addWithoutMerging(area.removeFromTop(tileSize * 2));
+        }
+
+        // Tiles that didn't fit in this frame's time budget are rendered on the next frame
+        // Rendering can invalidate more tiles, so iterate over a copy
+        auto const tilesToRender = invalidTiles;
+        RectangleList<int> renderedTiles;
+
+        // First, draw only the invalidated tiles to a separate framebuffer
         // I've found that nvgScissor doesn't always clip everything, meaning that there will be graphical glitches if we don't do this
         nvgBindFramebuffer(invalidFBO);
-        nvgViewport(0, 0, viewWidth, viewHeight);
+        setFramebufferViewport(viewWidth, viewHeight);
         nvgClear(nvg);
 
         nvgBeginFrame(nvg, getWidth() * desktopScale, getHeight() * desktopScale, devicePixelScale);
         nvgScale(nvg, desktopScale, desktopScale);
-        nvgScissor(nvg, invalidArea.getX(), invalidArea.getY(), invalidArea.getWidth(), invalidArea.getHeight());
-        editor->renderArea(nvg, invalidArea);
-        nvgEndFrame(nvg);
+        for (auto const& tile : tilesToRender) {
+            // Always draw at least one tile, so we keep making progress
+            if (!renderedTiles.isEmpty() && Time::getMillisecondCounter() - startTime >= maxRenderTimeMs)
+                break;
+
+            NVGScopedState scopedState(nvg);
+            invalidArea = tile;
+            nvgScissor(nvg, tile.getX(), tile.getY(), tile.getWidth(), tile.getHeight());
+            editor->renderArea(nvg, tile);
+            renderedTiles.addWithoutMerging(tile);
+        }
+
+        {
+            FrameProfiler::Scope scope(&frameProfiler, FrameProfiler::Present);
+            nvgEndFrame(nvg);
+        }
 
         nvgBindFramebuffer(mainFBO);
 #if NANOVG_GL_IMPLEMENTATION
-        nvgViewport(0, 0, viewWidth, viewHeight);
+        setFramebufferViewport(viewWidth, viewHeight);
         nvgBeginFrame(nvg, getWidth(), getHeight(), devicePixelScale);
 #else
         nvgBeginFrame(nvg, getWidth() * desktopScale, getHeight() * desktopScale, devicePixelScale);
         nvgScale(nvg, desktopScale, desktopScale);
 #endif
-        nvgBeginPath(nvg);
-        nvgScissor(nvg, invalidArea.getX(), invalidArea.getY(), invalidArea.getWidth(), invalidArea.getHeight());
-
-        nvgFillPaint(nvg, nvgImagePattern(nvg, 0, 0, getWidth(), getHeight(), 0, invalidFBO->image, 1));
-        nvgFillRect(nvg, invalidArea.getX(), invalidArea.getY(), invalidArea.getWidth(), invalidArea.getHeight());
+        auto const invalidImage = getFramebufferPattern(invalidFBO, 0, 0);
+        for (auto const& tile : renderedTiles) {
+            nvgBeginPath(nvg);
+            nvgScissor(nvg, tile.getX(), tile.getY(), tile.getWidth(), tile.getHeight());
+            nvgFillPaint(nvg, invalidImage);
+            nvgFillRect(nvg, tile.getX(), tile.getY(), tile.getWidth(), tile.getHeight());
 
 #if ENABLE_FB_DEBUGGING
-        static Random rng;
-        nvgFillColor(nvg, nvgRGBA(rng.nextInt(255), rng.nextInt(255), rng.nextInt(255), 0x50));
-        nvgFillRect(nvg, 0, 0, getWidth(), getHeight());
+            static Random rng;
+            nvgFillColor(nvg, nvgRGBA(rng.nextInt(255), rng.nextInt(255), rng.nextInt(255), 0x50));
+            nvgFillRect(nvg, 0, 0, getWidth(), getHeight());
 #endif
+        }
 
         nvgEndFrame(nvg);
 
         nvgBindFramebuffer(nullptr);
         needsBufferSwap = true;
+        invalidTiles.subtract(renderedTiles);
         invalidArea = Rectangle<int>(0, 0, 0, 0);
     }
 
@@ -387,15 +630,22 @@ void NVGSurface::render()
         nvgFillColor(nvg, nvgRGB(backgroundColour.getRed(), backgroundColour.getGreen(), backgroundColour.getBlue()));
         nvgFillRect(nvg, -10, -10, getWidth() + 10, getHeight() + 10);
 
-        nvgFillPaint(nvg, nvgImagePattern(nvg, 0, 0, getWidth(), getHeight(), 0, mainFBO->image, 1));
+        nvgFillPaint(nvg, getFramebufferPattern(mainFBO, 0, 0));
         nvgFillRect(nvg, 0, 0, getWidth(), getHeight());
         
-#if ENABLE_FPS_COUNT
+        if (frameProfiler.isEnabled()) {
+            nvgSave(nvg);
+            frameProfiler.render(nvg, 8.0f, 8.0f);
+            nvgRestore(nvg);
+        }
+
+#if ENABLE_GPU_MEMORY_OVERLAY
         nvgSave(nvg);
-        frameTimer->render(nvg);
+        renderMemoryOverlay();
         nvgRestore(nvg);
 #endif
 
+        FrameProfiler::Scope scope(&frameProfiler, FrameProfiler::Present);
         nvgEndFrame(nvg);
 
 #ifdef NANOVG_GL_IMPLEMENTATION
@@ -408,14 +658,108 @@ void NVGSurface::render()
             startTimerHz(60);
 #endif
         needsBufferSwap = false;
+
+        StartupProfiler::mark("First frame");
+        StartupProfiler::finish();
     }
 
     auto elapsed = Time::getMillisecondCounter() - startTime;
     // We update frambuffers after we call swapBuffers to make sure the frame is on time
+    framebuffersPending = false;
     if (elapsed < 14) {
+        FrameProfiler::Scope scope(&frameProfiler, FrameProfiler::UpdateFramebuffers);
         for (auto* cnv : editor->getTabComponent().getVisibleCanvases()) {
-            cnv->updateFramebuffers(nvg, cnv->getLocalBounds(), 14 - elapsed);
+            framebuffersPending |= !cnv->updateFramebuffers(nvg, cnv->getLocalBounds(), 14 - elapsed);
         }
+    } else {
+        framebuffersPending = true;
+    }
+
+    if (frameProfiler.isEnabled()) {
+        frameProfiler.endFrame();
+        needsBufferSwap = true; // Keep the overlay moving, even when nothing else changes
+    }
+
+    if (++framesSinceBudgetCheck >= framesPerBudgetCheck) {
+        framesSinceBudgetCheck = 0;
+        enforceMemoryBudget();
+    }
+}
+
+void NVGSurface::enforceMemoryBudget()
+{
+    struct Resource {
+        NVGResourceUsage const* usage;
+        size_t size;
+        std::function<void()> evict;
+    };
+
+    std::vector<Resource> evictable;
+    size_t totalSize = 0;
+
+    auto addResource = [this, &evictable, &totalSize](auto* resource) {
+        auto const size = resource->getMemorySize();
+        if (resource->nvg != nvg || !size)
+            return;
+
+        totalSize += size;
+        if (NVGResourceUsage::currentFrame - resource->usage.lastDrawnFrame >= minFramesUnused)
+            evictable.push_back({ &resource->usage, size, [resource]() { resource->evict(); } });
+    };
+
+    for (auto* image : NVGImage::allImages)
+        addResource(image);
+    for (auto* framebuffer : NVGFramebuffer::allFramebuffers)
+        addResource(framebuffer);
+
+    if (totalSize <= memoryBudget)
+        return;
+
+    std::sort(evictable.begin(), evictable.end(), [](Resource const& a, Resource const& b) {
+        return a.usage->lastDrawnFrame < b.usage->lastDrawnFrame;
+    });
+
+    for (auto& resource : evictable) {
+        if (totalSize <= memoryBudget)
+            break;
+
+        resource.evict();
+        totalSize -= resource.size;
+    }
+}
+
+void NVGSurface::renderMemoryOverlay()
+{
+    std::map<void const*, size_t> sizePerOwner;
+    auto addResource = [this, &sizePerOwner](auto* resource) {
+        if (resource->nvg == nvg)
+            sizePerOwner[resource->usage.owner] += resource->getMemorySize();
+    };
+
+    for (auto* image : NVGImage::allImages)
+        addResource(image);
+    for (auto* framebuffer : NVGFramebuffer::allFramebuffers)
+        addResource(framebuffer);
+
+    StringArray lines;
+    size_t totalSize = 0;
+    for (auto* cnv : editor->getTabComponent().getVisibleCanvases()) {
+        lines.add(cnv->patch.getTitle() + ": " + String(sizePerOwner[cnv] / (1024.0 * 1024.0), 1) + " MB");
+        sizePerOwner.erase(cnv);
+    }
+    for (auto const& [owner, size] : sizePerOwner)
+        totalSize += size;
+    lines.add("Other: " + String(totalSize / (1024.0 * 1024.0), 1) + " MB");
+
+    nvgFillColor(nvg, nvgRGBA(40, 40, 40, 200));
+    nvgFillRect(nvg, 0, getHeight() - lines.size() * 16 - 8, 220, lines.size() * 16 + 8);
+
+    nvgFontFace(nvg, "Inter-Tabular");
+    nvgFontSize(nvg, 13.0f);
+    nvgTextAlign(nvg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+    nvgFillColor(nvg, nvgRGBA(240, 240, 240, 255));
+    for (int i = 0; i < lines.size(); i++) {
+        nvgText(nvg, 6, getHeight() - (lines.size() - i) * 16 - 4, lines[i].toRawUTF8(), nullptr);
     }
 }
 
@@ -12,6 +12,8 @@ using namespace juce::gl;
 
 #include "Utility/Config.h"
 #include "Utility/SettingsFile.h"
+#include "Constants.h"
+#include "Utility/FrameProfiler.h"
 
 #include <nanovg.h>
 #ifdef NANOVG_GL_IMPLEMENTATION
@@ -20,8 +22,79 @@ using namespace juce::gl;
 #    define NANOVG_GL_IMPLEMENTATION 1
 #endif
 
-class FrameTimer;
+class NVGResourceCache;
+class NVGFramebuffer;
 class PluginEditor;
+
+// Theme colours, converted to NVGcolor once whenever the look and feel changes
+// Rendering code looks them up by their PlugDataColour id, instead of asking the look and feel and converting the result every frame
+class NVGColourTable {
+public:
+    void update(Component& component)
+    {
+        for (int colourId = 0; colourId < PlugDataColour::numberOfColours; colourId++) {
+            auto const colour = component.findColour(colourId);
+            colours[colourId] = nvgRGBA(colour.getRed(), colour.getGreen(), colour.getBlue(), colour.getAlpha());
+        }
+        version = ++lastVersion;
+    }
+
+    NVGcolor operator[](PlugDataColour colourId) const { return colours[colourId]; }
+
+    bool isValid() const { return version != 0; }
+
+    // Goes up whenever any table is updated, colours derived from the table can compare it to know when to recalculate
+    uint32 getVersion() const { return version; }
+
+private:
+    std::array<NVGcolor, PlugDataColour::numberOfColours> colours {};
+    uint32 version = 0;
+    inline static uint32 lastVersion = 0;
+};
+
+// Object colours are stored as strings in a Value, this only parses them again when the string changes
+// Colours in a TypedValue are already parsed, then we only convert them again when the colour changes
+class NVGCachedColour {
+public:
+    Colour get(TypedValue<Colour> const& value)
+    {
+        auto const& newColour = value.get();
+        if (newColour != colour) {
+            colour = newColour;
+            nvgColour = nvgRGBA(colour.getRed(), colour.getGreen(), colour.getBlue(), colour.getAlpha());
+        }
+        return colour;
+    }
+
+    NVGcolor getNVG(TypedValue<Colour> const& value)
+    {
+        get(value);
+        return nvgColour;
+    }
+
+    Colour get(Value const& value)
+    {
+        auto const text = value.toString();
+        if (text != source) {
+            source = text;
+            colour = Colour::fromString(text);
+            nvgColour = nvgRGBA(colour.getRed(), colour.getGreen(), colour.getBlue(), colour.getAlpha());
+        }
+        return colour;
+    }
+
+    NVGcolor getNVG(Value const& value)
+    {
+        get(value);
+        return nvgColour;
+    }
+
+private:
+    String source;
+    Colour colour;
+    NVGcolor nvgColour = nvgRGBA(0, 0, 0, 0);
+};
+
 class NVGSurface :
 #if NANOVG_METAL_IMPLEMENTATION && JUCE_MAC
     public NSViewComponent
@@ -97,13 +170,53 @@ public:
     void invalidateArea(Rectangle<int> area);
     void invalidateAll();
 
+    // The content of area moved by delta, so the next frame shifts what we already rendered, and only draws the strips that scrolled into view
+    void scrollArea(Rectangle<int> area, Point<int> delta);
+
+    // Invalidates area on the next frame, unless that area gets scrolled before then
+    // Moving a viewport's content repaints the whole viewport before we hear about the scroll, this lets us skip that repaint
+    void invalidateAreaUnlessScrolled(Rectangle<int> area);
+
+    // Copies part of the last rendered frame into target
+    void copyToFramebuffer(NVGFramebuffer& target, Rectangle<int> area);
+
     NVGcontext* getRawContext() { return nvg; }
 
     static NVGSurface* getSurfaceForContext(NVGcontext*);
 
+    NVGResourceCache& getResourceCache() { return *resourceCache; }
+
+    NVGColourTable const& getThemeColours()
+    {
+        if (!themeColours.isValid())
+            themeColours.update(*this);
+
+        return themeColours;
+    }
+
+    NVGcolor getThemeColour(PlugDataColour colourId) { return getThemeColours()[colourId]; }
+
+    FrameProfiler& getFrameProfiler() { return frameProfiler; }
+    void toggleFrameProfiler();
+
 private:
     
     float calculateRenderScale() const;
+
+    void renderScrolledArea(int viewWidth, int viewHeight, float desktopScale, float devicePixelScale);
+
+    // mainFBO and invalidFBO can be larger than the surface, these only draw into and read from the part that we use
+    void setFramebufferViewport(int viewWidth, int viewHeight);
+    NVGpaint getFramebufferPattern(NVGframebuffer* framebuffer, float x, float y);
+    static int getFramebufferSizeClass(int size);
+
+    // Deletes the offscreen images that were drawn least recently, until we're back under budget
+    void enforceMemoryBudget();
+    void renderMemoryOverlay();
+
+    // Frame pacing: returns false when a frame would look exactly the same as the last one
+    bool needsRender();
+    uint32 getMinimumFrameInterval();
     
     void resized() override;
 
@@ -112,10 +225,26 @@ private:
     bool needsBufferSwap = false;
     std::unique_ptr<VBlankAttachment> vBlankAttachment;
 
-    Rectangle<int> invalidArea;
+    // Invalidated parts of the surface, rounded out to whole tiles
+    // Only these get re-rendered, everything else is kept from the last frame in mainFBO
+    static constexpr int tileSize = 128;
+    static constexpr int maxTilesPerFrame = 24;
+    static constexpr uint32 maxRenderTimeMs = 10; // After this, the remaining tiles wait for the next frame so we don't hold up the message thread
+    RectangleList<int> invalidTiles;
+
+    Rectangle<int> invalidArea; // Area that is currently being rendered
+    RectangleList<int> deferredInvalidations;
+    Rectangle<int> scrollingArea;
+    Point<int> scrollDelta;
+
+    // Allocated in size classes, so resizing only creates new framebuffers when the surface outgrows them
+    // When it gets smaller, we wait a while before giving memory back, in case it's resized again
     NVGframebuffer* mainFBO = nullptr;
     NVGframebuffer* invalidFBO = nullptr;
-    int fbWidth = 0, fbHeight = 0;
+    int fbWidth = 0, fbHeight = 0;         // Allocated size
+    int fbViewWidth = 0, fbViewHeight = 0; // Size of the surface in pixels
+    uint32 framebufferShrinkTime = 0;      // When the surface first became small enough for smaller framebuffers, 0 if it isn't
+    static constexpr uint32 framebufferShrinkDelayMs = 2000;
 
     static inline std::map<NVGcontext*, NVGSurface*> surfaces;
 
@@ -124,12 +253,32 @@ private:
     Rectangle<int> newBounds;
 
     float lastRenderScale = 0.0f;
+
+    uint32 lastFrameTime = 0;
+    bool framebuffersPending = false;
+    bool wasHidden = false;
+
+    // iPads and integrated GPUs share their memory with everything else, so offscreen images get a fixed budget per surface
+#if JUCE_IOS
+    static constexpr size_t memoryBudget = 96 * 1024 * 1024;
+#else
+    static constexpr size_t memoryBudget = 384 * 1024 * 1024;
+#endif
+    static constexpr uint32 framesPerBudgetCheck = 60;
+    static constexpr uint32 minFramesUnused = 4; // Never evict what was drawn in the last few frames, so we don't rebuild images we're still drawing
+    uint32 framesSinceBudgetCheck = 0;
+
+    // Windows that don't have focus can get away with a lower frame rate
+    static constexpr uint32 backgroundFrameInterval = 33;
     
 #if NANOVG_GL_IMPLEMENTATION
     std::unique_ptr<OpenGLContext> glContext;
 #endif
 
-    std::unique_ptr<FrameTimer> frameTimer;
+    FrameProfiler frameProfiler;
+
+    std::unique_ptr<NVGResourceCache> resourceCache;
+    NVGColourTable themeColours;
 };
 
 class NVGComponent {
@@ -178,6 +327,71 @@ public:
         }
     }
 
+    // Builds a path through a polyline, without adding more points than can be seen
+    // Consecutive points that fall in the same pixel column are reduced to their lowest and highest point, in the order they occur
+    // That keeps the outline of dense waveforms, while the stroke only has to be tessellated for a few points per pixel
+    static void setPolylinePath(NVGcontext* nvg, float const* xs, float const* ys, int numPoints)
+    {
+        nvgBeginPath(nvg);
+
+        int column = 0;
+        bool hasColumn = false;
+        Point<float> low, high, lastPoint;
+        bool lowFirst = true;
+
+        auto addPoint = [nvg, started = false, &lastPoint](Point<float> point) mutable {
+            // Points that are less than half a pixel apart won't be visible
+            if (started && point.getDistanceSquaredFrom(lastPoint) < 0.25f)
+                return;
+
+            if (started)
+                nvgLineTo(nvg, point.x, point.y);
+            else
+                nvgMoveTo(nvg, point.x, point.y);
+
+            started = true;
+            lastPoint = point;
+        };
+
+        auto flushColumn = [&]() {
+            if (!hasColumn)
+                return;
+
+            addPoint(lowFirst ? low : high);
+            addPoint(lowFirst ? high : low);
+        };
+
+        for (int i = 0; i < numPoints; i++) {
+            auto const point = Point<float>(xs[i], ys[i]);
+            if (!point.isFinite())
+                continue;
+
+            auto const pointColumn = static_cast<int>(std::floor(point.x));
+            if (hasColumn && pointColumn == column) {
+                if (point.y < low.y) {
+                    low = point;
+                    lowFirst = false;
+                }
+                if (point.y > high.y) {
+                    high = point;
+                    lowFirst = true;
+                }
+                continue;
+            }
+
+            flushColumn();
+
+            // Start every column where the previous segment ended, so the line stays connected
+            addPoint(point);
+            column = pointColumn;
+            hasColumn = true;
+            low = high = point;
+            lowFirst = true;
+        }
+
+        flushColumn();
+    }
+
     virtual void render(NVGcontext*) {};
 
 private:
@@ -186,6 +400,39 @@ private:
     JUCE_DECLARE_WEAK_REFERENCEABLE(NVGComponent)
 };
 
+// Remembers when, and for which canvas, an offscreen image was last drawn
+// NVGSurface uses this to stay within its GPU memory budget, by deleting the images that haven't been drawn for the longest time
+// Everything that owns an NVGImage or NVGFramebuffer already renders it again when it's invalid, so that's all eviction has to do
+struct NVGResourceUsage {
+    void markDrawn()
+    {
+        lastDrawnFrame = currentFrame;
+        owner = currentOwner;
+    }
+
+    // Attributes what gets drawn to a canvas, for the memory overlay
+    struct ScopedOwner {
+        explicit ScopedOwner(void const* newOwner)
+            : previousOwner(currentOwner)
+        {
+            currentOwner = newOwner;
+        }
+
+        ~ScopedOwner()
+        {
+            currentOwner = previousOwner;
+        }
+
+        void const* previousOwner;
+    };
+
+    uint32 lastDrawnFrame = 0;
+    void const* owner = nullptr;
+
+    static inline uint32 currentFrame = 0;
+    static inline void const* currentOwner = nullptr;
+};
+
 class NVGImage {
 public:
     NVGImage(NVGcontext* nvg, int width, int height, std::function<void(Graphics&)> renderCall)
@@ -321,6 +568,7 @@ public:
     void render(NVGcontext* nvg, Rectangle<int> b)
     {
         if (imageId) {
+            usage.markDrawn();
             nvgFillPaint(nvg, nvgImagePattern(nvg, 0, 0, b.getWidth(), b.getHeight(), 0, imageId, 1));
             nvgFillRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight());
         }
@@ -333,9 +581,27 @@ public:
 
     int getImageId()
     {
+        usage.markDrawn();
         return imageId;
     }
 
+    size_t getMemorySize() const
+    {
+        return imageId ? static_cast<size_t>(imageWidth) * imageHeight * 4 : 0;
+    }
+
+    // Frees the texture, whoever owns the image will render it again the next time it's needed
+    void evict()
+    {
+        if (!imageId)
+            return;
+
+        nvgDeleteImage(nvg, imageId);
+        imageId = 0;
+        if (onImageInvalidate)
+            onImageInvalidate();
+    }
+
     void setDirty()
     {
         isDirty = true;
@@ -347,6 +613,7 @@ public:
     bool isDirty = false;
 
     std::function<void()> onImageInvalidate = nullptr;
+    NVGResourceUsage usage;
 
     static inline std::set<NVGImage*> allImages;
 };
@@ -426,6 +693,7 @@ public:
     void render(NVGcontext* nvg, Rectangle<int> b)
     {
         if (fb) {
+            usage.markDrawn();
             nvgFillPaint(nvg, nvgImagePattern(nvg, 0, 0, b.getWidth(), b.getHeight(), 0, fb->image, 1));
             nvgFillRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight());
         }
@@ -436,13 +704,30 @@ public:
         if (!fb)
             return -1;
 
+        usage.markDrawn();
         return fb->image;
     }
 
+    size_t getMemorySize() const
+    {
+        return fb ? static_cast<size_t>(fbWidth) * fbHeight * 4 : 0;
+    }
+
+    void evict()
+    {
+        if (fb) {
+            nvgDeleteFramebuffer(fb);
+            fb = nullptr;
+        }
+    }
+
+    NVGResourceUsage usage;
+
 private:
+    friend class NVGSurface;
     static inline std::set<NVGFramebuffer*> allFramebuffers;
 
-    NVGcontext* nvg;
+    NVGcontext* nvg = nullptr;
     NVGframebuffer* fb = nullptr;
     int fbWidth, fbHeight;
     bool fbDirty = false;
@@ -462,3 +747,217 @@ struct NVGScopedState
     
     NVGcontext* nvg;
 };
+
+// A JUCE path converted to nanovg commands once, for paths that are drawn every frame but rarely change
+// Drawing it doesn't need to copy the JUCE path or walk it with an iterator
+class NVGCachedPath {
+public:
+    void set(Path const& path)
+    {
+        commands.clear();
+
+        Path::Iterator i(path);
+        while (i.next()) {
+            switch (i.elementType) {
+            case Path::Iterator::startNewSubPath:
+                commands.insert(commands.end(), { MoveTo, i.x1, i.y1 });
+                break;
+            case Path::Iterator::lineTo:
+                commands.insert(commands.end(), { LineTo, i.x1, i.y1 });
+                break;
+            case Path::Iterator::quadraticTo:
+                commands.insert(commands.end(), { QuadTo, i.x1, i.y1, i.x2, i.y2 });
+                break;
+            case Path::Iterator::cubicTo:
+                commands.insert(commands.end(), { BezierTo, i.x1, i.y1, i.x2, i.y2, i.x3, i.y3 });
+                break;
+            case Path::Iterator::closePath:
+                commands.push_back(Close);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    // Begins a new path in nanovg, with the commands we stored
+    void apply(NVGcontext* nvg) const
+    {
+        nvgBeginPath(nvg);
+
+        auto const* c = commands.data();
+        auto const* end = c + commands.size();
+        while (c < end) {
+            switch (static_cast<int>(*c)) {
+            case static_cast<int>(MoveTo):
+                nvgMoveTo(nvg, c[1], c[2]);
+                c += 3;
+                break;
+            case static_cast<int>(LineTo):
+                nvgLineTo(nvg, c[1], c[2]);
+                c += 3;
+                break;
+            case static_cast<int>(QuadTo):
+                nvgQuadTo(nvg, c[1], c[2], c[3], c[4]);
+                c += 5;
+                break;
+            case static_cast<int>(BezierTo):
+                nvgBezierTo(nvg, c[1], c[2], c[3], c[4], c[5], c[6]);
+                c += 7;
+                break;
+            default:
+                nvgClosePath(nvg);
+                c += 1;
+                break;
+            }
+        }
+    }
+
+    bool isEmpty() const { return commands.empty(); }
+
+private:
+    // Stored in the same array as the points, each command is followed by its points
+    static constexpr float MoveTo = 0.0f, LineTo = 1.0f, QuadTo = 2.0f, BezierTo = 3.0f, Close = 4.0f;
+
+    std::vector<float> commands;
+};
+
+// Images and framebuffers that all canvases on a surface draw with, like iolets, resize handles and object flags
+// They only depend on their size and colours, so all canvases and split views on a surface can share a single copy
+// Every resource stays alive for as long as a canvas holds a handle to it
+// The JUCE rasterisations of images are shared between surfaces too, so opening another window only has to upload them
+class NVGResourceCache {
+public:
+    NVGResourceCache()
+    {
+        numCaches++;
+    }
+
+    // The rasters are shared by all surfaces, so they go when the last one does
+    ~NVGResourceCache()
+    {
+        if (--numCaches == 0)
+            rasters.clear();
+    }
+
+    enum Kind {
+        Iolets,
+        ResizeHandle,
+        GOPResizeHandle,
+        ObjectFlag,
+        ObjectFlagSelected,
+        KnobChrome,
+        VUMeterChrome,
+        KeyboardKeys
+    };
+
+    struct Key {
+        int kind = 0;
+        int width = 0, height = 0;
+        hash32 variant = 0; // Hash of everything else the resource depends on, like colours and iolet style
+
+        auto operator<=>(Key const&) const = default;
+    };
+
+    template<typename T>
+    class Handle {
+    public:
+        bool isValid() const { return resource && resource->isValid(); }
+
+        // Whether the handle holds a resource made for this key, so it can be drawn in its place
+        bool matches(Key const& otherKey) const { return key == otherKey && isValid(); }
+
+        int getImageId() const { return resource ? resource->getImageId() : 0; }
+        int getImage() const { return resource ? resource->getImage() : -1; }
+
+    private:
+        friend class NVGResourceCache;
+        std::shared_ptr<T> resource;
+        Key key;
+    };
+
+    static hash32 getVariant(std::initializer_list<uint32> values)
+    {
+        hash32 result = EMPTY_HASH;
+        for (auto value : values) {
+            result ^= value;
+            result *= (hash32)0x01000193;
+        }
+        return result;
+    }
+
+    // Makes the handle point to an image for this key, rendering it with JUCE if nobody has it yet
+    // Returns true if the handle changed, in which case everything that was drawn with it needs a repaint
+    template<typename RenderFunc>
+    bool updateImage(NVGcontext* nvg, Handle<NVGImage>& handle, Key const& key, RenderFunc&& renderCall)
+    {
+        if (handle.key == key && handle.isValid())
+            return false;
+
+        auto image = acquire(images, key);
+        if (!image->isValid()) {
+            auto raster = rasters.find(key);
+            if (raster == rasters.end()) {
+                if (rasters.size() >= maxRasters)
+                    rasters.clear();
+
+                raster = rasters.emplace(key, Image(Image::ARGB, key.width, key.height, true)).first;
+                Graphics g(raster->second);
+                renderCall(g);
+            }
+
+            // Uploading swaps the colour channels in place, so don't hand over the shared copy
+            auto upload = raster->second.createCopy();
+            image->loadJUCEImage(nvg, upload);
+        }
+
+        handle.resource = std::move(image);
+        handle.key = key;
+        return true;
+    }
+
+    // Same for framebuffers, which are rendered with nanovg, so they can't be shared between surfaces
+    template<typename RenderFunc>
+    bool updateFramebuffer(NVGcontext* nvg, Handle<NVGFramebuffer>& handle, Key const& key, RenderFunc&& renderCall)
+    {
+        if (handle.key == key && handle.isValid())
+            return false;
+
+        auto framebuffer = acquire(framebuffers, key);
+        if (!framebuffer->isValid())
+            framebuffer->renderToFramebuffer(nvg, key.width, key.height, renderCall);
+
+        handle.resource = std::move(framebuffer);
+        handle.key = key;
+        return true;
+    }
+
+private:
+    template<typename T>
+    static std::shared_ptr<T> acquire(std::map<Key, std::weak_ptr<T>>& resources, Key const& key)
+    {
+        // Forget about the resources nobody uses anymore
+        for (auto it = resources.begin(); it != resources.end();) {
+            if (it->second.expired())
+                it = resources.erase(it);
+            else
+                ++it;
+        }
+
+        auto& entry = resources[key];
+        auto resource = entry.lock();
+        if (!resource) {
+            resource = std::make_shared<T>();
+            entry = resource;
+        }
+
+        return resource;
+    }
+
+    std::map<Key, std::weak_ptr<NVGImage>> images;
+    std::map<Key, std::weak_ptr<NVGFramebuffer>> framebuffers;
+
+    static constexpr size_t maxRasters = 64;
+    static inline std::map<Key, Image> rasters;
+    static inline int numCaches = 0;
+};
@@ -22,9 +22,10 @@
 #include "Objects/ObjectBase.h"
 
 #include "Dialogs/Dialogs.h"
-#include "Heavy/CompatibleObjects.h"
 
 #include "Pd/Patch.h"
+#include "Sidebar/SearchIndex.h"
+#include "Heavy/CompatibilityChecker.h"
 
 extern "C" {
 #include <m_pd.h>
@@ -75,6 +76,7 @@ Object::~Object()
 {
     hideEditor(); // Make sure the editor is not still open, that could lead to issues with listeners attached to the editor (i.e. suggestioncomponent)
     cnv->selectedComponents.removeChangeListener(this);
+    cnv->objectIndex.remove(this);
 }
 
 void Object::updateObjectActivityPolicy(String objectName)
@@ -172,11 +174,7 @@ bool Object::isSelected() const
 void Object::propertyChanged(String const& name, var const& value) {
     if(name == "hvcc_mode")
     {
-        isHvccCompatible = checkIfHvccCompatible();
-        if (gui && !isHvccCompatible) {
-            cnv->pd->logWarning(String("Warning: object \"" + gui->getType() + "\" is not supported in Compiled Mode").toRawUTF8());
-        }
-        repaint();
+        updateHvccCompatibility();
     }
 }
 
@@ -193,17 +191,41 @@ void Object::valueChanged(Value& v)
     }
 }
 
-bool Object::checkIfHvccCompatible() const
+void Object::updateHvccCompatibility()
 {
-    if (gui) {
-        auto typeName = gui->getType();
-        // Check hvcc compatibility
-        bool isSubpatch = gui->getPatch() != nullptr;
+    auto const incompatibleObject = findHvccIncompatibleObject();
+    auto const wasCompatible = isHvccCompatible;
+    isHvccCompatible = incompatibleObject.isEmpty();
 
-        return !hvccMode.get() || isSubpatch || HeavyCompatibleObjects::getAllCompatibleObjects().contains(typeName);
+    // Only warn when it changes, this gets checked again whenever something inside a subpatch is edited
+    if (wasCompatible && !isHvccCompatible) {
+        cnv->pd->logWarning(String("Warning: object \"" + incompatibleObject + "\" is not supported in Compiled Mode").toRawUTF8());
     }
+    if (wasCompatible != isHvccCompatible)
+        repaint();
+}
+
+String Object::findHvccIncompatibleObject() const
+{
+    if (!gui || !hvccMode.get())
+        return {};
+
+    auto typeName = gui->getType();
+
+    // For subpatches and abstractions, it depends on what's inside
+    if (auto subpatch = gui->getPatch()) {
+        if (auto glist = subpatch->getPointer()) {
+            auto const objectText = gui->getText();
+            if (objectText.startsWith("pd @hv_obj"))
+                return {};
 
-    return true;
+            auto const incompatibleObject = HeavyCompatibilityChecker::findIncompatibleObject(glist.get());
+            return incompatibleObject.isNotEmpty() ? objectText + " -> " + incompatibleObject : String();
+        }
+        return {};
+    }
+
+    return HeavyCompatibleObjects::getAllCompatibleObjects().contains(typeName) ? String() : typeName;
 }
 
 bool Object::hitTest(int x, int y)
@@ -375,7 +397,8 @@ void Object::setType(String const& newType, pd::WeakReference existingObject)
             }
 
             // Synchronise to make sure connections are preserved correctly
-            cnv->synchronise();
+            // Only this object and its connections changed, so there's no need to rescan the whole patch
+            cnv->synchroniseObject(this);
         } else {
             auto rect = getObjectBounds();
             auto* newObject = patch->createObject(rect.getX(), rect.getY(), newType);
@@ -395,17 +418,19 @@ void Object::setType(String const& newType, pd::WeakReference existingObject)
     isGemObject = is_gem_object(gui->getText().toRawUTF8());
 
     if (gui) {
-        gui->initialise();
+        // Loading a big patch would otherwise spend most of its time setting up guis nobody can see yet
+        guiInitialisePending = existingObject.isValid() && !cnv->isAreaInView(gui->getPdBounds() + cnv->canvasOrigin);
+        guiUpdatePending = false;
+        if (!guiInitialisePending)
+            gui->initialise();
+
         gui->lock(cnv->isGraph || locked == var(true) || commandLocked == var(true));
         gui->addMouseListener(this, true);
         addAndMakeVisible(gui.get());
     }
 
-    isHvccCompatible = checkIfHvccCompatible();
-
-    if (gui && !isHvccCompatible) {
-        cnv->pd->logWarning(String("Warning: object \"" + gui->getType() + "\" is not supported in Compiled Mode").toRawUTF8());
-    }
+    isHvccCompatible = true;
+    updateHvccCompatibility();
 
     // Update inlets/outlets
     updateIolets();
@@ -452,7 +477,7 @@ void Object::setType(String const& newType, pd::WeakReference existingObject)
     editor->updateCommandStatus();
 
     cnv->synchroniseSplitCanvas();
-    cnv->pd->updateObjectImplementations();
+    cnv->pd->updateObjectImplementations(cnv->patch.getUncheckedPointer());
 }
 
 Array<Rectangle<float>> Object::getCorners() const
@@ -511,8 +536,24 @@ void Object::lookAndFeelChanged() {
         gui->updateLabel();
 }
 
+void Object::moved()
+{
+    updateSpatialIndex();
+}
+
+void Object::updateSpatialIndex()
+{
+    auto bounds = getBounds();
+    if (gui && gui->labels)
+        bounds = bounds.getUnion(gui->labels->getCanvasBounds());
+
+    cnv->objectIndex.update(this, bounds);
+}
+
 void Object::resized()
 {
+    updateSpatialIndex();
+
     setVisible(!((cnv->isGraph || cnv->presentationMode == var(true)) && gui && gui->hideInGraph()));
 
     if (gui) {
@@ -822,6 +863,9 @@ void Object::mouseDown(MouseEvent const& e)
         object->originalBounds = object->getBounds();
     }
 
+    // Objects could have moved without a drag since the index was built, like with the arrow keys or undo
+    cnv->objectGrid.invalidateSnapIndex();
+
     repaint();
 
     ds.canvasDragStartPosition = cnv->getPosition();
@@ -859,6 +903,8 @@ void Object::mouseUp(MouseEvent const& e)
         originalBounds.setBounds(0, 0, 0, 0);
     } else {
         if (cnv->isGraph) {
+            // This doesn't get to the end of the drag below, where the snap index is normally invalidated
+            cnv->objectGrid.invalidateSnapIndex();
             if (isInsideUndoSequence) {
                 isInsideUndoSequence = false;
                 cnv->patch.endUndoSequence("Drag");
@@ -907,9 +953,10 @@ void Object::mouseUp(MouseEvent const& e)
 
             ds.objectSnappingInbetween->iolets[0]->isTargeted = false;
             ds.objectSnappingInbetween->iolets[ds.objectSnappingInbetween->numInputs]->isTargeted = false;
-            ds.objectSnappingInbetween = nullptr;
 
-            cnv->synchronise();
+            // All connections that changed are connected to the snapped object
+            cnv->synchroniseObject(ds.objectSnappingInbetween);
+            ds.objectSnappingInbetween = nullptr;
         }
         
         for (auto* object : cnv->getSelectionOfType<Object>()) {
@@ -937,6 +984,7 @@ void Object::mouseUp(MouseEvent const& e)
     }
 
     cnv->needsSearchUpdate = true;
+    cnv->pd->searchIndex->markDirty(cnv->patch.getUncheckedPointer());
 }
 
 void Object::mouseDrag(MouseEvent const& e)
@@ -1203,11 +1251,35 @@ void Object::mouseDrag(MouseEvent const& e)
     }
 }
 
+void Object::catchUpGui()
+{
+    if (!gui || !(guiInitialisePending || guiUpdatePending))
+        return;
+
+    if (std::exchange(guiInitialisePending, false)) {
+        guiUpdatePending = false;
+        gui->initialise();
+        gui->lock(cnv->isGraph || locked == var(true) || commandLocked == var(true));
+        updateIolets();
+        updateBounds();
+        resized();
+    } else if (std::exchange(guiUpdatePending, false)) {
+        gui->update();
+    }
+}
+
 void Object::render(NVGcontext* nvg)
 {
+    catchUpGui();
+
+    if (cnv->isRenderingLowDetail() && !newObjectEditor) {
+        renderLowDetail(nvg);
+        return;
+    }
+
     auto lb = getLocalBounds();
     auto b = lb.reduced(margin);
-    auto selectedOutlineColour = convertColour(getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
+    auto selectedOutlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
 
     if (selectedFlag) {
         auto& resizeHandleImage = cnv->resizeHandleImage;
@@ -1232,6 +1304,15 @@ void Object::render(NVGcontext* nvg)
         nvgSmoothGlow(nvg, lb.getX(), lb.getY(), lb.getWidth(), lb.getHeight(), glowColour, nvgRGBA(0, 0, 0, 0), Corners::objectCornerRadius, 1.1f);
     }
 
+    if (cnv->shouldShowDSPLoad()) {
+        // A quarter of the total DSP time already makes an object glow fully red
+        if (auto const load = cnv->pd->dspProfiler->getLoad(getPointer()); load > 0.005f) {
+            auto const amount = std::min(1.0f, load * 4.0f);
+            auto const loadColour = Colours::yellow.interpolatedWith(Colours::red, amount).withAlpha(0.35f + amount * 0.65f);
+            nvgSmoothGlow(nvg, lb.getX(), lb.getY(), lb.getWidth(), lb.getHeight(), convertColour(loadColour), nvgRGBA(0, 0, 0, 0), Corners::objectCornerRadius, 1.5f);
+        }
+    }
+
     if (gui && gui->isTransparent() && !getValue<bool>(locked) && !cnv->isGraph) {
         nvgFillColor(nvg, convertColour(getLookAndFeel().findColour(PlugDataColour::canvasBackgroundColourId).contrasting(0.35f).withAlpha(0.1f)));
         nvgFillRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), Corners::objectCornerRadius);
@@ -1244,13 +1325,13 @@ void Object::render(NVGcontext* nvg)
     }
 
     if (newObjectEditor) {
-        auto backgroundColour = convertColour(getLookAndFeel().findColour(PlugDataColour::textObjectBackgroundColourId));
-        auto outlineColour = convertColour(getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
+        auto backgroundColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::textObjectBackgroundColourId);
+        auto outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
 
         nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), backgroundColour, isSelected() ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
         
         nvgTranslate(nvg, margin, margin);
-        textEditorRenderer.renderJUCEComponent(nvg, *newObjectEditor, getValue<float>(cnv->zoomScale) * cnv->getRenderScale());
+        textEditorRenderer.renderJUCEComponent(nvg, *newObjectEditor, cnv->zoomScale.get() * cnv->getRenderScale());
     }
 
     // If autoconnect is about to happen, draw a fake inlet with a dotted outline
@@ -1262,7 +1343,7 @@ void Object::render(NVGcontext* nvg)
         nvgEllipse(nvg, fakeInletBounds[0] + fakeInletBounds[2] * 0.5f, fakeInletBounds[1] + fakeInletBounds[3] * 0.5f, fakeInletBounds[2] * 0.5f, fakeInletBounds[3] * 0.5f);
         nvgFill(nvg);
 
-        nvgStrokeColor(nvg, convertColour(getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId)));
+        nvgStrokeColor(nvg, cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId));
         nvgStrokeWidth(nvg, 1.0f);
         nvgStroke(nvg);
     }
@@ -1281,7 +1362,7 @@ void Object::render(NVGcontext* nvg)
         int textWidth = 6 + text.length() * 4;
         auto indexBounds = b.withSizeKeepingCentre(b.getWidth() + doubleMargin, halfHeight * 2).removeFromRight(textWidth);
 
-        auto fillColour = convertColour(getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
+        auto fillColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
         nvgDrawRoundedRect(nvg, indexBounds.getX(), indexBounds.getY(), indexBounds.getWidth(), indexBounds.getHeight(), fillColour, fillColour, 2.0f);
 
         nvgFontSize(nvg, 8.0f);
@@ -1295,6 +1376,61 @@ void Object::render(NVGcontext* nvg)
 }
 
 
+// Far zoomed out, text, iolets and flags are too small to see, so we draw a box or a cached image of the gui
+void Object::renderLowDetail(NVGcontext* nvg)
+{
+    auto b = getLocalBounds().reduced(margin);
+
+    if (gui && gui->showThumbnailWhenZoomedOut()) {
+        // Animated guis keep updating their thumbnail, just not every frame
+        if (!thumbnail.isValid() || Time::getMillisecondCounter() - lastThumbnailUpdate > 250)
+            cnv->requestThumbnailUpdate(this);
+
+        if (thumbnail.isValid()) {
+            nvgBeginPath(nvg);
+            nvgRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight());
+            nvgFillPaint(nvg, nvgImagePattern(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), 0, thumbnail.getImage(), 1.0f));
+            nvgFill(nvg);
+
+            if (selectedFlag) {
+                nvgBeginPath(nvg);
+                nvgRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight());
+                nvgStrokeColor(nvg, cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId));
+                nvgStrokeWidth(nvg, 2.0f);
+                nvgStroke(nvg);
+            }
+            return;
+        }
+    }
+
+    auto boxColour = getLookAndFeel().findColour(selectedFlag ? PlugDataColour::objectSelectedOutlineColourId : PlugDataColour::objectOutlineColourId);
+    nvgFillColor(nvg, convertColour(boxColour));
+    nvgFillRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), Corners::objectCornerRadius);
+}
+
+void Object::updateThumbnail(NVGcontext* nvg, float pixelScale, float zoom)
+{
+    if (!gui || !cnv->isRenderingLowDetail())
+        return;
+
+    auto const b = getLocalBounds().reduced(margin);
+    int const width = std::max(1, roundToInt(b.getWidth() * zoom * pixelScale));
+    int const height = std::max(1, roundToInt(b.getHeight() * zoom * pixelScale));
+
+    thumbnail.renderToFramebuffer(nvg, width, height, [this, b, width, height, zoom, pixelScale](NVGcontext* nvg) {
+        nvgViewport(0, 0, width, height);
+        nvgClear(nvg);
+
+        nvgBeginFrame(nvg, b.getWidth() * zoom, b.getHeight() * zoom, pixelScale);
+        nvgScale(nvg, zoom, zoom);
+        gui->render(nvg);
+        nvgEndFrame(nvg);
+    });
+
+    lastThumbnailUpdate = Time::getMillisecondCounter();
+    repaint();
+}
+
 void Object::renderIolets(NVGcontext* nvg)
 {
     if (cnv->isGraph)
@@ -1307,22 +1443,30 @@ void Object::renderIolets(NVGcontext* nvg)
     }
 }
 
-void Object::renderLabel(NVGcontext* nvg)
+void Object::renderLabel(NVGcontext* nvg, Rectangle<int> const& area)
 {
-    if (gui) {
-        if (auto* label = gui->getLabel()) {
+    if (!gui || !gui->labels || cnv->isRenderingLowDetail())
+        return;
+
+    // The labels keep their bounds in canvas coordinates, updated whenever they move, so we don't have to look them up every frame
+    auto const* labels = gui->labels.get();
+    if (!labels->getCanvasBounds().intersects(area))
+        return;
+
+    if (auto* label = gui->getLabel()) {
+        auto const labelBounds = labels->getLabelCanvasBounds();
+        if (labelBounds.intersects(area)) {
             NVGScopedState scopedState(nvg);
-            auto posOnCanvas = cnv->getLocalPoint(gui->labels.get(), label->getPosition());
-            nvgTranslate(nvg, posOnCanvas.getX(), posOnCanvas.getY());
+            nvgTranslate(nvg, labelBounds.getX(), labelBounds.getY());
             label->renderLabel(nvg, cnv->getRenderScale() * 2.0f);
         }
-        if (auto* vu = gui->getVU()) {
-            if (vu->isVisible()) {
-                NVGScopedState scopedState(nvg);
-                auto posOnCanvas = cnv->getLocalPoint(gui->labels.get(), vu->getPosition());
-                nvgTranslate(nvg, posOnCanvas.getX(), posOnCanvas.getY());
-                vu->render(nvg);
-            }
+    }
+    if (auto* vu = gui->getVU()) {
+        auto const vuBounds = labels->getVUCanvasBounds();
+        if (vu->isVisible() && vuBounds.intersects(area)) {
+            NVGScopedState scopedState(nvg);
+            nvgTranslate(nvg, vuBounds.getX(), vuBounds.getY());
+            vu->render(nvg);
         }
     }
 }
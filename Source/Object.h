@@ -52,6 +52,10 @@ public:
     void timerCallback() override;
 
     void resized() override;
+    void moved() override;
+
+    // Lets the canvas know where this object and its label are, for culling
+    void updateSpatialIndex();
 
     void updateIoletGeometry();
 
@@ -86,7 +90,11 @@ public:
     void render(NVGcontext* nvg) override;
 
     void renderIolets(NVGcontext* nvg);
-    void renderLabel(NVGcontext* nvg);
+    // Only draws the label and VU scale if they overlap the area that's being redrawn
+    void renderLabel(NVGcontext* nvg, Rectangle<int> const& area);
+
+    // Renders the gui into the thumbnail that we show when zoomed far out
+    void updateThumbnail(NVGcontext* nvg, float pixelScale, float zoom);
 
     void mouseMove(MouseEvent const& e) override;
     void mouseDown(MouseEvent const& e) override;
@@ -106,6 +114,18 @@ public:
 
     Array<Rectangle<float>> getCorners() const;
 
+    // Position in the pd object list, used to render objects in the correct order
+    int drawOrder = std::numeric_limits<int>::max();
+
+    // Set when the gui skipped a sync because it was out of view, see Canvas::updateObjectsInView
+    bool guiUpdatePending = false;
+
+    // Guis of existing objects that are out of view when they're loaded only finish setting up once they're needed
+    bool guiInitialisePending = false;
+
+    // Finishes initialising or syncing the gui, if that was postponed while it was out of view
+    void catchUpGui();
+
     int numInputs = 0;
     int numOutputs = 0;
 
@@ -134,6 +154,9 @@ public:
 
     bool isSelected() const;
 
+    // Checks again if heavy can compile this object, for subpatches that includes everything inside them
+    void updateHvccCompatibility();
+
     // Controls the way object activity propagates upwards inside GOPs.
     enum ObjectActivityPolicy {
         Self, //Trigger object's own activity only.
@@ -146,13 +169,15 @@ public:
 private:
     void initialise();
 
+    void renderLowDetail(NVGcontext* nvg);
+
     void updateTooltips();
 
     void updateObjectActivityPolicy(String objectName);
 
     void openNewObjectEditor();
 
-    bool checkIfHvccCompatible() const;
+    String findHvccIncompatibleObject() const;
 
     void setSelected(bool shouldBeSelected);
     bool selectedFlag = false;
@@ -169,6 +194,9 @@ private:
 
     NVGImage textEditorRenderer;
 
+    NVGFramebuffer thumbnail;
+    uint32 lastThumbnailUpdate = 0;
+
     ObjectDragState& ds;
 
     RateReducer rateReducer = RateReducer(ACTIVITY_UPDATE_RATE);
@@ -23,22 +23,74 @@ ObjectGrid::ObjectGrid(Canvas* cnv)
     gridSize = SettingsFile::getInstance()->getProperty<int>("grid_size");
 }
 
-Array<Object*> ObjectGrid::getSnappableObjects(Object* draggedObject)
+bool ObjectGrid::isSnappable(Object* draggedObject, Object* object)
 {
     auto& cnv = draggedObject->cnv;
     if (!cnv->viewport)
-        return {};
-
-    Array<Object*> snappable;
+        return false;
 
     auto scaleFactor = std::sqrt(std::abs(cnv->getTransform().getDeterminant()));
     auto viewBounds = cnv->viewport->getViewArea() / scaleFactor;
 
+    // don't look at dragged object, selected objects, or objects that are outside of view bounds
+    return draggedObject != object && !object->isSelected() && viewBounds.intersects(object->getBounds());
+}
+
+void ObjectGrid::buildSnapIndex()
+{
+    for (auto& side : snapIndex.sides)
+        side.clear();
+
+    snapIndex.objects.clear();
+    snapIndex.objects.reserve(cnv->objects.size());
+
     for (auto* object : cnv->objects) {
-        if (draggedObject == object || object->isSelected() || !viewBounds.intersects(object->getBounds()))
-            continue; // don't look at dragged object, selected objects, or objects that are outside of view bounds
+        auto const b = object->getBounds().reduced(Object::margin);
+        auto const index = static_cast<int>(snapIndex.objects.size());
+        snapIndex.objects.emplace_back(object);
+
+        snapIndex.sides[Left].emplace_back(b.getX(), index);
+        snapIndex.sides[Right].emplace_back(b.getRight(), index);
+        snapIndex.sides[Top].emplace_back(b.getY(), index);
+        snapIndex.sides[Bottom].emplace_back(b.getBottom(), index);
+        snapIndex.sides[VerticalCentre].emplace_back(b.getCentreY(), index);
+        snapIndex.sides[HorizontalCentre].emplace_back(b.getCentreX(), index);
+    }
+
+    for (auto& side : snapIndex.sides)
+        std::sort(side.begin(), side.end());
+
+    snapIndex.isValid = true;
+}
+
+Array<Object*> ObjectGrid::getSnapCandidates(Object* draggedObject, Rectangle<int> desiredBounds)
+{
+    if (!draggedObject->cnv->viewport)
+        return {};
 
-        snappable.add(object);
+    if (!snapIndex.isValid || snapIndex.objects.size() != static_cast<size_t>(cnv->objects.size()))
+        buildSnapIndex();
+
+    int const positions[6] = { desiredBounds.getX(), desiredBounds.getRight(), desiredBounds.getY(), desiredBounds.getBottom(), desiredBounds.getCentreY(), desiredBounds.getCentreX() };
+
+    // Every object that lines up with any side could snap, the snapping code below decides which side it snaps with
+    std::vector<int> candidates;
+    for (int side = 0; side < 6; side++) {
+        auto const& sorted = snapIndex.sides[side];
+        auto it = std::lower_bound(sorted.begin(), sorted.end(), std::pair<int, int>(positions[side] - objectTolerance + 1, 0));
+        for (; it != sorted.end() && it->first < positions[side] + objectTolerance; ++it) {
+            candidates.push_back(it->second);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    Array<Object*> snappable;
+    for (auto index : candidates) {
+        auto* object = snapIndex.objects[index].getComponent();
+        if (object && isSnappable(draggedObject, object))
+            snappable.add(object);
     }
 
     auto centre = draggedObject->getBounds().getCentre();
@@ -75,7 +127,8 @@ Point<int> ObjectGrid::performMove(Object* toDrag, Point<int> dragOffset)
 
     auto [snapGrid, snapEdges, snapCentres] = std::tuple<bool, bool, bool> { gridType & 1, gridType & 2, gridType & 4 };
 
-    auto snappable = getSnappableObjects(toDrag);
+    auto desiredBounds = toDrag->originalBounds.reduced(Object::margin) + dragOffset;
+    auto snappable = getSnapCandidates(toDrag, desiredBounds);
 
     Point<int> distance;
     Line<int> verticalIndicator, horizontalIndicator;
@@ -86,7 +139,7 @@ Point<int> ObjectGrid::performMove(Object* toDrag, Point<int> dragOffset)
         for (auto* connection : toDrag->getConnections()) {
 
             if (connection->inobj == toDrag) {
-                if (!snappable.contains(connection->outobj))
+                if (!isSnappable(toDrag, connection->outobj))
                     continue;
 
                 auto outletBounds = connection->outobj->getBounds() + connection->outlet->getPosition();
@@ -104,7 +157,7 @@ Point<int> ObjectGrid::performMove(Object* toDrag, Point<int> dragOffset)
                 }
                 break;
             } else if (connection->outobj == toDrag) {
-                if (!snappable.contains(connection->inobj))
+                if (!isSnappable(toDrag, connection->inobj))
                     continue;
 
                 auto inletBounds = connection->inobj->getBounds() + connection->inlet->getPosition();
@@ -125,8 +178,6 @@ Point<int> ObjectGrid::performMove(Object* toDrag, Point<int> dragOffset)
         }
     }
 
-    auto desiredBounds = toDrag->originalBounds.reduced(Object::margin) + dragOffset;
-
     bool objectSnapped = false;
     // Check for relative object snap
     for (auto* object : snappable) {
@@ -236,7 +287,7 @@ Point<int> ObjectGrid::performResize(Object* toDrag, Point<int> dragOffset, Rect
 
     if (snapEdges) {
         // Check for objects to relative snap to
-        for (auto* object : getSnappableObjects(toDrag)) {
+        for (auto* object : getSnapCandidates(toDrag, desiredBounds)) {
             auto b1 = object->getBounds().reduced(Object::margin);
             float topDiff = b1.getY() - desiredBounds.getY();
             float bottomDiff = b1.getBottom() - desiredBounds.getBottom();
@@ -393,6 +444,10 @@ void ObjectGrid::clearIndicators(bool fast)
 {
     float lineFadeMs = fast ? 50 : 250;
 
+    // Only the fade-out at the end of a drag is slow, the next drag indexes the objects where they are then
+    if (!fast)
+        invalidateSnapIndex();
+
     lineAlphaMultiplier[0] = dsp::FastMathApproximations::exp((-MathConstants<float>::twoPi * 1000.0f / 60.0f) / lineFadeMs);
     lineAlphaMultiplier[1] = lineAlphaMultiplier[0];
     if (lineTargetAlpha[0] != 0.0f || lineTargetAlpha[1] != 0.0f) {
@@ -402,6 +457,11 @@ void ObjectGrid::clearIndicators(bool fast)
     }
 }
 
+void ObjectGrid::invalidateSnapIndex()
+{
+    snapIndex.isValid = false;
+}
+
 void ObjectGrid::setIndicator(int idx, Line<int> line, float scale)
 {
     auto lineIsEmpty = line.getLength() == 0;
@@ -22,6 +22,9 @@ struct ObjectGrid : public SettingsFileListener
 
     void clearIndicators(bool fast);
 
+    // Makes the next snap look at where the objects are now
+    void invalidateSnapIndex();
+
     void render(NVGcontext* nvg);
 
 private:
@@ -38,7 +41,10 @@ private:
 
     void propertyChanged(String const& name, var const& value) override;
 
-    static Array<Object*> getSnappableObjects(Object* draggedObject);
+    // Objects that are close enough to snap to, furthest first, so that the closest one wins
+    Array<Object*> getSnapCandidates(Object* draggedObject, Rectangle<int> desiredBounds);
+    static bool isSnappable(Object* draggedObject, Object* object);
+    void buildSnapIndex();
 
     void setIndicator(int idx, Line<int> line, float lineScale);
 
@@ -47,6 +53,16 @@ private:
     static constexpr int objectTolerance = 6;
     static constexpr int connectionTolerance = 9;
 
+    // The edges and centres of all objects, sorted, so we can find the ones to snap to without looking at every object on every mouse event
+    // Built when a drag starts: only selected objects move while dragging, and those are never snapped to
+    struct SnapIndex {
+        std::array<std::vector<std::pair<int, int>>, 6> sides; // Position and object index, for every Side
+        std::vector<Component::SafePointer<Object>> objects;
+        bool isValid = false;
+    };
+
+    SnapIndex snapIndex;
+
     Line<int> lines[2];
     float lineAlpha[2] = {};
     float lineTargetAlpha[2] = {};
@@ -5,6 +5,8 @@
  */
 
 #include "Components/PropertiesPanel.h"
+#include "Utility/MinMaxPyramid.h"
+#include "Pd/ArrayDirtyRanges.h"
 
 extern "C" {
 void garray_arraydialog(t_fake_garray* x, t_symbol* name, t_floatarg fsize, t_floatarg fflags, t_floatarg deleteit);
@@ -41,6 +43,9 @@ public:
     {
         vec.reserve(8192);
         read(vec);
+        editScale = getScale();
+        editMode = getEditMode();
+        peaks.update(vec.data(), static_cast<int>(vec.size()), 0, static_cast<int>(vec.size()));
 
         updateParameters();
 
@@ -60,28 +65,37 @@ public:
         pd->unregisterMessageListener(arr.getRawUnchecked<void>(), this);
     }
 
-    static std::vector<float> rescale(std::vector<float> const& v, unsigned const newSize)
+    // Samples to draw for the visible part of the array
+    // More than a point per pixel will cause insane loads, and isn't actually helpful
+    // Instead, every pixel gets the lowest and highest sample it covers, which the pyramid finds without reading every sample
+    std::vector<float> getDisplayPoints(int width, DrawType& style) const
     {
-        if (v.empty()) {
-            return {};
-        }
+        auto const range = getVisibleRange();
+        width = std::max(width, 1);
 
-        std::vector<float> result(newSize);
-        std::size_t const oldSize = v.size();
-        for (unsigned i = 0; i < newSize; i++) {
-            auto const idx = i * (oldSize - 1) / newSize;
-            auto const mod = i * (oldSize - 1) % newSize;
+        if (range.getLength() <= width)
+            return std::vector<float>(vec.begin() + range.getStart(), vec.begin() + range.getEnd());
 
-            if (mod == 0)
-                result[i] = v[idx];
-            else {
-                float const part = float(mod) / float(newSize);
-                result[i] = v[idx] * (1.0 - part) + v[idx + 1] * part;
-            }
+        // Points and curves only make sense when you can see the individual points
+        style = Polygon;
+
+        std::vector<float> points;
+        points.reserve(static_cast<size_t>(width * 2));
+
+        auto const samplesPerPixel = static_cast<double>(range.getLength()) / width;
+        for (int x = 0; x < width; x++) {
+            auto const start = range.getStart() + static_cast<int>(x * samplesPerPixel);
+            auto const end = std::max(start + 1, range.getStart() + static_cast<int>((x + 1) * samplesPerPixel));
+            auto const peak = peaks.getRange(vec.data(), start, end);
+
+            // Alternate the order, so the line goes through the peaks instead of jumping back every pixel
+            points.push_back(x & 1 ? peak.getEnd() : peak.getStart());
+            points.push_back(x & 1 ? peak.getStart() : peak.getEnd());
         }
-        return result;
+
+        return points;
     }
-        
+
     static Path createArrayPath(std::vector<float> points, DrawType style, std::array<float, 2> scale, float width, float height)
     {
         bool invert = false;
@@ -90,12 +104,6 @@ public:
             std::swap(scale[0], scale[1]);
         }
         
-        // More than a point per pixel will cause insane loads, and isn't actually helpful
-        // Instead, linearly interpolate the vector to a max size of width in pixels
-        if (points.size() > width) {
-            points = rescale(points, width);
-        }
-        
         // Need at least 4 points to draw a bezier curve
         if(points.size() <= 4 && style == Curve) style = Polygon;
         
@@ -195,13 +203,37 @@ public:
         return result;
     }
 
+    static void setArrayPolylinePath(NVGcontext* nvg, std::vector<float> const& points, std::array<float, 2> scale, float width, float height)
+    {
+        bool invert = false;
+        if (scale[0] >= scale[1]) {
+            invert = true;
+            std::swap(scale[0], scale[1]);
+        }
+
+        float const dh = height / (scale[1] - scale[0]);
+        float const dw = width / static_cast<float>(points.size() - 1);
+        float const invh = invert ? 0 : height;
+        float const yscale = invert ? -1.0f : 1.0f;
+
+        std::vector<float> xs(points.size()), ys(points.size());
+        for (size_t x = 0; x < points.size(); x++) {
+            xs[x] = x * dw;
+            ys[x] = invh - (std::clamp(points[x], scale[0], scale[1]) - scale[0]) * dh * yscale;
+        }
+
+        setPolylinePath(nvg, xs.data(), ys.data(), static_cast<int>(points.size()));
+    }
+
     void paintGraph(Graphics& g)
     {
         auto const h = static_cast<float>(getHeight());
         auto const w = static_cast<float>(getWidth());
 
         if (!vec.empty()) {
-            auto p = createArrayPath(vec, getDrawType(), getScale(), w, h);
+            auto style = getDrawType();
+            auto points = getDisplayPoints(getWidth(), style);
+            auto p = createArrayPath(std::move(points), style, getScale(), w, h);
             g.setColour(getContentColour());
             g.strokePath(p, PathStrokeType(getLineWidth()));
         }
@@ -216,9 +248,16 @@ public:
         nvgIntersectRoundedScissor(nvg, arrB.getX(), arrB.getY(), arrB.getWidth(), arrB.getHeight(), Corners::objectCornerRadius);
         
         if (!vec.empty()) {
-            auto p = createArrayPath(vec, getDrawType(), getScale(), w, h);
-            setJUCEPath(nvg, p);
-            
+            auto style = getDrawType();
+            auto points = getDisplayPoints(getWidth(), style);
+
+            if (points.size() > 1 && style == Polygon) {
+                setArrayPolylinePath(nvg, points, getScale(), w, h);
+            } else {
+                auto p = createArrayPath(std::move(points), style, getScale(), w, h);
+                setJUCEPath(nvg, p);
+            }
+
             nvgStrokeColor(nvg, nvgRGBAf(getContentColour().getFloatRed(), getContentColour().getFloatGreen(), getContentColour().getFloatBlue(), getContentColour().getFloatAlpha()));
             nvgStrokeWidth(nvg, getLineWidth());
             nvgStroke(nvg);
@@ -234,6 +273,7 @@ public:
             MessageManager::callAsync([_this = SafePointer(this), shouldBeEditable = static_cast<bool>(atoms[0].getFloat())]() {
                 if(_this) {
                     _this->editable = shouldBeEditable;
+                    _this->editMode = shouldBeEditable;
                     _this->setInterceptsMouseClicks(shouldBeEditable, false);
                 }
             });
@@ -342,33 +382,26 @@ public:
 
     void mouseDown(MouseEvent const& e) override
     {
-        if (error || !getEditMode())
+        if (error || !editMode || vec.empty())
             return;
         edited = true;
 
-        auto const s = static_cast<float>(vec.size() - 1);
-        auto const w = static_cast<float>(getWidth());
-        auto const x = static_cast<float>(e.x);
-
-        lastIndex = std::round(std::clamp(x / w, 0.f, 1.f) * s);
+        lastIndex = getIndexForX(static_cast<float>(e.x));
 
         mouseDrag(e);
     }
 
     void mouseDrag(MouseEvent const& e) override
     {
-        if (error || !getEditMode())
+        if (error || !editMode || vec.empty())
             return;
 
-        auto const s = static_cast<float>(vec.size() - 1);
-        auto const w = static_cast<float>(getWidth());
         auto const h = static_cast<float>(getHeight());
-        auto const x = static_cast<float>(e.x);
         auto const y = static_cast<float>(e.y);
 
-        std::array<float, 2> scale = getScale();
+        auto const scale = editScale;
 
-        int const index = static_cast<int>(std::round(std::clamp(x / w, 0.f, 1.f) * s));
+        int const index = getIndexForX(static_cast<float>(e.x));
 
         float start = vec[lastIndex];
         float current = (1.f - std::clamp(y / h, 0.f, 1.f)) * (scale[1] - scale[0]) + scale[0];
@@ -383,45 +416,200 @@ public:
         for (int n = interpStart; n <= interpEnd; n++) {
             vec[n] = jmap<float>(n, interpStart, interpEnd + 1, min, max);
         }
+        peaks.update(vec.data(), static_cast<int>(vec.size()), interpStart, interpEnd + 1);
 
-        // Don't want to touch vec on the other thread, so we copy the vector into the lambda
-        auto changed = std::vector<float>(vec.begin() + interpStart, vec.begin() + interpEnd + 1);
-
+        auto const changed = Range<int>(interpStart, interpEnd + 1);
+        pendingEdit = pendingEdit.isEmpty() ? changed : pendingEdit.getUnionWith(changed);
         lastIndex = index;
 
-        pd->lockAudioThread();
-        for (int n = 0; n < changed.size(); n++) {
-            write(interpStart + n, changed[n]);
+        flushEdits(false);
+        repaintIndexRange(changed);
+    }
+
+    void mouseUp(MouseEvent const& e) override
+    {
+        // Also when the edit mode changed during the drag, otherwise updates from pd would be ignored from now on
+        edited = false;
+        if (error || !editMode)
+            return;
+
+        flushEdits(true);
+    }
+
+    // Sends the edited part of the array to pd, which writes it in between two blocks
+    // While a batch is still on its way, new edits are collected into one range, so fast drawing doesn't queue up a write for every mouse event
+    // The last batch of a drag also makes pd redraw the array
+    void flushEdits(bool finished)
+    {
+        auto const range = pendingEdit.getIntersectionWith({ 0, static_cast<int>(vec.size()) });
+        if (!finished && (range.isEmpty() || editsInFlight->load() > 0))
+            return;
+
+        pendingEdit = {};
+        editsInFlight->fetch_add(1);
+
+        pd->enqueueFunctionAtBlockBoundary([array = arr, inFlight = editsInFlight, start = range.getStart(), values = std::vector<float>(vec.begin() + range.getStart(), vec.begin() + range.getEnd()), finished]() {
+            inFlight->fetch_sub(1);
+
+            if (auto* garray = array.getRaw<t_fake_garray>()) {
+                auto* words = reinterpret_cast<t_word*>(garray_vec(reinterpret_cast<t_garray*>(garray)));
+                auto const size = garray_getarray(reinterpret_cast<t_garray*>(garray))->a_n;
+                auto const end = std::min(start + static_cast<int>(values.size()), size);
+                for (int i = start; i < end; i++) {
+                    words[i].w_float = values[i - start];
+                }
+
+                if (!values.empty())
+                    pd_symbol(&garray->x_gobj.g_pd, gensym("array"));
+                if (finished)
+                    plugdata_forward_message(garray->x_glist, gensym("redraw"), 0, NULL);
+            }
+        });
+    }
+
+    // Only repaints the part of the graph that shows these values, including the lines towards their neighbours
+    void repaintIndexRange(Range<int> indices)
+    {
+        constexpr int margin = 4;
+        auto const left = static_cast<int>(std::floor(getXForIndex(indices.getStart() - 1))) - margin;
+        auto const right = static_cast<int>(std::ceil(getXForIndex(indices.getEnd()))) + margin;
+        repaint(Rectangle<int>(left, 0, right - left, getHeight()).getIntersection(getLocalBounds()));
+    }
+
+    void mouseWheelMove(MouseEvent const& e, MouseWheelDetails const& wheel) override
+    {
+        if (!zoomable || vec.empty()) {
+            Component::mouseWheelMove(e, wheel);
+            return;
         }
 
-        if (auto ptr = arr.get<t_fake_garray>()) {
-            pd->sendDirectMessage(ptr.get(), stringArray);
+        // Scrolling vertically zooms in around the mouse, scrolling horizontally moves through the array
+        if (!approximatelyEqual(wheel.deltaY, 0.0f))
+            zoomAround(static_cast<float>(e.x), std::pow(2.0f, -wheel.deltaY * 2.0f));
+
+        if (!approximatelyEqual(wheel.deltaX, 0.0f)) {
+            auto const range = getVisibleRange();
+            setVisibleRange(range + roundToInt(-wheel.deltaX * range.getLength()));
         }
+    }
 
-        pd->unlockAudioThread();
+    void mouseMagnify(MouseEvent const& e, float scaleFactor) override
+    {
+        if (!zoomable || vec.empty()) {
+            Component::mouseMagnify(e, scaleFactor);
+            return;
+        }
+
+        zoomAround(static_cast<float>(e.x), 1.0f / scaleFactor);
+    }
+
+    void zoomAround(float x, float factor)
+    {
+        auto const range = getVisibleRange();
+        auto const anchor = range.getStart() + std::clamp(x / std::max(getWidth(), 1), 0.0f, 1.0f) * range.getLength();
+        auto const newLength = std::max(roundToInt(range.getLength() * factor), 1);
+        auto const newStart = roundToInt(anchor - (anchor - range.getStart()) * (static_cast<float>(newLength) / range.getLength()));
+
+        setVisibleRange({ newStart, newStart + newLength });
+    }
+
+    // Only shows part of the array, an empty range shows all of it
+    void setVisibleRange(Range<int> newRange)
+    {
+        auto const numSamples = static_cast<int>(vec.size());
+        auto const length = std::clamp(newRange.getLength(), std::min(minVisibleSamples, numSamples), numSamples);
+        auto const start = std::clamp(newRange.getStart(), 0, numSamples - length);
+
+        visibleRange = length == numSamples ? Range<int>() : Range<int>(start, start + length);
         repaint();
     }
 
-    void mouseUp(MouseEvent const& e) override
+    Range<int> getVisibleRange() const
     {
-        if (error || !getEditMode())
-            return;
+        auto const all = Range<int>(0, static_cast<int>(vec.size()));
+        return visibleRange.isEmpty() ? all : visibleRange.getIntersectionWith(all);
+    }
 
-        if (auto ptr = arr.get<t_fake_garray>()) {
-            plugdata_forward_message(ptr->x_glist, gensym("redraw"), 0, NULL);
-        }
+    float getXForIndex(int index) const
+    {
+        auto const range = getVisibleRange();
+        return static_cast<float>(index - range.getStart()) / static_cast<float>(std::max(range.getLength() - 1, 1)) * getWidth();
+    }
 
-        edited = false;
+    int getIndexForX(float x) const
+    {
+        auto const range = getVisibleRange();
+        auto const s = static_cast<float>(range.getLength() - 1);
+        return range.getStart() + static_cast<int>(std::round(std::clamp(x / std::max(getWidth(), 1), 0.f, 1.f) * s));
     }
 
     void update()
     {
         size = getArraySize();
+        editScale = getScale();
+        editMode = getEditMode();
+
+        if (auto ptr = arr.get<t_garray>())
+            arrayVector = garray_vec(ptr.get());
+
+        // Until our own edits have reached pd, reading the array would undo them
+        if (!edited && pendingEdit.isEmpty() && editsInFlight->load() == 0) {
+            auto const changed = read(vec);
+            if (!changed.isEmpty() || peaks.getNumSamples() != static_cast<int>(vec.size())) {
+                peaks.update(vec.data(), static_cast<int>(vec.size()), changed.getStart(), changed.getEnd());
+                repaint();
+            }
+        }
+    }
+
+    // Reads back only the part of the array that DSP wrote since the last frame, see pd::ArrayDirtyRanges
+    // Returns the range that was written, so the same range can be given to other graphs of this array
+    Range<int> updateDirtyRange()
+    {
+        if (edited || !pendingEdit.isEmpty() || editsInFlight->load() != 0)
+            return {};
+
+        int start = 0, end = 0;
+        if (auto ptr = arr.get<t_garray>()) {
+            arrayVector = garray_vec(ptr.get());
+            if (!pd::ArrayDirtyRanges::takeDirtyRange(arrayVector, start, end))
+                return {};
+        }
+
+        updateRange({ start, end });
+        return { start, end };
+    }
+
+    // Can be called without locking pd, to find out if updateDirtyRange has anything to do
+    // The vector is remembered from the last update. When the array is resized, pd redraws it, which updates it again
+    bool mightBeDirty() const
+    {
+        return !arrayVector || pd::ArrayDirtyRanges::isDirty(arrayVector);
+    }
+
+    void updateRange(Range<int> dirty)
+    {
+        if (dirty.isEmpty() || edited || !pendingEdit.isEmpty() || editsInFlight->load() != 0)
+            return;
+
+        if (auto ptr = arr.get<t_garray>()) {
+            int const size = garray_getarray(ptr.get())->a_n;
+            if (size != static_cast<int>(vec.size())) {
+                update();
+                return;
+            }
 
-        if (!edited) {
-            bool changed = read(vec);
-            if(changed) repaint();
+            dirty = dirty.getIntersectionWith({ 0, size });
+            auto const* words = reinterpret_cast<t_word*>(garray_vec(ptr.get()));
+            for (int i = dirty.getStart(); i < dirty.getEnd(); i++) {
+                vec[i] = words[i].w_float;
+            }
+        } else {
+            return;
         }
+
+        peaks.update(vec.data(), static_cast<int>(vec.size()), dirty.getStart(), dirty.getEnd());
+        repaint();
     }
 
     bool willSaveContent() const
@@ -618,44 +806,57 @@ public:
         }
     }
 
-    // Gets the values from the array.
-    bool read(std::vector<float>& output) const
+    // Gets the values from the array, returns the range of values that changed
+    Range<int> read(std::vector<float>& output) const
     {
-        bool changed = false;
+        int firstChanged = -1, lastChanged = -1;
         if (auto ptr = arr.get<t_garray>()) {
             int const size = garray_getarray(ptr.get())->a_n;
+            bool const resized = output.size() != static_cast<size_t>(size);
             output.resize(static_cast<size_t>(size));
 
             t_word* vec = ((t_word*)garray_vec(ptr.get()));
             for (int i = 0; i < size; i++) {
-                changed = changed || output[i] != vec[i].w_float;
-                output[i] = vec[i].w_float;
+                if (output[i] != vec[i].w_float) {
+                    if (firstChanged < 0)
+                        firstChanged = i;
+                    lastChanged = i;
+                    output[i] = vec[i].w_float;
+                }
             }
-        }
-        
-        return changed;
-    }
 
-    // Writes a value to the array.
-    void write(size_t const pos, float const input)
-    {
-        if (auto ptr = arr.get<t_garray>()) {
-            t_word* vec = ((t_word*)garray_vec(ptr.get()));
-            vec[pos].w_float = input;
+            if (resized)
+                return { 0, size };
         }
+
+        return firstChanged < 0 ? Range<int>() : Range<int>(firstChanged, lastChanged + 1);
     }
 
     pd::WeakReference arr;
+    void const* arrayVector = nullptr;
 
     std::vector<float> vec;
+    MinMaxPyramid peaks;
     std::atomic<bool> edited;
     bool error = false;
-    String const stringArray = "array";
+
+    // Edited values that haven't been sent to pd yet, and the number of batches that pd hasn't written yet
+    Range<int> pendingEdit;
+    std::shared_ptr<std::atomic<int>> editsInFlight = std::make_shared<std::atomic<int>>(0);
+
+    // Read whenever we update from pd, so drawing doesn't have to lock the audio thread
+    std::array<float, 2> editScale = { -1.0f, 1.0f };
+    bool editMode = true;
 
     int lastIndex = 0;
 
     PluginProcessor* pd;
     bool editable = true;
+
+    // The array editor dialog lets you zoom in on part of the array
+    bool zoomable = false;
+    Range<int> visibleRange;
+    static constexpr int minVisibleSamples = 8;
 };
 
 struct ArrayPropertiesPanel : public PropertiesPanelProperty
@@ -904,6 +1105,7 @@ public:
     {
         for (auto* arr : arrays) {
             auto* graph = graphs.add(new GraphicalArray(pd, arr, parent));
+            graph->zoomable = true;
             addChildComponent(graph);
 
             auto* list = lists.add(new ArrayListView(pd, arr));
@@ -1012,6 +1214,13 @@ public:
         pd->unlockAudioThread();
     }
 
+    // Called with the audio thread locked, by the ArrayObject that found out which part of the array changed
+    void updateGraphRange(int index, Range<int> dirty)
+    {
+        if (isPositiveAndBelow(index, graphs.size()))
+            graphs[index]->updateRange(dirty);
+    }
+
     void mouseDown(MouseEvent const& e) override
     {
         windowDragger.startDraggingComponent(this, e);
@@ -1050,7 +1259,8 @@ public:
     }
 };
 
-class ArrayObject final : public ObjectBase {
+class ArrayObject final : public ObjectBase
+    , public FrameScheduler::Poller {
 public:
     SafePointer<ArrayPropertiesPanel> propertiesPanel = nullptr;
     Value sizeProperty = SynchronousValue();
@@ -1061,6 +1271,9 @@ public:
     {
         reinitialiseGraphs();
 
+        // Arrays that are being written by DSP, like a recording with [tabwrite~], show what's written every frame
+        cnv->editor->frameScheduler.addPoller(this, 1000 / 30);
+
         setInterceptsMouseClicks(false, true);
 
         objectParameters.addParamSize(&sizeProperty);
@@ -1136,8 +1349,8 @@ public:
     {
         auto b = getLocalBounds().toFloat();
         auto backgroundColour = nvgRGBA(0, 0, 0, 0);
-        auto selectedOutlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
-        auto outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
+        auto selectedOutlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
+        auto outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
 
         nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), backgroundColour, object->isSelected() ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
 
@@ -1315,6 +1528,29 @@ public:
         }
     }
 
+    bool shouldPoll() override
+    {
+        return isOnScreen() || dialog;
+    }
+
+    void pollFrame() override
+    {
+        // Most frames, nothing was written, then we don't need pd's lock at all
+        if (std::none_of(graphs.begin(), graphs.end(), [](auto* graph) { return graph->mightBeDirty(); }))
+            return;
+
+        if (!pd->tryLockAudioThread())
+            return;
+
+        for (int i = 0; i < graphs.size(); i++) {
+            auto const dirty = graphs[i]->updateDirtyRange();
+            if (dialog && !dirty.isEmpty())
+                dialog->updateGraphRange(i, dirty);
+        }
+
+        pd->unlockAudioThread();
+    }
+
     void receiveObjectMessage(hash32 symbol, pd::Atom const atoms[8], int numAtoms) override
     {
         switch (symbol) {
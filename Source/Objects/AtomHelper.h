@@ -28,6 +28,7 @@ class AtomHelper {
     PluginProcessor* pd;
 
     pd::WeakReference ptr;
+    t_symbol* emptySymbol;
 
     int lastFontHeight = 10;
     hash32 lastLabelTextHash = 0;
@@ -49,6 +50,7 @@ public:
         , cnv(parent->cnv)
         , pd(parent->cnv->pd)
         , ptr(pointer)
+        , emptySymbol(pd->generateSymbol("empty"))
     {
         objectParameters.addParamCombo("Font height", cDimensions, &fontSize, { "auto", "8", "10", "12", "16", "24", "36" });
         objectParameters.addParamReceiveSymbol(&receiveSymbol);
@@ -448,7 +450,7 @@ public:
     bool hasSendSymbol()
     {
         if (auto atom = ptr.get<t_fake_gatom>()) {
-            return atom->a_symto && atom->a_symto != pd->generateSymbol("empty") && atom->a_symto != pd->generateSymbol("");
+            return atom->a_symto && atom->a_symto != emptySymbol && atom->a_symto != &s_;
         }
 
         return false;
@@ -457,7 +459,7 @@ public:
     bool hasReceiveSymbol()
     {
         if (auto atom = ptr.get<t_fake_gatom>()) {
-            return atom->a_symfrom && atom->a_symfrom != pd->generateSymbol("empty") && atom->a_symfrom != pd->generateSymbol("");
+            return atom->a_symfrom && atom->a_symfrom != emptySymbol && atom->a_symfrom != &s_;
         }
 
         return false;
@@ -107,14 +107,14 @@ public:
     {
         auto b = getLocalBounds().toFloat();
 
-        auto foregroundColour = convertColour(getValue<Colour>(iemHelper.primaryColour)); // TODO: this is some bad threading practice!
+        auto foregroundColour = convertColour(iemHelper.getPrimaryColour());
 
-        auto bgColour = getValue<Colour>(iemHelper.secondaryColour);
+        auto bgColour = iemHelper.getSecondaryColour();
 
         auto backgroundColour = convertColour(bgColour);
-        auto selectedOutlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
-        auto outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
-        auto internalLineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::guiObjectInternalOutlineColour));
+        auto selectedOutlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
+        auto outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
+        auto internalLineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::guiObjectInternalOutlineColour);
 
         nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), backgroundColour, object->isSelected() ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
 
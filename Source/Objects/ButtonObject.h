@@ -9,8 +9,9 @@ class ButtonObject final : public ObjectBase {
     bool state = false;
     bool alreadyTriggered = false;
 
-    Value primaryColour = SynchronousValue();
-    Value secondaryColour = SynchronousValue();
+    TypedValue<Colour> primaryColour;
+    TypedValue<Colour> secondaryColour;
+    NVGCachedColour primaryColourCache, secondaryColourCache;
     Value sizeProperty = SynchronousValue();
 
     enum Mode {
@@ -195,13 +196,13 @@ public:
     {
         auto b = getLocalBounds().toFloat();
 
-        auto foregroundColour = convertColour(Colour::fromString(primaryColour.toString()));
-        auto bgColour = Colour::fromString(secondaryColour.toString());
+        auto foregroundColour = primaryColourCache.getNVG(primaryColour);
+        auto bgColour = secondaryColourCache.get(secondaryColour);
         
         auto backgroundColour = convertColour(bgColour);
-        auto selectedOutlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
-        auto outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
-        auto internalLineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::guiObjectInternalOutlineColour));
+        auto selectedOutlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
+        auto outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
+        auto internalLineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::guiObjectInternalOutlineColour);
 
         nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), backgroundColour, object->isSelected() ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
 
@@ -162,7 +162,7 @@ public:
 
     void render(NVGcontext* nvg) override
     {
-        Colour bgcolour = Colour::fromString(iemHelper.secondaryColour.toString());
+        Colour bgcolour = iemHelper.getSecondaryColour();
         auto b = getLocalBounds().toFloat();
 
         auto nvgBgColour = convertColour(bgcolour);
@@ -17,6 +17,7 @@ class CommentObject final : public ObjectBase
     String objectText;
 
     CachedTextRender textRenderer;
+    SharedResourcePointer<SharedTextLayouts> sharedLayouts;
 
 public:
     CommentObject(pd::WeakReference obj, Object* object)
@@ -188,7 +189,22 @@ public:
 
         auto colour = cnv->editor->getLookAndFeel().findColour(PlugDataColour::commentTextColourId);
         int textWidth = getTextSize().getWidth() - 8;
-        if (textRenderer.prepareLayout(objText, Fonts::getDefaultFont().withHeight(15), colour, textWidth, getValue<int>(sizeProperty))) {
+
+        // The first layout is created in the background, so opening a patch full of long comments doesn't have to wait for it
+        // While editing, we need the new layout right away
+        std::function<void()> onCreated;
+        if (!editor) {
+            onCreated = [_this = SafePointer(this)] {
+                if (_this) {
+                    // updateBounds doesn't ask for the layout while the object is being dragged, so we take it here
+                    _this->updateTextLayout();
+                    _this->object->updateBounds();
+                    _this->repaint();
+                }
+            };
+        }
+
+        if (textRenderer.prepareLayout(objText, Fonts::getDefaultFont().withHeight(15), colour, textWidth, getValue<int>(sizeProperty), &sharedLayouts.get(), onCreated)) {
             repaint();
         }
     }
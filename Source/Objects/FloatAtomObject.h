@@ -152,10 +152,10 @@ public:
         input.setColour(Label::textColourId, cnv->editor->getLookAndFeel().findColour(PlugDataColour::canvasTextColourId));
         input.setColour(TextEditor::textColourId, cnv->editor->getLookAndFeel().findColour(PlugDataColour::canvasTextColourId));
 
-        backgroundColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::guiObjectBackgroundColourId));
+        backgroundColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::guiObjectBackgroundColourId);
         selCol = cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId);
         selectedOutlineColour = convertColour(selCol);
-        outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
+        outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
 
         repaint();
     }
@@ -11,8 +11,9 @@ class FunctionObject final : public ObjectBase {
 
     Value initialise = SynchronousValue();
     Value range = SynchronousValue();
-    Value primaryColour = SynchronousValue();
-    Value secondaryColour = SynchronousValue();
+    TypedValue<Colour> primaryColour;
+    TypedValue<Colour> secondaryColour;
+    NVGCachedColour primaryColourCache, secondaryColourCache;
     Value sendSymbol = SynchronousValue();
     Value receiveSymbol = SynchronousValue();
     Value sizeProperty = SynchronousValue();
@@ -108,10 +109,10 @@ public:
         bool editing = cnv->locked == var(true) || cnv->presentationMode == var(true) || ModifierKeys::getCurrentModifiers().isCtrlDown();
 
         auto b = getLocalBounds().toFloat();
-        auto backgroundColour = convertColour(Colour::fromString(secondaryColour.toString()));
-        auto foregroundColour = convertColour(Colour::fromString(primaryColour.toString()));
-        auto selectedOutlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
-        auto outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
+        auto backgroundColour = secondaryColourCache.getNVG(secondaryColour);
+        auto foregroundColour = primaryColourCache.getNVG(primaryColour);
+        auto selectedOutlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
+        auto outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
 
         nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), backgroundColour, selected ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
 
@@ -7,7 +7,9 @@
 #if ENABLE_GEM
 
 #    include <juce_opengl/juce_opengl.h>
+#    include <readerwriterqueue.h>
 #    include <Gem/src/Base/GemJUCEContext.h>
+#    include "Utility/TraceRecorder.h"
 
 void triggerMotionEvent(int x, int y);
 void triggerButtonEvent(int which, int state, int x, int y);
@@ -50,18 +52,16 @@ public:
         instance = libpd_this_instance();
 
         resizeListener.beginResize = [this]() {
-            setThis();
-            sys_lock();
-            gemBeginExternalResize();
-            sys_unlock();
+            postEvent([]() {
+                gemBeginExternalResize();
+            }, true);
         };
 
         resizeListener.endResize = [this]() {
-            setThis();
-            sys_lock();
-            gemEndExternalResize();
-            initGemWindow();
-            sys_unlock();
+            postEvent([]() {
+                gemEndExternalResize();
+                initGemWindow();
+            }, true);
         };
 
         setBounds(bounds);
@@ -108,8 +108,9 @@ public:
             h *= scale;
         }
 
-        setThis();
-        triggerResizeEvent(w, h);
+        postEvent([w, h]() {
+            triggerResizeEvent(w, h);
+        }, true);
     }
 
     void paint(Graphics&) override
@@ -118,36 +119,43 @@ public:
 
     void mouseDown(MouseEvent const& e) override
     {
-        setThis();
-        triggerButtonEvent(e.mods.isRightButtonDown(), 1, e.x, e.y);
+        postEvent([right = e.mods.isRightButtonDown(), x = e.x, y = e.y]() {
+            triggerButtonEvent(right, 1, x, y);
+        });
     }
 
     void mouseUp(MouseEvent const& e) override
     {
-        setThis();
-        triggerButtonEvent(e.mods.isRightButtonDown(), 0, e.x, e.y);
+        postEvent([right = e.mods.isRightButtonDown(), x = e.x, y = e.y]() {
+            triggerButtonEvent(right, 0, x, y);
+        }, true);
     }
 
     void mouseMove(MouseEvent const& e) override
     {
-        setThis();
-        triggerMotionEvent(e.x, e.y);
+        postEvent([x = e.x, y = e.y]() {
+            triggerMotionEvent(x, y);
+        });
     }
     void mouseDrag(MouseEvent const& e) override
     {
-        setThis();
-        triggerMotionEvent(e.x, e.y);
+        postEvent([x = e.x, y = e.y]() {
+            triggerMotionEvent(x, y);
+        });
     }
 
     void mouseWheelMove(MouseEvent const& e, MouseWheelDetails const& wheel) override
     {
-        setThis();
-        triggerWheelEvent(wheel.deltaX, wheel.deltaY);
+        postEvent([dx = wheel.deltaX, dy = wheel.deltaY]() {
+            triggerWheelEvent(dx, dy);
+        });
     }
 
     bool keyPressed(KeyPress const& key) override
     {
-        triggerKeyboardEvent(key.getTextDescription().toRawUTF8(), key.getKeyCode(), 1);
+        postEvent([text = key.getTextDescription(), code = key.getKeyCode()]() {
+            triggerKeyboardEvent(text.toRawUTF8(), code, 1);
+        });
 
         heldKeys.add(key);
 
@@ -159,23 +167,41 @@ public:
         for (int i = heldKeys.size() - 1; i >= 0; i--) {
             auto key = heldKeys[i];
             if (!KeyPress::isKeyCurrentlyDown(key.getKeyCode())) {
-                sys_lock();
-                triggerKeyboardEvent(key.getTextDescription().toRawUTF8(), key.getKeyCode(), 0);
-                sys_unlock();
+                postEvent([text = key.getTextDescription(), code = key.getKeyCode()]() {
+                    triggerKeyboardEvent(text.toRawUTF8(), code, 0);
+                }, true);
 
                 heldKeys.remove(i);
             }
         }
     }
 
-    void setThis()
+    // Input from the message thread is handed to the thread that Gem renders on, which picks it up when it swaps buffers
+    // That way the message thread never waits for the pd lock, so a heavy scene can't hold up the editor, or the other way around
+    // If Gem isn't rendering, the queue fills up and we drop input, just like Gem would have done with input it doesn't read
+    // Releases and resizes are never dropped, otherwise a patch would think a button is still held, or render at the wrong size
+    void postEvent(std::function<void()> event, bool mustArrive = false)
     {
-        libpd_set_instance(instance);
+        if (mustArrive)
+            pendingEvents.enqueue(std::move(event));
+        else
+            pendingEvents.try_enqueue(std::move(event));
+    }
+
+    // Called on the Gem thread, while holding the pd lock
+    void dispatchPendingEvents()
+    {
+        std::function<void()> event;
+        while (pendingEvents.try_dequeue(event)) {
+            event();
+        }
     }
 
     OpenGLContext openGLContext;
     t_pdinstance* instance;
+    int64 frameStartTicks = 0; // When Gem started rendering the current frame, for the trace
     Array<KeyPress> heldKeys;
+    moodycamel::ReaderWriterQueue<std::function<void()>> pendingEvents { 256 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(GemJUCEWindow)
 };
@@ -251,13 +277,19 @@ int createGemWindow(WindowInfo& info, WindowHints& hints)
 void destroyGemWindow(WindowInfo& info)
 {
     if (auto* window = info.getWindow()) {
-        GemCallOnMessageThread([window, &info]() {
-            window->removeFromDesktop();
-            window->openGLContext.detach();
-            info.window.erase(window->instance);
-            info.context.erase(window->instance);
-            gemJUCEWindow[window->instance].reset(nullptr);
+        // Gem stops using the window right away, the window itself is closed on the message thread later
+        // Waiting for that here would block while we hold the pd lock, and the message thread might be waiting for that lock
+        info.window.erase(window->instance);
+        info.context.erase(window->instance);
+        OpenGLContext::deactivateCurrentContext();
+
+        auto const instance = window->instance;
+        MessageManager::callAsync([closedWindow = gemJUCEWindow[instance].release()]() {
+            closedWindow->removeFromDesktop();
+            closedWindow->openGLContext.detach();
+            delete closedWindow;
         });
+        gemJUCEWindow.erase(instance);
     }
 }
 
@@ -271,7 +303,15 @@ void initWin_sharedContext(WindowInfo& info, WindowHints& hints)
 // Rendering
 void gemWinSwapBuffers(WindowInfo& info)
 {
+    if (auto* window = info.getWindow()) {
+        // Rendering includes the texture uploads, so this shows whether uploads still stall a frame
+        if (window->frameStartTicks)
+            TraceRecorder::recordSince("Gem::renderFrame", window->frameStartTicks);
+        window->dispatchPendingEvents();
+    }
+
     if (auto* context = info.getContext()) {
+        TraceRecorder::Scope trace("Gem::swapBuffers");
         context->makeActive();
         context->swapBuffers();
         initGemWindow(); // If we don't put this here, the background doens't get filled, but there must be a better way?
@@ -279,6 +319,9 @@ void gemWinSwapBuffers(WindowInfo& info)
 }
 void gemWinMakeCurrent(WindowInfo& info)
 {
+    if (auto* window = info.getWindow())
+        window->frameStartTicks = Time::getHighResolutionTicks();
+
     if (auto* context = info.getContext()) {
         context->initialiseOnThread();
         context->makeActive();
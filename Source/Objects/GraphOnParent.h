@@ -22,6 +22,44 @@ class GraphOnParent final : public ObjectBase {
 
     NVGImage openInGopBackground;
 
+    // The interior of the graph is drawn from a cached framebuffer, until one of its children repaints or the zoom changes
+    // Interiors that keep changing, like animated GUIs, never settle long enough to be cached
+    struct InteriorListener : public CachedComponentImage {
+        explicit InteriorListener(GraphOnParent& parent)
+            : graph(parent)
+        {
+        }
+
+        void paint(Graphics& g) override { }
+
+        bool invalidate(Rectangle<int> const& rect) override
+        {
+            graph.interiorChanged();
+            return true;
+        }
+
+        bool invalidateAll() override
+        {
+            graph.interiorChanged();
+            return true;
+        }
+
+        void releaseResources() override { }
+
+        GraphOnParent& graph;
+    };
+
+    NVGFramebuffer interiorCache;
+    float interiorCacheScale = 0.0f;
+    bool interiorCacheDirty = true;
+    uint32 lastInteriorChange = 0;
+
+    // How long the interior needs to stay unchanged before we cache it
+    static constexpr uint32 interiorSettleTimeMs = 250;
+
+    // Set while rendering into a cache, so nested graphs draw directly, and the render itself doesn't count as a change
+    inline static int cacheRenderDepth = 0;
+
 public:
     // Graph On Parent
     GraphOnParent(pd::WeakReference obj, Object* object)
@@ -38,8 +76,9 @@ public:
 
         // There is a possibility that a donecanvasdialog message is sent inbetween the initialisation in pd and the initialisation of the plugdata object, making it possible to miss this message. This especially tends to happen if the messagebox is connected to a loadbang.
         // By running another update call asynchrounously, we can still respond to the new state
+        // If the object waits to be initialised until it's in view, that update will pick up the new state instead
         MessageManager::callAsync([_this = SafePointer(this)]() {
-            if (_this) {
+            if (_this && !_this->object->guiInitialisePending) {
                 _this->update();
                 _this->valueChanged(_this->isGraphChild);
             }
@@ -208,6 +247,7 @@ public:
     {
         if (!canvas) {
             canvas = std::make_unique<Canvas>(cnv->editor, subpatch, this);
+            canvas->setCachedComponentImage(new InteriorListener(*this));
 
             // Make sure that the graph doesn't become the current canvas
             cnv->patch.setCurrent();
@@ -230,6 +270,49 @@ public:
         canvas->updateDrawables();
     }
 
+    // Part of the inner canvas that shows through the graph, in the coordinates of the inner canvas
+    Rectangle<int> getInteriorArea() const
+    {
+        return getLocalBounds() - canvas->getPosition();
+    }
+
+    void interiorChanged()
+    {
+        if (cacheRenderDepth > 0)
+            return;
+
+        interiorCacheDirty = true;
+        lastInteriorChange = Time::getMillisecondCounter();
+    }
+
+    void updateCachedRender(NVGcontext* nvg, float pixelScale, float zoom) override
+    {
+        if (!canvas || !isShowing() || getWidth() <= 0 || getHeight() <= 0)
+            return;
+
+        // Changed again since it was requested, try again once it settles
+        if (Time::getMillisecondCounter() - lastInteriorChange <= interiorSettleTimeMs)
+            return;
+
+        auto const width = roundToInt(getWidth() * zoom * pixelScale);
+        auto const height = roundToInt(getHeight() * zoom * pixelScale);
+
+        cacheRenderDepth++;
+        interiorCache.renderToFramebuffer(nvg, width, height, [this, width, height, pixelScale, zoom](NVGcontext* nvg) {
+            nvgViewport(0, 0, width, height);
+            nvgClear(nvg);
+            nvgBeginFrame(nvg, getWidth() * zoom, getHeight() * zoom, pixelScale);
+            nvgScale(nvg, zoom, zoom);
+            nvgTranslate(nvg, canvas->getX(), canvas->getY());
+            canvas->performRender(nvg, getInteriorArea());
+            nvgEndFrame(nvg);
+        });
+        cacheRenderDepth--;
+
+        interiorCacheScale = pixelScale * zoom;
+        interiorCacheDirty = false;
+    }
+
     void render(NVGcontext* nvg) override
     {
         // Strangly, the title goes below the graph content in pd
@@ -249,19 +332,32 @@ public:
         if (canvas) {
             auto invalidArea = cnv->editor->nvgSurface.getInvalidArea();
 
-            if (!invalidArea.isEmpty())
+            // While rendering into a cache, the whole interior needs to be drawn
+            if (cacheRenderDepth > 0)
+                invalidArea = getInteriorArea();
+            else if (!invalidArea.isEmpty())
                 invalidArea = canvas->getLocalArea(&cnv->editor->nvgSurface, invalidArea).expanded(1);
             else
                 return;
 
             NVGScopedState scopedState(nvg);
             nvgIntersectRoundedScissor(nvg, b.getX() + 0.75f, b.getY() + 0.75f, b.getWidth() - 1.5f, b.getHeight() - 1.5f, Corners::objectCornerRadius);
-            nvgTranslate(nvg, canvas->getX(), canvas->getY());
-            canvas->performRender(nvg, invalidArea);
+
+            auto const scale = topLevel->getRenderScale() * topLevel->zoomScale.get();
+            if (cacheRenderDepth == 0 && !interiorCacheDirty && interiorCache.isValid() && approximatelyEqual(interiorCacheScale, scale)) {
+                nvgFillPaint(nvg, nvgImagePattern(nvg, 0, 0, getWidth(), getHeight(), 0, interiorCache.getImage(), 1));
+                nvgFillRect(nvg, 0, 0, getWidth(), getHeight());
+            } else {
+                nvgTranslate(nvg, canvas->getX(), canvas->getY());
+                canvas->performRender(nvg, invalidArea);
+
+                if (cacheRenderDepth == 0 && Time::getMillisecondCounter() - lastInteriorChange > interiorSettleTimeMs)
+                    topLevel->requestCachedRenderUpdate(this);
+            }
         }
 
-        auto selectedOutlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
-        auto outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
+        auto selectedOutlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
+        auto outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
 
         if (isOpenedInSplitView) {
             auto bgColour = cnv->editor->getLookAndFeel().findColour(PlugDataColour::guiObjectBackgroundColourId);
@@ -298,7 +394,7 @@ public:
                 nvgBeginPath(nvg);
                 nvgFontFace(nvg, "Inter-Regular");
                 nvgFontSize(nvg, 12.0f);
-                nvgFillColor(nvg, convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::commentTextColourId))); // why comment colour?
+                nvgFillColor(nvg, cnv->editor->nvgSurface.getThemeColour(PlugDataColour::commentTextColourId)); // why comment colour?
                 nvgTextAlign(nvg, NVG_ALIGN_MIDDLE | NVG_ALIGN_CENTER);
                 nvgText(nvg, b.getCentreX(), b.getCentreY(), errorText.toRawUTF8(), nullptr);
             }
@@ -24,6 +24,7 @@ public:
         , cnv(parent->cnv)
         , pd(parent->cnv->pd)
         , ptr(iemgui)
+        , emptySymbol(pd->generateSymbol("empty"))
     {
     }
 
@@ -382,7 +383,7 @@ public:
     void setSendSymbol(String const& symbol) const
     {
         if (auto iemgui = ptr.get<t_iemgui>()) {
-            auto* sym = symbol.isEmpty() ? pd->generateSymbol("empty") : pd->generateSymbol(symbol);
+            auto* sym = symbol.isEmpty() ? emptySymbol : pd->generateSymbol(symbol);
             iemgui_send(iemgui.get(), iemgui.get(), sym);
         }
     }
@@ -390,11 +391,15 @@ public:
     void setReceiveSymbol(String const& symbol) const
     {
         if (auto iemgui = ptr.get<t_iemgui>()) {
-            auto* sym = symbol.isEmpty() ? pd->generateSymbol("empty") : pd->generateSymbol(symbol);
+            auto* sym = symbol.isEmpty() ? emptySymbol : pd->generateSymbol(symbol);
             iemgui_receive(iemgui.get(), iemgui.get(), sym);
         }
     }
 
+    // The colours as currently set in the properties, for rendering without locking pd every frame
+    Colour getPrimaryColour() { return primaryColourCache.get(primaryColour); }
+    Colour getSecondaryColour() { return secondaryColourCache.get(secondaryColour); }
+
     Colour getBackgroundColour() const
     {
         if (auto iemgui = ptr.get<t_iemgui>()) {
@@ -519,11 +524,14 @@ public:
     PluginProcessor* pd;
 
     pd::WeakReference ptr;
+    t_symbol* emptySymbol;
 
-    Value primaryColour = SynchronousValue();
-    Value secondaryColour = SynchronousValue();
+    TypedValue<Colour> primaryColour;
+    TypedValue<Colour> secondaryColour;
     Value labelColour = SynchronousValue();
 
+    NVGCachedColour primaryColourCache, secondaryColourCache;
+
     Value labelX = SynchronousValue(0.0f);
     Value labelY = SynchronousValue(0.0f);
     Value labelHeight = SynchronousValue(18.0f);
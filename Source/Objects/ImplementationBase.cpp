@@ -52,25 +52,14 @@ Canvas* ImplementationBase::getMainCanvas(t_canvas* patchPtr, bool alsoSearchRoo
                 return cnv;
             }
         }
-        for (auto* cnv : editor->getCanvases()) {
-            auto glist = cnv->patch.getPointer();
-            if (glist && glist.get() == patchPtr) {
-                return cnv;
-            }
-        }
     }
 
-    if (alsoSearchRoot) {
-        patchPtr = glist_getcanvas(patchPtr);
-        for (auto* editor : editors) {
-            for (auto* cnv : editor->getCanvases()) {
-                auto glist = cnv->patch.getPointer();
-                if (glist && glist.get() == patchPtr) {
-                    return cnv;
-                }
-            }
-        }
-    }
+    auto& implementations = pd->getObjectImplementations();
+    if (auto* cnv = implementations.findCanvas(patchPtr))
+        return cnv;
+
+    if (alsoSearchRoot)
+        return implementations.findCanvas(glist_getcanvas(patchPtr));
 
     return nullptr;
 }
@@ -90,6 +79,9 @@ bool ImplementationBase::hasImplementation(char const* type)
     case hash("mouse"):
     case hash("mousestate"):
     case hash("mousefilter"):
+#if ENABLE_GEM
+    case hash("pix_texture"):
+#endif
         return true;
 
     default:
@@ -122,6 +114,10 @@ ImplementationBase* ImplementationBase::createImplementation(String const& type,
         return new MouseStateObject(ptr, cnv, pd);
     case hash("mousefilter"):
         return new MouseFilterObject(ptr, cnv, pd);
+#if ENABLE_GEM
+    case hash("pix_texture"):
+        return new PixTextureObject(ptr, cnv, pd);
+#endif
 
     default:
         break;
@@ -178,50 +174,97 @@ ObjectImplementationManager::ObjectImplementationManager(pd::Instance* processor
 
 void ObjectImplementationManager::handleAsyncUpdate()
 {
+    auto const fullUpdate = std::exchange(fullUpdatePending, false);
+    auto const rootPatches = std::exchange(changedRootPatches, {});
+
+    // Full updates come from canvases opening or closing, so the canvas lookup needs to be rebuilt
+    if (fullUpdate)
+        canvasesChanged = true;
+
+    // Objects that pd deleted go first, a new object can be created at the same address
+    for (auto it = objectImplementations.begin(); it != objectImplementations.end();) {
+        if (!it->second->ptr.isValid()) {
+            it = objectImplementations.erase(it);
+        } else {
+            it++;
+        }
+    }
+
     Array<std::pair<t_canvas*, t_gobj*>> allImplementations;
 
     pd->setThis();
 
+    // The changed patches might have been closed since, so we only search the ones pd still has
     pd->lockAudioThread();
     for (auto* cnv = pd_getcanvaslist(); cnv; cnv = cnv->gl_next) {
+        if (!fullUpdate && !rootPatches.count(cnv))
+            continue;
+
         for (auto* object : getImplementationsForPatch(cnv)) {
             allImplementations.add({ cnv, object });
         }
     }
     pd->unlockAudioThread();
 
-    // Remove unused object implementations
-    for (auto it = objectImplementations.cbegin(); it != objectImplementations.cend();) {
-        auto& [ptr, implementation] = *it;
-
-        auto found = std::find_if(allImplementations.begin(), allImplementations.end(), [ptr = ptr](auto const& toCompare) {
-            return std::get<1>(toCompare) == ptr;
-        });
-
-        if (found == allImplementations.end()) {
-            objectImplementations.erase(it++);
-        } else {
-            it++;
+    // Remove unused object implementations, we can only tell which ones are unused when we've seen everything
+    if (fullUpdate) {
+        std::set<t_gobj*> usedObjects;
+        for (auto& [cnv, obj] : allImplementations)
+            usedObjects.insert(obj);
+
+        for (auto it = objectImplementations.begin(); it != objectImplementations.end();) {
+            if (!usedObjects.count(it->first)) {
+                it = objectImplementations.erase(it);
+            } else {
+                it++;
+            }
         }
     }
 
     for (auto& [cnv, obj] : allImplementations) {
-        if (!objectImplementations.count(obj)) {
-
+        auto& implementation = objectImplementations[obj];
+        if (!implementation) {
             auto const name = String::fromUTF8(pd::Interface::getObjectClassName(&obj->g_pd));
-
-            objectImplementations[obj] = std::unique_ptr<ImplementationBase>(ImplementationBase::createImplementation(name, obj, cnv, pd));
+            implementation = std::unique_ptr<ImplementationBase>(ImplementationBase::createImplementation(name, obj, cnv, pd));
+        }
+        // An implementation that already exists only needs to update if the open canvases changed
+        else if (!fullUpdate) {
+            continue;
         }
 
-        objectImplementations[obj]->update();
+        implementation->update();
     }
 }
 
-void ObjectImplementationManager::updateObjectImplementations()
+void ObjectImplementationManager::updateObjectImplementations(t_canvas* changedPatch)
 {
+    if (changedPatch) {
+        while (changedPatch->gl_owner)
+            changedPatch = changedPatch->gl_owner;
+        changedRootPatches.insert(changedPatch);
+    } else {
+        fullUpdatePending = true;
+    }
+
     triggerAsyncUpdate();
 }
 
+Canvas* ObjectImplementationManager::findCanvas(t_canvas* patch)
+{
+    if (std::exchange(canvasesChanged, false)) {
+        canvasesByPatch.clear();
+        for (auto* editor : pd->getEditors()) {
+            for (auto* cnv : editor->getCanvases()) {
+                if (auto glist = cnv->patch.getPointer())
+                    canvasesByPatch.try_emplace(glist.get(), cnv);
+            }
+        }
+    }
+
+    auto it = canvasesByPatch.find(patch);
+    return it != canvasesByPatch.end() ? it->second.getComponent() : nullptr;
+}
+
 Array<t_gobj*> ObjectImplementationManager::getImplementationsForPatch(t_canvas* patch)
 {
     Array<t_gobj*> implementations;
@@ -41,9 +41,14 @@ class ObjectImplementationManager : public AsyncUpdater {
 public:
     explicit ObjectImplementationManager(pd::Instance* pd);
 
-    void updateObjectImplementations();
+    // With a patch, only searches the root of that patch for new objects, and leaves the existing implementations alone
+    // Without one, searches everything and updates all implementations, because the open canvases might have changed
+    void updateObjectImplementations(t_canvas* changedPatch = nullptr);
     void clearObjectImplementationsForPatch(t_canvas* patch);
 
+    // The first open canvas that shows this patch
+    Canvas* findCanvas(t_canvas* patch);
+
     void handleAsyncUpdate() override;
 
 private:
@@ -52,4 +57,11 @@ private:
     PluginProcessor* pd;
 
     std::map<t_gobj*, std::unique_ptr<ImplementationBase>> objectImplementations;
+
+    bool fullUpdatePending = false;
+    std::set<t_canvas*> changedRootPatches;
+
+    // Rebuilt after canvases were opened or closed, the safe pointers cover canvases that closed since
+    std::unordered_map<t_canvas*, Component::SafePointer<Canvas>> canvasesByPatch;
+    bool canvasesChanged = true;
 };
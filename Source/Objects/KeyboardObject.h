@@ -12,6 +12,16 @@ class MIDIKeyboard : public MidiKeyboardState
 
 public:
     int clickedKey = -1;
+    int hoveredKey = -1;
+
+    // Keys are drawn from images of the whole keyboard with every key in the same state, one image per state
+    enum KeyState {
+        Up,
+        Over,
+        Down,
+        NumKeyStates
+    };
+    KeyState paintedState = Up;
 
     std::set<int> heldKeys;
     std::set<int> toggledKeys;
@@ -83,6 +93,50 @@ public:
         return false;
     }
 
+    KeyState getKeyState(int midiNoteNumber) const
+    {
+        if (heldKeys.count(midiNoteNumber) || toggledKeys.count(midiNoteNumber))
+            return Down;
+        if (midiNoteNumber == hoveredKey)
+            return Over;
+        return Up;
+    }
+
+    // Only the area of the key needs to be drawn again, black keys are part of the area of the white keys around them
+    void repaintKey(int midiNoteNumber)
+    {
+        if (isPositiveAndBelow(midiNoteNumber, 128))
+            repaint(getRectangleForKey(midiNoteNumber).getSmallestIntegerContainer());
+    }
+
+    void setHoveredKey(int midiNoteNumber)
+    {
+        if (midiNoteNumber == hoveredKey)
+            return;
+
+        repaintKey(hoveredKey);
+        hoveredKey = midiNoteNumber;
+        repaintKey(hoveredKey);
+    }
+
+    void mouseMove(MouseEvent const& e) override
+    {
+        MidiKeyboardComponent::mouseMove(e);
+        setHoveredKey(getNoteAndVelocityAtPosition(e.position).note);
+    }
+
+    void mouseDrag(MouseEvent const& e) override
+    {
+        MidiKeyboardComponent::mouseDrag(e);
+        setHoveredKey(getNoteAndVelocityAtPosition(e.position).note);
+    }
+
+    void mouseExit(MouseEvent const& e) override
+    {
+        MidiKeyboardComponent::mouseExit(e);
+        setHoveredKey(-1);
+    }
+
     void resetToggledKeys()
     {
         for (auto key : toggledKeys){
@@ -138,7 +192,8 @@ public:
 
     void drawWhiteNote(int midiNoteNumber, Graphics& g, Rectangle<float> area, bool isDown, bool isOver, Colour lineColour, Colour textColour) override
     {
-        isDown = heldKeys.count(midiNoteNumber) || toggledKeys.count(midiNoteNumber);
+        isDown = paintedState == Down;
+        isOver = paintedState == Over;
 
         auto c = Colour(225, 225, 225);
         if (isOver)
@@ -208,7 +263,8 @@ public:
     {
         auto c = Colour(90, 90, 90);
 
-        isDown = heldKeys.count(midiNoteNumber) || toggledKeys.count(midiNoteNumber);
+        isDown = paintedState == Down;
+        isOver = paintedState == Over;
 
         if (isOver)
             c = Colour(101, 101, 101);
@@ -221,7 +277,7 @@ public:
 };
 // ELSE keyboard
 class KeyboardObject final : public ObjectBase
-    , public Timer {
+    , public FrameScheduler::Poller {
 
     Value lowC = SynchronousValue();
     Value octaves = SynchronousValue();
@@ -235,7 +291,10 @@ class KeyboardObject final : public ObjectBase
     MIDIKeyboard keyboard;
     int keyRatio = 5;
 
-    std::unique_ptr<NanoVGGraphicsContext> nvgCtx = nullptr;
+    // Notes that were on in pd at the last frame, only the keys that changed since then get repainted
+    std::bitset<128> pdNotes;
+
+    NVGResourceCache::Handle<NVGImage> keyImages[MIDIKeyboard::NumKeyStates];
 
 public:
     KeyboardObject(pd::WeakReference ptr, Object* object)
@@ -279,7 +338,7 @@ public:
         objectParameters.addParamReceiveSymbol(&receiveSymbol);
         objectParameters.addParamSendSymbol(&sendSymbol);
 
-        startTimer(50);
+        cnv->editor->frameScheduler.addPoller(this, 50);
     }
 
     void update() override
@@ -308,14 +367,68 @@ public:
         keyboard.setToggleMode(getValue<bool>(toggleMode));
     }
 
+    // The keyboard is drawn once per key state into images, shared by all keyboards that look the same
+    // Every frame draws the image with all keys up, and only the keys that are pressed or hovered on top of it
     void render(NVGcontext* nvg) override
     {
-        if (!nvgCtx || nvgCtx->getContext() != nvg)
-            nvgCtx = std::make_unique<NanoVGGraphicsContext>(nvg);
-        Graphics g(*nvgCtx);
-        {
-            paintEntireComponent(g, true);
+        auto const b = getLocalBounds().toFloat();
+        bool const selected = object->isSelected() && !cnv->isGraph;
+        auto& surface = cnv->editor->nvgSurface;
+
+        nvgFillColor(nvg, surface.getThemeColour(PlugDataColour::guiObjectBackgroundColourId));
+        nvgFillRoundedRect(nvg, b.getX() + 0.5f, b.getY() + 0.5f, b.getWidth() - 1.0f, b.getHeight() - 1.0f, Corners::objectCornerRadius);
+
+        auto const width = keyboard.getWidth();
+        auto const height = keyboard.getHeight();
+        if (width > 0 && height > 0) {
+            auto const scale = getImageScale();
+            bool const showOctaves = !getValue<bool>(cnv->locked) && !cnv->editor->isInPluginMode();
+            auto const variant = NVGResourceCache::getVariant({ static_cast<uint32>(keyboard.getRangeStart()), static_cast<uint32>(keyboard.getRangeEnd()),
+                static_cast<uint32>(roundToInt(keyboard.getKeyWidth() * 100.0f)), showOctaves, surface.getThemeColours().getVersion() });
+
+            for (int state = 0; state < MIDIKeyboard::NumKeyStates; state++) {
+                auto const key = NVGResourceCache::Key { NVGResourceCache::KeyboardKeys, roundToInt(width * scale), roundToInt(height * scale), NVGResourceCache::getVariant({ variant, static_cast<uint32>(state) }) };
+                surface.getResourceCache().updateImage(nvg, keyImages[state], key, [this, scale, state](Graphics& g) {
+                    g.addTransform(AffineTransform::scale(scale));
+                    keyboard.paintedState = static_cast<MIDIKeyboard::KeyState>(state);
+                    keyboard.paint(g);
+                    keyboard.paintedState = MIDIKeyboard::Up;
+                });
+            }
+
+            auto drawKeys = [nvg, this, width, height](int state, Rectangle<float> area) {
+                nvgFillPaint(nvg, nvgImagePattern(nvg, 0, 0, width, height, 0, keyImages[state].getImage(), 1));
+                nvgFillRect(nvg, area.getX(), area.getY(), area.getWidth(), area.getHeight());
+            };
+
+            drawKeys(MIDIKeyboard::Up, keyboard.getLocalBounds().toFloat());
+
+            // White keys first, they cover the black keys next to them, so those are drawn again after
+            auto const rangeStart = keyboard.getRangeStart();
+            auto const rangeEnd = keyboard.getRangeEnd();
+            std::bitset<128> whiteKeysDrawn;
+            for (int note = rangeStart; note <= rangeEnd; note++) {
+                auto const state = keyboard.getKeyState(note);
+                if (state != MIDIKeyboard::Up && !MidiMessage::isMidiNoteBlack(note)) {
+                    drawKeys(state, keyboard.getRectangleForKey(note));
+                    whiteKeysDrawn.set(note);
+                }
+            }
+            for (int note = rangeStart; note <= rangeEnd; note++) {
+                if (!MidiMessage::isMidiNoteBlack(note))
+                    continue;
+
+                auto const state = keyboard.getKeyState(note);
+                if (state != MIDIKeyboard::Up || (note > 0 && whiteKeysDrawn[note - 1]) || (note < 127 && whiteKeysDrawn[note + 1]))
+                    drawKeys(state, keyboard.getRectangleForKey(note));
+            }
         }
+
+        nvgBeginPath(nvg);
+        nvgRoundedRect(nvg, b.getX() + 0.5f, b.getY() + 0.5f, b.getWidth() - 1.0f, b.getHeight() - 1.0f, Corners::objectCornerRadius);
+        nvgStrokeColor(nvg, surface.getThemeColour(selected ? PlugDataColour::objectSelectedOutlineColourId : PlugDataColour::objectOutlineColourId));
+        nvgStrokeWidth(nvg, 1.0f);
+        nvgStroke(nvg);
     }
 
     void updateSizeProperty() override
@@ -424,19 +537,35 @@ public:
 
     void updateValue()
     {
-        int notes[256];
+        auto const rangeStart = std::max(keyboard.getRangeStart(), 0);
+        auto const rangeEnd = std::min(keyboard.getRangeEnd(), 127);
+
+        std::bitset<128> notes;
         if (auto obj = ptr.get<t_fake_keyboard>()) {
-            memcpy(notes, obj->x_tgl_notes, 256 * sizeof(int));
+            for (int i = rangeStart; i <= rangeEnd; i++) {
+                notes[i] = obj->x_tgl_notes[i] != 0;
+            }
+        } else {
+            return;
         }
 
-        for (int i = keyboard.getRangeStart(); i <= keyboard.getRangeEnd(); i++) {
+        auto const changed = notes ^ pdNotes;
+        pdNotes = notes;
+        if (changed.none())
+            return;
+
+        bool const isToggleMode = getValue<bool>(toggleMode);
+        for (int i = rangeStart; i <= rangeEnd; i++) {
+            if (!changed[i])
+                continue;
+
             if (notes[i] && !keyboard.heldKeys.contains(i)) {
                 keyboard.heldKeys.insert(i);
-                repaint();
+                keyboard.repaintKey(i);
             }
-            if (!notes[i] && keyboard.heldKeys.contains(i) && keyboard.clickedKey != i && !getValue<bool>(toggleMode)) {
+            if (!notes[i] && keyboard.heldKeys.contains(i) && keyboard.clickedKey != i && !isToggleMode) {
                 keyboard.heldKeys.erase(i);
-                repaint();
+                keyboard.repaintKey(i);
             }
         }
     }
@@ -448,7 +577,7 @@ public:
         else
             keyboard.heldKeys.erase(midiNoteNumber);
 
-        keyboard.repaint();
+        keyboard.repaintKey(midiNoteNumber);
     }
 
     void notesOn(pd::Atom const atoms[8], int numAtoms, bool isOn)
@@ -458,8 +587,9 @@ public:
                 keyboard.heldKeys.insert(atoms[at].getFloat());
             else
                 keyboard.heldKeys.erase(atoms[at].getFloat());
+
+            keyboard.repaintKey(atoms[at].getFloat());
         }
-        keyboard.repaint();
     }
 
     void receiveObjectMessage(hash32 symbol, pd::Atom const atoms[8], int numAtoms) override
@@ -542,17 +672,13 @@ public:
         return sSymbol.isNotEmpty() && (sSymbol != "empty");
     }
 
-    void timerCallback() override
+    bool shouldPoll() override
     {
-        updateValue();
+        return isOnScreen();
     }
 
-    void paintOverChildren(Graphics& g) override
+    void pollFrame() override
     {
-        bool selected = object->isSelected() && !cnv->isGraph;
-        auto outlineColour = cnv->editor->getLookAndFeel().findColour(selected ? PlugDataColour::objectSelectedOutlineColourId : PlugDataColour::objectOutlineColourId);
-
-        g.setColour(outlineColour);
-        g.drawRoundedRectangle(getLocalBounds().toFloat().reduced(0.5f), Corners::objectCornerRadius, 1.0f);
+        updateValue();
     }
 };
@@ -66,41 +66,77 @@ public:
         arcStart = newArcStart;
     }
 
-    void render(NVGcontext* nvg) override
-    {
-        auto bounds = getLocalBounds().toFloat().reduced(getWidth() * 0.14f);
-
-        auto const lineThickness = std::max(bounds.getWidth() * 0.09f, 1.5f);
+    struct Geometry {
+        Rectangle<float> bounds;
+        float lineThickness;
+        float startAngle, endAngle;
+        float angle, centre;
+        float arcRadius, arcWidth;
+    };
 
-        auto sliderPosProportional = getValue();
+    Geometry getGeometry()
+    {
+        Geometry geometry;
+        geometry.bounds = getLocalBounds().toFloat().reduced(getWidth() * 0.14f);
+        geometry.lineThickness = std::max(geometry.bounds.getWidth() * 0.09f, 1.5f);
 
         auto startAngle = getRotaryParameters().startAngleRadians - (MathConstants<float>::pi * 0.5f);
         auto endAngle = getRotaryParameters().endAngleRadians - (MathConstants<float>::pi * 0.5f);
 
-        auto angle = jmap<float>(sliderPosProportional, startAngle, endAngle);
-        auto centre = jmap<double>(arcStart, startAngle, endAngle);
+        geometry.angle = jmap<float>(getValue(), startAngle, endAngle);
+        geometry.centre = jmap<float>(arcStart, startAngle, endAngle);
 
-        startAngle = std::clamp(startAngle, endAngle - MathConstants<float>::twoPi, endAngle + MathConstants<float>::twoPi);
+        geometry.startAngle = std::clamp(startAngle, endAngle - MathConstants<float>::twoPi, endAngle + MathConstants<float>::twoPi);
+        geometry.endAngle = endAngle;
 
-        if (drawArc) {
-            auto arcBounds = bounds.reduced(lineThickness);
-            auto arcRadius = arcBounds.getWidth() * 0.5;
-            auto arcWidth = (arcRadius - lineThickness) / arcRadius;
+        auto arcBounds = geometry.bounds.reduced(geometry.lineThickness);
+        geometry.arcRadius = arcBounds.getWidth() * 0.5f;
+        geometry.arcWidth = (geometry.arcRadius - geometry.lineThickness) / geometry.arcRadius;
+        return geometry;
+    }
+
+    // Hash of everything renderStatic depends on, besides the size
+    hash32 getStaticVariant()
+    {
+        auto const geometry = getGeometry();
+        return NVGResourceCache::getVariant({ fgColour.getARGB(), arcColour.getARGB(), static_cast<uint32>(numberOfTicks), drawArc,
+            static_cast<uint32>(roundToInt(geometry.startAngle * 10000.0f)), static_cast<uint32>(roundToInt(geometry.endAngle * 10000.0f)) });
+    }
 
+    // The parts that don't move with the value: the arc behind the value and the ticks
+    void renderStatic(NVGcontext* nvg)
+    {
+        auto const geometry = getGeometry();
+        auto const& bounds = geometry.bounds;
+
+        if (drawArc) {
             nvgBeginPath(nvg);
-            nvgArc(nvg, bounds.getCentreX(), bounds.getCentreY(), arcRadius, startAngle, endAngle, NVG_HOLE);
-            nvgStrokeWidth(nvg, arcWidth * lineThickness);
+            nvgArc(nvg, bounds.getCentreX(), bounds.getCentreY(), geometry.arcRadius, geometry.startAngle, geometry.endAngle, NVG_HOLE);
+            nvgStrokeWidth(nvg, geometry.arcWidth * geometry.lineThickness);
             nvgStrokeColor(nvg, nvgRGBAf(arcColour.getFloatRed(), arcColour.getFloatGreen(), arcColour.getFloatBlue(), arcColour.getFloatAlpha()));
             nvgStroke(nvg);
+        }
 
+        drawTicks(nvg, bounds, geometry.startAngle, geometry.endAngle, geometry.lineThickness);
+    }
+
+    // The value arc and the wiper
+    void renderValue(NVGcontext* nvg)
+    {
+        auto const geometry = getGeometry();
+        auto const& bounds = geometry.bounds;
+        auto const angle = geometry.angle;
+        auto const centre = geometry.centre;
+
+        if (drawArc) {
             nvgBeginPath(nvg);
             if (centre < angle) {
-                nvgArc(nvg, bounds.getCentreX(), bounds.getCentreY(), arcRadius, centre, angle, NVG_HOLE);
+                nvgArc(nvg, bounds.getCentreX(), bounds.getCentreY(), geometry.arcRadius, centre, angle, NVG_HOLE);
             } else {
-                nvgArc(nvg, bounds.getCentreX(), bounds.getCentreY(), arcRadius, angle, centre, NVG_HOLE);
+                nvgArc(nvg, bounds.getCentreX(), bounds.getCentreY(), geometry.arcRadius, angle, centre, NVG_HOLE);
             }
             nvgStrokeColor(nvg, nvgRGBAf(fgColour.getFloatRed(), fgColour.getFloatGreen(), fgColour.getFloatBlue(), fgColour.getFloatAlpha()));
-            nvgStrokeWidth(nvg, arcWidth * lineThickness);
+            nvgStrokeWidth(nvg, geometry.arcWidth * geometry.lineThickness);
             nvgStroke(nvg);
         }
 
@@ -109,14 +145,18 @@ public:
 
         // draw wiper
         nvgBeginPath(nvg);
-        nvgMoveTo(nvg, bounds.getCentreX(), bounds.getCentreY()); // Adjust parameters as needed
-        nvgLineTo(nvg, wiperX, wiperY);                           // Adjust parameters as needed
-        nvgStrokeWidth(nvg, lineThickness);
+        nvgMoveTo(nvg, bounds.getCentreX(), bounds.getCentreY());
+        nvgLineTo(nvg, wiperX, wiperY);
+        nvgStrokeWidth(nvg, geometry.lineThickness);
         nvgStrokeColor(nvg, nvgRGBAf(fgColour.getFloatRed(), fgColour.getFloatGreen(), fgColour.getFloatBlue(), fgColour.getFloatAlpha()));
         nvgLineCap(nvg, NVG_ROUND);
         nvgStroke(nvg);
+    }
 
-        drawTicks(nvg, bounds, startAngle, endAngle, lineThickness);
+    void render(NVGcontext* nvg) override
+    {
+        renderStatic(nvg);
+        renderValue(nvg);
     }
 
     void setFgColour(Colour newFgColour)
@@ -154,9 +194,11 @@ class KnobObject final : public ObjectBase {
     Value outline = SynchronousValue();
     Value showArc = SynchronousValue();
     Value exponential = SynchronousValue();
-    Value primaryColour = SynchronousValue();
-    Value secondaryColour = SynchronousValue();
+    TypedValue<Colour> primaryColour;
+    TypedValue<Colour> secondaryColour;
     Value arcColour = SynchronousValue();
+    NVGCachedColour secondaryColourCache;
+    NVGResourceCache::Handle<NVGFramebuffer> chrome;
     Value sendSymbol = SynchronousValue();
     Value receiveSymbol = SynchronousValue();
     Value arcStart = SynchronousValue();
@@ -446,32 +488,72 @@ public:
         }
     }
 
+    NVGResourceCache::Key getChromeKey(float scale)
+    {
+        bool const selected = object->isSelected() && !cnv->isGraph;
+        auto const variant = NVGResourceCache::getVariant({ knob.getStaticVariant(), secondaryColourCache.get(secondaryColour).getARGB(),
+            ::getValue<bool>(outline), selected, cnv->editor->nvgSurface.getThemeColours().getVersion() });
+        return { NVGResourceCache::KnobChrome, roundToInt(getWidth() * scale), roundToInt(getHeight() * scale), variant };
+    }
+
+    // Everything but the value is drawn from a framebuffer, shared by all knobs that look the same at this zoom
     void render(NVGcontext* nvg) override
+    {
+        auto const scale = getCachedRenderScale();
+        if (scale > 0.0f && chrome.matches(getChromeKey(scale))) {
+            nvgFillPaint(nvg, nvgImagePattern(nvg, 0, 0, getWidth(), getHeight(), 0, chrome.getImage(), 1));
+            nvgFillRect(nvg, 0, 0, getWidth(), getHeight());
+        } else {
+            renderChrome(nvg);
+            if (scale > 0.0f)
+                requestCachedRenderUpdate();
+        }
+
+        knob.renderValue(nvg);
+    }
+
+    void updateCachedRender(NVGcontext* nvg, float pixelScale, float zoom) override
+    {
+        if (getWidth() <= 0 || getHeight() <= 0)
+            return;
+
+        auto const key = getChromeKey(pixelScale * zoom);
+        cnv->editor->nvgSurface.getResourceCache().updateFramebuffer(nvg, chrome, key, [this, &key, pixelScale, zoom](NVGcontext* nvg) {
+            nvgViewport(0, 0, key.width, key.height);
+            nvgClear(nvg);
+            nvgBeginFrame(nvg, getWidth() * zoom, getHeight() * zoom, pixelScale);
+            nvgScale(nvg, zoom, zoom);
+            renderChrome(nvg);
+            nvgEndFrame(nvg);
+        });
+    }
+
+    void renderChrome(NVGcontext* nvg)
     {
         auto b = getLocalBounds().toFloat();
-        auto bgColour = Colour::fromString(secondaryColour.toString());
+        auto bgColour = secondaryColourCache.getNVG(secondaryColour);
 
         if (::getValue<bool>(outline)) {
             bool selected = object->isSelected() && !cnv->isGraph;
-            auto outlineColour = cnv->editor->getLookAndFeel().findColour(selected ? PlugDataColour::objectSelectedOutlineColourId : objectOutlineColourId);
+            auto outlineColour = cnv->editor->nvgSurface.getThemeColour(selected ? PlugDataColour::objectSelectedOutlineColourId : objectOutlineColourId);
 
-            nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), convertColour(bgColour), convertColour(outlineColour), Corners::objectCornerRadius);
+            nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), bgColour, outlineColour, Corners::objectCornerRadius);
         } else {
             auto circleBounds = getLocalBounds().toFloat().reduced(getWidth() * 0.13f);
             auto const lineThickness = std::max(circleBounds.getWidth() * 0.07f, 1.5f);
             circleBounds = circleBounds.reduced(lineThickness - 0.5f);
 
-            nvgFillColor(nvg, convertColour(bgColour));
+            nvgFillColor(nvg, bgColour);
             nvgBeginPath(nvg);
             nvgCircle(nvg, circleBounds.getCentreX(), circleBounds.getCentreY(), circleBounds.getWidth() / 2.0f);
             nvgFill(nvg);
 
-            nvgStrokeColor(nvg, convertColour(cnv->editor->getLookAndFeel().findColour(objectOutlineColourId)));
+            nvgStrokeColor(nvg, cnv->editor->nvgSurface.getThemeColour(objectOutlineColourId));
             nvgStrokeWidth(nvg, 1.0f);
             nvgStroke(nvg);
         }
 
-        knob.render(nvg);
+        knob.renderStatic(nvg);
     }
 
     void resized() override
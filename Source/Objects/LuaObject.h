@@ -19,7 +19,7 @@ void pdlua_gfx_repaint(t_pdlua* o, int firsttime);
 }
 
 class LuaObject final : public ObjectBase
-    , public Timer {
+    , public FrameScheduler::Poller {
 
     Colour currentColour;
 
@@ -65,14 +65,57 @@ class LuaObject final : public ObjectBase
         }
     };
 
-    std::vector<LuaGuiMessage> guiCommandBuffer;
+    // Messages that arrive outside of a paint, like lua_resized
     moodycamel::ReaderWriterQueue<LuaGuiMessage> guiMessageQueue;
 
+    // pdlua sends the draw commands of a frame from the pd thread, between lua_start_paint and lua_end_paint
+    // We collect them in a command list, and hand finished lists to the message thread through a triple buffer
+    // The lists keep their memory, so once they've grown big enough, painting doesn't allocate anymore
+    struct DrawCommandList {
+        struct Command {
+            t_symbol* symbol;
+            int offset; // Index of the first atom
+            int size;
+        };
+
+        std::vector<Command> commands;
+        std::vector<t_atom> atoms;
+
+        void clear()
+        {
+            commands.clear();
+            atoms.clear();
+        }
+
+        void add(t_symbol* symbol, int argc, t_atom* argv)
+        {
+            commands.push_back({ symbol, static_cast<int>(atoms.size()), argc });
+            atoms.insert(atoms.end(), argv, argv + argc);
+        }
+    };
+
+    // Bit 2 of middleList is set when it holds a frame the message thread hasn't picked up yet
+    static constexpr int freshFlag = 4;
+    DrawCommandList drawLists[3];
+    int backList = 0;  // pd thread only
+    int frontList = 1; // Message thread only
+    std::atomic<int> middleList = 2;
+    bool isPainting = false; // pd thread only
+
+    // The front list holds a complete frame, which we can draw again when only the zoom, colours or selection changed
+    bool hasFrame = false;
+    bool needsRedraw = false;
+
+    t_symbol* startPaintSymbol;
+    t_symbol* endPaintSymbol;
+
     static inline std::map<t_pdlua*, std::vector<LuaObject*>> allDrawTargets = std::map<t_pdlua*, std::vector<LuaObject*>>();
 
 public:
     LuaObject(pd::WeakReference obj, Object* parent)
         : ObjectBase(obj, parent)
+        , startPaintSymbol(pd->generateSymbol("lua_start_paint"))
+        , endPaintSymbol(pd->generateSymbol("lua_end_paint"))
     {
         if (auto pdlua = ptr.get<t_pdlua>()) {
             pdlua->gfx.plugdata_draw_callback = &drawCallback;
@@ -80,7 +123,8 @@ public:
         }
 
         parentHierarchyChanged();
-        startTimerHz(60);
+        // Always polls, even when it can't be seen, otherwise the draw commands would keep piling up
+        cnv->editor->frameScheduler.addPoller(this, 0);
     }
 
     ~LuaObject()
@@ -187,7 +231,7 @@ public:
 
     void lookAndFeelChanged() override
     {
-        sendRepaintMessage();
+        needsRedraw = true;
     }
 
     void render(NVGcontext* nvg) override
@@ -197,7 +241,8 @@ public:
 
     void valueChanged(Value& v) override
     {
-        sendRepaintMessage();
+        // Zooming only changes the resolution of the framebuffer, so we don't need pdlua to paint again
+        needsRedraw = true;
     }
 
     void handleGuiMessage(t_symbol* sym, int argc, t_atom* argv)
@@ -472,49 +517,64 @@ public:
         }
     }
 
-    void timerCallback() override
+    void pollFrame() override
     {
         LuaGuiMessage guiMessage;
         while (guiMessageQueue.try_dequeue(guiMessage)) {
-            guiCommandBuffer.push_back(guiMessage);
+            handleGuiMessage(guiMessage.symbol, guiMessage.size, guiMessage.data.data());
+        }
+
+        if (isSelected != object->isSelected()) {
+            isSelected = object->isSelected();
+            needsRedraw = true;
         }
 
-        auto* startMesage = pd->generateSymbol("lua_start_paint");
-        auto* endMessage = pd->generateSymbol("lua_end_paint");
+        // Only a new frame from pdlua means that the content changed, otherwise we keep the framebuffer we have
+        if (middleList.load(std::memory_order_relaxed) & freshFlag) {
+            frontList = middleList.exchange(frontList, std::memory_order_acq_rel) & 3;
+            hasFrame = true;
+            needsRedraw = true;
+        }
 
-        int startIdx = -1, endIdx = -1;
-        bool updateScene = false;
-        for (int i = guiCommandBuffer.size() - 1; i >= 0; i--) {
-            if (guiCommandBuffer[i].symbol == startMesage)
-                startIdx = i;
-            if (guiCommandBuffer[i].symbol == endMessage)
-                endIdx = i + 1;
+        if (!hasFrame) {
+            sendRepaintMessage();
+            return;
+        }
 
-            if (startIdx != -1 && endIdx != -1) {
-                updateScene = true;
-                break;
+        if (needsRedraw || !framebuffer.isValid()) {
+            needsRedraw = false;
+            auto& list = drawLists[frontList];
+            for (auto const& command : list.commands) {
+                handleGuiMessage(command.symbol, command.size, list.atoms.data() + command.offset);
             }
         }
+    }
 
-        if (updateScene) {
-            if (endIdx > startIdx) {
-                for (int i = startIdx; i < endIdx; i++) {
-                    handleGuiMessage(guiCommandBuffer[i].symbol, guiCommandBuffer[i].size, guiCommandBuffer[i].data.data());
-                }
-            }
-            guiCommandBuffer.erase(guiCommandBuffer.begin(), guiCommandBuffer.begin() + endIdx);
+    // Called from the pd thread
+    void receiveDrawCommand(t_symbol* sym, int argc, t_atom* argv)
+    {
+        if (sym == startPaintSymbol) {
+            drawLists[backList].clear();
+            isPainting = true;
         }
 
-        if (isSelected != object->isSelected() || !framebuffer.isValid()) {
-            isSelected = object->isSelected();
-            sendRepaintMessage();
+        if (!isPainting) {
+            guiMessageQueue.enqueue({ sym, argc, argv });
+            return;
+        }
+
+        drawLists[backList].add(sym, argc, argv);
+
+        if (sym == endPaintSymbol) {
+            isPainting = false;
+            backList = middleList.exchange(backList | freshFlag, std::memory_order_acq_rel) & 3;
         }
     }
 
     static void drawCallback(void* target, t_symbol* sym, int argc, t_atom* argv)
     {
         for (auto* object : allDrawTargets[static_cast<t_pdlua*>(target)]) {
-            object->guiMessageQueue.enqueue({ sym, argc, argv });
+            object->receiveDrawCommand(sym, argc, argv);
         }
     }
 
@@ -162,7 +162,7 @@ public:
         auto height = getHeight();
 
         auto pixelScale = cnv->getRenderScale();
-        auto zoom = cnv->isZooming ? 2.0f : getValue<float>(cnv->zoomScale);
+        auto zoom = cnv->isZooming ? 2.0f : cnv->zoomScale.get();
 
         auto const flagArea = Point<int>(width * pixelScale * zoom, height * pixelScale * zoom);
 
@@ -240,10 +240,10 @@ public:
 
     void lookAndFeelChanged() override
     {
-        backgroundColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::guiObjectBackgroundColourId));
+        backgroundColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::guiObjectBackgroundColourId);
         selectedColour = cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId);
         selectedOutlineColour = convertColour(selectedColour);
-        outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
+        outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
         flagCol = cnv->editor->getLookAndFeel().findColour(PlugDataColour::guiObjectInternalOutlineColour);
         guiOutlineCol = cnv->editor->getLookAndFeel().findColour(PlugDataColour::outlineColourId);
 
@@ -11,8 +11,8 @@ class MessboxObject final : public ObjectBase
     TextEditor editor;
     BorderSize<int> border = BorderSize<int>(5, 7, 1, 2);
 
-    Value primaryColour = SynchronousValue();
-    Value secondaryColour = SynchronousValue();
+    TypedValue<Colour> primaryColour;
+    TypedValue<Colour> secondaryColour;
     Value fontSize = SynchronousValue();
     Value bold = SynchronousValue();
     Value sizeProperty = SynchronousValue();
@@ -121,7 +121,7 @@ public:
     {
         auto bounds = getLocalBounds();
         // Draw background
-        g.setColour(Colour::fromString(secondaryColour.toString()));
+        g.setColour(secondaryColour.get());
         g.fillRoundedRectangle(bounds.toFloat().reduced(0.5f), Corners::objectCornerRadius);
     }
         
@@ -11,8 +11,8 @@ class NoteObject final : public ObjectBase {
 
     TextEditor noteEditor;
 
-    Value primaryColour = SynchronousValue();
-    Value secondaryColour = SynchronousValue();
+    TypedValue<Colour> primaryColour;
+    TypedValue<Colour> secondaryColour;
     Value font = SynchronousValue();
     Value fontSize = SynchronousValue();
     Value bold = SynchronousValue();
@@ -224,7 +224,7 @@ public:
         if (getValue<bool>(fillBackground)) {
             auto bounds = getLocalBounds();
             // Draw background
-            g.setColour(Colour::fromString(secondaryColour.toString()));
+            g.setColour(secondaryColour.get());
             g.fillRoundedRectangle(bounds.toFloat().reduced(0.5f), Corners::objectCornerRadius);
         }
     }
@@ -7,7 +7,7 @@
 #include "Components/DraggableNumber.h"
 
 class NumboxTildeObject final : public ObjectBase
-    , public Timer {
+    , public FrameScheduler::Poller {
 
     DraggableNumber input;
 
@@ -21,8 +21,9 @@ class NumboxTildeObject final : public ObjectBase
     Value min = SynchronousValue(0.0f);
     Value max = SynchronousValue(0.0f);
 
-    Value primaryColour = SynchronousValue();
-    Value secondaryColour = SynchronousValue();
+    TypedValue<Colour> primaryColour;
+    TypedValue<Colour> secondaryColour;
+    NVGCachedColour secondaryColourCache;
     Value sizeProperty = SynchronousValue();
 
 public:
@@ -53,7 +54,7 @@ public:
             }
         };
 
-        startTimer(nextInterval);
+        cnv->editor->frameScheduler.addPoller(this, nextInterval);
         repaint();
 
         objectParameters.addParamSize(&sizeProperty);
@@ -257,11 +258,11 @@ public:
     void render(NVGcontext* nvg) override
     {
         auto b = getLocalBounds().toFloat();
-        auto backgroundColour = Colour::fromString(secondaryColour.toString());
+        auto backgroundColour = secondaryColourCache.getNVG(secondaryColour);
         bool selected = object->isSelected() && !cnv->isGraph;
-        auto outlineColour = cnv->editor->getLookAndFeel().findColour(selected ? PlugDataColour::objectSelectedOutlineColourId : PlugDataColour::objectOutlineColourId);
+        auto outlineColour = cnv->editor->nvgSurface.getThemeColour(selected ? PlugDataColour::objectSelectedOutlineColourId : PlugDataColour::objectOutlineColourId);
 
-        nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), convertColour(backgroundColour), convertColour(outlineColour), Corners::objectCornerRadius);
+        nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), backgroundColour, outlineColour, Corners::objectCornerRadius);
 
         {
             NVGScopedState scopedState(nvg);
@@ -274,12 +275,17 @@ public:
         auto iconBounds = Rectangle<int>(7, 3, getHeight(), getHeight());
         nvgFontFace(nvg, "icon_font-Regular");
         nvgFontSize(nvg, 12.0f);
-        nvgFillColor(nvg, convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::dataColourId)));
+        nvgFillColor(nvg, cnv->editor->nvgSurface.getThemeColour(PlugDataColour::dataColourId));
         nvgTextAlign(nvg, NVG_ALIGN_TOP | NVG_ALIGN_LEFT);
         nvgText(nvg, iconBounds.getX(), iconBounds.getY(), icon.toRawUTF8(), nullptr);
     }
 
-    void timerCallback() override
+    bool shouldPoll() override
+    {
+        return isOnScreen();
+    }
+
+    void pollFrame() override
     {
         auto val = getValue();
 
@@ -287,7 +293,7 @@ public:
             input.setText(input.formatNumber(val), dontSendNotification);
         }
 
-        startTimer(nextInterval);
+        cnv->editor->frameScheduler.setPollInterval(this, nextInterval);
     }
 
     float getValue()
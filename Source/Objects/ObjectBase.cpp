@@ -6,6 +6,7 @@
 
 #include <juce_gui_basics/juce_gui_basics.h>
 #include <juce_audio_utils/juce_audio_utils.h>
+#include <bitset>
 
 #include "Utility/Config.h"
 #include "Utility/Fonts.h"
@@ -139,6 +140,7 @@ ObjectBase::ObjectBase(pd::WeakReference obj, Object* parent)
     , object(parent)
     , cnv(parent->cnv)
     , pd(parent->cnv->pd)
+    , setSelector(pd->generateSymbol("set"))
     , objectSizeListener(parent)
 {
     // Perform async, so that we don't get a size change callback for initial creation
@@ -155,6 +157,7 @@ ObjectBase::ObjectBase(pd::WeakReference obj, Object* parent)
     auto objectBounds = object->getObjectBounds();
     positionParameter = Array<var> { var(objectBounds.getX()), var(objectBounds.getY()) };
 
+    objectParameters.setOwner(ptr);
     objectParameters.addParamPosition(&positionParameter);
     positionParameter.addListener(&objectSizeListener);
 
@@ -302,6 +305,27 @@ String ObjectBase::getType() const
     return {};
 }
 
+bool ObjectBase::isListenerVisible()
+{
+    // Objects that a graph or plugin mode hides are never shown on this canvas, so they don't need to hear what pd sends them
+    if (cnv->isGraph && !object->isVisible())
+        return false;
+
+    return cnv->isShowing();
+}
+
+bool ObjectBase::isOnScreen()
+{
+    if (!cnv->isShowing())
+        return false;
+
+    if (!cnv->viewport)
+        return cnv->isAreaInView(object->getBounds());
+
+    auto const visibleArea = cnv->getLocalArea(cnv->viewport.get(), cnv->viewport->getLocalBounds());
+    return visibleArea.intersects(object->getBounds());
+}
+
 // Make sure the object can't be triggered if that palette is in drag mode
 bool ObjectBase::hitTest(int x, int y)
 {
@@ -318,6 +342,10 @@ Rectangle<int> ObjectBase::getSelectableBounds()
 // Makes sure that any tabs refering to the now deleted patch will be closed
 void ObjectBase::closeOpenedSubpatchers()
 {
+    // A hibernating canvas only deletes its objects, the subpatches themselves are still there
+    if (cnv->isHibernating())
+        return;
+
     auto* editor = object->editor;
 
     for (auto* canvas : editor->getCanvases()) {
@@ -459,7 +487,25 @@ float ObjectBase::getImageScale()
             topLevel = nextCnv;
         }
     }
-    return topLevel->isZooming ? topLevel->getRenderScale() * 2.0f : topLevel->getRenderScale() * std::max(1.0f, getValue<float>(topLevel->zoomScale));
+    return topLevel->isZooming ? topLevel->getRenderScale() * 2.0f : topLevel->getRenderScale() * std::max(1.0f, topLevel->zoomScale.get());
+}
+
+float ObjectBase::getCachedRenderScale()
+{
+    Canvas* topLevel = cnv;
+    while (auto* nextCnv = topLevel->findParentComponentOfClass<Canvas>()) {
+        topLevel = nextCnv;
+    }
+    return topLevel->isZooming ? 0.0f : topLevel->getRenderScale() * topLevel->zoomScale.get();
+}
+
+void ObjectBase::requestCachedRenderUpdate()
+{
+    Canvas* topLevel = cnv;
+    while (auto* nextCnv = topLevel->findParentComponentOfClass<Canvas>()) {
+        topLevel = nextCnv;
+    }
+    topLevel->requestCachedRenderUpdate(this);
 }
 
 ObjectParameters ObjectBase::getParameters()
@@ -489,6 +535,10 @@ void ObjectBase::stopEdition()
         return;
 
     edited = false;
+
+    // The last value of a drag has to arrive before pd hears that the drag ended
+    sendPendingFloatValue();
+
     if (auto lockedPtr = ptr.get<void>()) {
         pd->sendMessage("gui", "mouse", { 0.f });
     }
@@ -496,13 +546,41 @@ void ObjectBase::stopEdition()
 
 void ObjectBase::sendFloatValue(float newValue)
 {
-    t_atom atom;
-    SETFLOAT(&atom, newValue);
-
-    if (auto obj = ptr.get<t_pd>()) {
-        pd_typedmess(obj.get(), cnv->patch.instance->generateSymbol("set"), 1, &atom);
-        pd_bang(obj.get());
+    if (!coalesceFloatValues) {
+        if (auto obj = ptr.get<t_pd>())
+            deliverFloatValue(obj.get(), setSelector, newValue);
+        return;
     }
+
+    // Only one function is queued at a time, it sends whatever the latest value is by the time the audio thread gets to it
+    pendingFloatValue->value.store(newValue, std::memory_order_relaxed);
+    if (pendingFloatValue->queued.exchange(true, std::memory_order_acq_rel))
+        return;
+
+    pd->enqueueFunctionAtBlockBoundary([pending = pendingFloatValue, ref = ptr, selector = setSelector]() {
+        if (!pending->queued.exchange(false, std::memory_order_acq_rel))
+            return;
+
+        if (auto* obj = ref.getRaw<t_pd>())
+            deliverFloatValue(obj, selector, pending->value.load(std::memory_order_relaxed));
+    });
+}
+
+void ObjectBase::sendPendingFloatValue()
+{
+    if (!pendingFloatValue->queued.exchange(false, std::memory_order_acq_rel))
+        return;
+
+    if (auto obj = ptr.get<t_pd>())
+        deliverFloatValue(obj.get(), setSelector, pendingFloatValue->value.load(std::memory_order_relaxed));
+}
+
+void ObjectBase::deliverFloatValue(t_pd* obj, t_symbol* selector, float value)
+{
+    t_atom atom;
+    SETFLOAT(&atom, value);
+    pd_typedmess(obj, selector, 1, &atom);
+    pd_bang(obj);
 }
 
 ObjectBase* ObjectBase::createGui(pd::WeakReference ptr, Object* parent)
@@ -13,6 +13,7 @@
 #include "Utility/SynchronousValue.h"
 #include "NVGSurface.h"
 #include "Utility/CachedTextRender.h"
+#include "Utility/Fonts.h"
 #include "Object.h"
 #include "Canvas.h"
 
@@ -28,10 +29,8 @@ class Object;
 class ObjectLabel : public Label
     , public NVGComponent {
 
-    hash32 lastTextHash = 0;
-    NVGImage image;
-    float lastScale = 1.0f;
-    bool updateColour = false;
+    CachedTextRender textRenderer;
+    Font lastFont;
     Colour lastColour;
 
 public:
@@ -45,18 +44,22 @@ public:
         setInterceptsMouseClicks(false, false);
     }
 
+    // Drawn from nanovg's glyph atlas, so zooming or changing the text doesn't render a new image for every label
     void renderLabel(NVGcontext* nvg, float scale)
     {
-        auto textHash = hash(getText());
-        if (image.needsUpdate(roundToInt(getWidth() * scale), roundToInt(getHeight() * scale)) || updateColour || lastTextHash != textHash || lastScale != scale) {
-            updateImage(nvg, scale);
-            lastTextHash = textHash;
-            lastScale = scale;
-            updateColour = false;
+        // The default sans-serif font is the current font, resolve it so nanovg can find it
+        auto font = getFont();
+        if (font.getTypefaceName() == Font::getDefaultSansSerifFontName())
+            font = Fonts::getCurrentFont().withHeight(font.getHeight());
+
+        if (font != lastFont) {
+            textRenderer = CachedTextRender();
+            lastFont = font;
         }
 
-        nvgFillPaint(nvg, nvgImagePattern(nvg, 0, 0, getWidth() + 1, getHeight(), 0, image.getImageId(), 1.0f));
-        nvgFillRect(nvg, 0, 0, getWidth() + 1, getHeight());
+        // Labels are a single line, don't let the layout wrap them if it measures a little wider than the label
+        textRenderer.prepareLayout(getText(), font, lastColour, std::numeric_limits<int16>::max(), getWidth());
+        textRenderer.renderText(nvg, getLocalBounds(), scale);
     }
 
     void setColour(Colour const& colour)
@@ -64,15 +67,9 @@ public:
         if (colour != lastColour) {
             Label::setColour(Label::textColourId, colour);
             lastColour = colour;
-            updateColour = true;
         }
     }
 
-    void updateImage(NVGcontext* nvg, float scale)
-    {
-        image.renderJUCEComponent(nvg, *this, scale);
-    }
-
 private:
 };
 
@@ -161,6 +158,25 @@ public:
         setBounds(allBounds);
         // force resize to run, so position updates even when union size doesn't change
         resized();
+
+        if (obj)
+            obj->updateSpatialIndex();
+    }
+
+    // Label and VU scale bounds in canvas coordinates
+    Rectangle<int> getCanvasBounds() const
+    {
+        return labelBounds.getUnion(vuScaleBounds);
+    }
+
+    Rectangle<int> getLabelCanvasBounds() const
+    {
+        return obj ? labelBounds : getCanvasBounds();
+    }
+
+    Rectangle<int> getVUCanvasBounds() const
+    {
+        return vuScaleBounds;
     }
 
     void resized() override
@@ -228,6 +244,15 @@ public:
 
     virtual bool isTransparent() { return false; };
 
+    // Objects on tabs that aren't showing don't need to update their GUI until they're shown again
+    bool isListenerVisible() override;
+
+    // True if the object is inside the visible part of its canvas
+    bool isOnScreen();
+
+    // When zoomed far out, objects are either drawn as a cached thumbnail, or as a plain box if there's nothing to see but text
+    virtual bool showThumbnailWhenZoomedOut() { return true; }
+
     bool hitTest(int x, int y) override;
 
     // Some objects need to show/hide iolets when send/receive symbols are set
@@ -246,6 +271,9 @@ public:
     // Called whenever a drawable changes
     virtual void updateDrawables() { }
 
+    // Called from the top level canvas after a frame, for objects that asked it to refresh an offscreen cache
+    virtual void updateCachedRender(NVGcontext* nvg, float pixelScale, float zoom) { }
+
     // Called after creation, to initialise parameter listeners
     virtual void update() { }
 
@@ -338,11 +366,18 @@ protected:
     void valueChanged(Value& value) override { }
 
     // Send a float value to Pd
+    // Dragging can produce many more values than there are audio blocks, so by default only the latest value gets sent, at the next block
     void sendFloatValue(float value);
 
     // Gets the scale factor we need to use of we want to draw images inside the component
     float getImageScale();
 
+    // The scale updateCachedRender would render at right now, or 0 while zooming, when the render would be outdated right away
+    float getCachedRenderScale();
+
+    // Asks the top level canvas to call updateCachedRender after this frame
+    void requestCachedRenderUpdate();
+
     // Used by various ELSE objects, though sometimes with char*, sometimes with unsigned char*
     template<typename T>
     void colourToHexArray(Colour colour, T* hex)
@@ -383,6 +418,9 @@ public:
     Canvas* cnv;
     PluginProcessor* pd;
 
+    // Resolved once, sendFloatValue gets called for every value change
+    t_symbol* setSelector;
+
     std::unique_ptr<ObjectLabels> labels;
 
 protected:
@@ -394,6 +432,9 @@ protected:
 
     virtual std::unique_ptr<ComponentBoundsConstrainer> createConstrainer();
 
+    // Objects where every value means something, like a radio that triggers a step for every button it passes, should turn this off
+    bool coalesceFloatValues = true;
+
     static inline constexpr int maxSize = 1000000;
     static inline std::atomic<bool> edited = false;
     std::unique_ptr<ComponentBoundsConstrainer> constrainer;
@@ -403,4 +444,16 @@ protected:
 
     friend class IEMHelper;
     friend class AtomHelper;
+
+private:
+    struct PendingFloatValue {
+        std::atomic<float> value = 0.0f;
+        std::atomic<bool> queued = false;
+    };
+
+    static void deliverFloatValue(t_pd* obj, t_symbol* selector, float value);
+    void sendPendingFloatValue();
+
+    // Shared with the queued function, which can run after this object is gone
+    std::shared_ptr<PendingFloatValue> pendingFloatValue = std::make_shared<PendingFloatValue>();
 };
@@ -807,3 +807,25 @@ public:
         }
     }
 };
+
+#if ENABLE_GEM
+// Makes [pix_texture] upload its images through a ring of pixel buffer objects
+// The GPU copies the previous frame while Gem decodes the next one, instead of stalling the render loop on every upload
+class PixTextureObject final : public ImplementationBase {
+    bool configured = false;
+
+public:
+    using ImplementationBase::ImplementationBase;
+
+    void update() override
+    {
+        if (configured)
+            return;
+
+        if (auto texture = ptr.get<t_pd>()) {
+            pd->sendDirectMessage(texture.get(), "pbo", { 2.0f });
+            configured = true;
+        }
+    }
+};
+#endif
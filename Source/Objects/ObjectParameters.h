@@ -4,6 +4,7 @@
 
 #include <utility>
 #include "LookAndFeel.h"
+#include "Pd/WeakReference.h"
 
 enum ParameterType {
     tString,
@@ -35,7 +36,7 @@ class ObjectParameters {
 public:
     ObjectParameters() = default;
 
-    Array<ObjectParameter> getParameters()
+    Array<ObjectParameter> const& getParameters() const
     {
         return objectParameters;
     }
@@ -45,6 +46,17 @@ public:
         objectParameters.add(param);
     }
 
+    // The pd object these parameters belong to, so the inspector can tell whether it's still showing the same object
+    void setOwner(pd::WeakReference const& ownerRef)
+    {
+        owner = ownerRef;
+    }
+
+    std::optional<pd::WeakReference> const& getOwner() const
+    {
+        return owner;
+    }
+
     void resetAll()
     {
         auto& lnf = LookAndFeel::getDefaultLookAndFeel();
@@ -145,6 +157,7 @@ public:
 
 private:
     Array<ObjectParameter> objectParameters;
+    std::optional<pd::WeakReference> owner;
 
     static ObjectParameter makeParam(String const& pString, ParameterType pType, ParameterCategory pCat, Value* pVal, StringArray const& pStringList, var const& pDefault, CustomPanelCreateFn customComponentFn = nullptr, InteractionFn onInteractionFn = nullptr)
     {
@@ -49,25 +49,28 @@ public:
                     return;
                 }
 #endif
-                if (auto pdTilde = ptr.get<t_fake_pd_tilde>()) {
-                    auto pdPath = pdLocation.getFullPathName();
-                    auto schedPath = pdLocation.getChildFile("extra").getChildFile("pd~").getFullPathName();
-
-                    pdTilde->x_pddir = gensym(pdPath.toRawUTF8());
-                    pdTilde->x_schedlibdir = gensym(schedPath.toRawUTF8());
-                    pd->sendDirectMessage(pdTilde.get(), "pd~", { pd->generateSymbol("start") });
-                }
+                startSubprocess();
             },
                 true, true, "", "LastPdLocation", cnv->editor);
         } else {
-            if (auto pdTilde = ptr.get<t_fake_pd_tilde>()) {
-                auto pdPath = pdLocation.getFullPathName();
-                auto schedPath = pdLocation.getChildFile("extra").getChildFile("pd~").getFullPathName();
+            startSubprocess();
+        }
+    }
+
+    void startSubprocess()
+    {
+        if (auto pdTilde = ptr.get<t_fake_pd_tilde>()) {
+            auto pdPath = pdLocation.getFullPathName();
+            auto schedPath = pdLocation.getChildFile("extra").getChildFile("pd~").getFullPathName();
+
+            pdTilde->x_pddir = gensym(pdPath.toRawUTF8());
+            pdTilde->x_schedlibdir = gensym(schedPath.toRawUTF8());
+
+            // Always use the binary encoding, with text encoding every sample gets printed and parsed again on both sides,
+            // which costs more than the subpatch itself at high channel counts
+            pdTilde->x_binary = 1;
 
-                pdTilde->x_pddir = gensym(pdPath.toRawUTF8());
-                pdTilde->x_schedlibdir = gensym(schedPath.toRawUTF8());
-                pd->sendDirectMessage(pdTilde.get(), "pd~", { pd->generateSymbol("start") });
-            }
+            pd->sendDirectMessage(pdTilde.get(), "pd~", { pd->generateSymbol("start") });
         }
     }
 };
@@ -185,7 +185,7 @@ public:
             nvgFontSize(nvg, 20);
             nvgFontFace(nvg, "Inter-Regular");
             nvgTextAlign(nvg, NVG_ALIGN_CENTER | NVG_ALIGN_MIDDLE);
-            nvgFillColor(nvg, convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::canvasTextColourId)));
+            nvgFillColor(nvg, cnv->editor->nvgSurface.getThemeColour(PlugDataColour::canvasTextColourId));
             nvgText(nvg, b.getCentreX(), b.getCentreY(), "?", 0);
         } else {
 
@@ -25,6 +25,8 @@ public:
         : ObjectBase(ptr, object)
         , iemHelper(ptr, object, this)
     {
+        coalesceFloatValues = false;
+
         objectParameters.addParamSize(&sizeProperty, true);
         objectParameters.addParamInt("Options", cGeneral, &max, 8);
         iemHelper.addIemParameters(objectParameters);
@@ -198,14 +200,14 @@ public:
     {
         auto b = getLocalBounds().toFloat();
         bool isSelected = object->isSelected() && !cnv->isGraph;
-        auto selectedOutlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
-        auto outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
+        auto selectedOutlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
+        auto outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
 
-        nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), convertColour(iemHelper.getBackgroundColour()), isSelected ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
+        nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), convertColour(iemHelper.getSecondaryColour()), isSelected ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
 
         float size = (isVertical ? static_cast<float>(getHeight()) / numItems : static_cast<float>(getWidth()) / numItems);
 
-        nvgStrokeColor(nvg, convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::guiObjectInternalOutlineColour)));
+        nvgStrokeColor(nvg, cnv->editor->nvgSurface.getThemeColour(PlugDataColour::guiObjectInternalOutlineColour));
         nvgStrokeWidth(nvg, 1.0f);
 
         for (int i = 1; i < numItems; i++) {
@@ -222,7 +224,7 @@ public:
             }
         }
 
-        auto bgColour = ::getValue<Colour>(iemHelper.secondaryColour);
+        auto bgColour = iemHelper.getSecondaryColour();
 
         if (mouseHover) {
             auto hoverColour = bgColour.contrasting(bgColour.getBrightness() > 0.5f ? 0.03f : 0.05f);
@@ -237,7 +239,7 @@ public:
         float selectionY = isVertical ? selected * size : 0;
         auto selectionBounds = Rectangle<float>(selectionX, selectionY, size, size).reduced(jmin<int>(size * 0.25f, 5));
 
-        nvgFillColor(nvg, convertColour(::getValue<Colour>(iemHelper.primaryColour)));
+        nvgFillColor(nvg, convertColour(iemHelper.getPrimaryColour()));
         nvgFillRoundedRect(nvg, selectionBounds.getX(), selectionBounds.getY(), selectionBounds.getWidth(), selectionBounds.getHeight(), Corners::objectCornerRadius / 2.0f);
     }
 
@@ -140,8 +140,25 @@ public:
     }
 };
 
+// Pd sends a redraw to every drawing instruction of a scalar when any of its fields change, and to every scalar of a template
+// when the template changes. Most of those don't change the geometry, so the path is only replaced, and repainted, when it actually changed.
+// The nanovg commands for it are kept, so drawing it every frame doesn't have to walk the JUCE path
+class DrawableScalarPath : public DrawablePath {
+public:
+    void updatePath(Path const& path)
+    {
+        if (path == getPath())
+            return;
+
+        setPath(path);
+        cachedPath.set(path);
+    }
+
+    NVGCachedPath cachedPath;
+};
+
 class DrawableCurve final : public DrawableTemplate
-    , public DrawablePath {
+    , public DrawableScalarPath {
 
     t_fake_curve* object;
     GlobalMouseListener globalMouseListener;
@@ -217,10 +234,8 @@ public:
 
     void render(NVGcontext* nvg) override
     {
-        Path p = getPath();
-        setJUCEPath(nvg, p);
+        cachedPath.apply(nvg);
 
-        // TODO: could be more optimised
         if (closed) {
             nvgClosePath(nvg);
 
@@ -255,7 +270,7 @@ public:
         }
 
         if (!fielddesc_getfloat(&x->x_vis, templ, data, 0)) {
-            setPath(Path());
+            updatePath(Path());
             return;
         }
 
@@ -342,7 +357,7 @@ public:
                 setFill(getStrokeFill());
             }
 
-            setPath(toDraw);
+            updatePath(toDraw);
         } else {
             post("warning: curves need at least two points to be graphed");
         }
@@ -373,7 +388,7 @@ public:
 
     void render(NVGcontext* nvg) override
     {
-        auto scale = canvas->isZooming ? canvas->getRenderScale() * 2.0f : canvas->getRenderScale() * std::max(1.0f, getValue<float>(canvas->zoomScale));
+        auto scale = canvas->isZooming ? canvas->getRenderScale() * 2.0f : canvas->getRenderScale() * std::max(1.0f, canvas->zoomScale.get());
         auto bounds = getBoundingBox().getBoundingBox().toNearestInt();
         NVGScopedState scopedState(nvg);
         nvgTranslate(nvg, bounds.getX(), bounds.getY());
@@ -487,7 +502,7 @@ public:
 };
 
 class DrawablePlot final : public DrawableTemplate
-    , public DrawablePath {
+    , public DrawableScalarPath {
 
     t_fake_curve* object;
     GlobalMouseListener globalMouseListener;
@@ -570,8 +585,7 @@ public:
 
     void render(NVGcontext* nvg) override
     {
-        Path p = getPath();
-        setJUCEPath(nvg, p);
+        cachedPath.apply(nvg);
 
         nvgFillColor(nvg, convertColour(getFill().colour));
         nvgFill(nvg);
@@ -647,7 +661,7 @@ public:
         t_fake_fielddesc *xfielddesc, *yfielddesc, *wfielddesc;
 
         if (!fielddesc_getfloat(&x->x_vis, templ, data, 0)) {
-            setPath(Path());
+            updatePath(Path());
             return;
         }
 
@@ -842,6 +856,27 @@ public:
                 // no "w" field.  If the linewidth is positive, draw a
                 // segmented line with the requested width; otherwise don't
                 // draw the trace at all.
+
+                // Pd only draws the first point of every pixel column, which loses the peaks of dense arrays
+                // We also keep the lowest and highest point of each column, like arrays do
+                int const maxPoints = static_cast<int>(sizeof(coordinates) / sizeof(*coordinates)) / 2;
+                t_float columnFirst = 0, columnLow = 0, columnHigh = 0;
+                auto flushColumn = [&]() {
+                    if (ndrawn == 0 || xonset >= 0)
+                        return;
+
+                    if (columnLow != columnFirst && ndrawn < maxPoints) {
+                        coordinates[ndrawn * 2 + 0] = lastpixel;
+                        coordinates[ndrawn * 2 + 1] = columnLow;
+                        ndrawn++;
+                    }
+                    if (columnHigh != columnFirst && columnHigh != columnLow && ndrawn < maxPoints) {
+                        coordinates[ndrawn * 2 + 0] = lastpixel;
+                        coordinates[ndrawn * 2 + 1] = columnHigh;
+                        ndrawn++;
+                    }
+                };
+
                 for (i = 0, xsum = xloc; i < nelem; i++) {
                     t_float usexloc;
                     if (xonset >= 0)
@@ -856,15 +891,25 @@ public:
 
                     xpix = xToPixels(baseX + fielddesc_cvttocoord((t_fielddesc*)xfielddesc, usexloc));
                     ixpix = xpix + 0.5;
+                    auto const ypix = yToPixels(baseY + yloc + fielddesc_cvttocoord((t_fielddesc*)yfielddesc, yval));
                     if (xonset >= 0 || ixpix != lastpixel) {
+                        flushColumn();
+                        if (ndrawn >= maxPoints)
+                            break;
+
                         coordinates[ndrawn * 2 + 0] = ixpix;
-                        coordinates[ndrawn * 2 + 1] = yToPixels(baseY + yloc + fielddesc_cvttocoord((t_fielddesc*)yfielddesc, yval));
+                        coordinates[ndrawn * 2 + 1] = ypix;
                         ndrawn++;
+                        columnFirst = columnLow = columnHigh = ypix;
+                    } else {
+                        columnLow = std::min(columnLow, ypix);
+                        columnHigh = std::max(columnHigh, ypix);
                     }
                     lastpixel = ixpix;
-                    if (ndrawn * 2 >= sizeof(coordinates) / sizeof(*coordinates))
+                    if (ndrawn >= maxPoints)
                         break;
                 }
+                flushColumn();
 
                 // TK will complain if there aren't at least 2 points...
                 //   Don't know about JUCE though...
@@ -917,7 +962,7 @@ public:
             }
         }
 
-        setPath(toDraw);
+        updatePath(toDraw);
         updateSubplots();
     }
 
@@ -5,25 +5,28 @@
  */
 
 class ScopeObject final : public ObjectBase
-    , public Timer {
+    , public FrameScheduler::Poller {
 
     std::vector<float> x_buffer;
     std::vector<float> y_buffer;
 
-    Value gridColour = SynchronousValue();
+    TypedValue<Colour> gridColour;
     Value triggerMode = SynchronousValue();
     Value triggerValue = SynchronousValue();
     Value samplesPerPoint = SynchronousValue();
     Value bufferSize = SynchronousValue();
     Value delay = SynchronousValue();
     Value signalRange = SynchronousValue();
-    Value primaryColour = SynchronousValue();
-    Value secondaryColour = SynchronousValue();
+    TypedValue<Colour> primaryColour;
+    TypedValue<Colour> secondaryColour;
+    NVGCachedColour primaryColourCache, secondaryColourCache, gridColourCache;
     Value receiveSymbol = SynchronousValue();
     Value sizeProperty = SynchronousValue();
 
     bool freezeScope = false;
 
+    pd::SignalTapBus::Tap* signalTap;
+
 public:
     ScopeObject(pd::WeakReference ptr, Object* object)
         : ObjectBase(ptr, object)
@@ -42,7 +45,32 @@ public:
 
         objectParameters.addParamReceiveSymbol(&receiveSymbol);
 
-        startTimerHz(25);
+        cnv->editor->frameScheduler.addPoller(this, 40);
+
+        // Copying the scope buffer once every 16 blocks is enough for a 40ms refresh rate
+        signalTap = pd->signalTaps->subscribe(ptr.getRawUnchecked<void>(), readScope, SCOPE_MAXBUFSIZE * 4, 16);
+    }
+
+    ~ScopeObject() override
+    {
+        pd->signalTaps->unsubscribe(signalTap);
+    }
+
+    // Called from the audio thread, copies the last complete sweep of the scope
+    static bool readScope(void* object, pd::SignalTapBus::Snapshot& snapshot)
+    {
+        auto* scope = static_cast<t_fake_scope*>(object);
+        auto const bufsize = std::clamp(scope->x_bufsize, 0, snapshot.capacity);
+
+        std::copy_n(scope->x_xbuflast, bufsize, snapshot.getChannel(0));
+        std::copy_n(scope->x_ybuflast, bufsize, snapshot.getChannel(1));
+        snapshot.numChannels = 2;
+        snapshot.numSamples = bufsize;
+
+        snapshot.values[0] = scope->x_min;
+        snapshot.values[1] = scope->x_max;
+        snapshot.values[2] = scope->x_xymode;
+        return true;
     }
 
     void updateSizeProperty() override
@@ -116,18 +144,18 @@ public:
 
     void render(NVGcontext* nvg) override
     {
-        auto selectedOutlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
-        auto outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
+        auto selectedOutlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
+        auto outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
 
         auto b = getLocalBounds().toFloat();
 
-        nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), convertColour(Colour::fromString(secondaryColour.toString())), object->isSelected() ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
+        nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), secondaryColourCache.getNVG(secondaryColour), object->isSelected() ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
 
         auto dx = getWidth() * 0.125f;
         auto dy = getHeight() * 0.25f;
 
         nvgBeginPath(nvg);
-        nvgStrokeColor(nvg, convertColour(Colour::fromString(gridColour.toString())));
+        nvgStrokeColor(nvg, gridColourCache.getNVG(gridColour));
         nvgStrokeWidth(nvg, 1.0f);
         auto xx = dx;
         for (int i = 0; i < 7; i++) {
@@ -146,48 +174,47 @@ public:
 
         NVGScopedState scopedState(nvg);
         nvgIntersectScissor(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight());
-        if (!(y_buffer.empty() || x_buffer.empty())) {
-            nvgBeginPath(nvg);
-            nvgStrokeColor(nvg, convertColour(Colour::fromString(primaryColour.toString())));
+        if (y_buffer.size() > 1 && x_buffer.size() == y_buffer.size()) {
+            nvgStrokeColor(nvg, primaryColourCache.getNVG(primaryColour));
             nvgStrokeWidth(nvg, 2.0f);
             nvgLineJoin(nvg, NVG_ROUND);
             nvgLineCap(nvg, NVG_ROUND);
 
-            nvgMoveTo(nvg, x_buffer[1], y_buffer[1]);
-
-            for (size_t i = 2; i < y_buffer.size(); i++) {
-                nvgLineTo(nvg, x_buffer[i], y_buffer[i]);
-            }
+            setPolylinePath(nvg, x_buffer.data() + 1, y_buffer.data() + 1, static_cast<int>(y_buffer.size()) - 1);
             nvgStroke(nvg);
         }
     }
 
-    void timerCallback() override
+    bool shouldPoll() override
+    {
+        return isOnScreen();
+    }
+
+    void pollFrame() override
     {
         if (freezeScope)
             return;
 
-        int bufsize = 0, mode = 0;
-        float min = 0.0f, max = 1.0f;
-
         if (object->iolets.size() == 3)
             object->iolets[2]->setVisible(false);
 
-        if (auto scope = ptr.get<t_fake_scope>()) {
-            bufsize = scope->x_bufsize;
-            min = scope->x_min;
-            max = scope->x_max;
-            mode = scope->x_xymode;
-
-            if (x_buffer.size() != bufsize) {
-                x_buffer.resize(bufsize);
-                y_buffer.resize(bufsize);
-            }
+        auto const* snapshot = signalTap->getNewSnapshot();
+        if (!snapshot)
+            return;
 
-            std::copy(scope->x_xbuflast, scope->x_xbuflast + bufsize, x_buffer.data());
-            std::copy(scope->x_ybuflast, scope->x_ybuflast + bufsize, y_buffer.data());
+        int bufsize = snapshot->numSamples;
+        float min = snapshot->values[0];
+        float max = snapshot->values[1];
+        int mode = static_cast<int>(snapshot->values[2]);
+
+        if (x_buffer.size() != bufsize) {
+            x_buffer.resize(bufsize);
+            y_buffer.resize(bufsize);
         }
 
+        std::copy_n(snapshot->getChannel(0), bufsize, x_buffer.data());
+        std::copy_n(snapshot->getChannel(1), bufsize, y_buffer.data());
+
         if (min > max) {
             auto temp = max;
             max = min;
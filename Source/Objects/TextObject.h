@@ -184,6 +184,8 @@ public:
 
     ~TextBase() override = default;
 
+    bool showThumbnailWhenZoomedOut() override { return false; }
+
     void update() override
     {
         if (auto obj = ptr.get<t_text>()) {
@@ -194,8 +196,8 @@ public:
     void lookAndFeelChanged() override
     {
         backgroundColour = cnv->editor->getLookAndFeel().findColour(PlugDataColour::textObjectBackgroundColourId);
-        selectedOutlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
-        outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
+        selectedOutlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
+        outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
         ioletAreaColour = convertColour(object->findColour(PlugDataColour::ioletAreaColourId));
 
         updateTextLayout();
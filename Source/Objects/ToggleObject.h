@@ -71,13 +71,14 @@ public:
     {
         auto b = getLocalBounds().toFloat();
 
-        auto bgColour = ::getValue<Colour>(iemHelper.secondaryColour);
+        auto bgColour = iemHelper.getSecondaryColour();
+        auto fgColour = iemHelper.getPrimaryColour();
 
         auto backgroundColour = convertColour(bgColour);
-        auto toggledColour = convertColour(::getValue<Colour>(iemHelper.primaryColour)); // TODO: don't access audio thread variables in render loop
-        auto untoggledColour = convertColour(::getValue<Colour>(iemHelper.primaryColour).interpolatedWith(::getValue<Colour>(iemHelper.secondaryColour), 0.8f));
-        auto selectedOutlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
-        auto outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
+        auto toggledColour = convertColour(fgColour);
+        auto untoggledColour = convertColour(fgColour.interpolatedWith(bgColour, 0.8f));
+        auto selectedOutlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
+        auto outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
 
         nvgDrawRoundedRect(nvg, b.getX(), b.getY(), b.getWidth(), b.getHeight(), backgroundColour, object->isSelected() ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
 
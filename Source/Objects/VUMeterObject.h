@@ -9,6 +9,7 @@ class VUMeterObject final : public ObjectBase {
     IEMHelper iemHelper;
     Value sizeProperty = SynchronousValue();
     Value showScale = SynchronousValue();
+    NVGResourceCache::Handle<NVGFramebuffer> chrome;
 
 public:
     VUMeterObject(pd::WeakReference ptr, Object* object)
@@ -113,55 +114,117 @@ public:
         iemHelper.setPdBounds(b);
     }
 
-    void render(NVGcontext* nvg) override
+    struct Geometry {
+        float outerBorderWidth = 2.0f;
+        int totalBlocks = 30;
+        float blockHeight, blockWidth;
+        float blockRectHeight, blockRectSpacing;
+        float blockCornerSize;
+    };
+
+    Geometry getGeometry() const
     {
-        if(!ptr.isValid()) return;
-        
-        auto values = std::vector<float> { ptr.get<t_vu>()->x_fp, ptr.get<t_vu>()->x_fr };
-        auto backgroundColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::guiObjectBackgroundColourId));
-        auto selectedOutlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectSelectedOutlineColourId));
-        auto outlineColour = convertColour(cnv->editor->getLookAndFeel().findColour(PlugDataColour::objectOutlineColourId));
+        Geometry g;
+        auto spacingFraction = 0.05f;
+        auto doubleOuterBorderWidth = 2.0f * g.outerBorderWidth;
+
+        g.blockHeight = (getHeight() - doubleOuterBorderWidth) / static_cast<float>(g.totalBlocks);
+        g.blockWidth = getWidth() - doubleOuterBorderWidth;
+        g.blockRectHeight = (1.0f - 2.0f * spacingFraction) * g.blockHeight;
+        g.blockRectSpacing = spacingFraction * g.blockHeight;
+        g.blockCornerSize = 0.1f * g.blockHeight;
+        return g;
+    }
+
+    // Draws the meter at x, with numBlocks blocks lit
+    void renderMeter(NVGcontext* nvg, float x, int numBlocks)
+    {
+        auto backgroundColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::guiObjectBackgroundColourId);
+        auto selectedOutlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectSelectedOutlineColourId);
+        auto outlineColour = cnv->editor->nvgSurface.getThemeColour(PlugDataColour::objectOutlineColourId);
+        auto const g = getGeometry();
 
         int height = getHeight();
         int width = getWidth();
 
-        nvgDrawRoundedRect(nvg, 0, 0, width, height, backgroundColour, object->isSelected() ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
-
-        auto outerBorderWidth = 2.0f;
-        auto totalBlocks = 30;
-        auto spacingFraction = 0.05f;
-        auto doubleOuterBorderWidth = 2.0f * outerBorderWidth;
-
-        auto blockHeight = (height - doubleOuterBorderWidth) / static_cast<float>(totalBlocks);
-        auto blockWidth = width - doubleOuterBorderWidth;
-        auto blockRectHeight = (1.0f - 2.0f * spacingFraction) * blockHeight;
-        auto blockRectSpacing = spacingFraction * blockHeight;
-        auto blockCornerSize = 0.1f * blockHeight;
-
-        float rms = Decibels::decibelsToGain(values[1] - 12.0f);
-        float lvl = (float)std::exp(std::log(rms) / 3.0) * (rms > 0.002);
-        auto numBlocks = roundToInt(totalBlocks * lvl);
+        nvgDrawRoundedRect(nvg, x, 0, width, height, backgroundColour, object->isSelected() ? selectedOutlineColour : outlineColour, Corners::objectCornerRadius);
 
         auto verticalGradient1 = nvgLinearGradient(nvg, 0, getHeight() * 0.25f, 0, getHeight() * 0.5f, nvgRGBAf(1, 0.5f, 0, 1), nvgRGBAf(0.26f, 0.64f, 0.78f, 1.0f));
         auto verticalGradient2 = nvgLinearGradient(nvg, 0, 0, 0, getHeight() * 0.25f, nvgRGBAf(1, 0, 0, 1), nvgRGBAf(1, 0.5f, 0, 1));
 
-        for (auto i = 1; i < totalBlocks; ++i) {
+        for (auto i = 1; i < g.totalBlocks; ++i) {
             NVGpaint gradient;
             if (i >= numBlocks) {
                 nvgFillColor(nvg, nvgRGBAf(0.3f, 0.3f, 0.3f, 1.0f)); // Dark grey for inactive blocks
             } else {
-                gradient = (i < totalBlocks * 0.75f) ? verticalGradient1 : verticalGradient2;
+                gradient = (i < g.totalBlocks * 0.75f) ? verticalGradient1 : verticalGradient2;
                 nvgFillPaint(nvg, gradient);
             }
-            nvgFillRoundedRect(nvg, outerBorderWidth, outerBorderWidth + ((totalBlocks - i) * blockHeight) + blockRectSpacing, blockWidth, blockRectHeight, blockCornerSize);
+            nvgFillRoundedRect(nvg, x + g.outerBorderWidth, g.outerBorderWidth + ((g.totalBlocks - i) * g.blockHeight) + g.blockRectSpacing, g.blockWidth, g.blockRectHeight, g.blockCornerSize);
+        }
+    }
+
+    // The framebuffer holds the meter with no blocks lit, and next to it the meter with all blocks lit
+    NVGResourceCache::Key getChromeKey(float scale)
+    {
+        auto const variant = NVGResourceCache::getVariant({ object->isSelected(), cnv->editor->nvgSurface.getThemeColours().getVersion() });
+        return { NVGResourceCache::VUMeterChrome, roundToInt(getWidth() * 2 * scale), roundToInt(getHeight() * scale), variant };
+    }
+
+    void updateCachedRender(NVGcontext* nvg, float pixelScale, float zoom) override
+    {
+        if (getWidth() <= 0 || getHeight() <= 0)
+            return;
+
+        auto const key = getChromeKey(pixelScale * zoom);
+        cnv->editor->nvgSurface.getResourceCache().updateFramebuffer(nvg, chrome, key, [this, &key, pixelScale, zoom](NVGcontext* nvg) {
+            nvgViewport(0, 0, key.width, key.height);
+            nvgClear(nvg);
+            nvgBeginFrame(nvg, getWidth() * 2 * zoom, getHeight() * zoom, pixelScale);
+            nvgScale(nvg, zoom, zoom);
+            renderMeter(nvg, 0, 0);
+            renderMeter(nvg, getWidth(), getGeometry().totalBlocks);
+            nvgEndFrame(nvg);
+        });
+    }
+
+    void render(NVGcontext* nvg) override
+    {
+        if(!ptr.isValid()) return;
+        
+        auto values = std::vector<float> { ptr.get<t_vu>()->x_fp, ptr.get<t_vu>()->x_fr };
+        auto const g = getGeometry();
+
+        int height = getHeight();
+        int width = getWidth();
+
+        float rms = Decibels::decibelsToGain(values[1] - 12.0f);
+        float lvl = (float)std::exp(std::log(rms) / 3.0) * (rms > 0.002);
+        auto numBlocks = roundToInt(g.totalBlocks * lvl);
+
+        // Draw the unlit meter, and the lit blocks below the level from the lit meter next to it
+        auto const scale = getCachedRenderScale();
+        if (scale > 0.0f && chrome.matches(getChromeKey(scale))) {
+            nvgFillPaint(nvg, nvgImagePattern(nvg, 0, 0, width * 2, height, 0, chrome.getImage(), 1));
+            nvgFillRect(nvg, 0, 0, width, height);
+
+            if (numBlocks > 1) {
+                auto const litTop = g.outerBorderWidth + (g.totalBlocks - numBlocks + 1) * g.blockHeight;
+                nvgFillPaint(nvg, nvgImagePattern(nvg, -width, 0, width * 2, height, 0, chrome.getImage(), 1));
+                nvgFillRect(nvg, 0, litTop, width, height - litTop);
+            }
+        } else {
+            renderMeter(nvg, 0, numBlocks);
+            if (scale > 0.0f)
+                requestCachedRenderUpdate();
         }
 
         float peak = Decibels::decibelsToGain(values[0] - 12.0f);
         float lvl2 = (float)std::exp(std::log(peak) / 3.0) * (peak > 0.002);
-        auto numBlocks2 = roundToInt(totalBlocks * lvl2);
+        auto numBlocks2 = roundToInt(g.totalBlocks * lvl2);
 
         nvgFillColor(nvg, nvgRGBAf(1, 1, 1, 1)); // White for the peak block
-        nvgFillRoundedRect(nvg, outerBorderWidth, outerBorderWidth + ((totalBlocks - numBlocks2) * blockHeight) + blockRectSpacing, blockWidth, blockRectHeight / 2.0f, blockCornerSize);
+        nvgFillRoundedRect(nvg, g.outerBorderWidth, g.outerBorderWidth + ((g.totalBlocks - numBlocks2) * g.blockHeight) + g.blockRectSpacing, g.blockWidth, g.blockRectHeight / 2.0f, g.blockCornerSize);
     }
 
     void receiveObjectMessage(hash32 symbol, pd::Atom const atoms[8], int numAtoms) override
@@ -0,0 +1,202 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+extern "C" {
+#include <m_pd.h>
+#include <m_imp.h>
+}
+
+#include "ArrayDirtyRanges.h"
+
+namespace pd {
+
+// Open addressing on the address of the sample vector, so marking a range never allocates or locks
+// Removed entries leave a marker behind, so arrays that were added after them can still be found. New arrays can take their place
+// Arrays are only looked for in the first few entries from where they hash to. If those are taken, the array isn't tracked,
+// and only updates when pd redraws it
+static constexpr int maxArrays = 4096;
+static constexpr int maxProbes = 16;
+
+struct DirtyRangeEntry {
+    std::atomic<void const*> array = nullptr;
+    std::atomic<uint64_t> range = 0; // Start in the upper half, end in the lower half, 0 when clean
+};
+
+static DirtyRangeEntry dirtyRanges[maxArrays];
+
+// Marks an entry that was removed, no vector can live at this address
+static void const* const removedEntry = &dirtyRanges;
+
+static int getFirstIndex(void const* arrayVector)
+{
+    return static_cast<int>((reinterpret_cast<uintptr_t>(arrayVector) >> 4) % maxArrays);
+}
+
+static DirtyRangeEntry* findDirtyRangeEntry(void const* arrayVector)
+{
+    auto index = getFirstIndex(arrayVector);
+    for (int probe = 0; probe < maxProbes; probe++) {
+        auto& entry = dirtyRanges[index];
+        auto const existing = entry.array.load(std::memory_order_acquire);
+        if (existing == arrayVector)
+            return &entry;
+        if (existing == nullptr)
+            return nullptr;
+
+        index = (index + 1) % maxArrays;
+    }
+
+    return nullptr;
+}
+
+static DirtyRangeEntry* insertDirtyRangeEntry(void const* arrayVector)
+{
+    if (auto* entry = findDirtyRangeEntry(arrayVector))
+        return entry;
+
+    auto index = getFirstIndex(arrayVector);
+    for (int probe = 0; probe < maxProbes; probe++) {
+        auto& entry = dirtyRanges[index];
+        auto existing = entry.array.load(std::memory_order_acquire);
+        if (existing == arrayVector)
+            return &entry;
+
+        if (existing == nullptr || existing == removedEntry) {
+            if (entry.array.compare_exchange_strong(existing, arrayVector, std::memory_order_acq_rel) || existing == arrayVector)
+                return &entry;
+        }
+
+        index = (index + 1) % maxArrays;
+    }
+
+    return nullptr;
+}
+
+void ArrayDirtyRanges::markDirty(void const* arrayVector, int start, int end)
+{
+    if (!arrayVector || end <= start || start < 0)
+        return;
+
+    auto* entry = insertDirtyRangeEntry(arrayVector);
+    if (!entry)
+        return;
+
+    auto current = entry->range.load(std::memory_order_relaxed);
+    uint64_t merged;
+    do {
+        auto newStart = static_cast<uint32_t>(start);
+        auto newEnd = static_cast<uint32_t>(end);
+        if (current != 0) {
+            newStart = std::min(newStart, static_cast<uint32_t>(current >> 32));
+            newEnd = std::max(newEnd, static_cast<uint32_t>(current));
+        }
+        merged = (static_cast<uint64_t>(newStart) << 32) | newEnd;
+    } while (merged != current && !entry->range.compare_exchange_weak(current, merged, std::memory_order_release, std::memory_order_relaxed));
+}
+
+bool ArrayDirtyRanges::takeDirtyRange(void const* arrayVector, int& start, int& end)
+{
+    auto* entry = findDirtyRangeEntry(arrayVector);
+    if (!entry)
+        return false;
+
+    auto const range = entry->range.exchange(0, std::memory_order_acquire);
+    if (range == 0)
+        return false;
+
+    start = static_cast<int>(range >> 32);
+    end = static_cast<int>(static_cast<uint32_t>(range));
+    return true;
+}
+
+bool ArrayDirtyRanges::isDirty(void const* arrayVector)
+{
+    auto const* entry = arrayVector ? findDirtyRangeEntry(arrayVector) : nullptr;
+    return entry && entry->range.load(std::memory_order_relaxed) != 0;
+}
+
+void ArrayDirtyRanges::forget(void const* arrayVector)
+{
+    if (!arrayVector)
+        return;
+
+    if (auto* entry = findDirtyRangeEntry(arrayVector)) {
+        entry->range.store(0, std::memory_order_relaxed);
+        entry->array.store(removedEntry, std::memory_order_release);
+    }
+}
+
+// Same layout as tabwrite~ in d_array.c
+typedef struct _fake_tabwrite_tilde {
+    t_object x_obj;
+    int x_phase;
+    int x_nsampsintab;
+    t_word* x_vec;
+    t_symbol* x_arrayname;
+    t_float x_f;
+} t_fake_tabwrite_tilde;
+
+using DSPMethod = void (*)(t_object*, t_signal**);
+static DSPMethod originalTabwriteDSP = nullptr;
+
+// Where tabwrite~ was before its perform routine ran, per DSP thread
+static thread_local int tabwritePhaseBeforeBlock = 0;
+
+static t_int* tabwrite_dirty_before_perform(t_int* w)
+{
+    auto* x = reinterpret_cast<t_fake_tabwrite_tilde*>(w[1]);
+    tabwritePhaseBeforeBlock = x->x_phase;
+    return w + 2;
+}
+
+static t_int* tabwrite_dirty_after_perform(t_int* w)
+{
+    auto* x = reinterpret_cast<t_fake_tabwrite_tilde*>(w[1]);
+    auto const n = static_cast<int>(w[2]);
+    auto const start = tabwritePhaseBeforeBlock;
+
+    if (x->x_vec && start < x->x_nsampsintab)
+        ArrayDirtyRanges::markDirty(x->x_vec, start, std::min(start + n, x->x_nsampsintab));
+
+    return w + 3;
+}
+
+static void tabwrite_dirty_dsp(t_object* x, t_signal** sp)
+{
+    // tabwrite~ looks its array up again here, so a resized or deleted array shows up as a different vector
+    auto const* previousVector = reinterpret_cast<t_fake_tabwrite_tilde*>(x)->x_vec;
+
+    dsp_add(tabwrite_dirty_before_perform, 1, x);
+    originalTabwriteDSP(x, sp);
+    dsp_add(tabwrite_dirty_after_perform, 2, x, static_cast<t_int>(sp[0]->s_n));
+
+    if (previousVector != reinterpret_cast<t_fake_tabwrite_tilde*>(x)->x_vec)
+        ArrayDirtyRanges::forget(previousVector);
+}
+
+void ArrayDirtyRanges::setup()
+{
+    // tabwrite~'s class isn't exported, so we make one to find it
+    pd_this->pd_newest = nullptr;
+    pd_typedmess(&pd_objectmaker, gensym("tabwrite~"), 0, nullptr);
+
+    auto* tabwrite = pd_newest();
+    if (!tabwrite)
+        return;
+
+    auto* tabwriteClass = pd_class(tabwrite);
+    originalTabwriteDSP = reinterpret_cast<DSPMethod>(zgetfn(tabwrite, gensym("dsp")));
+    pd_free(tabwrite);
+
+    if (originalTabwriteDSP)
+        class_addmethod(tabwriteClass, reinterpret_cast<t_method>(tabwrite_dirty_dsp), gensym("dsp"), A_CANT, 0);
+}
+
+}
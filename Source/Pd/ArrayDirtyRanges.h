@@ -0,0 +1,32 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+namespace pd {
+
+// The parts of arrays that were written by DSP since the GUI last looked, so array graphs only read back what changed
+// Writers on the audio thread merge their range into the array's entry without locking, the message thread takes it out
+// Arrays are identified by their sample vector, which changes when the array is resized. Then, the GUI reads all of it anyway,
+// and the entry of the old vector is removed
+// [tabwrite~] publishes what it writes every block. Other writers, like [soundfiler] or [array set], still make pd redraw the array
+struct ArrayDirtyRanges {
+    static void setup();
+
+    // Can be called from any thread
+    static void markDirty(void const* arrayVector, int start, int end);
+
+    // Gets the range written since the last call, returns false if nothing was written
+    static bool takeDirtyRange(void const* arrayVector, int& start, int& end);
+
+    // Doesn't take the range, so it can be checked without locking pd first
+    static bool isDirty(void const* arrayVector);
+
+    // Call when a vector was freed or replaced, so its entry can be used by another array
+    static void forget(void const* arrayVector);
+};
+
+}
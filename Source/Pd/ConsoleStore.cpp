@@ -0,0 +1,93 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "Utility/Config.h"
+#include "Utility/Hash.h"
+#include "Utility/CachedStringWidth.h"
+
+#include "ConsoleStore.h"
+
+namespace pd {
+
+void ConsoleStore::add(void* object, String const& message, int type)
+{
+    if (end > start) {
+        auto& last = ring[(end - 1) % capacity];
+        if (last.object == object && last.type == type && messages[last.message].text == message) {
+            last.repeats++;
+            return;
+        }
+    }
+
+    // Drop the oldest entry when the ring is full
+    if (end - start == capacity) {
+        release(ring[start % capacity].message);
+        start++;
+    }
+
+    auto const entry = Entry { object, intern(message), 1, type };
+
+    // The ring only grows up to its capacity, so an instance that barely prints doesn't hold on to a lot of memory
+    if (ring.size() < capacity)
+        ring.push_back(entry);
+    else
+        ring[end % capacity] = entry;
+
+    end++;
+}
+
+void ConsoleStore::addRepeats(int numRepeats)
+{
+    if (end > start)
+        ring[(end - 1) % capacity].repeats += numRepeats;
+}
+
+void ConsoleStore::clear()
+{
+    for (auto sequence = start; sequence < end; sequence++) {
+        release(ring[sequence % capacity].message);
+    }
+
+    start = end;
+}
+
+uint32 ConsoleStore::intern(String const& message)
+{
+    if (auto it = messageIds.find(message); it != messageIds.end()) {
+        messages[it->second].refCount++;
+        return it->second;
+    }
+
+    // Measuring the text would load fonts, which a headless instance never needs
+    auto const length = ProjectInfo::isHeadless ? 0 : CachedStringWidth<14>::calculateStringWidth(message) + 40;
+
+    uint32 id;
+    if (!freeMessages.empty()) {
+        id = freeMessages.back();
+        freeMessages.pop_back();
+        messages[id] = { message, length, 1 };
+    } else {
+        id = static_cast<uint32>(messages.size());
+        messages.push_back({ message, length, 1 });
+    }
+
+    messageIds[message] = id;
+    return id;
+}
+
+void ConsoleStore::release(uint32 id)
+{
+    auto& message = messages[id];
+    if (--message.refCount > 0)
+        return;
+
+    messageIds.erase(message.text);
+    message.text = String();
+    freeMessages.push_back(id);
+}
+
+}
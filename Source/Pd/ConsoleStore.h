@@ -0,0 +1,73 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+namespace pd {
+
+// The console output of an instance, only used on the message thread
+// Entries go in a ring that keeps the last 100k of them, and every entry is addressed by a sequence number that keeps counting up,
+// so the console can tell which entries it has already seen after older ones got dropped
+// Messages are interned: a line that gets printed many times is stored and measured only once
+class ConsoleStore {
+public:
+    struct Entry {
+        void* object;
+        uint32 message;
+        int repeats;
+        int type;
+    };
+
+    static constexpr int capacity = 100000;
+
+    // Adds a line, or counts it as a repeat if it's the same as the last one
+    void add(void* object, String const& message, int type);
+
+    // Counts repeats of the last entry that were already merged before they got here
+    void addRepeats(int numRepeats);
+
+    // Forgets all entries
+    void clear();
+
+    // Clearing the console only hides what's there, so it can be restored later
+    void hideAll() { hiddenBefore = end; }
+    void restore() { hiddenBefore = 0; }
+
+    // Sequence numbers of the first entry to show, and one past the last entry
+    int64 getFirstShown() const { return std::max(start, hiddenBefore); }
+    int64 getEnd() const { return end; }
+
+    bool contains(int64 sequence) const { return sequence >= start && sequence < end; }
+
+    // The sequence number must be between getFirstShown and getEnd
+    Entry const& get(int64 sequence) const { return ring[sequence % capacity]; }
+
+    String const& getMessage(Entry const& entry) const { return messages[entry.message].text; }
+
+    // Width of the message in pixels, measured when it was first added
+    int getLength(Entry const& entry) const { return messages[entry.message].length; }
+
+private:
+    uint32 intern(String const& message);
+    void release(uint32 message);
+
+    struct Message {
+        String text;
+        int length;
+        int refCount;
+    };
+
+    std::vector<Entry> ring;
+    int64 start = 0;
+    int64 end = 0;
+    int64 hiddenBefore = 0;
+
+    std::vector<Message> messages;
+    std::vector<uint32> freeMessages;
+    std::unordered_map<String, uint32> messageIds;
+};
+
+}
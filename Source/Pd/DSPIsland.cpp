@@ -0,0 +1,99 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <juce_audio_basics/juce_audio_basics.h>
+
+#include "Utility/Config.h"
+#include "DSPIsland.h"
+
+namespace pd {
+
+DSPIsland::DSPIsland(Instance& parentInstance, File const& file, StringArray const& searchPaths)
+    : parent(parentInstance)
+    , patchFile(file)
+{
+    String pdluaVersion;
+    initialisePd(pdluaVersion);
+
+    lockAudioThread();
+    libpd_clear_search_path();
+    for (auto const& path : searchPaths) {
+        libpd_add_to_search_path(path.toRawUTF8());
+    }
+
+    patch = openPatch(patchFile);
+    unlockAudioThread();
+
+    if (!isValid()) {
+        parent.logError("Couldn't open parallel patch: " + patchFile.getFileName());
+    }
+}
+
+DSPIsland::~DSPIsland()
+{
+    release();
+    patch = nullptr;
+}
+
+bool DSPIsland::isValid() const
+{
+    return patch != nullptr && patch->getPointer() != nullptr;
+}
+
+File DSPIsland::getPatchFile() const
+{
+    return patchFile;
+}
+
+void DSPIsland::prepare(int numIns, int numOuts, double sampleRate, int blockSize)
+{
+    prepareDSP(numIns, numOuts, sampleRate, blockSize);
+    audioVectorOut.assign(static_cast<size_t>(numOuts * Instance::getBlockSize()), 0.0f);
+    startDSP();
+}
+
+void DSPIsland::release()
+{
+    releaseDSP();
+}
+
+void DSPIsland::process(float const* inputs)
+{
+    performDSP(inputs, audioVectorOut.data());
+    sendMessagesFromQueue();
+}
+
+void DSPIsland::addOutputTo(float* outputs, int numSamples) const
+{
+    FloatVectorOperations::add(outputs, audioVectorOut.data(), std::min<int>(numSamples, static_cast<int>(audioVectorOut.size())));
+}
+
+void DSPIsland::updateConsole(int numMessages, bool newWarning)
+{
+    // Forward console output to the instance that owns us, so it shows up in the console of the editor
+    auto& messages = getConsoleMessages();
+    for (auto sequence = std::max(messages.getFirstShown(), messages.getEnd() - numMessages); sequence < messages.getEnd(); sequence++) {
+        auto const& entry = messages.get(sequence);
+        auto const& message = messages.getMessage(entry);
+        if (entry.type) {
+            parent.logError("[" + patchFile.getFileName() + "] " + message);
+        } else {
+            parent.logMessage("[" + patchFile.getFileName() + "] " + message);
+        }
+    }
+    messages.clear();
+}
+
+void DSPIsland::reloadAbstractions(File changedPatch, t_glist* except)
+{
+    setThis();
+    lockAudioThread();
+    Patch::reloadPatch(changedPatch, except);
+    unlockAudioThread();
+}
+
+} // namespace pd
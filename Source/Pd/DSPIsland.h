@@ -0,0 +1,65 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "Instance.h"
+
+namespace pd {
+
+// A headless pd instance that runs a single patch with its own DSP chain
+// Since libpd keeps one DSP chain per instance, this is what allows us to process independent patches on separate cores
+// Islands take the same audio input as the main instance, and their output is summed with it at the dac~ stage
+// They don't have an editor, and don't send MIDI or parameters back to the host
+class DSPIsland : public Instance {
+public:
+    DSPIsland(Instance& parentInstance, File const& patchFile, StringArray const& searchPaths);
+    ~DSPIsland() override;
+
+    bool isValid() const;
+    File getPatchFile() const;
+
+    void prepare(int numIns, int numOuts, double sampleRate, int blockSize);
+    void release();
+
+    // Called from a DSP worker thread, writes one pd block of output into audioVectorOut
+    void process(float const* inputs);
+
+    // Adds this island's last output to the main output vector
+    void addOutputTo(float* outputs, int numSamples) const;
+
+    void receiveNoteOn(int channel, int pitch, int velocity) override { }
+    void receiveControlChange(int channel, int controller, int value) override { }
+    void receiveProgramChange(int channel, int value) override { }
+    void receivePitchBend(int channel, int value) override { }
+    void receiveAftertouch(int channel, int value) override { }
+    void receivePolyAftertouch(int channel, int pitch, int value) override { }
+    void receiveMidiByte(int port, int byte) override { }
+
+    void updateConsole(int numMessages, bool newWarning) override;
+    void titleChanged() override { }
+
+    void performParameterChange(int type, String const& name, float value) override { }
+    void enableAudioParameter(String const& name) override { }
+    void setParameterRange(String const& name, float min, float max) override { }
+    void setParameterMode(String const& name, int mode) override { }
+
+    void performLatencyCompensationChange(float value) override { }
+
+    void fillDataBuffer(std::vector<pd::Atom> const& list) override { }
+    void parseDataBuffer(XmlElement const& xml) override { }
+
+    void reloadAbstractions(File changedPatch, t_glist* except) override;
+
+private:
+    Instance& parent;
+    File patchFile;
+    Patch::Ptr patch;
+
+    std::vector<float> audioVectorOut;
+};
+
+} // namespace pd
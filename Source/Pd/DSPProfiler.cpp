@@ -0,0 +1,323 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <juce_gui_basics/juce_gui_basics.h>
+
+#include "Utility/Config.h"
+#include "DSPProfiler.h"
+#include "Instance.h"
+#include "Patch.h"
+
+extern "C" {
+#include <m_imp.h>
+#include <g_canvas.h>
+#include <z_libpd.h>
+}
+
+#include "InstanceAccess.h"
+
+namespace pd {
+
+DSPProfiler::DSPProfiler(Instance* parent)
+    : instance(parent)
+{
+}
+
+DSPProfiler::~DSPProfiler()
+{
+    setEnabled(false);
+}
+
+void DSPProfiler::setProfilingWanted(void* requester, bool wanted)
+{
+    if (wanted)
+        requesters.insert(requester);
+    else
+        requesters.erase(requester);
+
+    setEnabled(!requesters.empty());
+}
+
+float DSPProfiler::getLoad(void* object) const
+{
+    if (auto it = loads.find(object); it != loads.end())
+        return it->second;
+
+    return 0.0f;
+}
+
+void DSPProfiler::setEnabled(bool shouldBeEnabled)
+{
+    if (shouldBeEnabled == enabled.load())
+        return;
+
+    instance->lockAudioThread();
+    instance->setThis();
+
+    auto const instanceNumber = plugdata_instance_number(libpd_this_instance());
+    jassert(isPositiveAndBelow(instanceNumber, maxInstances));
+
+    if (shouldBeEnabled && isPositiveAndBelow(instanceNumber, maxInstances)) {
+        profilers[instanceNumber] = this;
+        bool foundNewClass = false;
+        for (auto* cnv = pd_getcanvaslist(); cnv; cnv = cnv->gl_next) {
+            wrapClasses(cnv, foundNewClass);
+        }
+        enabled = true;
+
+        // Rebuild the DSP chain, so we can see which object adds what
+        canvas_update_dsp();
+        reserveForChain();
+        startTimer(500);
+    } else if (!shouldBeEnabled) {
+        stopTimer();
+        enabled = false;
+        unwrapClasses();
+
+        // Rebuilding the chain gets rid of our trampolines
+        canvas_update_dsp();
+        ranges.clear();
+        patchedEntries.clear();
+        objects.clear();
+        objectTicks.clear();
+        patchedChain = nullptr;
+        patchedChainSize = 0;
+
+        if (isPositiveAndBelow(instanceNumber, maxInstances))
+            profilers[instanceNumber] = nullptr;
+
+        loads.clear();
+        canvasLoads.clear();
+        sendChangeMessage();
+    }
+
+    instance->unlockAudioThread();
+}
+
+void DSPProfiler::wrapClasses(t_canvas* cnv, bool& foundNewClass)
+{
+    static auto* dspSymbol = gensym("dsp");
+
+    for (auto* y = cnv->gl_list; y; y = y->g_next) {
+        auto* cls = pd_class(&y->g_pd);
+
+        // Canvases add their children to the chain, those get profiled individually
+        if (cls == canvas_class) {
+            wrapClasses(reinterpret_cast<t_canvas*>(y), foundNewClass);
+            continue;
+        }
+
+        if (originalDSPMethods.count(cls))
+            continue;
+
+        auto* methods = plugdata_class_methods(cls, libpd_this_instance());
+        for (int i = 0; i < cls->c_nmethod; i++) {
+            if (methods[i].me_name == dspSymbol) {
+                originalDSPMethods[cls] = reinterpret_cast<DSPMethod>(methods[i].me_fun);
+                methods[i].me_fun = reinterpret_cast<t_gotfn>(profiledDSPMethod);
+                foundNewClass = true;
+                break;
+            }
+        }
+    }
+}
+
+void DSPProfiler::unwrapClasses()
+{
+    static auto* dspSymbol = gensym("dsp");
+
+    for (auto& [cls, original] : originalDSPMethods) {
+        auto* methods = plugdata_class_methods(cls, libpd_this_instance());
+        for (int i = 0; i < cls->c_nmethod; i++) {
+            if (methods[i].me_name == dspSymbol) {
+                methods[i].me_fun = reinterpret_cast<t_gotfn>(original);
+                break;
+            }
+        }
+    }
+
+    originalDSPMethods.clear();
+}
+
+// The audio thread can't allocate, so make room for patching the chain pd just built
+void DSPProfiler::reserveForChain()
+{
+    auto const chainSize = static_cast<size_t>(std::max(plugdata_dspchainsize(libpd_this_instance()), 0));
+    patchedEntries.reserve(chainSize);
+    ranges.reserve(chainSize);
+    objects.reserve(ranges.size());
+    objectTicks.reserve(ranges.size());
+}
+
+DSPProfiler* DSPProfiler::getCurrent()
+{
+    auto const instanceNumber = plugdata_instance_number(libpd_this_instance());
+    return isPositiveAndBelow(instanceNumber, maxInstances) ? profilers[instanceNumber].load(std::memory_order_relaxed) : nullptr;
+}
+
+// Stands in for the dsp method of every signal class, to record which part of the chain each object added
+void DSPProfiler::profiledDSPMethod(t_object* x, t_signal** sp)
+{
+    auto* profiler = getCurrent();
+    if (!profiler)
+        return;
+
+    auto it = profiler->originalDSPMethods.find(pd_class(&x->ob_pd));
+    if (it == profiler->originalDSPMethods.end())
+        return;
+
+    auto const start = plugdata_dspchainsize(libpd_this_instance()) - 1;
+
+    // Chain got smaller than what we've seen, so this is a new build
+    if (!profiler->ranges.empty() && start <= profiler->ranges.back().start)
+        profiler->ranges.clear();
+
+    it->second(x, sp);
+
+    if (plugdata_dspchainsize(libpd_this_instance()) - 1 > start)
+        profiler->ranges.push_back({ x, start });
+}
+
+t_int* DSPProfiler::profiledPerform(t_int* w)
+{
+    auto* profiler = getCurrent();
+    auto const now = Time::getHighResolutionTicks();
+    auto const offset = static_cast<int>(w - profiler->patchedChain);
+    auto const& entry = profiler->patchedEntries[offset];
+
+    if (profiler->currentObject >= 0)
+        profiler->objectTicks[profiler->currentObject] += now - profiler->lastTimestamp;
+
+    profiler->currentObject = entry.object;
+    profiler->lastTimestamp = now;
+
+    return entry.original(w);
+}
+
+void DSPProfiler::prepareChain()
+{
+    auto* chain = plugdata_dspchain(libpd_this_instance());
+    auto const chainSize = plugdata_dspchainsize(libpd_this_instance());
+
+    currentObject = -1;
+
+    if (chain == patchedChain && chainSize == patchedChainSize)
+        return;
+
+    objects.clear();
+    objectTicks.clear();
+
+    // Until the message thread has made room for this chain, leave it as it is and try again next tick
+    if (chain && (patchedEntries.capacity() < static_cast<size_t>(chainSize) || objects.capacity() < ranges.size())) {
+        patchedChain = nullptr;
+        patchedChainSize = 0;
+        return;
+    }
+
+    // pd rebuilt the chain, put our trampolines back in
+    patchedChain = chain;
+    patchedChainSize = chainSize;
+
+    if (!chain || chainSize <= 0)
+        return;
+
+    patchedEntries.assign(static_cast<size_t>(chainSize), PatchedEntry());
+
+    for (auto const& range : ranges) {
+        if (range.start >= chainSize - 1)
+            break;
+
+        auto& entry = patchedEntries[range.start];
+        entry.original = reinterpret_cast<t_perfroutine>(chain[range.start]);
+        entry.object = static_cast<int>(objects.size());
+        chain[range.start] = reinterpret_cast<t_int>(profiledPerform);
+
+        objects.push_back(range.object);
+        objectTicks.push_back(0);
+    }
+
+    // The last entry finishes the chain, timestamp it so the last object gets its time too
+    auto& last = patchedEntries[chainSize - 1];
+    last.original = reinterpret_cast<t_perfroutine>(chain[chainSize - 1]);
+    chain[chainSize - 1] = reinterpret_cast<t_int>(profiledPerform);
+}
+
+void DSPProfiler::timerCallback()
+{
+    instance->lockAudioThread();
+    instance->setThis();
+
+    // Pick up signal classes that were created since we started
+    bool foundNewClass = false;
+    for (auto* cnv = pd_getcanvaslist(); cnv; cnv = cnv->gl_next) {
+        wrapClasses(cnv, foundNewClass);
+    }
+    if (foundNewClass)
+        canvas_update_dsp();
+
+    reserveForChain();
+
+    int64 totalTicks = 0;
+    for (auto ticks : objectTicks)
+        totalTicks += ticks;
+
+    std::unordered_map<void*, float> newLoads;
+    for (size_t i = 0; i < objects.size(); i++) {
+        auto const load = totalTicks > 0 ? static_cast<float>(objectTicks[i]) / static_cast<float>(totalTicks) : 0.0f;
+        auto const previous = getLoad(objects[i]);
+        newLoads[objects[i]] = previous * 0.5f + load * 0.5f;
+        objectTicks[i] = 0;
+    }
+
+    std::vector<CanvasLoad> newCanvasLoads;
+    for (auto* cnv = pd_getcanvaslist(); cnv; cnv = cnv->gl_next) {
+        addCanvasLoads(cnv, String(), newLoads, newCanvasLoads);
+    }
+
+    instance->unlockAudioThread();
+
+    std::sort(newCanvasLoads.begin(), newCanvasLoads.end(), [](auto const& a, auto const& b) {
+        return a.load > b.load;
+    });
+
+    loads = std::move(newLoads);
+    canvasLoads = std::move(newCanvasLoads);
+    sendChangeMessage();
+}
+
+// Adds up the load of everything inside this canvas, and stores it as the canvas' own load
+float DSPProfiler::addCanvasLoads(t_canvas* cnv, String const& parentName, std::unordered_map<void*, float>& loads, std::vector<CanvasLoad>& canvasLoads)
+{
+    auto const canvasName = String::fromUTF8(cnv->gl_name->s_name);
+    auto const name = parentName.isEmpty() ? canvasName : parentName + " > " + canvasName;
+
+    float total = 0.0f;
+    for (auto* y = cnv->gl_list; y; y = y->g_next) {
+        if (pd_class(&y->g_pd) == canvas_class) {
+            total += addCanvasLoads(reinterpret_cast<t_canvas*>(y), name, loads, canvasLoads);
+        } else if (auto it = loads.find(y); it != loads.end()) {
+            total += it->second;
+        }
+    }
+
+    if (total > 0.0f) {
+        loads[cnv] = total;
+
+        // Resampled subpatches are often the ones that cost the most, so show their rate with them
+        auto const context = Patch::getDSPContext(cnv);
+        auto label = name;
+        if (context.resampling > 1.0f)
+            label << " (" << roundToInt(context.resampling) << "x)";
+        else if (context.resampling < 1.0f)
+            label << " (1/" << roundToInt(1.0f / context.resampling) << "x)";
+
+        canvasLoads.push_back({ cnv, label, total, parentName.isEmpty() });
+    }
+
+    return total;
+}
+
+}
@@ -0,0 +1,101 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+extern "C" {
+#include <m_pd.h>
+}
+
+namespace pd {
+
+class Instance;
+
+// Measures how much of the DSP time each object takes, for the "DSP load" overlay
+// While enabled, the "dsp" method of every signal class is wrapped, so we can see which part of the DSP chain each object adds
+// Before every tick, the first perform routine of each object is swapped for a trampoline that timestamps it
+// The time between two timestamps is attributed to the object that was running in between
+// Subpatches and abstractions get the load of everything inside them, so the CPU meter can list which patches take the most
+// This only costs anything while a canvas shows the overlay, or the CPU meter popup is open
+class DSPProfiler : public Timer
+    , public ChangeBroadcaster {
+public:
+    explicit DSPProfiler(Instance* parent);
+    ~DSPProfiler() override;
+
+    // Every canvas that shows the overlay asks for profiling, it stays active while anyone needs it
+    void setProfilingWanted(void* requester, bool wanted);
+
+    struct CanvasLoad {
+        void* canvas;
+        String name; // Including the names of the patches it's in, like "main.pd > synth > filter"
+        float load;
+        bool isTopLevel;
+    };
+
+    // Fraction of the total DSP time spent in this object, averaged over the last few windows
+    // For a subpatch or abstraction, that's the load of everything inside it
+    float getLoad(void* object) const;
+
+    // Every patch and subpatch that takes any DSP time, the heaviest first
+    std::vector<CanvasLoad> const& getCanvasLoads() const { return canvasLoads; }
+
+    // Called from the audio thread right before a tick, while holding the pd lock
+    void prepareChain();
+
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+private:
+    using DSPMethod = void (*)(t_object*, t_signal**);
+
+    struct Range {
+        t_object* object;
+        int start;
+    };
+
+    struct PatchedEntry {
+        t_perfroutine original = nullptr;
+        int object = -1;
+    };
+
+    void timerCallback() override;
+    void setEnabled(bool shouldBeEnabled);
+
+    void wrapClasses(t_canvas* cnv, bool& foundNewClass);
+    void reserveForChain();
+    static float addCanvasLoads(t_canvas* cnv, String const& parentName, std::unordered_map<void*, float>& loads, std::vector<CanvasLoad>& canvasLoads);
+    void unwrapClasses();
+
+    static void profiledDSPMethod(t_object* x, t_signal** sp);
+    static t_int* profiledPerform(t_int* w);
+    static DSPProfiler* getCurrent();
+
+    Instance* instance;
+    std::atomic<bool> enabled = false;
+    std::set<void*> requesters;
+
+    // Only touched while holding the pd lock
+    std::unordered_map<t_class*, DSPMethod> originalDSPMethods;
+    std::vector<Range> ranges;
+    std::vector<PatchedEntry> patchedEntries;
+    std::vector<t_object*> objects;
+    std::vector<int64> objectTicks;
+    t_int* patchedChain = nullptr;
+    int patchedChainSize = 0;
+    int currentObject = -1;
+    int64 lastTimestamp = 0;
+
+    // Message thread only
+    std::unordered_map<void*, float> loads;
+    std::vector<CanvasLoad> canvasLoads;
+
+    static constexpr int maxInstances = 256;
+    static inline std::atomic<DSPProfiler*> profilers[maxInstances] = {};
+
+    JUCE_DECLARE_NON_COPYABLE(DSPProfiler)
+};
+
+}
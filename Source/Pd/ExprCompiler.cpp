@@ -0,0 +1,746 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <juce_core/juce_core.h>
+#include "Utility/Config.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+
+extern "C" {
+#include <m_pd.h>
+#include <m_imp.h>
+}
+
+#include "ExprCompiler.h"
+
+namespace pd {
+
+enum class ExprCode {
+    Input,
+    Constant,
+    Neg,
+    Not,
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Equal,
+    NotEqual,
+    And,
+    Or,
+    Sin,
+    Cos,
+    Tan,
+    Asin,
+    Acos,
+    Atan,
+    Sinh,
+    Cosh,
+    Tanh,
+    Sqrt,
+    Exp,
+    Log,
+    Log10,
+    Abs,
+    Floor,
+    Ceil,
+    Int,
+    Rint,
+    Atan2,
+    Pow,
+    Min,
+    Max,
+    Fmod,
+    If
+};
+
+// Shared by constant folding and the block loops, where the code is a template argument so the switch disappears
+template<typename T>
+static T applyExpr(ExprCode code, T a, T b, T c)
+{
+    switch (code) {
+    case ExprCode::Neg: return -a;
+    case ExprCode::Not: return a == 0;
+    case ExprCode::Add: return a + b;
+    case ExprCode::Sub: return a - b;
+    case ExprCode::Mul: return a * b;
+    case ExprCode::Div: return b != 0 ? a / b : 0; // expr~ outputs 0 when dividing by zero
+    case ExprCode::Less: return a < b;
+    case ExprCode::LessEqual: return a <= b;
+    case ExprCode::Greater: return a > b;
+    case ExprCode::GreaterEqual: return a >= b;
+    case ExprCode::Equal: return a == b;
+    case ExprCode::NotEqual: return a != b;
+    case ExprCode::And: return a != 0 && b != 0;
+    case ExprCode::Or: return a != 0 || b != 0;
+    case ExprCode::Sin: return std::sin(a);
+    case ExprCode::Cos: return std::cos(a);
+    case ExprCode::Tan: return std::tan(a);
+    case ExprCode::Asin: return std::asin(a);
+    case ExprCode::Acos: return std::acos(a);
+    case ExprCode::Atan: return std::atan(a);
+    case ExprCode::Sinh: return std::sinh(a);
+    case ExprCode::Cosh: return std::cosh(a);
+    case ExprCode::Tanh: return std::tanh(a);
+    case ExprCode::Sqrt: return std::sqrt(a);
+    case ExprCode::Exp: return std::exp(a);
+    case ExprCode::Log: return std::log(a);
+    case ExprCode::Log10: return std::log10(a);
+    case ExprCode::Abs: return std::abs(a);
+    case ExprCode::Floor: return std::floor(a);
+    case ExprCode::Ceil: return std::ceil(a);
+    case ExprCode::Int: return std::trunc(a);
+    case ExprCode::Rint: return std::rint(a);
+    case ExprCode::Atan2: return std::atan2(a, b);
+    case ExprCode::Pow: return std::pow(a, b);
+    case ExprCode::Min: return std::min(a, b);
+    case ExprCode::Max: return std::max(a, b);
+    case ExprCode::Fmod: return std::fmod(a, b);
+    case ExprCode::If: return a != 0 ? b : c;
+    default: return 0;
+    }
+}
+
+static bool isBinaryExpr(ExprCode code)
+{
+    return (code >= ExprCode::Add && code <= ExprCode::Or) || (code >= ExprCode::Atan2 && code <= ExprCode::Fmod);
+}
+
+struct ExprNode {
+    ExprCode code = ExprCode::Constant;
+    double value = 0;
+    bool isInt = false; // expr does integer maths on integer constants, so 1/2 is 0
+    int input = 0;
+    std::vector<ExprNode> args;
+};
+
+// Recursive descent over the text of the expression, with C's precedence
+// Subexpressions that only use constants are folded while parsing
+class ExprParser {
+public:
+    ExprParser(std::string const& textToParse, int numSignalInputs)
+        : text(textToParse)
+        , numInputs(numSignalInputs)
+    {
+    }
+
+    bool parse(ExprNode& result)
+    {
+        result = parseOr();
+        skipSpace();
+        return !failed && position == text.size();
+    }
+
+private:
+    ExprNode parseOr()
+    {
+        auto left = parseAnd();
+        while (!failed && accept("||"))
+            left = makeNode(ExprCode::Or, { std::move(left), parseAnd() });
+        return left;
+    }
+
+    ExprNode parseAnd()
+    {
+        auto left = parseEquality();
+        while (!failed && accept("&&"))
+            left = makeNode(ExprCode::And, { std::move(left), parseEquality() });
+        return left;
+    }
+
+    ExprNode parseEquality()
+    {
+        auto left = parseRelational();
+        while (!failed) {
+            if (accept("=="))
+                left = makeNode(ExprCode::Equal, { std::move(left), parseRelational() });
+            else if (accept("!="))
+                left = makeNode(ExprCode::NotEqual, { std::move(left), parseRelational() });
+            else
+                break;
+        }
+        return left;
+    }
+
+    ExprNode parseRelational()
+    {
+        auto left = parseAdditive();
+        while (!failed) {
+            // Shifts aren't compiled, leave them for the parse to fail on
+            if (peek("<<") || peek(">>"))
+                break;
+
+            if (accept("<="))
+                left = makeNode(ExprCode::LessEqual, { std::move(left), parseAdditive() });
+            else if (accept(">="))
+                left = makeNode(ExprCode::GreaterEqual, { std::move(left), parseAdditive() });
+            else if (accept("<"))
+                left = makeNode(ExprCode::Less, { std::move(left), parseAdditive() });
+            else if (accept(">"))
+                left = makeNode(ExprCode::Greater, { std::move(left), parseAdditive() });
+            else
+                break;
+        }
+        return left;
+    }
+
+    ExprNode parseAdditive()
+    {
+        auto left = parseMultiplicative();
+        while (!failed) {
+            if (accept("+"))
+                left = makeNode(ExprCode::Add, { std::move(left), parseMultiplicative() });
+            else if (accept("-"))
+                left = makeNode(ExprCode::Sub, { std::move(left), parseMultiplicative() });
+            else
+                break;
+        }
+        return left;
+    }
+
+    ExprNode parseMultiplicative()
+    {
+        auto left = parseUnary();
+        while (!failed) {
+            if (accept("*"))
+                left = makeNode(ExprCode::Mul, { std::move(left), parseUnary() });
+            else if (accept("/"))
+                left = makeNode(ExprCode::Div, { std::move(left), parseUnary() });
+            else
+                break;
+        }
+        return left;
+    }
+
+    ExprNode parseUnary()
+    {
+        if (accept("-"))
+            return makeNode(ExprCode::Neg, { parseUnary() });
+        if (!peek("!=") && accept("!"))
+            return makeNode(ExprCode::Not, { parseUnary() });
+        if (accept("+"))
+            return parseUnary();
+
+        return parsePrimary();
+    }
+
+    ExprNode parsePrimary()
+    {
+        skipSpace();
+        if (position >= text.size())
+            return fail();
+
+        if (accept("(")) {
+            auto node = parseOr();
+            if (!accept(")"))
+                return fail();
+            return node;
+        }
+
+        auto const c = text[position];
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+            return parseNumber();
+
+        if (c == '$') {
+            // Only signal inputs are compiled, $f, $s, $i and fexpr~'s $x and $y go through expr~ itself
+            if (position + 2 > text.size() || (text[position + 1] != 'v' && text[position + 1] != 'V'))
+                return fail();
+
+            position += 2;
+            auto const start = position;
+            while (position < text.size() && std::isdigit(static_cast<unsigned char>(text[position])))
+                position++;
+
+            auto const index = start == position || position - start > 4 ? 0 : std::stoi(text.substr(start, position - start));
+            if (index < 1 || index > numInputs)
+                return fail();
+
+            ExprNode node;
+            node.code = ExprCode::Input;
+            node.input = index - 1;
+            return node;
+        }
+
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+            return parseFunction();
+
+        return fail();
+    }
+
+    ExprNode parseNumber()
+    {
+        auto const start = position;
+        bool isInt = true;
+        while (position < text.size()) {
+            auto const c = text[position];
+            if (std::isdigit(static_cast<unsigned char>(c))) {
+                position++;
+            } else if (c == '.') {
+                isInt = false;
+                position++;
+            } else if ((c == 'e' || c == 'E') && position + 1 < text.size()) {
+                isInt = false;
+                position++;
+                if (text[position] == '-' || text[position] == '+')
+                    position++;
+            } else {
+                break;
+            }
+        }
+
+        char* end = nullptr;
+        auto const number = text.substr(start, position - start);
+        auto const value = std::strtod(number.c_str(), &end);
+        if (end != number.c_str() + number.size())
+            return fail();
+
+        ExprNode node;
+        node.value = value;
+        node.isInt = isInt;
+        return node;
+    }
+
+    ExprNode parseFunction()
+    {
+        auto const start = position;
+        while (position < text.size() && (std::isalnum(static_cast<unsigned char>(text[position])) || text[position] == '_'))
+            position++;
+
+        struct Function {
+            char const* name;
+            ExprCode code;
+            int numArgs;
+        };
+        static Function const functions[] = {
+            { "sin", ExprCode::Sin, 1 }, { "cos", ExprCode::Cos, 1 }, { "tan", ExprCode::Tan, 1 },
+            { "asin", ExprCode::Asin, 1 }, { "acos", ExprCode::Acos, 1 }, { "atan", ExprCode::Atan, 1 },
+            { "sinh", ExprCode::Sinh, 1 }, { "cosh", ExprCode::Cosh, 1 }, { "tanh", ExprCode::Tanh, 1 },
+            { "sqrt", ExprCode::Sqrt, 1 }, { "exp", ExprCode::Exp, 1 }, { "log", ExprCode::Log, 1 },
+            { "ln", ExprCode::Log, 1 }, { "log10", ExprCode::Log10, 1 }, { "abs", ExprCode::Abs, 1 },
+            { "fabs", ExprCode::Abs, 1 }, { "floor", ExprCode::Floor, 1 }, { "ceil", ExprCode::Ceil, 1 },
+            { "int", ExprCode::Int, 1 }, { "rint", ExprCode::Rint, 1 }, { "float", ExprCode::Constant, 1 },
+            { "atan2", ExprCode::Atan2, 2 }, { "pow", ExprCode::Pow, 2 }, { "min", ExprCode::Min, 2 },
+            { "max", ExprCode::Max, 2 }, { "fmod", ExprCode::Fmod, 2 }, { "if", ExprCode::If, 3 }
+        };
+
+        auto const name = text.substr(start, position - start);
+        auto const* function = std::find_if(std::begin(functions), std::end(functions), [&name](auto const& f) { return name == f.name; });
+
+        // Unknown functions and table lookups aren't compiled
+        if (function == std::end(functions) || !accept("("))
+            return fail();
+
+        std::vector<ExprNode> args;
+        for (int i = 0; i < function->numArgs && !failed; i++) {
+            if (i > 0 && !accept(","))
+                return fail();
+            args.push_back(parseOr());
+        }
+        if (failed || !accept(")"))
+            return fail();
+
+        // float() only tells expr to stop doing integer maths
+        if (function->code == ExprCode::Constant) {
+            args[0].isInt = false;
+            return std::move(args[0]);
+        }
+
+        return makeNode(function->code, std::move(args));
+    }
+
+    ExprNode makeNode(ExprCode code, std::vector<ExprNode> args)
+    {
+        ExprNode node;
+        node.code = code;
+        node.args = std::move(args);
+
+        if (failed)
+            return node;
+
+        bool allConstant = true;
+        bool allInts = true;
+        for (auto const& arg : node.args) {
+            allConstant = allConstant && arg.code == ExprCode::Constant;
+            allInts = allInts && arg.isInt;
+        }
+        if (!allConstant)
+            return node;
+
+        auto const a = node.args[0].value;
+        auto const b = node.args.size() > 1 ? node.args[1].value : 0.0;
+        auto const c = node.args.size() > 2 ? node.args[2].value : 0.0;
+
+        ExprNode folded;
+        if (code == ExprCode::Div && allInts) {
+            folded.value = b != 0 ? std::trunc(a / b) : 0.0;
+        } else {
+            folded.value = applyExpr(code, a, b, c);
+        }
+
+        switch (code) {
+        case ExprCode::Neg:
+        case ExprCode::Add:
+        case ExprCode::Sub:
+        case ExprCode::Mul:
+        case ExprCode::Div:
+        case ExprCode::Abs:
+        case ExprCode::Min:
+        case ExprCode::Max:
+            folded.isInt = allInts;
+            break;
+        case ExprCode::If:
+            folded.isInt = a != 0 ? node.args[1].isInt : node.args[2].isInt;
+            break;
+        case ExprCode::Int:
+            folded.isInt = true;
+            break;
+        default:
+            folded.isInt = code >= ExprCode::Not && code <= ExprCode::Or;
+            break;
+        }
+
+        return folded;
+    }
+
+    void skipSpace()
+    {
+        while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position])))
+            position++;
+    }
+
+    bool peek(char const* token)
+    {
+        skipSpace();
+        return text.compare(position, std::strlen(token), token) == 0;
+    }
+
+    bool accept(char const* token)
+    {
+        if (!peek(token))
+            return false;
+
+        position += std::strlen(token);
+        return true;
+    }
+
+    ExprNode fail()
+    {
+        failed = true;
+        return {};
+    }
+
+    std::string const& text;
+    int const numInputs;
+    size_t position = 0;
+    bool failed = false;
+};
+
+struct CompiledExpr {
+    static constexpr int stackSize = 16;
+    static constexpr int chunkSize = 64;
+
+    struct Op {
+        ExprCode code;
+        t_sample value = 0;
+        int input = 0;
+        bool withConstant = false; // Binary operation with a constant on the right, which isn't put on the stack
+    };
+
+    int numInputs = 0;
+    std::vector<std::vector<Op>> outputs;
+
+    // Every output leaves its result on the stack, above the results of the outputs before it
+    bool compile(ExprNode const& node)
+    {
+        auto& ops = outputs.emplace_back();
+        auto depth = static_cast<int>(outputs.size()) - 1;
+        return emit(node, ops, depth);
+    }
+
+    bool emit(ExprNode const& node, std::vector<Op>& ops, int& depth)
+    {
+        if (node.code == ExprCode::Input || node.code == ExprCode::Constant) {
+            ops.push_back({ node.code, static_cast<t_sample>(node.value), node.input });
+            return ++depth <= stackSize;
+        }
+
+        if (isBinaryExpr(node.code) && node.args[1].code == ExprCode::Constant) {
+            if (!emit(node.args[0], ops, depth))
+                return false;
+            ops.push_back({ node.code, static_cast<t_sample>(node.args[1].value), 0, true });
+            return true;
+        }
+
+        for (auto const& arg : node.args) {
+            if (!emit(arg, ops, depth))
+                return false;
+        }
+
+        ops.push_back({ node.code });
+        depth -= static_cast<int>(node.args.size()) - 1;
+        return true;
+    }
+};
+
+template<ExprCode code>
+static void runUnaryExpr(t_sample* a, int length)
+{
+    for (int i = 0; i < length; i++)
+        a[i] = applyExpr<t_sample>(code, a[i], 0, 0);
+}
+
+template<ExprCode code>
+static void runBinaryExpr(CompiledExpr::Op const& op, t_sample (*stack)[CompiledExpr::chunkSize], int& top, int length)
+{
+    if (op.withConstant) {
+        auto* a = stack[top - 1];
+        auto const b = op.value;
+        for (int i = 0; i < length; i++)
+            a[i] = applyExpr<t_sample>(code, a[i], b, 0);
+        return;
+    }
+
+    top--;
+    auto* a = stack[top - 1];
+    auto const* b = stack[top];
+    for (int i = 0; i < length; i++)
+        a[i] = applyExpr<t_sample>(code, a[i], b[i], 0);
+}
+
+static void runExprOp(CompiledExpr::Op const& op, t_sample (*stack)[CompiledExpr::chunkSize], int& top, t_int const* signals, int offset, int length)
+{
+    switch (op.code) {
+    case ExprCode::Input: {
+        auto const* in = reinterpret_cast<t_sample const*>(signals[op.input]) + offset;
+        std::copy(in, in + length, stack[top++]);
+        break;
+    }
+    case ExprCode::Constant:
+        std::fill(stack[top], stack[top] + length, op.value);
+        top++;
+        break;
+    case ExprCode::If: {
+        top -= 2;
+        auto* condition = stack[top - 1];
+        auto const* a = stack[top];
+        auto const* b = stack[top + 1];
+        for (int i = 0; i < length; i++)
+            condition[i] = condition[i] != 0 ? a[i] : b[i];
+        break;
+    }
+    case ExprCode::Neg: runUnaryExpr<ExprCode::Neg>(stack[top - 1], length); break;
+    case ExprCode::Not: runUnaryExpr<ExprCode::Not>(stack[top - 1], length); break;
+    case ExprCode::Sin: runUnaryExpr<ExprCode::Sin>(stack[top - 1], length); break;
+    case ExprCode::Cos: runUnaryExpr<ExprCode::Cos>(stack[top - 1], length); break;
+    case ExprCode::Tan: runUnaryExpr<ExprCode::Tan>(stack[top - 1], length); break;
+    case ExprCode::Asin: runUnaryExpr<ExprCode::Asin>(stack[top - 1], length); break;
+    case ExprCode::Acos: runUnaryExpr<ExprCode::Acos>(stack[top - 1], length); break;
+    case ExprCode::Atan: runUnaryExpr<ExprCode::Atan>(stack[top - 1], length); break;
+    case ExprCode::Sinh: runUnaryExpr<ExprCode::Sinh>(stack[top - 1], length); break;
+    case ExprCode::Cosh: runUnaryExpr<ExprCode::Cosh>(stack[top - 1], length); break;
+    case ExprCode::Tanh: runUnaryExpr<ExprCode::Tanh>(stack[top - 1], length); break;
+    case ExprCode::Sqrt: runUnaryExpr<ExprCode::Sqrt>(stack[top - 1], length); break;
+    case ExprCode::Exp: runUnaryExpr<ExprCode::Exp>(stack[top - 1], length); break;
+    case ExprCode::Log: runUnaryExpr<ExprCode::Log>(stack[top - 1], length); break;
+    case ExprCode::Log10: runUnaryExpr<ExprCode::Log10>(stack[top - 1], length); break;
+    case ExprCode::Abs: runUnaryExpr<ExprCode::Abs>(stack[top - 1], length); break;
+    case ExprCode::Floor: runUnaryExpr<ExprCode::Floor>(stack[top - 1], length); break;
+    case ExprCode::Ceil: runUnaryExpr<ExprCode::Ceil>(stack[top - 1], length); break;
+    case ExprCode::Int: runUnaryExpr<ExprCode::Int>(stack[top - 1], length); break;
+    case ExprCode::Rint: runUnaryExpr<ExprCode::Rint>(stack[top - 1], length); break;
+    case ExprCode::Add: runBinaryExpr<ExprCode::Add>(op, stack, top, length); break;
+    case ExprCode::Sub: runBinaryExpr<ExprCode::Sub>(op, stack, top, length); break;
+    case ExprCode::Mul: runBinaryExpr<ExprCode::Mul>(op, stack, top, length); break;
+    case ExprCode::Div: runBinaryExpr<ExprCode::Div>(op, stack, top, length); break;
+    case ExprCode::Less: runBinaryExpr<ExprCode::Less>(op, stack, top, length); break;
+    case ExprCode::LessEqual: runBinaryExpr<ExprCode::LessEqual>(op, stack, top, length); break;
+    case ExprCode::Greater: runBinaryExpr<ExprCode::Greater>(op, stack, top, length); break;
+    case ExprCode::GreaterEqual: runBinaryExpr<ExprCode::GreaterEqual>(op, stack, top, length); break;
+    case ExprCode::Equal: runBinaryExpr<ExprCode::Equal>(op, stack, top, length); break;
+    case ExprCode::NotEqual: runBinaryExpr<ExprCode::NotEqual>(op, stack, top, length); break;
+    case ExprCode::And: runBinaryExpr<ExprCode::And>(op, stack, top, length); break;
+    case ExprCode::Or: runBinaryExpr<ExprCode::Or>(op, stack, top, length); break;
+    case ExprCode::Atan2: runBinaryExpr<ExprCode::Atan2>(op, stack, top, length); break;
+    case ExprCode::Pow: runBinaryExpr<ExprCode::Pow>(op, stack, top, length); break;
+    case ExprCode::Min: runBinaryExpr<ExprCode::Min>(op, stack, top, length); break;
+    case ExprCode::Max: runBinaryExpr<ExprCode::Max>(op, stack, top, length); break;
+    case ExprCode::Fmod: runBinaryExpr<ExprCode::Fmod>(op, stack, top, length); break;
+    }
+}
+
+static t_int* compiled_expr_perform(t_int* w)
+{
+    auto const* program = reinterpret_cast<CompiledExpr const*>(w[1]);
+    auto const n = static_cast<int>(w[2]);
+    auto const* signals = w + 3;
+    auto const* outputs = signals + program->numInputs;
+    auto const numOutputs = static_cast<int>(program->outputs.size());
+
+    // Outputs can share their buffer with an input, so every output of a chunk is computed before any is written
+    t_sample stack[CompiledExpr::stackSize][CompiledExpr::chunkSize];
+    for (int offset = 0; offset < n; offset += CompiledExpr::chunkSize) {
+        auto const length = std::min(CompiledExpr::chunkSize, n - offset);
+        int top = 0;
+        for (auto const& ops : program->outputs) {
+            for (auto const& op : ops)
+                runExprOp(op, stack, top, signals, offset, length);
+        }
+        for (int i = 0; i < numOutputs; i++)
+            std::copy(stack[i], stack[i] + length, reinterpret_cast<t_sample*>(outputs[i]) + offset);
+    }
+
+    return w + 3 + program->numInputs + numOutputs;
+}
+
+using DSPMethod = void (*)(t_object*, t_signal**);
+static DSPMethod originalExprDSP = nullptr;
+static std::atomic<bool> exprCompilerEnabled = true;
+
+// The text expr~ was created with, as expr~ itself puts it together from its arguments
+static bool getExprText(t_object* x, std::vector<std::string>& expressions)
+{
+    if (!x->te_binbuf)
+        return false;
+
+    auto const argc = binbuf_getnatom(x->te_binbuf);
+    auto const* argv = binbuf_getvec(x->te_binbuf);
+
+    std::string text;
+    for (int i = 1; i < argc; i++) {
+        switch (argv[i].a_type) {
+        case A_FLOAT: {
+            char buf[MAXPDSTRING];
+            atom_string(&argv[i], buf, MAXPDSTRING);
+            text += buf;
+            break;
+        }
+        case A_SYMBOL:
+            text += argv[i].a_w.w_symbol->s_name;
+            break;
+        case A_COMMA:
+            text += ',';
+            break;
+        case A_SEMI:
+            expressions.push_back(std::move(text));
+            text.clear();
+            break;
+        default:
+            return false; // Dollar arguments of abstractions
+        }
+        text += ' ';
+    }
+
+    if (text.find_first_not_of(' ') != std::string::npos)
+        expressions.push_back(std::move(text));
+
+    return !expressions.empty();
+}
+
+// Programs are shared by every expr~ with the same text, and kept for as long as we run
+// Expressions that can't be compiled are remembered too, so we don't parse them again on every DSP rebuild
+static CompiledExpr const* getCompiledExpr(t_object* x, int numInputs, int numOutputs)
+{
+    static std::mutex cacheMutex;
+    static std::map<std::string, std::unique_ptr<CompiledExpr>> cache;
+
+    std::vector<std::string> expressions;
+    if (!getExprText(x, expressions) || static_cast<int>(expressions.size()) != numOutputs)
+        return nullptr;
+
+    auto key = std::to_string(numInputs);
+    for (auto const& expression : expressions)
+        key += ';' + expression;
+
+    std::lock_guard lock(cacheMutex);
+    if (auto it = cache.find(key); it != cache.end())
+        return it->second.get();
+
+    auto program = std::make_unique<CompiledExpr>();
+    program->numInputs = numInputs;
+    for (auto const& expression : expressions) {
+        ExprNode node;
+        ExprParser parser(expression, numInputs);
+        if (!parser.parse(node) || !program->compile(node)) {
+            program.reset();
+            break;
+        }
+    }
+
+    return (cache[key] = std::move(program)).get();
+}
+
+static bool addCompiledExpr(t_object* x, t_signal** sp)
+{
+    auto const numInputs = obj_nsiginlets(x);
+    auto const numOutputs = obj_nsigoutlets(x);
+    if (numInputs <= 0 || numOutputs <= 0)
+        return false;
+
+    for (int i = 0; i < numInputs; i++) {
+        if (sp[i]->s_nchans != 1)
+            return false;
+    }
+
+    auto const* program = getCompiledExpr(x, numInputs, numOutputs);
+    if (!program)
+        return false;
+
+    auto const n = sp[0]->s_n;
+    std::vector<t_int> args = { reinterpret_cast<t_int>(program), static_cast<t_int>(n) };
+    for (int i = 0; i < numInputs + numOutputs; i++) {
+        if (!sp[i])
+            signal_setmultiout(&sp[i], 1);
+        args.push_back(reinterpret_cast<t_int>(sp[i]->s_vec));
+    }
+
+    dsp_addv(compiled_expr_perform, static_cast<int>(args.size()), args.data());
+    return true;
+}
+
+static void compiled_expr_dsp(t_object* x, t_signal** sp)
+{
+    if (exprCompilerEnabled.load(std::memory_order_relaxed) && addCompiledExpr(x, sp))
+        return;
+
+    originalExprDSP(x, sp);
+}
+
+void ExprCompiler::setup()
+{
+    // expr~'s class isn't exported, so we make one to find it
+    t_atom arg;
+    SETSYMBOL(&arg, gensym("$v1"));
+    pd_this->pd_newest = nullptr;
+    pd_typedmess(&pd_objectmaker, gensym("expr~"), 1, &arg);
+
+    auto* expr = pd_newest();
+    if (!expr)
+        return;
+
+    auto* exprClass = pd_class(expr);
+    originalExprDSP = reinterpret_cast<DSPMethod>(zgetfn(expr, gensym("dsp")));
+    pd_free(expr);
+
+    // pd keeps the old method around as "dsp_aliased"
+    if (originalExprDSP)
+        class_addmethod(exprClass, reinterpret_cast<t_method>(compiled_expr_dsp), gensym("dsp"), A_CANT, 0);
+}
+
+void ExprCompiler::setEnabled(bool shouldBeEnabled)
+{
+    exprCompilerEnabled = shouldBeEnabled;
+}
+
+}
@@ -0,0 +1,22 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+namespace pd {
+
+// Replaces the dsp method of [expr~], to run simple expressions as a list of block-wise operations instead of
+// interpreting the expression tree for every block. Expressions are compiled once per text, and shared by every object
+// Only $v inputs, numbers, arithmetic, comparisons, logic and the common math functions are compiled
+// Anything else, like $f inlets, tables, integer operators or multichannel inputs, still goes through expr~ itself
+struct ExprCompiler {
+    static void setup();
+
+    // Takes effect when the DSP chain is rebuilt
+    static void setEnabled(bool shouldBeEnabled);
+};
+
+}
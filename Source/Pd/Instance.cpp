@@ -11,11 +11,15 @@
 #include "Dialogs/Dialogs.h"
 
 #include <algorithm>
+#include <array>
 #include "Instance.h"
 #include "Patch.h"
+#include "Library.h"
 #include "MessageListener.h"
 #include "Objects/ImplementationBase.h"
 #include "Utility/SettingsFile.h"
+#include "Utility/TraceRecorder.h"
+#include "Utility/StartupProfiler.h"
 
 extern "C" {
 
@@ -23,6 +27,7 @@ extern "C" {
 #include <m_imp.h>
 
 #include "Pd/Interface.h"
+#include "Pd/InstanceAccess.h"
 #include "Setup.h"
 #include "z_print_util.h"
 
@@ -30,99 +35,142 @@ EXTERN int sys_load_lib(t_canvas* canvas, char const* classname);
 
 struct pd::Instance::internal {
 
+    // Pd never frees a symbol, so we can remember which t_symbol a string resolved to and skip pd's symbol table next time
+    // Every thread gets its own table, so lookups don't need a lock. Entries keep the id of the instance they came from,
+    // since every pd instance has its own symbol table. When two strings land in the same slot, the newest one wins
+    static t_symbol* lookupSymbol(uint32 instanceId, char const* name)
+    {
+        struct Entry {
+            uint32 instanceId = 0;
+            t_symbol* symbol = nullptr;
+        };
+        static thread_local std::array<Entry, 1024> cache;
+
+        auto& entry = cache[hash(name) & (cache.size() - 1)];
+        if (entry.instanceId == instanceId && entry.symbol && !std::strcmp(entry.symbol->s_name, name))
+            return entry.symbol;
+
+        entry = { instanceId, gensym(name) };
+        return entry.symbol;
+    }
+
     static void instance_multi_bang(pd::Instance* ptr, char const* recv)
     {
-        ptr->enqueueGuiMessage({ String("bang"), String::fromUTF8(recv) });
+        ptr->enqueueGuiMessage(gensym(recv), &s_bang, 0, nullptr);
     }
 
     static void instance_multi_float(pd::Instance* ptr, char const* recv, float f)
     {
-        ptr->enqueueGuiMessage({ String("float"), String::fromUTF8(recv), std::vector<Atom>(1, { f }) });
+        t_atom atom;
+        SETFLOAT(&atom, f);
+        ptr->enqueueGuiMessage(gensym(recv), &s_float, 1, &atom);
     }
 
     static void instance_multi_symbol(pd::Instance* ptr, char const* recv, char const* sym)
     {
-        ptr->enqueueGuiMessage({ String("symbol"), String::fromUTF8(recv), std::vector<Atom>(1, ptr->generateSymbol(sym)) });
+        t_atom atom;
+        SETSYMBOL(&atom, lookupSymbol(ptr->symbolCacheId, sym));
+        ptr->enqueueGuiMessage(lookupSymbol(ptr->symbolCacheId, recv), &s_symbol, 1, &atom);
     }
 
     static void instance_multi_list(pd::Instance* ptr, char const* recv, int argc, t_atom* argv)
     {
-        Message mess { String("list"), String::fromUTF8(recv), std::vector<Atom>(argc) };
-        for (int i = 0; i < argc; ++i) {
-            if (argv[i].a_type == A_FLOAT)
-                mess.list[i] = Atom(atom_getfloat(argv + i));
-            else if (argv[i].a_type == A_SYMBOL)
-                mess.list[i] = Atom(atom_getsymbol(argv + i));
-        }
-
-        ptr->enqueueGuiMessage(mess);
+        ptr->enqueueGuiMessage(gensym(recv), &s_list, argc, argv);
     }
 
     static void instance_multi_message(pd::Instance* ptr, char const* recv, char const* msg, int argc, t_atom* argv)
     {
-        Message mess { msg, String::fromUTF8(recv), std::vector<Atom>(argc) };
-        for (int i = 0; i < argc; ++i) {
-            if (argv[i].a_type == A_FLOAT)
-                mess.list[i] = Atom(atom_getfloat(argv + i));
-            else if (argv[i].a_type == A_SYMBOL)
-                mess.list[i] = Atom(atom_getsymbol(argv + i));
-        }
-        ptr->enqueueGuiMessage(mess);
+        ptr->enqueueGuiMessage(gensym(recv), gensym(msg), argc, argv);
     }
 
     static void instance_multi_noteon(pd::Instance* ptr, int channel, int pitch, int velocity)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, pitch, velocity]() mutable {
-            ptr->receiveNoteOn(channel + 1, pitch, velocity);
-        });
+        ptr->enqueueMidiOutput({ MidiOutputEvent::NoteOn, channel + 1, pitch, velocity });
     }
 
     static void instance_multi_controlchange(pd::Instance* ptr, int channel, int controller, int value)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, controller, value]() mutable {
-            ptr->receiveControlChange(channel + 1, controller, value);
-        });
+        ptr->enqueueMidiOutput({ MidiOutputEvent::ControlChange, channel + 1, controller, value });
     }
 
     static void instance_multi_programchange(pd::Instance* ptr, int channel, int value)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, value]() mutable {
-            ptr->receiveProgramChange(channel + 1, value);
-        });
+        ptr->enqueueMidiOutput({ MidiOutputEvent::ProgramChange, channel + 1, value });
     }
 
     static void instance_multi_pitchbend(pd::Instance* ptr, int channel, int value)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, value]() mutable {
-            ptr->receivePitchBend(channel + 1, value);
-        });
+        ptr->enqueueMidiOutput({ MidiOutputEvent::PitchBend, channel + 1, value });
     }
 
     static void instance_multi_aftertouch(pd::Instance* ptr, int channel, int value)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, value]() mutable {
-            ptr->receiveAftertouch(channel + 1, value);
-        });
+        ptr->enqueueMidiOutput({ MidiOutputEvent::Aftertouch, channel + 1, value });
     }
 
     static void instance_multi_polyaftertouch(pd::Instance* ptr, int channel, int pitch, int value)
     {
-        ptr->enqueueFunctionAsync([ptr, channel, pitch, value]() mutable {
-            ptr->receivePolyAftertouch(channel + 1, pitch, value);
-        });
+        ptr->enqueueMidiOutput({ MidiOutputEvent::PolyAftertouch, channel + 1, pitch, value });
     }
 
     static void instance_multi_midibyte(pd::Instance* ptr, int port, int byte)
     {
-        ptr->enqueueFunctionAsync([ptr, port, byte]() mutable {
-            ptr->receiveMidiByte(port + 1, byte);
-        });
+        ptr->enqueueMidiOutput({ MidiOutputEvent::MidiByte, port + 1, byte });
     }
 
     static void instance_multi_print(pd::Instance* ptr, void* object, char const* s)
     {
         ptr->consoleHandler.processPrint(object, s);
     }
+
+#if ENABLE_GEM
+    // pd doesn't tell a loader which instance is loading, so we look it up from pd's current instance
+    static inline CriticalSection gemLoaderLock;
+    static inline std::unordered_map<void*, Instance*> gemLoaderInstances;
+
+    // pd calls this when it can't find a class, or when a patch declares a library
+    // Gem is only set up the first time a patch asks for it, instead of for every process that loads plugdata
+    static int load_gem_on_demand(t_canvas* canvas, char const* classname, char const* path)
+    {
+        static std::atomic<bool> loaded = false;
+        if (loaded.load())
+            return 0;
+
+        auto const name = String::fromUTF8(classname);
+        if (name != "Gem" && !name.startsWith("Gem/")) {
+            Instance* loading = nullptr;
+            {
+                ScopedLock lock(gemLoaderLock);
+                if (auto const it = gemLoaderInstances.find(libpd_this_instance()); it != gemLoaderInstances.end())
+                    loading = it->second;
+            }
+
+            if (!loading)
+                return 0;
+
+            loading->documentation->waitForInitialisationToFinish();
+            if (!loading->documentation->isGemObject(name))
+                return 0;
+        }
+
+        if (loaded.exchange(true))
+            return 0;
+
+        // Classes need to be set up on the main instance, they will be added to the other instances from there
+        auto* currentInstance = libpd_this_instance();
+        libpd_set_instance(libpd_main_instance());
+
+        set_class_prefix(gensym("Gem"));
+        class_set_extern_dir(gensym("14.gem"));
+        pd::Setup::initialiseGem(ProjectInfo::appDataDir.getChildFile("Extra").getChildFile("Gem").getFullPathName().toStdString());
+        class_set_extern_dir(gensym(""));
+        set_class_prefix(nullptr);
+        clear_class_loadsym();
+
+        libpd_set_instance(currentInstance);
+        return 1;
+    }
+#endif
 };
 }
 
@@ -130,15 +178,28 @@ namespace pd {
 
 Instance::Instance()
     : messageDispatcher(std::make_unique<MessageDispatcher>())
+    , symbolCacheId(++lastSymbolCacheId)
     , consoleHandler(this)
 {
-    pd::Setup::initialisePd();
+    {
+        StartupProfiler::Phase phase("Setup::initialisePd");
+        pd::Setup::initialisePd();
+    }
     objectImplementations = std::make_unique<::ObjectImplementationManager>(this);
 }
 
 Instance::~Instance()
 {
+#if ENABLE_GEM
+    {
+        ScopedLock lock(internal::gemLoaderLock);
+        std::erase_if(internal::gemLoaderInstances, [this](auto const& entry) { return entry.second == this; });
+    }
+#endif
+
     objectImplementations.reset(nullptr); // Make sure it gets deallocated before pd instance gets deleted
+    dspProfiler.reset(nullptr);
+    signalTaps.reset(nullptr);
     
     pd_free(static_cast<t_pd*>(messageReceiver));
     pd_free(static_cast<t_pd*>(midiReceiver));
@@ -149,28 +210,64 @@ Instance::~Instance()
     pd_free(static_cast<t_pd*>(parameterCreateReceiver));
     pd_free(static_cast<t_pd*>(parameterRangeReceiver));
     pd_free(static_cast<t_pd*>(parameterModeReceiver));
+    pd_free(static_cast<t_pd*>(parameterRampReceiver));
 
     // JYG added this
     pd_free(static_cast<t_pd*>(dataBufferReceiver));
 
+    if (patchAtoms)
+        binbuf_free(patchAtoms);
+
     libpd_set_instance(static_cast<t_pdinstance*>(instance));
     libpd_free_instance(static_cast<t_pdinstance*>(instance));
 }
 
+t_binbuf* Instance::getPatchAtoms(String const& patchText)
+{
+    if (!patchAtoms)
+        patchAtoms = binbuf_new();
+
+    if (patchText != patchAtomsText) {
+        binbuf_text(patchAtoms, patchText.toRawUTF8(), patchText.getNumBytesAsUTF8());
+        patchAtomsText = patchText;
+    }
+
+    return patchAtoms;
+}
+
+void Instance::setPatchAtoms(String const& patchText, t_binbuf* atoms)
+{
+    if (!patchAtoms)
+        patchAtoms = binbuf_new();
+
+    binbuf_clear(patchAtoms);
+    binbuf_add(patchAtoms, binbuf_getnatom(atoms), binbuf_getvec(atoms));
+    patchAtomsText = patchText;
+}
+
 // ag: Stuff to be done after unpacking the library data on first launch.
 void Instance::initialisePd(String& pdlua_version)
 {
-    instance = libpd_new_instance();
-
+    // Take a pre-created instance if there is one, creating them is slow once all libraries are loaded
+    instance = instancePool->take();
     libpd_set_instance(static_cast<t_pdinstance*>(instance));
 
+#if ENABLE_GEM
+    {
+        // Without PDINSTANCE, libpd_new_instance doesn't return the instance that libpd_this_instance does
+        ScopedLock lock(internal::gemLoaderLock);
+        internal::gemLoaderInstances[libpd_this_instance()] = this;
+    }
+#endif
+
     setup_lock(
         static_cast<void const*>(&audioLock),
         [](void* lock) {
-            static_cast<CriticalSection*>(lock)->enter();
+            TraceRecorder::Scope trace("Wait for audio lock");
+            LockProfiler::enter(*static_cast<CriticalSection*>(lock), LockProfiler::PdLock, "sys_lock", 0);
         },
         [](void* lock) {
-            static_cast<CriticalSection*>(lock)->exit();
+            LockProfiler::exit(*static_cast<CriticalSection*>(lock), LockProfiler::PdLock);
         });
 
     setup_weakreferences(
@@ -178,17 +275,15 @@ void Instance::initialisePd(String& pdlua_version)
             static_cast<pd::Instance*>(instance)->clearWeakReferences(ref);
         },
         [](void* instance, void* ref, void* weakref) {
-            auto** reference_state = reinterpret_cast<pd_weak_reference**>(weakref);
-            *reference_state = new pd_weak_reference(true);
-            static_cast<pd::Instance*>(instance)->registerWeakReference(ref, *reference_state);
+            auto** reference_state = reinterpret_cast<WeakReferenceTable::Handle**>(weakref);
+            *reference_state = new WeakReferenceTable::Handle(static_cast<pd::Instance*>(instance)->weakReferences.acquire(ref));
         },
-        [](void* instance, void* ref, void* weakref) {
-            auto** reference_state = reinterpret_cast<pd_weak_reference**>(weakref);
-            static_cast<pd::Instance*>(instance)->unregisterWeakReference(ref, *reference_state);
+        [](void*, void*, void* weakref) {
+            auto** reference_state = reinterpret_cast<WeakReferenceTable::Handle**>(weakref);
             delete *reference_state;
         },
         [](void* ref) -> int {
-            return ((pd_weak_reference*)ref)->load();
+            return static_cast<WeakReferenceTable::Handle*>(ref)->isAlive();
         });
 
     midiReceiver = pd::Setup::createMIDIHook(this, reinterpret_cast<t_plugdata_noteonhook>(internal::instance_multi_noteon), reinterpret_cast<t_plugdata_controlchangehook>(internal::instance_multi_controlchange), reinterpret_cast<t_plugdata_programchangehook>(internal::instance_multi_programchange),
@@ -220,6 +315,23 @@ void Instance::initialisePd(String& pdlua_version)
     parameterModeReceiver = pd::Setup::createReceiver(this, "param_mode", reinterpret_cast<t_plugdata_banghook>(internal::instance_multi_bang), reinterpret_cast<t_plugdata_floathook>(internal::instance_multi_float), reinterpret_cast<t_plugdata_symbolhook>(internal::instance_multi_symbol),
         reinterpret_cast<t_plugdata_listhook>(internal::instance_multi_list), reinterpret_cast<t_plugdata_messagehook>(internal::instance_multi_message));
 
+    parameterRampReceiver = pd::Setup::createReceiver(this, "param_ramp", reinterpret_cast<t_plugdata_banghook>(internal::instance_multi_bang), reinterpret_cast<t_plugdata_floathook>(internal::instance_multi_float), reinterpret_cast<t_plugdata_symbolhook>(internal::instance_multi_symbol),
+        reinterpret_cast<t_plugdata_listhook>(internal::instance_multi_list), reinterpret_cast<t_plugdata_messagehook>(internal::instance_multi_message));
+
+    guiReceivers.pd = generateSymbol("pd");
+    guiReceivers.param = generateSymbol("param");
+    guiReceivers.latencyCompensation = generateSymbol("latency_compensation");
+    guiReceivers.dataBuffer = generateSymbol("to_daw_databuffer");
+    guiReceivers.paramChange = generateSymbol("param_change");
+    guiReceivers.paramCreate = generateSymbol("param_create");
+    guiReceivers.paramRange = generateSymbol("param_range");
+    guiReceivers.paramMode = generateSymbol("param_mode");
+    guiReceivers.paramRamp = generateSymbol("param_ramp");
+
+    midiReceivers.midiIn = generateSymbol("#midiin");
+    midiReceivers.sysexIn = generateSymbol("#sysexin");
+    midiReceivers.realtimeIn = generateSymbol("#midirealtimein");
+
     // Register callback when pd's gui changes
     // Needs to be done on pd's thread
     auto gui_trigger = [](void* instance, char const* name, int argc, t_atom* argv) {
@@ -292,17 +404,23 @@ void Instance::initialisePd(String& pdlua_version)
         // Whenever a new instance is created, the functions will be copied from this one
         libpd_set_instance(libpd_main_instance());
 
-        set_class_prefix(gensym("else"));
-        class_set_extern_dir(gensym("9.else"));
-        pd::Setup::initialiseELSE();
-        set_class_prefix(gensym("cyclone"));
-        class_set_extern_dir(gensym("10.cyclone"));
-        pd::Setup::initialiseCyclone();
-
-        set_class_prefix(gensym("Gem"));
+        {
+            StartupProfiler::Phase phase("Setup::initialiseELSE");
+            set_class_prefix(gensym("else"));
+            class_set_extern_dir(gensym("9.else"));
+            pd::Setup::initialiseELSE();
+        }
+        {
+            StartupProfiler::Phase phase("Setup::initialiseCyclone");
+            set_class_prefix(gensym("cyclone"));
+            class_set_extern_dir(gensym("10.cyclone"));
+            pd::Setup::initialiseCyclone();
+        }
 
-        class_set_extern_dir(gensym("14.gem"));
-        pd::Setup::initialiseGem(ProjectInfo::appDataDir.getChildFile("Extra").getChildFile("Gem").getFullPathName().toStdString());
+#if ENABLE_GEM
+        // Gem is the largest library we ship and loads its plugins from disk, so it waits until a patch needs it
+        sys_register_loader(internal::load_gem_on_demand);
+#endif
 
         class_set_extern_dir(gensym(""));
         set_class_prefix(nullptr);
@@ -314,6 +432,7 @@ void Instance::initialisePd(String& pdlua_version)
         auto extra = ProjectInfo::appDataDir.getChildFile("Extra");
         char vers[1000];
         *vers = 0;
+        StartupProfiler::Phase phase("Setup::initialisePdLua");
         pd::Setup::initialisePdLua(extra.getFullPathName().getCharPointer(), vers, 1000, &registerLuaClass);
         if (*vers)
             pdlua_version = vers;
@@ -325,6 +444,11 @@ void Instance::initialisePd(String& pdlua_version)
     // ag: need to do this here to suppress noise from chatty externals
     printReceiver = pd::Setup::createPrintHook(this, reinterpret_cast<t_plugdata_printhook>(internal::instance_multi_print));
     libpd_set_verbose(0);
+
+    dspProfiler = std::make_unique<DSPProfiler>(this);
+    signalTaps = std::make_unique<SignalTapBus>(this);
+
+    instancePool->scheduleRefill();
 }
 
 int Instance::getBlockSize()
@@ -332,10 +456,24 @@ int Instance::getBlockSize()
     return libpd_blocksize();
 }
 
+bool Instance::hasMultipleInstances()
+{
+    return plugdata_has_multiple_instances() != 0;
+}
+
 void Instance::prepareDSP(int const nins, int const nouts, double const samplerate, int const blockSize)
 {
     libpd_set_instance(static_cast<t_pdinstance*>(instance));
     libpd_init_audio(nins, nouts, static_cast<int>(samplerate));
+    rebuildSmoother.prepare(nouts, getBlockSize());
+
+    auto const blockSeconds = getBlockSize() / std::max(1.0, samplerate);
+    functionQueueBudgetTicks = Time::secondsToHighResolutionTicks(blockSeconds * 0.25);
+}
+
+void Instance::setSmoothDSPRebuilds(bool const enabled)
+{
+    rebuildSmoother.setEnabled(enabled);
 }
 
 void Instance::startDSP()
@@ -360,7 +498,126 @@ void Instance::releaseDSP()
 void Instance::performDSP(float const* inputs, float* outputs)
 {
     libpd_set_instance(static_cast<t_pdinstance*>(instance));
+
+    // pd's lock is recursive, so holding it here doesn't get in the way of libpd taking it again
+    auto const numOutputs = rebuildSmoother.getNumChannels();
+    auto const blockSize = getBlockSize();
+    auto const getOutputChannel = [outputs, blockSize](int ch) { return outputs + ch * blockSize; };
+    auto const smoothRebuilds = rebuildSmoother.isEnabled();
+    if (smoothRebuilds && !lockForBlock(true)) {
+        rebuildSmoother.conceal(numOutputs, blockSize, getOutputChannel);
+        return;
+    }
+
+    auto const profiling = dspProfiler && dspProfiler->isEnabled();
+    auto const tapping = signalTaps && signalTaps->hasTaps();
+    if (!profiling && !tapping) {
+        // libpd takes pd's lock itself
+        audioThreadWantsLock.store(true, std::memory_order_relaxed);
+        libpd_process_raw(inputs, outputs);
+        audioThreadWantsLock.store(false, std::memory_order_relaxed);
+
+        if (smoothRebuilds) {
+            rebuildSmoother.processed(numOutputs, blockSize, getOutputChannel);
+            sys_unlock();
+        }
+        return;
+    }
+
+    audioThreadWantsLock.store(true, std::memory_order_relaxed);
+    sys_lock();
+    audioThreadWantsLock.store(false, std::memory_order_relaxed);
+    if (profiling)
+        dspProfiler->prepareChain();
+
     libpd_process_raw(inputs, outputs);
+
+    if (tapping)
+        signalTaps->process();
+    sys_unlock();
+
+    if (smoothRebuilds) {
+        rebuildSmoother.processed(numOutputs, blockSize, getOutputChannel);
+        sys_unlock();
+    }
+}
+
+// Processes numTicks pd blocks in place on a set of non-interleaved channels, starting at offset
+// This skips the intermediate interleaved buffer that libpd_process_raw needs, so the samples only get copied into pd's own adc~/dac~ buffers
+// With more than one tick, the GUI only gets polled once, so messages are handled once every numTicks blocks
+void Instance::performDSP(float* const* channels, int const numChannels, int const offset, int const numTicks)
+{
+    auto* pdInstance = static_cast<t_pdinstance*>(instance);
+    libpd_set_instance(pdInstance);
+
+    auto const blockSize = DEFDACBLKSIZE;
+    auto const numInputs = std::min(numChannels, plugdata_inchannels(pdInstance));
+    auto const numOutputs = std::min(numChannels, plugdata_outchannels(pdInstance));
+
+    auto const getChannel = [channels, offset](int ch) { return channels[ch] + offset; };
+    auto const smoothRebuilds = rebuildSmoother.isEnabled();
+    if (!lockForBlock(smoothRebuilds)) {
+        rebuildSmoother.conceal(numChannels, blockSize * numTicks, getChannel);
+        return;
+    }
+    sys_pollgui();
+
+    auto* soundIn = plugdata_soundin(pdInstance);
+    auto* soundOut = plugdata_soundout(pdInstance);
+    auto const soundOutSize = plugdata_outchannels(pdInstance) * blockSize;
+    for (int tick = 0; tick < numTicks; tick++) {
+        auto const tickOffset = offset + tick * blockSize;
+
+        for (int ch = 0; ch < numInputs; ch++) {
+            std::copy_n(channels[ch] + tickOffset, blockSize, soundIn + (ch * blockSize));
+        }
+
+        std::fill_n(soundOut, soundOutSize, 0);
+
+        if (dspProfiler && dspProfiler->isEnabled())
+            dspProfiler->prepareChain();
+
+        sched_tick();
+
+        if (signalTaps && signalTaps->hasTaps())
+            signalTaps->process();
+
+        for (int ch = 0; ch < numOutputs; ch++) {
+            std::copy_n(soundOut + (ch * blockSize), blockSize, channels[ch] + tickOffset);
+        }
+    }
+
+    sys_unlock();
+
+    // Channels that pd doesn't output to would otherwise still contain the input
+    for (int ch = numOutputs; ch < numChannels; ch++) {
+        FloatVectorOperations::clear(channels[ch] + offset, blockSize * numTicks);
+    }
+
+    if (smoothRebuilds)
+        rebuildSmoother.processed(numChannels, blockSize * numTicks, getChannel);
+}
+
+bool Instance::lockForBlock(bool const smoothRebuilds)
+{
+    if (smoothRebuilds && rebuildSmoother.isRebuilding())
+        return sys_trylock() == 0;
+
+    audioThreadWantsLock.store(true, std::memory_order_relaxed);
+    sys_lock();
+    audioThreadWantsLock.store(false, std::memory_order_relaxed);
+    return true;
+}
+
+// Advances pd's scheduler by one block without running the DSP chain, so clocks and messages keep going at almost no cost
+void Instance::advanceClocks()
+{
+    libpd_set_instance(static_cast<t_pdinstance*>(instance));
+
+    sys_lock();
+    sys_pollgui();
+    plugdata_tick_without_dsp(static_cast<t_pdinstance*>(instance));
+    sys_unlock();
 }
 
 void Instance::sendNoteOn(int const channel, int const pitch, int const velocity) const
@@ -405,6 +662,16 @@ void Instance::sendSysEx(int const port, int const byte) const
     libpd_sysex(port, byte);
 }
 
+// A whole sysex message under one lock, instead of taking it for every byte
+void Instance::sendSysEx(int const port, uint8 const* data, int const size) const
+{
+    libpd_set_instance(static_cast<t_pdinstance*>(instance));
+    sys_lock();
+    for (int i = 0; i < size; i++)
+        libpd_sysex(port, data[i]);
+    sys_unlock();
+}
+
 void Instance::sendSysRealTime(int const port, int const byte) const
 {
     libpd_set_instance(static_cast<t_pdinstance*>(instance));
@@ -417,6 +684,21 @@ void Instance::sendMidiByte(int const port, int const byte) const
     libpd_midibyte(port, byte);
 }
 
+bool Instance::hasMidiByteListeners() const
+{
+    return midiReceivers.midiIn && midiReceivers.midiIn->s_thing;
+}
+
+bool Instance::hasSysExListeners() const
+{
+    return midiReceivers.sysexIn && midiReceivers.sysexIn->s_thing;
+}
+
+bool Instance::hasSysRealTimeListeners() const
+{
+    return midiReceivers.realtimeIn && midiReceivers.realtimeIn->s_thing;
+}
+
 void Instance::sendBang(char const* receiver) const
 {
     if (!ProjectInfo::isStandalone && !instance)
@@ -436,6 +718,20 @@ void Instance::sendFloat(char const* receiver, float const value) const
     libpd_float(receiver, value);
 }
 
+void Instance::sendFloat(t_symbol* receiver, float const value) const
+{
+    if (!instance || !receiver)
+        return;
+
+    libpd_set_instance(static_cast<t_pdinstance*>(instance));
+
+    sys_lock();
+    if (auto* target = receiver->s_thing) {
+        pd_float(target, value);
+    }
+    sys_unlock();
+}
+
 void Instance::sendSymbol(char const* receiver, char const* symbol) const
 {
     if (!ProjectInfo::isStandalone && !instance)
@@ -445,6 +741,24 @@ void Instance::sendSymbol(char const* receiver, char const* symbol) const
     libpd_symbol(receiver, symbol);
 }
 
+// Sends "<target> <samples>" without looking anything up, for [param~]
+void Instance::sendFloatRamp(t_symbol* receiver, float const target, int const numSamples) const
+{
+    if (!instance || !receiver)
+        return;
+
+    libpd_set_instance(static_cast<t_pdinstance*>(instance));
+
+    sys_lock();
+    if (auto* thing = receiver->s_thing) {
+        t_atom args[2];
+        SETFLOAT(args, target);
+        SETFLOAT(args + 1, static_cast<t_float>(numSamples));
+        pd_list(thing, &s_list, 2, args);
+    }
+    sys_unlock();
+}
+
 void Instance::sendList(char const* receiver, std::vector<Atom> const& list) const
 {
     auto argv = std::vector<t_atom>(list.size());
@@ -482,196 +796,310 @@ void Instance::sendMessage(char const* receiver, char const* msg, std::vector<At
     sendTypedMessage(generateSymbol(receiver)->s_thing, msg, list);
 }
 
-void Instance::processSend(dmessage mess)
+void Instance::deliverDirectMessage(t_pd* object, t_symbol* selector, Atom const* atoms, int numAtoms)
 {
-    if (auto obj = mess.object.get<t_pd>()) {
-        if (mess.selector == "list") {
-            auto argv = std::vector<t_atom>(mess.list.size());
-            for (size_t i = 0; i < mess.list.size(); ++i) {
-                if (mess.list[i].isFloat())
-                    SETFLOAT(argv.data() + i, mess.list[i].getFloat());
-                else if (mess.list[i].isSymbol()) {
-                    SETSYMBOL(argv.data() + i, mess.list[i].getSymbol());
-                } else
-                    SETFLOAT(argv.data() + i, 0.0);
-            }
-            pd_list(obj.get(), generateSymbol("list"), static_cast<int>(mess.list.size()), argv.data());
-        } else if (mess.selector == "float" && !mess.list.empty() && mess.list[0].isFloat()) {
-            pd_float(obj.get(), mess.list[0].getFloat());
-        } else if (mess.selector == "symbol" && !mess.list.empty() && mess.list[0].isSymbol()) {
-            pd_symbol(obj.get(), mess.list[0].getSymbol());
-        } else {
-            sendTypedMessage(obj.get(), mess.selector.toRawUTF8(), mess.list);
-        }
+    if (selector == &s_float && numAtoms > 0 && atoms[0].isFloat()) {
+        pd_float(object, atoms[0].getFloat());
+        return;
+    }
+    if (selector == &s_symbol && numAtoms > 0 && atoms[0].isSymbol()) {
+        pd_symbol(object, atoms[0].getSymbol());
+        return;
+    }
+
+    // Short messages, which is nearly all of them, are converted on the stack
+    t_atom stackAtoms[DirectMessageQueue::maxAtoms];
+    std::vector<t_atom> heapAtoms;
+    auto* argv = stackAtoms;
+    if (numAtoms > DirectMessageQueue::maxAtoms) {
+        heapAtoms.resize(numAtoms);
+        argv = heapAtoms.data();
+    }
+
+    for (int i = 0; i < numAtoms; ++i) {
+        if (atoms[i].isSymbol())
+            SETSYMBOL(argv + i, atoms[i].getSymbol());
+        else
+            SETFLOAT(argv + i, atoms[i].getFloat());
+    }
+
+    if (selector == &s_list) {
+        pd_list(object, &s_list, numAtoms, argv);
     } else {
-        sendMessage(mess.destination.toRawUTF8(), mess.selector.toRawUTF8(), mess.list);
+        pd_typedmess(object, selector, numAtoms, argv);
     }
 }
 
-void Instance::registerMessageListener(void* object, MessageListener* messageListener)
+int Instance::processDirectMessages()
 {
-    messageDispatcher->addMessageListener(object, messageListener);
+    int numMessages = 0;
+    directMessageQueue.drain([&numMessages](DirectMessageQueue::Slot const& slot) {
+        if (auto* obj = slot.object->getRaw<t_pd>()) {
+            deliverDirectMessage(obj, slot.selector, slot.atoms, slot.numAtoms);
+            numMessages++;
+        }
+    });
+    return numMessages;
 }
 
-void Instance::unregisterMessageListener(void* object, MessageListener* messageListener)
+void Instance::enqueueDirectMessage(void* object, t_symbol* selector, Atom const* atoms, int numAtoms)
 {
-    messageDispatcher->removeMessageListener(object, messageListener);
+    // The audio thread drains the queue at the start of every block. If it hasn't done so recently, audio isn't running,
+    // so there is nothing to contend with and we deliver right away
+    auto const audioThreadIsDraining = Time::getMillisecondCounter() - lastAudioThreadDrain.load(std::memory_order_relaxed) < 100;
+    if (audioThreadIsDraining && directMessageQueue.push(this, object, selector, atoms, numAtoms))
+        return;
+
+    // Queue full or message too long: fall back to delivering under the lock, after anything that was queued before it
+    auto const ref = WeakReference(object, this);
+    lockAudioThread();
+    setThis();
+    processDirectMessages();
+    if (auto* obj = ref.getRaw<t_pd>()) {
+        deliverDirectMessage(obj, selector, atoms, numAtoms);
+    }
+    unlockAudioThread();
 }
 
-void Instance::registerWeakReference(void* ptr, pd_weak_reference* ref)
+void Instance::registerMessageListener(void* object, MessageListener* messageListener, bool receiveEveryMessage)
 {
-    weakReferenceMutex.lock();
-    pdWeakReferences[ptr].push_back(ref);
-    weakReferenceMutex.unlock();
+    messageDispatcher->addMessageListener(object, messageListener, receiveEveryMessage);
 }
 
-void Instance::unregisterWeakReference(void* ptr, pd_weak_reference const* ref)
+void Instance::unregisterMessageListener(void* object, MessageListener* messageListener)
 {
-    weakReferenceMutex.lock();
+    messageDispatcher->removeMessageListener(object, messageListener);
+}
 
-    auto& refs = pdWeakReferences[ptr];
+void Instance::clearWeakReferences(void* ptr)
+{
+    weakReferences.clear(ptr);
+}
 
-    auto it = std::find(refs.begin(), refs.end(), ref);
+void Instance::enqueueFunctionAsync(std::function<void(void)> const& fn)
+{
+    functionQueue.enqueue(fn);
+    numQueuedFunctions.fetch_add(1, std::memory_order_release);
+}
 
-    if (it != refs.end()) {
-        pdWeakReferences[ptr].erase(it);
+void Instance::enqueueFunctionAtBlockBoundary(std::function<void(void)> const& fn)
+{
+    auto const audioThreadIsDraining = Time::getMillisecondCounter() - lastAudioThreadDrain.load(std::memory_order_relaxed) < 100;
+    if (audioThreadIsDraining) {
+        enqueueFunctionAsync(fn);
+        return;
     }
 
-    weakReferenceMutex.unlock();
+    // Run anything that was queued before it first, to keep the order
+    lockAudioThread();
+    setThis();
+    runQueuedFunctions();
+    fn();
+    unlockAudioThread();
 }
 
-void Instance::clearWeakReferences(void* ptr)
+int Instance::runQueuedFunctions(int64 const deadlineTicks)
 {
-    weakReferenceMutex.lock();
-    for (auto* ref : pdWeakReferences[ptr]) {
-        *ref = false;
+    int numFunctions = 0;
+    while (numQueuedFunctions.load(std::memory_order_acquire) > 0) {
+        auto const numDequeued = static_cast<int>(functionQueue.try_dequeue_bulk(functionBatch.get(), functionBatchSize));
+        if (numDequeued == 0)
+            break; // Counted, but not visible in the queue yet, we'll get it next time
+
+        numQueuedFunctions.fetch_sub(numDequeued, std::memory_order_acq_rel);
+
+        // Once they're out of the queue, they have to run now, or they'd end up behind newer ones
+        for (int i = 0; i < numDequeued; i++) {
+            functionBatch[i]();
+            functionBatch[i] = nullptr;
+        }
+        numFunctions += numDequeued;
+
+        if (Time::getHighResolutionTicks() >= deadlineTicks)
+            break;
     }
-    pdWeakReferences.erase(ptr);
-    weakReferenceMutex.unlock();
-}
 
-void Instance::enqueueFunctionAsync(std::function<void(void)> const& fn)
-{
-    functionQueue.enqueue(fn);
+    return numFunctions;
 }
 
-void Instance::enqueueGuiMessage(Message const& message)
+// Called from pd's thread, which is usually the audio thread
+// Nothing is allocated here unless the ring overflows or the message has too many atoms to fit in a record
+void Instance::enqueueGuiMessage(t_symbol* destination, t_symbol* selector, int argc, t_atom* argv)
 {
+    GuiMessage message;
+    message.destination = destination;
+    message.selector = selector;
+    message.numAtoms = argc;
+
+    if (argc <= GuiMessage::maxAtoms) {
+        for (int i = 0; i < argc; ++i) {
+            message.atoms[i] = argv[i].a_type == A_SYMBOL ? Atom(atom_getsymbol(argv + i)) : Atom(atom_getfloat(argv + i));
+        }
+    } else {
+        guiMessageOverflow.enqueue(Atom::fromAtoms(argc, argv));
+    }
+
     guiMessageQueue.enqueue(message);
-    triggerAsyncUpdate();
+
+    // Only wake up the message thread once for everything that gets queued before it runs
+    if (!guiMessagesPending.exchange(true, std::memory_order_acq_rel))
+        triggerAsyncUpdate();
 }
 
 void Instance::sendDirectMessage(void* object, String const& msg, std::vector<Atom>&& list)
 {
-    lockAudioThread();
-    processSend(dmessage(this, object, String(), msg, std::move(list)));
-    unlockAudioThread();
+    enqueueDirectMessage(object, generateSymbol(msg), list.data(), static_cast<int>(list.size()));
 }
 
 void Instance::sendDirectMessage(void* object, std::vector<Atom>&& list)
 {
-    lockAudioThread();
-    processSend(dmessage(this, object, String(), "list", std::move(list)));
-    unlockAudioThread();
+    enqueueDirectMessage(object, generateSymbol("list"), list.data(), static_cast<int>(list.size()));
 }
 
 void Instance::sendDirectMessage(void* object, String const& msg)
 {
-
-    lockAudioThread();
-    processSend(dmessage(this, object, String(), "symbol", std::vector<Atom>(1, generateSymbol(msg))));
-    unlockAudioThread();
+    auto const atom = Atom(generateSymbol(msg));
+    enqueueDirectMessage(object, generateSymbol("symbol"), &atom, 1);
 }
 
 void Instance::sendDirectMessage(void* object, float const msg)
 {
-    lockAudioThread();
-    processSend(dmessage(this, object, String(), "float", std::vector<Atom>(1, msg)));
-    unlockAudioThread();
+    auto const atom = Atom(msg);
+    enqueueDirectMessage(object, generateSymbol("float"), &atom, 1);
 }
 
 void Instance::handleAsyncUpdate()
 {
-    Message mess;
+    TraceRecorder::Scope trace("Instance::handleAsyncUpdate");
+    int numMessages = 0;
+
+    // Clear this before draining, so anything queued while we're busy will trigger another update
+    guiMessagesPending.store(false, std::memory_order_release);
+
+    GuiMessage mess;
+    std::vector<Atom> overflowList;
     while (guiMessageQueue.try_dequeue(mess)) {
-        auto const dest = hash(mess.destination);
+        numMessages++;
+        auto const* list = mess.atoms;
+        auto const size = mess.numAtoms;
+
+        if (size > GuiMessage::maxAtoms) {
+            if (!guiMessageOverflow.try_dequeue(overflowList))
+                continue;
+            list = overflowList.data();
+        }
 
-        switch (dest) {
-        case hash("pd"):
-            receiveSysMessage(mess.selector, mess.list);
-            break;
-        case hash("latency_compensation"):
-            if (mess.list.size() == 1) {
-                if (!mess.list[0].isFloat())
-                    return;
-                performLatencyCompensationChange(mess.list[0].getFloat());
+        auto const* dest = mess.destination;
+        if (dest == guiReceivers.pd) {
+            receiveSysMessage(String::fromUTF8(mess.selector->s_name), std::vector<Atom>(list, list + size));
+        } else if (dest == guiReceivers.latencyCompensation) {
+            if (size == 1 && list[0].isFloat()) {
+                performLatencyCompensationChange(list[0].getFloat());
             }
-            break;
-        case hash("param"):
-            if (mess.list.size() >= 2) {
-                if (!mess.list[0].isSymbol() || !mess.list[1].isFloat())
-                    return;
-                auto name = mess.list[0].toString();
-                float value = mess.list[1].getFloat();
-                performParameterChange(0, name, value);
+        } else if (dest == guiReceivers.param) {
+            if (size >= 2 && list[0].isSymbol() && list[1].isFloat()) {
+                performParameterChange(0, list[0].toString(), list[1].getFloat());
             }
-            break;
-        case hash("param_create"):
-            if (mess.list.size() >= 1) {
-                if (!mess.list[0].isSymbol())
-                    return;
-                auto name = mess.list[0].toString();
-                enableAudioParameter(name);
+        } else if (dest == guiReceivers.paramCreate) {
+            if (size >= 1 && list[0].isSymbol()) {
+                enableAudioParameter(list[0].toString());
             }
-            break;
-        case hash("param_range"):
-            if (mess.list.size() >= 3) {
-                if (!mess.list[0].isSymbol() || !mess.list[1].isFloat() || !mess.list[2].isFloat())
-                    return;
-                auto name = mess.list[0].toString();
-                float min = mess.list[1].getFloat();
-                float max = mess.list[2].getFloat();
-                setParameterRange(name, min, max);
+        } else if (dest == guiReceivers.paramRange) {
+            if (size >= 3 && list[0].isSymbol() && list[1].isFloat() && list[2].isFloat()) {
+                setParameterRange(list[0].toString(), list[1].getFloat(), list[2].getFloat());
             }
-            break;
-        case hash("param_mode"):
-            if (mess.list.size() >= 2) {
-                if (!mess.list[0].isSymbol() || !mess.list[1].isFloat())
-                    return;
-                auto name = mess.list[0].toString();
-                float mode = mess.list[1].getFloat();
-                setParameterMode(name, mode);
+        } else if (dest == guiReceivers.paramMode) {
+            if (size >= 2 && list[0].isSymbol() && list[1].isFloat()) {
+                setParameterMode(list[0].toString(), list[1].getFloat());
             }
-            break;
-        case hash("param_change"):
-            if (mess.list.size() >= 2) {
-                if (!mess.list[0].isSymbol() || !mess.list[1].isFloat())
-                    return;
-                auto name = mess.list[0].toString();
-                int state = mess.list[1].getFloat() != 0;
-                performParameterChange(1, name, state);
+        } else if (dest == guiReceivers.paramRamp) {
+            if (size >= 1 && list[0].isSymbol()) {
+                resendAudioParameter(list[0].toString());
             }
-            break;
+        } else if (dest == guiReceivers.paramChange) {
+            if (size >= 2 && list[0].isSymbol() && list[1].isFloat()) {
+                performParameterChange(1, list[0].toString(), list[1].getFloat() != 0);
+            }
+        } else if (dest == guiReceivers.dataBuffer) {
             // JYG added this
-        case hash("to_daw_databuffer"):
-            fillDataBuffer(mess.list);
-            break;
-        default:
-            break;
+            fillDataBuffer(std::vector<Atom>(list, list + size));
         }
     }
+
+    trace.setCount(numMessages);
+}
+
+// Called from pd's hooks, which always run while holding the pd lock
+void Instance::enqueueMidiOutput(MidiOutputEvent const& event)
+{
+    if (numMidiOutputEvents < maxMidiOutputEvents) {
+        midiOutputEvents[numMidiOutputEvents++] = event;
+        midiOutputPending.store(true, std::memory_order_release);
+        return;
+    }
+
+    // Buffer is full, don't lose the event
+    enqueueFunctionAsync([this, event]() {
+        dispatchMidiOutput(event);
+    });
+}
+
+void Instance::dispatchMidiOutput(MidiOutputEvent const& event)
+{
+    switch (event.type) {
+    case MidiOutputEvent::NoteOn:
+        receiveNoteOn(event.channel, event.data1, event.data2);
+        break;
+    case MidiOutputEvent::ControlChange:
+        receiveControlChange(event.channel, event.data1, event.data2);
+        break;
+    case MidiOutputEvent::ProgramChange:
+        receiveProgramChange(event.channel, event.data1);
+        break;
+    case MidiOutputEvent::PitchBend:
+        receivePitchBend(event.channel, event.data1);
+        break;
+    case MidiOutputEvent::Aftertouch:
+        receiveAftertouch(event.channel, event.data1);
+        break;
+    case MidiOutputEvent::PolyAftertouch:
+        receivePolyAftertouch(event.channel, event.data1, event.data2);
+        break;
+    case MidiOutputEvent::MidiByte:
+        receiveMidiByte(event.channel, event.data1);
+        break;
+    }
 }
 
 void Instance::sendMessagesFromQueue()
 {
+    auto const isMessageThread = MessageManager::existsAndIsCurrentThread();
+    if (!isMessageThread)
+        lastAudioThreadDrain.store(Time::getMillisecondCounter(), std::memory_order_relaxed);
+
+    // Most blocks have nothing to deliver, then we don't need pd's lock
+    if (numQueuedFunctions.load(std::memory_order_acquire) == 0 && directMessageQueue.isEmpty() && !midiOutputPending.load(std::memory_order_acquire))
+        return;
+
+    TraceRecorder::Scope trace("sendMessagesFromQueue");
+    auto const deadline = isMessageThread ? std::numeric_limits<int64>::max() : Time::getHighResolutionTicks() + functionQueueBudgetTicks.load(std::memory_order_relaxed);
+
     libpd_set_instance(static_cast<t_pdinstance*>(instance));
 
     sys_lock();
-    std::function<void(void)> callback;
-    while (functionQueue.try_dequeue(callback)) {
-        callback();
+    auto numMessages = processDirectMessages() + numMidiOutputEvents;
+
+    // MIDI out that pd produced during the last block, in the order it was produced
+    midiOutputPending.store(false, std::memory_order_relaxed);
+    for (int i = 0; i < numMidiOutputEvents; i++) {
+        dispatchMidiOutput(midiOutputEvents[i]);
     }
+    numMidiOutputEvents = 0;
+
+    numMessages += runQueuedFunctions(deadline);
     sys_unlock();
+
+    trace.setCount(numMessages);
 }
 
 Patch::Ptr Instance::openPatch(File const& toOpen)
@@ -697,7 +1125,7 @@ void Instance::setThis() const
 t_symbol* Instance::generateSymbol(char const* symbol) const
 {
     setThis();
-    return gensym(symbol);
+    return internal::lookupSymbol(symbolCacheId, symbol);
 }
 
 t_symbol* Instance::generateSymbol(String const& symbol) const
@@ -720,16 +1148,11 @@ void Instance::logWarning(String const& warning)
     consoleHandler.logWarning(nullptr, warning);
 }
 
-std::deque<std::tuple<void*, String, int, int, int>>& Instance::getConsoleMessages()
+ConsoleStore& Instance::getConsoleMessages()
 {
     return consoleHandler.consoleMessages;
 }
 
-std::deque<std::tuple<void*, String, int, int, int>>& Instance::getConsoleHistory()
-{
-    return consoleHandler.consoleHistory;
-}
-
 void Instance::createPanel(int type, char const* snd, char const* location, char const* callbackName, int openMode)
 {
     auto* obj = generateSymbol(snd)->s_thing;
@@ -815,14 +1238,16 @@ bool Instance::loadLibrary(String const& libraryToLoad)
     return sys_load_lib(nullptr, libraryToLoad.toRawUTF8());
 }
 
-void Instance::lockAudioThread()
+void Instance::lockAudioThread(std::source_location const& location)
 {
-    audioLock.enter();
+    TraceRecorder::Scope trace("Wait for audio lock");
+    LockProfiler::enter(audioLock, LockProfiler::PdLock, location);
 }
 
-bool Instance::tryLockAudioThread()
+bool Instance::tryLockAudioThread(std::source_location const& location)
 {
     if (audioLock.tryEnter()) {
+        LockProfiler::acquired(LockProfiler::PdLock, location.function_name(), static_cast<int>(location.line()));
         return true;
     }
 
@@ -831,12 +1256,12 @@ bool Instance::tryLockAudioThread()
 
 void Instance::unlockAudioThread()
 {
-    audioLock.exit();
+    LockProfiler::exit(audioLock, LockProfiler::PdLock);
 }
 
-void Instance::updateObjectImplementations()
+void Instance::updateObjectImplementations(t_canvas* changedPatch)
 {
-    objectImplementations->updateObjectImplementations();
+    objectImplementations->updateObjectImplementations(changedPatch);
 }
 
 void Instance::clearObjectImplementationsForPatch(pd::Patch* p)
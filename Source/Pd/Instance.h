@@ -11,9 +11,18 @@ extern "C" {
 #include <s_inter.h>
 }
 
+#include <optional>
 #include <concurrentqueue.h>
 #include <readerwriterqueue.h>
+#include "Utility/Config.h"
 #include "Utility/CachedStringWidth.h"
+#include "Utility/LogRing.h"
+#include "Utility/LockProfiler.h"
+#include "Utility/DSPRebuildSmoother.h"
+#include "ConsoleStore.h"
+#include "DSPProfiler.h"
+#include "InstancePool.h"
+#include "SignalTapBus.h"
 #include "Patch.h"
 
 class ObjectImplementationManager;
@@ -134,27 +143,97 @@ private:
 class MessageListener;
 class MessageDispatcher;
 class Patch;
+class DocumentationDatabase;
 class Instance : public AsyncUpdater {
-    struct Message {
-        String selector;
-        String destination;
-        std::vector<pd::Atom> list;
+    struct MidiOutputEvent {
+        enum Type : uint8 {
+            NoteOn,
+            ControlChange,
+            ProgramChange,
+            PitchBend,
+            Aftertouch,
+            PolyAftertouch,
+            MidiByte
+        };
+
+        Type type;
+        int channel; // Port, for MidiByte
+        int data1 = 0;
+        int data2 = 0;
     };
 
-    struct dmessage {
+    // Fixed-size record for messages from pd to plugdata's receivers, so queueing them doesn't allocate
+    // Lists that don't fit are passed through guiMessageOverflow
+    struct GuiMessage {
+        static constexpr int maxAtoms = 16;
 
-        dmessage(pd::Instance* instance, void* ref, String dest, String sel, std::vector<pd::Atom> atoms)
-            : object(ref, instance)
-            , destination(dest)
-            , selector(sel)
-            , list(std::move(atoms))
+        t_symbol* destination = nullptr;
+        t_symbol* selector = nullptr;
+        int numAtoms = 0;
+        Atom atoms[maxAtoms];
+    };
+
+    // Single-consumer ring that carries direct messages from the GUI to pd, drained by the audio thread at the start of each block
+    // Slots are only constructed and destroyed by producers, so looking up weak reference slots never happens on the audio thread
+    struct DirectMessageQueue {
+        static constexpr int capacity = 512;
+        static constexpr int maxAtoms = 16;
+
+        struct Slot {
+            std::optional<WeakReference> object;
+            t_symbol* selector = nullptr;
+            int numAtoms = 0;
+            Atom atoms[maxAtoms];
+        };
+
+        // Returns false if the message doesn't fit, in which case the caller has to deliver it some other way
+        bool push(Instance* instance, void* object, t_symbol* selector, Atom const* atoms, int numAtoms)
+        {
+            if (numAtoms > maxAtoms)
+                return false;
+
+            SpinLock::ScopedLockType lock(producerLock);
+
+            auto const write = writeIndex.load(std::memory_order_relaxed);
+            if (write - readIndex.load(std::memory_order_acquire) >= capacity)
+                return false;
+
+            auto& slot = slots[write % capacity];
+            slot.object.reset();
+            slot.object.emplace(object, instance);
+            slot.selector = selector;
+            slot.numAtoms = numAtoms;
+            std::copy(atoms, atoms + numAtoms, slot.atoms);
+
+            writeIndex.store(write + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Can be called without the lock, a message that's being pushed right now may not be seen yet
+        bool isEmpty() const
         {
+            return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
         }
 
-        WeakReference object;
-        String destination;
-        String selector;
-        std::vector<pd::Atom> list;
+        // Must be called while holding the audio lock, which makes the lock holder the only consumer
+        template<typename Callback>
+        void drain(Callback const& callback)
+        {
+            auto read = readIndex.load(std::memory_order_relaxed);
+            auto const write = writeIndex.load(std::memory_order_acquire);
+
+            for (; read != write; read++) {
+                callback(slots[read % capacity]);
+            }
+
+            readIndex.store(read, std::memory_order_release);
+        }
+
+    private:
+        std::unique_ptr<Slot[]> slots = std::make_unique<Slot[]>(capacity);
+        std::atomic<uint32> writeIndex = 0;
+        std::atomic<uint32> readIndex = 0;
+        SpinLock producerLock;
     };
 
 public:
@@ -167,8 +246,16 @@ public:
     void startDSP();
     void releaseDSP();
     void performDSP(float const* inputs, float* outputs);
+    void performDSP(float* const* channels, int numChannels, int offset, int numTicks = 1);
+    void advanceClocks();
     static int getBlockSize();
 
+    // Whether the pd we're linked with was built with PDINSTANCE, without it all Instances share pd's global state
+    static bool hasMultipleInstances();
+
+    // Instead of waiting for pd to finish rebuilding the DSP chain, fade out and back in around it
+    void setSmoothDSPRebuilds(bool enabled);
+
     void handleAsyncUpdate() override;
 
     void sendNoteOn(int channel, int pitch, int velocity) const;
@@ -178,9 +265,16 @@ public:
     void sendAfterTouch(int channel, int value) const;
     void sendPolyAfterTouch(int channel, int pitch, int value) const;
     void sendSysEx(int port, int byte) const;
+    void sendSysEx(int port, uint8 const* data, int size) const;
     void sendSysRealTime(int port, int byte) const;
     void sendMidiByte(int port, int byte) const;
 
+    // pd only passes raw, sysex and realtime MIDI on to objects that are listening, but it has to be handed every byte first
+    // With these we can skip the bytes when there's no [midiin], [sysexin] or [midirealtimein] anywhere
+    bool hasMidiByteListeners() const;
+    bool hasSysExListeners() const;
+    bool hasSysRealTimeListeners() const;
+
     virtual void receiveNoteOn(int channel, int pitch, int velocity) = 0;
     virtual void receiveControlChange(int channel, int controller, int value) = 0;
     virtual void receiveProgramChange(int channel, int value) = 0;
@@ -193,6 +287,8 @@ public:
 
     void sendBang(char const* receiver) const;
     void sendFloat(char const* receiver, float value) const;
+    void sendFloat(t_symbol* receiver, float value) const;
+    void sendFloatRamp(t_symbol* receiver, float target, int numSamples) const;
     void sendSymbol(char const* receiver, char const* symbol) const;
     void sendList(char const* receiver, std::vector<pd::Atom> const& list) const;
     void sendMessage(char const* receiver, char const* msg, std::vector<pd::Atom> const& list) const;
@@ -203,11 +299,10 @@ public:
 
     virtual void receiveSysMessage(String const& selector, std::vector<pd::Atom> const& list) {};
 
-    void registerMessageListener(void* object, MessageListener* messageListener);
+    // Listeners normally get the latest message for each selector once per frame, set receiveEveryMessage if they can't miss any
+    void registerMessageListener(void* object, MessageListener* messageListener, bool receiveEveryMessage = false);
     void unregisterMessageListener(void* object, MessageListener* messageListener);
 
-    void registerWeakReference(void* ptr, pd_weak_reference* ref);
-    void unregisterWeakReference(void* ptr, pd_weak_reference const* ref);
     void clearWeakReferences(void* ptr);
 
     static void registerLuaClass(char const* object);
@@ -219,7 +314,11 @@ public:
 
     void enqueueFunctionAsync(std::function<void(void)> const& fn);
 
-    void enqueueGuiMessage(Message const& fn);
+    // Runs fn while holding the pd lock in between two blocks, without making the caller wait for the audio thread
+    // If audio isn't running, nothing would pick it up, so then it runs right away under the lock
+    void enqueueFunctionAtBlockBoundary(std::function<void(void)> const& fn);
+
+    void enqueueGuiMessage(t_symbol* destination, t_symbol* selector, int argc, t_atom* argv);
 
     // Enqueue a message to an pd::WeakReference
     // This will first check if the weakreference is valid before triggering the callback
@@ -231,6 +330,7 @@ public:
                 fn(obj.get());
             }
         });
+        numQueuedFunctions.fetch_add(1, std::memory_order_release);
     }
 
     void sendDirectMessage(void* object, String const& msg, std::vector<Atom>&& list);
@@ -238,11 +338,15 @@ public:
     void sendDirectMessage(void* object, String const& msg);
     void sendDirectMessage(void* object, float msg);
 
-    void updateObjectImplementations();
+    // Pass the patch that changed, so only that patch gets searched for new objects
+    // Without a patch, everything is searched again, that's also what we do when a canvas is opened or closed
+    void updateObjectImplementations(t_canvas* changedPatch = nullptr);
     void clearObjectImplementationsForPatch(pd::Patch* p);
+    ObjectImplementationManager& getObjectImplementations() const { return *objectImplementations; }
 
     virtual void performParameterChange(int type, String const& name, float value) = 0;
     virtual void enableAudioParameter(String const& name) = 0;
+    virtual void resendAudioParameter(String const& name) = 0;
     virtual void setParameterRange(String const& name, float min, float max) = 0;
     virtual void setParameterMode(String const& name, int mode) = 0;
 
@@ -256,11 +360,21 @@ public:
     void logError(String const& message);
     void logWarning(String const& message);
 
-    std::deque<std::tuple<void*, String, int, int, int>>& getConsoleMessages();
-    std::deque<std::tuple<void*, String, int, int, int>>& getConsoleHistory();
+    ConsoleStore& getConsoleMessages();
 
+    // The patch text that was last copied or pasted, kept as atoms
+    // Pasting the same text again, like the clipboard or a palette item, reuses them instead of parsing the text again
+    // Only call these while holding pd's lock
+    t_binbuf* getPatchAtoms(String const& patchText);
+    void setPatchAtoms(String const& patchText, t_binbuf* atoms);
+
+    // On the message thread, this runs everything that's queued. Other threads run queued functions for a limited time,
+    // a quarter of a pd block, and leave the rest for the next block, so a burst of messages can't make audio miss its deadline
     void sendMessagesFromQueue();
-    void processSend(dmessage mess);
+
+    // Approximate, for metrics
+    size_t getNumQueuedFunctions() const { return numQueuedFunctions.load(std::memory_order_relaxed); }
+    size_t getNumQueuedGuiMessages() const { return guiMessageQueue.size_approx(); }
 
     Patch::Ptr openPatch(File const& toOpen);
 
@@ -270,8 +384,9 @@ public:
     t_symbol* generateSymbol(String const& symbol) const;
     t_symbol* generateSymbol(char const* symbol) const;
 
-    void lockAudioThread();
-    bool tryLockAudioThread();
+    // The location is only used to see who holds the lock, when lock profiling is on
+    void lockAudioThread(std::source_location const& location = std::source_location::current());
+    bool tryLockAudioThread(std::source_location const& location = std::source_location::current());
     void unlockAudioThread();
 
     bool loadLibrary(String const& library);
@@ -284,6 +399,7 @@ public:
     void* parameterCreateReceiver = nullptr;
     void* parameterRangeReceiver = nullptr;
     void* parameterModeReceiver = nullptr;
+    void* parameterRampReceiver = nullptr;
     void* midiReceiver = nullptr;
     void* printReceiver = nullptr;
     void* dataBufferReceiver = nullptr;
@@ -292,17 +408,79 @@ public:
 
     bool isPerformingGlobalSync = false;
     CriticalSection const audioLock;
-    std::recursive_mutex weakReferenceMutex;
+    WeakReferenceTable weakReferences;
+
+    // Set while the audio thread is waiting on pd's lock, so a WeakReference::BatchLock knows when to let go
+    std::atomic<bool> audioThreadWantsLock = false;
+    DSPRebuildSmoother rebuildSmoother;
     std::unique_ptr<pd::MessageDispatcher> messageDispatcher;
+    SharedResourcePointer<pd::InstancePool> instancePool;
+#if ENABLE_GEM
+    // Tells the Gem loader which classes belong to Gem
+    SharedResourcePointer<pd::DocumentationDatabase> documentation;
+#endif
+    std::unique_ptr<pd::DSPProfiler> dspProfiler;
+    std::unique_ptr<pd::SignalTapBus> signalTaps;
 
     // All opened patches
     Array<pd::Patch::Ptr, CriticalSection> patches;
 
 private:
-    std::unordered_map<void*, std::vector<pd_weak_reference*>> pdWeakReferences;
-
     moodycamel::ConcurrentQueue<std::function<void(void)>> functionQueue = moodycamel::ConcurrentQueue<std::function<void(void)>>(4096);
-    moodycamel::ConcurrentQueue<Message> guiMessageQueue = moodycamel::ConcurrentQueue<Message>(64);
+
+    // Counted after every enqueue, so finding nothing to do doesn't need pd's lock
+    std::atomic<int> numQueuedFunctions = 0;
+
+    // Functions are taken out of the queue in batches, into an array that's only used while holding pd's lock
+    static constexpr int functionBatchSize = 32;
+    std::unique_ptr<std::function<void(void)>[]> functionBatch = std::make_unique<std::function<void(void)>[]>(functionBatchSize);
+    std::atomic<int64> functionQueueBudgetTicks = 0;
+
+    // Runs queued functions until the queue is empty or the deadline has passed, must hold pd's lock
+    int runQueuedFunctions(int64 deadlineTicks = std::numeric_limits<int64>::max());
+
+    // Takes pd's lock for a block of audio. Returns false without the lock if the DSP chain is being rebuilt and we should skip the block instead
+    bool lockForBlock(bool smoothRebuilds);
+    moodycamel::ReaderWriterQueue<GuiMessage> guiMessageQueue = moodycamel::ReaderWriterQueue<GuiMessage>(512);
+    moodycamel::ReaderWriterQueue<std::vector<Atom>> guiMessageOverflow = moodycamel::ReaderWriterQueue<std::vector<Atom>>(8);
+    std::atomic<bool> guiMessagesPending = false;
+
+    String patchAtomsText;
+    t_binbuf* patchAtoms = nullptr;
+
+    void enqueueMidiOutput(MidiOutputEvent const& event);
+    void dispatchMidiOutput(MidiOutputEvent const& event);
+
+    // Only touched while holding the pd lock, except for the flag
+    static constexpr int maxMidiOutputEvents = 4096;
+    std::atomic<bool> midiOutputPending = false;
+    std::unique_ptr<MidiOutputEvent[]> midiOutputEvents = std::make_unique<MidiOutputEvent[]>(maxMidiOutputEvents);
+    int numMidiOutputEvents = 0;
+
+    struct {
+        t_symbol* pd = nullptr;
+        t_symbol* param = nullptr;
+        t_symbol* latencyCompensation = nullptr;
+        t_symbol* dataBuffer = nullptr;
+        t_symbol* paramChange = nullptr;
+        t_symbol* paramCreate = nullptr;
+        t_symbol* paramRange = nullptr;
+        t_symbol* paramMode = nullptr;
+        t_symbol* paramRamp = nullptr;
+    } guiReceivers;
+
+    struct {
+        t_symbol* midiIn = nullptr;
+        t_symbol* sysexIn = nullptr;
+        t_symbol* realtimeIn = nullptr;
+    } midiReceivers;
+
+    void enqueueDirectMessage(void* object, t_symbol* selector, Atom const* atoms, int numAtoms);
+    int processDirectMessages(); // Returns how many messages were delivered
+    static void deliverDirectMessage(t_pd* object, t_symbol* selector, Atom const* atoms, int numAtoms);
+
+    DirectMessageQueue directMessageQueue;
+    std::atomic<uint32> lastAudioThreadDrain = 0;
 
     std::unique_ptr<FileChooser> openChooser;
     static inline std::set<hash32> luaClasses = std::set<hash32>(); // Keep track of class names that correspond to pdlua objects
@@ -310,6 +488,10 @@ private:
 protected:
     struct internal;
 
+    // Tells apart the instances in the per-thread symbol cache, ids are never reused so a new instance can't see symbols from an old one
+    uint32 const symbolCacheId;
+    static inline std::atomic<uint32> lastSymbolCacheId = 0;
+
     std::unique_ptr<ObjectImplementationManager> objectImplementations;
 
     struct ConsoleHandler : public AsyncUpdater {
@@ -322,10 +504,56 @@ protected:
 
         void handleAsyncUpdate() override
         {
+            printWakeupPending.store(false, std::memory_order_release);
+
             auto item = std::tuple<void*, String, bool>();
             int numReceived = 0;
             bool newWarning = false;
 
+            // Output from pd's print hook, strings only get created here
+            printRing.read([this, &numReceived, &newWarning](LogRing::Header const& header, char const* text) {
+                switch (header.type) {
+                case LogRing::Line: {
+                    auto message = String::fromUTF8(text, static_cast<int>(header.size));
+                    bool isError = false;
+                    if (message.startsWith("error")) {
+                        message = message.substring(7);
+                        isError = true;
+                    } else if (message.startsWith("verbose(0):") || message.startsWith("verbose(1):")) {
+                        message = message.substring(12);
+                        isError = true;
+                    } else if (message.startsWith("verbose(")) {
+                        message = message.substring(12);
+                    }
+                    addMessage(header.object, message, isError);
+                    newWarning = newWarning || isError;
+
+                    lastRingLine = { header.object, message, isError };
+                    lastRingLineEnd = consoleMessages.getEnd();
+                    numRingLinesRead++;
+                    break;
+                }
+                case LogRing::Repeat:
+                    addRingRepeats(static_cast<int>(header.size));
+                    break;
+                case LogRing::Suppressed:
+                    addMessage(header.object, String(header.size) + " messages suppressed, printing too fast", true);
+                    newWarning = true;
+                    break;
+                }
+                numReceived++;
+            });
+
+            // Repeats of the last line we read that pushLine is still counting
+            auto pending = pendingRepeats.load(std::memory_order_acquire);
+            while (static_cast<uint32>(pending) > 0 && static_cast<uint32>(pending >> 32) == numRingLinesRead) {
+                if (pendingRepeats.compare_exchange_weak(pending, static_cast<uint64>(numRingLinesRead) << 32, std::memory_order_acq_rel)) {
+                    addRingRepeats(static_cast<int>(static_cast<uint32>(pending)));
+                    numReceived++;
+                    break;
+                }
+            }
+
             while (pendingMessages.try_dequeue(item)) {
                 auto& [object, message, type] = item;
                 addMessage(object, message, type);
@@ -342,19 +570,20 @@ protected:
 
         void addMessage(void* object, String const& message, bool type)
         {
-            if (consoleMessages.size()) {
-                auto& [lastObject, lastMessage, lastType, lastLength, numMessages] = consoleMessages.back();
-                if (object == lastObject && message == lastMessage && type == lastType) {
-                    numMessages++;
-                } else {
-                    consoleMessages.emplace_back(object, message, type, CachedStringWidth<14>::calculateStringWidth(message) + 40, 1);
-                }
-            } else {
-                consoleMessages.emplace_back(object, message, type, CachedStringWidth<14>::calculateStringWidth(message) + 40, 1);
-            }
+            consoleMessages.add(object, message, type);
+        }
 
-            if (consoleMessages.size() > 800)
-                consoleMessages.pop_front();
+        void addRingRepeats(int numRepeats)
+        {
+            // Only merged with the line it repeats if nothing else was added to the console since
+            if (consoleMessages.getEnd() == lastRingLineEnd) {
+                consoleMessages.addRepeats(numRepeats);
+            } else if (lastRingLineEnd >= 0) {
+                auto const& [object, message, isError] = lastRingLine;
+                addMessage(object, message, isError);
+                consoleMessages.addRepeats(numRepeats - 1);
+                lastRingLineEnd = consoleMessages.getEnd();
+            }
         }
 
         void logMessage(void* object, String const& message)
@@ -390,57 +619,124 @@ protected:
             }
         }
 
+        // Called from pd's print hook, usually on the audio thread: this doesn't allocate or lock
         void processPrint(void* object, char const* message)
         {
-            std::function<void(String const)> forwardMessage =
-                [this, object](String const& message) {
-                    if (message.startsWith("error")) {
-                        logError(object, message.substring(7));
-                    } else if (message.startsWith("verbose(0):") || message.startsWith("verbose(1):")) {
-                        logError(object, message.substring(12));
-                    } else {
-                        if (message.startsWith("verbose(")) {
-                            logMessage(object, message.substring(12));
-                        } else {
-                            logMessage(object, message);
-                        }
-                    }
-                };
-
-            static int length = 0;
-            printConcatBuffer[length] = '\0';
-
             int len = (int)strlen(message);
-            while (length + len >= 2048) {
-                int d = 2048 - 1 - length;
-                strncat(printConcatBuffer, message, d);
+            while (printConcatLength + len >= LogRing::maxLineLength) {
+                int d = LogRing::maxLineLength - 1 - printConcatLength;
+                std::memcpy(printConcatBuffer + printConcatLength, message, d);
 
                 // Send concatenated line to plugdata!
-                forwardMessage(String::fromUTF8(printConcatBuffer));
+                pushLine(object, printConcatBuffer, LogRing::maxLineLength - 1);
 
                 message += d;
                 len -= d;
-                length = 0;
-                printConcatBuffer[0] = '\0';
+                printConcatLength = 0;
             }
 
-            strncat(printConcatBuffer, message, len);
-            length += len;
-
-            if (length > 0 && printConcatBuffer[length - 1] == '\n') {
-                printConcatBuffer[length - 1] = '\0';
+            std::memcpy(printConcatBuffer + printConcatLength, message, len);
+            printConcatLength += len;
 
+            if (printConcatLength > 0 && printConcatBuffer[printConcatLength - 1] == '\n') {
                 // Send concatenated line to plugdata!
-                forwardMessage(String::fromUTF8(printConcatBuffer));
+                pushLine(object, printConcatBuffer, printConcatLength - 1);
+                printConcatLength = 0;
+            }
+        }
+
+        void pushLine(void* object, char const* text, int length)
+        {
+            // Identical consecutive lines are only counted, the message thread takes the count when it reads the console
+            if (object == lastLineObject && length == lastLineLength && std::memcmp(text, lastLine, length) == 0) {
+                pendingRepeats.fetch_add(1, std::memory_order_release);
+                wakeUp();
+                return;
+            }
+
+            // Whatever the message thread didn't take yet has to come before the next line
+            auto const repeats = static_cast<uint32>(pendingRepeats.exchange(static_cast<uint64>(numRingLinesWritten) << 32, std::memory_order_acq_rel));
+            if (repeats > 0 && printRing.write(lastLineObject, LogRing::Repeat, repeats))
+                wakeUp();
+
+            auto const now = Time::getMillisecondCounter();
+            auto& limit = getRateLimit(object, now);
+            if (now - limit.windowStart >= 1000) {
+                if (limit.suppressed > 0 && printRing.write(object, LogRing::Suppressed, limit.suppressed)) {
+                    lastLineLength = -1; // The next line doesn't follow the last one anymore
+                    wakeUp();
+                }
 
-                length = 0;
+                limit.windowStart = now;
+                limit.numLines = 0;
+                limit.suppressed = 0;
             }
+
+            if (++limit.numLines > maxLinesPerSecond || !printRing.write(object, LogRing::Line, static_cast<uint32>(length), text)) {
+                limit.suppressed++;
+                lastLineLength = -1; // A repeat after a dropped line would be merged with the line before it
+                return;
+            }
+
+            lastLineObject = object;
+            lastLineLength = length;
+            std::memcpy(lastLine, text, length);
+            pendingRepeats.store(static_cast<uint64>(++numRingLinesWritten) << 32, std::memory_order_release);
+            wakeUp();
+        }
+
+        void wakeUp()
+        {
+            if (!printWakeupPending.exchange(true, std::memory_order_acq_rel))
+                triggerAsyncUpdate();
+        }
+
+        struct RateLimit {
+            void* object = nullptr;
+            uint32 windowStart = 0;
+            uint32 numLines = 0;
+            uint32 suppressed = 0;
+        };
+
+        // Small fixed table of recently printing objects, the least recently started window gets recycled
+        RateLimit& getRateLimit(void* object, uint32 now)
+        {
+            RateLimit* oldest = rateLimits;
+            for (auto& limit : rateLimits) {
+                if (limit.object == object)
+                    return limit;
+                if (limit.windowStart < oldest->windowStart)
+                    oldest = &limit;
+            }
+
+            *oldest = RateLimit { object, now - 1000, 0, 0 };
+            return *oldest;
         }
 
-        std::deque<std::tuple<void*, String, int, int, int>> consoleMessages;
-        std::deque<std::tuple<void*, String, int, int, int>> consoleHistory;
+        static constexpr uint32 maxLinesPerSecond = 500;
+
+        LogRing printRing = LogRing(1 << 18);
+        std::atomic<bool> printWakeupPending = false;
+        RateLimit rateLimits[16];
+
+        int printConcatLength = 0;
+        char printConcatBuffer[LogRing::maxLineLength];
+
+        void* lastLineObject = nullptr;
+        int lastLineLength = -1;
+        char lastLine[LogRing::maxLineLength];
+
+        // The number of lines written to and read from the print ring, so the message thread knows which line the pending repeats belong to
+        // pendingRepeats holds that line number in the upper half, and how often it was repeated since in the lower half
+        uint32 numRingLinesWritten = 0;
+        uint32 numRingLinesRead = 0;
+        std::atomic<uint64> pendingRepeats = 0;
+
+        ConsoleStore consoleMessages;
 
-        char printConcatBuffer[2048];
+        // The last line that came out of the print ring, and where the console ended after adding it, for the repeat records
+        std::tuple<void*, String, bool> lastRingLine;
+        int64 lastRingLineEnd = -1;
 
         moodycamel::ReaderWriterQueue<std::tuple<void*, String, bool>> pendingMessages;
     };
@@ -0,0 +1,103 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "InstanceAccess.h"
+#include <s_stuff.h>
+
+static t_pdinstance* resolve_instance(t_pdinstance* x)
+{
+#ifdef PDINSTANCE
+    return x ? x : pd_this;
+#else
+    // There is only one instance, and libpd_new_instance doesn't return it
+    (void)x;
+    return pd_this;
+#endif
+}
+
+int plugdata_has_multiple_instances(void)
+{
+#ifdef PDINSTANCE
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+int plugdata_instance_number(t_pdinstance* x)
+{
+#ifdef PDINSTANCE
+    return resolve_instance(x)->pd_instanceno;
+#else
+    (void)x;
+    return 0;
+#endif
+}
+
+int plugdata_any_dsp_running(void)
+{
+#ifdef PDINSTANCE
+    int i;
+    for (i = 0; i < pd_ninstances; i++) {
+        if (pd_instances[i] && pd_instances[i]->pd_dspstate)
+            return 1;
+    }
+    return 0;
+#else
+    return pd_this->pd_dspstate;
+#endif
+}
+
+t_sample* plugdata_soundin(t_pdinstance* x)
+{
+    return resolve_instance(x)->pd_stuff->st_soundin;
+}
+
+t_sample* plugdata_soundout(t_pdinstance* x)
+{
+    return resolve_instance(x)->pd_stuff->st_soundout;
+}
+
+int plugdata_inchannels(t_pdinstance* x)
+{
+    return resolve_instance(x)->pd_stuff->st_inchannels;
+}
+
+int plugdata_outchannels(t_pdinstance* x)
+{
+    return resolve_instance(x)->pd_stuff->st_outchannels;
+}
+
+t_int* plugdata_dspchain(t_pdinstance* x)
+{
+    return resolve_instance(x)->pd_dspchain;
+}
+
+int plugdata_dspchainsize(t_pdinstance* x)
+{
+    return resolve_instance(x)->pd_dspchainsize;
+}
+
+void plugdata_tick_without_dsp(t_pdinstance* x)
+{
+    t_pdinstance* instance = resolve_instance(x);
+
+    // dsp_tick skips the chain if there is none
+    t_int* chain = instance->pd_dspchain;
+    instance->pd_dspchain = 0;
+    sched_tick();
+    instance->pd_dspchain = chain;
+}
+
+t_methodentry* plugdata_class_methods(t_class* c, t_pdinstance* x)
+{
+#ifdef PDINSTANCE
+    return c->c_methods[resolve_instance(x)->pd_instanceno];
+#else
+    (void)x;
+    return c->c_methods;
+#endif
+}
@@ -0,0 +1,46 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <m_pd.h>
+#include <m_imp.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// plugdata's own code is compiled without PDINSTANCE, but the plugins link against a pd built with it
+// That changes what pd_this and STUFF point to, and how some structs are laid out, so reading them directly would give us the main instance
+// These are compiled together with pd instead (see Libraries/CMakeLists.txt), so they always match the pd library we're linked with
+// Passing a null instance means the current one
+
+// 1 when pd was built with PDINSTANCE, so every plugdata instance gets its own pd instance
+int plugdata_has_multiple_instances(void);
+
+int plugdata_instance_number(t_pdinstance* x);
+
+// 1 when any pd instance in the process has DSP switched on
+int plugdata_any_dsp_running(void);
+
+// pd's adc~ and dac~ buffers, one block per channel, after each other
+t_sample* plugdata_soundin(t_pdinstance* x);
+t_sample* plugdata_soundout(t_pdinstance* x);
+int plugdata_inchannels(t_pdinstance* x);
+int plugdata_outchannels(t_pdinstance* x);
+
+t_int* plugdata_dspchain(t_pdinstance* x);
+int plugdata_dspchainsize(t_pdinstance* x);
+
+// Advances the scheduler by one block without running the DSP chain, the caller has to hold pd's lock
+void plugdata_tick_without_dsp(t_pdinstance* x);
+
+// The method table of a class, which every instance has its own copy of with PDINSTANCE
+t_methodentry* plugdata_class_methods(t_class* c, t_pdinstance* x);
+
+#ifdef __cplusplus
+}
+#endif
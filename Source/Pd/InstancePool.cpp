@@ -0,0 +1,98 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <juce_events/juce_events.h>
+using namespace juce;
+
+#include "Utility/Config.h"
+#include "InstancePool.h"
+
+extern "C" {
+#include <z_libpd.h>
+}
+
+#include "InstanceAccess.h"
+
+namespace pd {
+
+InstancePool::~InstancePool()
+{
+    stopTimer();
+
+    ScopedLock lock(poolLock);
+    for (auto* instance : instances) {
+        libpd_free_instance(instance);
+    }
+    instances.clear();
+
+    libpd_set_instance(libpd_main_instance());
+}
+
+t_pdinstance* InstancePool::take()
+{
+    {
+        ScopedLock lock(poolLock);
+        if (!instances.empty()) {
+            auto* instance = instances.back();
+            instances.pop_back();
+            return instance;
+        }
+    }
+
+    return libpd_new_instance();
+}
+
+void InstancePool::scheduleRefill()
+{
+    if (getTargetSize() == 0)
+        return;
+
+    // Wait until things have settled down after opening something
+    startTimer(3000);
+}
+
+void InstancePool::timerCallback()
+{
+    stopTimer();
+
+    ScopedLock lock(poolLock);
+    if (instances.size() >= static_cast<size_t>(getTargetSize()))
+        return;
+
+    // Try again later, when no instance would have to wait for the global lock
+    if (plugdata_any_dsp_running()) {
+        startTimer(5000);
+        return;
+    }
+
+    // Creating an instance makes it the current one, so put back whatever this thread was using
+    auto* current = libpd_this_instance();
+    instances.push_back(libpd_new_instance());
+    libpd_set_instance(current);
+
+    // Create the rest one at a time, so we never block the message thread for long
+    if (instances.size() < static_cast<size_t>(getTargetSize()))
+        startTimer(500);
+}
+
+int InstancePool::getTargetSize()
+{
+    if constexpr (ProjectInfo::isLowMemory)
+        return 0;
+
+    if (!plugdata_has_multiple_instances())
+        return 0;
+
+    auto const memory = SystemStats::getMemorySizeInMegabytes();
+    if (memory < 4096)
+        return 0;
+    if (memory < 16384)
+        return 1;
+
+    return 2;
+}
+
+}
@@ -0,0 +1,39 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+struct _pdinstance;
+
+namespace pd {
+
+// Keeps a few pd instances created ahead of time, so a new plugin instance or window doesn't have to wait for one
+// Creating an instance copies the method tables of every class we have loaded, which adds up with ELSE and cyclone
+// Instances are created on the message thread, a few seconds after one was taken, so it doesn't compete with opening a patch
+// Creating one takes pd's global lock, which holds up every instance, so we only do it while none of them has DSP running
+// How many we keep depends on the memory of the machine, and none on low-memory platforms
+// This is shared by all instances in the process through a SharedResourcePointer
+// When pd is built without PDINSTANCE, there is only one pd instance to share, so the pool stays empty
+class InstancePool : private Timer {
+public:
+    ~InstancePool() override;
+
+    // Returns an instance from the pool, or creates a new one if the pool is empty
+    _pdinstance* take();
+
+    // Call when an instance is fully initialised: only then are all classes loaded, so new instances get copies of them
+    void scheduleRefill();
+
+private:
+    void timerCallback() override;
+
+    static int getTargetSize();
+
+    CriticalSection poolLock;
+    std::vector<_pdinstance*> instances;
+};
+
+}
@@ -397,6 +397,12 @@ struct Interface {
 
         binbuf_text(getInstanceEditor()->copy_binbuf, buf, len);
 
+        pasteCopyBuffer(cnv);
+    }
+
+    // Pastes whatever is in pd's copy buffer
+    static void pasteCopyBuffer(t_canvas* cnv)
+    {
         canvas_setcurrent(cnv);
         pd_typedmess((t_pd*)cnv, gensym("paste"), 0, nullptr);
         canvas_unsetcurrent(cnv);
@@ -14,6 +14,7 @@
 
 #include "Utility/OSUtils.h"
 #include "Utility/SettingsFile.h"
+#include "Utility/StartupProfiler.h"
 
 extern "C" {
 #include <m_pd.h>
@@ -38,11 +39,15 @@ struct _canvasenvironment {
 
 namespace pd {
 
-Library::Library(pd::Instance* instance) : Thread("Library Index Thread"), pd(instance)
+Library::Library(pd::Instance* instance)
+    : Thread("Search Path Index Thread")
+    , pd(instance)
 {
     watcher.addFolder(ProjectInfo::appDataDir);
     watcher.addListener(this);
 
+    startThread();
+
     // Needs to be async, otherwise LV2 validation fails
     MessageManager::callAsync([this, pd = juce::WeakReference(pd)]() {
         if (pd.get()) {
@@ -50,20 +55,18 @@ Library::Library(pd::Instance* instance) : Thread("Library Index Thread"), pd(in
             updateLibrary();
         }
     });
-
-    startThread();
 }
 
 Library::~Library()
 {
     appDirChanged = nullptr;
-    waitForThreadToExit(-1);
+    stopThread(-1);
 }
 
 void Library::updateLibrary()
 {
-    auto settingsTree = ValueTree::fromXml(ProjectInfo::appDataDir.getChildFile(".settings").loadFileAsString());
-    auto pathTree = settingsTree.getChildWithName("Paths");
+    StartupProfiler::Phase phase("Library::updateLibrary");
+    StringArray newPdObjects;
 
     sys_lock();
 
@@ -73,8 +76,6 @@ void Library::updateLibrary()
     auto* mlist = static_cast<t_methodentry*>(libpd_get_class_methods(o));
     t_methodentry* m;
 
-    allObjects.clear();
-
     int i;
     for (i = o->c_nmethod, m = mlist; i--; m++) {
         if (!m || !m->me_name)
@@ -82,28 +83,29 @@ void Library::updateLibrary()
 
         auto newName = String::fromUTF8(m->me_name->s_name);
         if (!(newName.startsWith("else/") || newName.startsWith("cyclone/") || newName.endsWith("_aliased"))) {
-            allObjects.add(newName);
+            newPdObjects.add(newName);
         }
     }
 
-    // Find patches in our search tree
-    for (auto path : pathTree) {
-        auto filePath = path.getProperty("Path").toString();
-
-        auto file = File(filePath);
-        if (!file.exists() || !file.isDirectory())
-            continue;
+    sys_unlock();
 
-        for (auto const& file : OSUtils::iterateDirectory(file, false, true)) {
-            if (file.hasFileExtension("pd")) {
-                auto filename = file.getFileNameWithoutExtension();
-                if (!filename.startsWith("help-") && !filename.endsWith("-help")) {
-                    allObjects.add(filename);
-                }
-            }
-        }
+    {
+        std::lock_guard<std::recursive_mutex> lock(libraryLock);
+        pdObjects = std::move(newPdObjects);
+        rebuildObjectList();
     }
 
+    // Find patches in our search tree without holding up pd
+    notify();
+}
+
+void Library::rebuildObjectList()
+{
+    allObjects.clearQuick();
+    allObjects.ensureStorageAllocated(pdObjects.size() + abstractions.size() + 5);
+    allObjects.addArray(pdObjects);
+    allObjects.addArray(abstractions);
+
     // These can't be created by name in Pd, but plugdata allows it
     allObjects.add("graph");
     allObjects.add("garray");
@@ -113,65 +115,149 @@ void Library::updateLibrary()
     allObjects.add("symbol");
     allObjects.add("list");
 
-    sys_unlock();
+    sortedObjects = allObjects;
+    sortedObjects.sort(false);
+    auto& names = sortedObjects.strings;
+    names.removeRange(static_cast<int>(std::unique(names.begin(), names.end()) - names.begin()), names.size());
 }
 
-
 void Library::run()
 {
-    MemoryInputStream instream(BinaryData::Documentation_bin, BinaryData::Documentation_binSize, false);
-    ValueTree documentationTree = ValueTree::readFromStream(instream);
+    while (!threadShouldExit()) {
+        wait(-1);
 
-    auto weights = std::vector<float>(2);
-    weights[0] = 6.0f; // More weight for name
-    weights[1] = 3.0f; // More weight for description
-    searchDatabase.setWeights(weights);
-    
-    for (auto objectEntry : documentationTree) {
-        auto categoriesTree = objectEntry.getChildWithName("categories");
+        if (threadShouldExit())
+            return;
 
-        std::vector<std::string> fields;
-        int numProperties = objectEntry.getNumProperties();
-        for(int i = 0; i < numProperties; i++) // Name and description
+        auto settingsTree = ValueTree::fromXml(ProjectInfo::appDataDir.getChildFile(".settings").loadFileAsString());
+        auto pathTree = settingsTree.getChildWithName("Paths");
+
+        StringArray changed;
         {
-            auto property = objectEntry.getProperty(objectEntry.getPropertyName(i)).toString();
-            fields.push_back(property.toStdString());
+            std::lock_guard<std::recursive_mutex> lock(libraryLock);
+            changed.swapWith(changedDirectories);
         }
-        for(auto subtree : objectEntry) // Parent tree for arguments, inlets, outlets
-        {
-            for(auto child : subtree) // tree for individual arguments, inlets, outlets, etc.
-            {
-                for(int i = 0; i < child.getNumProperties(); i++)
-                {
-                    auto property = child.getProperty(child.getPropertyName(i)).toString();
-                    if(!property.containsOnly("0123456789.,-")) {
-                        fields.push_back(property.toStdString());
+
+        std::unordered_map<hash32, DirectoryIndex> newIndex;
+        StringArray newAbstractions;
+
+        for (auto path : pathTree) {
+            auto directory = File(path.getProperty("Path").toString());
+            if (!directory.isDirectory())
+                continue;
+
+            auto const directoryPath = directory.getFullPathName();
+            auto const directoryHash = hash(directoryPath);
+            if (newIndex.count(directoryHash))
+                continue;
+
+            auto const lastModified = directory.getLastModificationTime();
+            auto existing = directoryIndex.find(directoryHash);
+
+            if (existing != directoryIndex.end() && existing->second.lastModified == lastModified && !changed.contains(directoryPath)) {
+                newIndex[directoryHash] = std::move(existing->second);
+            } else {
+                DirectoryIndex entry { lastModified, {} };
+                for (auto const& file : OSUtils::iterateDirectory(directory, false, true)) {
+                    if (file.hasFileExtension("pd")) {
+                        auto filename = file.getFileNameWithoutExtension();
+                        if (!filename.startsWith("help-") && !filename.endsWith("-help")) {
+                            entry.abstractions.add(filename);
+                        }
                     }
                 }
+                newIndex[directoryHash] = std::move(entry);
             }
+
+            newAbstractions.addArray(newIndex[directoryHash].abstractions);
+
+            if (threadShouldExit())
+                return;
         }
-        
+
+        directoryIndex = std::move(newIndex);
+
+        std::lock_guard<std::recursive_mutex> lock(libraryLock);
+        abstractions = std::move(newAbstractions);
+        rebuildObjectList();
+    }
+}
+
+DocumentationDatabase::DocumentationDatabase() : Thread("Documentation Index Thread")
+{
+    startThread();
+}
+
+DocumentationDatabase::~DocumentationDatabase()
+{
+    waitForThreadToExit(-1);
+}
+
+void DocumentationDatabase::run()
+{
+    if (!isInitialised)
+        buildIndex();
+
+    // Nobody might ever search, so don't spend the memory on the search database until they do
+    {
+        ScopedLock lock(requestLock);
+        if (ProjectInfo::isLowMemory && !searchRequested) {
+            waitingForRequest = true;
+            return;
+        }
+    }
+
+    buildSearchDatabase();
+}
+
+void DocumentationDatabase::requestSearchDatabase()
+{
+    if (!ProjectInfo::isLowMemory)
+        return;
+
+    ScopedLock lock(requestLock);
+    if (searchRequested)
+        return;
+
+    searchRequested = true;
+    if (waitingForRequest) {
+        // The thread has returned from run() already, it only needs to finish exiting
+        waitForThreadToExit(-1);
+        startThread();
+    }
+}
+
+// First build the name index, that's all that object creation and tooltips need
+void DocumentationDatabase::buildIndex()
+{
+    MemoryInputStream instream(BinaryData::Documentation_bin, BinaryData::Documentation_binSize, false);
+    ValueTree documentationTree = ValueTree::readFromStream(instream);
+
+    searchableEntries.reserve(documentationTree.getNumChildren());
+
+    for (auto objectEntry : documentationTree) {
+        auto categoriesTree = objectEntry.getChildWithName("categories");
+
         String origin;
         for (auto category : categoriesTree) {
             auto cat = category.getProperty("name").toString();
-            if (objectOrigins.contains(cat)) {
+            if (Library::objectOrigins.contains(cat)) {
                 origin = cat;
             }
         }
-        
+
         auto name = objectEntry.getProperty("name").toString();
-        
-        if(origin == "Gem") {
+
+        if (origin == "Gem") {
 #if !ENABLE_GEM
             continue;
 #else
             gemObjects.add(name);
 #endif
         }
-        
-        searchDatabase.addEntry(objectEntry, fields);
-        searchDatabase.setThreshold(0.4f);
-        
+
+        searchableEntries.push_back(objectEntry);
+
         if (origin.isEmpty()) {
             documentationIndex[hash(name)] = objectEntry;
         } else if (origin == "Gem") {
@@ -183,23 +269,86 @@ void Library::run()
             documentationIndex[hash(origin + "/" + name)] = objectEntry;
         }
     }
-    
+
+    isInitialised = true;
     initWait.signal();
 }
 
-void Library::waitForInitialisationToFinish()
+// Then fill the fuzzy search database, which is the slow part
+void DocumentationDatabase::buildSearchDatabase()
 {
-    if(!isInitialised) {
-        initWait.wait();
-        isInitialised = true;
+    auto weights = std::vector<float>(2);
+    weights[0] = 6.0f; // More weight for name
+    weights[1] = 3.0f; // More weight for description
+    searchDatabase.setWeights(weights);
+    searchDatabase.setThreshold(0.4f);
+
+    for (auto& objectEntry : searchableEntries) {
+        if (threadShouldExit())
+            return;
+
+        std::vector<std::string> fields;
+        int numProperties = objectEntry.getNumProperties();
+        for (int i = 0; i < numProperties; i++) // Name and description
+        {
+            auto property = objectEntry.getProperty(objectEntry.getPropertyName(i)).toString();
+            fields.push_back(property.toStdString());
+        }
+        for (auto subtree : objectEntry) // Parent tree for arguments, inlets, outlets
+        {
+            for (auto child : subtree) // tree for individual arguments, inlets, outlets, etc.
+            {
+                for (int i = 0; i < child.getNumProperties(); i++) {
+                    auto property = child.getProperty(child.getPropertyName(i)).toString();
+                    if (!property.containsOnly("0123456789.,-")) {
+                        fields.push_back(property.toStdString());
+                    }
+                }
+            }
+        }
+
+        searchDatabase.addEntry(objectEntry, fields);
     }
+
+    // The search database has its own copy of everything it needs
+    searchableEntries.clear();
+    searchableEntries.shrink_to_fit();
+
+    searchReady = true;
 }
 
-bool Library::isGemObject(String const& query) const
+void DocumentationDatabase::waitForInitialisationToFinish()
+{
+    if (!isInitialised)
+        initWait.wait();
+}
+
+bool DocumentationDatabase::isGemObject(String const& query) const
 {
     return gemObjects.contains(query);
 }
 
+ValueTree DocumentationDatabase::getObjectInfo(String const& name) const
+{
+    if (!isInitialised)
+        return {};
+
+    if (auto it = documentationIndex.find(hash(name)); it != documentationIndex.end())
+        return it->second;
+
+    return {};
+}
+
+void Library::waitForInitialisationToFinish()
+{
+    documentation->waitForInitialisationToFinish();
+}
+
+bool Library::isGemObject(String const& query) const
+{
+    return documentation->isGemObject(query);
+}
+
 StringArray Library::autocomplete(String const& query, File const& patchDirectory) const
 {
     StringArray result;
@@ -215,20 +364,29 @@ StringArray Library::autocomplete(String const& query, File const& patchDirector
         }
     }
 
-    // Then, go over all regular objects for direct autocompletion
-    for (auto const& str : allObjects) {
-        if (result.size() >= 20)
-            break;
+    // Then, look up all regular objects that start with the query in the sorted index
+    // The names with this prefix are next to each other, so we only visit the ones we return
+    {
+        std::lock_guard<std::recursive_mutex> lock(libraryLock);
+        auto const& names = sortedObjects.strings;
+        auto const first = std::lower_bound(names.begin(), names.end(), query);
+
+        // The exact match and its signal version would often be cut off by the limit otherwise, since "~" sorts last
+        for (auto const& name : { query, query + "~" }) {
+            auto const it = std::lower_bound(first, names.end(), name);
+            if (it != names.end() && *it == name)
+                result.addIfNotAlreadyThere(name);
+        }
 
-        if (str.startsWith(query)) {
-            result.addIfNotAlreadyThere(str);
+        for (auto it = first; it != names.end() && result.size() < 20 && it->startsWith(query); ++it) {
+            result.addIfNotAlreadyThere(*it);
         }
     }
     
     result.sort(true);
     
     // Finally, do a fuzzy search of all object documentation
-    auto fuzzyResults = searchDatabase.search(query.toStdString());
+    auto fuzzyResults = documentation->search(query);
     for(auto& fuzzyMatch : fuzzyResults)
     {
         if (result.size() >= 20) break;
@@ -247,13 +405,16 @@ StringArray Library::searchObjectDocumentation(String const& query)
     StringArray result;
     result.ensureStorageAllocated(20);
     
-    for (auto const& str : allObjects) {
-        if (str.startsWith(query)) {
-            result.addIfNotAlreadyThere(str);
+    {
+        std::lock_guard<std::recursive_mutex> lock(libraryLock);
+        for (auto const& str : allObjects) {
+            if (str.startsWith(query)) {
+                result.addIfNotAlreadyThere(str);
+            }
         }
     }
     
-    auto fuzzyResults = searchDatabase.search(query.toStdString());
+    auto fuzzyResults = documentation->search(query);
     result.ensureStorageAllocated(result.size() + fuzzyResults.size());
     
     for(auto& fuzzyMatch : fuzzyResults)
@@ -269,7 +430,7 @@ StringArray Library::searchObjectDocumentation(String const& query)
 
 ValueTree Library::getObjectInfo(String const& name)
 {
-    return documentationIndex[hash(name)];
+    return documentation->getObjectInfo(name);
 }
 
 std::array<StringArray, 2> Library::parseIoletTooltips(ValueTree const& iolets, String const& name, int numIn, int numOut)
@@ -327,12 +488,23 @@ std::array<StringArray, 2> Library::parseIoletTooltips(ValueTree const& iolets,
 
 StringArray Library::getAllObjects()
 {
+    std::lock_guard<std::recursive_mutex> lock(libraryLock);
     return allObjects;
 }
 
-void Library::filesystemChanged()
+void Library::filesystemChanged(FileSystemWatcher::ChangeSet const& changes)
 {
-    updateLibrary();
+    // Make sure the directories get rescanned, even if their modification time didn't change
+    // Only those get scanned again, the rest of the index is reused
+    {
+        std::lock_guard<std::recursive_mutex> lock(libraryLock);
+        for (auto const& [file, event] : changes) {
+            if (file.hasFileExtension("pd"))
+                changedDirectories.addIfNotAlreadyThere(file.getParentDirectory().getFullPathName());
+        }
+    }
+
+    notify();
 }
 
 File Library::findPatch(String const& patchToFind)
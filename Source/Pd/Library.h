@@ -14,22 +14,76 @@
 
 namespace pd {
 
+// The documentation index and search database, decoded from BinaryData
+// This never changes, so it's shared by all instances in the process through a SharedResourcePointer:
+// it gets built once on a background thread when the first Library is created, and freed along with the last one
+// The name index is ready quickly, the fuzzy search database takes a lot longer to build
+// Until that's done, searches only return nothing instead of blocking the caller
+// With ProjectInfo::isLowMemory, the search database is only built once somebody searches
+class DocumentationDatabase : public Thread {
+public:
+    DocumentationDatabase();
+    ~DocumentationDatabase() override;
+
+    void run() override;
+
+    // Waits for the name index, not for the search database
+    void waitForInitialisationToFinish();
+
+    bool isGemObject(String const& query) const;
+    ValueTree getObjectInfo(String const& name) const;
+
+    bool isSearchReady() const { return searchReady.load(); }
+
+    // Instances may search from different threads at the same time
+    auto search(String const& query)
+    {
+        using Results = decltype(searchDatabase.search(std::string()));
+        if (!searchReady.load()) {
+            requestSearchDatabase();
+            return Results();
+        }
+
+        ScopedLock lock(searchLock);
+        return searchDatabase.search(query.toStdString());
+    }
+
+private:
+    void buildIndex();
+    void buildSearchDatabase();
+    void requestSearchDatabase();
+
+    StringArray gemObjects;
+    std::vector<ValueTree> searchableEntries;
+    fuzzysearch::Database<ValueTree> searchDatabase;
+    std::unordered_map<hash32, ValueTree> documentationIndex;
+    CriticalSection searchLock;
+
+    WaitableEvent initWait = WaitableEvent(true);
+    std::atomic<bool> isInitialised = false;
+    std::atomic<bool> searchReady = false;
+
+    CriticalSection requestLock;
+    bool searchRequested = false;
+    bool waitingForRequest = false;
+};
+
 class Instance;
-class Library : public FileSystemWatcher::Listener, public Thread {
+class Library : public FileSystemWatcher::Listener
+    , private Thread {
 
 public:
     explicit Library(pd::Instance* instance);
 
     ~Library() override;
-    
-    void run() override;
-    
+
     void waitForInitialisationToFinish();
 
     void updateLibrary();
 
     bool isGemObject(String const& query) const;
     
+    // Safe to call from any thread, the suggestion box runs it on a worker
     StringArray autocomplete(String const& query, File const& patchDirectory) const;
     StringArray searchObjectDocumentation(String const& query);
     
@@ -37,7 +91,7 @@ public:
 
     static std::array<StringArray, 2> parseIoletTooltips(ValueTree const& iolets, String const& name, int numIn, int numOut);
 
-    void filesystemChanged() override;
+    void filesystemChanged(FileSystemWatcher::ChangeSet const& changes) override;
 
     static File findHelpfile(t_gobj* obj, File const& parentPatchFile);
 
@@ -78,19 +132,33 @@ public:
     static inline StringArray objectOrigins = { "vanilla", "ELSE", "cyclone", "Gem", "heavylib", "pdlua" };
 
 private:
+    // Rescans the search paths whenever updateLibrary or the file watcher asks for it
+    void run() override;
+
+    // Needs to be called while holding libraryLock
+    void rebuildObjectList();
+
+    struct DirectoryIndex {
+        Time lastModified;
+        StringArray abstractions;
+    };
+
+    // Only touched by the index thread: directories that haven't been modified since the last scan are not scanned again
+    std::unordered_map<hash32, DirectoryIndex> directoryIndex;
+
+    // Everything below is guarded by libraryLock
     StringArray allObjects;
-    StringArray gemObjects;
-    
-    std::recursive_mutex libraryLock;
-    
-    fuzzysearch::Database<ValueTree> searchDatabase;
+    StringArray sortedObjects; // allObjects sorted and without duplicates, so a prefix can be found with a binary search
+    StringArray pdObjects;
+    StringArray abstractions;
+    StringArray changedDirectories;
+
+    mutable std::recursive_mutex libraryLock;
+
+    SharedResourcePointer<DocumentationDatabase> documentation;
 
     FileSystemWatcher watcher;
-    WaitableEvent initWait;
     pd::Instance* pd;
-
-    std::unordered_map<hash32, ValueTree> documentationIndex;
-    bool isInitialised = false;
 };
 
 } // namespace pd
@@ -7,6 +7,7 @@
 
 #include "Instance.h"
 #include "Utility/ThreadSafeStack.h"
+#include "Utility/TraceRecorder.h"
 #include <readerwriterqueue.h>
 
 namespace pd {
@@ -15,13 +16,24 @@ class MessageListener {
 public:
     virtual void receiveMessage(t_symbol* symbol, pd::Atom const atoms[8], int numAtoms) = 0;
 
+    // Listeners that can't be seen right now get paused: the dispatcher holds on to the latest message for each symbol,
+    // and delivers those when resumePausedListeners() is called
+    virtual bool isListenerVisible() { return true; }
+
     JUCE_DECLARE_WEAK_REFERENCEABLE(MessageListener)
 };
 
 // MessageDispatcher handles the organising of messages from Pd to the plugdata GUI
-// It provides an optimised way to listen to messages within pd from the message thread,
-// without performing and memory allocation on the audio thread, and which groups messages within the same audio block (or multiple audio blocks, depending on how long it takes to get a callback from the message thread) togethter
+// It provides an optimised way to listen to messages within pd from the message thread, without performing any memory allocation on the audio thread
+// Every target that has a listener gets a slot in a fixed-size table, with room for the latest message of a few selectors
+// The audio thread overwrites those with the latest value and marks the slot as dirty, the message thread only visits dirty slots
+// This means that all messages to the same target and selector that arrive between two frames are coalesced into one
+// Listeners that need to see every message can ask for that when registering, those messages go through an ordered queue instead
 class MessageDispatcher {
+    static constexpr int numSlots = 4096; // Needs to be a power of two
+    static constexpr int maxProbes = 64;
+    static constexpr int entriesPerSlot = 4;
+
     // Wrapper to store 8 atoms in stack memory
     // We never read more than 8 args in the whole source code, so this prevents unnecessary memory copying
     // We also don't want this list to be dynamic since we want to stack allocate it
@@ -64,18 +76,76 @@ class MessageDispatcher {
         }
     };
 
+    // Latest message for one selector, protected by a sequence lock: odd while the audio thread is writing
+    struct Entry {
+        std::atomic<bool> used = false;
+        t_symbol* symbol = nullptr;
+        std::atomic<uint32> sequence = 0;
+        uint32 lastDelivered = 0; // Message thread only
+        Message message;
+    };
+
+    struct Slot {
+        std::atomic<void*> target = nullptr;
+        std::atomic<bool> dirty = false;
+        std::atomic<bool> keepsHistory = false;
+        std::atomic<bool> countsOnly = false; // Only activity targets use this slot, nothing gets delivered
+        std::atomic<uint32> activity = 0;     // Number of messages to this target, ever
+        Entry entries[entriesPerSlot];
+    };
+
 public:
     MessageDispatcher()
+        : slots(std::make_unique<Slot[]>(numSlots))
+        , dirtyFifo(numSlots + 1)
+        , dirtyBuffer(numSlots + 1)
     {
-        usedHashes.reserve(stackSize);
+        dirtySlots.reserve(numSlots);
+        orderedMessages.reserve(stackSize);
         nullListeners.reserve(stackSize);
     }
 
+    // Called from the audio thread, while holding the pd lock
     void enqueueMessage(void* target, t_symbol* symbol, int argc, t_atom* argv)
     {
         if(block) return;
-        
-        messageStack.push({ target, symbol, argc, argv });
+
+        auto* slot = findSlot(target);
+        if (slot)
+            slot->activity.fetch_add(1, std::memory_order_relaxed);
+
+        if (!slot) {
+            // Nobody listens to this target
+            if (numTargetsWithoutSlot.load(std::memory_order_relaxed) == 0)
+                return;
+
+            messageStack.push({ target, symbol, argc, argv });
+        } else if (slot->countsOnly.load(std::memory_order_relaxed)) {
+            // Nothing gets delivered, we only keep the latest message for getLatestMessage
+            writeEntry(slot->entries[0], target, symbol, argc, argv);
+        } else if (slot->keepsHistory.load(std::memory_order_relaxed) || !writeToSlot(*slot, target, symbol, argc, argv)) {
+            messageStack.push({ target, symbol, argc, argv });
+        }
+
+        pendingMessages.store(true, std::memory_order_relaxed);
+    }
+
+    // Lets the GUI skip frames when pd has nothing new to show
+    bool hasPendingMessages() const
+    {
+        return pendingMessages.load(std::memory_order_relaxed);
+    }
+
+    // Ordered messages the message thread hasn't picked up yet
+    int getNumQueuedMessages() const
+    {
+        return messageStack.getNumPending();
+    }
+
+    // Messages that had to go through the ordered queue while it was full, since this dispatcher was created
+    uint64 getNumDroppedMessages() const
+    {
+        return messageStack.getNumDropped();
     }
     
     // used when no plugineditor is active, so we can just ignore messages
@@ -90,13 +160,38 @@ public:
             while (messageStack.pop(message)) {}
             messageStack.swapBuffers();
             while (messageStack.pop(message)) {}
+
+            readDirtySlots();
+            for (auto index : dirtySlots) {
+                auto& slot = slots[index];
+                slot.dirty.store(false);
+                for (auto& entry : slot.entries)
+                    entry.lastDelivered = entry.sequence.load(std::memory_order_acquire);
+            }
         }
     }
 
-    void addMessageListener(void* object, pd::MessageListener* messageListener)
+    // Set receiveEveryMessage if the listener can't miss any messages, instead of only receiving the latest one for every selector
+    void addMessageListener(void* object, pd::MessageListener* messageListener, bool receiveEveryMessage = false)
     {
         ScopedLock lock(messageListenerLock);
-        messageListeners[object].insert(juce::WeakReference(messageListener));
+        auto& listeners = messageListeners[object];
+        if (listeners.empty()) {
+            // An activity target might have a slot already, from now on its messages get delivered too
+            if (auto* slot = findSlot(object)) {
+                slot->entries[0].lastDelivered = slot->entries[0].sequence.load(std::memory_order_relaxed);
+                slot->countsOnly.store(false, std::memory_order_relaxed);
+            } else {
+                assignSlot(object);
+            }
+        }
+
+        listeners.insert(juce::WeakReference(messageListener));
+
+        if (receiveEveryMessage) {
+            if (auto* slot = findSlot(object))
+                slot->keepsHistory.store(true, std::memory_order_relaxed);
+        }
     }
 
     void removeMessageListener(void* object, MessageListener* messageListener)
@@ -112,69 +207,416 @@ public:
         if (it != listeners.end())
             listeners.erase(it);
 
-        if (listeners.empty())
+        if (listeners.empty()) {
             messageListeners.erase(object);
+            releaseListenerSlot(object);
+        }
+
+        pausedListeners.erase(messageListener);
+    }
+
+    // For targets where the GUI only needs to know that messages went through, like connections for the activity overlays
+    // The audio thread counts the messages and keeps the latest one in the target's slot, nothing is queued or delivered
+    // The GUI samples the count with getActivityCount whenever it draws a frame
+    void addActivityTarget(void* target)
+    {
+        ScopedLock lock(messageListenerLock);
+        if (activityTargets[target]++ > 0 || messageListeners.count(target))
+            return;
+
+        assignSlot(target, true);
+    }
+
+    void removeActivityTarget(void* target)
+    {
+        ScopedLock lock(messageListenerLock);
+        auto it = activityTargets.find(target);
+        if (it == activityTargets.end() || --it->second > 0)
+            return;
+
+        activityTargets.erase(it);
+        if (!messageListeners.count(target))
+            releaseSlot(target);
+    }
+
+    // Goes up by one for every message to this target, only tracked for targets that have a listener or are an activity target
+    uint32 getActivityCount(void* target) const
+    {
+        if (auto* slot = findSlot(target))
+            return slot->activity.load(std::memory_order_relaxed);
+
+        return 0;
+    }
+
+    // The most recent message to an activity target, returns false if there wasn't one
+    bool getLatestMessage(void* target, t_symbol*& symbol, pd::Atom atoms[8], int& numAtoms) const
+    {
+        auto* slot = findSlot(target);
+        if (!slot || !slot->countsOnly.load(std::memory_order_relaxed))
+            return false;
+
+        Message message;
+        if (!peekEntry(slot->entries[0], message) || message.target != target)
+            return false;
+
+        symbol = message.symbol;
+        numAtoms = message.size;
+        for (int at = 0; at < message.size; at++) {
+            atoms[at] = pd::Atom(message.data + at);
+        }
+        return true;
+    }
+
+    // Call this when listeners might have become visible again, like after switching tabs
+    void resumePausedListeners()
+    {
+        std::vector<juce::WeakReference<MessageListener>> visibleListeners;
+        for (auto it = pausedListeners.begin(); it != pausedListeners.end();) {
+            auto* listener = it->second.listener.get();
+            if (!listener) {
+                it = pausedListeners.erase(it);
+                continue;
+            }
+
+            if (listener->isListenerVisible())
+                visibleListeners.emplace_back(listener);
+            ++it;
+        }
+
+        // Receiving a message can add or remove listeners, so don't do this while iterating
+        for (auto& listener : visibleListeners) {
+            if (auto* stillAlive = listener.get())
+                resumeListener(stillAlive);
+        }
     }
 
     void dequeueMessages() // Note: make sure correct pd instance is active when calling this
     {
-        usedHashes.clear();
+        TraceRecorder::Scope trace("MessageDispatcher::dequeueMessages");
+        int numMessages = 0;
+
         nullListeners.clear();
+        pendingMessages.store(false, std::memory_order_relaxed);
 
+        // Messages that need to arrive in order, the stack gives us the newest first
+        orderedMessages.clear();
         messageStack.swapBuffers();
         Message message;
         while (messageStack.pop(message)) {
-            auto hash = reinterpret_cast<intptr_t>(message.target) ^ reinterpret_cast<intptr_t>(message.symbol);
-            if (usedHashes.find(hash) != usedHashes.end()) {
+            orderedMessages.push_back(message);
+        }
+        for (auto it = orderedMessages.rbegin(); it != orderedMessages.rend(); ++it) {
+            dispatchMessage(*it);
+        }
+        numMessages += static_cast<int>(orderedMessages.size());
+
+        readDirtySlots();
+        for (auto index : dirtySlots) {
+            auto& slot = slots[index];
+
+            // Clear the flag before reading, so that anything written from now on marks the slot again
+            slot.dirty.store(false);
+
+            auto* target = slot.target.load(std::memory_order_acquire);
+            if (!target || target == removedTarget)
                 continue;
+
+            for (auto& entry : slot.entries) {
+                if (!entry.used.load(std::memory_order_acquire))
+                    break;
+
+                if (readEntry(entry, message) && message.target == target) {
+                    dispatchMessage(message);
+                    numMessages++;
+                }
             }
-            usedHashes.insert(hash);
+        }
 
-            if (messageListeners.find(message.target) == messageListeners.end())
+        // The same target can be in here more than once, so look for deleted listeners instead of erasing by iterator
+        for (auto* target : nullListeners) {
+            auto listeners = messageListeners.find(target);
+            if (listeners == messageListeners.end())
                 continue;
 
-            for (auto it = messageListeners.at(message.target).begin(); it != messageListeners.at(message.target).end(); ++it) {
+            for (auto it = listeners->second.begin(); it != listeners->second.end();) {
                 if (it->wasObjectDeleted())
-                    continue;
+                    it = listeners->second.erase(it);
+                else
+                    ++it;
+            }
+
+            if (listeners->second.empty()) {
+                ScopedLock lock(messageListenerLock);
+                messageListeners.erase(listeners);
+                releaseListenerSlot(target);
+            }
+        }
+
+        trace.setCount(numMessages);
+    }
+
+private:
+    static inline void* const removedTarget = reinterpret_cast<void*>(1);
+
+    static int getHomeSlot(void* target)
+    {
+        auto const bits = static_cast<uint64>(reinterpret_cast<uintptr_t>(target));
+        return static_cast<int>(((bits >> 4) * 0x9E3779B97F4A7C15ull) >> 32) & (numSlots - 1);
+    }
 
-                auto listener = it->get();
+    Slot* findSlot(void* target) const
+    {
+        auto const home = getHomeSlot(target);
+        for (int i = 0; i < maxProbes; i++) {
+            auto& slot = slots[(home + i) & (numSlots - 1)];
+            auto* slotTarget = slot.target.load(std::memory_order_acquire);
+            if (slotTarget == target)
+                return &slot;
+            if (!slotTarget)
+                return nullptr;
+        }
+
+        return nullptr;
+    }
 
-                pd::Atom atoms[8];
-                for (int at = 0; at < message.size; at++) {
-                    atoms[at] = pd::Atom(message.data + at);
+    // Message thread only, while holding messageListenerLock
+    void assignSlot(void* target, bool countsOnly = false)
+    {
+        auto const home = getHomeSlot(target);
+        for (int i = 0; i < maxProbes; i++) {
+            auto& slot = slots[(home + i) & (numSlots - 1)];
+            auto* slotTarget = slot.target.load(std::memory_order_relaxed);
+            if (!slotTarget || slotTarget == removedTarget) {
+                slot.keepsHistory.store(false, std::memory_order_relaxed);
+                slot.countsOnly.store(countsOnly, std::memory_order_relaxed);
+                for (auto& entry : slot.entries) {
+                    entry.used.store(false, std::memory_order_relaxed);
+                    entry.lastDelivered = entry.sequence.load(std::memory_order_relaxed);
                 }
-                auto symbol = message.symbol ? message.symbol : gensym("");
+                slot.target.store(target, std::memory_order_release);
+                return;
+            }
+        }
 
-                if (listener)
-                    listener->receiveMessage(symbol, atoms, message.size);
-                else
-                    nullListeners.push_back({ message.target, it });
+        // Activity targets just don't get counted then
+        if (countsOnly)
+            return;
+
+        // Table is full around this slot, send messages to this target through the ordered queue
+        targetsWithoutSlot.insert(target);
+        numTargetsWithoutSlot.store(static_cast<int>(targetsWithoutSlot.size()), std::memory_order_relaxed);
+    }
+
+    // Message thread only, while holding messageListenerLock
+    // The audio thread might still be writing to this slot, that's why messages are checked against the slot target before delivering
+    void releaseSlot(void* target)
+    {
+        if (targetsWithoutSlot.erase(target)) {
+            numTargetsWithoutSlot.store(static_cast<int>(targetsWithoutSlot.size()), std::memory_order_relaxed);
+            return;
+        }
+
+        if (auto* slot = findSlot(target))
+            slot->target.store(removedTarget, std::memory_order_release);
+    }
+
+    // Message thread only, while holding messageListenerLock
+    // The last listener of a target went away, but the slot stays if the target is also an activity target
+    void releaseListenerSlot(void* target)
+    {
+        if (!activityTargets.count(target)) {
+            releaseSlot(target);
+        } else if (auto* slot = findSlot(target)) {
+            slot->countsOnly.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    // Audio thread only, returns false if the slot has no room for another selector
+    bool writeToSlot(Slot& slot, void* target, t_symbol* symbol, int argc, t_atom* argv)
+    {
+        Entry* entry = nullptr;
+        for (auto& candidate : slot.entries) {
+            if (!candidate.used.load(std::memory_order_acquire)) {
+                candidate.symbol = symbol;
+                candidate.used.store(true, std::memory_order_release);
+                entry = &candidate;
+                break;
+            }
+            if (candidate.symbol == symbol) {
+                entry = &candidate;
+                break;
             }
         }
 
-        for (int i = nullListeners.size() - 1; i >= 0; i--) {
-            auto& [target, iterator] = nullListeners[i];
-            messageListeners[target].erase(iterator);
+        if (!entry)
+            return false;
+
+        writeEntry(*entry, target, symbol, argc, argv);
+
+        if (!slot.dirty.exchange(true)) {
+            int start1, size1, start2, size2;
+            dirtyFifo.prepareToWrite(1, start1, size1, start2, size2);
+            if (size1 > 0)
+                dirtyBuffer[start1] = static_cast<int>(&slot - slots.get());
+            dirtyFifo.finishedWrite(size1);
         }
+
+        return true;
     }
 
-private:
+    // Audio thread only
+    static void writeEntry(Entry& entry, void* target, t_symbol* symbol, int argc, t_atom* argv)
+    {
+        auto const sequence = entry.sequence.load(std::memory_order_relaxed);
+        entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.message = Message(target, symbol, argc, argv);
+        entry.sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    // Reads the latest message in an entry, whether it was delivered or not
+    static bool peekEntry(Entry const& entry, Message& result)
+    {
+        for (int attempt = 0; attempt < 8; attempt++) {
+            auto const before = entry.sequence.load(std::memory_order_acquire);
+            if (before == 0)
+                return false;
+
+            if (before & 1)
+                continue;
+
+            result = entry.message;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry.sequence.load(std::memory_order_relaxed) == before)
+                return true;
+        }
+
+        return false;
+    }
+
+    // Returns true if there's a message we haven't delivered yet
+    static bool readEntry(Entry& entry, Message& result)
+    {
+        for (int attempt = 0; attempt < 8; attempt++) {
+            auto const before = entry.sequence.load(std::memory_order_acquire);
+            if (before == entry.lastDelivered)
+                return false;
+
+            if (before & 1)
+                continue;
+
+            result = entry.message;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry.sequence.load(std::memory_order_relaxed) == before) {
+                entry.lastDelivered = before;
+                return true;
+            }
+        }
+
+        // The audio thread kept writing, it will mark the slot dirty again so we'll pick it up next time
+        return false;
+    }
+
+    void readDirtySlots()
+    {
+        dirtySlots.clear();
+
+        int start1, size1, start2, size2;
+        dirtyFifo.prepareToRead(dirtyFifo.getNumReady(), start1, size1, start2, size2);
+        dirtySlots.insert(dirtySlots.end(), dirtyBuffer.begin() + start1, dirtyBuffer.begin() + start1 + size1);
+        dirtySlots.insert(dirtySlots.end(), dirtyBuffer.begin() + start2, dirtyBuffer.begin() + start2 + size2);
+        dirtyFifo.finishedRead(size1 + size2);
+    }
+
+    void dispatchMessage(Message const& message)
+    {
+        auto listeners = messageListeners.find(message.target);
+        if (listeners == messageListeners.end())
+            return;
+
+        for (auto it = listeners->second.begin(); it != listeners->second.end(); ++it) {
+            auto listener = it->get();
+
+            if (!listener) {
+                nullListeners.push_back(message.target);
+                continue;
+            }
+
+            // Keep only the latest message for each symbol
+            if (!listener->isListenerVisible()) {
+                auto& paused = pausedListeners[listener];
+                paused.listener = listener;
+                paused.latestMessages[message.symbol] = message;
+                continue;
+            }
+
+            // Became visible without anyone telling us, catch up first so the old messages don't arrive after this one
+            if (!pausedListeners.empty())
+                resumeListener(listener);
+
+            deliverMessage(listener, message);
+        }
+    }
+
+    void resumeListener(MessageListener* listener)
+    {
+        auto paused = pausedListeners.find(listener);
+        if (paused == pausedListeners.end())
+            return;
+
+        auto messages = std::move(paused->second.latestMessages);
+        pausedListeners.erase(paused);
+
+        for (auto& [symbol, message] : messages) {
+            deliverMessage(listener, message);
+        }
+    }
+
+    void deliverMessage(MessageListener* listener, Message const& message)
+    {
+        pd::Atom atoms[8];
+        for (int at = 0; at < message.size; at++) {
+            atoms[at] = pd::Atom(message.data + at);
+        }
+        auto symbol = message.symbol ? message.symbol : gensym("");
+
+        listener->receiveMessage(symbol, atoms, message.size);
+    }
+
+    struct PausedListener {
+        juce::WeakReference<MessageListener> listener;
+        std::unordered_map<t_symbol*, Message> latestMessages;
+    };
+
     static constexpr int stackSize = 65536;
     using MessageStack = ThreadSafeStack<Message, stackSize>;
 
-    std::vector<std::pair<void*, std::set<juce::WeakReference<pd::MessageListener>>::iterator>> nullListeners;
-    std::unordered_set<intptr_t> usedHashes;
+    std::vector<void*> nullListeners;
+
+    std::unique_ptr<Slot[]> slots;
+    AbstractFifo dirtyFifo;
+    std::vector<int> dirtyBuffer;
+    std::vector<int> dirtySlots;
+
+    // Ordered messages, for listeners that want every message, or when a target or selector didn't fit in the table
     MessageStack messageStack;
+    std::vector<Message> orderedMessages;
 
-    // Queue to use in case our fast stack queue is full
-    moodycamel::ConcurrentQueue<Message> backupQueue;
+    std::unordered_set<void*> targetsWithoutSlot;
+    std::atomic<int> numTargetsWithoutSlot = 0;
 
     std::unordered_map<void*, std::set<juce::WeakReference<MessageListener>>> messageListeners;
+    std::unordered_map<void*, int> activityTargets;
     CriticalSection messageListenerLock;
 
+    // Message thread only
+    std::unordered_map<MessageListener*, PausedListener> pausedListeners;
+
     // Block messages unless an editor has been constructed
     // Otherwise the message queue will not be cleared by the editors v-blank
     std::atomic<bool> block = true;
+
+    std::atomic<bool> pendingMessages = false;
 };
 
 }
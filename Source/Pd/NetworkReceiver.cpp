@@ -0,0 +1,515 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <juce_core/juce_core.h>
+#include <juce_events/juce_events.h>
+#include "Utility/Config.h"
+
+#include <chrono>
+#include <map>
+#include <readerwriterqueue.h>
+
+extern "C" {
+#include <m_pd.h>
+#include <s_stuff.h>
+}
+
+#include "NetworkReceiver.h"
+
+namespace pd {
+
+// One parsed message, with room for its atoms and text inline, so the queue never allocates
+// Symbols are stored as text: gensym isn't safe to call from our thread, so they're looked up when the message is output
+struct NetworkMessage {
+    static constexpr int maxAtoms = 32;
+    static constexpr int maxText = 512;
+
+    struct Atom {
+        float value;
+        int16 textStart; // -1 for floats
+        int16 textLength;
+    };
+
+    bool addFloat(float value)
+    {
+        if (numAtoms >= maxAtoms)
+            return false;
+
+        atoms[numAtoms++] = { value, -1, 0 };
+        return true;
+    }
+
+    bool addSymbol(char const* symbol, int length)
+    {
+        if (numAtoms >= maxAtoms || textLength + length + 1 > maxText)
+            return false;
+
+        memcpy(text + textLength, symbol, length);
+        text[textLength + length] = 0;
+        atoms[numAtoms++] = { 0.0f, static_cast<int16>(textLength), static_cast<int16>(length) };
+        textLength += length + 1;
+        return true;
+    }
+
+    // Adds a word the way pd would read it: as a float if it looks like one
+    bool addWord(char const* word, int length)
+    {
+        if (length > 0 && length < 32) {
+            char buffer[32];
+            memcpy(buffer, word, length);
+            buffer[length] = 0;
+
+            char* end;
+            auto const value = std::strtod(buffer, &end);
+            if (end == buffer + length && (std::isdigit(static_cast<unsigned char>(buffer[0])) || buffer[0] == '-' || buffer[0] == '+' || buffer[0] == '.'))
+                return addFloat(static_cast<float>(value));
+        }
+
+        return addSymbol(word, length);
+    }
+
+    void clear()
+    {
+        numAtoms = 0;
+        textLength = 0;
+        timetag = 0.0;
+    }
+
+    double timetag = 0.0; // Milliseconds since 1970, 0 means right away
+    int numAtoms = 0;
+    int textLength = 0;
+    Atom atoms[maxAtoms];
+    char text[maxText];
+};
+
+// Reads and parses packets for one object, pd only ever looks at the queue
+class NetworkReceiveThread : public Thread {
+public:
+    NetworkReceiveThread(int portToListenOn, bool parseOSC)
+        : Thread("Network Receive")
+        , port(portToListenOn)
+        , isOSC(parseOSC)
+    {
+    }
+
+    ~NetworkReceiveThread() override
+    {
+        stop();
+        stopThread(1000);
+    }
+
+    // Closes the socket and tells the thread to exit, without waiting for it
+    void stop()
+    {
+        signalThreadShouldExit();
+        socket.shutdown();
+    }
+
+    bool start()
+    {
+        if (!socket.bindToPort(port))
+            return false;
+
+        startThread(Priority::high);
+        return true;
+    }
+
+    moodycamel::ReaderWriterQueue<NetworkMessage> queue { 256 };
+    std::atomic<int64> numDropped = 0;
+
+private:
+    void run() override
+    {
+        HeapBlock<uint8> packet(maxPacketSize);
+
+        while (!threadShouldExit()) {
+            if (socket.waitUntilReady(true, 100) != 1)
+                continue;
+
+            auto const size = socket.read(packet.get(), maxPacketSize, false);
+            if (size <= 0)
+                continue;
+
+            if (isOSC)
+                parseOSC(packet.get(), size, 0.0);
+            else
+                parseFUDI(reinterpret_cast<char const*>(packet.get()), size);
+        }
+    }
+
+    void enqueue()
+    {
+        if (!queue.try_enqueue(message))
+            numDropped.fetch_add(1, std::memory_order_relaxed);
+
+        message.clear();
+    }
+
+    void drop()
+    {
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+        message.clear();
+    }
+
+    // Messages are separated by semicolons, words by whitespace, like pd's own netsend
+    void parseFUDI(char const* data, int size)
+    {
+        int wordStart = -1;
+        bool overflow = false;
+        for (int i = 0; i <= size; i++) {
+            auto const c = i < size ? data[i] : ';';
+            auto const isEscaped = i > 0 && data[i - 1] == '\\';
+            auto const isSeparator = !isEscaped && (c == ';' || c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == 0);
+
+            if (!isSeparator) {
+                if (wordStart < 0)
+                    wordStart = i;
+                continue;
+            }
+
+            if (wordStart >= 0) {
+                overflow = !message.addWord(data + wordStart, i - wordStart) || overflow;
+                wordStart = -1;
+            }
+
+            if (c == ';' && message.numAtoms > 0) {
+                if (overflow)
+                    drop();
+                else
+                    enqueue();
+                overflow = false;
+            }
+        }
+    }
+
+    static uint32 readInt(uint8 const* data)
+    {
+        return ByteOrder::bigEndianInt(data);
+    }
+
+    static int paddedLength(int length)
+    {
+        return (length + 4) & ~3;
+    }
+
+    // Returns the length of the string, or -1 if it doesn't end inside the packet
+    static int readString(uint8 const* data, int size)
+    {
+        for (int i = 0; i < size; i++) {
+            if (data[i] == 0)
+                return i;
+        }
+        return -1;
+    }
+
+    // OSC timetags are NTP time: seconds since 1900 and a 32 bit fraction, we use milliseconds since 1970
+    static double timetagToMilliseconds(uint8 const* data)
+    {
+        auto const seconds = readInt(data);
+        auto const fraction = readInt(data + 4);
+
+        // 1 means "immediately"
+        if (seconds == 0 && fraction == 1)
+            return 0.0;
+
+        return (static_cast<double>(seconds) - 2208988800.0) * 1000.0 + static_cast<double>(fraction) / 4294967296.0 * 1000.0;
+    }
+
+    void parseOSC(uint8 const* data, int size, double timetag)
+    {
+        if (size >= 16 && memcmp(data, "#bundle", 8) == 0) {
+            auto const bundleTime = timetagToMilliseconds(data + 8);
+            for (int position = 16; position + 4 <= size;) {
+                auto const elementSize = static_cast<int>(readInt(data + position));
+                position += 4;
+                if (elementSize <= 0 || position + elementSize > size)
+                    return;
+
+                parseOSC(data + position, elementSize, bundleTime);
+                position += elementSize;
+            }
+            return;
+        }
+
+        auto const addressLength = readString(data, size);
+        if (addressLength <= 0 || data[0] != '/')
+            return;
+
+        message.timetag = timetag;
+
+        // Like [oscparse]: every part of the address becomes an atom
+        auto const* address = reinterpret_cast<char const*>(data);
+        for (int start = 1, i = 1; i <= addressLength; i++) {
+            if (i == addressLength || address[i] == '/') {
+                if (i > start && !message.addWord(address + start, i - start))
+                    return drop();
+                start = i + 1;
+            }
+        }
+
+        auto position = paddedLength(addressLength);
+        if (position >= size || data[position] != ',') {
+            enqueue();
+            return;
+        }
+
+        auto const* typeTags = reinterpret_cast<char const*>(data + position + 1);
+        auto const numTypeTags = readString(data + position + 1, size - position - 1);
+        if (numTypeTags < 0)
+            return drop();
+
+        position += paddedLength(numTypeTags + 1);
+
+        bool ok = true;
+        for (int t = 0; t < numTypeTags && ok; t++) {
+            auto const remaining = size - position;
+            switch (typeTags[t]) {
+            case 'i':
+            case 'c':
+            case 'r':
+                if ((ok = remaining >= 4))
+                    ok = message.addFloat(static_cast<float>(static_cast<int32>(readInt(data + position))));
+                position += 4;
+                break;
+            case 'f':
+                if ((ok = remaining >= 4)) {
+                    auto const bits = readInt(data + position);
+                    float value;
+                    memcpy(&value, &bits, sizeof(float));
+                    ok = message.addFloat(value);
+                }
+                position += 4;
+                break;
+            case 'h':
+            case 'd':
+            case 't':
+                if ((ok = remaining >= 8)) {
+                    auto const bits = (static_cast<uint64>(readInt(data + position)) << 32) | readInt(data + position + 4);
+                    if (typeTags[t] == 'd') {
+                        double value;
+                        memcpy(&value, &bits, sizeof(double));
+                        ok = message.addFloat(static_cast<float>(value));
+                    } else {
+                        ok = message.addFloat(static_cast<float>(static_cast<int64>(bits)));
+                    }
+                }
+                position += 8;
+                break;
+            case 's':
+            case 'S': {
+                auto const length = readString(data + position, remaining);
+                if ((ok = length >= 0))
+                    ok = message.addSymbol(reinterpret_cast<char const*>(data + position), length);
+                position += paddedLength(std::max(length, 0));
+                break;
+            }
+            case 'b': {
+                // Blobs come out as their size, the data itself doesn't fit in atoms
+                if ((ok = remaining >= 4)) {
+                    auto const blobSize = static_cast<int>(readInt(data + position));
+
+                    // The size comes from the packet, it has to fit in what's left of it
+                    if ((ok = blobSize >= 0 && blobSize <= remaining - 4)) {
+                        ok = message.addFloat(static_cast<float>(blobSize));
+                        position += 4 + ((blobSize + 3) & ~3);
+                    }
+                }
+                break;
+            }
+            case 'm':
+                if ((ok = remaining >= 4)) {
+                    for (int i = 0; i < 4 && ok; i++)
+                        ok = message.addFloat(data[position + i]);
+                }
+                position += 4;
+                break;
+            case 'T':
+                ok = message.addFloat(1.0f);
+                break;
+            case 'F':
+                ok = message.addFloat(0.0f);
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (ok)
+            enqueue();
+        else
+            drop();
+    }
+
+    static constexpr int maxPacketSize = 65536;
+
+    DatagramSocket socket;
+    int port;
+    bool isOSC;
+    NetworkMessage message; // Receive thread only
+};
+
+static t_class* netreceive_async_class;
+
+typedef struct _netreceive_async {
+    t_object x_obj;
+    t_clock* x_poll;
+    t_clock* x_scheduled;
+    bool x_osc;
+    int64 x_dropped;
+    NetworkReceiveThread* x_thread;
+    std::multimap<double, NetworkMessage>* x_pending; // Keyed by logical time
+} t_netreceive_async;
+
+static void netreceive_async_output(t_netreceive_async* x, NetworkMessage const& message)
+{
+    t_atom atoms[NetworkMessage::maxAtoms];
+    for (int i = 0; i < message.numAtoms; i++) {
+        auto const& atom = message.atoms[i];
+        if (atom.textStart < 0)
+            SETFLOAT(atoms + i, atom.value);
+        else
+            SETSYMBOL(atoms + i, gensym(message.text + atom.textStart));
+    }
+
+    // FUDI messages start with their selector, like they do in pd, OSC messages are lists like [oscparse] makes them
+    if (!x->x_osc && message.numAtoms > 0 && atoms[0].a_type == A_SYMBOL)
+        outlet_anything(x->x_obj.ob_outlet, atoms[0].a_w.w_symbol, message.numAtoms - 1, atoms + 1);
+    else
+        outlet_list(x->x_obj.ob_outlet, &s_list, message.numAtoms, atoms);
+}
+
+static void netreceive_async_reschedule(t_netreceive_async* x)
+{
+    if (x->x_pending->empty())
+        clock_unset(x->x_scheduled);
+    else
+        clock_set(x->x_scheduled, x->x_pending->begin()->first);
+}
+
+// Outputs the timetagged messages that are due now
+static void netreceive_async_scheduled(t_netreceive_async* x)
+{
+    auto const now = clock_getlogicaltime();
+    while (!x->x_pending->empty() && x->x_pending->begin()->first <= now) {
+        auto const message = x->x_pending->begin()->second;
+        x->x_pending->erase(x->x_pending->begin());
+        netreceive_async_output(x, message);
+    }
+    netreceive_async_reschedule(x);
+}
+
+// Runs once per block, in between DSP ticks
+static void netreceive_async_poll(t_netreceive_async* x)
+{
+    if (!x->x_thread)
+        return;
+
+    clock_delay(x->x_poll, 1);
+
+    auto const wallClock = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count()) / 1000.0;
+
+    bool scheduled = false;
+    NetworkMessage message;
+    while (x->x_thread->queue.try_dequeue(message)) {
+        auto const delay = message.timetag - wallClock;
+        if (message.timetag <= 0.0 || delay <= 0.0) {
+            netreceive_async_output(x, message);
+            if (!x->x_thread) // The outlet might have made us stop listening
+                return;
+            continue;
+        }
+
+        x->x_pending->emplace(clock_getsystimeafter(delay), message);
+        scheduled = true;
+    }
+
+    if (scheduled)
+        netreceive_async_reschedule(x);
+
+    auto const dropped = x->x_thread->numDropped.load(std::memory_order_relaxed);
+    if (dropped != x->x_dropped) {
+        pd_error(x, "netreceive.async: dropped %d messages, they were too long or came in faster than we could handle", static_cast<int>(dropped - x->x_dropped));
+        x->x_dropped = dropped;
+    }
+}
+
+static void netreceive_async_stop(t_netreceive_async* x)
+{
+    clock_unset(x->x_poll);
+
+    // Joining the thread can take as long as the socket blocks, so that happens on the message thread instead of pd's
+    if (auto* thread = std::exchange(x->x_thread, nullptr)) {
+        thread->stop();
+        if (!MessageManager::callAsync([thread]() { delete thread; }))
+            delete thread;
+    }
+
+    x->x_dropped = 0;
+}
+
+static void netreceive_async_listen(t_netreceive_async* x, t_floatarg port)
+{
+    netreceive_async_stop(x);
+
+    auto const portNumber = static_cast<int>(port);
+    if (portNumber <= 0)
+        return;
+
+    x->x_thread = new NetworkReceiveThread(portNumber, x->x_osc);
+    if (!x->x_thread->start()) {
+        pd_error(x, "netreceive.async: can't listen on port %d", portNumber);
+        netreceive_async_stop(x);
+        return;
+    }
+
+    clock_delay(x->x_poll, 1);
+}
+
+static void* netreceive_async_new(t_symbol* s, int argc, t_atom* argv)
+{
+    auto* x = reinterpret_cast<t_netreceive_async*>(pd_new(netreceive_async_class));
+    x->x_poll = clock_new(x, reinterpret_cast<t_method>(netreceive_async_poll));
+    x->x_scheduled = clock_new(x, reinterpret_cast<t_method>(netreceive_async_scheduled));
+    x->x_osc = false;
+    x->x_dropped = 0;
+    x->x_thread = nullptr;
+    x->x_pending = new std::multimap<double, NetworkMessage>();
+    outlet_new(&x->x_obj, &s_anything);
+
+    // Polls once per pd block
+    clock_setunit(x->x_poll, DEFDACBLKSIZE, 1);
+
+    int port = 0;
+    for (int i = 0; i < argc; i++) {
+        if (argv[i].a_type == A_FLOAT)
+            port = static_cast<int>(argv[i].a_w.w_float);
+        else if (argv[i].a_type == A_SYMBOL && !strcmp(argv[i].a_w.w_symbol->s_name, "-osc"))
+            x->x_osc = true;
+    }
+
+    if (port > 0)
+        netreceive_async_listen(x, port);
+
+    ignoreUnused(s);
+    return x;
+}
+
+static void netreceive_async_free(t_netreceive_async* x)
+{
+    netreceive_async_stop(x);
+    clock_free(x->x_poll);
+    clock_free(x->x_scheduled);
+    delete x->x_pending;
+}
+
+void NetworkReceiver::setup()
+{
+    netreceive_async_class = class_new(gensym("netreceive.async"), reinterpret_cast<t_newmethod>(netreceive_async_new), reinterpret_cast<t_method>(netreceive_async_free),
+        sizeof(t_netreceive_async), CLASS_DEFAULT, A_GIMME, 0);
+    class_addmethod(netreceive_async_class, reinterpret_cast<t_method>(netreceive_async_listen), gensym("listen"), A_FLOAT, 0);
+}
+
+}
@@ -0,0 +1,20 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+namespace pd {
+
+// [netreceive.async <port> [-osc]]: receives UDP packets on a thread of its own, instead of in pd's scheduler
+// Packets are parsed into atoms on that thread, FUDI by default or OSC with -osc, and handed over through a lock-free queue
+// The object picks them up once per block, so a burst of packets costs the audio thread little more than the outlet calls
+// OSC bundles with a timetag in the future are output at that time, in pd's logical time, so they land on the right sample
+// "listen <port>" moves to another port, "listen 0" stops listening
+struct NetworkReceiver {
+    static void setup();
+};
+
+}
@@ -0,0 +1,128 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <juce_core/juce_core.h>
+#include "Utility/Config.h"
+
+extern "C" {
+#include <m_pd.h>
+}
+
+#include "ParameterRamp.h"
+
+namespace pd {
+
+static t_class* param_tilde_class;
+
+typedef struct _param_tilde {
+    t_object x_obj;
+    t_symbol* x_name;
+    t_symbol* x_receiver;
+    t_float x_value;
+    t_float x_target;
+    t_float x_increment;
+    int x_samples_left;
+} t_param_tilde;
+
+static t_int* param_tilde_perform(t_int* w)
+{
+    auto* x = reinterpret_cast<t_param_tilde*>(w[1]);
+    auto* out = reinterpret_cast<t_sample*>(w[2]);
+    auto const n = static_cast<int>(w[3]);
+
+    int i = 0;
+    if (x->x_samples_left > 0) {
+        auto const rampLength = std::min(n, x->x_samples_left);
+        auto value = x->x_value;
+        for (; i < rampLength; i++) {
+            value += x->x_increment;
+            out[i] = value;
+        }
+
+        x->x_samples_left -= rampLength;
+        x->x_value = value;
+
+        // Adding up the increments drifts away from the target, so the last sample of the ramp is exactly the target
+        if (x->x_samples_left == 0) {
+            x->x_value = x->x_target;
+            out[rampLength - 1] = x->x_target;
+        }
+    }
+
+    for (; i < n; i++) {
+        out[i] = x->x_value;
+    }
+
+    return w + 4;
+}
+
+static void param_tilde_dsp(t_param_tilde* x, t_signal** sp)
+{
+    dsp_add(param_tilde_perform, 3, x, sp[0]->s_vec, static_cast<t_int>(sp[0]->s_n));
+}
+
+// A float jumps straight to the value
+static void param_tilde_float(t_param_tilde* x, t_floatarg f)
+{
+    x->x_value = f;
+    x->x_target = f;
+    x->x_samples_left = 0;
+}
+
+// "<value> <samples>" ramps to the value, reaching it after that many samples
+static void param_tilde_list(t_param_tilde* x, t_symbol*, int argc, t_atom* argv)
+{
+    auto const target = atom_getfloatarg(0, argc, argv);
+    auto const samples = static_cast<int>(atom_getfloatarg(1, argc, argv));
+
+    if (samples <= 0) {
+        param_tilde_float(x, target);
+        return;
+    }
+
+    x->x_target = target;
+    x->x_increment = (target - x->x_value) / static_cast<t_float>(samples);
+    x->x_samples_left = samples;
+}
+
+static void* param_tilde_new(t_symbol* name)
+{
+    auto* x = reinterpret_cast<t_param_tilde*>(pd_new(param_tilde_class));
+    x->x_name = name;
+    x->x_receiver = gensym((String(ParameterRamp::receiverPrefix) + String::fromUTF8(name->s_name)).toRawUTF8());
+    x->x_value = 0;
+    x->x_target = 0;
+    x->x_increment = 0;
+    x->x_samples_left = 0;
+    outlet_new(&x->x_obj, &s_signal);
+
+    if (*name->s_name) {
+        pd_bind(&x->x_obj.ob_pd, x->x_receiver);
+
+        // Ask the processor for the current value, otherwise we'd wait for the next time it changes
+        if (auto* request = gensym("param_ramp")->s_thing)
+            pd_symbol(request, name);
+    }
+
+    return x;
+}
+
+static void param_tilde_free(t_param_tilde* x)
+{
+    if (*x->x_name->s_name)
+        pd_unbind(&x->x_obj.ob_pd, x->x_receiver);
+}
+
+void ParameterRamp::setup()
+{
+    param_tilde_class = class_new(gensym("param~"), reinterpret_cast<t_newmethod>(param_tilde_new), reinterpret_cast<t_method>(param_tilde_free),
+        sizeof(t_param_tilde), CLASS_DEFAULT, A_DEFSYMBOL, 0);
+    class_addmethod(param_tilde_class, reinterpret_cast<t_method>(param_tilde_dsp), gensym("dsp"), A_CANT, 0);
+    class_addfloat(param_tilde_class, reinterpret_cast<t_method>(param_tilde_float));
+    class_addlist(param_tilde_class, reinterpret_cast<t_method>(param_tilde_list));
+}
+
+}
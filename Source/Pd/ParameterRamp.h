@@ -0,0 +1,21 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+namespace pd {
+
+// [param~ <name>]: outputs a DAW parameter as a signal
+// Host automation only reaches us once per host block, so instead of jumping to the new value, this ramps to it over the length of the block
+// That saves patches from smoothing the steps with [line~]. While the value doesn't change, it just outputs a constant
+struct ParameterRamp {
+    static void setup();
+
+    // The processor sends "<value> <samples>" to the parameter name with this prefix, whenever the parameter changes
+    static constexpr char const* receiverPrefix = "param~:";
+};
+
+}
@@ -7,6 +7,7 @@
 
 #include "Utility/Config.h"
 #include "Utility/Fonts.h"
+#include "Utility/TraceRecorder.h"
 
 #include "Patch.h"
 #include "Instance.h"
@@ -24,8 +25,14 @@ extern "C" {
 #include "g_undo.h"
 
 extern void canvas_reload(t_symbol* name, t_symbol* dir, t_glist* except);
+
+t_glist* clone_get_instance(t_gobj*, int);
+int clone_get_n(t_gobj*);
 }
 
+#include "InstanceAccess.h"
+#include "Objects/AllGuis.h"
+
 namespace pd {
 
 Patch::Patch(pd::WeakReference patchPtr, Instance* parentInstance, bool ownsPatch, File patchFile)
@@ -140,6 +147,89 @@ bool Patch::isSubpatch()
     return false;
 }
 
+Patch::DSPContext Patch::getDSPContext(t_canvas* cnv)
+{
+    static auto* blockSymbol = gensym("block~");
+    static auto* switchSymbol = gensym("switch~");
+
+    DSPContext context;
+    for (auto* y = cnv->gl_list; y; y = y->g_next) {
+        // switch~ creates a block~ too, only the name it was typed with tells them apart
+        if (pd_class(&y->g_pd)->c_name != blockSymbol)
+            continue;
+
+        auto* object = pd_checkobject(&y->g_pd);
+        auto const argc = binbuf_getnatom(object->te_binbuf);
+        auto* argv = binbuf_getvec(object->te_binbuf);
+
+        context.object = object;
+        context.isSwitch = argc > 0 && argv[0].a_type == A_SYMBOL && argv[0].a_w.w_symbol == switchSymbol;
+        context.blockSize = static_cast<int>(atom_getfloatarg(1, argc, argv));
+        context.overlap = std::max(static_cast<int>(atom_getfloatarg(2, argc, argv)), 1);
+        context.resampling = argc > 3 ? atom_getfloatarg(3, argc, argv) : 1.0f;
+        if (context.resampling <= 0.0f)
+            context.resampling = 1.0f;
+        break;
+    }
+
+    return context;
+}
+
+Patch::DSPContext Patch::getDSPContext()
+{
+    if (auto patch = ptr.get<t_canvas>()) {
+        return getDSPContext(patch.get());
+    }
+
+    return {};
+}
+
+int Patch::getVectorSize(t_canvas* cnv)
+{
+    if (!cnv)
+        return Instance::getBlockSize();
+
+    auto const context = getDSPContext(cnv);
+    if (context.blockSize > 0)
+        return context.blockSize;
+
+    // Follows its parent's block, but at its own rate
+    return std::max(1, roundToInt(static_cast<float>(getVectorSize(cnv->gl_owner)) * context.resampling));
+}
+
+void Patch::setDSPContext(int blockSize, int upsampling)
+{
+    auto const context = getDSPContext();
+    auto const followsParent = blockSize <= 0 && upsampling <= 1;
+
+    // The parent's block could itself be upsampled, so it can be longer than the top-level block
+    auto parentVectorSize = Instance::getBlockSize();
+    if (auto patch = ptr.get<t_canvas>())
+        parentVectorSize = getVectorSize(patch->gl_owner);
+
+    // pd counts the block size at the upsampled rate
+    auto const vectorSize = followsParent ? 0 : (blockSize > 0 ? blockSize : parentVectorSize) * std::max(upsampling, 1);
+
+    String text = context.isSwitch ? "switch~" : "block~";
+    if (!followsParent || context.overlap != 1)
+        text << " " << vectorSize << " " << context.overlap << " " << std::max(upsampling, 1);
+
+    // A switch~ stays, it's also what turns this patch on and off
+    if (text == "block~") {
+        if (context.object) {
+            removeObjects({ &context.object->te_g });
+            finishRemove();
+        }
+        return;
+    }
+
+    if (context.object) {
+        renameObject(context.object, text);
+    } else {
+        createObject(20, 20, text);
+    }
+}
+
 void Patch::updateUndoRedoState()
 {
     if (auto patch = ptr.get<t_glist>()) {
@@ -147,9 +237,11 @@ void Patch::updateUndoRedoState()
         canPatchRedo = pd::Interface::canRedo(patch.get());
         isPatchDirty = patch->gl_dirty;
 
-        auto undoSize = pd::Interface::getUndoSize(patch.get());
-        if (undoQueueSize != undoSize) {
-            undoQueueSize = undoSize;
+        // Only the ends of the queue matter for the undo/redo strings, so don't walk the whole history to find out if it changed
+        auto* undoQueue = canvas_undo_get(patch.get());
+        auto* undoAction = undoQueue ? undoQueue->u_last : nullptr;
+        auto* redoAction = undoAction ? undoAction->next : nullptr;
+        if (undoAction != lastUndoAction || redoAction != lastRedoAction) {
             updateUndoRedoString();
         }
     }
@@ -196,6 +288,54 @@ void Patch::setVisible(bool shouldVis)
     }
 }
 
+static void addMemoryUsage(t_glist* glist, Patch::MemoryUsage& usage)
+{
+    for (t_gobj* y = glist->gl_list; y; y = y->g_next) {
+        auto* pdClass = pd_class(&y->g_pd);
+        usage.numObjects++;
+        usage.objectBytes += pdClass->c_size;
+
+        if (pdClass == canvas_class) {
+            addMemoryUsage(reinterpret_cast<t_glist*>(y), usage);
+        } else if (pdClass == clone_class) {
+            for (int i = 0; i < clone_get_n(y); i++) {
+                usage.numCloneInstances++;
+                addMemoryUsage(clone_get_instance(y, i), usage);
+            }
+        } else if (pdClass == garray_class) {
+            if (auto* array = garray_getarray(reinterpret_cast<t_garray*>(y))) {
+                usage.numArrays++;
+                usage.arrayBytes += static_cast<size_t>(array->a_n) * array->a_elemsize;
+            }
+        } else {
+            // [text define], [qlist] and [textfile] all start with the same text buffer
+            auto const* name = pdClass->c_name->s_name;
+            if (!strcmp(name, "text define") || !strcmp(name, "qlist") || !strcmp(name, "textfile")) {
+                if (auto* binbuf = reinterpret_cast<t_fake_textbuf*>(y)->b_binbuf) {
+                    usage.numTextBuffers++;
+                    usage.textBytes += static_cast<size_t>(binbuf_getnatom(binbuf)) * sizeof(t_atom);
+                }
+            }
+        }
+    }
+}
+
+Patch::MemoryUsage Patch::getMemoryUsage() const
+{
+    if (auto patch = ptr.get<t_glist>())
+        return getMemoryUsage(patch.get());
+
+    return {};
+}
+
+Patch::MemoryUsage Patch::getMemoryUsage(t_glist* patch)
+{
+    MemoryUsage usage;
+    addMemoryUsage(patch, usage);
+    usage.numUndoSteps = pd::Interface::getUndoSize(patch);
+    return usage;
+}
+
 Connections Patch::getConnections() const
 {
     Connections connections;
@@ -229,31 +369,32 @@ std::vector<pd::WeakReference> Patch::getObjects()
     return objects;
 }
 
-t_gobj* Patch::createObject(int x, int y, String const& name)
+t_symbol* Patch::parseObject(int x, int y, String const& name, std::vector<t_atom>& atoms, String& patchText, std::set<String>* reservedArrayNames)
 {
-
     StringArray tokens;
     tokens.addTokens(name.replace("\\ ", "__%SPACE%__"), true); // Prevent "/ " from being tokenised
 
     ObjectThemeManager::get()->formatObject(tokens);
 
-    if (tokens[0] == "garray") {
-        if (auto patch = ptr.get<t_glist>()) {
-            auto arrayPasta = "#N canvas 0 0 450 250 (subpatch) 0;\n#X array @arrName 100 float 2;\n#X coords 0 1 100 -1 200 140 1;\n#X restore " + String(x) + " " + String(y) + " graph;";
-
-            instance->setThis();
-            auto* newArraySymbol = pd::Interface::getUnusedArrayName();
-            arrayPasta = arrayPasta.replace("@arrName", String::fromUTF8(newArraySymbol->s_name));
+    instance->setThis();
 
-            pd::Interface::paste(patch.get(), arrayPasta.toRawUTF8());
-            return pd::Interface::getNewest(patch.get());
-        }
-    } else if (tokens[0] == "graph") {
-        if (auto patch = ptr.get<t_glist>()) {
-            auto graphPasta = "#N canvas 0 0 450 250 (subpatch) 1;\n#X coords 0 1 100 -1 200 140 1 0 0;\n#X restore " + String(x) + " " + String(y) + " graph;";
-            pd::Interface::paste(patch.get(), graphPasta.toRawUTF8());
-            return pd::Interface::getNewest(patch.get());
+    if (tokens[0] == "garray") {
+        patchText = "#N canvas 0 0 450 250 (subpatch) 0;\n#X array @arrName 100 float 2;\n#X coords 0 1 100 -1 200 140 1;\n#X restore " + String(x) + " " + String(y) + " graph;";
+
+        auto arrayName = String::fromUTF8(pd::Interface::getUnusedArrayName()->s_name);
+        if (reservedArrayNames) {
+            // The arrays earlier in a batch don't exist yet, so they can't be found by name
+            for (int i = 1; reservedArrayNames->count(arrayName) || pd_findbyclass(instance->generateSymbol(arrayName), garray_class); i++)
+                arrayName = "array" + String(i);
+            reservedArrayNames->insert(arrayName);
         }
+
+        patchText = patchText.replace("@arrName", arrayName);
+        return nullptr;
+    }
+    if (tokens[0] == "graph") {
+        patchText = "#N canvas 0 0 450 250 (subpatch) 1;\n#X coords 0 1 100 -1 200 140 1 0 0;\n#X restore " + String(x) + " " + String(y) + " graph;";
+        return nullptr;
     }
 
     t_symbol* typesymbol = instance->generateSymbol("obj");
@@ -284,13 +425,11 @@ t_gobj* Patch::createObject(int x, int y, String const& name)
 
     tokens.removeEmptyStrings();
 
-    int argc = tokens.size() + 2;
-
-    auto argv = std::vector<t_atom>(argc);
+    atoms.resize(tokens.size() + 2);
 
     // Set position
-    SETFLOAT(argv.data(), static_cast<float>(x));
-    SETFLOAT(argv.data() + 1, static_cast<float>(y));
+    SETFLOAT(atoms.data(), static_cast<float>(x));
+    SETFLOAT(atoms.data() + 1, static_cast<float>(y));
 
     for (int i = 0; i < tokens.size(); i++) {
         // check if string is a valid number
@@ -299,21 +438,134 @@ t_gobj* Patch::createObject(int x, int y, String const& name)
         auto ptr = charptr;
         CharacterFunctions::readDoubleValue(ptr); // This will read the number and increment the pointer to be past the number
         if (ptr - charptr == token.getNumBytesAsUTF8()) {
-            SETFLOAT(argv.data() + i + 2, token.getFloatValue());
+            SETFLOAT(atoms.data() + i + 2, token.getFloatValue());
         } else {
-            SETSYMBOL(argv.data() + i + 2, instance->generateSymbol(token));
+            SETSYMBOL(atoms.data() + i + 2, instance->generateSymbol(token));
         }
     }
 
+    return typesymbol;
+}
+
+t_gobj* Patch::createObject(int x, int y, String const& name)
+{
+    std::vector<t_atom> argv;
+    String patchText;
+    auto* typesymbol = parseObject(x, y, name, argv, patchText);
+
     if (auto patch = ptr.get<t_glist>()) {
+        if (patchText.isNotEmpty()) {
+            pd::Interface::paste(patch.get(), patchText.toRawUTF8());
+            return pd::Interface::getNewest(patch.get());
+        }
+
         setCurrent();
         pd::Interface::getInstanceEditor()->canvas_undo_already_set_move = 1;
-        return pd::Interface::createObject(patch.get(), typesymbol, argc, argv.data());
+        deferDSPRebuild();
+        return pd::Interface::createObject(patch.get(), typesymbol, static_cast<int>(argv.size()), argv.data());
     }
 
     return nullptr;
 }
 
+int Patch::ObjectBatch::addObject(int x, int y, String const& name)
+{
+    objects.push_back({ { x, y }, name, String() });
+    return static_cast<int>(objects.size()) - 1;
+}
+
+int Patch::ObjectBatch::addPatchText(String const& text)
+{
+    objects.push_back({ {}, String(), text });
+    return static_cast<int>(objects.size()) - 1;
+}
+
+void Patch::ObjectBatch::connect(Endpoint source, int outlet, Endpoint sink, int inlet)
+{
+    connections.push_back({ source, outlet, sink, inlet });
+}
+
+std::vector<t_gobj*> Patch::createObjects(ObjectBatch const& batch, String const& undoName)
+{
+    std::vector<t_gobj*> created;
+
+    auto patch = ptr.get<t_glist>();
+    if (!patch || batch.objects.empty())
+        return created;
+
+    setCurrent();
+
+    // Write the whole batch as patch text atoms, so pd creates it in one paste, instead of one object at a time
+    auto* atoms = binbuf_new();
+    auto* textBuffer = binbuf_new();
+    std::set<String> reservedArrayNames;
+    for (auto const& object : batch.objects) {
+        String patchText = object.patchText;
+        if (patchText.isEmpty()) {
+            std::vector<t_atom> argv;
+            if (auto* type = parseObject(object.position.x, object.position.y, object.name, argv, patchText, &reservedArrayNames)) {
+                binbuf_addv(atoms, "ss", instance->generateSymbol("#X"), type);
+                binbuf_add(atoms, static_cast<int>(argv.size()), argv.data());
+                binbuf_addsemi(atoms);
+                continue;
+            }
+        }
+
+        binbuf_text(textBuffer, patchText.toRawUTF8(), patchText.getNumBytesAsUTF8());
+        binbuf_add(atoms, binbuf_getnatom(textBuffer), binbuf_getvec(textBuffer));
+    }
+    binbuf_free(textBuffer);
+
+    auto const numBatchObjects = static_cast<int>(batch.objects.size());
+    for (auto const& connection : batch.connections) {
+        if (isPositiveAndBelow(connection.source.index, numBatchObjects) && isPositiveAndBelow(connection.sink.index, numBatchObjects))
+            binbuf_addv(atoms, "ssiiii;", instance->generateSymbol("#X"), instance->generateSymbol("connect"), connection.source.index, connection.outlet, connection.sink.index, connection.inlet);
+    }
+
+    startUndoSequence(undoName);
+    deferDSPRebuild();
+
+    int numExisting = 0;
+    for (auto* y = patch->gl_list; y; y = y->g_next)
+        numExisting++;
+
+    auto* copyBuffer = pd::Interface::getInstanceEditor()->copy_binbuf;
+    binbuf_clear(copyBuffer);
+    binbuf_add(copyBuffer, binbuf_getnatom(atoms), binbuf_getvec(atoms));
+    binbuf_free(atoms);
+    pd::Interface::pasteCopyBuffer(patch.get());
+
+    int index = 0;
+    for (auto* y = patch->gl_list; y; y = y->g_next) {
+        if (index++ >= numExisting)
+            created.push_back(y);
+    }
+
+    // Connections to objects that were already in the patch can't be part of the pasted text
+    auto getObject = [&created](ObjectBatch::Endpoint const& endpoint) -> t_object* {
+        if (endpoint.existing)
+            return endpoint.existing;
+        if (isPositiveAndBelow(endpoint.index, static_cast<int>(created.size())))
+            return pd::Interface::checkObject(created[endpoint.index]);
+        return nullptr;
+    };
+
+    for (auto const& connection : batch.connections) {
+        if (!connection.source.existing && !connection.sink.existing)
+            continue;
+
+        auto* source = getObject(connection.source);
+        auto* sink = getObject(connection.sink);
+        if (source && sink && pd::Interface::canConnect(patch.get(), source, connection.outlet, sink, connection.inlet))
+            pd::Interface::createConnection(patch.get(), source, connection.outlet, sink, connection.inlet);
+    }
+
+    glist_noselect(patch.get());
+    endUndoSequence(undoName);
+
+    return created;
+}
+
 t_gobj* Patch::renameObject(t_object* obj, String const& name)
 {
     StringArray tokens;
@@ -325,6 +577,7 @@ t_gobj* Patch::renameObject(t_object* obj, String const& name)
     if (auto patch = ptr.get<t_glist>()) {
         setCurrent();
 
+        deferDSPRebuild();
         pd::Interface::renameObject(patch.get(), &obj->te_g, newName.toRawUTF8(), newName.getNumBytesAsUTF8());
         return pd::Interface::getNewest(patch.get());
     }
@@ -338,110 +591,80 @@ void Patch::copy(std::vector<t_gobj*> const& objects)
         int size;
         char const* text = pd::Interface::copy(patch.get(), &size, objects);
         auto copied = String::fromUTF8(text, size);
+
+        // Pasting this back in doesn't need to parse the text again
+        instance->setPatchAtoms(copied, pd::Interface::getInstanceEditor()->copy_binbuf);
         MessageManager::callAsync([copied]() mutable { SystemClipboard::copyTextToClipboard(copied); });
     }
 }
 
-String Patch::translatePatchAsString(String const& patchAsString, Point<int> position)
+void Patch::translatePatchAtoms(t_binbuf* atoms, Point<int> position)
 {
-    int minX = std::numeric_limits<int>::max();
-    int minY = std::numeric_limits<int>::max();
-
-    int canvasDepth = 0;
-
-    auto isObject = [](StringArray& tokens) {
-        return tokens[0] == "#X" && tokens[1] != "connect" && tokens[1] != "f" && tokens[2].containsOnly("-0123456789") && tokens[3].containsOnly("-0123456789");
-    };
-
-    // blank message objects have a comma after their position: "#X msg 0 0, f 9;"
-    // this normally isn't an issue, but because they are blank, the comma is next to the number token and doesn't get parsed correctly
-    auto isMsg = [](StringArray& tokens) {
-        return tokens[0] == "#X" && tokens[1] == "msg";
-    };
-
-    auto isStartingCanvas = [](StringArray& tokens) {
-        return tokens[0] == "#N" && tokens[1] == "canvas" && tokens[2].containsOnly("-0123456789") && tokens[3].containsOnly("-0123456789") && tokens[4].containsOnly("-0123456789") && tokens[5].containsOnly("-0123456789");
-    };
-
-    auto isEndingCanvas = [](StringArray& tokens) {
-        return tokens[0] == "#X" && tokens[1] == "restore" && tokens[2].containsOnly("-0123456789") && tokens[3].containsOnly("-0123456789");
-    };
-
-    for (auto& line : StringArray::fromLines(patchAsString)) {
-
-        line = line.upToLastOccurrenceOf(";", false, false);
-
-        auto tokens = StringArray::fromTokens(line, true);
-
-        if (isStartingCanvas(tokens)) {
-            canvasDepth++;
-        }
-
-        if (canvasDepth == 0) {
-            if (isObject(tokens)) {
-                minX = std::min(minX, tokens[2].getIntValue());
-                minY = std::min(minY, tokens[3].getIntValue());
-            } else if (isMsg(tokens)) {
-                minX = std::min(minX, tokens[2].getIntValue());
-                minY = std::min(minY, tokens[3].removeCharacters(",").getIntValue());
+    auto* vec = binbuf_getvec(atoms);
+    int const numAtoms = binbuf_getnatom(atoms);
+
+    // Calls the callback with the index of every message that has a position we need to move: objects in the top-level of the pasted patch, and subpatches that end there
+    auto forEachPosition = [vec, numAtoms](auto const& callback) {
+        int canvasDepth = 0;
+        int start = 0;
+        while (start < numAtoms) {
+            int end = start;
+            while (end < numAtoms && vec[end].a_type != A_SEMI)
+                end++;
+
+            auto isSymbol = [vec, end](int index, char const* name) {
+                return index < end && vec[index].a_type == A_SYMBOL && !strcmp(vec[index].a_w.w_symbol->s_name, name);
+            };
+            auto hasPosition = end - start >= 4 && vec[start + 2].a_type == A_FLOAT && vec[start + 3].a_type == A_FLOAT;
+
+            if (isSymbol(start, "#N") && isSymbol(start + 1, "canvas")) {
+                canvasDepth++;
             }
-        }
 
-        if (isEndingCanvas(tokens)) {
-            if (canvasDepth == 1) {
-                minX = std::min(minX, tokens[2].getIntValue());
-                minY = std::min(minY, tokens[3].getIntValue());
+            if (canvasDepth == 0 && hasPosition && isSymbol(start, "#X") && !isSymbol(start + 1, "connect") && !isSymbol(start + 1, "f")) {
+                callback(start);
             }
-            canvasDepth--;
-        }
-    }
 
-    canvasDepth = 0;
-    auto toPaste = StringArray::fromLines(patchAsString);
-    for (auto& line : toPaste) {
-        line = line.upToLastOccurrenceOf(";", false, false);
-        auto tokens = StringArray::fromTokens(line, true);
-        if (isStartingCanvas(tokens)) {
-            canvasDepth++;
-        }
-
-        if (canvasDepth == 0) {
-            if (isObject(tokens)) {
-                tokens.set(2, String(tokens[2].getIntValue() - minX + position.x));
-                tokens.set(3, String(tokens[3].getIntValue() - minY + position.y));
-                line = tokens.joinIntoString(" ");
-            } else if (isMsg(tokens)) {
-                tokens.set(2, String(tokens[2].getIntValue() - minX + position.x));
-                tokens.set(3, String(tokens[3].removeCharacters(",").getIntValue() - minY + position.y) + ",");
-                line = tokens.joinIntoString(" ");
-            }
-        }
-
-        if (isEndingCanvas(tokens)) {
-            if (canvasDepth == 1) {
-                tokens.set(2, String(tokens[2].getIntValue() - minX + position.x));
-                tokens.set(3, String(tokens[3].getIntValue() - minY + position.y));
+            if (isSymbol(start, "#X") && isSymbol(start + 1, "restore")) {
+                if (canvasDepth == 1 && hasPosition)
+                    callback(start);
+                canvasDepth--;
             }
 
-            line = tokens.joinIntoString(" ");
-
-            canvasDepth--;
+            start = end + 1;
         }
+    };
 
-        line += ";";
-    }
+    int minX = std::numeric_limits<int>::max();
+    int minY = std::numeric_limits<int>::max();
+    forEachPosition([vec, &minX, &minY](int message) {
+        minX = std::min(minX, static_cast<int>(atom_getfloat(vec + message + 2)));
+        minY = std::min(minY, static_cast<int>(atom_getfloat(vec + message + 3)));
+    });
 
-    return toPaste.joinIntoString("\n");
+    forEachPosition([vec, minX, minY, position](int message) {
+        SETFLOAT(vec + message + 2, static_cast<int>(atom_getfloat(vec + message + 2)) - minX + position.x);
+        SETFLOAT(vec + message + 3, static_cast<int>(atom_getfloat(vec + message + 3)) - minY + position.y);
+    });
 }
 
 void Patch::paste(Point<int> position)
 {
-    auto text = SystemClipboard::getTextFromClipboard();
-
-    auto translatedObjects = translatePatchAsString(text, position);
+    paste(SystemClipboard::getTextFromClipboard(), position);
+}
 
+void Patch::paste(String const& patchText, Point<int> position)
+{
     if (auto patch = ptr.get<t_glist>()) {
-        pd::Interface::paste(patch.get(), translatedObjects.toRawUTF8());
+        // Patch text that was copied or pasted before is still around as atoms, so it only has to be moved, not parsed again
+        auto* atoms = instance->getPatchAtoms(patchText);
+        auto* copyBuffer = pd::Interface::getInstanceEditor()->copy_binbuf;
+        binbuf_clear(copyBuffer);
+        binbuf_add(copyBuffer, binbuf_getnatom(atoms), binbuf_getvec(atoms));
+        translatePatchAtoms(copyBuffer, position);
+
+        deferDSPRebuild();
+        pd::Interface::pasteCopyBuffer(patch.get());
     }
 }
 
@@ -449,6 +672,7 @@ void Patch::duplicate(std::vector<t_gobj*> const& objects, t_outconnect* connect
 {
     if (auto patch = ptr.get<t_glist>()) {
         setCurrent();
+        deferDSPRebuild();
         pd::Interface::duplicateSelection(patch.get(), objects, connection);
     }
 }
@@ -483,6 +707,7 @@ void Patch::createConnection(t_object* src, int nout, t_object* sink, int nin)
 {
     if (auto patch = ptr.get<t_glist>()) {
         setCurrent();
+        deferDSPRebuild();
         pd::Interface::createConnection(patch.get(), src, nout, sink, nin);
     }
 }
@@ -491,6 +716,7 @@ t_outconnect* Patch::createAndReturnConnection(t_object* src, int nout, t_object
 {
     if (auto patch = ptr.get<t_glist>()) {
         setCurrent();
+        deferDSPRebuild();
         return pd::Interface::createConnection(patch.get(), src, nout, sink, nin);
     }
 
@@ -501,6 +727,7 @@ void Patch::removeConnection(t_object* src, int nout, t_object* sink, int nin, t
 {
     if (auto patch = ptr.get<t_glist>()) {
         setCurrent();
+        deferDSPRebuild();
         pd::Interface::removeConnection(patch.get(), src, nout, sink, nin, connectionPath);
     }
 }
@@ -544,12 +771,16 @@ void Patch::removeObjects(std::vector<t_gobj*> const& objects)
 {
     if (auto patch = ptr.get<t_glist>()) {
         setCurrent();
+        deferDSPRebuild();
         pd::Interface::removeObjects(patch.get(), objects);
     }
 }
 
 void Patch::startUndoSequence(String const& name)
 {
+    finishUndoGesture();
+
+    undoSequenceDepth++;
     if (auto patch = ptr.get<t_glist>()) {
         canvas_undo_add(patch.get(), UNDO_SEQUENCE_START, instance->generateSymbol(name)->s_name, nullptr);
     }
@@ -557,15 +788,77 @@ void Patch::startUndoSequence(String const& name)
 
 void Patch::endUndoSequence(String const& name)
 {
+    undoSequenceDepth = std::max(undoSequenceDepth - 1, 0);
     if (auto patch = ptr.get<t_glist>()) {
         canvas_undo_add(patch.get(), UNDO_SEQUENCE_END, instance->generateSymbol(name)->s_name, nullptr);
 
+        // Only at the end of the sequence that suspended it, so a long gesture around it doesn't keep DSP off
+        if (undoSequenceDepth < dspSuspendedAtDepth)
+            finishDeferredDSPRebuild();
+
         updateUndoRedoString();
     }
 }
 
+// Call while holding the pd lock
+void Patch::deferDSPRebuild()
+{
+    if (undoSequenceDepth == 0 || suspendedDSPState >= 0)
+        return;
+
+    instance->setThis();
+    suspendedDSPState = canvas_suspend_dsp();
+    dspSuspendedAtDepth = undoSequenceDepth;
+
+    // Some sequences stay open for a whole mouse gesture, DSP should never be off for longer than the edits we're handling right now
+    MessageManager::callAsync([_this = Ptr(this)]() {
+        DSPRebuildSmoother::ScopedRebuild rebuild(_this->instance->rebuildSmoother);
+        _this->instance->setThis();
+        sys_lock();
+        _this->finishDeferredDSPRebuild();
+        sys_unlock();
+    });
+}
+
+// Call while holding the pd lock
+void Patch::finishDeferredDSPRebuild()
+{
+    if (suspendedDSPState < 0)
+        return;
+
+    TraceRecorder::Scope trace("DSP rebuild");
+    DSPRebuildSmoother::ScopedRebuild rebuild(instance->rebuildSmoother);
+    instance->setThis();
+    canvas_resume_dsp(suspendedDSPState);
+    trace.setCount(plugdata_dspchainsize(libpd_this_instance()));
+
+    suspendedDSPState = -1;
+    dspSuspendedAtDepth = 0;
+}
+
+void Patch::continueUndoGesture(String const& name)
+{
+    if (openUndoGesture == name)
+        return;
+
+    startUndoSequence(name);
+    openUndoGesture = name;
+}
+
+void Patch::finishUndoGesture()
+{
+    if (openUndoGesture.isEmpty())
+        return;
+
+    auto name = openUndoGesture;
+    openUndoGesture = String();
+    endUndoSequence(name);
+}
+
 void Patch::undo()
 {
+    finishUndoGesture();
+
     if (auto patch = ptr.get<t_glist>()) {
         setCurrent();
         auto x = patch.get();
@@ -580,6 +873,8 @@ void Patch::undo()
 
 void Patch::redo()
 {
+    finishUndoGesture();
+
     if (auto patch = ptr.get<t_glist>()) {
         setCurrent();
         auto x = patch.get();
@@ -600,6 +895,9 @@ void Patch::updateUndoRedoString()
         auto undo = currentUndo;
         auto redo = currentUndo->next;
 
+        lastUndoAction = undo;
+        lastRedoAction = redo;
+
 #ifdef DEBUG_UNDO_QUEUE
         auto undoDbg = undo;
         auto redoDbg = redo;
@@ -759,6 +1057,45 @@ void Patch::reloadPatch(File const& changedPatch, t_glist* except)
     canvas_reload(file, dir, except);
 }
 
+bool Patch::isAffectedByReload(t_glist* glist, File const& changedPatch)
+{
+    // Same test that canvas_reload uses to find the instances it reloads
+    auto* dir = gensym(changedPatch.getParentDirectory().getFullPathName().replace("\\", "/").toRawUTF8());
+    auto* file = gensym(changedPatch.getFileName().toRawUTF8());
+    auto isInstance = [dir, file](t_glist* x) {
+        return x->gl_name == file && canvas_isabstraction(x) && canvas_getdir(x) == dir;
+    };
+
+    for (auto* owner = glist; owner; owner = owner->gl_owner) {
+        if (isInstance(owner))
+            return true;
+    }
+
+    std::function<bool(t_glist*)> containsInstance = [&](t_glist* x) {
+        for (t_gobj* y = x->gl_list; y; y = y->g_next) {
+            // The instances of a [clone] aren't in the patch, but they're reloaded as well
+            if (pd_class(&y->g_pd) == clone_class) {
+                for (int i = 0; i < clone_get_n(y); i++) {
+                    auto* child = clone_get_instance(y, i);
+                    if (isInstance(child) || containsInstance(child))
+                        return true;
+                }
+                continue;
+            }
+
+            if (pd_class(&y->g_pd) != canvas_class)
+                continue;
+
+            auto* child = reinterpret_cast<t_glist*>(y);
+            if (isInstance(child) || containsInstance(child))
+                return true;
+        }
+        return false;
+    };
+
+    return containsInstance(glist);
+}
+
 bool Patch::objectWasDeleted(t_gobj* objectPtr) const
 {
     if (auto patch = ptr.get<t_glist>()) {
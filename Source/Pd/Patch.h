@@ -41,6 +41,51 @@ public:
     t_gobj* createObject(int x, int y, String const& name);
     t_gobj* renameObject(t_object* obj, String const& name);
 
+    // A list of objects and connections that are created together, in a single paste
+    // Objects are written the same way as for createObject, or as patch text for a single object that needs more than one line, like a subpatch
+    // Connections refer to objects in the batch by their index, or to objects that are already in the patch
+    struct ObjectBatch {
+        struct Endpoint {
+            Endpoint(int objectIndex)
+                : index(objectIndex)
+            {
+            }
+            Endpoint(t_object* existingObject)
+                : existing(existingObject)
+            {
+            }
+
+            int index = -1;
+            t_object* existing = nullptr;
+        };
+
+        struct Object {
+            Point<int> position;
+            String name;
+            String patchText;
+        };
+
+        struct Connection {
+            Endpoint source;
+            int outlet;
+            Endpoint sink;
+            int inlet;
+        };
+
+        // Both return the index of the new object
+        int addObject(int x, int y, String const& name);
+        int addPatchText(String const& text);
+
+        void connect(Endpoint source, int outlet, Endpoint sink, int inlet);
+
+        std::vector<Object> objects;
+        std::vector<Connection> connections;
+    };
+
+    // Creates everything in the batch as one undo step, returns the new objects in the order they were added
+    // Call this while holding the audio lock, and synchronise the canvas once afterwards
+    std::vector<t_gobj*> createObjects(ObjectBatch const& batch, String const& undoName);
+
     void moveObjects(std::vector<t_gobj*> const&, int x, int y);
 
     void moveObjectTo(t_gobj* object, int x, int y);
@@ -52,19 +97,47 @@ public:
 
     bool isSubpatch();
 
+    // The block~ or switch~ object that sets the block size and resampling of a patch
+    struct DSPContext {
+        t_object* object = nullptr;
+        bool isSwitch = false;
+        int blockSize = 0; // 0 follows the parent
+        int overlap = 1;
+        float resampling = 1.0f; // Above 1 upsamples, below 1 downsamples
+    };
+
+    // The caller needs to hold the audio lock
+    static DSPContext getDSPContext(t_canvas* cnv);
+    DSPContext getDSPContext();
+
+    // The number of samples a patch processes per block, at its own rate, nullptr for the top-level block size
+    // The caller needs to hold the audio lock
+    static int getVectorSize(t_canvas* cnv);
+
+    // Changes, adds or removes the block~ of this patch so that it runs at this block size and upsampling
+    // The block size is counted in samples at the parent's rate, 0 keeps the parent's block size
+    void setDSPContext(int blockSize, int upsampling);
+
     void setVisible(bool shouldVis);
 
-    static String translatePatchAsString(String const& clipboardContent, Point<int> position);
+    // Moves the top-level objects in a pasted patch so that their top-left corner ends up at position
+    static void translatePatchAtoms(t_binbuf* atoms, Point<int> position);
 
     t_glist* getRoot();
 
     void copy(std::vector<t_gobj*> const& objects);
     void paste(Point<int> position);
+    void paste(String const& patchText, Point<int> position);
     void duplicate(std::vector<t_gobj*> const& objects, t_outconnect* connection);
 
     void startUndoSequence(String const& name);
     void endUndoSequence(String const& name);
 
+    // Keeps adding to one undo step for as long as the same gesture goes on, like nudging objects with the arrow keys
+    // The step is closed by finishUndoGesture, or as soon as anything else starts a sequence or undoes/redoes
+    void continueUndoGesture(String const& name);
+    void finishUndoGesture();
+
     void undo();
     void redo();
 
@@ -100,6 +173,25 @@ public:
 
     Connections getConnections() const;
 
+    // Estimate of the memory pd uses for this patch, including its subpatches, abstractions and clone instances
+    // Only counts what we can see from the outside: the objects themselves, array data and the contents of text buffers
+    struct MemoryUsage {
+        int numObjects = 0;
+        size_t objectBytes = 0;
+        int numArrays = 0;
+        size_t arrayBytes = 0;
+        int numTextBuffers = 0;
+        size_t textBytes = 0;
+        int numCloneInstances = 0;
+        int numUndoSteps = 0;
+
+        size_t getTotalBytes() const { return objectBytes + arrayBytes + textBytes; }
+    };
+
+    // Call these while holding the audio lock
+    MemoryUsage getMemoryUsage() const;
+    static MemoryUsage getMemoryUsage(t_glist* patch);
+
     WeakReference::Ptr<t_canvas> getPointer() const
     {
         return ptr.get<t_canvas>();
@@ -117,6 +209,10 @@ public:
 
     static void reloadPatch(File const& changedPatch, t_glist* except);
 
+    // True if reloading this abstraction changes what's inside the glist:
+    // either the glist contains an instance of it somewhere, or it's a part of such an instance itself
+    static bool isAffectedByReload(t_glist* glist, File const& changedPatch);
+
     String getTitle() const;
     void setTitle(String const& title);
     void setUntitled();
@@ -139,6 +235,10 @@ public:
     void updateUndoRedoString();
 
 private:
+    // Turns the text of an object box into the atoms that pd creates it from, after the type and position
+    // Arrays and graphs are returned as patch text instead, arrays get a name that's not in use yet, or in reservedArrayNames
+    t_symbol* parseObject(int x, int y, String const& name, std::vector<t_atom>& atoms, String& patchText, std::set<String>* reservedArrayNames = nullptr);
+
     std::atomic<bool> canPatchUndo;
     std::atomic<bool> canPatchRedo;
     std::atomic<bool> isPatchDirty;
@@ -151,7 +251,19 @@ private:
     friend class Instance;
     friend class Object;
 
-    int undoQueueSize = 0;
+    // The undo actions that the undo/redo strings were last read from
+    void const* lastUndoAction = nullptr;
+    void const* lastRedoAction = nullptr;
+
+    String openUndoGesture;
+
+    // Edits inside an undo sequence would each rebuild the whole DSP chain, so DSP is suspended at the first edit that can change it,
+    // and the chain is built once when that sequence ends, or when we're done handling the current event
+    void deferDSPRebuild();
+    void finishDeferredDSPRebuild();
+    int undoSequenceDepth = 0;
+    int dspSuspendedAtDepth = 0;
+    int suspendedDSPState = -1;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Patch)
 };
@@ -14,6 +14,11 @@ extern "C" {
 #include <string>
 #include <cstring>
 #include "Setup.h"
+#include "SoundfileLoader.h"
+#include "ParameterRamp.h"
+#include "NetworkReceiver.h"
+#include "ExprCompiler.h"
+#include "ArrayDirtyRanges.h"
 
 static t_class* plugdata_receiver_class;
 
@@ -1297,6 +1302,12 @@ int Setup::initialisePd()
         plugdata_print_class = class_new(gensym("plugdata_print"), (t_newmethod)NULL, (t_method)NULL,
             sizeof(t_plugdata_print), CLASS_DEFAULT, A_NULL, 0);
 
+        SoundfileLoader::setup();
+        ParameterRamp::setup();
+        NetworkReceiver::setup();
+        ExprCompiler::setup();
+        ArrayDirtyRanges::setup();
+
         int i;
         t_atom zz[ndefaultfont + 2];
         SETSYMBOL(zz, gensym("."));
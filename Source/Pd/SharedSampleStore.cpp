@@ -0,0 +1,168 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include "SharedSampleStore.h"
+
+namespace pd {
+
+// The cache file starts with this header, followed by the samples of each channel in turn, as native floats
+struct SampleCacheHeader {
+    char magic[8];
+    double sampleRate;
+    int32 numFrames;
+    int32 numChannels;
+};
+
+static constexpr char sampleCacheMagic[8] = { 'P', 'D', 'S', 'M', 'P', 'L', 0, 1 };
+
+float const* SharedSampleStore::Samples::getChannel(int channel) const
+{
+    auto const* data = static_cast<char const*>(mapping->getData()) + sizeof(SampleCacheHeader);
+    return reinterpret_cast<float const*>(data) + static_cast<size_t>(channel) * static_cast<size_t>(numFrames);
+}
+
+std::shared_ptr<SharedSampleStore::Samples const> SharedSampleStore::load(File const& file, AudioFormatManager& formatManager)
+{
+    static std::mutex storeLock;
+    static std::map<String, std::weak_ptr<Samples>> store;
+
+    auto const key = file.getFullPathName() + ":" + String(file.getSize()) + ":" + String(file.getLastModificationTime().toMilliseconds());
+
+    std::shared_ptr<Samples> samples;
+    {
+        std::lock_guard<std::mutex> lock(storeLock);
+        auto& entry = store[key];
+        samples = entry.lock();
+        if (!samples) {
+            samples = std::make_shared<Samples>();
+            entry = samples;
+        }
+
+        // Forget files nobody uses anymore
+        for (auto it = store.begin(); it != store.end();) {
+            it = it->second.expired() ? store.erase(it) : std::next(it);
+        }
+    }
+
+    auto const cacheDirectory = File::getSpecialLocation(File::tempDirectory).getChildFile("plugdata-samples");
+
+    // Clean up after earlier sessions the first time anything is loaded
+    static std::once_flag cleanedUp;
+    std::call_once(cleanedUp, [&cacheDirectory]() { removeOldCacheFiles(cacheDirectory); });
+
+    // Only the first caller decodes, everyone else waits for it here
+    std::call_once(samples->loaded, [&file, &formatManager, &key, &samples, &cacheDirectory]() {
+        auto const cacheFile = cacheDirectory.getChildFile(String::toHexString(key.hashCode64()) + ".pcm");
+
+        if (!map(cacheFile, *samples)) {
+            cacheDirectory.createDirectory();
+            decode(file, cacheFile, formatManager, *samples);
+            removeOldCacheFiles(cacheDirectory);
+        }
+    });
+
+    return samples;
+}
+
+bool SharedSampleStore::map(File const& cacheFile, Samples& samples)
+{
+    if (!cacheFile.existsAsFile())
+        return false;
+
+    auto mapping = std::make_unique<MemoryMappedFile>(cacheFile, MemoryMappedFile::readOnly);
+    if (!mapping->getData() || mapping->getSize() < sizeof(SampleCacheHeader))
+        return false;
+
+    SampleCacheHeader header;
+    std::memcpy(&header, mapping->getData(), sizeof(SampleCacheHeader));
+
+    auto const expectedSize = sizeof(SampleCacheHeader) + static_cast<size_t>(header.numFrames) * static_cast<size_t>(header.numChannels) * sizeof(float);
+    if (std::memcmp(header.magic, sampleCacheMagic, sizeof(sampleCacheMagic)) != 0 || header.numFrames <= 0 || header.numChannels <= 0 || mapping->getSize() != expectedSize)
+        return false;
+
+    samples.numFrames = header.numFrames;
+    samples.numChannels = header.numChannels;
+    samples.sampleRate = header.sampleRate;
+    samples.mapping = std::move(mapping);
+
+    // Not every filesystem keeps access times, so we keep track of when a cache file was last used ourselves
+    cacheFile.setLastModificationTime(Time::getCurrentTime());
+    return true;
+}
+
+void SharedSampleStore::removeOldCacheFiles(File const& cacheDirectory)
+{
+    auto const now = Time::getCurrentTime();
+    auto cacheFiles = cacheDirectory.findChildFiles(File::findFiles, false, "*.pcm;*.tmp");
+
+    // Most recently used first
+    std::sort(cacheFiles.begin(), cacheFiles.end(), [](File const& a, File const& b) {
+        return a.getLastModificationTime() > b.getLastModificationTime();
+    });
+
+    int64 totalSize = 0;
+    for (auto const& cacheFile : cacheFiles) {
+        auto const age = now - cacheFile.getLastModificationTime();
+
+        // Temporary files are left behind if a decode was interrupted
+        auto const isStale = cacheFile.hasFileExtension("tmp") ? age.inHours() >= 1.0 : age.inDays() >= maxCacheFileAgeDays;
+
+        totalSize += cacheFile.getSize();
+
+        // Files that are still mapped can't be removed on Windows, those stay until the next cleanup
+        if (isStale || totalSize > maxCacheSize)
+            cacheFile.deleteFile();
+    }
+}
+
+void SharedSampleStore::decode(File const& file, File const& cacheFile, AudioFormatManager& formatManager, Samples& samples)
+{
+    std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+    if (!reader || reader->lengthInSamples <= 0 || reader->lengthInSamples > std::numeric_limits<int32>::max() || reader->numChannels <= 0) {
+        samples.error = reader ? "empty or too long" : "unknown format";
+        return;
+    }
+
+    SampleCacheHeader header;
+    std::memcpy(header.magic, sampleCacheMagic, sizeof(sampleCacheMagic));
+    header.sampleRate = reader->sampleRate;
+    header.numFrames = static_cast<int32>(reader->lengthInSamples);
+    header.numChannels = static_cast<int32>(reader->numChannels);
+
+    // Written under a temporary name, so other processes never map a half-written file
+    auto const tempFile = cacheFile.getSiblingFile(cacheFile.getFileName() + "." + String::toHexString(Random::getSystemRandom().nextInt64()) + ".tmp");
+
+    bool ok;
+    {
+        FileOutputStream output(tempFile);
+        ok = output.openedOk() && output.write(&header, sizeof(SampleCacheHeader));
+
+        // Decode in chunks, and write every channel of the chunk where that channel goes
+        constexpr int chunkSize = 1 << 16;
+        AudioBuffer<float> chunk(header.numChannels, chunkSize);
+        for (int position = 0; ok && position < header.numFrames; position += chunkSize) {
+            auto const numSamples = std::min(chunkSize, header.numFrames - position);
+            reader->read(&chunk, 0, numSamples, position, true, true);
+
+            for (int ch = 0; ok && ch < header.numChannels; ch++) {
+                auto const offset = sizeof(SampleCacheHeader) + (static_cast<size_t>(ch) * static_cast<size_t>(header.numFrames) + static_cast<size_t>(position)) * sizeof(float);
+                ok = output.setPosition(static_cast<int64>(offset)) && output.write(chunk.getReadPointer(ch), static_cast<size_t>(numSamples) * sizeof(float));
+            }
+        }
+
+        output.flush();
+        ok = ok && !output.getStatus().failed();
+    }
+
+    // If another process finished the same file first, we use theirs
+    if (!ok || !tempFile.moveFileTo(cacheFile))
+        tempFile.deleteFile();
+
+    if (!map(cacheFile, samples))
+        samples.error = ok ? "can't map decoded samples" : "can't write decoded samples";
+}
+
+}
@@ -0,0 +1,47 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "Utility/Config.h"
+
+namespace pd {
+
+// Decoded soundfiles, shared by every plugdata instance in the process
+// The first load decodes the file into a cache file in the temp directory, after that it's memory-mapped, so a file is
+// only decoded once. Every array still copies the samples into its own vector, since pd owns that memory.
+// Samples are keyed by path, size and modification time, they stay mapped for as long as someone holds on to them,
+// and loading a file that's already being decoded waits for it. Cache files that weren't used for a while are removed.
+class SharedSampleStore {
+public:
+    struct Samples {
+        int numFrames = 0;
+        int numChannels = 0;
+        double sampleRate = 0.0;
+        String error;
+
+        float const* getChannel(int channel) const;
+
+    private:
+        friend class SharedSampleStore;
+        std::unique_ptr<MemoryMappedFile> mapping;
+        std::once_flag loaded;
+    };
+
+    // Can be called from any thread except the audio thread, blocks until the file is decoded or mapped
+    static std::shared_ptr<Samples const> load(File const& file, AudioFormatManager& formatManager);
+
+private:
+    static void decode(File const& file, File const& cacheFile, AudioFormatManager& formatManager, Samples& samples);
+    static bool map(File const& cacheFile, Samples& samples);
+    static void removeOldCacheFiles(File const& cacheDirectory);
+
+    static constexpr int64 maxCacheSize = 2048ll * 1024 * 1024;
+    static constexpr int maxCacheFileAgeDays = 7;
+};
+
+}
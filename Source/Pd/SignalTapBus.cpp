@@ -0,0 +1,140 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <juce_gui_basics/juce_gui_basics.h>
+
+#include "Utility/Config.h"
+#include "SignalTapBus.h"
+#include "Instance.h"
+
+extern "C" {
+#include <m_imp.h>
+#include <g_canvas.h>
+}
+
+namespace pd {
+
+SignalTapBus::Tap::Tap(void* object, Instance* instance, Reader tapReader, int samplesPerChannel, int ticks)
+    : source(object, instance)
+    , reader(tapReader)
+    , ticksPerRead(std::max(ticks, 1))
+{
+    for (auto& snapshot : snapshots) {
+        snapshot.capacity = samplesPerChannel;
+        snapshot.samples.assign(static_cast<size_t>(samplesPerChannel * maxChannels), 0.0f);
+    }
+}
+
+SignalTapBus::Snapshot const* SignalTapBus::Tap::getNewSnapshot()
+{
+    if (!(middle.load(std::memory_order_relaxed) & freshFlag))
+        return nullptr;
+
+    front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+    return &snapshots[front];
+}
+
+void SignalTapBus::Tap::process()
+{
+    if (++tickCount < ticksPerRead)
+        return;
+
+    tickCount = 0;
+
+    if (!source.isValid())
+        return;
+
+    auto& snapshot = snapshots[back];
+    if (!reader(source.getRawUnchecked<void>(), snapshot))
+        return;
+
+    snapshot.numChannels = std::min(snapshot.numChannels, maxChannels);
+    snapshot.numSamples = std::min(snapshot.numSamples, snapshot.capacity);
+
+    for (int ch = 0; ch < snapshot.numChannels; ch++) {
+        auto const* samples = snapshot.getChannel(ch);
+        auto const range = FloatVectorOperations::findMinAndMax(samples, snapshot.numSamples);
+
+        float sumOfSquares = 0.0f;
+        for (int i = 0; i < snapshot.numSamples; i++) {
+            sumOfSquares += samples[i] * samples[i];
+        }
+
+        snapshot.min[ch] = range.getStart();
+        snapshot.max[ch] = range.getEnd();
+        snapshot.rms[ch] = snapshot.numSamples > 0 ? std::sqrt(sumOfSquares / static_cast<float>(snapshot.numSamples)) : 0.0f;
+    }
+
+    // Publish the finished snapshot, and start writing into the one the GUI isn't holding
+    back = middle.exchange(back | freshFlag, std::memory_order_acq_rel) & 3;
+    snapshots[back].numChannels = 0;
+    snapshots[back].numSamples = 0;
+}
+
+SignalTapBus::SignalTapBus(Instance* parent)
+    : instance(parent)
+{
+}
+
+SignalTapBus::Tap* SignalTapBus::subscribe(void* object, Reader reader, int samplesPerChannel, int ticksPerRead)
+{
+    auto* tap = new Tap(object, instance, reader, samplesPerChannel, ticksPerRead);
+
+    instance->lockAudioThread();
+    taps.emplace_back(tap);
+    numTaps = static_cast<int>(taps.size());
+    instance->unlockAudioThread();
+
+    return tap;
+}
+
+void SignalTapBus::unsubscribe(Tap* tap)
+{
+    std::unique_ptr<Tap> removed;
+
+    instance->lockAudioThread();
+    auto it = std::find_if(taps.begin(), taps.end(), [tap](auto const& t) { return t.get() == tap; });
+    if (it != taps.end()) {
+        removed = std::move(*it);
+        taps.erase(it);
+    }
+    numTaps = static_cast<int>(taps.size());
+    instance->unlockAudioThread();
+}
+
+void SignalTapBus::process()
+{
+    for (auto const& tap : taps) {
+        tap->process();
+    }
+}
+
+bool SignalTapBus::readConnection(void* outconnect, Snapshot& snapshot)
+{
+    // Without debugging, pd doesn't keep the signals of connections around
+    if (!plugdata_debugging_enabled())
+        return false;
+
+    auto* signal = outconnect_get_signal(static_cast<t_outconnect*>(outconnect));
+    if (!signal || !signal->s_vec)
+        return false;
+
+    auto const numChannels = std::min(signal->s_nchans, maxChannels);
+    if (numChannels != snapshot.numChannels) {
+        snapshot.numChannels = numChannels;
+        snapshot.numSamples = 0;
+    }
+
+    auto const numSamples = std::min(signal->s_n, snapshot.capacity - snapshot.numSamples);
+    for (int ch = 0; ch < numChannels; ch++) {
+        std::copy_n(signal->s_vec + ch * signal->s_n, numSamples, snapshot.getChannel(ch) + snapshot.numSamples);
+    }
+
+    snapshot.numSamples += numSamples;
+    return snapshot.numSamples >= snapshot.capacity;
+}
+
+}
@@ -0,0 +1,100 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include "WeakReference.h"
+
+namespace pd {
+
+class Instance;
+
+// Lets the GUI look at signals without reading pd's memory from the message thread
+// Right after every tick, the audio thread asks each tap to copy what it needs into a snapshot
+// Finished snapshots are handed over through a triple buffer, so neither side ever waits for the other
+// Registering and removing taps takes the pd lock, reading a snapshot doesn't
+class SignalTapBus {
+public:
+    static constexpr int maxChannels = 8;
+
+    struct Snapshot {
+        int numChannels = 0;
+        int numSamples = 0; // Per channel
+        int capacity = 0;   // Per channel
+
+        // Peak and RMS over the samples in this snapshot, per channel
+        float min[maxChannels] = {};
+        float max[maxChannels] = {};
+        float rms[maxChannels] = {};
+
+        // Values the reader wants to pass along with the samples, like display ranges
+        float values[4] = {};
+
+        std::vector<float> samples;
+
+        float* getChannel(int channel) { return samples.data() + channel * capacity; }
+        float const* getChannel(int channel) const { return samples.data() + channel * capacity; }
+    };
+
+    // Called from the audio thread while holding the pd lock, appends what the object produced this tick to the snapshot
+    // Returns true once the snapshot is complete and should be handed to the GUI
+    using Reader = bool (*)(void* object, Snapshot& snapshot);
+
+    class Tap {
+    public:
+        // Returns the latest snapshot if a new one arrived since the last call, otherwise nullptr
+        Snapshot const* getNewSnapshot();
+
+        Snapshot const& getLastSnapshot() const { return snapshots[front]; }
+
+    private:
+        friend class SignalTapBus;
+
+        Tap(void* object, Instance* instance, Reader reader, int samplesPerChannel, int ticksPerRead);
+
+        void process();
+
+        WeakReference source;
+        Reader reader;
+        int ticksPerRead;
+        int tickCount = 0;
+
+        // Bit 2 of middle is set when it holds a snapshot the GUI hasn't picked up yet
+        static constexpr int freshFlag = 4;
+        Snapshot snapshots[3];
+        int back = 0;  // Audio thread only
+        int front = 1; // Message thread only
+        std::atomic<int> middle = 2;
+
+        JUCE_DECLARE_NON_COPYABLE(Tap)
+    };
+
+    explicit SignalTapBus(Instance* parent);
+
+    // The reader is called every ticksPerRead ticks, and may write up to samplesPerChannel samples per channel into a snapshot
+    // The tap belongs to the bus, and stays valid until it's unsubscribed
+    Tap* subscribe(void* object, Reader reader, int samplesPerChannel, int ticksPerRead = 1);
+    void unsubscribe(Tap* tap);
+
+    // Called from the audio thread right after a tick, while holding the pd lock
+    void process();
+
+    bool hasTaps() const { return numTaps.load(std::memory_order_relaxed) > 0; }
+
+    // Reader for a t_outconnect, collects the signal that goes through a connection, one block per tick
+    static bool readConnection(void* outconnect, Snapshot& snapshot);
+
+private:
+    Instance* instance;
+
+    // Only touched while holding the pd lock
+    std::vector<std::unique_ptr<Tap>> taps;
+    std::atomic<int> numTaps = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(SignalTapBus)
+};
+
+}
@@ -0,0 +1,304 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "Utility/Config.h"
+
+extern "C" {
+#include <m_pd.h>
+#include <m_imp.h>
+#include <g_canvas.h>
+#include <s_stuff.h>
+}
+
+#include "Objects/AllGuis.h"
+#include "SharedSampleStore.h"
+#include "SoundfileLoader.h"
+
+namespace pd {
+
+// Decoding threads, shared by all loaders in the process
+struct SoundfileLoaderPool {
+    SoundfileLoaderPool()
+    {
+        formatManager.registerBasicFormats();
+    }
+
+    ~SoundfileLoaderPool()
+    {
+        pool.removeAllJobs(true, 5000);
+    }
+
+    AudioFormatManager formatManager;
+    ThreadPool pool { 2 };
+};
+
+// One "read" message, shared between the pd object and the thread that decodes it
+struct SoundfileLoadJob {
+    enum State {
+        Decoding,
+        Finished,
+        Failed,
+        Cancelled
+    };
+
+    ~SoundfileLoadJob()
+    {
+        for (auto* buffer : buffers) {
+            if (buffer)
+                freebytes(buffer, static_cast<size_t>(numFrames) * sizeof(t_word));
+        }
+    }
+
+    void decode(AudioFormatManager& formatManager)
+    {
+        // Decoded once per process, other instances that load the same file copy from the same mapped pages
+        auto const samples = SharedSampleStore::load(file, formatManager);
+        if (samples->error.isNotEmpty()) {
+            error = samples->error;
+            state = Failed;
+            return;
+        }
+
+        numFrames = samples->numFrames;
+        sampleRate = samples->sampleRate;
+        numChannels = samples->numChannels;
+
+        buffers.resize(arrays.size(), nullptr);
+        for (auto& buffer : buffers) {
+            buffer = static_cast<t_word*>(getbytes(static_cast<size_t>(numFrames) * sizeof(t_word)));
+            if (!buffer) {
+                error = "out of memory";
+                state = Failed;
+                return;
+            }
+        }
+
+        // Copy in chunks, so cancelling doesn't have to wait for the whole file
+        constexpr int chunkSize = 1 << 16;
+        for (int position = 0; position < numFrames; position += chunkSize) {
+            if (state.load() == Cancelled)
+                return;
+
+            auto const numSamples = std::min(chunkSize, numFrames - position);
+            for (size_t i = 0; i < buffers.size(); i++) {
+                // Arrays past the number of channels in the file stay zero, getbytes clears them
+                if (static_cast<int>(i) >= numChannels)
+                    continue;
+
+                auto* words = buffers[i] + position;
+                auto const* channel = samples->getChannel(static_cast<int>(i)) + position;
+                for (int n = 0; n < numSamples; n++)
+                    words[n].w_float = channel[n];
+            }
+        }
+
+        state = Finished;
+    }
+
+    File file;
+    std::vector<t_symbol*> arrays;
+
+    std::atomic<int> state = Decoding;
+    String error;
+
+    int numFrames = 0;
+    int numChannels = 0;
+    double sampleRate = 0.0;
+    std::vector<t_word*> buffers;
+};
+
+static t_class* soundfiler_async_class;
+
+typedef struct _soundfiler_async {
+    t_object x_obj;
+    t_canvas* x_canvas;
+    t_clock* x_clock;
+    t_outlet* x_info;
+    std::shared_ptr<SoundfileLoadJob>* x_job;
+    SharedResourcePointer<SoundfileLoaderPool>* x_pool;
+} t_soundfiler_async;
+
+// Puts the decoded buffer into an array in place of the old one, the old buffer is freed on the pool
+// Sets usedInDSP if a DSP object is reading from the array
+static void soundfiler_async_swap(t_soundfiler_async* x, t_symbol* name, t_word*& buffer, int numFrames, bool& usedInDSP)
+{
+    auto* garray = reinterpret_cast<t_garray*>(pd_findbyclass(name, garray_class));
+    if (!garray) {
+        pd_error(x, "soundfiler.async: %s: no such array", name->s_name);
+        return;
+    }
+
+    int size;
+    t_word* vec;
+    if (!garray_getfloatwords(garray, &size, &vec)) {
+        pd_error(x, "soundfiler.async: %s: bad template for array", name->s_name);
+        return;
+    }
+
+    auto* array = garray_getarray(garray);
+    auto* oldBuffer = array->a_vec;
+    auto const oldSize = static_cast<size_t>(array->a_n) * static_cast<size_t>(array->a_elemsize);
+
+    array->a_vec = reinterpret_cast<char*>(buffer);
+    array->a_n = numFrames;
+    array->a_valid = ++glist_valid;
+    buffer = nullptr;
+
+    (*x->x_pool)->pool.addJob([oldBuffer, oldSize]() {
+        freebytes(oldBuffer, oldSize);
+    });
+
+    // If this is the only array in its graph, make the graph fit the new size, like garray_resize does
+    auto* fakeGarray = reinterpret_cast<t_fake_garray*>(garray);
+    auto* glist = fakeGarray->x_glist;
+    if (glist->gl_list == &fakeGarray->x_gobj && !fakeGarray->x_gobj.g_next && glist->gl_x2 != numFrames) {
+        glist->gl_x2 = numFrames;
+    }
+
+    usedInDSP = usedInDSP || fakeGarray->x_usedindsp;
+
+    garray_redraw(garray);
+    plugdata_forward_message(glist, gensym("redraw"), 0, NULL);
+}
+
+// Buffers that didn't end up in an array get freed along with the job, that shouldn't happen on the audio thread either
+static void soundfiler_async_dispose(t_soundfiler_async* x, std::shared_ptr<SoundfileLoadJob>&& job)
+{
+    (*x->x_pool)->pool.addJob([job = std::move(job)]() mutable {
+        job.reset();
+    });
+}
+
+// Polls the job from the scheduler, so everything we do here happens in between two blocks
+static void soundfiler_async_tick(t_soundfiler_async* x)
+{
+    auto& job = *x->x_job;
+    if (!job)
+        return;
+
+    auto const state = job->state.load();
+    if (state == SoundfileLoadJob::Decoding) {
+        clock_delay(x->x_clock, 5);
+        return;
+    }
+
+    auto finishedJob = std::move(job);
+    job.reset();
+
+    if (state == SoundfileLoadJob::Failed) {
+        pd_error(x, "soundfiler.async: %s: %s", finishedJob->file.getFullPathName().toRawUTF8(), finishedJob->error.toRawUTF8());
+        soundfiler_async_dispose(x, std::move(finishedJob));
+        outlet_float(x->x_obj.ob_outlet, 0);
+        return;
+    }
+
+    auto const numFrames = finishedJob->numFrames;
+
+    bool usedInDSP = false;
+    for (size_t i = 0; i < finishedJob->arrays.size(); i++) {
+        soundfiler_async_swap(x, finishedJob->arrays[i], finishedJob->buffers[i], numFrames, usedInDSP);
+    }
+
+    // Objects like [tabplay~] hold on to the old buffer until the DSP chain is rebuilt
+    if (usedInDSP)
+        canvas_update_dsp();
+
+    t_atom info[2];
+    SETFLOAT(info, finishedJob->sampleRate);
+    SETFLOAT(info + 1, finishedJob->numChannels);
+    soundfiler_async_dispose(x, std::move(finishedJob));
+
+    outlet_list(x->x_info, &s_list, 2, info);
+    outlet_float(x->x_obj.ob_outlet, numFrames);
+}
+
+static void soundfiler_async_cancel(t_soundfiler_async* x)
+{
+    auto& job = *x->x_job;
+    if (!job)
+        return;
+
+    job->state = SoundfileLoadJob::Cancelled;
+    job.reset();
+    clock_unset(x->x_clock);
+}
+
+static void soundfiler_async_read(t_soundfiler_async* x, t_symbol* s, int argc, t_atom* argv)
+{
+    // Flags of [soundfiler] are accepted, arrays are always resized to fit the file
+    while (argc > 0 && argv->a_type == A_SYMBOL && *argv->a_w.w_symbol->s_name == '-') {
+        auto const* flag = argv->a_w.w_symbol->s_name;
+        auto const takesArgument = !strcmp(flag, "-skip") || !strcmp(flag, "-maxsize") || !strcmp(flag, "-bytes");
+        argc -= takesArgument ? 2 : 1;
+        argv += takesArgument ? 2 : 1;
+    }
+
+    if (argc < 2 || argv[0].a_type != A_SYMBOL) {
+        pd_error(x, "usage: read [flags] filename tablename...");
+        return;
+    }
+
+    char directory[MAXPDSTRING], *filename;
+    auto const fd = canvas_open(x->x_canvas, argv[0].a_w.w_symbol->s_name, "", directory, &filename, MAXPDSTRING, 1);
+    if (fd < 0) {
+        pd_error(x, "soundfiler.async: %s: can't open", argv[0].a_w.w_symbol->s_name);
+        return;
+    }
+    sys_close(fd);
+
+    auto job = std::make_shared<SoundfileLoadJob>();
+    job->file = File(String::fromUTF8(directory)).getChildFile(String::fromUTF8(filename));
+    for (int i = 1; i < argc; i++) {
+        if (argv[i].a_type != A_SYMBOL) {
+            pd_error(x, "soundfiler.async: bad array name");
+            return;
+        }
+        job->arrays.push_back(argv[i].a_w.w_symbol);
+    }
+
+    // A new read replaces the one that's still going
+    soundfiler_async_cancel(x);
+    *x->x_job = job;
+
+    auto* pool = x->x_pool->get();
+    pool->pool.addJob([job, pool]() {
+        job->decode(pool->formatManager);
+    });
+
+    clock_delay(x->x_clock, 5);
+    ignoreUnused(s);
+}
+
+static void* soundfiler_async_new()
+{
+    auto* x = reinterpret_cast<t_soundfiler_async*>(pd_new(soundfiler_async_class));
+    x->x_canvas = canvas_getcurrent();
+    x->x_clock = clock_new(x, reinterpret_cast<t_method>(soundfiler_async_tick));
+    x->x_job = new std::shared_ptr<SoundfileLoadJob>();
+    x->x_pool = new SharedResourcePointer<SoundfileLoaderPool>();
+    outlet_new(&x->x_obj, &s_float);
+    x->x_info = outlet_new(&x->x_obj, &s_list);
+    return x;
+}
+
+static void soundfiler_async_free(t_soundfiler_async* x)
+{
+    soundfiler_async_cancel(x);
+    clock_free(x->x_clock);
+    delete x->x_job;
+    delete x->x_pool;
+}
+
+void SoundfileLoader::setup()
+{
+    soundfiler_async_class = class_new(gensym("soundfiler.async"), reinterpret_cast<t_newmethod>(soundfiler_async_new), reinterpret_cast<t_method>(soundfiler_async_free),
+        sizeof(t_soundfiler_async), CLASS_DEFAULT, A_NULL, 0);
+    class_addmethod(soundfiler_async_class, reinterpret_cast<t_method>(soundfiler_async_read), gensym("read"), A_GIMME, 0);
+    class_addmethod(soundfiler_async_class, reinterpret_cast<t_method>(soundfiler_async_cancel), gensym("cancel"), A_NULL);
+}
+
+}
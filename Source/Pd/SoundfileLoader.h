@@ -0,0 +1,19 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+namespace pd {
+
+// [soundfiler.async]: loads soundfiles into arrays without blocking the scheduler
+// "read <file> <array> ..." decodes the file on a background thread pool, into new buffers for the arrays
+// Once it's done, the buffers are swapped in between two blocks, the graphs are redrawn and the outlets give the number of frames,
+// followed by the sample rate and number of channels on the right outlet, like [soundfiler] does
+struct SoundfileLoader {
+    static void setup();
+};
+
+}
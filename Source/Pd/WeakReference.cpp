@@ -6,6 +6,7 @@
 
 #include "Utility/Config.h"
 #include <juce_gui_basics/juce_gui_basics.h>
+#include <thread>
 
 extern "C" {
 #include <s_inter.h>
@@ -18,7 +19,8 @@ pd::WeakReference::WeakReference(void* p, Instance* instance)
     : ptr(p)
     , pd(instance)
 {
-    pd->registerWeakReference(ptr, &weakRef);
+    if (ptr)
+        handle = pd->weakReferences.acquire(ptr);
 }
 
 pd::WeakReference::WeakReference(Instance* instance)
@@ -27,47 +29,77 @@ pd::WeakReference::WeakReference(Instance* instance)
 {
 }
 
-pd::WeakReference::WeakReference(WeakReference const& toCopy)
-    : ptr(toCopy.ptr)
-    , pd(toCopy.pd)
+void pd::WeakReference::setThis() const
 {
-    pd->weakReferenceMutex.lock();
+    if (pd)
+        pd->setThis();
+}
 
-    weakRef = toCopy.weakRef.load();
-    pd->registerWeakReference(ptr, &weakRef);
+pd::WeakReference::BatchLock::BatchLock(Instance* instance)
+    : pd(instance)
+    , previous(batchedInstance)
+{
+    pd->setThis();
+    sys_lock();
+    batchedInstance = pd;
+}
 
-    pd->weakReferenceMutex.unlock();
+pd::WeakReference::BatchLock::~BatchLock()
+{
+    batchedInstance = previous;
+    pd->setThis();
+    sys_unlock();
 }
 
-pd::WeakReference::~WeakReference()
+void pd::WeakReference::BatchLock::yield()
 {
-    if (pd)
-        pd->unregisterWeakReference(ptr, &weakRef);
+    if (!pd->audioThreadWantsLock.load(std::memory_order_relaxed))
+        return;
+
+    pd->setThis();
+    sys_unlock();
+    std::this_thread::yield();
+    sys_lock();
 }
 
-pd::WeakReference& pd::WeakReference::operator=(pd::WeakReference const& other)
+pd::WeakReferenceTable::Handle pd::WeakReferenceTable::acquire(void* object)
 {
-    bool valid = other.ptr && other.pd;
-    if (valid && this != &other) // Check for self-assignment
     {
-        pd = other.pd;
-
-        pd->weakReferenceMutex.lock();
-        pd->unregisterWeakReference(ptr, &other.weakRef);
+        std::shared_lock lock(mutex);
+        if (auto it = handles.find(object); it != handles.end())
+            return it->second;
+    }
 
-        // Use atomic exchange to safely copy the weakRef value
-        weakRef.store(other.weakRef.load());
-        ptr = other.ptr;
+    std::unique_lock lock(mutex);
+    if (auto it = handles.find(object); it != handles.end())
+        return it->second;
 
-        pd->registerWeakReference(ptr, &weakRef);
-        pd->weakReferenceMutex.unlock();
+    Slot* slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        if (numUsedInLastChunk == chunkSize) {
+            chunks.push_back(std::make_unique<Slot[]>(chunkSize));
+            numUsedInLastChunk = 0;
+        }
+        slot = &chunks.back()[numUsedInLastChunk++];
     }
 
-    return *this;
+    auto const handle = Handle { slot, slot->generation.load(std::memory_order_relaxed) };
+    handles.emplace(object, handle);
+    return handle;
 }
 
-void pd::WeakReference::setThis() const
+void pd::WeakReferenceTable::clear(void* object)
 {
-    if (pd)
-        pd->setThis();
+    std::unique_lock lock(mutex);
+    auto it = handles.find(object);
+    if (it == handles.end())
+        return;
+
+    // Every handle to this object now has an old generation, the slot can be given to the next object
+    it->second.slot->generation.fetch_add(1, std::memory_order_release);
+    freeSlots.push_back(it->second.slot);
+    handles.erase(it);
 }
@@ -5,27 +5,72 @@
  */
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <unordered_map>
-#include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <vector>
 
 #include <m_pd.h>
 
-using pd_weak_reference = std::atomic<bool>;
-
 namespace pd {
 
+// Every pd object we hold a weak reference to gets a slot in here
+// A reference remembers its slot and the slot's generation. When pd frees the object, the generation goes up, which invalidates all references to it at once
+// Copying or checking a reference is lock-free, only finding the slot for a raw pointer needs the lock
+struct WeakReferenceTable {
+    struct Slot {
+        std::atomic<uint32_t> generation = 1;
+    };
+
+    struct Handle {
+        Slot* slot = nullptr;
+        uint32_t generation = 0;
+
+        // References without a slot never point to anything, so there's nothing to invalidate
+        bool isAlive() const
+        {
+            return !slot || slot->generation.load(std::memory_order_acquire) == generation;
+        }
+    };
+
+    // Finds the slot for an object, or gives it a new one
+    Handle acquire(void* object);
+
+    // Called by pd when it frees an object
+    void clear(void* object);
+
+private:
+    // Slots are allocated in chunks that never move, so handles can keep pointing at them
+    static constexpr int chunkSize = 4096;
+    std::vector<std::unique_ptr<Slot[]>> chunks;
+    int numUsedInLastChunk = chunkSize;
+    std::vector<Slot*> freeSlots;
+
+    std::unordered_map<void*, Handle> handles;
+    std::shared_mutex mutex;
+};
+
 class Instance;
 struct WeakReference {
     WeakReference(void* p, Instance* instance);
 
     WeakReference(Instance* instance);
 
-    WeakReference(WeakReference const& toCopy);
-
-    ~WeakReference();
+    WeakReference(WeakReference const& toCopy) = default;
 
-    WeakReference& operator=(WeakReference const& other);
+    // Assigning an empty reference leaves this one as it was
+    WeakReference& operator=(WeakReference const& other)
+    {
+        if (other.ptr && other.pd && this != &other) {
+            ptr = other.ptr;
+            pd = other.pd;
+            handle = other.handle;
+        }
+        return *this;
+    }
 
     bool operator==(WeakReference const& other) const
     {
@@ -42,32 +87,35 @@ struct WeakReference {
     template<typename T>
     struct Ptr {
 
-        Ptr(T* pointer, pd_weak_reference const& ref)
-            : weakRef(ref)
+        Ptr(T* pointer, WeakReferenceTable::Handle ref, bool lock = true)
+            : handle(ref)
             , ptr(pointer)
+            , locked(lock)
         {
-            sys_lock();
+            if (locked)
+                sys_lock();
         }
 
         ~Ptr()
         {
-            sys_unlock();
+            if (locked)
+                sys_unlock();
         }
 
         operator bool() const
         {
-            return weakRef && (ptr != nullptr);
+            return handle.isAlive() && (ptr != nullptr);
         }
 
         T* get()
         {
-            return weakRef ? ptr : nullptr;
+            return handle.isAlive() ? ptr : nullptr;
         }
 
         template<typename C>
         C* cast()
         {
-            return weakRef ? reinterpret_cast<C*>(ptr) : nullptr;
+            return handle.isAlive() ? reinterpret_cast<C*>(ptr) : nullptr;
         }
 
         T* operator->()
@@ -75,24 +123,41 @@ struct WeakReference {
             return ptr;
         }
 
-        pd_weak_reference const& weakRef;
+        WeakReferenceTable::Handle handle;
         T* ptr;
+        bool const locked;
 
         JUCE_DECLARE_NON_COPYABLE(Ptr)
     };
 
+    // Holds pd's lock for a whole pass over many objects, so every get() inside it can skip locking and unlocking
+    // Call yield() between objects, that lets go of the lock for a moment if the audio thread is waiting for it
+    // Anything you got from pd before a yield() could have been deleted after it
+    struct BatchLock {
+        explicit BatchLock(Instance* instance);
+        ~BatchLock();
+
+        void yield();
+
+    private:
+        Instance* pd;
+        Instance* previous;
+
+        JUCE_DECLARE_NON_COPYABLE(BatchLock)
+    };
+
     template<typename T>
     Ptr<T> get() const
     {
         setThis();
-        return Ptr<T>(reinterpret_cast<T*>(ptr), weakRef);
+        return Ptr<T>(reinterpret_cast<T*>(ptr), handle, batchedInstance != pd);
     }
 
     template<typename T>
     T* getRaw() const
     {
         setThis();
-        return weakRef ? reinterpret_cast<T*>(ptr) : nullptr;
+        return handle.isAlive() ? reinterpret_cast<T*>(ptr) : nullptr;
     }
 
     template<typename T>
@@ -101,15 +166,18 @@ struct WeakReference {
         return reinterpret_cast<T*>(ptr);
     }
 
-    bool isValid()
+    bool isValid() const
     {
-        return weakRef && ptr != nullptr;
+        return handle.isAlive() && ptr != nullptr;
     }
 
 private:
     void* ptr;
     Instance* pd;
-    pd_weak_reference weakRef = true;
+    WeakReferenceTable::Handle handle;
+
+    // The instance whose lock this thread holds through a BatchLock
+    static inline thread_local Instance* batchedInstance = nullptr;
 };
 
 }
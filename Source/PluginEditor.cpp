@@ -34,7 +34,7 @@
 #include "PluginMode.h"
 #include "Components/TouchSelectionHelper.h"
 
-#if ENABLE_TESTING
+#if ENABLE_TESTING || ENABLE_BENCHMARK
 void runTests(PluginEditor* editor);
 #endif
 
@@ -267,7 +267,7 @@ PluginEditor::PluginEditor(PluginProcessor& p)
     touchSelectionHelper->setAlwaysOnTop(true);
 #endif
 
-#if ENABLE_TESTING
+#if ENABLE_TESTING || ENABLE_BENCHMARK
         // Call after window is ready
         ::Timer::callAfterDelay(200, [this](){
             runTests(this);
@@ -378,7 +378,7 @@ void PluginEditor::paintOverChildren(Graphics& g)
 void PluginEditor::renderArea(NVGcontext* nvg, Rectangle<int> area)
 {
     if (isInPluginMode()) {
-        pluginMode->render(nvg);
+        pluginMode->renderArea(nvg, area);
     } else {
         if (welcomePanel->isVisible()) {
             NVGScopedState scopedState(nvg);
@@ -525,7 +525,7 @@ bool PluginEditor::isInPluginMode() const
 // Retern the patch that belongs to this editor that's in plugin mode
 pd::Patch::Ptr PluginEditor::findPatchInPluginMode()
 {
-    ScopedLock lock(pd->patches.getLock());
+    LockProfiler::ScopedLock lock(pd->patches.getLock(), LockProfiler::PatchesLock);
 
     for (auto& patch : pd->patches) {
         if (editorIndex == patch->windowIndex && patch->openInPluginMode) {
@@ -1132,6 +1132,12 @@ void PluginEditor::getCommandInfo(CommandID const commandID, ApplicationCommandI
         result.setActive(true);
         break;
     }
+    case CommandIDs::ToggleFrameProfiler: {
+        result.setInfo("Toggle Frame Profiler", "Shows where the time of each frame goes", "View", 0);
+        result.addDefaultKeypress(80, ModifierKeys::commandModifier | ModifierKeys::shiftModifier | ModifierKeys::altModifier);
+        result.setActive(true);
+        break;
+    }
     default:
         break;
     }
@@ -1477,6 +1483,10 @@ bool PluginEditor::perform(InvocationInfo const& info)
 
         return true;
     }
+    case CommandIDs::ToggleFrameProfiler: {
+        nvgSurface.toggleFrameProfiler();
+        return true;
+    }
     default: {
         cnv = getCurrentCanvas();
         if (!cnv->viewport)
@@ -1640,6 +1650,9 @@ bool PluginEditor::highlightSearchTarget(void* target, bool openNewTabIfNeeded)
 
     for (auto* cnv : getCanvases()) {
         if (cnv->patch.getPointer().get() == targetCanvas) {
+            // The target might not have an Object yet if the tab is hibernating or still loading
+            cnv->loadAllObjects();
+
             Object* found = nullptr;
             for (auto* object : cnv->objects) {
                 if (object->getPointer() == target) {
@@ -1673,6 +1686,7 @@ bool PluginEditor::highlightSearchTarget(void* target, bool openNewTabIfNeeded)
 
     if (openNewTabIfNeeded) {
         auto* cnv = tabComponent.openPatch(new pd::Patch(pd::WeakReference(targetCanvas, pd), pd, false));
+        cnv->loadAllObjects();
 
         Object* found = nullptr;
         for (auto* object : cnv->objects) {
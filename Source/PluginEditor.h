@@ -23,6 +23,7 @@
 
 #include "Utility/ObjectThemeManager.h"
 #include "NVGSurface.h"
+#include "Utility/FrameScheduler.h"
 
 class CalloutArea : public Component, public Timer {
 public:
@@ -152,6 +153,9 @@ public:
 
     std::unique_ptr<Palettes> palettes;
 
+    // Needs to outlive the canvases, since objects unregister from it when they're deleted
+    FrameScheduler frameScheduler;
+
     NVGSurface nvgSurface;
 
     // used to display callOutBoxes only in a safe area between top & bottom toolbars
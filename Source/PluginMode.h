@@ -167,10 +167,11 @@ public:
         editor->nvgSurface.invalidateAll();
     }
 
-    void render(NVGcontext* nvg) override
+    // Only draws what's inside the invalidated area, the canvas is a graph so it already leaves out connections, iolets and the grid
+    void renderArea(NVGcontext* nvg, Rectangle<int> area)
     {
         nvgFillColor(nvg, findNVGColour(PlugDataColour::canvasBackgroundColourId));
-        nvgFillRect(nvg, 0, 0, getWidth(), getHeight());
+        nvgFillRect(nvg, area.getX(), area.getY(), area.getWidth(), area.getHeight());
 
         NVGScopedState scopedState(nvg);
         nvgScale(nvg, pluginModeScale, pluginModeScale);
@@ -180,7 +181,8 @@ public:
         bounds /= pluginModeScale;
         bounds = bounds.translated(cnv->canvasOrigin.x, cnv->canvasOrigin.y);
 
-        cnv->performRender(nvg, bounds);
+        auto const invalidArea = cnv->getLocalArea(&editor->nvgSurface, area).expanded(1);
+        cnv->performRender(nvg, bounds.getIntersection(invalidArea));
     }
 
     void closePluginMode()
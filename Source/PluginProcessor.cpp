@@ -3,7 +3,9 @@
  // For information on usage and redistribution, and for a DISCLAIMER OF ALL
  // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
  */
+#include <bit>
 #include <clocale>
+#include <iostream>
 #include <memory>
 
 #include <juce_gui_basics/juce_gui_basics.h>
@@ -12,14 +14,18 @@
 
 #include "PluginProcessor.h"
 #include "Pd/Library.h"
+#include "Pd/ExprCompiler.h"
+#include "Pd/InstanceAccess.h"
 
 #include "Utility/Config.h"
 #include "Utility/Fonts.h"
 #include "Utility/SettingsFile.h"
 #include "Utility/PluginParameter.h"
 #include "Utility/OSUtils.h"
-#include "Utility/AudioSampleRingBuffer.h"
 #include "Utility/MidiDeviceManager.h"
+#include "Utility/TraceRecorder.h"
+#include "Utility/StartupProfiler.h"
+#include "Utility/ResourceExtractor.h"
 
 #include "Utility/Presets.h"
 #include "Canvas.h"
@@ -30,12 +36,13 @@
 #include "Statusbar.h"
 
 #include "Dialogs/Dialogs.h"
-#include "Dialogs/ConnectionMessageDisplay.h"
 
 #include "Sidebar/Sidebar.h"
+#include "Sidebar/SearchIndex.h"
 
 extern "C" {
 #include "../Libraries/pd-cyclone/shared/common/file.h"
+#include <FluidLite/include/fluidlite.h>
 EXTERN char* pd_version;
 }
 
@@ -86,6 +93,8 @@ PluginProcessor::PluginProcessor()
     , internalSynth(std::make_unique<InternalSynth>())
     , hostInfoUpdater(this)
 {
+    StartupProfiler::Phase startupPhase("Create instance");
+
     // Make sure to use dots for decimal numbers, pd requires that
     std::setlocale(LC_ALL, "C");
 
@@ -95,11 +104,19 @@ PluginProcessor::PluginProcessor()
         LookAndFeel::setDefaultLookAndFeel(&lnf.get());
 
         // Initialise directory structure and settings file
-        initialiseFilesystem();
-        settingsFile = SettingsFile::getInstance()->initialise();
+        {
+            StartupProfiler::Phase phase("initialiseFilesystem");
+            initialiseFilesystem();
+        }
+        {
+            StartupProfiler::Phase phase("SettingsFile::initialise");
+            settingsFile = SettingsFile::getInstance()->initialise();
+        }
     }
 
     statusbarSource = std::make_unique<StatusbarSource>();
+    searchIndex = std::make_unique<SearchIndex>(this);
+    canvasSyncScheduler = std::make_unique<CanvasSyncScheduler>(this);
 
     auto* volumeParameter = new PlugDataParameter(this, "volume", 0.8f, true, 0, 0.0f, 1.0f);
     addParameter(volumeParameter);
@@ -108,6 +125,10 @@ PluginProcessor::PluginProcessor()
     // XML tree for storing additional data in DAW session
     extraData = std::make_unique<XmlElement>("ExtraData");
 
+    dynamicParameters = !settingsFile->getProperty<int>("fixed_parameter_count");
+    if (dynamicParameters)
+        numParameters = std::clamp(settingsFile->getProperty<int>("parameter_blocks"), 1, maxParameters / parameterBlockSize) * parameterBlockSize;
+
     // General purpose automation parameters you can get by using "receive param1" etc.
     for (int n = 0; n < numParameters; n++) {
         auto* parameter = new PlugDataParameter(this, "param" + String(n + 1), 0.0f, false, n + 1, 0.0f, 1.0f);
@@ -136,9 +157,6 @@ PluginProcessor::PluginProcessor()
     midiBufferOut.ensureSize(2048);
     midiBufferInternalSynth.ensureSize(2048);
 
-    atoms_playhead.reserve(3);
-    atoms_playhead.resize(1);
-
     auto themeName = settingsFile->getProperty<String>("theme");
 
     // Make sure theme exists
@@ -152,8 +170,14 @@ PluginProcessor::PluginProcessor()
     settingsFile->saveSettings();
 
     oversampling = settingsFile->getProperty<int>("oversampling");
+    oversamplingQuality = std::clamp(settingsFile->getProperty<int>("oversampling_quality"), 0, 2);
+    ticksPerEngineBlock = std::clamp(settingsFile->getProperty<int>("engine_block_size") / Instance::getBlockSize(), 1, 8);
 
     setProtectedMode(settingsFile->getProperty<int>("protected"));
+    setMultiCoreDSP(settingsFile->getProperty<int>("multicore_dsp"));
+    setSleepWhenSilent(settingsFile->getProperty<int>("sleep_when_silent"));
+    setSmoothDSPRebuilds(settingsFile->getProperty<int>("smooth_dsp_rebuild"));
+    pd::ExprCompiler::setEnabled(settingsFile->getProperty<int>("compile_expr"));
     setLimiterThreshold(settingsFile->getProperty<int>("limiter_threshold"));
     enableInternalSynth = settingsFile->getProperty<int>("internal_synth");
 
@@ -161,21 +185,38 @@ PluginProcessor::PluginProcessor()
 
     // ag: This needs to be done *after* the library data has been unpacked on
     // first launch.
-    initialisePd(pdlua_version);
+    {
+        StartupProfiler::Phase phase("initialisePd");
+        initialisePd(pdlua_version);
+    }
     logMessage(pdlua_version);
 
-    updateSearchPaths();
+    playheadInjector.initialise(*this);
 
-    objectLibrary = std::make_unique<pd::Library>(this);
+    for (auto* param : getParameters()) {
+        auto* pldParam = reinterpret_cast<PlugDataParameter*>(param);
+        pldParam->internReceiverSymbol();
+        pldParam->markDirty();
+    }
+
+    updateSearchPaths();
 
     setLatencySamples(pd::Instance::getBlockSize());
     settingsFile->startChangeListener();
 
     sendMessagesFromQueue();
+
+    processMetrics->addSource(this);
 }
 
 PluginProcessor::~PluginProcessor()
 {
+    processMetrics->removeSource(this);
+
+    // Stop the workers before the islands they might be processing go away
+    dspThreadPool.reset();
+    dspIslands.clear();
+
     // Deleting the pd instance in ~PdInstance() will also free all the Pd patches
     patches.clear();
 }
@@ -204,54 +245,40 @@ void PluginProcessor::initialiseFilesystem()
         homeDir.createDirectory();
 #endif
 
-    auto initMutex = homeDir.getChildFile(".initialising");
+    // If another instance of plugdata is initialising, wait for it to finish
+    // The OS releases this lock if that instance crashes, so we never have to guess how long to wait
+    // InterProcessLock doesn't keep out other instances in this process, that's what the CriticalSection is for
+    static CriticalSection initialiseLock;
+    ScopedLock const scopedInitialiseLock(initialiseLock);
+    InterProcessLock interProcessLock("plugdata_filesystem");
+    InterProcessLock::ScopedLockType const scopedInterProcessLock(interProcessLock);
+
+    // Binary data shouldn't be too big, then the compiler will run out of memory
+    // To prevent this, we split the binarydata into multiple files, which we read as one stream here
+    std::vector<std::pair<char const*, int64>> chunks;
+    for (int i = 0;; i++) {
+        int size;
+        auto* resource = BinaryData::getNamedResource((String("Filesystem_") + String(i) + "_zip").toRawUTF8(), size);
+        if (!resource)
+            break;
 
-    // If this is true, another instance of plugdata is already initialising
-    // We wait a maximum of 5 seconds before we continue initialising, to prevent problems
-    int wait = 0;
-    while (initMutex.exists() && wait < 20) {
-        Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 500);
-        wait++;
+        chunks.emplace_back(resource, size);
     }
 
-    initMutex.create();
-
-    // Check if the abstractions directory exists, if not, unzip it from binaryData
-    if (!versionDataDir.exists()) {
-
-        // Binary data shouldn't be too big, then the compiler will run out of memory
-        // To prevent this, we split the binarydata into multiple files, and add them back together here
-        std::vector<char> allData;
-        int i = 0;
-        while (true) {
-            int size;
-            auto* resource = BinaryData::getNamedResource((String("Filesystem_") + String(i) + "_zip").toRawUTF8(), size);
+    // Only extracts the files that are missing or changed, so usually there's nothing to do here
+    versionDataDir.createDirectory();
+    ResourceExtractor::ChunkedInputStream filesystemStream(std::move(chunks));
+    if (ResourceExtractor::extract(filesystemStream, versionDataDir))
+        internalSynth->extractSoundfont();
 
-            if (!resource) {
-                break;
-            }
-
-            allData.insert(allData.end(), resource, resource + size);
-            i++;
-        }
-
-        MemoryInputStream memstream(allData.data(), allData.size(), false);
-
-        versionDataDir.getParentDirectory().createDirectory();
-        auto tempVersionDataDir = versionDataDir.getParentDirectory().getChildFile("plugdata_version");
-
-        auto file = ZipFile(memstream);
-        file.uncompressTo(tempVersionDataDir.getParentDirectory());
-
-        // Create filesystem for this specific version
-        tempVersionDataDir.moveFileTo(versionDataDir);
-
-        if (versionDataDir.isDirectory())
-            internalSynth->extractSoundfont();
-    }
     if (!deken.exists()) {
         deken.createDirectory();
     }
+
+    // Decoded samples of .sf3 soundfonts are cached here, and shared between sfont~ objects and the internal synth
+    auto soundfontCache = versionDataDir.getChildFile("Soundfonts");
+    soundfontCache.createDirectory();
+    fluid_set_sample_cache_dir(soundfontCache.getFullPathName().toRawUTF8());
 #if !JUCE_IOS
     if (!patches.exists()) {
         patches.createDirectory();
@@ -320,21 +347,11 @@ void PluginProcessor::initialiseFilesystem()
     versionDataDir.getChildFile("Documentation").createSymbolicLink(homeDir.getChildFile("Documentation"), true);
     versionDataDir.getChildFile("Extra").createSymbolicLink(homeDir.getChildFile("Extra"), true);
 #endif
-    
-    initMutex.deleteFile();
 }
 
-void PluginProcessor::updateSearchPaths()
+StringArray PluginProcessor::getSearchPaths()
 {
-    // Reload pd search paths from settings
     auto pathTree = settingsFile->getPathsTree();
-
-    setThis();
-
-    lockAudioThread();
-    
-    libpd_clear_search_path();
-
     auto paths = pd::Library::defaultPaths;
 
     for (auto child : pathTree) {
@@ -342,12 +359,28 @@ void PluginProcessor::updateSearchPaths()
         paths.addIfNotAlreadyThere(path);
     }
 
+    StringArray searchPaths;
     for (auto const& path : paths) {
-        libpd_add_to_search_path(path.getFullPathName().toRawUTF8());
+        searchPaths.add(path.getFullPathName());
     }
 
     for (auto const& path : DekenInterface::getExternalPaths()) {
-        libpd_add_to_search_path(path.replace("\\", "/").toRawUTF8());
+        searchPaths.add(path.replace("\\", "/"));
+    }
+
+    return searchPaths;
+}
+
+void PluginProcessor::updateSearchPaths()
+{
+    setThis();
+
+    lockAudioThread();
+    
+    libpd_clear_search_path();
+
+    for (auto const& path : getSearchPaths()) {
+        libpd_add_to_search_path(path.toRawUTF8());
     }
 
     auto librariesTree = settingsFile->getLibrariesTree();
@@ -419,10 +452,9 @@ int PluginProcessor::getCurrentProgram()
 void PluginProcessor::setCurrentProgram(int index)
 {
     if (isPositiveAndBelow(index, Presets::presets.size())) {
-        MemoryOutputStream data;
-        Base64::convertFromBase64(data, Presets::presets[index].second);
-        if (data.getDataSize() > 0) {
-            setStateInformation(data.getData(), static_cast<int>(data.getDataSize()));
+        auto const& data = Presets::getPresetData(index);
+        if (data.getSize() > 0) {
+            setStateInformation(data.getData(), static_cast<int>(data.getSize()));
             lastSetProgram = index;
         }
     }
@@ -457,6 +489,63 @@ void PluginProcessor::setOversampling(int amount)
     suspendProcessing(false);
 }
 
+void PluginProcessor::setOversamplingQuality(int quality)
+{
+    quality = std::clamp(quality, 0, 2);
+    if (oversamplingQuality == quality)
+        return;
+
+    settingsFile->setProperty("oversampling_quality", var(quality));
+
+    oversamplingQuality = quality;
+    auto blockSize = AudioProcessor::getBlockSize();
+    auto sampleRate = AudioProcessor::getSampleRate();
+
+    suspendProcessing(true);
+    prepareToPlay(sampleRate, blockSize);
+    suspendProcessing(false);
+}
+
+void PluginProcessor::setEngineBlockSize(int blockSize)
+{
+    auto const ticks = std::clamp(blockSize / Instance::getBlockSize(), 1, 8);
+    if (ticksPerEngineBlock == ticks)
+        return;
+
+    settingsFile->setProperty("engine_block_size", var(ticks * Instance::getBlockSize()));
+
+    ticksPerEngineBlock = ticks;
+    auto sampleRate = AudioProcessor::getSampleRate();
+    auto hostBlockSize = AudioProcessor::getBlockSize();
+
+    suspendProcessing(true);
+    prepareToPlay(sampleRate, hostBlockSize);
+    suspendProcessing(false);
+}
+
+// The number of samples we process between handling messages and MIDI
+// Pd's own block size is fixed when it's compiled, so a larger engine block is a number of pd blocks processed in one go
+int PluginProcessor::getEngineBlockSize() const
+{
+    return Instance::getBlockSize() * ticksPerEngineBlock.load(std::memory_order_relaxed);
+}
+
+void PluginProcessor::updateLatency()
+{
+    // The fifos add one engine block and the oversampling filters add their own latency, on top of the user's latency compensation
+    auto oversamplingLatency = oversampling > 0 && oversampler ? roundToInt(oversampler->getLatencyInSamples()) : 0;
+    auto fifoLatency = variableBlockSize ? getEngineBlockSize() : 0;
+    setLatencySamples(customLatencySamples + fifoLatency + oversamplingLatency);
+}
+
+void PluginProcessor::handleAsyncUpdate()
+{
+    Instance::handleAsyncUpdate();
+
+    if (latencyUpdatePending.exchange(false))
+        updateLatency();
+}
+
 void PluginProcessor::setLimiterThreshold(int amount)
 {
     auto threshold = (std::vector<float> { -12, -6, 0, 3 })[amount];
@@ -470,6 +559,106 @@ void PluginProcessor::setProtectedMode(bool enabled)
     protectedMode = enabled;
 }
 
+void PluginProcessor::setMultiCoreDSP(bool enabled)
+{
+    if (enabled == static_cast<bool>(dspThreadPool))
+        return;
+
+    suspendProcessing(true);
+    if (enabled) {
+        // Leave one core for the main instance and one for the message thread
+        auto numWorkers = std::clamp(SystemStats::getNumCpus() - 2, 1, 8);
+        auto const sampleRate = getSampleRate() > 0.0 ? getSampleRate() : 44100.0;
+        auto const options = Thread::RealtimeOptions().withApproximateAudioProcessingTime(getEngineBlockSize(), sampleRate);
+        dspThreadPool = std::make_unique<DSPThreadPool>(numWorkers, options);
+        dspThreadPool->setWorkgroup(audioWorkgroup);
+    } else {
+        dspThreadPool.reset();
+    }
+    multiCoreDSP = enabled;
+    suspendProcessing(false);
+}
+
+void PluginProcessor::setSleepWhenSilent(bool enabled)
+{
+    // Only makes sense for effects, an instrument has no input to wake up on
+    sleepWhenSilent = enabled && ProjectInfo::isFx;
+}
+
+void PluginProcessor::updateSleepState(AudioBuffer<float> const& buffer, bool hasMidiInput)
+{
+    if (!sleepWhenSilent) {
+        dspSleeping = false;
+        numSilentSamples = 0;
+        return;
+    }
+
+    auto const numSamples = buffer.getNumSamples();
+    auto isSilent = !hasMidiInput;
+    for (int ch = 0; ch < std::min(getTotalNumInputChannels(), buffer.getNumChannels()) && isSilent; ch++) {
+        isSilent = buffer.getMagnitude(ch, 0, numSamples) < 1e-5f; // -100dB
+    }
+
+    if (!isSilent) {
+        dspSleeping = false;
+        numSilentSamples = 0;
+        return;
+    }
+
+    // Let the patch ring out for the configured tail length before going to sleep
+    numSilentSamples += numSamples;
+    auto const tailSamples = static_cast<int64>(std::max(0.1, getTailLengthSeconds()) * getSampleRate());
+    dspSleeping = numSilentSamples > tailSamples;
+}
+
+void PluginProcessor::openParallelPatch(File const& patchFile)
+{
+    // A second instance would share pd's global state with this one
+    if (!hasMultipleInstances()) {
+        logError("Can't run " + patchFile.getFileName() + " on a separate core: this build of plugdata doesn't support multiple pd instances");
+        return;
+    }
+
+    if (!multiCoreDSP) {
+        logWarning("Multi-core DSP is disabled, opening " + patchFile.getFileName() + " in the main instance");
+        loadPatch(URL(patchFile));
+        return;
+    }
+
+    auto island = std::make_unique<pd::DSPIsland>(*this, patchFile, getSearchPaths());
+    if (!island->isValid())
+        return;
+
+    if (auto sampleRate = AudioProcessor::getSampleRate(); !approximatelyEqual(sampleRate, 0.0)) {
+        float oversampleFactor = 1 << oversampling;
+        island->prepare(getTotalNumInputChannels(), getTotalNumOutputChannels(), sampleRate * oversampleFactor, AudioProcessor::getBlockSize() * oversampleFactor);
+    }
+
+    ScopedLock lock(dspIslandLock);
+    dspIslands.add(island.release());
+    logMessage("Running " + patchFile.getFileName() + " on a DSP worker thread");
+}
+
+void PluginProcessor::closeParallelPatch(File const& patchFile)
+{
+    ScopedLock lock(dspIslandLock);
+    for (int i = dspIslands.size() - 1; i >= 0; i--) {
+        if (dspIslands[i]->getPatchFile() == patchFile) {
+            dspIslands.remove(i);
+        }
+    }
+}
+
+Array<File> PluginProcessor::getParallelPatches()
+{
+    ScopedLock lock(dspIslandLock);
+    Array<File> parallelPatches;
+    for (auto* island : dspIslands) {
+        parallelPatches.add(island->getPatchFile());
+    }
+    return parallelPatches;
+}
+
 void PluginProcessor::numChannelsChanged()
 {
     auto blockSize = AudioProcessor::getBlockSize();
@@ -490,18 +679,31 @@ void PluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
 
     prepareDSP(getTotalNumInputChannels(), getTotalNumOutputChannels(), sampleRate * oversampleFactor, samplesPerBlock * oversampleFactor);
 
-    oversampler = std::make_unique<dsp::Oversampling<float>>(std::max(1, maxChannels), oversampling, dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, false);
+    {
+        ScopedLock lock(dspIslandLock);
+        for (auto* island : dspIslands) {
+            island->prepare(getTotalNumInputChannels(), getTotalNumOutputChannels(), sampleRate * oversampleFactor, samplesPerBlock * oversampleFactor);
+        }
+    }
+
+    heavyPreview.prepare(sampleRate * oversampleFactor);
+
+    // Quality profiles: 0 = fast IIR (lowest latency), 1 = steep IIR, 2 = linear phase FIR (highest latency)
+    auto const quality = oversamplingQuality.load();
+    auto const filterType = quality == 2 ? dsp::Oversampling<float>::filterHalfBandFIREquiripple : dsp::Oversampling<float>::filterHalfBandPolyphaseIIR;
+    oversampler = std::make_unique<dsp::Oversampling<float>>(std::max(1, maxChannels), oversampling, filterType, quality > 0, quality == 2);
 
     oversampler->initProcessing(samplesPerBlock);
 
-    if (enableInternalSynth && ProjectInfo::isStandalone) {
+    if (ProjectInfo::isStandalone) {
         internalSynth->prepare(sampleRate, samplesPerBlock, maxChannels);
     }
 
     audioAdvancement = 0;
     auto const pdBlockSize = static_cast<size_t>(Instance::getBlockSize());
-    audioBufferIn.setSize(maxChannels, pdBlockSize);
-    audioBufferOut.setSize(maxChannels, pdBlockSize);
+    auto const engineBlockSize = getEngineBlockSize();
+    audioBufferIn.setSize(maxChannels, engineBlockSize);
+    channelPointers.resize(maxChannels, nullptr);
 
     audioVectorIn.resize(maxChannels * pdBlockSize, 0.0f);
     audioVectorOut.resize(maxChannels * pdBlockSize, 0.0f);
@@ -509,15 +711,17 @@ void PluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     midiBufferIn.clear();
     midiBufferOut.clear();
 
-    // If the block size is a multiple of 64 and we are not a plugin, we can optimise the process loop
-    // Audio plugins can choose to send in a smaller block size when automation is happening
-    variableBlockSize = !ProjectInfo::isStandalone || samplesPerBlock < pdBlockSize || samplesPerBlock % pdBlockSize != 0;
+    // If the block size is a multiple of the engine block, we can process pd blocks straight into the host buffer without adding latency
+    // Plugin hosts can still send in an odd or smaller block, for example when automation is happening. In that case
+    // processBlock switches over to the fifos for good and reports the extra block of latency
+    auto const oversampledBlockSize = static_cast<int>(samplesPerBlock * oversampleFactor);
+    variableBlockSize = oversampledBlockSize < engineBlockSize || oversampledBlockSize % engineBlockSize != 0;
 
-    if (variableBlockSize) {
-        inputFifo = std::make_unique<AudioMidiFifo>(maxChannels, std::max<int>(pdBlockSize, samplesPerBlock) * 3);
-        outputFifo = std::make_unique<AudioMidiFifo>(maxChannels, std::max<int>(pdBlockSize, samplesPerBlock) * 3);
-        outputFifo->writeSilence(Instance::getBlockSize());
-    }
+    inputFifo = std::make_unique<AudioMidiFifo>(maxChannels, std::max<int>(engineBlockSize, oversampledBlockSize) * 3);
+    outputFifo = std::make_unique<AudioMidiFifo>(maxChannels, std::max<int>(engineBlockSize, oversampledBlockSize) * 3);
+    outputFifo->writeSilence(engineBlockSize);
+
+    updateLatency();
 
     midiByteIndex = 0;
     midiByteBuffer[0] = 0;
@@ -529,17 +733,32 @@ void PluginProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     startDSP();
 
     statusbarSource->setSampleRate(sampleRate);
+    statusbarSource->blockTiming.prepare(sampleRate);
     statusbarSource->setBufferSize(samplesPerBlock);
     statusbarSource->prepareToPlay(getTotalNumOutputChannels());
 
     limiter.prepare({ sampleRate, static_cast<uint32>(samplesPerBlock), std::max(1u, static_cast<uint32>(maxChannels)) });
 
     smoothedGain.reset(AudioProcessor::getSampleRate(), 0.02);
+    gainRamp.assign(samplesPerBlock, 1.0f);
+}
+
+// The host tells us which workgroup its audio thread is in, our DSP workers join it so they get scheduled together
+void PluginProcessor::audioWorkgroupContextChanged(AudioWorkgroup const& workgroup)
+{
+    audioWorkgroup = workgroup;
+    if (dspThreadPool)
+        dspThreadPool->setWorkgroup(workgroup);
 }
 
 void PluginProcessor::releaseResources()
 {
     releaseDSP();
+
+    ScopedLock lock(dspIslandLock);
+    for (auto* island : dspIslands) {
+        island->release();
+    }
 }
 
 bool PluginProcessor::isBusesLayoutSupported(BusesLayout const& layouts) const
@@ -617,15 +836,26 @@ void PluginProcessor::processBlockBypassed(AudioBuffer<float>& buffer, MidiBuffe
 
 void PluginProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
 {
+    TraceRecorder::setThreadName("Audio thread");
+    TraceRecorder::Scope trace("PluginProcessor::processBlock");
     ScopedNoDenormals noDenormals;
     AudioProcessLoadMeasurer::ScopedTimer cpuTimer(cpuLoadMeasurer, buffer.getNumSamples());
 
+    auto& blockTiming = statusbarSource->blockTiming;
+    blockTiming.beginBlock(buffer.getNumSamples());
+
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
     setThis();
-    sendPlayhead();
-    sendParameters();
+    {
+        BlockTimingMonitor::ScopedStage stage(blockTiming, BlockTimingMonitor::Playhead);
+        sendPlayhead();
+    }
+    {
+        BlockTimingMonitor::ScopedStage stage(blockTiming, BlockTimingMonitor::Parameters);
+        sendParameters(buffer.getNumSamples() << oversampling.load());
+    }
 
     for (int i = totalNumInputChannels; i < totalNumOutputChannels; ++i) {
         buffer.clear(i, 0, buffer.getNumSamples());
@@ -635,10 +865,18 @@ void PluginProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiM
     auto blockOut = oversampling > 0 ? oversampler->processSamplesUp(targetBlock) : targetBlock;
 
     auto hasMidiInEvents = hasRealEvents(midiMessages);
+    updateSleepState(buffer, hasMidiInEvents);
 
     midiBufferIn.clear();
     midiBufferOut.clear();
 
+    if (!variableBlockSize && blockOut.getNumSamples() % getEngineBlockSize() != 0) {
+        // The host sent a block we can't split into whole engine blocks, so from now on we need the fifos
+        variableBlockSize = true;
+        latencyUpdatePending = true;
+        triggerAsyncUpdate();
+    }
+
     if (variableBlockSize) {
         processVariable(blockOut, midiMessages);
     } else {
@@ -680,13 +918,12 @@ void PluginProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiM
 
     // apply smoothing to the main volume control
     smoothedGain.setTargetValue(mappedTargetGain);
-    smoothedGain.applyGain(buffer, buffer.getNumSamples());
-
-    statusbarSource->process(hasMidiInEvents, hasMidiOutEvents, totalNumOutputChannels);
-    statusbarSource->setCPUUsage(cpuLoadMeasurer.getLoadAsPercentage());
-    statusbarSource->peakBuffer.write(buffer);
 
     if (ProjectInfo::isStandalone) {
+        // Hardware MIDI output is sent from its own thread, spread out over the block the same way as the events are
+        auto const blockStartTime = Time::getMillisecondCounterHiRes();
+        auto const millisecondsPerSample = 1000.0 / getSampleRate();
+
         for (auto bufferIterator : midiMessages) {
             auto* midiDeviceManager = ProjectInfo::getMidiDeviceManager();
 
@@ -697,36 +934,44 @@ void PluginProcessor::processBlock(AudioBuffer<float>& buffer, MidiBuffer& midiM
                 midiBufferInternalSynth.addEvent(message, 0);
             }
             if (isPositiveAndBelow(device, midiDeviceManager->getOutputDevices().size() + 1)) {
-                midiDeviceManager->sendMidiOutputMessage(device, message);
+                midiDeviceManager->queueMidiOutputMessage(device, std::move(message), blockStartTime + bufferIterator.samplePosition * millisecondsPerSample);
             }
         }
 
-        // If the internalSynth is enabled and loaded, let it process the midi
-        if (enableInternalSynth && internalSynth->isReady()) {
-            internalSynth->process(buffer, midiBufferInternalSynth);
-        } else if (!enableInternalSynth && internalSynth->isReady()) {
-            internalSynth->unprepare();
-        } else if (enableInternalSynth && !internalSynth->isReady()) {
-            internalSynth->prepare(getSampleRate(), AudioProcessor::getBlockSize(), std::max(totalNumInputChannels, totalNumOutputChannels));
-        }
+        // The internal synth gets loaded and deleted on its own thread, here we only tell it whether we want it, and crossfade when it changes
+        internalSynth->process(buffer, midiBufferInternalSynth, enableInternalSynth, blockTiming.getLastBlockLoad());
         midiBufferInternalSynth.clear();
     }
 
-    if (protectedMode && buffer.getNumChannels() > 0) {
+    auto const numSamples = buffer.getNumSamples();
+    if (protectedMode && buffer.getNumChannels() > 0 && !gainRamp.empty()) {
+        // Take out inf and NaN values, apply the volume and limit the output, all in one pass
+        // Some hosts send bigger blocks than they prepared us for, those are done in parts the size of the gain ramp
+        auto block = dsp::AudioBlock<float>(buffer);
+        auto const rampSize = static_cast<int>(gainRamp.size());
+        for (int start = 0; start < numSamples; start += rampSize) {
+            auto const partSize = std::min(rampSize, numSamples - start);
+            if (smoothedGain.isSmoothing()) {
+                for (int n = 0; n < partSize; n++)
+                    gainRamp[n] = smoothedGain.getNextValue();
+            } else {
+                FloatVectorOperations::fill(gainRamp.data(), smoothedGain.getCurrentValue(), partSize);
+            }
 
-        // Take out inf and NaN values
-        auto* const* writePtr = buffer.getArrayOfWritePointers();
-        for (int ch = 0; ch < buffer.getNumChannels(); ch++) {
-            for (int n = 0; n < buffer.getNumSamples(); n++) {
-                if (!std::isfinite(writePtr[ch][n])) {
-                    writePtr[ch][n] = 0.0f;
-                }
+            auto part = block.getSubBlock(static_cast<size_t>(start), static_cast<size_t>(partSize));
+            if (auto numScrubbed = limiter.sanitiseAndProcess(part, gainRamp.data())) {
+                statusbarSource->addScrubbedSamples(numScrubbed);
             }
         }
-
-        auto block = dsp::AudioBlock<float>(buffer);
-        limiter.process(block);
+    } else {
+        smoothedGain.applyGain(buffer, numSamples);
     }
+
+    statusbarSource->process(hasMidiInEvents, hasMidiOutEvents, totalNumOutputChannels);
+    statusbarSource->setCPUUsage(cpuLoadMeasurer.getLoadAsPercentage());
+    statusbarSource->updatePeak(buffer, numSamples);
+
+    blockTiming.endBlock();
 }
 
 void PluginProcessor::updatePatchUndoRedoState()
@@ -738,7 +983,12 @@ void PluginProcessor::updatePatchUndoRedoState()
         return;
     }
 
+    // Every change asks for this, but one queued update covers all changes made before it runs
+    if (undoRedoStateUpdatePending.exchange(true))
+        return;
+
     enqueueFunctionAsync([this]() {
+        undoRedoStateUpdatePending = false;
         for (auto& patch : patches) {
             patch->updateUndoRedoState();
         }
@@ -746,7 +996,7 @@ void PluginProcessor::updatePatchUndoRedoState()
 }
 void PluginProcessor::processConstant(dsp::AudioBlock<float> buffer, MidiBuffer& midiMessages)
 {
-    int blockSize = Instance::getBlockSize();
+    int blockSize = getEngineBlockSize();
     int numBlocks = buffer.getNumSamples() / blockSize;
     audioAdvancement = 0;
 
@@ -758,15 +1008,12 @@ void PluginProcessor::processConstant(dsp::AudioBlock<float> buffer, MidiBuffer&
         midiBufferOut.clear();
     }
 
-    for (int block = 0; block < numBlocks; block++) {
-        for (int ch = 0; ch < buffer.getNumChannels(); ch++) {
-            // Copy the channel data into the vector
-            juce::FloatVectorOperations::copy(
-                audioVectorIn.data() + (ch * blockSize),
-                buffer.getChannelPointer(ch) + audioAdvancement,
-                blockSize);
-        }
+    auto const numChannels = static_cast<int>(buffer.getNumChannels());
+    for (int ch = 0; ch < numChannels; ch++) {
+        channelPointers[ch] = buffer.getChannelPointer(ch);
+    }
 
+    for (int block = 0; block < numBlocks; block++) {
         setThis();
 
         midiBufferIn.clear();
@@ -774,19 +1021,13 @@ void PluginProcessor::processConstant(dsp::AudioBlock<float> buffer, MidiBuffer&
         sendMidiBuffer();
 
         // Process audio
-        performDSP(audioVectorIn.data(), audioVectorOut.data());
-
-        sendMessagesFromQueue();
-
-        if (connectionListener && plugdata_debugging_enabled())
-            connectionListener->updateSignalData();
-
-        for (int ch = 0; ch < buffer.getNumChannels(); ch++) {
-            // Use FloatVectorOperations to copy the vector data into the audioBuffer
-            juce::FloatVectorOperations::copy(
-                buffer.getChannelPointer(ch) + audioAdvancement,
-                audioVectorOut.data() + (ch * blockSize),
-                blockSize);
+        {
+            BlockTimingMonitor::ScopedStage stage(statusbarSource->blockTiming, BlockTimingMonitor::DSP);
+            performDSPBlock(channelPointers.data(), numChannels, audioAdvancement);
+        }
+        {
+            BlockTimingMonitor::ScopedStage stage(statusbarSource->blockTiming, BlockTimingMonitor::Messages);
+            sendMessagesFromQueue();
         }
 
         audioAdvancement += blockSize;
@@ -798,26 +1039,17 @@ void PluginProcessor::processConstant(dsp::AudioBlock<float> buffer, MidiBuffer&
 
 void PluginProcessor::processVariable(dsp::AudioBlock<float> buffer, MidiBuffer& midiMessages)
 {
-    auto const pdBlockSize = Instance::getBlockSize();
-    auto const numChannels = buffer.getNumChannels();
+    auto const engineBlockSize = getEngineBlockSize();
 
     inputFifo->writeAudioAndMidi(buffer, midiMessages);
     midiMessages.clear();
 
     audioAdvancement = 0; // Always has to be 0 if we use the AudioMidiFifo!
 
-    while (inputFifo->getNumSamplesAvailable() >= pdBlockSize) {
+    while (inputFifo->getNumSamplesAvailable() >= engineBlockSize) {
         midiBufferIn.clear();
         inputFifo->readAudioAndMidi(audioBufferIn, midiBufferIn);
 
-        for (int channel = 0; channel < audioBufferIn.getNumChannels(); channel++) {
-            // Copy the channel data into the vector
-            juce::FloatVectorOperations::copy(
-                audioVectorIn.data() + (channel * pdBlockSize),
-                audioBufferIn.getReadPointer(channel),
-                pdBlockSize);
-        }
-
         if (producesMidi()) {
             midiByteIndex = 0;
             midiByteBuffer[0] = 0;
@@ -830,117 +1062,157 @@ void PluginProcessor::processVariable(dsp::AudioBlock<float> buffer, MidiBuffer&
 
         sendMidiBuffer();
 
-        // Process audio
-        performDSP(audioVectorIn.data(), audioVectorOut.data());
+        // Process audio, pd writes its output straight back into audioBufferIn
+        {
+            BlockTimingMonitor::ScopedStage stage(statusbarSource->blockTiming, BlockTimingMonitor::DSP);
+            performDSPBlock(audioBufferIn.getArrayOfWritePointers(), audioBufferIn.getNumChannels(), 0);
+        }
+        {
+            BlockTimingMonitor::ScopedStage stage(statusbarSource->blockTiming, BlockTimingMonitor::Messages);
+            sendMessagesFromQueue();
+        }
 
-        sendMessagesFromQueue();
+        outputFifo->writeAudioAndMidi(audioBufferIn, midiBufferOut);
+    }
 
-        if (connectionListener && plugdata_debugging_enabled())
-            connectionListener->updateSignalData();
+    outputFifo->readAudioAndMidi(buffer, midiMessages);
+}
 
-        for (int channel = 0; channel < numChannels; channel++) {
-            // Use FloatVectorOperations to copy the vector data into the audioBuffer
-            juce::FloatVectorOperations::copy(
-                audioBufferOut.getWritePointer(channel),
-                audioVectorOut.data() + (channel * pdBlockSize),
-                pdBlockSize);
-        }
+// Processes one engine block, which is one or more pd blocks
+void PluginProcessor::performDSPBlock(float* const* channels, int numChannels, int offset)
+{
+    auto const numTicks = ticksPerEngineBlock.load(std::memory_order_relaxed);
 
-        outputFifo->writeAudioAndMidi(audioBufferOut, midiBufferOut);
+    // Without anything special going on, pd can process all ticks while holding its lock once
+    if (!dspSleeping && !heavyPreview.isLoaded() && (!dspThreadPool || dspIslands.isEmpty())) {
+        performDSP(channels, numChannels, offset, numTicks);
+        return;
     }
 
-    outputFifo->readAudioAndMidi(buffer, midiMessages);
+    for (int tick = 0; tick < numTicks; tick++) {
+        performDSPTick(channels, numChannels, offset + tick * Instance::getBlockSize());
+    }
 }
 
-void PluginProcessor::sendPlayhead()
+void PluginProcessor::performDSPTick(float* const* channels, int numChannels, int offset)
 {
-    AudioPlayHead* playhead = getPlayHead();
+    // While asleep, only keep pd's clocks and messages going
+    if (dspSleeping) {
+        advanceClocks();
+        for (int ch = 0; ch < numChannels; ch++) {
+            FloatVectorOperations::clear(channels[ch] + offset, Instance::getBlockSize());
+        }
+        return;
+    }
 
-    if (!playhead)
+    // The patch compiled with heavy replaces pd's DSP, but pd still handles clocks and messages
+    if (heavyPreview.process(channels, numChannels, offset, Instance::getBlockSize())) {
+        advanceClocks();
         return;
+    }
 
-    auto infos = playhead->getPosition();
-    
-    lockAudioThread();
-    setThis();
-    if (infos.hasValue()) {
-        atoms_playhead[0] = static_cast<float>(infos->getIsPlaying());
-        sendMessage("_playhead", "playing", atoms_playhead);
+    // Parallel islands read their input from one contiguous vector, so only then do we need to copy
+    if (!dspThreadPool || dspIslands.isEmpty()) {
+        performDSP(channels, numChannels, offset);
+        return;
+    }
+
+    auto const blockSize = Instance::getBlockSize();
+    for (int ch = 0; ch < numChannels; ch++) {
+        FloatVectorOperations::copy(audioVectorIn.data() + (ch * blockSize), channels[ch] + offset, blockSize);
+    }
+
+    performMainAndParallelDSP();
 
-        atoms_playhead[0] = static_cast<float>(infos->getIsRecording());
-        sendMessage("_playhead", "recording", atoms_playhead);
+    for (int ch = 0; ch < numChannels; ch++) {
+        FloatVectorOperations::copy(channels[ch] + offset, audioVectorOut.data() + (ch * blockSize), blockSize);
+    }
+}
 
-        atoms_playhead[0] = static_cast<float>(infos->getIsLooping());
+void PluginProcessor::performMainAndParallelDSP()
+{
+    // If the message thread is adding or removing an island, just skip them for this block
+    ScopedTryLock lock(dspIslandLock);
+    if (!dspThreadPool || dspIslands.isEmpty() || !lock.isLocked()) {
+        performDSP(audioVectorIn.data(), audioVectorOut.data());
+        return;
+    }
 
-        auto loopPoints = infos->getLoopPoints();
-        if (loopPoints.hasValue()) {
-            atoms_playhead.emplace_back(static_cast<float>(loopPoints->ppqStart));
-            atoms_playhead.emplace_back(static_cast<float>(loopPoints->ppqEnd));
+    auto process = [this](int index) {
+        // Task 0 always runs on the audio thread, so the main instance's MIDI and message output stay there
+        if (index == 0) {
+            performDSP(audioVectorIn.data(), audioVectorOut.data());
         } else {
-            atoms_playhead.emplace_back(0.0f);
-            atoms_playhead.emplace_back(0.0f);
+            dspIslands.getUnchecked(index - 1)->process(audioVectorIn.data());
         }
-        sendMessage("_playhead", "looping", atoms_playhead);
+    };
 
-        if (infos->getEditOriginTime().hasValue()) {
-            atoms_playhead.resize(1);
-            atoms_playhead[0] = static_cast<float>(*infos->getEditOriginTime());
-            sendMessage("_playhead", "edittime", atoms_playhead);
-        }
+    dspThreadPool->parallelFor(dspIslands.size() + 1, process);
 
-        if (infos->getFrameRate().hasValue()) {
-            atoms_playhead.resize(1);
-            atoms_playhead[0] = static_cast<float>(infos->getFrameRate()->getEffectiveRate());
-            sendMessage("_playhead", "framerate", atoms_playhead);
-        }
+    auto const numOutputSamples = Instance::getBlockSize() * getTotalNumOutputChannels();
+    for (auto* island : dspIslands) {
+        island->addOutputTo(audioVectorOut.data(), numOutputSamples);
+    }
 
-        if (infos->getBpm().hasValue()) {
-            atoms_playhead.resize(1);
-            atoms_playhead[0] = static_cast<float>(*infos->getBpm());
-            sendMessage("_playhead", "bpm", atoms_playhead);
-        }
+    setThis();
+}
 
-        if (infos->getPpqPositionOfLastBarStart().hasValue()) {
-            atoms_playhead.resize(1);
-            atoms_playhead[0] = static_cast<float>(*infos->getPpqPositionOfLastBarStart());
-            sendMessage("_playhead", "lastbar", atoms_playhead);
-        }
+void PluginProcessor::sendPlayhead()
+{
+    AudioPlayHead* playhead = getPlayHead();
 
-        if (infos->getTimeSignature().hasValue()) {
-            atoms_playhead.resize(1);
-            atoms_playhead[0] = static_cast<float>(infos->getTimeSignature()->numerator);
-            atoms_playhead.emplace_back(static_cast<float>(infos->getTimeSignature()->denominator));
-            sendMessage("_playhead", "timesig", atoms_playhead);
-        }
-        
-        auto ppq = infos->getPpqPosition();
-        auto samplesTime = infos->getTimeInSamples();
-        auto secondsTime = infos->getTimeInSeconds();
-        if (ppq.hasValue() || samplesTime.hasValue() || secondsTime.hasValue()) {
-            atoms_playhead.resize(3);
-            atoms_playhead[0] = ppq.hasValue() ? static_cast<float>(*ppq) : 0.0f;
-            atoms_playhead[1] = samplesTime.hasValue() ? static_cast<float>(*samplesTime) : 0.0f;
-            atoms_playhead[2] = secondsTime.hasValue() ? static_cast<float>(*secondsTime) : 0.0f;
-            sendMessage("_playhead", "position", atoms_playhead);
-        }
-        atoms_playhead.resize(1);
-    }
+    if (!playhead)
+        return;
+
+    auto infos = playhead->getPosition();
+    if (!infos.hasValue() || !playheadInjector.update(*infos))
+        return;
+
+    // Don't wait for the GUI to release the lock: whatever we couldn't send now stays pending until the next block
+    if (!tryLockAudioThread())
+        return;
+
+    setThis();
+    playheadInjector.send();
     unlockAudioThread();
 }
 
-void PluginProcessor::sendParameters()
+void PluginProcessor::markParameterDirty(int const parameterIndex)
 {
-    for (auto* param : getParameters()) {
-        // We used to do dynamic_cast here, but since it gets called very often and param is always PlugDataParameter, we use reinterpret_cast now
-        auto* pldParam = reinterpret_cast<PlugDataParameter*>(param);
-        if (!pldParam->isEnabled())
-            continue;
+    jassert(isPositiveAndBelow(parameterIndex, numDirtyParameterWords * 64));
+    dirtyParameters[parameterIndex >> 6].fetch_or(uint64(1) << (parameterIndex & 63), std::memory_order_release);
+}
 
-        auto newvalue = pldParam->getUnscaledValue();
-        if (!approximatelyEqual(pldParam->getLastValue(), newvalue)) {
-            auto title = pldParam->getTitle();
-            sendFloat(title.toRawUTF8(), pldParam->getUnscaledValue());
-            pldParam->setLastValue(newvalue);
+// numSamples is the number of samples pd processes for this block, [param~] ramps to the new value over that time
+void PluginProcessor::sendParameters(int numSamples)
+{
+    auto const& parameters = getParameters();
+
+    // Only visit the parameters that changed since the last block
+    for (int word = 0; word < numDirtyParameterWords; word++) {
+        auto dirtyBits = dirtyParameters[word].exchange(0, std::memory_order_acq_rel);
+        while (dirtyBits) {
+            auto const parameterIndex = (word << 6) + std::countr_zero(dirtyBits);
+            dirtyBits &= dirtyBits - 1;
+
+            if (parameterIndex >= parameters.size())
+                break;
+
+            // We used to do dynamic_cast here, but since it gets called very often and param is always PlugDataParameter, we use reinterpret_cast now
+            auto* pldParam = reinterpret_cast<PlugDataParameter*>(parameters.getUnchecked(parameterIndex));
+            if (!pldParam->isEnabled())
+                continue;
+
+            auto newvalue = pldParam->getUnscaledValue();
+            if (pldParam->takeResendRequest()) {
+                // A new [param~] jumps straight to the current value
+                sendFloatRamp(pldParam->getRampReceiverSymbol(), newvalue, 0);
+            }
+            if (!approximatelyEqual(pldParam->getLastValue(), newvalue)) {
+                sendFloat(pldParam->getReceiverSymbol(), newvalue);
+                sendFloatRamp(pldParam->getRampReceiverSymbol(), newvalue, numSamples);
+                pldParam->setLastValue(newvalue);
+            }
         }
     }
 }
@@ -948,6 +1220,12 @@ void PluginProcessor::sendParameters()
 void PluginProcessor::sendMidiBuffer()
 {
     if (acceptsMidi()) {
+        // Checked without the lock, a listener that is being created right now will get its bytes from the next block on
+        setThis();
+        auto const sendMidiBytes = hasMidiByteListeners();
+        auto const sendSysExBytes = hasSysExListeners();
+        auto const sendRealTimeBytes = hasSysRealTimeListeners();
+
         for (auto const& event : midiBufferIn) {
 
             int device;
@@ -970,17 +1248,20 @@ void PluginProcessor::sendMidiBuffer()
             } else if (message.isProgramChange()) {
                 sendProgramChange(channel, message.getProgramChangeNumber());
             } else if (message.isSysEx()) {
-                for (int i = 0; i < message.getSysExDataSize(); ++i) {
-                    sendSysEx(device, static_cast<int>(message.getSysExData()[i]));
-                }
+                if (sendSysExBytes)
+                    sendSysEx(device, message.getSysExData(), message.getSysExDataSize());
             } else if (message.isMidiClock() || message.isMidiStart() || message.isMidiStop() || message.isMidiContinue() || message.isActiveSense() || (message.getRawDataSize() == 1 && message.getRawData()[0] == 0xff)) {
-                for (int i = 0; i < message.getRawDataSize(); ++i) {
-                    sendSysRealTime(device, static_cast<int>(message.getRawData()[i]));
+                if (sendRealTimeBytes) {
+                    for (int i = 0; i < message.getRawDataSize(); ++i) {
+                        sendSysRealTime(device, static_cast<int>(message.getRawData()[i]));
+                    }
                 }
             }
 
-            for (int i = 0; i < message.getRawDataSize(); i++) {
-                sendMidiByte(device, static_cast<int>(message.getRawData()[i]));
+            if (sendMidiBytes) {
+                for (int i = 0; i < message.getRawDataSize(); i++) {
+                    sendMidiByte(device, static_cast<int>(message.getRawData()[i]));
+                }
             }
         }
         midiBufferIn.clear();
@@ -994,6 +1275,14 @@ bool PluginProcessor::hasEditor() const
 
 AudioProcessorEditor* PluginProcessor::createEditor()
 {
+    // The library is only used for the editor's autocompletion, help files and tooltips
+    // Hosts create lots of instances that never get an editor when they scan or load a session, those shouldn't have to index all objects
+    if (!objectLibrary) {
+        StartupProfiler::Phase phase("Create library");
+        objectLibrary = std::make_unique<pd::Library>(this);
+    }
+
+    StartupProfiler::Phase phase("Create editor");
     auto* editor = new PluginEditor(*this);
     setThis();
 
@@ -1007,6 +1296,146 @@ AudioProcessorEditor* PluginProcessor::createEditor()
     return editor;
 }
 
+// Saved array contents ("#A" lines) are usually the bulk of a large patch, and as text every value takes around ten bytes
+// In the DAW state we store them as float32 instead, which is also much quicker to write and read back than formatting and parsing text
+// Patch text can't start with this tag, so states saved before we did this still load
+static constexpr char packedPatchTag[] = "#PACKED1\n";
+static constexpr size_t minPackedArraySize = 64;
+
+enum PackedRecord : uint8 {
+    packedText = 0,
+    packedArray = 1,
+    packedEnd = 2
+};
+
+static void writePackedPatchContent(OutputStream& out, String const& content)
+{
+    auto const text = content.toStdString();
+    out.write(packedPatchTag, sizeof(packedPatchTag) - 1);
+
+    auto writeText = [&out, &text](size_t start, size_t end) {
+        if (end <= start)
+            return;
+        out.writeByte(static_cast<char>(packedText));
+        out.writeInt(static_cast<int>(end - start));
+        out.write(text.data() + start, end - start);
+    };
+
+    std::vector<float> values;
+    size_t textStart = 0;
+    size_t position = 0;
+    while ((position = text.find("#A ", position)) != std::string::npos) {
+        auto const statementEnd = text.find(';', position);
+        if (statementEnd == std::string::npos)
+            break;
+
+        // Only whole statements that contain nothing but numbers, like "#A 0 0.5 0.25;"
+        if (position != 0 && text[position - 1] != '\n') {
+            position = statementEnd;
+            continue;
+        }
+
+        auto const* cursor = text.data() + position + 3;
+        auto const* end = text.data() + statementEnd;
+        char* parsedEnd;
+        auto const startIndex = std::strtol(cursor, &parsedEnd, 10);
+        bool isNumeric = parsedEnd != cursor && parsedEnd <= end;
+        cursor = parsedEnd;
+
+        values.clear();
+        while (isNumeric) {
+            while (cursor < end && (*cursor == ' ' || *cursor == '\n'))
+                cursor++;
+            if (cursor >= end)
+                break;
+
+            auto const value = std::strtof(cursor, &parsedEnd);
+            isNumeric = parsedEnd != cursor && parsedEnd <= end && (parsedEnd == end || *parsedEnd == ' ' || *parsedEnd == '\n');
+            values.push_back(value);
+            cursor = parsedEnd;
+        }
+
+        if (!isNumeric || values.size() < minPackedArraySize) {
+            position = statementEnd;
+            continue;
+        }
+
+        writeText(textStart, position);
+        out.writeByte(static_cast<char>(packedArray));
+        out.writeInt(static_cast<int>(startIndex));
+        out.writeInt(static_cast<int>(values.size()));
+        for (auto const value : values)
+            out.writeFloat(value);
+
+        position = textStart = statementEnd + 1;
+    }
+
+    writeText(textStart, text.size());
+    out.writeByte(static_cast<char>(packedEnd));
+}
+
+static String readPackedPatchContent(InputStream& in)
+{
+    MemoryOutputStream text;
+    char number[32];
+
+    while (!in.isExhausted()) {
+        auto const type = static_cast<uint8>(in.readByte());
+        if (type == packedText) {
+            auto const length = in.readInt();
+            if (length < 0 || text.writeFromInputStream(in, length) != length)
+                break;
+        } else if (type == packedArray) {
+            auto const startIndex = in.readInt();
+            auto const numValues = in.readInt();
+            if (numValues < 0)
+                break;
+
+            text << "#A " << String(startIndex);
+            for (int i = 0; i < numValues && !in.isExhausted(); i++) {
+                // Nine significant digits is enough for pd to read back the exact same float
+                auto const length = std::snprintf(number, sizeof(number), " %.9g", in.readFloat());
+                text.write(number, static_cast<size_t>(length));
+            }
+            text << ";";
+        } else {
+            break;
+        }
+    }
+
+    return text.toUTF8();
+}
+
+String PluginProcessor::compressPatchContent(String const& content)
+{
+    MemoryOutputStream compressed;
+    {
+        GZIPCompressorOutputStream stream(compressed, 9);
+        writePackedPatchContent(stream, content);
+    }
+    return compressed.getMemoryBlock().toBase64Encoding();
+}
+
+String PluginProcessor::decompressPatchContent(String const& data)
+{
+    MemoryBlock block;
+    if (!block.fromBase64Encoding(data))
+        return {};
+
+    MemoryInputStream compressed(block, false);
+    GZIPDecompressorInputStream stream(compressed);
+
+    MemoryBlock decompressed;
+    stream.readIntoMemoryBlock(decompressed);
+
+    auto const tagLength = sizeof(packedPatchTag) - 1;
+    if (decompressed.getSize() < tagLength || std::memcmp(decompressed.getData(), packedPatchTag, tagLength) != 0)
+        return decompressed.toString();
+
+    MemoryInputStream packed(static_cast<char const*>(decompressed.getData()) + tagLength, decompressed.getSize() - tagLength, false);
+    return readPackedPatchContent(packed);
+}
+
 void PluginProcessor::getStateInformation(MemoryBlock& destData)
 {
     setThis();
@@ -1014,36 +1443,95 @@ void PluginProcessor::getStateInformation(MemoryBlock& destData)
     // Store pure-data and parameter state
     MemoryOutputStream ostream(destData, false);
 
-    ostream.writeInt(patches.size());
+    struct PatchSnapshot {
+        pd::Patch* patch;
+        char* buffer = nullptr;
+        int size = 0;
+        String location;
+        bool pluginMode;
+        int splitIndex;
+    };
+
+    std::vector<PatchSnapshot> snapshots;
+    snapshots.reserve(patches.size());
 
-    // Save path and content for patch
+    // Only let pd serialise the patches while we hold the audio lock
+    // Converting to Strings and building the XML happens after releasing it, so DSP isn't held up by host autosaves
     lockAudioThread();
+    for (auto const& patch : patches) {
+        PatchSnapshot snapshot { patch.get() };
+        if (auto cnv = patch->getPointer()) {
+            pd::Interface::getCanvasContent(cnv.get(), &snapshot.buffer, &snapshot.size);
+        }
+        snapshot.location = patch->getCurrentFile().getFullPathName();
+        snapshot.pluginMode = patch->openInPluginMode;
+        snapshot.splitIndex = patch->splitViewIndex;
+        snapshots.push_back(snapshot);
+    }
+    unlockAudioThread();
+
+    ostream.writeInt(static_cast<int>(snapshots.size()));
 
-    auto presetDir = ProjectInfo::appDataDir.getChildFile("Extra").getChildFile("Presets");
+    // By default, every distinct patch is stored once, compressed, and referenced by hash
+    // With "legacy_daw_state" enabled, we write the full content into the legacy stream and each patch element instead, so older versions can load it
+    auto const writeLegacyContent = settingsFile->getProperty<bool>("legacy_daw_state");
 
     auto patchesTree = new XmlElement("Patches");
+    auto contentsTree = new XmlElement("Contents");
+
+    ScopedLock cacheLock(patchContentCacheLock);
+    std::unordered_map<pd::Patch*, CachedPatchContent> newContentCache;
+
+    for (auto& snapshot : snapshots) {
+        CachedPatchContent entry;
+        if (snapshot.buffer) {
+            auto const rawHash = std::hash<std::string_view>()(std::string_view(snapshot.buffer, static_cast<size_t>(snapshot.size)));
+            auto cached = patchContentCache.find(snapshot.patch);
+            if (cached != patchContentCache.end() && cached->second.hash == rawHash && cached->second.size == snapshot.size) {
+                entry = cached->second;
+            } else {
+                entry = { rawHash, snapshot.size, String::fromUTF8(snapshot.buffer, snapshot.size) };
+            }
 
-    for (auto const& patch : patches) {
+            freebytes(static_cast<void*>(snapshot.buffer), static_cast<size_t>(snapshot.size) * sizeof(char));
+        }
 
-        auto content = patch->getCanvasContent();
-        auto patchFile = patch->getCurrentFile().getFullPathName();
+        auto const& content = entry.content;
 
         // Write legacy format
-        ostream.writeString(content);
-        ostream.writeString(patchFile);
+        ostream.writeString(writeLegacyContent ? content : String());
+        ostream.writeString(snapshot.location);
 
         auto* patchTree = new XmlElement("Patch");
         // Write new format
-        patchTree->setAttribute("Content", content);
-        patchTree->setAttribute("Location", patchFile);
-        patchTree->setAttribute("PluginMode", patch->openInPluginMode);
-        patchTree->setAttribute("SplitIndex", patch->splitViewIndex);
+        if (writeLegacyContent || content.isEmpty()) {
+            patchTree->setAttribute("Content", content);
+        } else {
+            if (entry.compressedContent.isEmpty()) {
+                entry.contentHash = String::toHexString(content.hashCode64());
+                entry.compressedContent = compressPatchContent(content);
+            }
+
+            patchTree->setAttribute("ContentHash", entry.contentHash);
+            if (!contentsTree->getChildByAttribute("Hash", entry.contentHash)) {
+                auto* contentTree = contentsTree->createNewChildElement("Content");
+                contentTree->setAttribute("Hash", entry.contentHash);
+                contentTree->setAttribute("Data", entry.compressedContent);
+            }
+        }
+        patchTree->setAttribute("Location", snapshot.location);
+        patchTree->setAttribute("PluginMode", snapshot.pluginMode);
+        patchTree->setAttribute("SplitIndex", snapshot.splitIndex);
 
         patchesTree->addChildElement(patchTree);
+
+        if (snapshot.buffer)
+            newContentCache[snapshot.patch] = std::move(entry);
     }
-    unlockAudioThread();
 
-    ostream.writeInt(getLatencySamples() - Instance::getBlockSize());
+    patchContentCache = std::move(newContentCache);
+
+    ostream.writeInt(customLatencySamples);
     ostream.writeInt(oversampling);
     ostream.writeFloat(getValue<float>(tailLength));
 
@@ -1053,7 +1541,9 @@ void PluginProcessor::getStateInformation(MemoryBlock& destData)
     // In the future, we're gonna load everything from xml, to make it easier to add new properties
     // By putting this here, we can prepare for making this change without breaking existing DAW saves
     xml.setAttribute("Oversampling", oversampling);
-    xml.setAttribute("Latency", getLatencySamples() - Instance::getBlockSize());
+    xml.setAttribute("Latency", customLatencySamples);
+    xml.setAttribute("OversamplingQuality", oversamplingQuality.load());
+    xml.setAttribute("EngineBlockSize", getEngineBlockSize());
     xml.setAttribute("TailLength", getValue<float>(tailLength));
     xml.setAttribute("Legacy", false);
 
@@ -1067,6 +1557,7 @@ void PluginProcessor::getStateInformation(MemoryBlock& destData)
     }
 
     xml.addChildElement(patchesTree);
+    xml.addChildElement(contentsTree);
 
     PlugDataParameter::saveStateInformation(xml, getParameters());
 
@@ -1101,24 +1592,10 @@ void PluginProcessor::setStateInformation(void const* data, int sizeInBytes)
     lockAudioThread();
 
     setThis();
-    
-    patches.clear();
 
-    std::vector<pd::WeakReference> openedPatches;
-    // Close all patches
-    for (auto* cnv = pd_getcanvaslist(); cnv; cnv = cnv->gl_next) {
-        openedPatches.push_back(pd::WeakReference(cnv, this));
-    }
-    for(auto patch : openedPatches)
-    {
-        if(auto cnv = patch.get<t_glist*>()) {
-            libpd_closefile(cnv.get());
-        }
-    }
-    
     int numPatches = istream.readInt();
 
-    Array<std::pair<String, File>> patches;
+    Array<std::pair<String, File>> legacyPatches;
 
     for (int i = 0; i < numPatches; i++) {
         auto state = istream.readString();
@@ -1126,7 +1603,7 @@ void PluginProcessor::setStateInformation(void const* data, int sizeInBytes)
 
         auto presetDir = ProjectInfo::appDataDir.getChildFile("Extra").getChildFile("Presets");
         path = path.replace("${PRESET_DIR}", presetDir.getFullPathName());
-        patches.add({ state, File(path) });
+        legacyPatches.add({ state, File(path) });
     }
 
     auto legacyLatency = istream.readInt();
@@ -1140,6 +1617,109 @@ void PluginProcessor::setStateInformation(void const* data, int sizeInBytes)
 
     std::unique_ptr<XmlElement> xmlState(getXmlFromBinary(xmlData, xmlSize));
 
+    struct PatchState {
+        String content;
+        File location;
+        bool pluginMode = false;
+        int splitIndex = 0;
+        String contentHash;
+    };
+    std::vector<PatchState> patchStates;
+
+    if (xmlState) {
+        // If xmltree contains new patch format, use that
+        if (auto* patchTree = xmlState->getChildByName("Patches")) {
+            auto* contentsTree = xmlState->getChildByName("Contents");
+            for (auto p : patchTree->getChildWithTagNameIterator("Patch")) {
+                auto content = p->getStringAttribute("Content");
+                auto location = p->getStringAttribute("Location");
+                auto pluginMode = p->getBoolAttribute("PluginMode");
+                String contentHash;
+
+                // Patches with the same content are only stored once, compressed
+                if (p->hasAttribute("ContentHash") && contentsTree) {
+                    if (auto* contentTree = contentsTree->getChildByAttribute("Hash", p->getStringAttribute("ContentHash"))) {
+                        content = decompressPatchContent(contentTree->getStringAttribute("Data"));
+                        contentHash = p->getStringAttribute("ContentHash");
+                    }
+                }
+
+                int splitIndex = 0;
+                if (p->hasAttribute("SplitIndex")) {
+                    splitIndex = p->getIntAttribute("SplitIndex");
+                }
+
+                auto presetDir = ProjectInfo::versionDataDir.getChildFile("Extra").getChildFile("Presets");
+                location = location.replace("${PRESET_DIR}", presetDir.getFullPathName());
+
+                patchStates.push_back({ content, File(location), pluginMode, splitIndex, contentHash });
+            }
+        }
+        // Otherwise, load from legacy format
+        else {
+            for (auto& [content, location] : legacyPatches) {
+                patchStates.push_back({ content, location });
+            }
+        }
+    }
+
+    // Hosts often hand us back the exact state we just gave them
+    // If pd would serialise our patches into exactly the same content, there's no need to close and reload them all
+    auto const matchesLoadedPatches = [this, &patchStates, &xmlState]() {
+        if (!xmlState || patchStates.empty() || patchStates.size() != static_cast<size_t>(patches.size()))
+            return false;
+
+        for (int i = 0; i < patches.size(); i++) {
+            auto content = patchStates[i].content;
+            auto cnv = patches[i]->getPointer();
+            if (!cnv)
+                return false;
+
+            // Presets only refer to a patch file, compare against that if it's the file we have open
+            if (content.isEmpty() && patches[i]->getCurrentFile() == patchStates[i].location && patchStates[i].location.existsAsFile()) {
+                content = patchStates[i].location.loadFileAsString();
+            }
+            if (content.isEmpty())
+                return false;
+
+            char* buf;
+            int bufsize;
+            pd::Interface::getCanvasContent(cnv.get(), &buf, &bufsize);
+
+            // Packed arrays don't decode back into pd's exact formatting, so compressed content is compared by the hash of the text it was made from
+            bool matches;
+            if (patchStates[i].contentHash.isNotEmpty())
+                matches = String::toHexString(String::fromUTF8(buf, bufsize).hashCode64()) == patchStates[i].contentHash;
+            else
+                matches = static_cast<size_t>(bufsize) == content.getNumBytesAsUTF8() && std::memcmp(buf, content.toRawUTF8(), static_cast<size_t>(bufsize)) == 0;
+            freebytes(static_cast<void*>(buf), static_cast<size_t>(bufsize) * sizeof(char));
+
+            if (!matches)
+                return false;
+        }
+        return true;
+    }();
+
+    if (matchesLoadedPatches) {
+        for (int i = 0; i < patches.size(); i++) {
+            patches[i]->splitViewIndex = patchStates[i].splitIndex;
+            patches[i]->openInPluginMode = patchStates[i].pluginMode;
+        }
+    } else {
+        patches.clear();
+
+        std::vector<pd::WeakReference> openedPatches;
+        // Close all patches
+        for (auto* cnv = pd_getcanvaslist(); cnv; cnv = cnv->gl_next) {
+            openedPatches.push_back(pd::WeakReference(cnv, this));
+        }
+        for (auto patch : openedPatches) {
+            if (auto cnv = patch.get<t_glist*>()) {
+                libpd_closefile(cnv.get());
+            }
+        }
+    }
+
     auto openPatch = [this](String const& content, File const& location, bool pluginMode = false, int splitIndex = 0) {
         // CHANGED IN v0.9.0:
         // We now prefer loading the patch content over the patch file, if possible
@@ -1169,28 +1749,9 @@ void PluginProcessor::setStateInformation(void const* data, int sizeInBytes)
     };
 
     if (xmlState) {
-        // If xmltree contains new patch format, use that
-        if (auto* patchTree = xmlState->getChildByName("Patches")) {
-            for (auto p : patchTree->getChildWithTagNameIterator("Patch")) {
-                auto content = p->getStringAttribute("Content");
-                auto location = p->getStringAttribute("Location");
-                auto pluginMode = p->getBoolAttribute("PluginMode");
-
-                int splitIndex = 0;
-                if (p->hasAttribute("SplitIndex")) {
-                    splitIndex = p->getIntAttribute("SplitIndex");
-                }
-
-                auto presetDir = ProjectInfo::versionDataDir.getChildFile("Extra").getChildFile("Presets");
-                location = location.replace("${PRESET_DIR}", presetDir.getFullPathName());
-
-                openPatch(content, location, pluginMode, splitIndex);
-            }
-        }
-        // Otherwise, load from legacy format
-        else {
-            for (auto& [content, location] : patches) {
-                openPatch(content, location);
+        if (!matchesLoadedPatches) {
+            for (auto& state : patchStates) {
+                openPatch(state.content, state.location, state.pluginMode, state.splitIndex);
             }
         }
 
@@ -1198,17 +1759,32 @@ void PluginProcessor::setStateInformation(void const* data, int sizeInBytes)
 
         PlugDataParameter::loadStateInformation(*xmlState, getParameters());
 
+        // Sessions saved with more parameters than we expose lose the rest, make sure the next load has them
+        int numSavedParameters = 0;
+        for (auto* paramXml : xmlState->getChildWithTagNameIterator("PARAM")) {
+            if (paramXml->getIntAttribute("enabled", 1))
+                numSavedParameters = std::max(numSavedParameters, paramXml->getStringAttribute("id").fromFirstOccurrenceOf("param", false, false).getIntValue());
+        }
+        reserveParameters(numSavedParameters);
+
         auto versionString = String("0.6.1"); // latest version that didn't have version inside the daw state
 
         if (!xmlState->hasAttribute("Legacy") || xmlState->getBoolAttribute("Legacy")) {
-            setLatencySamples(legacyLatency + Instance::getBlockSize());
+            customLatencySamples = legacyLatency;
             setOversampling(legacyOversampling);
             tailLength = legacyTail;
         } else {
+            if (xmlState->hasAttribute("OversamplingQuality")) {
+                setOversamplingQuality(xmlState->getIntAttribute("OversamplingQuality"));
+            }
+            if (xmlState->hasAttribute("EngineBlockSize")) {
+                setEngineBlockSize(xmlState->getIntAttribute("EngineBlockSize"));
+            }
+            customLatencySamples = xmlState->getIntAttribute("Latency");
             setOversampling(xmlState->getDoubleAttribute("Oversampling"));
-            setLatencySamples(xmlState->getDoubleAttribute("Latency") + Instance::getBlockSize());
             tailLength = xmlState->getDoubleAttribute("TailLength");
         }
+        updateLatency();
 
         if (xmlState->hasAttribute("Version")) {
             versionString = xmlState->getStringAttribute("Version");
@@ -1482,6 +2058,19 @@ void PluginProcessor::receiveSysMessage(String const& selector, std::vector<pd::
         }
         break;
     }
+    case hash("parallel"): {
+        if (list.size() >= 2) {
+            auto patch = File(list[1].toString()).getChildFile(list[0].toString());
+            openParallelPatch(patch);
+        }
+        break;
+    }
+    case hash("parallel_close"): {
+        if (list.size() >= 2) {
+            closeParallelPatch(File(list[1].toString()).getChildFile(list[0].toString()));
+        }
+        break;
+    }
     case hash("dsp"): {
         bool dsp = list[0].getFloat();
         for (auto* editor : getEditors()) {
@@ -1641,7 +2230,7 @@ void PluginProcessor::performLatencyCompensationChange(float value)
             editor->statusbar->setLatencyDisplay(customLatencySamples);
         }
 
-        setLatencySamples(customLatencySamples + Instance::getBlockSize());
+        updateLatency();
     }
 }
 
@@ -1650,6 +2239,22 @@ void PluginProcessor::sendParameterInfoChangeMessage()
     hostInfoUpdater.triggerAsyncUpdate();
 }
 
+void PluginProcessor::reserveParameters(int const numNeeded)
+{
+    if (!dynamicParameters || numNeeded <= numParameters)
+        return;
+
+    // We can't add parameters once the host has seen them, so the new block is there the next time plugdata is loaded
+    auto const numBlocks = std::min((numNeeded + parameterBlockSize - 1) / parameterBlockSize, maxParameters / parameterBlockSize);
+    MessageManager::callAsync([numBlocks] {
+        auto* settings = SettingsFile::getInstance();
+        if (settings->getProperty<int>("parameter_blocks") < numBlocks)
+            settings->setProperty("parameter_blocks", numBlocks);
+    });
+
+    logWarning("Out of host parameters: reload plugdata to get " + String(numBlocks * parameterBlockSize) + " instead of " + String(numParameters));
+}
+
 void PluginProcessor::setParameterRange(String const& name, float min, float max)
 {
     for (auto* p : getParameters()) {
@@ -1692,6 +2297,7 @@ void PluginProcessor::enableAudioParameter(String const& name)
         }
     }
 
+    bool foundFreeParameter = false;
     for (auto* p : getParameters()) {
         auto* param = dynamic_cast<PlugDataParameter*>(p);
         if (!param->isEnabled()) {
@@ -1699,15 +2305,28 @@ void PluginProcessor::enableAudioParameter(String const& name)
             param->setName(name);
             param->setIndex(numEnabled + 1);
             param->notifyDAW();
+            foundFreeParameter = true;
             break;
         }
     }
 
+    if (!foundFreeParameter)
+        reserveParameters(numEnabled + 1);
+
     for (auto* editor : getEditors()) {
         editor->sidebar->updateAutomationParameters();
     }
 }
 
+void PluginProcessor::resendAudioParameter(String const& name)
+{
+    for (auto* param : getParameters()) {
+        auto* pldParam = dynamic_cast<PlugDataParameter*>(param);
+        if (pldParam->isEnabled() && pldParam->getTitle() == name)
+            pldParam->requestResend();
+    }
+}
+
 void PluginProcessor::performParameterChange(int type, String const& name, float value)
 {
     // Type == 1 means it sets the change gesture state
@@ -1817,11 +2436,162 @@ void PluginProcessor::parseDataBuffer(XmlElement const& xml)
 
 void PluginProcessor::updateConsole(int numMessages, bool newWarning)
 {
+    // Without an editor, the console goes to stdout
+    if (ProjectInfo::isHeadless) {
+        auto& messages = getConsoleMessages();
+        for (auto sequence = std::max(messages.getFirstShown(), messages.getEnd() - numMessages); sequence < messages.getEnd(); sequence++) {
+            std::cout << messages.getMessage(messages.get(sequence)) << std::endl;
+        }
+        return;
+    }
+
     for (auto* editor : getEditors()) {
         editor->sidebar->updateConsole(numMessages, newWarning);
     }
 }
 
+void PluginProcessor::printMemoryReport()
+{
+    auto formatBytes = [](size_t bytes) {
+        return File::descriptionOfSizeInBytes(static_cast<int64>(bytes));
+    };
+
+    // GPU images and framebuffers, by the canvas that created them
+    std::map<void const*, size_t> imageBytes;
+    for (auto* image : NVGImage::allImages)
+        imageBytes[image->usage.owner] += image->getMemorySize();
+    for (auto* framebuffer : NVGFramebuffer::allFramebuffers)
+        imageBytes[framebuffer->usage.owner] += framebuffer->getMemorySize();
+
+    struct GuiUsage {
+        int numObjects = 0;
+        int numConnections = 0;
+        size_t imageBytes = 0;
+    };
+    std::map<t_canvas const*, GuiUsage> guiUsage;
+    auto const editors = getEditors();
+    for (auto* editor : editors) {
+        for (auto* cnv : editor->getCanvases()) {
+            auto& usage = guiUsage[cnv->patch.getUncheckedPointer()];
+            usage.numObjects += cnv->objects.size();
+            usage.numConnections += cnv->connections.size();
+            if (auto it = imageBytes.find(cnv); it != imageBytes.end()) {
+                usage.imageBytes += it->second;
+                imageBytes.erase(it);
+            }
+        }
+    }
+
+    StringArray lines;
+    StringArray leaks;
+    size_t totalBytes = 0;
+
+    lockAudioThread();
+    setThis();
+
+    std::set<t_canvas const*> loadedPatches;
+    for (auto const& patch : patches) {
+        auto const usage = patch->getMemoryUsage();
+        totalBytes += usage.getTotalBytes();
+        loadedPatches.insert(patch->getUncheckedPointer());
+
+        auto line = patch->getTitle() + ": " + formatBytes(usage.getTotalBytes()) + " in pd ("
+            + String(usage.numObjects) + " objects " + formatBytes(usage.objectBytes) + ", "
+            + String(usage.numArrays) + " arrays " + formatBytes(usage.arrayBytes) + ", "
+            + String(usage.numTextBuffers) + " text buffers " + formatBytes(usage.textBytes) + ", "
+            + String(usage.numCloneInstances) + " clone instances, "
+            + String(usage.numUndoSteps) + " undo steps)";
+
+        if (auto it = guiUsage.find(patch->getUncheckedPointer()); it != guiUsage.end()) {
+            auto const& gui = it->second;
+            totalBytes += gui.imageBytes;
+            line += ", GUI: " + String(gui.numObjects) + " objects, " + String(gui.numConnections) + " connections, " + formatBytes(gui.imageBytes) + " of images";
+        } else if (!editors.isEmpty()) {
+            leaks.add(patch->getTitle() + " has no open window, but is still loaded: " + formatBytes(usage.getTotalBytes()));
+        }
+
+        lines.add(line);
+    }
+
+    // Top-level patches pd still knows about, that we don't have in our list anymore
+    for (auto* glist = pd_getcanvaslist(); glist; glist = glist->gl_next) {
+        if (loadedPatches.count(glist))
+            continue;
+
+        auto const usage = pd::Patch::getMemoryUsage(glist);
+        leaks.add(String::fromUTF8(glist->gl_name->s_name) + " was closed, but is still loaded in pd: " + formatBytes(usage.getTotalBytes()));
+    }
+
+    // Signal vectors are recycled by pd between rebuilds, the chain itself is what gets reallocated every time
+    auto const chainSize = plugdata_dspchainsize(static_cast<t_pdinstance*>(instance));
+    auto const chainBytes = static_cast<size_t>(std::max(chainSize, 0)) * sizeof(t_int);
+    totalBytes += chainBytes;
+    lines.add("DSP chain: " + String(chainSize) + " entries, " + formatBytes(chainBytes));
+
+    unlockAudioThread();
+
+    size_t otherImageBytes = 0;
+    for (auto const& [owner, size] : imageBytes)
+        otherImageBytes += size;
+
+    logMessage("Memory report:");
+    for (auto const& line : lines)
+        logMessage(line);
+    logMessage("Other images: " + formatBytes(otherImageBytes));
+    logMessage("Total: " + formatBytes(totalBytes + otherImageBytes));
+
+    for (auto const& leak : leaks)
+        logWarning(leak);
+}
+
+ProcessMetrics::Snapshot PluginProcessor::getMetrics()
+{
+    ProcessMetrics::Snapshot snapshot;
+    {
+        ScopedLock lock(trackNameLock);
+        snapshot.name = trackName;
+    }
+    if (snapshot.name.isEmpty() && !patches.isEmpty())
+        snapshot.name = patches.getFirst()->getTitle();
+    if (snapshot.name.isEmpty())
+        snapshot.name = "plugdata";
+
+    auto const& timing = statusbarSource->blockTiming;
+    snapshot.cpuLoad = static_cast<float>(cpuLoadMeasurer.getLoadAsPercentage());
+    snapshot.worstBlockLoad = timing.getWorstBlockLoad();
+    snapshot.numBlocks = timing.getNumBlocks();
+    snapshot.numOverruns = timing.getNumOverruns();
+    snapshot.functionQueueDepth = getNumQueuedFunctions();
+    snapshot.guiQueueDepth = getNumQueuedGuiMessages();
+    snapshot.dispatcherQueueDepth = static_cast<size_t>(messageDispatcher->getNumQueuedMessages());
+    snapshot.numDroppedMessages = messageDispatcher->getNumDroppedMessages();
+    snapshot.numPatches = patches.size();
+    snapshot.numStolenSynthVoices = internalSynth->getNumStolenVoices();
+    snapshot.synthVoiceBudget = internalSynth->getVoiceBudget();
+
+    // Walking the patches needs pd's lock, so we only do it every few seconds, and not while the audio thread has it
+    auto const now = Time::getMillisecondCounter();
+    if ((lastMemoryMeasurement == 0 || now - lastMemoryMeasurement > 5000) && tryLockAudioThread()) {
+        setThis();
+        size_t bytes = 0;
+        for (auto const& patch : patches)
+            bytes += patch->getMemoryUsage().getTotalBytes();
+        unlockAudioThread();
+
+        lastPdMemory = bytes;
+        lastMemoryMeasurement = now;
+    }
+    snapshot.pdMemory = lastPdMemory;
+
+    return snapshot;
+}
+
+void PluginProcessor::updateTrackProperties(TrackProperties const& properties)
+{
+    ScopedLock lock(trackNameLock);
+    trackName = properties.name;
+}
+
 Array<PluginEditor*> PluginProcessor::getEditors() const
 {
     Array<PluginEditor*> editors;
@@ -1847,16 +2617,24 @@ void PluginProcessor::reloadAbstractions(File changedPatch, t_glist* except)
 
     isPerformingGlobalSync = true;
 
+    // Only the canvases that show (a part of) an instance of this abstraction change, the rest doesn't need to be synchronised
+    // This has to be checked before reloading, since the reload replaces the instances
+    std::map<PluginEditor*, Array<Component::SafePointer<Canvas>>> affectedCanvases;
+    for (auto* editor : getEditors()) {
+        for (auto* canvas : editor->getCanvases()) {
+            if (auto glist = canvas->patch.getPointer()) {
+                if (pd::Patch::isAffectedByReload(glist.get(), changedPatch))
+                    affectedCanvases[editor].add(canvas);
+            }
+        }
+    }
+
     pd::Patch::reloadPatch(changedPatch, except);
 
     for (auto* editor : getEditors()) {
 
-        // Synchronising can potentially delete some other canvases, so make sure we use a safepointer
-        Array<Component::SafePointer<Canvas>> canvases;
-
-        for (auto* canvas : editor->getCanvases()) {
-            canvases.add(canvas);
-        }
+        // Synchronising can potentially delete some other canvases, so we use a safepointer
+        auto& canvases = affectedCanvases[editor];
 
         for (auto& cnv : canvases) {
             if (cnv.getComponent()) {
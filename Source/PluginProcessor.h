@@ -13,9 +13,14 @@
 #include "Utility/Limiter.h"
 #include "Utility/SettingsFile.h"
 #include <Utility/AudioMidiFifo.h>
+#include "Utility/DSPThreadPool.h"
 
 #include "Pd/Instance.h"
 #include "Pd/Patch.h"
+#include "Pd/DSPIsland.h"
+#include "Heavy/HeavyPreview.h"
+#include "Utility/PlayheadInjector.h"
+#include "Utility/ProcessMetrics.h"
 
 namespace pd {
 class Library;
@@ -24,12 +29,14 @@ class Library;
 class InternalSynth;
 class SettingsFile;
 class StatusbarSource;
+class SearchIndex;
+class CanvasSyncScheduler;
 struct PlugDataLook;
 class PluginEditor;
-class ConnectionMessageDisplay;
 class PluginProcessor : public AudioProcessor
     , public pd::Instance
     , public SettingsFileListener
+    , public ProcessMetrics::Source
 {
 public:
     PluginProcessor();
@@ -39,11 +46,17 @@ public:
     static AudioProcessor::BusesProperties buildBusesProperties();
 
     void setOversampling(int amount);
+    void setOversamplingQuality(int quality);
+    void setEngineBlockSize(int blockSize);
+    int getEngineBlockSize() const;
+    void updateLatency();
+    void handleAsyncUpdate() override;
     void setLimiterThreshold(int amount);
     void setProtectedMode(bool enabled);
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
     void numChannelsChanged() override;
     void releaseResources() override;
+    void audioWorkgroupContextChanged(AudioWorkgroup const& workgroup) override;
 
     void updateAllEditorsLNF();
 
@@ -109,26 +122,47 @@ public:
     }
 
     void updatePatchUndoRedoState();
+    std::atomic<bool> undoRedoStateUpdatePending = false;
 
     void settingsFileReloaded() override;
 
     void initialiseFilesystem();
     void updateSearchPaths();
+    StringArray getSearchPaths();
+
+    void setMultiCoreDSP(bool enabled);
+    void setSleepWhenSilent(bool enabled);
+    void openParallelPatch(File const& patchFile);
+    void closeParallelPatch(File const& patchFile);
+    Array<File> getParallelPatches();
 
     void sendMidiBuffer();
     void sendPlayhead();
-    void sendParameters();
+    void sendParameters(int numSamples);
+    void markParameterDirty(int parameterIndex);
 
     Array<PluginEditor*> getEditors() const;
 
+    // Prints how much memory every open patch uses to the console, on the pd side and on the GUI side
+    // Also lists patches that were closed, but are still loaded
+    void printMemoryReport();
+
+    // What the metrics of every instance in the process show for this one
+    ProcessMetrics::Snapshot getMetrics() override;
+    void updateTrackProperties(TrackProperties const& properties) override;
+
     void performParameterChange(int type, String const& name, float value) override;
     void enableAudioParameter(String const& name) override;
+    void resendAudioParameter(String const& name) override;
     void setParameterRange(String const& name, float min, float max) override;
     void setParameterMode(String const& name, int mode) override;
 
     void performLatencyCompensationChange(float value) override;
     void sendParameterInfoChangeMessage();
 
+    // Makes sure the next instance exposes enough parameters, when we run out with dynamic parameters
+    void reserveParameters(int numNeeded);
+
     void fillDataBuffer(std::vector<pd::Atom> const& list) override;
     void parseDataBuffer(XmlElement const& xml) override;
     std::unique_ptr<XmlElement> extraData;
@@ -155,12 +189,25 @@ public:
 
     std::unique_ptr<StatusbarSource> statusbarSource;
 
+    // What the search panel shows for every open patch, shared by all editors
+    std::unique_ptr<SearchIndex> searchIndex;
+
+    // Coalesces the syncs of all canvases in all editors, so a patch shown in several places is read from pd once
+    std::unique_ptr<CanvasSyncScheduler> canvasSyncScheduler;
+
     Value tailLength = Value(0.0f);
 
     // Just so we never have to deal with deleting the default LnF
     SharedResourcePointer<PlugDataLook> lnf;
 
-    static inline constexpr int numParameters = 512;
+    static inline constexpr int maxParameters = 512;
+    static inline constexpr int parameterBlockSize = 64;
+    static inline constexpr int numDirtyParameterWords = (maxParameters + 64) / 64; // One extra bit for the volume parameter
+
+    // Hosts build automation lanes and state for every parameter we expose, and only ask how many there are once
+    // With a fixed parameter count that's always maxParameters. Otherwise we expose as many blocks as patches have needed so far
+    int numParameters = maxParameters;
+    bool dynamicParameters = false;
     static inline constexpr int numInputBuses = 16;
     static inline constexpr int numOutputBuses = 16;
 
@@ -169,29 +216,57 @@ public:
 
     // Zero means no oversampling
     std::atomic<int> oversampling = 0;
+    std::atomic<int> oversamplingQuality = 0;
+
+    // Number of pd blocks we process between handling messages and MIDI, more than one trades latency for throughput
+    std::atomic<int> ticksPerEngineBlock = 1;
+
+    // When enabled, patches opened with "; pd parallel" get their own DSP chain, which is processed on a DSP worker thread
+    std::atomic<bool> multiCoreDSP = false;
+
+    // When enabled, the fx stops running pd's DSP once its input has been silent for longer than the tail length
+    std::atomic<bool> sleepWhenSilent = false;
+
+    // Runs a patch compiled with heavy instead of pd's DSP, so you can compare the two
+    HeavyPreview heavyPreview { this };
 
     std::unique_ptr<InternalSynth> internalSynth;
     std::atomic<bool> enableInternalSynth = false;
 
     OwnedArray<PluginEditor> openedEditors;
-    Component::SafePointer<ConnectionMessageDisplay> connectionListener;
 
 private:
 
     int customLatencySamples = 0;
 
     SmoothedValue<float, ValueSmoothingTypes::Linear> smoothedGain;
+    std::vector<float> gainRamp;
 
     int audioAdvancement = 0;
 
-    bool variableBlockSize = false;
+    std::atomic<bool> variableBlockSize = false;
+    std::atomic<bool> latencyUpdatePending = false;
     AudioBuffer<float> audioBufferIn;
-    AudioBuffer<float> audioBufferOut;
+    std::vector<float*> channelPointers;
     AudioBuffer<float> bypassBuffer;
 
     std::vector<float> audioVectorIn;
     std::vector<float> audioVectorOut;
 
+    void performDSPBlock(float* const* channels, int numChannels, int offset);
+    void performDSPTick(float* const* channels, int numChannels, int offset);
+    void updateSleepState(AudioBuffer<float> const& buffer, bool hasMidiInput);
+    void performMainAndParallelDSP();
+
+    // Audio thread only
+    bool dspSleeping = false;
+    int64 numSilentSamples = 0;
+
+    std::unique_ptr<DSPThreadPool> dspThreadPool;
+    AudioWorkgroup audioWorkgroup;
+    OwnedArray<pd::DSPIsland> dspIslands;
+    CriticalSection dspIslandLock;
+
     std::unique_ptr<AudioMidiFifo> inputFifo;
     std::unique_ptr<AudioMidiFifo> outputFifo;
 
@@ -205,10 +280,28 @@ private:
     uint8 midiByteBuffer[512] = { 0 };
     size_t midiByteIndex = 0;
 
-    std::vector<pd::Atom> atoms_playhead;
+    PlayheadInjector playheadInjector;
+
+    // One bit per parameter, set by the host thread whenever a value changes, and cleared by sendParameters on the audio thread
+    std::atomic<uint64> dirtyParameters[numDirtyParameterWords] = {};
 
     int lastSetProgram = 0;
 
+    // Patch content from the last state save
+    // When pd serialises a patch into the same bytes again, we can reuse the String instead of converting it again
+    struct CachedPatchContent {
+        size_t hash = 0;
+        int size = 0;
+        String content;
+        String contentHash;
+        String compressedContent;
+    };
+    std::unordered_map<pd::Patch*, CachedPatchContent> patchContentCache;
+    CriticalSection patchContentCacheLock;
+
+    static String compressPatchContent(String const& content);
+    static String decompressPatchContent(String const& data);
+
     Limiter limiter;
     std::unique_ptr<dsp::Oversampling<float>> oversampler;
 
@@ -248,5 +341,11 @@ private:
 
     HostInfoUpdater hostInfoUpdater;
 
+    SharedResourcePointer<ProcessMetrics> processMetrics;
+    CriticalSection trackNameLock;
+    String trackName;
+    size_t lastPdMemory = 0;
+    uint32 lastMemoryMeasurement = 0;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginProcessor)
 };
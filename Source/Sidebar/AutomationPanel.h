@@ -497,9 +497,7 @@ public:
     void paint(Graphics& g) override
     {
         auto rect = getLocalBounds().reduced(14, 7);
-        Path shadowPath;
-        shadowPath.addRoundedRectangle(rect, Corners::defaultCornerRadius);
-        StackShadow::renderDropShadow(g, shadowPath, Colours::black.withAlpha(0.3f), 7);
+        StackShadow::renderDropShadow(g, rect.toFloat(), Corners::defaultCornerRadius, Colours::black.withAlpha(0.3f), 7);
     }
 
 private:
@@ -571,16 +569,21 @@ public:
         addAndMakeVisible(draggedItemDropShadow);
 
         addParameterButton.onClick = [this, parent]() {
+            bool foundFreeParameter = false;
             for (auto* param : getParameters()) {
                 if (!param->isEnabled()) {
                     param->setEnabled(true);
                     param->setName(getNewParameterName());
                     param->setIndex(rows.size());
                     param->notifyDAW();
+                    foundFreeParameter = true;
                     break;
                 }
             }
 
+            if (!foundFreeParameter)
+                pd->reserveParameters(rows.size() + 1);
+
             resized();
             parent->resized();
             updateSliders();
@@ -674,10 +677,19 @@ public:
 
     void updateSliders()
     {
-        rows.clear();
+        // Rows of parameters that are still enabled are kept, so changing one parameter doesn't build the whole list again
+        std::unordered_set<PlugDataParameter*> parametersWithRow;
+        for (int i = rows.size() - 1; i >= 0; i--) {
+            if (rows[i]->param->isEnabled()) {
+                rows[i]->update();
+                parametersWithRow.insert(rows[i]->param);
+            } else {
+                rows.remove(i);
+            }
+        }
 
         for (auto* param : getParameters()) {
-            if (param->isEnabled()) {
+            if (param->isEnabled() && !parametersWithRow.count(param)) {
                 auto* slider = rows.add(new AutomationItem(param, parentComponent, pd));
                 addAndMakeVisible(slider);
 
@@ -729,7 +741,8 @@ public:
 
     void checkMaxNumParameters()
     {
-        addParameterButton.setVisible(rows.size() < PluginProcessor::numParameters);
+        // With dynamic parameters, the button is still there to ask for another block
+        addParameterButton.setVisible(rows.size() < (pd->dynamicParameters ? PluginProcessor::maxParameters : pd->numParameters));
     }
 
     void resized() override
@@ -784,7 +797,8 @@ public:
 
 class AutomationPanel : public Component
     , public ScrollBar::Listener
-    , public AsyncUpdater {
+    , public AsyncUpdater
+    , public Timer {
 
 public:
     explicit AutomationPanel(PluginProcessor* processor)
@@ -820,16 +834,25 @@ public:
         sliders.setSize(getWidth(), std::max(sliders.getTotalHeight(), viewport.getMaximumVisibleHeight()));
     }
 
+    // A patch can change a parameter many times per frame, so the sliders only catch up 30 times per second
     void updateParameterValue(PlugDataParameter* changedParameter)
     {
-        for (int p = 0; p < sliders.rows.size(); p++) {
-            auto* param = sliders.rows[p]->param;
-            auto& slider = sliders.rows[p]->slider;
-            if (changedParameter == param && slider.getThumbBeingDragged() == -1) {
-                slider.setValue(param->getUnscaledValue());
-                break;
+        changedParameters.insert(changedParameter);
+        if (!isTimerRunning())
+            startTimerHz(30);
+    }
+
+    void timerCallback() override
+    {
+        stopTimer();
+
+        for (auto* row : sliders.rows) {
+            if (changedParameters.count(row->param) && row->slider.getThumbBeingDragged() == -1) {
+                row->slider.setValue(row->param->getUnscaledValue());
             }
         }
+
+        changedParameters.clear();
     }
 
     void handleAsyncUpdate() override
@@ -839,6 +862,7 @@ public:
     BouncingViewport viewport;
     AutomationComponent sliders;
     PluginProcessor* pd;
+    std::unordered_set<PlugDataParameter*> changedParameters;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AutomationPanel)
 };
@@ -8,6 +8,7 @@
 #include <utility>
 #include "Components/BouncingViewport.h"
 #include "Object.h"
+#include "Utility/BackgroundTasks.h"
 
 class ConsoleSettings : public Component {
 public:
@@ -121,6 +122,10 @@ public:
         } else if (v.refersToSameSourceAs(settingsValues[1])) {
             console->restore();
         } else {
+            // Showing or hiding messages or errors changes which entries get a row
+            if (!v.refersToSameSourceAs(settingsValues[4]))
+                console->rebuildRows();
+
             update();
         }
     }
@@ -153,127 +158,44 @@ public:
         repaint();
     }
 
-    class ConsoleComponent : public Component {
-        class ConsoleMessage : public Component {
-
-            ConsoleComponent& console;
-
-        public:
-            int idx;
-
-            ConsoleMessage(int index, ConsoleComponent& parent)
-                : console(parent)
-                , idx(index)
-            {
-                parent.addAndMakeVisible(this);
-            }
-
-            void mouseDown(MouseEvent const& e) override
-            {
-                if (!e.mods.isShiftDown() && !e.mods.isCommandDown()) {
-                    console.selectedItems.clear();
-                }
-
-                auto& [object, message, type, length, repeats] = console.pd->getConsoleMessages()[idx];
-                if (e.mods.isPopupMenu()) {
-
-                    PopupMenu menu;
-                    menu.addItem("Copy", [this]() { console.copySelectionToClipboard(); });
-                    menu.addItem("Show origin", object != nullptr, false, [this, target = object]() {
-                        auto* editor = findParentComponentOfClass<PluginEditor>();
-                        editor->highlightSearchTarget(target, true);
-                    });
-                    menu.showMenuAsync(PopupMenu::Options());
-                }
-
-                console.selectedItems.addIfNotAlreadyThere(SafePointer(this));
-                console.repaint();
-            }
-
-            void paint(Graphics& g) override
-            {
-                auto isSelected = console.selectedItems.contains(this);
-                auto showMessages = getValue<bool>(console.settingsValues[2]);
-                auto showErrors = getValue<bool>(console.settingsValues[3]);
-
-                if (isSelected) {
-                    // Draw selected background
-                    g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
-                    g.fillRoundedRectangle(getLocalBounds().reduced(0, 1).toFloat().withTrimmedTop(0.5f), Corners::defaultCornerRadius);
-
-                    for (auto& item : console.selectedItems) {
-
-                        if (!item.getComponent())
-                            return;
-                        // Draw connected on top
-                        if (item->idx == idx - 1) {
-                            g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
-                            g.fillRect(getLocalBounds().toFloat().withTrimmedBottom(5));
-
-                            g.setColour(findColour(PlugDataColour::outlineColourId));
-                            g.drawLine(10, 0, getWidth() - 10, 0);
-                        }
-
-                        // Draw connected on bottom
-                        if (item->idx == idx + 1) {
-                            g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
-                            g.fillRect(getLocalBounds().toFloat().withTrimmedTop(5));
-                        }
-                    }
-                }
-
-                // Get console message
-                auto& [object, message, type, length, repeats] = console.pd->getConsoleMessages()[idx];
-
-                // Check if message type should be visible
-                if ((type == 0 && !showMessages) || (type == 1 && !showErrors)) {
-                    return;
-                }
-
-                // Approximate number of lines from string length and current width
-                auto totalLength = length + calculateRepeatOffset(repeats);
-                auto numLines = Console::calculateNumLines(message, totalLength, console.getWidth());
-
-                auto textColour = findColour(PlugDataColour::sidebarTextColourId);
-
-                if (type == 1)
-                    textColour = Colours::orange;
-                else if (type == 2)
-                    textColour = Colours::red;
-
-                auto bounds = getLocalBounds().reduced(8, 2);
-                if (repeats > 1) {
-
-                    auto repeatIndicatorBounds = bounds.removeFromLeft(calculateRepeatOffset(repeats)).toFloat().translated(-4, 0.25);
-                    repeatIndicatorBounds = repeatIndicatorBounds.withSizeKeepingCentre(repeatIndicatorBounds.getWidth(), 21);
-
-                    auto circleColour = findColour(PlugDataColour::sidebarActiveBackgroundColourId);
-                    auto backgroundColour = findColour(PlugDataColour::sidebarBackgroundColourId);
-                    auto contrast = isSelected ? 1.5f : 0.5f;
+    class ConsoleComponent : public Component
+        , private AsyncUpdater {
 
-                    circleColour = Colour(circleColour.getRed() + (circleColour.getRed() - backgroundColour.getRed()) * contrast,
-                        circleColour.getGreen() + (circleColour.getGreen() - backgroundColour.getGreen()) * contrast,
-                        circleColour.getBlue() + (circleColour.getBlue() - backgroundColour.getBlue()) * contrast);
-
-                    g.setColour(circleColour);
-                    auto circleBounds = repeatIndicatorBounds.reduced(2);
-                    g.fillRoundedRectangle(circleBounds, circleBounds.getHeight() / 2.0f);
-
-                    Fonts::drawText(g, String(repeats), repeatIndicatorBounds, findColour(PlugDataColour::sidebarTextColourId), 12, Justification::centred);
-                }
+        // A console entry that passes the filter, and where it goes in the list
+        struct Row {
+            int64 sequence;
+            int y;
+            int height;
+        };
 
-                // Draw text
-                Fonts::drawFittedText(g, message, bounds.translated(0, -1), textColour, numLines, 0.9f, 14);
-            }
+        // What a worker needs to measure an entry, so it doesn't have to touch the console store
+        struct SnapshotEntry {
+            int64 sequence;
+            String message;
+            int length;
+            int repeats;
+            int type;
         };
 
         std::array<Value, 5>& settingsValues;
         Viewport& viewport;
 
         pd::Instance* pd; // instance to get console messages from
+
+        std::deque<Row> rows;
+        int64 rowsEnd = 0; // Entries before this one already have a row, or didn't pass the filter
+        int lastWidth = 0;
+
+        // Measuring all rows again after the width or the filter changed goes over the entire history, so that runs on a worker
+        std::atomic<int> latestRebuild = 0;
+        CriticalSection rebuildLock;
+        int rebuiltGeneration = -1;
+        std::deque<Row> rebuiltRows;
+        int64 rebuiltEnd = 0;
+        BackgroundTasks::TaskGroup tasks;
+
     public:
-        std::deque<std::unique_ptr<ConsoleMessage>> messages;
-        Array<SafePointer<ConsoleMessage>> selectedItems;
+        SortedSet<int64> selectedItems;
 
         ConsoleComponent(pd::Instance* instance, std::array<Value, 5>& b, Viewport& v)
             : settingsValues(b)
@@ -285,6 +207,12 @@ public:
             repaint();
         }
 
+        ~ConsoleComponent() override
+        {
+            tasks.cancelAndWait();
+            cancelPendingUpdate();
+        }
+
         void focusLost(FocusChangeType cause) override
         {
             selectedItems.clear();
@@ -293,11 +221,14 @@ public:
 
         void copySelectionToClipboard()
         {
+            auto& messages = pd->getConsoleMessages();
+
             String textToCopy;
-            for (auto& item : selectedItems) {
-                if (!item.getComponent())
+            for (auto sequence : selectedItems) {
+                if (sequence < messages.getFirstShown() || sequence >= messages.getEnd())
                     continue;
-                textToCopy += std::get<1>(pd->getConsoleMessages()[item->idx]) + "\n";
+
+                textToCopy += messages.getMessage(messages.get(sequence)) + "\n";
             }
 
             SystemClipboard::copyTextToClipboard(textToCopy.trimEnd());
@@ -314,62 +245,104 @@ public:
             return false;
         }
 
+        // Adds rows for the entries that came in since the last update, and drops the rows of entries that are gone
         void update()
         {
-            while (messages.size() > pd->getConsoleMessages().size() || messages.size() >= 800) {
-                messages.pop_front();
+            auto& messages = pd->getConsoleMessages();
+            auto const showMessages = getValue<bool>(settingsValues[2]);
+            auto const showErrors = getValue<bool>(settingsValues[3]);
 
-                // Make sure we don't trigger a repaint for all messages when the console is full
-                for (auto const& message : messages) {
-                    message->idx--;
-                }
+            while (!rows.empty() && rows.front().sequence < messages.getFirstShown()) {
+                rows.pop_front();
             }
 
-            while (messages.size() < pd->getConsoleMessages().size()) {
-                messages.push_back(std::make_unique<ConsoleMessage>(messages.size(), *this));
+            // The last entry may have been repeated since, which makes the repeat counter wider
+            if (!rows.empty()) {
+                auto& last = rows.back();
+                auto const& entry = messages.get(last.sequence);
+                last.height = getRowHeight(messages.getMessage(entry), messages.getLength(entry), entry.repeats, getWidth());
             }
 
+            for (auto sequence = std::max(rowsEnd, messages.getFirstShown()); sequence < messages.getEnd(); sequence++) {
+                auto const& entry = messages.get(sequence);
+                if (!isShown(entry.type, showMessages, showErrors))
+                    continue;
+
+                auto const y = rows.empty() ? 0 : rows.back().y + rows.back().height;
+                rows.push_back({ sequence, y, getRowHeight(messages.getMessage(entry), messages.getLength(entry), entry.repeats, getWidth()) });
+            }
+            rowsEnd = messages.getEnd();
+
             setSize(getWidth(), std::max<int>(getTotalHeight(), viewport.getHeight()));
-            resized();
+            repaint();
 
             if (getValue<bool>(settingsValues[4])) {
                 viewport.setViewPositionProportionately(0.0f, 1.0f);
             }
         }
 
+        // Measures and filters all entries again on a worker, the current rows stay until that's done
+        void rebuildRows()
+        {
+            auto& messages = pd->getConsoleMessages();
+
+            // Strings are reference counted, so this doesn't copy the text
+            std::vector<SnapshotEntry> snapshot;
+            snapshot.reserve(static_cast<size_t>(messages.getEnd() - messages.getFirstShown()));
+            for (auto sequence = messages.getFirstShown(); sequence < messages.getEnd(); sequence++) {
+                auto const& entry = messages.get(sequence);
+                snapshot.push_back({ sequence, messages.getMessage(entry), messages.getLength(entry), entry.repeats, entry.type });
+            }
+
+            auto const generation = ++latestRebuild;
+            tasks.cancelPendingJobs();
+            tasks.addJob("Console::measureRows", [this, snapshot = std::move(snapshot), generation, width = getWidth(), end = messages.getEnd(),
+                            showMessages = getValue<bool>(settingsValues[2]), showErrors = getValue<bool>(settingsValues[3])]() {
+                std::deque<Row> newRows;
+                int y = 0;
+                for (auto const& entry : snapshot) {
+                    if (latestRebuild.load() != generation)
+                        return;
+
+                    if (!isShown(entry.type, showMessages, showErrors))
+                        continue;
+
+                    auto const height = getRowHeight(entry.message, entry.length, entry.repeats, width);
+                    newRows.push_back({ entry.sequence, y, height });
+                    y += height;
+                }
+
+                ScopedLock lock(rebuildLock);
+                if (latestRebuild.load() != generation)
+                    return;
+
+                rebuiltGeneration = generation;
+                rebuiltRows = std::move(newRows);
+                rebuiltEnd = end;
+                triggerAsyncUpdate();
+            }, BackgroundTasks::High);
+        }
+
         void clear()
         {
-            pd->getConsoleHistory().insert(pd->getConsoleHistory().end(), pd->getConsoleMessages().begin(), pd->getConsoleMessages().end());
-            pd->getConsoleMessages().clear();
+            pd->getConsoleMessages().hideAll();
+            selectedItems.clear();
             update();
         }
 
         void restore()
         {
-            pd->getConsoleMessages().insert(pd->getConsoleMessages().begin(), pd->getConsoleHistory().begin(), pd->getConsoleHistory().end());
-            pd->getConsoleHistory().clear();
-            update();
+            pd->getConsoleMessages().restore();
+            rebuildRows();
         }
 
         // Get total height of messages, also taking multi-line messages into account
-        int getTotalHeight()
+        int getTotalHeight() const
         {
-            auto showMessages = getValue<bool>(settingsValues[2]);
-            auto showErrors = getValue<bool>(settingsValues[3]);
-            auto totalHeight = 0;
-
-            for (auto& [object, message, type, length, repeats] : pd->getConsoleMessages()) {
-                auto totalLength = length + calculateRepeatOffset(repeats);
-                auto numLines = Console::calculateNumLines(message, totalLength, getWidth());
-                auto height = numLines * 13 + 12;
-
-                if ((type == 0 && !showMessages) || (type == 1 && !showErrors))
-                    continue;
+            if (rows.empty())
+                return 8;
 
-                totalHeight += std::max(0, height);
-            }
-
-            return totalHeight + 8;
+            return rows.back().y + rows.back().height - rows.front().y + 8;
         }
 
         static int calculateRepeatOffset(int numRepeats)
@@ -383,34 +356,173 @@ public:
 
         void mouseDown(MouseEvent const& e) override
         {
-            selectedItems.clear();
+            auto const row = getRowAt(e.y);
+            if (row < 0) {
+                selectedItems.clear();
+                repaint();
+                return;
+            }
+
+            if (!e.mods.isShiftDown() && !e.mods.isCommandDown()) {
+                selectedItems.clear();
+            }
+
+            auto const sequence = rows[row].sequence;
+            if (e.mods.isPopupMenu()) {
+                auto* object = pd->getConsoleMessages().get(sequence).object;
+
+                PopupMenu menu;
+                menu.addItem("Copy", [this]() { copySelectionToClipboard(); });
+                menu.addItem("Show origin", object != nullptr, false, [this, target = object]() {
+                    auto* editor = findParentComponentOfClass<PluginEditor>();
+                    editor->highlightSearchTarget(target, true);
+                });
+                menu.showMenuAsync(PopupMenu::Options());
+            }
+
+            selectedItems.add(sequence);
             repaint();
         }
 
         void resized() override
         {
-            auto showMessages = getValue<bool>(settingsValues[2]);
-            auto showErrors = getValue<bool>(settingsValues[3]);
+            if (getWidth() != lastWidth) {
+                lastWidth = getWidth();
+                rebuildRows();
+            }
+        }
 
-            int totalHeight = 4;
-            for (int row = 0; row < static_cast<int>(pd->getConsoleMessages().size()); row++) {
-                if (row >= messages.size())
-                    break;
+        // Only paints the rows that are in view, the rest of the history costs nothing
+        void paint(Graphics& g) override
+        {
+            if (rows.empty())
+                return;
 
-                auto& [object, message, type, length, repeats] = pd->getConsoleMessages()[row];
+            auto const clip = g.getClipBounds();
+            auto const offset = 4 - rows.front().y;
+            auto const rightMargin = viewport.canScrollVertically() ? 13 : 11;
 
-                auto totalLength = length + calculateRepeatOffset(repeats);
-                auto numLines = Console::calculateNumLines(message, totalLength, getWidth());
-                auto height = numLines * 13 + 12;
+            auto it = std::upper_bound(rows.begin(), rows.end(), clip.getY() - offset, [](int y, Row const& row) {
+                return y < row.y + row.height;
+            });
 
-                if ((type == 0 && !showMessages) || (type == 1 && !showErrors))
-                    continue;
+            for (; it != rows.end() && it->y + offset < clip.getBottom(); ++it) {
+                auto const index = static_cast<int>(it - rows.begin());
+                paintRow(g, index, Rectangle<int>(6, it->y + offset, getWidth() - rightMargin, it->height));
+            }
+        }
+
+    private:
+        void handleAsyncUpdate() override
+        {
+            {
+                ScopedLock lock(rebuildLock);
+                if (rebuiltGeneration != latestRebuild.load())
+                    return;
+
+                rows = std::move(rebuiltRows);
+                rebuiltRows.clear();
+                rowsEnd = rebuiltEnd;
+            }
+
+            // Catch up with what came in while the rows were being measured
+            update();
+        }
 
-                int rightMargin = viewport.canScrollVertically() ? 13 : 11;
-                messages[row]->setBounds(6, totalHeight, getWidth() - rightMargin, height);
+        static bool isShown(int type, bool showMessages, bool showErrors)
+        {
+            return !((type == 0 && !showMessages) || (type == 1 && !showErrors));
+        }
+
+        static int getRowHeight(String const& message, int length, int repeats, int width)
+        {
+            // Approximate number of lines from string length and current width
+            auto totalLength = length + calculateRepeatOffset(repeats);
+            auto numLines = Console::calculateNumLines(message, totalLength, width);
+            return std::max(0, numLines * 13 + 12);
+        }
+
+        int getRowAt(int y) const
+        {
+            if (rows.empty())
+                return -1;
+
+            auto const offset = 4 - rows.front().y;
+            auto it = std::upper_bound(rows.begin(), rows.end(), y - offset, [](int y, Row const& row) {
+                return y < row.y + row.height;
+            });
 
-                totalHeight += height;
+            if (it == rows.end() || it->y + offset > y)
+                return -1;
+
+            return static_cast<int>(it - rows.begin());
+        }
+
+        void paintRow(Graphics& g, int index, Rectangle<int> rowBounds)
+        {
+            auto const& row = rows[index];
+            auto& messages = pd->getConsoleMessages();
+            auto const& entry = messages.get(row.sequence);
+            auto const& message = messages.getMessage(entry);
+
+            Graphics::ScopedSaveState saveState(g);
+            g.setOrigin(rowBounds.getPosition());
+            auto const localBounds = rowBounds.withZeroOrigin();
+
+            auto isSelected = selectedItems.contains(row.sequence);
+            if (isSelected) {
+                // Draw selected background
+                g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
+                g.fillRoundedRectangle(localBounds.reduced(0, 1).toFloat().withTrimmedTop(0.5f), Corners::defaultCornerRadius);
+
+                // Draw connected on top
+                if (index > 0 && selectedItems.contains(rows[index - 1].sequence)) {
+                    g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
+                    g.fillRect(localBounds.toFloat().withTrimmedBottom(5));
+
+                    g.setColour(findColour(PlugDataColour::outlineColourId));
+                    g.drawLine(10, 0, localBounds.getWidth() - 10, 0);
+                }
+
+                // Draw connected on bottom
+                if (index + 1 < static_cast<int>(rows.size()) && selectedItems.contains(rows[index + 1].sequence)) {
+                    g.setColour(findColour(PlugDataColour::sidebarActiveBackgroundColourId));
+                    g.fillRect(localBounds.toFloat().withTrimmedTop(5));
+                }
+            }
+
+            auto numLines = Console::calculateNumLines(message, messages.getLength(entry) + calculateRepeatOffset(entry.repeats), getWidth());
+
+            auto textColour = findColour(PlugDataColour::sidebarTextColourId);
+
+            if (entry.type == 1)
+                textColour = Colours::orange;
+            else if (entry.type == 2)
+                textColour = Colours::red;
+
+            auto bounds = localBounds.reduced(8, 2);
+            if (entry.repeats > 1) {
+
+                auto repeatIndicatorBounds = bounds.removeFromLeft(calculateRepeatOffset(entry.repeats)).toFloat().translated(-4, 0.25);
+                repeatIndicatorBounds = repeatIndicatorBounds.withSizeKeepingCentre(repeatIndicatorBounds.getWidth(), 21);
+
+                auto circleColour = findColour(PlugDataColour::sidebarActiveBackgroundColourId);
+                auto backgroundColour = findColour(PlugDataColour::sidebarBackgroundColourId);
+                auto contrast = isSelected ? 1.5f : 0.5f;
+
+                circleColour = Colour(circleColour.getRed() + (circleColour.getRed() - backgroundColour.getRed()) * contrast,
+                    circleColour.getGreen() + (circleColour.getGreen() - backgroundColour.getGreen()) * contrast,
+                    circleColour.getBlue() + (circleColour.getBlue() - backgroundColour.getBlue()) * contrast);
+
+                g.setColour(circleColour);
+                auto circleBounds = repeatIndicatorBounds.reduced(2);
+                g.fillRoundedRectangle(circleBounds, circleBounds.getHeight() / 2.0f);
+
+                Fonts::drawText(g, String(entry.repeats), repeatIndicatorBounds, findColour(PlugDataColour::sidebarTextColourId), 12, Justification::centred);
             }
+
+            // Draw text
+            Fonts::drawFittedText(g, message, bounds.translated(0, -1), textColour, numLines, 0.9f, 14);
         }
 
         JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ConsoleComponent)
@@ -430,7 +542,7 @@ public:
         return std::unique_ptr<TextButton>(settingsCalloutButton);
     }
 
-    static int calculateNumLines(String& message, int length, int maxWidth)
+    static int calculateNumLines(String const& message, int length, int maxWidth)
     {
         maxWidth -= 38.0f;
         if (message.containsAnyOf("\n\r") && message.containsNonWhitespaceChars()) {
@@ -78,6 +78,9 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DocumentBrowserSettings)
 };
 
+// Keeps the file tree of the browser folder up-to-date
+// The tree is saved to disk along with the modification time of every folder, so the browser can show it right away on the next launch
+// After that, only folders that were modified since, or that the file watcher reported, have to be listed again
 class DocumentationBrowserUpdateThread : public Thread
     , public ChangeBroadcaster
     , private FileSystemWatcher::Listener
@@ -94,20 +97,22 @@ public:
         fsWatcher.addFolder(File(SettingsFile::getInstance()->getProperty<String>("browser_path")));
         fsWatcher.addListener(this);
 
-        update();
+        loadIndex();
+        startThread(Thread::Priority::low);
     }
 
     ~DocumentationBrowserUpdateThread()
     {
         
         instance = nullptr;
+        signalThreadShouldExit();
+        notify();
         stopThread(-1);
     }
 
     void update()
     {
-        // startThread(fileTree.isValid() ? Thread::Priority::low : Thread::Priority::background);
-        startThread(Thread::Priority::low);
+        notify();
     }
 
     ValueTree getCurrentTree()
@@ -127,8 +132,40 @@ private:
     static inline Identifier const nameIdentifier = Identifier("Name");
     static inline Identifier const pathIdentifier = Identifier("Path");
     static inline Identifier const iconIdentifier = Identifier("Icon");
+    static inline Identifier const modifiedIdentifier = Identifier("Modified");
+    static inline Identifier const searchTextIdentifier = Identifier("SearchText");
 
-    ValueTree generateDirectoryValueTree(File const& directory)
+    static inline File const indexFile = ProjectInfo::appDataDir.getChildFile(".browser_index");
+
+    // Shows the tree from the last session until the thread has checked it
+    void loadIndex()
+    {
+        if (!indexFile.existsAsFile())
+            return;
+
+        FileInputStream istream(indexFile);
+        auto tree = ValueTree::readFromStream(istream);
+
+        // It's only useful if it's for the folder we're showing now
+        if (!tree.hasType("Folder") || tree.getProperty(pathIdentifier).toString() != File(SettingsFile::getInstance()->getProperty<String>("browser_path")).getFullPathName())
+            return;
+
+        {
+            ScopedLock treeLock(fileTreeLock);
+            fileTree = tree;
+        }
+
+        sendChangeMessage();
+    }
+
+    void saveIndex(ValueTree const& tree)
+    {
+        indexFile.replaceWithText("");
+        FileOutputStream ostream(indexFile);
+        tree.writeToStream(ostream);
+    }
+
+    ValueTree generateDirectoryValueTree(File const& directory, ValueTree const& previous, StringArray const& changedDirectories)
     {
         static File versionDataDir = ProjectInfo::appDataDir.getChildFile("Versions");
         static File toolchainDir = ProjectInfo::appDataDir.getChildFile("Toolchain");
@@ -138,10 +175,19 @@ private:
             return {};
         }
 
+        auto const modified = directory.getLastModificationTime().toMilliseconds();
+
         ValueTree rootNode("Folder");
         rootNode.setProperty(nameIdentifier, directory.getFileName(), nullptr);
         rootNode.setProperty(pathIdentifier, directory.getFullPathName(), nullptr);
         rootNode.setProperty(iconIdentifier, Icons::Folder, nullptr);
+        rootNode.setProperty(modifiedIdentifier, modified, nullptr);
+        rootNode.setProperty(searchTextIdentifier, directory.getFileName().toLowerCase(), nullptr);
+
+        // Adding, removing or renaming something in a folder changes its modification time
+        // So if that didn't change, the folder has the same entries as last time and we don't have to list it again
+        // The subfolders still need to be checked, since a change in there doesn't touch this folder
+        auto const unchanged = previous.isValid() && static_cast<int64>(previous.getProperty(modifiedIdentifier)) == modified && !changedDirectories.contains(directory.getFullPathName());
 
         // visitedDirectories keeps track of dirs we've already processed to prevent infinite loops
         static Array<hash32> visitedDirectories = {};
@@ -149,28 +195,46 @@ private:
         auto directoryHash = OSUtils::getUniqueFileHash(directory.getFullPathName());
         if (!visitedDirectories.contains(directoryHash)) {
             visitedDirectories.add(directoryHash); // Protect against symlink loops!
-            for (auto const& subDirectory : OSUtils::iterateDirectory(directory, false, false)) {
-                auto pathName = subDirectory.getFullPathName();
-                if (OSUtils::isDirectoryFast(pathName) && subDirectory != directory) {
-                    ValueTree childNode = generateDirectoryValueTree(subDirectory);
+            if (unchanged) {
+                for (auto const& previousChild : previous) {
+                    if (!previousChild.hasType("Folder"))
+                        continue;
+
+                    ValueTree childNode = generateDirectoryValueTree(File(previousChild.getProperty(pathIdentifier).toString()), previousChild, changedDirectories);
                     if (childNode.isValid())
                         rootNode.appendChild(childNode, nullptr);
                 }
+            } else {
+                for (auto const& subDirectory : OSUtils::iterateDirectory(directory, false, false)) {
+                    auto pathName = subDirectory.getFullPathName();
+                    if (OSUtils::isDirectoryFast(pathName) && subDirectory != directory) {
+                        ValueTree childNode = generateDirectoryValueTree(subDirectory, previous.getChildWithProperty(pathIdentifier, pathName), changedDirectories);
+                        if (childNode.isValid())
+                            rootNode.appendChild(childNode, nullptr);
+                    }
+                }
             }
             visitedDirectories.removeLast();
         }
 
-        for (auto const& file : OSUtils::iterateDirectory(directory, false, true)) {
-            if (file.getFileName().startsWith("."))
-                continue;
+        if (unchanged) {
+            for (auto const& previousChild : previous) {
+                if (previousChild.hasType(fileIdentifier))
+                    rootNode.appendChild(previousChild.createCopy(), nullptr);
+            }
+        } else {
+            for (auto const& file : OSUtils::iterateDirectory(directory, false, true)) {
+                if (file.getFileName().startsWith("."))
+                    continue;
 
-            
-            ValueTree childNode(fileIdentifier);
-            childNode.setProperty(nameIdentifier, file.getFileName(), nullptr);
-            childNode.setProperty(pathIdentifier, file.getFullPathName(), nullptr);
-            childNode.setProperty(iconIdentifier, Icons::File, nullptr);
+                ValueTree childNode(fileIdentifier);
+                childNode.setProperty(nameIdentifier, file.getFileName(), nullptr);
+                childNode.setProperty(pathIdentifier, file.getFullPathName(), nullptr);
+                childNode.setProperty(iconIdentifier, Icons::File, nullptr);
+                childNode.setProperty(searchTextIdentifier, file.getFileName().toLowerCase(), nullptr);
 
-            rootNode.appendChild(childNode, nullptr);
+                rootNode.appendChild(childNode, nullptr);
+            }
         }
 
         if (threadShouldExit())
@@ -203,41 +267,63 @@ private:
         }
     }
 
-        void run() override
-        {
-            try
-            {
-                int const maxRetries = 50;
-                int retries = 0;
-
-                while (retries < maxRetries) {
-                    if (threadShouldExit())
-                        break;
-                    if (fileTreeLock.tryEnter()) {
-                        fileTree = generateDirectoryValueTree(File(SettingsFile::getInstance()->getProperty<String>("browser_path")));
-                        fileTreeLock.exit();
-                        break;
-                    }
-                    retries++;
-                    Time::waitForMillisecondCounter(Time::getMillisecondCounter() + 100);
+    void run() override
+    {
+        while (!threadShouldExit()) {
+            try {
+                auto directory = File(SettingsFile::getInstance()->getProperty<String>("browser_path"));
+
+                ValueTree previous;
+                StringArray changed;
+                {
+                    ScopedLock treeLock(fileTreeLock);
+                    previous = fileTree;
+                    changed.swapWith(changedDirectories);
+                }
+
+                // After the browser folder changed, nothing from the old tree can be reused
+                if (previous.getProperty(pathIdentifier).toString() != directory.getFullPathName())
+                    previous = ValueTree();
+
+                auto tree = generateDirectoryValueTree(directory, previous, changed);
+                if (threadShouldExit())
+                    return;
+
+                {
+                    ScopedLock treeLock(fileTreeLock);
+                    fileTree = tree;
                 }
-                
+
+                if (tree.isValid())
+                    saveIndex(tree);
 
                 sendChangeMessage();
-            }
-            catch(...)
-            {
+            } catch (...) {
                 std::cerr << "Failed to update documentation browser" << std::endl;
             }
+
+            wait(-1);
         }
+    }
 
-    void filesystemChanged() override
+    void filesystemChanged(FileSystemWatcher::ChangeSet const& changes) override
     {
+        // Not every platform changes the modification time of a folder reliably, so make sure these get listed again
+        {
+            ScopedLock treeLock(fileTreeLock);
+            for (auto const& [file, event] : changes) {
+                changedDirectories.addIfNotAlreadyThere(file.getParentDirectory().getFullPathName());
+                if (event != FileSystemWatcher::fileDeleted && event != FileSystemWatcher::fileRenamedOldName && file.isDirectory())
+                    changedDirectories.addIfNotAlreadyThere(file.getFullPathName());
+            }
+        }
+
         update();
     }
 
     CriticalSection fileTreeLock;
     ValueTree fileTree;
+    StringArray changedDirectories; // Guarded by fileTreeLock
     FileSystemWatcher fsWatcher;
 };
 
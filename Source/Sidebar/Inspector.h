@@ -39,6 +39,23 @@ class Inspector : public Component {
     Array<ObjectParameters> properties;
     OwnedArray<PropertyRedirector> redirectors;
 
+    // What the panel was built for, so we don't rebuild it when the same objects get shown again
+    // Keyed on the object instead of the Value, because a new object can get the memory of a deleted one
+    struct ShownParameter {
+        std::optional<pd::WeakReference> owner;
+        String name;
+        ParameterType type;
+        ParameterCategory category;
+
+        // Parameters without an owner, like the canvas' own, are never the same, so their panel is always rebuilt
+        bool operator==(ShownParameter const& other) const
+        {
+            return owner && other.owner && owner->isValid() && other.owner->isValid() && *owner == *other.owner
+                && name == other.name && type == other.type && category == other.category;
+        }
+    };
+    std::vector<ShownParameter> shownParameters;
+
 public:
     Inspector()
     {
@@ -68,7 +85,7 @@ public:
         panel.setContentWidth(getWidth() - 16);
     }
 
-    static PropertiesPanelProperty* createPanel(int type, String const& name, Value* value, StringArray& options, std::function<void(bool)> onInteractionFn = nullptr)
+    static PropertiesPanelProperty* createPanel(int type, String const& name, Value* value, StringArray const& options, std::function<void(bool)> onInteractionFn = nullptr)
     {
         switch (type) {
         case tString:
@@ -103,40 +120,66 @@ public:
     {
         properties = objectParameters;
 
+        // The selection often changes without changing what we show, like when an object gets clicked again
+        // The panels are still bound to the same values then, so there's nothing to rebuild
+        std::vector<ShownParameter> newShownParameters;
+        for (auto const& parameters : objectParameters) {
+            for (auto const& [name, type, category, value, options, defaultVal, customComponentFn, onInteractionFn] : parameters.getParameters()) {
+                newShownParameters.push_back({ parameters.getOwner(), name, type, category });
+            }
+        }
+
+        if (newShownParameters == shownParameters && !panel.isEmpty())
+            return;
+
+        shownParameters = std::move(newShownParameters);
+
         StringArray names = { "Dimensions", "General", "Appearance", "Label", "Extra" };
 
         panel.clear();
 
-        auto parameterIsInAllObjects = [&objectParameters](ObjectParameter& param, Array<Value*>& values) {
-            auto& [name1, type1, category1, value1, options1, defaultVal1, customComponent1, onInteractionFn1] = param;
+        // Look up every object's parameters by name once, instead of searching all of them for every parameter
+        std::vector<std::unordered_map<String, Value*>> parametersByName;
+        if (objectParameters.size() > 1) {
+            parametersByName.resize(objectParameters.size());
+            for (int i = 0; i < objectParameters.size(); i++) {
+                for (auto const& [name, type, category, value, options, defaultVal, customComponentFn, onInteractionFn] : objectParameters[i].getParameters()) {
+                    parametersByName[i].try_emplace(name + ":" + String(static_cast<int>(type)) + ":" + String(static_cast<int>(category)), value);
+                }
+            }
+        }
 
-            if (objectParameters.size() > 1 && (name1 == "Size" || name1 == "Position" || name1 == "Height")) {
+        auto parameterIsInAllObjects = [&objectParameters, &parametersByName](ObjectParameter const& param, Array<Value*>& values) {
+            auto const& [name1, type1, category1, value1, options1, defaultVal1, customComponent1, onInteractionFn1] = param;
+
+            if (objectParameters.size() == 1) {
+                values.add(value1);
+                return true;
+            }
+
+            if (name1 == "Size" || name1 == "Position" || name1 == "Height") {
                 return false;
             }
 
-            bool isInAllObjects = true;
-            for (auto& parameters : objectParameters) {
-                bool hasParameter = false;
-                for (auto& [name2, type2, category2, value2, options2, defaultVal2, customComponent2, onInteractionFn2] : parameters.getParameters()) {
-                    if (name1 == name2 && type1 == type2 && category1 == category2) {
-                        values.add(value2);
-                        hasParameter = true;
-                        break;
-                    }
-                }
+            auto const key = name1 + ":" + String(static_cast<int>(type1)) + ":" + String(static_cast<int>(category1));
+            for (auto const& parameters : parametersByName) {
+                auto it = parameters.find(key);
+                if (it == parameters.end())
+                    return false;
 
-                isInAllObjects = isInAllObjects && hasParameter;
+                values.add(it->second);
             }
 
-            return isInAllObjects;
+            return true;
         };
 
         redirectors.clear();
 
+        auto const firstParameters = objectParameters[0];
         for (int i = 0; i < 4; i++) {
             Array<PropertiesPanelProperty*> panels;
-            for (auto& parameter : objectParameters[0].getParameters()) {
-                auto& [name, type, category, value, options, defaultVal, customComponentFn, onInteractionFn] = parameter;
+            for (auto const& parameter : firstParameters.getParameters()) {
+                auto const& [name, type, category, value, options, defaultVal, customComponentFn, onInteractionFn] = parameter;
 
                 if (customComponentFn && objectParameters.size() == 1 && static_cast<int>(category) == i) {
                     if (auto* customComponent = customComponentFn()) {
@@ -14,6 +14,9 @@ PaletteItem::PaletteItem(PluginEditor* e, PaletteDraggableList* parent, ValueTre
     paletteName = itemTree.getProperty("Name");
     palettePatch = itemTree.getProperty("Patch");
 
+    // Get the drag image ready before anyone starts dragging this item
+    OfflineObjectRenderer::prepareThumbnail(palettePatch);
+
     nameLabel.setText(paletteName, dontSendNotification);
     nameLabel.setInterceptsMouseClicks(false, false);
     nameLabel.onTextChange = [this]() mutable {
@@ -94,10 +97,8 @@ void PaletteItem::paint(Graphics& g)
     auto bounds = getLocalBounds().reduced(16.0f, 4.0f).toFloat();
 
     if (isItemDragged) {
-        Path dropShadowPath;
-        dropShadowPath.addRoundedRectangle(bounds.reduced(4.0f), 5.0f);
         auto dropShadowColour = findColour(PlugDataColour::objectSelectedOutlineColourId);
-        StackShadow::renderDropShadow(g, dropShadowPath, dropShadowColour.withAlpha(0.5f), 7);
+        StackShadow::renderDropShadow(g, bounds.reduced(4.0f), 5.0f, dropShadowColour.withAlpha(0.5f), 7);
     }
     auto outlineColour = isItemDragged ? PlugDataColour::objectSelectedOutlineColourId : PlugDataColour::objectOutlineColourId;
 
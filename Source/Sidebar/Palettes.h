@@ -83,7 +83,7 @@ public:
 
         paletteTree.addListener(this);
 
-        setSize(1, items.size() * 40 + 40);
+        setSize(1, items.size() * itemHeight + 40);
 
         pasteButton.onClick = [this]() {
             auto clipboardText = SystemClipboard::getTextFromClipboard();
@@ -138,28 +138,63 @@ public:
         addAndMakeVisible(pasteButton);
     }
 
-    void resized() override
+    Rectangle<int> getRowBounds(int index) const
+    {
+        return Rectangle<int>(0, index * itemHeight, getWidth(), itemHeight);
+    }
+
+    // Only rows that are in view have a component, so large palettes open quickly and don't hold on to a component per item
+    // Rows that scroll out of view are deleted again, unless they're being dragged or renamed
+    void updateVisibleItems()
+    {
+        auto visibleArea = getLocalBounds();
+        if (auto* viewport = findParentComponentOfClass<BouncingViewport>())
+            visibleArea = viewport->getViewArea();
+
+        auto firstRow = jmax(0, visibleArea.getY() / itemHeight - 1);
+        auto lastRow = jmin(items.size(), visibleArea.getBottom() / itemHeight + 2);
+
+        for (int i = 0; i < items.size(); i++) {
+            auto* item = items[i];
+            auto inView = i >= firstRow && i < lastRow;
+
+            if (inView && !item) {
+                item = new PaletteItem(editor, this, paletteTree.getChild(i));
+                items.set(i, item, false);
+                addAndMakeVisible(item);
+                item->setBounds(getRowBounds(i));
+            } else if (!inView && item && item != draggedItem && !item->nameLabel.isBeingEdited()) {
+                items.set(i, nullptr, true);
+            }
+        }
+    }
+
+    void moved() override
     {
-        auto height = 40;
-        auto itemsBounds = getLocalBounds().withHeight(height);
-        auto totalHeight = 0;
+        // The viewport moves us around when it scrolls
+        updateVisibleItems();
+    }
 
+    void resized() override
+    {
         auto& animator = Desktop::getInstance().getAnimator();
+        auto totalHeight = items.size() * itemHeight;
 
         Rectangle<int> bounds;
-        for (auto* item : items) {
-            bounds = itemsBounds.withPosition(0, totalHeight);
-            if (item != draggedItem) {
-                if (shouldAnimate) {
-                    animator.animateComponent(item, bounds, 1.0f, 200, false, 3.0f, 0.0f);
-                } else {
-                    animator.cancelAnimation(item, false);
-                    item->setBounds(bounds);
-                }
+        for (int i = 0; i < items.size(); i++) {
+            auto* item = items[i];
+            if (!item || item == draggedItem)
+                continue;
+
+            bounds = getRowBounds(i);
+            if (shouldAnimate) {
+                animator.animateComponent(item, bounds, 1.0f, 200, false, 3.0f, 0.0f);
+            } else {
+                animator.cancelAnimation(item, false);
+                item->setBounds(bounds);
             }
-            totalHeight += height;
         }
-        bounds = itemsBounds.withPosition(0, totalHeight + 5).withHeight(30);
+        bounds = getLocalBounds().withHeight(itemHeight).withPosition(0, totalHeight + 5).withHeight(30);
         pasteButton.setBounds(bounds.reduced(12, 0));
         // we set the bounds to the size of the component, but if we grow larger,
         // we want to make it larger so the viewport can scroll the component
@@ -173,6 +208,8 @@ public:
         // } else
         if (viewport && viewport->getViewPositionY() != viewportPosHackY)
             viewport->setViewPosition(Point<int>(0, viewportPosHackY));
+
+        updateVisibleItems();
     }
 
     void updateItems()
@@ -182,9 +219,9 @@ public:
 
         items.clear();
 
-        for (auto item : paletteTree) {
-            auto paletteItem = new PaletteItem(editor, this, item);
-            addAndMakeVisible(items.add(paletteItem));
+        // Components are created once their row is visible
+        for (int i = 0; i < paletteTree.getNumChildren(); i++) {
+            items.add(nullptr);
         }
 
         resized();
@@ -219,12 +256,12 @@ public:
             viewportPosHackY -= autoScrollOffset.getY();
 
             int idx = items.indexOf(draggedItem);
-            if (idx > 0 && draggedItem->getBounds().getCentreY() < items[idx - 1]->getBounds().getCentreY()) {
+            if (idx > 0 && draggedItem->getBounds().getCentreY() < getRowBounds(idx - 1).getCentreY()) {
                 items.swap(idx, idx - 1);
                 paletteTree.moveChild(idx, idx - 1, nullptr);
                 shouldAnimate = true;
                 resized();
-            } else if (idx < items.size() - 1 && draggedItem->getBounds().getCentreY() > items[idx + 1]->getBounds().getCentreY()) {
+            } else if (idx < items.size() - 1 && draggedItem->getBounds().getCentreY() > getRowBounds(idx + 1).getCentreY()) {
                 items.swap(idx, idx + 1);
                 paletteTree.moveChild(idx, idx + 1, nullptr);
                 shouldAnimate = true;
@@ -259,7 +296,9 @@ public:
     PluginEditor* editor;
     ValueTree paletteTree;
 
+    // One slot per palette item, null while the row is out of view
     OwnedArray<PaletteItem> items;
+    static constexpr int itemHeight = 40;
 
     SafePointer<PaletteItem> draggedItem;
     Point<int> mouseDownPos;
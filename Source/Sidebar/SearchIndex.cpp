@@ -0,0 +1,408 @@
+/*
+ // Copyright (c) 2021-2024 Timothy Schoen.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "Utility/Config.h"
+#include "Utility/Hash.h"
+#include "Constants.h"
+
+#include "SearchIndex.h"
+#include "Pd/Instance.h"
+#include "Pd/Interface.h"
+#include "Pd/Patch.h"
+#include "Objects/AllGuis.h"
+#include <m_pd.h>
+#include <m_imp.h>
+
+extern "C" {
+#include <g_all_guis.h>
+}
+
+static int srl_is_valid(t_symbol const* s)
+{
+    return (s != nullptr && s != gensym(""));
+}
+
+SearchIndex::SearchIndex(pd::Instance* instance)
+    : pd(instance)
+{
+}
+
+void SearchIndex::markDirty(t_glist* patch)
+{
+    // The canvases that include this patch are marked as well, up to the top-level patch
+    // Otherwise a patch that was replaced, like a reloaded abstraction, would stay in its parent's list as it was
+    std::vector<t_glist*> toMark { patch };
+    std::unordered_set<t_glist*> marked;
+    while (!toMark.empty()) {
+        auto* changed = toMark.back();
+        toMark.pop_back();
+        if (!marked.insert(changed).second)
+            continue;
+
+        for (auto& [glist, entry] : patches) {
+            if (glist == changed) {
+                entry.dirty = true;
+                continue;
+            }
+
+            for (auto const& subpatch : entry.subpatches) {
+                if (subpatch.getRawUnchecked<t_glist>() == changed) {
+                    toMark.push_back(glist);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+ValueTree SearchIndex::getPatchTree(pd::WeakReference const& patch)
+{
+    // Forget the patches that pd has deleted since
+    for (auto it = patches.begin(); it != patches.end();) {
+        if (!it->second.patch.isValid())
+            it = patches.erase(it);
+        else
+            ++it;
+    }
+
+    if (needsRefresh(patch)) {
+        pd::WeakReference::BatchLock lock(pd);
+        refresh(patch, lock);
+    }
+
+    return assemble(patch.getRawUnchecked<t_glist>(), 0);
+}
+
+bool SearchIndex::needsRefresh(pd::WeakReference const& patch) const
+{
+    if (!patch.isValid())
+        return false;
+
+    auto it = patches.find(patch.getRawUnchecked<t_glist>());
+    if (it == patches.end() || it->second.dirty || !it->second.patch.isValid())
+        return true;
+
+    for (auto const& subpatch : it->second.subpatches) {
+        // A subpatch that pd deleted since means this patch has changed too
+        if (!subpatch.isValid() || needsRefresh(subpatch))
+            return true;
+    }
+
+    return false;
+}
+
+void SearchIndex::refresh(pd::WeakReference const& patch, pd::WeakReference::BatchLock& lock)
+{
+    if (!patch.isValid())
+        return;
+
+    auto* glist = patch.getRawUnchecked<t_glist>();
+    auto it = patches.find(glist);
+    auto const subpatchDeleted = it != patches.end() && std::any_of(it->second.subpatches.begin(), it->second.subpatches.end(), [](auto const& subpatch) { return !subpatch.isValid(); });
+    if (it == patches.end() || it->second.dirty || subpatchDeleted || !it->second.patch.isValid()) {
+        PatchEntry entry { patch, ValueTree(), {}, false };
+        entry.objects = readPatch(patch, entry.subpatches, lock);
+        it = patches.insert_or_assign(glist, std::move(entry)).first;
+    }
+
+    // Copied, because reading a subpatch adds entries to the map
+    auto const subpatches = it->second.subpatches;
+    for (auto const& subpatch : subpatches) {
+        refresh(subpatch, lock);
+    }
+}
+
+ValueTree SearchIndex::assemble(t_glist* patch, int64 topLevel) const
+{
+    ValueTree patchTree("Patch");
+
+    auto it = patches.find(patch);
+    if (it == patches.end())
+        return patchTree;
+
+    for (auto const& object : it->second.objects) {
+        auto element = object.createCopy();
+        auto top = topLevel ? topLevel : static_cast<int64>(element.getProperty("Object"));
+
+        if (element.hasProperty("Subpatch")) {
+            auto subpatchTree = assemble(reinterpret_cast<t_glist*>(static_cast<int64>(element.getProperty("Subpatch"))), top);
+            while (subpatchTree.getNumChildren()) {
+                auto child = subpatchTree.getChild(0);
+                subpatchTree.removeChild(0, nullptr);
+                element.appendChild(child, nullptr);
+            }
+            element.removeProperty("Subpatch", nullptr);
+        }
+
+        element.setProperty("TopLevel", top, nullptr);
+        patchTree.appendChild(element, nullptr);
+    }
+
+    return patchTree;
+}
+
+ValueTree SearchIndex::readPatch(pd::WeakReference const& patchRef, std::vector<pd::WeakReference>& subpatches, pd::WeakReference::BatchLock& lock)
+{
+    ValueTree patchTree("Patch");
+    pd::Patch::Ptr patch = new pd::Patch(patchRef, pd, false);
+
+    for (auto objectPtr : patch->getObjects()) {
+        // Lets the audio thread in between objects, so reading a big patch doesn't hold up DSP
+        lock.yield();
+
+        auto patchPtr = patch->getPointer();
+        if (!patchPtr)
+            break;
+
+        if (auto object = objectPtr.get<t_pd>()) {
+            String type = String::fromUTF8(pd::Interface::getObjectClassName(object.get()));
+
+            if (!pd::Interface::checkObject(object.get()))
+                continue;
+
+            char* objectText;
+            int len;
+            pd::Interface::getObjectText(object.cast<t_text>(), &objectText, &len);
+
+            int x, y, w, h;
+            pd::Interface::getObjectBounds(patchPtr.get(), object.cast<t_gobj>(), &x, &y, &w, &h);
+
+            auto name = String::fromUTF8(objectText, len);
+            auto nameWithoutArgs = name.upToFirstOccurrenceOf(" ", false, false);
+            auto positionText = " (" + String(x) + ":" + String(y) + ")";
+
+            auto getFirstArgumentFromFullName = [](String const& fullName) -> String {
+                return fullName.fromFirstOccurrenceOf(" ", false, true).upToFirstOccurrenceOf(" ", false, true);
+            };
+
+            ValueTree element("Object");
+            if (type == "canvas" || type == "graph") {
+                // The contents of the subpatch get their own entry, which is added to this element when the tree is assembled
+                pd::Patch::Ptr subpatch = new pd::Patch(objectPtr, pd, false);
+                subpatches.push_back(objectPtr);
+
+                if (auto subpatchPtr = subpatch->getPointer()) {
+                    if (subpatchPtr->gl_list) {
+                        t_class* c = subpatchPtr->gl_list->g_pd;
+                        if (c && c->c_name && (String::fromUTF8(c->c_name->s_name) == "array")) {
+                            StringArray arrays;
+                            auto arrayIt = subpatchPtr->gl_list;
+                            while (arrayIt) {
+                                if (auto* array = reinterpret_cast<t_fake_garray*>(arrayIt))
+                                    arrays.add(String::fromUTF8(array->x_name->s_name));
+                                arrayIt = arrayIt->g_next;
+                            }
+                            String formatedArraysText;
+                            for (int i = 0; i < arrays.size(); i++) {
+                                formatedArraysText += arrays[i] + String(i < arrays.size() - 1 ? ", " : "");
+                            }
+                            name = "array: " + formatedArraysText;
+                        } else if (subpatchPtr->gl_isgraph) {
+                            name = nameWithoutArgs;
+                        }
+                    } else if (subpatchPtr->gl_isgraph) {
+                        name = nameWithoutArgs;
+                    }
+                }
+#ifdef SHOW_PD_SUBPATCH_SYMBOL
+                if (nameWithoutArgs == "pd") {
+                    auto arg = getFirstArgumentFromFullName(name);
+                    if (arg.isNotEmpty())
+                        element.setProperty("PDSymbol", nameWithoutArgs + "-" + arg, nullptr);
+                }
+#endif
+                element.setProperty("Name", name, nullptr);
+                element.setProperty("RightText", positionText, nullptr);
+                element.setProperty("Icon", canvas_isabstraction(subpatch->getPointer().get()) ? Icons::File : Icons::Object, nullptr);
+                element.setProperty("Object", reinterpret_cast<int64>(object.cast<void>()), nullptr);
+                element.setProperty("Subpatch", reinterpret_cast<int64>(object.cast<void>()), nullptr);
+            } else {
+                String finalFormatedName;
+                String sendSymbol;
+                String receiveSymbol;
+
+                switch (hash(type)) {
+                // IEM send-receive symbols
+                case hash("bng"):
+                case hash("hsl"):
+                case hash("vsl"):
+                case hash("slider"):
+                case hash("tgl"):
+                case hash("nbx"):
+                case hash("vradio"):
+                case hash("hradio"):
+                case hash("vu"):
+                case hash("cnv"): {
+                    if (auto iemgui = objectPtr.get<t_iemgui>()) {
+                        t_symbol* srlsym[3];
+                        iemgui_all_sym2dollararg(iemgui.get(), srlsym);
+                        if (srl_is_valid(srlsym[0])) {
+                            sendSymbol = String::fromUTF8(iemgui->x_snd_unexpanded->s_name);
+                        }
+                        if (srl_is_valid(srlsym[1])) {
+                            receiveSymbol = String::fromUTF8(iemgui->x_rcv_unexpanded->s_name);
+                        }
+                    }
+                    finalFormatedName = nameWithoutArgs;
+                    break;
+                }
+                case hash("keyboard"): {
+                    if (auto keyboardObject = object.cast<t_fake_keyboard>()) {
+                        sendSymbol = String(keyboardObject->x_send->s_name);
+                        receiveSymbol = String(keyboardObject->x_receive->s_name);
+                    }
+                    finalFormatedName = nameWithoutArgs;
+                    break;
+                }
+                case hash("pic"): {
+                    if (auto picObject = object.cast<t_fake_pic>()) {
+                        sendSymbol = String(picObject->x_send->s_name);
+                        receiveSymbol = String(picObject->x_receive->s_name);
+                    }
+                    finalFormatedName = nameWithoutArgs;
+                    break;
+                }
+                case hash("scope~"): {
+                    if (auto scopeObject = object.cast<t_fake_scope>()) {
+                        receiveSymbol = String(scopeObject->x_receive->s_name);
+                    }
+                    finalFormatedName = nameWithoutArgs;
+                    break;
+                }
+                case hash("function"): {
+                    if (auto keyboardObject = object.cast<t_fake_function>()) {
+                        sendSymbol = String(keyboardObject->x_send->s_name);
+                        receiveSymbol = String(keyboardObject->x_receive->s_name);
+                    }
+                    finalFormatedName = nameWithoutArgs;
+                    break;
+                }
+                case hash("note"): {
+                    if (auto noteObject = object.cast<t_fake_note>()) {
+                        receiveSymbol = String(noteObject->x_receive->s_name);
+                    }
+                    finalFormatedName = nameWithoutArgs;
+                    break;
+                }
+                case hash("knob"): {
+                    if (auto knobObj = object.cast<t_fake_knob>()) {
+                        sendSymbol = String(knobObj->x_snd->s_name);
+                        receiveSymbol = String(knobObj->x_rcv->s_name);
+                    }
+                    finalFormatedName = nameWithoutArgs;
+                    break;
+                }
+                case hash("gatom"): {
+                    auto gatomObject = object.cast<t_fake_gatom>();
+                    String gatomName;
+                    switch (gatomObject->a_flavor) {
+                    case A_FLOAT:
+                        gatomName = "floatbox";
+                        break;
+                    case A_SYMBOL:
+                        gatomName = "symbolbox";
+                        break;
+                    case A_NULL:
+                        gatomName = "listbox";
+                        break;
+                    default:
+                        break;
+                    }
+                    receiveSymbol = String(gatomObject->a_symfrom->s_name);
+                    sendSymbol = String(gatomObject->a_symto->s_name);
+                    finalFormatedName = gatomName;
+                    break;
+                }
+                case hash("message"): {
+                    finalFormatedName = "msg: " + name;
+                    break;
+                }
+                case hash("comment"): {
+                    finalFormatedName = "comment: " + name;
+                    break;
+                }
+                case hash("text"): {
+                    switch (object.cast<t_fake_text_define>()->x_textbuf.b_ob.te_type) {
+                    case T_TEXT: {
+                        // if object & classname is text, then it's a comment
+                        finalFormatedName = String("comment: ") + name;
+                        break;
+                    }
+                    case T_OBJECT: {
+                        // if object is T_OBJECT but classname is 'text' object is in error state
+                        element.setProperty("IconColour", Colours::red.toString(), nullptr);
+
+                        if (name.isEmpty())
+                            finalFormatedName = String("empty");
+                        else
+                            finalFormatedName = String("unknown: ") + name;
+
+                        break;
+                    }
+                    default:
+                        break;
+                    }
+                    break;
+                }
+                case hash("canvas"):
+                case hash("bicoeff"):
+                case hash("messbox"):
+                case hash("pad"):
+                case hash("button"): {
+                    finalFormatedName = nameWithoutArgs;
+                    break;
+                }
+
+                default: {
+                    switch (hash(nameWithoutArgs)) {
+                    case hash("s"):
+                    case hash("s~"):
+                    case hash("send"):
+                    case hash("send~"):
+                    case hash("throw~"): {
+                        sendSymbol = getFirstArgumentFromFullName(name);
+                        element.setProperty("SymbolIsObject", 1, nullptr);
+                        finalFormatedName = nameWithoutArgs;
+                        break;
+                    }
+                    case hash("r"):
+                    case hash("r~"):
+                    case hash("receive"):
+                    case hash("receive~"):
+                    case hash("catch~"): {
+                        receiveSymbol = getFirstArgumentFromFullName(name);
+                        element.setProperty("SymbolIsObject", 1, nullptr);
+                        finalFormatedName = nameWithoutArgs;
+                        break;
+                    }
+                    default:
+                        finalFormatedName = name;
+                        break;
+                    }
+                    break;
+                }
+                }
+
+                element.setProperty("Name", finalFormatedName, nullptr);
+                // Add send/receive tags if they exist
+                if (sendSymbol.isNotEmpty() && (sendSymbol != "empty") && (sendSymbol != "nosndno")) {
+                    element.setProperty("SendSymbol", sendSymbol, nullptr);
+                }
+                if (receiveSymbol.isNotEmpty() && (receiveSymbol != "empty")) {
+                    element.setProperty("ReceiveSymbol", receiveSymbol, nullptr);
+                }
+                element.setProperty("RightText", positionText, nullptr);
+                element.setProperty("Icon", Icons::Object, nullptr);
+                element.setProperty("Object", reinterpret_cast<int64>(object.cast<void>()), nullptr);
+            }
+
+            patchTree.appendChild(element, nullptr);
+        }
+    }
+
+    return patchTree;
+}
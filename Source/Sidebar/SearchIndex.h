@@ -0,0 +1,50 @@
+/*
+ // Copyright (c) 2021-2024 Timothy Schoen.
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <juce_data_structures/juce_data_structures.h>
+#include "Pd/WeakReference.h"
+
+struct _glist;
+
+namespace pd {
+class Instance;
+}
+
+// What the search panel shows for every object in a patch, read from pd once and then reused
+// Every patch and subpatch has its own entry. Canvases mark their patch as dirty when they sync,
+// and only dirty patches are read from pd again, so searching doesn't have to hold pd's lock
+class SearchIndex {
+public:
+    explicit SearchIndex(pd::Instance* instance);
+
+    // Makes the next getPatchTree read the objects in this patch, and in every patch that includes it, again
+    void markDirty(_glist* patch);
+
+    // Gets the search tree for a patch and all its subpatches
+    // Patches that were never read or changed since are read first, with a lock that lets the audio thread in between objects
+    // Everything else comes from the index without touching pd
+    juce::ValueTree getPatchTree(pd::WeakReference const& patch);
+
+private:
+    struct PatchEntry {
+        pd::WeakReference patch;
+        juce::ValueTree objects;
+        std::vector<pd::WeakReference> subpatches;
+        bool dirty;
+    };
+
+    // Reads every patch in this tree that isn't up-to-date
+    void refresh(pd::WeakReference const& patch, pd::WeakReference::BatchLock& lock);
+    bool needsRefresh(pd::WeakReference const& patch) const;
+
+    juce::ValueTree readPatch(pd::WeakReference const& patch, std::vector<pd::WeakReference>& subpatches, pd::WeakReference::BatchLock& lock);
+    juce::ValueTree assemble(_glist* patch, juce::int64 topLevel) const;
+
+    pd::Instance* pd;
+    std::unordered_map<_glist*, PatchEntry> patches;
+};
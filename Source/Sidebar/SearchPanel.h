@@ -5,19 +5,7 @@
  */
 
 #include "Object.h"
-#include "Objects/ObjectBase.h"
-#include "Objects/AllGuis.h"
-#include <m_pd.h>
-#include <m_imp.h>
-
-extern "C" {
-#include <g_all_guis.h>
-}
-
-static int srl_is_valid(t_symbol const* s)
-{
-    return (s != nullptr && s != gensym(""));
-}
+#include "SearchIndex.h"
 
 class SearchPanelSettings : public Component {
 public:
@@ -190,11 +178,10 @@ public:
     {
         auto* cnv = editor->getCurrentCanvas();
         if (cnv) {
-            cnv->pd->lockAudioThread(); // It locks inside of this anyway, so we might as well lock around it to prevent constantly locking/unlocking
-            auto tree = generatePatchTree(cnv->refCountedPatch);
+            // Only the patches that changed since the last search are read from pd, the rest comes from the index
+            auto tree = editor->pd->searchIndex->getPatchTree(pd::WeakReference(cnv->patch.getUncheckedPointer(), editor->pd));
             patchTree.setValueTree(tree);
             patchTree.filterNodes();
-            cnv->pd->unlockAudioThread();
         }
     }
 
@@ -214,261 +201,6 @@ public:
         patchTree.setBounds(tableBounds);
     }
 
-    ValueTree generatePatchTree(pd::Patch::Ptr patch, void* topLevel = nullptr)
-    {
-        ValueTree patchTree("Patch");
-        for (auto objectPtr : patch->getObjects()) {
-            if (auto object = objectPtr.get<t_pd>()) {
-                auto* top = topLevel ? topLevel : object.get();
-                String type = String::fromUTF8(pd::Interface::getObjectClassName(object.get()));
-
-                if (!pd::Interface::checkObject(object.get()))
-                    continue;
-
-                char* objectText;
-                int len;
-                pd::Interface::getObjectText(object.cast<t_text>(), &objectText, &len);
-
-                int x, y, w, h;
-                pd::Interface::getObjectBounds(patch->getPointer().get(), object.cast<t_gobj>(), &x, &y, &w, &h);
-
-                auto name = String::fromUTF8(objectText, len);
-                auto nameWithoutArgs = name.upToFirstOccurrenceOf(" ", false, false);
-                auto positionText = " (" + String(x) + ":" + String(y) + ")";
-
-                auto getFirstArgumentFromFullName = [](String const& fullName) -> String {
-                    return fullName.fromFirstOccurrenceOf(" ", false, true).upToFirstOccurrenceOf(" ", false, true);
-                };
-
-                ValueTree element("Object");
-                if (type == "canvas" || type == "graph") {
-                    pd::Patch::Ptr subpatch = new pd::Patch(objectPtr, editor->pd, false);
-                    ValueTree subpatchTree = generatePatchTree(subpatch, top);
-                    element.copyPropertiesAndChildrenFrom(subpatchTree, nullptr);
-
-                    if (auto patchPtr = subpatch->getPointer()) {
-                        if (patchPtr->gl_list) {
-                            t_class* c = patchPtr->gl_list->g_pd;
-                            if (c && c->c_name && (String::fromUTF8(c->c_name->s_name) == "array")) {
-                                StringArray arrays;
-                                auto arrayIt = patchPtr->gl_list;
-                                while (arrayIt) {
-                                    if (auto* array = reinterpret_cast<t_fake_garray*>(arrayIt))
-                                        arrays.add(String::fromUTF8(array->x_name->s_name));
-                                    arrayIt = arrayIt->g_next;
-                                }
-                                String formatedArraysText;
-                                for (int i = 0; i < arrays.size(); i++) {
-                                    formatedArraysText += arrays[i] + String(i < arrays.size() - 1 ? ", " : "");
-                                }
-                                name = "array: " + formatedArraysText;
-                            } else if (patchPtr->gl_isgraph) {
-                                name = nameWithoutArgs;
-                            }
-                        } else if (patchPtr->gl_isgraph) {
-                            name = nameWithoutArgs;
-                        }
-                    }
-#ifdef SHOW_PD_SUBPATCH_SYMBOL
-                    if (nameWithoutArgs == "pd") {
-                        auto arg = getFirstArgumentFromFullName(name);
-                        if (arg.isNotEmpty())
-                            element.setProperty("PDSymbol", nameWithoutArgs + "-" + arg, nullptr);
-                    }
-#endif
-                    element.setProperty("Name", name, nullptr);
-                    element.setProperty("RightText", positionText, nullptr);
-                    element.setProperty("Icon", canvas_isabstraction(subpatch->getPointer().get()) ? Icons::File : Icons::Object, nullptr);
-                    element.setProperty("Object", reinterpret_cast<int64>(object.cast<void>()), nullptr);
-                    element.setProperty("TopLevel", reinterpret_cast<int64>(top), nullptr);
-                } else {
-                    String finalFormatedName;
-                    String sendSymbol;
-                    String receiveSymbol;
-
-                    switch (hash(type)) {
-                    // IEM send-receive symbols
-                    case hash("bng"):
-                    case hash("hsl"):
-                    case hash("vsl"):
-                    case hash("slider"):
-                    case hash("tgl"):
-                    case hash("nbx"):
-                    case hash("vradio"):
-                    case hash("hradio"):
-                    case hash("vu"):
-                    case hash("cnv"): {
-                        if (auto iemgui = objectPtr.get<t_iemgui>()) {
-                            t_symbol* srlsym[3];
-                            iemgui_all_sym2dollararg(iemgui.get(), srlsym);
-                            if (srl_is_valid(srlsym[0])) {
-                                sendSymbol = String::fromUTF8(iemgui->x_snd_unexpanded->s_name);
-                            }
-                            if (srl_is_valid(srlsym[1])) {
-                                receiveSymbol = String::fromUTF8(iemgui->x_rcv_unexpanded->s_name);
-                            }
-                        }
-                        finalFormatedName = nameWithoutArgs;
-                        break;
-                    }
-                    case hash("keyboard"): {
-                        if (auto keyboardObject = object.cast<t_fake_keyboard>()) {
-                            sendSymbol = String(keyboardObject->x_send->s_name);
-                            receiveSymbol = String(keyboardObject->x_receive->s_name);
-                        }
-                        finalFormatedName = nameWithoutArgs;
-                        break;
-                    }
-                    case hash("pic"): {
-                        if (auto picObject = object.cast<t_fake_pic>()) {
-                            sendSymbol = String(picObject->x_send->s_name);
-                            receiveSymbol = String(picObject->x_receive->s_name);
-                        }
-                        finalFormatedName = nameWithoutArgs;
-                        break;
-                    }
-                    case hash("scope~"): {
-                        if (auto scopeObject = object.cast<t_fake_scope>()) {
-                            receiveSymbol = String(scopeObject->x_receive->s_name);
-                        }
-                        finalFormatedName = nameWithoutArgs;
-                        break;
-                    }
-                    case hash("function"): {
-                        if (auto keyboardObject = object.cast<t_fake_function>()) {
-                            sendSymbol = String(keyboardObject->x_send->s_name);
-                            receiveSymbol = String(keyboardObject->x_receive->s_name);
-                        }
-                        finalFormatedName = nameWithoutArgs;
-                        break;
-                    }
-                    case hash("note"): {
-                        if (auto noteObject = object.cast<t_fake_note>()) {
-                            receiveSymbol = String(noteObject->x_receive->s_name);
-                        }
-                        finalFormatedName = nameWithoutArgs;
-                        break;
-                    }
-                    case hash("knob"): {
-                        if (auto knobObj = object.cast<t_fake_knob>()) {
-                            sendSymbol = String(knobObj->x_snd->s_name);
-                            receiveSymbol = String(knobObj->x_rcv->s_name);
-                        }
-                        finalFormatedName = nameWithoutArgs;
-                        break;
-                    }
-                    case hash("gatom"): {
-                        auto gatomObject = object.cast<t_fake_gatom>();
-                        String gatomName;
-                        switch (gatomObject->a_flavor) {
-                        case A_FLOAT:
-                            gatomName = "floatbox";
-                            break;
-                        case A_SYMBOL:
-                            gatomName = "symbolbox";
-                            break;
-                        case A_NULL:
-                            gatomName = "listbox";
-                            break;
-                        default:
-                            break;
-                        }
-                        receiveSymbol = String(gatomObject->a_symfrom->s_name);
-                        sendSymbol = String(gatomObject->a_symto->s_name);
-                        finalFormatedName = gatomName;
-                        break;
-                    }
-                    case hash("message"): {
-                        finalFormatedName = "msg: " + name;
-                        break;
-                    }
-                    case hash("comment"): {
-                        finalFormatedName = "comment: " + name;
-                        break;
-                    }
-                    case hash("text"): {
-                        switch (object.cast<t_fake_text_define>()->x_textbuf.b_ob.te_type) {
-                        case T_TEXT: {
-                            // if object & classname is text, then it's a comment
-                            finalFormatedName = String("comment: ") + name;
-                            break;
-                        }
-                        case T_OBJECT: {
-                            // if object is T_OBJECT but classname is 'text' object is in error state
-                            element.setProperty("IconColour", Colours::red.toString(), nullptr);
-
-                            if (name.isEmpty())
-                                finalFormatedName = String("empty");
-                            else
-                                finalFormatedName = String("unknown: ") + name;
-
-                            break;
-                        }
-                        default:
-                            break;
-                        }
-                        break;
-                    }
-                    case hash("canvas"):
-                    case hash("bicoeff"):
-                    case hash("messbox"):
-                    case hash("pad"):
-                    case hash("button"): {
-                        finalFormatedName = nameWithoutArgs;
-                        break;
-                    }
-
-                    default: {
-                        switch (hash(nameWithoutArgs)) {
-                        case hash("s"):
-                        case hash("s~"):
-                        case hash("send"):
-                        case hash("send~"):
-                        case hash("throw~"): {
-                            sendSymbol = getFirstArgumentFromFullName(name);
-                            element.setProperty("SymbolIsObject", 1, nullptr);
-                            finalFormatedName = nameWithoutArgs;
-                            break;
-                        }
-                        case hash("r"):
-                        case hash("r~"):
-                        case hash("receive"):
-                        case hash("receive~"):
-                        case hash("catch~"): {
-                            receiveSymbol = getFirstArgumentFromFullName(name);
-                            element.setProperty("SymbolIsObject", 1, nullptr);
-                            finalFormatedName = nameWithoutArgs;
-                            break;
-                        }
-                        default:
-                            finalFormatedName = name;
-                            break;
-                        }
-                        break;
-                    }
-                    }
-
-                    element.setProperty("Name", finalFormatedName, nullptr);
-                    // Add send/receive tags if they exist
-                    if (sendSymbol.isNotEmpty() && (sendSymbol != "empty") && (sendSymbol != "nosndno")) {
-                        element.setProperty("SendSymbol", sendSymbol, nullptr);
-                    }
-                    if (receiveSymbol.isNotEmpty() && (receiveSymbol != "empty")) {
-                        element.setProperty("ReceiveSymbol", receiveSymbol, nullptr);
-                    }
-                    element.setProperty("RightText", positionText, nullptr);
-                    element.setProperty("Icon", Icons::Object, nullptr);
-                    element.setProperty("Object", reinterpret_cast<int64>(object.cast<void>()), nullptr);
-                    element.setProperty("TopLevel", reinterpret_cast<int64>(top), nullptr);
-                }
-
-                patchTree.appendChild(element, nullptr);
-            }
-        }
-
-        return patchTree;
-    }
-
     SafePointer<Canvas> currentCanvas;
     PluginEditor* editor;
     ValueTreeViewerComponent patchTree = ValueTreeViewerComponent("(Subpatch)");
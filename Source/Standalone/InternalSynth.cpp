@@ -15,27 +15,36 @@
 // InternalSynth is an internal General MIDI synthesizer that can be used as a MIDI output device
 // The goal is to get something similar to the "AU DLS Synth" in Max/MSP on macOS, but cross-platform
 // Since fluidsynth is alraedy included for the sfont~ object, we can reuse it here to read a GM soundfont
+struct InternalSynth::Synth {
+    FluidSynth* synth = nullptr;
+    FluidSettings* settings = nullptr;
+
+    int sampleRate = 0;
+    int blockSize = 0;
+    int numChannels = 0;
+
+    AudioBuffer<float> buffer;
+
+    // Crossfade gain, only used on the audio thread
+    float gain = 0.0f;
+
+    // How many stolen voices we already counted, only used on the audio thread
+    unsigned int reportedStolenVoices = 0;
+};
+
 InternalSynth::InternalSynth()
     : Thread("InternalSynthInit")
 {
-#ifndef PLUGDATA_STANDALONE
-    ignoreUnused(synth);
-    ignoreUnused(settings);
-#endif
 }
 
 InternalSynth::~InternalSynth()
 {
-#ifdef PLUGDATA_STANDALONE
     stopThread(6000);
 
-    if (ready) {
-        if (synth)
-            delete_fluid_synth(synth);
-        if (settings)
-            delete_fluid_settings(settings);
-    }
-#endif
+    deleteSynth(activeSynth);
+    deleteSynth(fadingSynth);
+    deleteSynth(loadedSynth.exchange(nullptr));
+    deleteSynth(retiredSynth.exchange(nullptr));
 }
 
 void InternalSynth::extractSoundfont()
@@ -50,99 +59,219 @@ void InternalSynth::extractSoundfont()
 #endif
 }
 
-// Initialise fluidsynth on another thread, because it takes a while
+// Creates and deletes synths on another thread, because it takes a while
 void InternalSynth::run()
 {
 #ifdef PLUGDATA_STANDALONE
+    while (!threadShouldExit()) {
+        // Synths the audio thread is done with get deleted here
+        deleteSynth(retiredSynth.exchange(nullptr));
+
+        auto const sampleRate = requestedSampleRate.load();
+        auto const blockSize = requestedBlockSize.load();
+        auto const numChannels = requestedNumChannels.load();
+
+        if (!wantsSynth) {
+            // A synth that finished loading after it was turned off isn't needed anymore
+            deleteSynth(loadedSynth.exchange(nullptr));
+            builtSampleRate = builtBlockSize = builtNumChannels = 0;
+        } else if (sampleRate > 0 && blockSize > 0 && !loadedSynth.load()) {
+            // Whatever happened while we were waiting, if the synth is wanted now, we make sure there is one
+            auto const discarded = synthDiscarded.exchange(false);
+            if (discarded || sampleRate != builtSampleRate || blockSize != builtBlockSize || numChannels != builtNumChannels) {
+                builtSampleRate = sampleRate;
+                builtBlockSize = blockSize;
+                builtNumChannels = numChannels;
+
+                loadedSynth = createSynth(sampleRate, blockSize, numChannels);
+            }
+        }
+
+        wait(20);
+    }
+#endif
+}
+
+InternalSynth::Synth* InternalSynth::createSynth(int sampleRate, int blockSize, int numChannels)
+{
+#ifdef PLUGDATA_STANDALONE
+    // Check if soundfont exists to prevent crashing
+    if (!soundFont.existsAsFile())
+        return nullptr;
 
-    unprepareLock.lock();
+    auto* newSynth = new Synth();
+    newSynth->sampleRate = sampleRate;
+    newSynth->blockSize = blockSize;
+    newSynth->numChannels = numChannels;
 
     // Fluidlite does not like setups with <2 channels
-    internalBuffer.setSize(std::max(2, lastNumChannels.load()), lastBlockSize);
-    internalBuffer.clear();
+    newSynth->buffer.setSize(std::max(2, numChannels), blockSize);
+    newSynth->buffer.clear();
 
-    // Check if soundfont exists to prevent crashing
-    if (soundFont.existsAsFile()) {
-        auto pathName = soundFont.getFullPathName();
-
-        // Initialise fluidsynth
-        settings = new_fluid_settings();
-        fluid_settings_setint(settings, "synth.ladspa.active", 0);
-        fluid_settings_setint(settings, "synth.midi-channels", 16);
-        fluid_settings_setnum(settings, "synth.gain", 0.9f);
-        fluid_settings_setnum(settings, "synth.audio-channels", lastNumChannels);
-        fluid_settings_setnum(settings, "synth.sample-rate", lastSampleRate);
-        synth = new_fluid_synth(settings); // Create fluidsynth instance:
-
-        // Load the soundfont
-        int ret = fluid_synth_sfload(synth, pathName.toRawUTF8(), 0);
-
-        if (ret >= 0) {
-            fluid_synth_program_reset(synth);
-        }
+    auto pathName = soundFont.getFullPathName();
+
+    // Initialise fluidsynth
+    newSynth->settings = new_fluid_settings();
+    fluid_settings_setint(newSynth->settings, "synth.ladspa.active", 0);
+    fluid_settings_setint(newSynth->settings, "synth.midi-channels", 16);
+    fluid_settings_setnum(newSynth->settings, "synth.gain", 0.9f);
+    fluid_settings_setnum(newSynth->settings, "synth.audio-channels", numChannels);
+    fluid_settings_setnum(newSynth->settings, "synth.sample-rate", sampleRate);
+    newSynth->synth = new_fluid_synth(newSynth->settings); // Create fluidsynth instance:
+
+    // Load the soundfont
+    int ret = fluid_synth_sfload(newSynth->synth, pathName.toRawUTF8(), 0);
 
-        ready = true;
+    if (ret >= 0) {
+        fluid_synth_program_reset(newSynth->synth);
     }
 
-    unprepareLock.unlock();
+    return newSynth;
+#else
+    ignoreUnused(sampleRate, blockSize, numChannels);
+    return nullptr;
+#endif
+}
+
+void InternalSynth::deleteSynth(Synth* synth)
+{
+    if (!synth)
+        return;
+
+#ifdef PLUGDATA_STANDALONE
+    if (synth->synth)
+        delete_fluid_synth(synth->synth);
+    if (synth->settings)
+        delete_fluid_settings(synth->settings);
+#endif
+
+    delete synth;
+}
+
+void InternalSynth::prepare(int sampleRate, int blockSize, int numChannels)
+{
+#ifdef PLUGDATA_STANDALONE
+    requestedSampleRate = sampleRate;
+    requestedBlockSize = blockSize;
+    requestedNumChannels = numChannels;
 
+    startThread();
+#else
+    ignoreUnused(sampleRate, blockSize, numChannels);
 #endif
 }
 
-void InternalSynth::unprepare()
+void InternalSynth::process(AudioBuffer<float>& buffer, MidiBuffer& midiMessages, bool enabled, float lastBlockLoad)
 {
 #ifdef PLUGDATA_STANDALONE
+    auto const numChannels = buffer.getNumChannels();
+    auto const numSamples = buffer.getNumSamples();
+
+    // Ask for a new synth if this buffer doesn't fit the one we have
+    wantsSynth = enabled;
+    if (numChannels != requestedNumChannels.load())
+        requestedNumChannels = numChannels;
+    if (numSamples > requestedBlockSize.load())
+        requestedBlockSize = numSamples;
+
+    // Swap synths only when the last crossfade is done, so there are never more than two playing
+    if (!fadingSynth) {
+        if (!enabled) {
+            if (activeSynth)
+                synthDiscarded = true;
+
+            fadingSynth = activeSynth;
+            activeSynth = nullptr;
+        } else if (auto* newSynth = loadedSynth.exchange(nullptr)) {
+            fadingSynth = activeSynth;
+            activeSynth = newSynth;
+            activeSynth->gain = 0.0f;
+        }
+    }
 
-    unprepareLock.lock();
+    auto const fits = [numChannels, numSamples](Synth* synth) {
+        return synth->numChannels == numChannels && numSamples <= synth->blockSize;
+    };
 
-    if (ready) {
-        if (synth)
-            delete_fluid_synth(synth);
-        if (settings)
-            delete_fluid_settings(settings);
+    auto const getGainStep = [numSamples](Synth* synth) {
+        return static_cast<float>(numSamples) / (crossfadeSeconds * static_cast<float>(synth->sampleRate));
+    };
 
-        lastSampleRate = 0;
-        lastBlockSize = 0;
-        lastNumChannels = 0;
+    if (activeSynth && fits(activeSynth)) {
+        auto const startGain = activeSynth->gain;
+        activeSynth->gain = std::min(1.0f, startGain + getGainStep(activeSynth));
 
-        ready = false;
+        // Before the note-ons of this block, so they already take the place of quieter voices
+        updateVoiceBudget(activeSynth, lastBlockLoad);
 
-        synth = nullptr;
-        settings = nullptr;
+        sendMidi(activeSynth, midiMessages);
+        render(activeSynth, buffer, startGain, activeSynth->gain);
+
+        auto const stolenVoices = fluid_synth_get_stolen_voice_count(activeSynth->synth);
+        numStolenVoices.fetch_add(stolenVoices - activeSynth->reportedStolenVoices, std::memory_order_relaxed);
+        activeSynth->reportedStolenVoices = stolenVoices;
     }
 
-    unprepareLock.unlock();
+    if (fadingSynth) {
+        auto const startGain = fadingSynth->gain;
+        fadingSynth->gain = std::max(0.0f, startGain - getGainStep(fadingSynth));
+
+        if (startGain > 0.0f && fits(fadingSynth))
+            render(fadingSynth, buffer, startGain, fadingSynth->gain);
 
+        // Hand it to the background thread to delete, if it's still busy with the last one we'll try again next block
+        Synth* expected = nullptr;
+        if (fadingSynth->gain <= 0.0f && retiredSynth.compare_exchange_strong(expected, fadingSynth))
+            fadingSynth = nullptr;
+    }
+
+    ready = activeSynth != nullptr;
+#else
+    ignoreUnused(buffer, midiMessages, enabled, lastBlockLoad);
 #endif
 }
 
-void InternalSynth::prepare(int sampleRate, int blockSize, int numChannels)
+void InternalSynth::updateVoiceBudget(Synth* synth, float lastBlockLoad)
 {
 #ifdef PLUGDATA_STANDALONE
+    auto* fluid = synth->synth;
 
-    if (ready && !isThreadRunning() && sampleRate == lastSampleRate && blockSize == lastBlockSize && numChannels == lastNumChannels) {
+    // A single slow block is often caused by something else, like a GUI update taking the lock, so only react to a trend
+    smoothedLoad += (lastBlockLoad - smoothedLoad) * 0.2f;
+
+    if (blocksUntilBudgetChange > 0) {
+        blocksUntilBudgetChange--;
         return;
-    } else {
-        lastSampleRate = sampleRate;
-        lastBlockSize = blockSize;
-        lastNumChannels = numChannels;
+    }
 
-        startThread();
+    auto const polyphony = fluid_synth_get_polyphony(fluid);
+    auto const currentBudget = fluid_synth_get_voice_budget(fluid);
+    auto const budget = currentBudget > 0 ? currentBudget : polyphony;
+
+    if (smoothedLoad > loadToShedVoices) {
+        // Shed relative to what's playing, a budget far above the playing voices wouldn't change anything
+        auto const playing = std::min(budget, fluid_synth_get_active_voice_count(fluid));
+        auto const newBudget = std::max(minVoiceBudget, playing - playing / 4);
+        if (newBudget < budget)
+            fluid_synth_set_voice_budget(fluid, newBudget);
+
+        blocksUntilBudgetChange = blocksAfterShedding;
+    } else if (smoothedLoad < loadToRestoreVoices && currentBudget > 0) {
+        // Setting it to the polyphony removes the budget
+        fluid_synth_set_voice_budget(fluid, currentBudget + 1);
+        blocksUntilBudgetChange = blocksPerRestoredVoice;
     }
 
+    voiceBudget.store(fluid_synth_get_voice_budget(fluid), std::memory_order_relaxed);
+#else
+    ignoreUnused(synth, lastBlockLoad);
 #endif
 }
 
-void InternalSynth::process(AudioBuffer<float>& buffer, MidiBuffer& midiMessages)
+void InternalSynth::sendMidi(Synth* synth, MidiBuffer& midiMessages)
 {
 #ifdef PLUGDATA_STANDALONE
-
-    if (buffer.getNumChannels() != lastNumChannels || buffer.getNumSamples() > lastBlockSize) {
-        unprepare();
-        return;
-    }
-
-    unprepareLock.lock();
+    auto* fluid = synth->synth;
 
     // Pass MIDI messages to fluidsynth
     for (auto const& event : midiMessages) {
@@ -151,42 +280,51 @@ void InternalSynth::process(AudioBuffer<float>& buffer, MidiBuffer& midiMessages
         auto channel = message.getChannel() - 1;
 
         if (message.isNoteOn()) {
-            fluid_synth_noteon(synth, channel, message.getNoteNumber(), message.getVelocity());
+            fluid_synth_noteon(fluid, channel, message.getNoteNumber(), message.getVelocity());
         }
         if (message.isNoteOff()) {
-            fluid_synth_noteoff(synth, channel, message.getNoteNumber());
+            fluid_synth_noteoff(fluid, channel, message.getNoteNumber());
         }
         if (message.isAftertouch()) {
-            fluid_synth_key_pressure(synth, channel, message.getNoteNumber(), message.getAfterTouchValue());
+            fluid_synth_key_pressure(fluid, channel, message.getNoteNumber(), message.getAfterTouchValue());
         }
         if (message.isChannelPressure()) {
-            fluid_synth_channel_pressure(synth, channel, message.getAfterTouchValue());
+            fluid_synth_channel_pressure(fluid, channel, message.getAfterTouchValue());
         }
         if (message.isController()) {
-            fluid_synth_cc(synth, channel, message.getControllerNumber(), message.getControllerValue());
+            fluid_synth_cc(fluid, channel, message.getControllerNumber(), message.getControllerValue());
         }
         if (message.isProgramChange()) {
-            fluid_synth_program_change(synth, channel, message.getProgramChangeNumber());
+            fluid_synth_program_change(fluid, channel, message.getProgramChangeNumber());
         }
         if (message.isPitchWheel()) {
-            fluid_synth_pitch_bend(synth, channel, message.getPitchWheelValue());
+            fluid_synth_pitch_bend(fluid, channel, message.getPitchWheelValue());
         }
         if (message.isSysEx()) {
-            fluid_synth_sysex(synth, reinterpret_cast<char const*>(message.getSysExData()), message.getSysExDataSize(), nullptr, nullptr, nullptr, 0);
+            fluid_synth_sysex(fluid, reinterpret_cast<char const*>(message.getSysExData()), message.getSysExDataSize(), nullptr, nullptr, nullptr, 0);
         }
     }
+#else
+    ignoreUnused(synth, midiMessages);
+#endif
+}
+
+void InternalSynth::render(Synth* synth, AudioBuffer<float>& buffer, float startGain, float endGain)
+{
+#ifdef PLUGDATA_STANDALONE
+    auto& internalBuffer = synth->buffer;
+    auto const numFluidChannels = std::max(2, buffer.getNumChannels());
 
     internalBuffer.clear();
 
     // Run audio through fluidsynth
-    fluid_synth_process(synth, buffer.getNumSamples(), std::max(2, buffer.getNumChannels()), const_cast<float**>(internalBuffer.getArrayOfReadPointers()), std::max(2, buffer.getNumChannels()), const_cast<float**>(internalBuffer.getArrayOfWritePointers()));
+    fluid_synth_process(synth->synth, buffer.getNumSamples(), numFluidChannels, const_cast<float**>(internalBuffer.getArrayOfReadPointers()), numFluidChannels, const_cast<float**>(internalBuffer.getArrayOfWritePointers()));
 
     for (int ch = 0; ch < buffer.getNumChannels(); ch++) {
-        buffer.addFrom(ch, 0, internalBuffer, ch, 0, buffer.getNumSamples());
+        buffer.addFromWithRamp(ch, 0, internalBuffer.getReadPointer(ch), buffer.getNumSamples(), startGain, endGain);
     }
-
-    unprepareLock.unlock();
-
+#else
+    ignoreUnused(synth, buffer, startGain, endGain);
 #endif
 }
 
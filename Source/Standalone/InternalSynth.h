@@ -15,6 +15,10 @@
 typedef struct _fluid_synth_t FluidSynth;
 typedef struct _fluid_hashtable_t FluidSettings;
 
+// Fluidsynth is created and deleted on a background thread, the audio thread only says whether it wants a synth, and in what format
+// Once a new synth is loaded, the audio thread picks it up between two blocks and crossfades to it, so toggling it never causes a dropout
+// When blocks get close to their deadline, the synth gets a voice budget below its polyphony, so dense GM files steal their quietest
+// voices instead of causing dropouts. The budget grows back slowly once there's time to spare
 class InternalSynth final : public Thread {
 
 public:
@@ -24,30 +28,77 @@ public:
 
     void extractSoundfont();
 
-    // Initialise fluidsynth on another thread, because it takes a while
+    // Creates and deletes synths on another thread, because it takes a while
     void run() override;
 
-    void unprepare();
-
+    // Message thread: sets the sample rate and starts the background thread
     void prepare(int sampleRate, int blockSize, int numChannels);
 
-    void process(AudioBuffer<float>& buffer, MidiBuffer& midiMessages);
+    // Audio thread: adds the synth output to the buffer, or fades it out if it's no longer enabled
+    // Never blocks, if the synth isn't ready yet, this block is skipped
+    // lastBlockLoad is how long the previous block took, as fraction of its deadline
+    void process(AudioBuffer<float>& buffer, MidiBuffer& midiMessages, bool enabled, float lastBlockLoad);
 
     bool isReady();
 
+    // Voices that were stopped early to stay within the polyphony or the voice budget, since the app was started
+    uint32 getNumStolenVoices() const { return numStolenVoices.load(std::memory_order_relaxed); }
+
+    // The number of voices the synth may play right now, 0 when it's not limited
+    int getVoiceBudget() const { return voiceBudget.load(std::memory_order_relaxed); }
+
 private:
+    struct Synth;
+
+    Synth* createSynth(int sampleRate, int blockSize, int numChannels);
+    static void deleteSynth(Synth* synth);
+
+    void updateVoiceBudget(Synth* synth, float lastBlockLoad);
+
+    static void sendMidi(Synth* synth, MidiBuffer& midiMessages);
+    static void render(Synth* synth, AudioBuffer<float>& buffer, float startGain, float endGain);
+
     File soundFont = ProjectInfo::versionDataDir.getChildFile("Extra").getChildFile("GS").getChildFile("GeneralUser_GS.sf3");
 
-    // Fluidsynth state
-    FluidSynth* synth = nullptr;
-    FluidSettings* settings = nullptr;
+    // Requested by the audio thread, read by the background thread
+    std::atomic<bool> wantsSynth = false;
+    std::atomic<int> requestedSampleRate = 0;
+    std::atomic<int> requestedBlockSize = 0;
+    std::atomic<int> requestedNumChannels = 0;
+
+    // Set when the audio thread let go of its synth because it was turned off
+    // If it's turned back on before the background thread noticed, the format is the same, but we still need a new synth
+    std::atomic<bool> synthDiscarded = false;
+
+    // Handed over between the two threads, each can only hold one synth at a time
+    std::atomic<Synth*> loadedSynth = nullptr;
+    std::atomic<Synth*> retiredSynth = nullptr;
+
+    // Only used on the audio thread
+    Synth* activeSynth = nullptr;
+    Synth* fadingSynth = nullptr;
+
+    // Only used on the background thread, the format of the synth that was created last
+    int builtSampleRate = 0, builtBlockSize = 0, builtNumChannels = 0;
 
     std::atomic<bool> ready = false;
-    std::mutex unprepareLock;
 
-    std::atomic<int> lastSampleRate = 0;
-    std::atomic<int> lastBlockSize = 0;
-    std::atomic<int> lastNumChannels = 0;
+    // Only used on the audio thread
+    float smoothedLoad = 0.0f;
+    int blocksUntilBudgetChange = 0;
+
+    // Reported to the GUI
+    std::atomic<uint32> numStolenVoices = 0;
+    std::atomic<int> voiceBudget = 0;
+
+    static constexpr float crossfadeSeconds = 0.02f;
+
+    // Above this load, we take away a quarter of the playing voices, below the other one we give one back
+    static constexpr float loadToShedVoices = 0.85f;
+    static constexpr float loadToRestoreVoices = 0.6f;
+    static constexpr int minVoiceBudget = 16;
 
-    AudioBuffer<float> internalBuffer;
+    // Blocks to wait after shedding before looking again, so the load can settle, and between restoring two voices
+    static constexpr int blocksAfterShedding = 16;
+    static constexpr int blocksPerRestoredVoice = 8;
 };
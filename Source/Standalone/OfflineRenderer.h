@@ -0,0 +1,243 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <thread>
+
+// Renders patches into audio files as fast as the CPU allows, without a GUI or audio device
+// Start it with: plugdata --headless --render [--seconds 60] [--input in.wav ...] [--output out.wav] [--output-dir dir]
+//                [--sample-rate 48000] [--block-size 512] [--bit-depth 24] [--jobs 4] patch.pd ...
+// Every patch is rendered once, or once for every input file. Renders run in their own instance, several at the same time
+// pd's clocks advance with the samples we process, so metros and delays run in logical time, no matter how fast we render
+// Results go to the console, which is written to stdout in headless mode. Returns the number of renders that failed
+class OfflineRenderer {
+public:
+    struct Job {
+        File patch;
+        File input;
+        File output;
+    };
+
+    static int run(StringArray const& args)
+    {
+        auto getArgument = [&args](String const& name, double defaultValue) {
+            auto const index = args.indexOf(name);
+            return index >= 0 && index + 1 < args.size() ? args[index + 1].getDoubleValue() : defaultValue;
+        };
+        auto getFileArguments = [&args](String const& name) {
+            Array<File> files;
+            for (int i = 0; i < args.size() - 1; i++) {
+                if (args[i] == name)
+                    files.add(File::getCurrentWorkingDirectory().getChildFile(args[i + 1].unquoted()));
+            }
+            return files;
+        };
+
+        auto const inputs = getFileArguments("--input");
+        auto const outputs = getFileArguments("--output");
+        auto const outputDirectories = getFileArguments("--output-dir");
+
+        Array<File> patches;
+        for (auto const& arg : args) {
+            auto const patchFile = File::getCurrentWorkingDirectory().getChildFile(arg.trim().unquoted().trim());
+            if (patchFile.existsAsFile() && patchFile.hasFileExtension("pd"))
+                patches.add(patchFile);
+        }
+
+        std::vector<Job> jobs;
+        for (auto const& patch : patches) {
+            if (inputs.isEmpty()) {
+                jobs.push_back({ patch, File(), File() });
+                continue;
+            }
+            for (auto const& input : inputs) {
+                jobs.push_back({ patch, input, File() });
+            }
+        }
+
+        for (auto& job : jobs) {
+            auto const name = job.input.exists() ? job.input.getFileNameWithoutExtension() + "-" + job.patch.getFileNameWithoutExtension() : job.patch.getFileNameWithoutExtension();
+            auto const directory = outputDirectories.isEmpty() ? job.patch.getParentDirectory() : outputDirectories.getFirst();
+            job.output = jobs.size() == 1 && !outputs.isEmpty() ? outputs.getFirst() : directory.getChildFile(name + ".wav");
+        }
+
+        if (jobs.empty()) {
+            Logger::writeToLog("No patches to render");
+            return 1;
+        }
+
+        Settings settings;
+        settings.seconds = getArgument("--seconds", 0.0);
+        settings.sampleRate = getArgument("--sample-rate", 0.0);
+        settings.blockSize = std::max(1, static_cast<int>(getArgument("--block-size", 512)));
+        settings.bitDepth = static_cast<int>(getArgument("--bit-depth", 24));
+
+        // Without multi-instance support, all instances share pd's global state, so they can't render at the same time
+        auto const maxJobs = pd::Instance::hasMultipleInstances() ? static_cast<int>(getArgument("--jobs", SystemStats::getNumPhysicalCpus())) : 1;
+        auto const numJobs = static_cast<size_t>(std::max(1, maxJobs));
+
+        int numFailed = 0;
+
+        // Instances are created and loaded on the message thread, and only the rendering itself runs in parallel
+        for (size_t first = 0; first < jobs.size(); first += numJobs) {
+            auto const last = std::min(jobs.size(), first + numJobs);
+
+            std::vector<std::unique_ptr<Render>> renders;
+            for (auto i = first; i < last; i++) {
+                renders.push_back(std::make_unique<Render>(jobs[i], settings));
+            }
+
+            std::vector<std::thread> threads;
+            for (auto& render : renders) {
+                threads.emplace_back([&render]() { render->process(); });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+
+            for (auto& render : renders) {
+                if (!render->finish())
+                    numFailed++;
+            }
+        }
+
+        return numFailed;
+    }
+
+private:
+    struct Settings {
+        double seconds = 0.0;    // 0 means as long as the input file
+        double sampleRate = 0.0; // 0 means the rate of the input file, or 48kHz
+        int blockSize = 512;
+        int bitDepth = 24;
+    };
+
+    class Render {
+    public:
+        Render(Job const& jobToRender, Settings const& settings)
+            : job(jobToRender)
+            , blockSize(settings.blockSize)
+        {
+            formatManager.registerBasicFormats();
+
+            // Created first, so errors can be reported to its console
+            processor.reset(dynamic_cast<PluginProcessor*>(createPluginFilterOfType(AudioProcessor::wrapperType_Standalone)));
+
+            if (job.input.existsAsFile()) {
+                reader.reset(formatManager.createReaderFor(job.input));
+                if (!reader) {
+                    error = "can't read " + job.input.getFullPathName();
+                    return;
+                }
+            }
+
+            sampleRate = settings.sampleRate > 0.0 ? settings.sampleRate : (reader ? reader->sampleRate : 48000.0);
+            if (reader && !approximatelyEqual(reader->sampleRate, sampleRate)) {
+                error = "the sample rate of " + job.input.getFileName() + " doesn't match the render sample rate";
+                return;
+            }
+
+            auto const seconds = settings.seconds > 0.0 ? settings.seconds : (reader ? static_cast<double>(reader->lengthInSamples) / sampleRate : 10.0);
+            numSamples = static_cast<int64>(seconds * sampleRate);
+
+            processor->loadPatch(URL(job.patch));
+            processor->prepareToPlay(sampleRate, blockSize);
+
+            // Don't keep the latency of the fifos and oversampling in the file
+            latency = processor->getLatencySamples();
+
+            auto const numOutputChannels = processor->getTotalNumOutputChannels();
+            job.output.getParentDirectory().createDirectory();
+            job.output.deleteFile();
+            auto stream = job.output.createOutputStream();
+
+            WavAudioFormat wav;
+            if (stream)
+                writer.reset(wav.createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(numOutputChannels), settings.bitDepth, {}, 0));
+
+            if (!writer) {
+                error = "can't write " + job.output.getFullPathName();
+                return;
+            }
+
+            stream.release(); // The writer owns it now
+        }
+
+        void process()
+        {
+            if (!writer)
+                return;
+
+            auto const start = Time::getMillisecondCounterHiRes();
+            auto const numChannels = std::max(processor->getTotalNumInputChannels(), processor->getTotalNumOutputChannels());
+            auto const numOutputChannels = processor->getTotalNumOutputChannels();
+
+            AudioBuffer<float> buffer(numChannels, blockSize);
+            MidiBuffer midi;
+            std::vector<float const*> channelsToWrite(static_cast<size_t>(numOutputChannels));
+
+            int64 numRead = 0;
+            int64 numWritten = 0;
+            auto const totalToProcess = numSamples + latency;
+
+            for (int64 processed = 0; processed < totalToProcess; processed += blockSize) {
+                buffer.clear();
+                if (reader && numRead < reader->lengthInSamples) {
+                    reader->read(&buffer, 0, blockSize, numRead, true, true);
+                    numRead += blockSize;
+                }
+                midi.clear();
+
+                processor->processBlock(buffer, midi);
+
+                // Skip the samples that only hold latency, and stop at the length we were asked for
+                auto const skip = static_cast<int>(jlimit<int64>(0, blockSize, latency - processed));
+                auto const toWrite = static_cast<int>(std::min<int64>(blockSize - skip, numSamples - numWritten));
+                if (toWrite <= 0)
+                    continue;
+
+                for (int ch = 0; ch < numOutputChannels; ch++) {
+                    channelsToWrite[ch] = buffer.getReadPointer(ch, skip);
+                }
+                writer->writeFromFloatArrays(channelsToWrite.data(), numOutputChannels, toWrite);
+                numWritten += toWrite;
+            }
+
+            renderTime = Time::getMillisecondCounterHiRes() - start;
+        }
+
+        // Returns false if the render failed
+        bool finish()
+        {
+            writer.reset();
+            processor->releaseResources();
+
+            if (error.isNotEmpty()) {
+                processor->logError("Failed to render " + job.patch.getFullPathName() + ": " + error);
+                return false;
+            }
+
+            auto const realtimeFactor = renderTime > 0.0 ? (static_cast<double>(numSamples) / sampleRate * 1000.0) / renderTime : 0.0;
+            processor->logMessage("Rendered " + job.output.getFullPathName() + " (" + String(realtimeFactor, 1) + "x realtime)");
+            return true;
+        }
+
+    private:
+        Job job;
+        AudioFormatManager formatManager;
+        std::unique_ptr<AudioFormatReader> reader;
+        std::unique_ptr<AudioFormatWriter> writer;
+        std::unique_ptr<PluginProcessor> processor;
+
+        double sampleRate = 48000.0;
+        int blockSize;
+        int64 numSamples = 0;
+        int latency = 0;
+        double renderTime = 0.0;
+        String error;
+    };
+};
@@ -25,12 +25,20 @@
 #include "Pd/Setup.h"
 
 #include "PlugDataWindow.h"
+#include "OfflineRenderer.h"
 #include "Canvas.h"
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+#if ENABLE_BENCHMARK
+void runDSPBenchmark(StringArray const& args); // Tests/DSPBenchmark.cpp
+#endif
+
 #include "Dialogs/Dialogs.h"
 
+#include <iostream>
+#include <thread>
+
 #if JUCE_WINDOWS
 #    include <filesystem>
 #endif
@@ -87,7 +95,7 @@ public:
     {
         auto tokens = StringArray::fromTokens(commandLine, " ", "\"");
         auto file = File(tokens[0].unquoted());
-        if (file.existsAsFile()) {
+        if (file.existsAsFile() && mainWindow) {
             auto* pd = dynamic_cast<PluginProcessor*>(pluginHolder->processor.get());
             auto* editor = dynamic_cast<PluginEditor*>(mainWindow->mainComponent->getEditor());
             if (pd && editor && file.existsAsFile()) {
@@ -107,6 +115,12 @@ public:
 
     void initialise(String const& arguments) override
     {
+        auto const args = StringArray::fromTokens(arguments, true);
+        if (args.contains("--headless") || args.contains("-nogui")) {
+            initialiseHeadless(args);
+            return;
+        }
+
         LookAndFeel::getDefaultLookAndFeel().setColour(ResizableWindow::backgroundColourId, Colours::transparentBlack);
 
         pluginHolder = std::make_unique<StandalonePluginHolder>(appProperties.getUserSettings(), false, "");
@@ -146,8 +160,75 @@ public:
         mainWindow->setBoundsConstrained(getWindowScreenBounds());
     }
 
+    // Runs the processor and audio devices without creating a window, editor or graphics context
+    // Patches given on the command line are opened, after that every line on stdin is sent to pd as a message, like "pd dsp 1;"
+    // The console is written to stdout. With --metrics-port <port>, the metrics of every instance are served over HTTP
+    void initialiseHeadless(StringArray const& args)
+    {
+        ProjectInfo::isHeadless = true;
+        mainWindow = nullptr;
+
+#if ENABLE_BENCHMARK
+        if (args.contains("--benchmark-dsp")) {
+            runDSPBenchmark(args);
+            quit();
+            return;
+        }
+#endif
+
+        if (args.contains("--render")) {
+            setApplicationReturnValue(OfflineRenderer::run(args));
+            quit();
+            return;
+        }
+
+        pluginHolder = std::make_unique<StandalonePluginHolder>(appProperties.getUserSettings(), false, "");
+        auto* pd = dynamic_cast<PluginProcessor*>(pluginHolder->processor.get());
+
+        if (auto const index = args.indexOf("--metrics-port"); index >= 0 && index + 1 < args.size())
+            metricsExporter = std::make_unique<ProcessMetrics::Exporter>(args[index + 1].getIntValue());
+
+        for (auto arg : args) {
+            auto const toOpen = File(arg.trim().unquoted().trim());
+            if (toOpen.existsAsFile() && toOpen.hasFileExtension("pd"))
+                pd->loadPatch(URL(toOpen));
+        }
+
+        // Reading stdin blocks, and can't be interrupted when we quit, so this thread is never joined
+        std::thread([]() {
+            std::string line;
+            while (std::getline(std::cin, line)) {
+                MessageManager::callAsync([message = String::fromUTF8(line.c_str())]() {
+                    if (auto* app = dynamic_cast<PlugDataApp*>(JUCEApplicationBase::getInstance()))
+                        app->sendHeadlessMessage(message);
+                });
+            }
+        }).detach();
+    }
+
+    void sendHeadlessMessage(String const& message)
+    {
+        if (message.trim() == "quit" || message.trim() == "quit;") {
+            quit();
+            return;
+        }
+
+        auto* pd = dynamic_cast<PluginProcessor*>(pluginHolder->processor.get());
+        if (!pd || message.trim().isEmpty())
+            return;
+
+        pd->lockAudioThread();
+        pd->setThis();
+        t_binbuf* b = binbuf_new();
+        binbuf_text(b, message.toRawUTF8(), message.getNumBytesAsUTF8());
+        binbuf_eval(b, nullptr, 0, nullptr);
+        binbuf_free(b);
+        pd->unlockAudioThread();
+    }
+
     void shutdown() override
     {
+        metricsExporter = nullptr;
         mainWindow = nullptr;
         pluginHolder->stopPlaying();
         pluginHolder = nullptr;
@@ -243,10 +324,11 @@ public:
     }
 
     std::unique_ptr<StandalonePluginHolder> pluginHolder;
+    std::unique_ptr<ProcessMetrics::Exporter> metricsExporter;
 
 protected:
     ApplicationProperties appProperties;
-    PlugDataWindow* mainWindow;
+    PlugDataWindow* mainWindow = nullptr;
 };
 
 void PlugDataWindow::closeAllPatches()
@@ -604,11 +604,8 @@ public:
     {
         if (drawWindowShadow && !useNativeTitlebar() && !isFullScreen()) {
             auto b = getLocalBounds();
-            Path localPath;
-            localPath.addRoundedRectangle(b.toFloat().reduced(22.0f), Corners::windowCornerRadius);
-
             int radius = isActiveWindow() ? 22 : 17;
-            StackShadow::renderDropShadow(g, localPath, Colour(0, 0, 0).withAlpha(0.6f), radius, { 0, 2 });
+            StackShadow::renderDropShadow(g, b.toFloat().reduced(22.0f), Corners::windowCornerRadius, Colour(0, 0, 0).withAlpha(0.6f), radius, { 0, 2 });
         }
     }
 #elif JUCE_WINDOWS
@@ -442,9 +442,201 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(CPUHistoryGraph);
 };
 
+// Shows how long audio blocks took compared to their deadline, and what the overruns were spent on
+class BlockTimingDisplay : public Component
+    , public Timer
+    , public SettableTooltipClient {
+public:
+    explicit BlockTimingDisplay(BlockTimingMonitor& monitor)
+        : timing(monitor)
+    {
+        startTimer(500);
+    }
+
+    void timerCallback() override
+    {
+        repaint();
+    }
+
+    void mouseDoubleClick(MouseEvent const& e) override
+    {
+        timing.reset();
+        repaint();
+    }
+
+    void paint(Graphics& g) override
+    {
+        auto bounds = getLocalBounds().reduced(6, 0);
+        auto graphBounds = bounds.removeFromTop(44).toFloat();
+
+        g.setColour(findColour(PlugDataColour::levelMeterBackgroundColourId));
+        g.fillRoundedRectangle(graphBounds, Corners::defaultCornerRadius * 0.75f);
+
+        // Counts differ by orders of magnitude between bins, so scale the bars logarithmically
+        uint32 maxCount = 1;
+        for (int i = 0; i < BlockTimingMonitor::numBins; i++)
+            maxCount = std::max(maxCount, timing.getHistogramBin(i));
+
+        auto const barWidth = graphBounds.getWidth() / BlockTimingMonitor::numBins;
+        auto const labelFont = Fonts::getDefaultFont().withHeight(10.0f);
+        for (int i = 0; i < BlockTimingMonitor::numBins; i++) {
+            auto const count = timing.getHistogramBin(i);
+            auto const fraction = count > 0 ? std::log1p(static_cast<float>(count)) / std::log1p(static_cast<float>(maxCount)) : 0.0f;
+
+            auto barBounds = graphBounds.withX(graphBounds.getX() + i * barWidth).withWidth(barWidth).reduced(2.0f, 3.0f);
+            auto const isOverrun = i > 0 && BlockTimingMonitor::binLimits[i - 1] >= 1.0f;
+            g.setColour(isOverrun ? Colours::red : findColour(PlugDataColour::levelMeterActiveColourId));
+            g.fillRect(barBounds.removeFromBottom(barBounds.getHeight() * fraction));
+
+            auto const label = i < BlockTimingMonitor::numBins - 1 ? String(roundToInt(BlockTimingMonitor::binLimits[i] * 100.0f)) : String(">");
+            g.setColour(findColour(PlugDataColour::popupMenuTextColourId).withAlpha(0.6f));
+            g.setFont(labelFont);
+            g.drawText(label, Rectangle<float>(graphBounds.getX() + i * barWidth, graphBounds.getBottom(), barWidth, 12.0f), Justification::centred);
+        }
+
+        bounds.removeFromTop(14);
+
+        auto const numOverruns = timing.getNumOverruns();
+        String summary = String(numOverruns) + " of " + String(timing.getNumBlocks()) + " blocks late, worst " + String(roundToInt(timing.getWorstBlockLoad() * 100.0f)) + "%";
+
+        StringArray stageSummary;
+        for (int i = 0; i < BlockTimingMonitor::NumStages; i++) {
+            auto const stage = static_cast<BlockTimingMonitor::Stage>(i);
+            stageSummary.add(String(BlockTimingMonitor::stageNames[i]) + ": " + String(timing.getWorstStageMs(stage), 2) + "ms" + (numOverruns ? " (" + String(timing.getNumOverruns(stage)) + ")" : String()));
+        }
+
+        g.setColour(findColour(PlugDataColour::popupMenuTextColourId));
+        g.setFont(Fonts::getDefaultFont().withHeight(12.0f));
+        g.drawText(summary, bounds.removeFromTop(16), Justification::centredLeft);
+
+        g.setFont(Fonts::getDefaultFont().withHeight(11.0f));
+        g.drawText(stageSummary[0] + "  " + stageSummary[1], bounds.removeFromTop(14), Justification::centredLeft);
+        g.drawText(stageSummary[2] + "  " + stageSummary[3], bounds.removeFromTop(14), Justification::centredLeft);
+    }
+
+private:
+    BlockTimingMonitor& timing;
+};
+
+// The patches and subpatches that take the most DSP time
+// The profiler measures every object while this is showing, and adds them up per patch
+class DSPConsumerList : public Component
+    , public ChangeListener {
+public:
+    static constexpr int maxRows = 5;
+    static constexpr int rowHeight = 18;
+
+    explicit DSPConsumerList(pd::DSPProfiler& dspProfiler)
+        : profiler(dspProfiler)
+    {
+        profiler.addChangeListener(this);
+        profiler.setProfilingWanted(this, true);
+    }
+
+    ~DSPConsumerList() override
+    {
+        profiler.removeChangeListener(this);
+        profiler.setProfilingWanted(this, false);
+    }
+
+    void changeListenerCallback(ChangeBroadcaster*) override
+    {
+        repaint();
+    }
+
+    void paint(Graphics& g) override
+    {
+        auto const& loads = profiler.getCanvasLoads();
+        auto const textColour = findColour(PlugDataColour::popupMenuTextColourId);
+        auto bounds = getLocalBounds().reduced(8, 0);
+
+        if (loads.empty()) {
+            Fonts::drawText(g, "Measuring...", bounds.removeFromTop(rowHeight), textColour.withAlpha(0.5f), 13);
+            return;
+        }
+
+        for (int i = 0; i < std::min<int>(maxRows, loads.size()); i++) {
+            auto const& entry = loads[i];
+            auto row = bounds.removeFromTop(rowHeight);
+            Fonts::drawText(g, String(roundToInt(entry.load * 100.0f)) + "%", row.removeFromRight(36), textColour, 13, Justification::centredRight);
+            Fonts::drawFittedText(g, entry.name, row, entry.isTopLevel ? textColour : textColour.withAlpha(0.75f), 1, 0.8f, 13.0f);
+        }
+    }
+
+private:
+    pd::DSPProfiler& profiler;
+};
+
+// Every plugdata instance in this process, with the ones that use the most time first
+// In a DAW session, this shows which track's instance is the hog without opening every editor
+class ProcessMetricsList : public Component
+    , public Timer {
+public:
+    static constexpr int maxRows = 5;
+    static constexpr int rowHeight = 30;
+
+    ProcessMetricsList()
+    {
+        timerCallback();
+        startTimer(1000);
+    }
+
+    void timerCallback() override
+    {
+        auto const lastHeight = getTotalHeight();
+        snapshots = metrics->getSnapshots();
+        std::sort(snapshots.begin(), snapshots.end(), [](auto const& a, auto const& b) {
+            return a.cpuLoad > b.cpuLoad;
+        });
+
+        if (getTotalHeight() != lastHeight && onHeightChanged)
+            onHeightChanged();
+
+        repaint();
+    }
+
+    void paint(Graphics& g) override
+    {
+        auto const textColour = findColour(PlugDataColour::popupMenuTextColourId);
+        auto bounds = getLocalBounds().reduced(8, 0);
+
+        for (int i = 0; i < std::min<int>(maxRows, snapshots.size()); i++) {
+            auto const& snapshot = snapshots[i];
+            auto row = bounds.removeFromTop(rowHeight);
+            auto top = row.removeFromTop(16);
+
+            Fonts::drawText(g, String(roundToInt(snapshot.cpuLoad)) + "%", top.removeFromRight(36), textColour, 13, Justification::centredRight);
+            if (snapshot.numOverruns > 0)
+                Fonts::drawText(g, String(snapshot.numOverruns) + " late", top.removeFromRight(48), Colours::red, 12, Justification::centredRight);
+            Fonts::drawFittedText(g, snapshot.name, top, textColour, 1, 0.8f, 13.0f);
+
+            auto details = String(snapshot.numPatches) + (snapshot.numPatches == 1 ? " patch, " : " patches, ") + File::descriptionOfSizeInBytes(static_cast<int64>(snapshot.pdMemory))
+                + ", queued " + String(static_cast<int64>(snapshot.functionQueueDepth + snapshot.guiQueueDepth + snapshot.dispatcherQueueDepth));
+            Fonts::drawFittedText(g, details, row, textColour.withAlpha(0.6f), 1, 0.8f, 11.0f);
+        }
+
+        if (snapshots.size() > maxRows)
+            Fonts::drawText(g, String(static_cast<int>(snapshots.size()) - maxRows) + " more", bounds.removeFromTop(16), textColour.withAlpha(0.5f), 12);
+    }
+
+    int getTotalHeight() const
+    {
+        return std::min<int>(maxRows, snapshots.size()) * rowHeight + (snapshots.size() > maxRows ? 16 : 0);
+    }
+
+    // Instances can be opened or closed while the list is showing
+    std::function<void()> onHeightChanged;
+
+private:
+    SharedResourcePointer<ProcessMetrics> metrics;
+    std::vector<ProcessMetrics::Snapshot> snapshots;
+};
+
 class CPUMeterPopup : public Component {
 public:
-    CPUMeterPopup(CircularBuffer<float>& history, CircularBuffer<float>& longHistory)
+    CPUMeterPopup(CircularBuffer<float>& history, CircularBuffer<float>& longHistory, BlockTimingMonitor& blockTiming, pd::DSPProfiler& profiler)
+        : blockTimingDisplay(blockTiming)
+        , consumerList(profiler)
     {
         cpuGraph = std::make_unique<CPUHistoryGraph>(history, 200);
         cpuGraphLongHistory = std::make_unique<CPUHistoryGraph>(longHistory, 300);
@@ -461,6 +653,29 @@ public:
         slowGraphTitle.setJustificationType(Justification::centred);
         addAndMakeVisible(slowGraphTitle);
 
+        blockTimingTitle.setText("Block timing", dontSendNotification);
+        blockTimingTitle.setFont(Fonts::getBoldFont().withHeight(14.0f));
+        blockTimingTitle.setJustificationType(Justification::centred);
+        addAndMakeVisible(blockTimingTitle);
+
+        blockTimingDisplay.setTooltip("Time spent per audio block, as percentage of the time available. Double-click to reset");
+        addAndMakeVisible(blockTimingDisplay);
+
+        consumerTitle.setText("DSP time per patch", dontSendNotification);
+        consumerTitle.setFont(Fonts::getBoldFont().withHeight(14.0f));
+        consumerTitle.setJustificationType(Justification::centred);
+        addAndMakeVisible(consumerTitle);
+        addAndMakeVisible(consumerList);
+
+        instancesTitle.setText("All plugdata instances", dontSendNotification);
+        instancesTitle.setFont(Fonts::getBoldFont().withHeight(14.0f));
+        instancesTitle.setJustificationType(Justification::centred);
+        addAndMakeVisible(instancesTitle);
+        addAndMakeVisible(instancesList);
+        instancesList.onHeightChanged = [this] {
+            updateSize();
+        };
+
         linear.setConnectedEdges(TextButton::ConnectedEdgeFlags::ConnectedOnRight);
         logA.setConnectedEdges(TextButton::ConnectedEdgeFlags::ConnectedOnLeft | TextButton::ConnectedEdgeFlags::ConnectedOnRight);
         logB.setConnectedEdges(TextButton::ConnectedEdgeFlags::ConnectedOnLeft);
@@ -489,7 +704,7 @@ public:
         auto currentMappingMode = SettingsFile::getInstance()->getPropertyAsValue("cpu_meter_mapping_mode").getValue();
         buttons[currentMappingMode]->setToggleState(true, dontSendNotification);
 
-        setSize(212, 177);
+        updateSize();
     }
 
     ~CPUMeterPopup() override
@@ -509,6 +724,15 @@ public:
         linear.setBounds(b.removeFromLeft(buttonWidth));
         logA.setBounds(b.removeFromLeft(buttonWidth).expanded(1, 0));
         logB.setBounds(b.removeFromLeft(buttonWidth).expanded(1, 0));
+
+        blockTimingTitle.setBounds(0, b.getBottom() + 6, getWidth(), 20);
+        blockTimingDisplay.setBounds(0, blockTimingTitle.getBottom(), getWidth(), 88);
+
+        consumerTitle.setBounds(0, blockTimingDisplay.getBottom() + 6, getWidth(), 20);
+        consumerList.setBounds(0, consumerTitle.getBottom(), getWidth(), DSPConsumerList::maxRows * DSPConsumerList::rowHeight);
+
+        instancesTitle.setBounds(0, consumerList.getBottom() + 6, getWidth(), 20);
+        instancesList.setBounds(0, instancesTitle.getBottom(), getWidth(), instancesList.getTotalHeight());
     }
 
     std::function<void()> getUpdateFunc()
@@ -528,6 +752,11 @@ public:
     std::function<void()> onClose = []() {};
 
 private:
+    void updateSize()
+    {
+        setSize(212, 285 + 26 + DSPConsumerList::maxRows * DSPConsumerList::rowHeight + 26 + instancesList.getTotalHeight());
+    }
+
     void update()
     {
         cpuGraph->repaint();
@@ -540,8 +769,14 @@ private:
 
     Label fastGraphTitle;
     Label slowGraphTitle;
+    Label blockTimingTitle;
     std::unique_ptr<CPUHistoryGraph> cpuGraph;
     std::unique_ptr<CPUHistoryGraph> cpuGraphLongHistory;
+    BlockTimingDisplay blockTimingDisplay;
+    Label consumerTitle;
+    DSPConsumerList consumerList;
+    Label instancesTitle;
+    ProcessMetricsList instancesList;
 
     TextButton linear = TextButton("Linear");
     TextButton logA = TextButton("Log A");
@@ -600,7 +835,8 @@ public:
     void mouseUp(MouseEvent const& e) override
     {
         if (!isCallOutBoxActive) {
-            auto cpuHistory = std::make_unique<CPUMeterPopup>(cpuUsage, cpuUsageLongHistory);
+            auto* editor = findParentComponentOfClass<PluginEditor>();
+            auto cpuHistory = std::make_unique<CPUMeterPopup>(cpuUsage, cpuUsageLongHistory, editor->pd->statusbarSource->blockTiming, *editor->pd->dspProfiler);
             updateCPUGraph = cpuHistory->getUpdateFunc();
             updateCPUGraphLong = cpuHistory->getUpdateFuncLongHistory();
 
@@ -610,7 +846,6 @@ public:
                 repaint();
             };
 
-            auto* editor = findParentComponentOfClass<PluginEditor>();
             currentCalloutBox = &editor->showCalloutBox(std::move(cpuHistory), getScreenBounds());
             isCallOutBoxActive = true;
         } else {
@@ -966,6 +1201,15 @@ void Statusbar::audioProcessedChanged(bool audioProcessed)
     powerButton.setColour(TextButton::textColourOnId, colour);
 }
 
+void Statusbar::nonFiniteSamplesScrubbed(int numSamples)
+{
+    // Repeated identical messages get grouped by the console, so this won't flood it
+    pd->logWarning("Protected mode removed NaN/Inf samples from the output");
+
+    totalScrubbedSamples += numSamples;
+    limiterButton.setTooltip("Turn off limiter (" + String(totalScrubbedSamples) + " NaN/Inf samples removed)");
+}
+
 void Statusbar::lookAndFeelChanged()
 {
     limiterButton.setColour(ComboBox::outlineColourId, Colours::transparentBlack);
@@ -1028,7 +1272,21 @@ void StatusbarSource::process(bool hasMidiInput, bool hasMidiOutput, int channel
 
 void StatusbarSource::prepareToPlay(int nChannels)
 {
-    peakBuffer.reset(sampleRate, bufferSize, nChannels);
+    numChannels = nChannels;
+    for (auto& level : peakLevels)
+        level.store(0.0f, std::memory_order_relaxed);
+}
+
+void StatusbarSource::updatePeak(AudioBuffer<float> const& buffer, int numSamples)
+{
+    for (int ch = 0; ch < std::min<int>(buffer.getNumChannels(), peakLevels.size()); ch++) {
+        auto const range = FloatVectorOperations::findMinAndMax(buffer.getReadPointer(ch), numSamples);
+        auto const peak = std::max(-range.getStart(), range.getEnd());
+
+        // Only the audio thread raises it, so we don't mind the timer resetting it in between
+        if (peak > peakLevels[ch].load(std::memory_order_relaxed))
+            peakLevels[ch].store(peak, std::memory_order_relaxed);
+    }
 }
 
 void StatusbarSource::timerCallback()
@@ -1055,12 +1313,19 @@ void StatusbarSource::timerCallback()
             listener->audioProcessedChanged(hasProcessedAudio);
     }
 
-    auto peak = peakBuffer.getPeak();
+    Array<float> peak;
+    for (int ch = 0; ch < std::min<int>(numChannels, peakLevels.size()); ch++)
+        peak.add(std::sqrt(peakLevels[ch].exchange(0.0f, std::memory_order_relaxed)));
 
     for (auto* listener : listeners) {
         listener->audioLevelChanged(peak);
         listener->cpuUsageChanged(cpuUsage.load(std::memory_order_relaxed));
     }
+
+    if (auto scrubbed = numScrubbedSamples.exchange(0, std::memory_order_relaxed)) {
+        for (auto* listener : listeners)
+            listener->nonFiniteSamplesScrubbed(scrubbed);
+    }
 }
 
 void StatusbarSource::addListener(Listener* l)
@@ -1077,3 +1342,8 @@ void StatusbarSource::setCPUUsage(float cpu)
 {
     cpuUsage.store(cpu, std::memory_order_relaxed);
 }
+
+void StatusbarSource::addScrubbedSamples(int numSamples)
+{
+    numScrubbedSamples.fetch_add(numSamples, std::memory_order_relaxed);
+}
@@ -10,7 +10,7 @@
 #include "LookAndFeel.h"
 #include "Utility/SettingsFile.h"
 #include "Utility/ModifierKeyListener.h"
-#include "Utility/AudioSampleRingBuffer.h"
+#include "Utility/BlockTimingMonitor.h"
 #include "Components/Buttons.h"
 
 class Canvas;
@@ -30,6 +30,7 @@ public:
         virtual void audioProcessedChanged(bool audioProcessed) { ignoreUnused(audioProcessed); }
         virtual void audioLevelChanged(Array<float> peak) { ignoreUnused(peak); }
         virtual void cpuUsageChanged(float newCpuUsage) { ignoreUnused(newCpuUsage); }
+        virtual void nonFiniteSamplesScrubbed(int numSamples) { ignoreUnused(numSamples); }
         virtual void timerCallback() { }
     };
 
@@ -49,16 +50,24 @@ public:
     void removeListener(Listener* l);
 
     void setCPUUsage(float cpuUsage);
+    void addScrubbedSamples(int numSamples);
 
-    AudioSampleRingBuffer peakBuffer;
+    // Called on the audio thread after the gain stage, keeps the highest peak of the meter's channels until the timer picks it up
+    void updatePeak(AudioBuffer<float> const& buffer, int numSamples);
+
+    BlockTimingMonitor blockTiming;
 
 private:
     std::atomic<int> lastMidiReceivedTime = 0;
     std::atomic<int> lastMidiSentTime = 0;
     std::atomic<int> lastAudioProcessedTime = 0;
     std::atomic<float> cpuUsage;
+    std::atomic<int> numScrubbedSamples = 0;
+
+    // The level meter only shows the first two channels
+    std::array<std::atomic<float>, 2> peakLevels = { 0.0f, 0.0f };
 
-    int numChannels;
+    int numChannels = 0;
     int bufferSize;
 
     double sampleRate = 44100;
@@ -88,6 +97,7 @@ public:
     void lookAndFeelChanged() override;
 
     void audioProcessedChanged(bool audioProcessed) override;
+    void nonFiniteSamplesScrubbed(int numSamples) override;
 
     void setLatencyDisplay(int value);
     void updateZoomLevel();
@@ -111,6 +121,7 @@ private:
     SmallIconButton snapEnableButton, snapSettingsButton;
     SmallIconButton powerButton, audioSettingsButton;
 
+    int64 totalScrubbedSamples = 0;
     TextButton limiterButton = TextButton("Limit");
 
     std::unique_ptr<LatencyDisplayButton> latencyDisplayButton;
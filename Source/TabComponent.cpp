@@ -29,6 +29,7 @@ TabComponent::TabComponent(PluginEditor* editor)
     }
 
     addMouseListener(this, true);
+    startTimer(60000);
     
     // Dequeue messages to "pd" symbol to make sure the "pluginmode" message always arrives earlier than the tab update.
     // Without this, FL Studio (and possibly others) will fail to init the pluginmode theme!
@@ -52,7 +53,7 @@ Canvas* TabComponent::openPatch(const URL& path)
     auto patchFile = path.getLocalFile();
 
     {
-        ScopedLock lock(pd->patches.getLock());
+        LockProfiler::ScopedLock lock(pd->patches.getLock(), LockProfiler::PatchesLock);
         for (auto& patch : pd->patches) {
             if (patch->getCurrentFile() == patchFile) {
                 pd->logError("Patch is already open");
@@ -315,6 +316,29 @@ void TabComponent::clearCanvases()
     }
 }
 
+void TabComponent::timerCallback()
+{
+    auto const now = Time::getMillisecondCounter();
+
+    std::unordered_map<Canvas*, uint32> newLastShownTimes;
+    for (auto* cnv : canvases) {
+        if (cnv == splits[0] || cnv == splits[1]) {
+            newLastShownTimes[cnv] = now;
+            continue;
+        }
+
+        auto it = lastShownTimes.find(cnv);
+        auto const lastShown = it != lastShownTimes.end() ? it->second : now;
+        newLastShownTimes[cnv] = lastShown;
+
+        if (now - lastShown > hibernateAfterMinutes * 60000u)
+            cnv->hibernate();
+    }
+
+    // Closed tabs drop out here
+    lastShownTimes = std::move(newLastShownTimes);
+}
+
 void TabComponent::handleAsyncUpdate()
 {
     pd->setThis();
@@ -360,7 +384,7 @@ void TabComponent::handleAsyncUpdate()
     for (int i = canvases.size() - 1; i >= 0; i--) {
         bool exists = false;
         {
-            ScopedLock lock(pd->patches.getLock());
+            LockProfiler::ScopedLock lock(pd->patches.getLock(), LockProfiler::PatchesLock);
             for (auto& patch : pd->patches) {
                 if (canvases[i]->patch == *patch && canvases[i]->patch.windowIndex == editorIndex) {
                     exists = true;
@@ -375,7 +399,7 @@ void TabComponent::handleAsyncUpdate()
 
     // Load all patches from pd patch array
     {
-        ScopedLock lock(pd->patches.getLock());
+        LockProfiler::ScopedLock lock(pd->patches.getLock(), LockProfiler::PatchesLock);
         for (auto& patch : pd->patches) {
             if (patch->windowIndex != editorIndex)
                 continue;
@@ -659,6 +683,9 @@ void TabComponent::resized()
     // use the active canvas viewports dimensions (the one that is assigned to the split) for resizing each canvas
     for (int i = 0; i < splits.size(); i++) {
         if (splits[i]) {
+            splits[i]->wakeUp();
+            lastShownTimes[splits[i]] = Time::getMillisecondCounter();
+
             auto splitBounds = bounds.removeFromLeft((isSplit && splits[i] == splits[0]) ? (splitSize - 3) : getWidth());
             for (auto* tab : tabbars[i]) {
                 if (auto canvas = tab->cnv) {
@@ -903,7 +930,7 @@ void TabComponent::saveTabPositions()
         return a.second < b.second;
     });
 
-    pd->patches.getLock().enter();
+    LockProfiler::enter(pd->patches.getLock(), LockProfiler::PatchesLock);
     int i = 0;
     for (auto& [patch, tabIdx] : sortedPatches) {
 
@@ -913,7 +940,7 @@ void TabComponent::saveTabPositions()
         pd->patches.set(i, patch);
         i++;
     }
-    pd->patches.getLock().exit();
+    LockProfiler::exit(pd->patches.getLock(), LockProfiler::PatchesLock);
 }
 
 void TabComponent::itemDragMove(SourceDetails const& dragSourceDetails)
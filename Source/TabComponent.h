@@ -6,7 +6,8 @@
 class PluginMode;
 class TabComponent : public Component
     , public DragAndDropTarget
-    , public AsyncUpdater {
+    , public AsyncUpdater
+    , public Timer {
     class TabBarButtonComponent;
 
 public:
@@ -47,6 +48,9 @@ private:
     void clearCanvases();
     void handleAsyncUpdate() override;
 
+    // Hibernates tabs that weren't shown for a while, so that lots of open patches don't keep all their objects around
+    void timerCallback() override;
+
     void sendTabUpdateToVisibleCanvases();
 
     void resized() override;
@@ -331,6 +335,9 @@ private:
 
     OwnedArray<Canvas, CriticalSection> canvases;
 
+    static constexpr int hibernateAfterMinutes = 10;
+    std::unordered_map<Canvas*, uint32> lastShownTimes;
+
     PluginEditor* editor;
     PluginProcessor* pd;
 };
@@ -20,6 +20,9 @@ public:
         fifo.setTotalSize(maxSize + 1);
         audioBuffer.setSize(channels, maxSize + 1);
 
+        // Preallocate the MIDI storage here, so reading and writing never has to allocate
+        midiData.resize(std::max<size_t>(minMidiStorageSize, static_cast<size_t>(maxSize) * 16));
+
         clear();
     }
 
@@ -27,7 +30,11 @@ public:
     {
         fifo.reset();
         audioBuffer.clear();
-        midiBuffer.clear();
+
+        midiReadPosition = 0;
+        midiWritePosition = 0;
+        samplesWritten = 0;
+        samplesRead = 0;
     }
 
     int getNumSamplesAvailable() { return fifo.getNumReady(); }
@@ -38,7 +45,7 @@ public:
         jassert(getNumSamplesFree() >= audioSrc.getNumSamples());
         jassert(audioSrc.getNumChannels() == audioBuffer.getNumChannels());
 
-        midiBuffer.addEvents(midiSrc, 0, audioSrc.getNumSamples(), fifo.getNumReady());
+        writeMidi(midiSrc, static_cast<int>(audioSrc.getNumSamples()));
 
         int start1, size1, start2, size2;
         fifo.prepareToWrite(audioSrc.getNumSamples(), start1, size1, start2, size2);
@@ -49,6 +56,7 @@ public:
             audioSrc.copyTo(audioBuffer, size1, start2, size2);
 
         fifo.finishedWrite(size1 + size2);
+        samplesWritten += size1 + size2;
     }
 
     void readAudioAndMidi(dsp::AudioBlock<float>& audioDst, MidiBuffer& midiDst)
@@ -56,12 +64,7 @@ public:
         jassert(getNumSamplesAvailable() >= audioDst.getNumSamples());
         jassert(audioDst.getNumChannels() == audioBuffer.getNumChannels());
 
-        midiDst.addEvents(midiBuffer, 0, audioDst.getNumSamples(), 0);
-
-        // Move all the remaining midi events forward by the number of samples removed
-        MidiBuffer temp;
-        temp.addEvents(midiBuffer, audioDst.getNumSamples(), fifo.getNumReady(), -audioDst.getNumSamples());
-        midiBuffer = temp;
+        readMidi(midiDst, static_cast<int>(audioDst.getNumSamples()));
 
         int start1, size1, start2, size2;
         fifo.prepareToRead(audioDst.getNumSamples(), start1, size1, start2, size2);
@@ -72,6 +75,7 @@ public:
             audioDst.copyFrom(audioBuffer, start2, size1, size2);
 
         fifo.finishedRead(size1 + size2);
+        samplesRead += size1 + size2;
     }
 
     void writeSilence(int numSamples)
@@ -87,6 +91,7 @@ public:
             audioBuffer.clear(start2, size2);
 
         fifo.finishedWrite(size1 + size2);
+        samplesWritten += size1 + size2;
     }
 
     void writeAudioAndMidi(juce::AudioBuffer<float> const& audioSrc, juce::MidiBuffer const& midiSrc)
@@ -94,7 +99,7 @@ public:
         jassert(getNumSamplesFree() >= audioSrc.getNumSamples());
         jassert(audioSrc.getNumChannels() == audioBuffer.getNumChannels());
 
-        midiBuffer.addEvents(midiSrc, 0, audioSrc.getNumSamples(), fifo.getNumReady());
+        writeMidi(midiSrc, static_cast<int>(audioSrc.getNumSamples()));
 
         int start1, size1, start2, size2;
         fifo.prepareToWrite(audioSrc.getNumSamples(), start1, size1, start2, size2);
@@ -108,6 +113,7 @@ public:
         }
 
         fifo.finishedWrite(size1 + size2);
+        samplesWritten += size1 + size2;
     }
 
     void readAudioAndMidi(juce::AudioBuffer<float>& audioDst, juce::MidiBuffer& midiDst)
@@ -115,12 +121,7 @@ public:
         jassert(getNumSamplesAvailable() >= audioDst.getNumSamples());
         jassert(audioDst.getNumChannels() == audioBuffer.getNumChannels());
 
-        midiDst.addEvents(midiBuffer, 0, audioDst.getNumSamples(), 0);
-
-        // Move all the remaining midi events forward by the number of samples removed
-        juce::MidiBuffer temp;
-        temp.addEvents(midiBuffer, audioDst.getNumSamples(), fifo.getNumReady(), -audioDst.getNumSamples());
-        midiBuffer = temp;
+        readMidi(midiDst, audioDst.getNumSamples());
 
         int start1, size1, start2, size2;
         fifo.prepareToRead(audioDst.getNumSamples(), start1, size1, start2, size2);
@@ -134,12 +135,79 @@ public:
         }
 
         fifo.finishedRead(size1 + size2);
+        samplesRead += size1 + size2;
     }
 
 private:
+    // Events are stored back-to-back as [timestamp][size][data], with the timestamp counted from the start of the stream
+    // That way, reading doesn't have to move the remaining events forward, we only advance the read position
+    void writeMidi(MidiBuffer const& midiSrc, int numSamples)
+    {
+        for (auto const event : midiSrc) {
+            if (event.samplePosition >= numSamples)
+                break;
+
+            auto const eventSize = static_cast<size_t>(event.numBytes);
+            auto const requiredSpace = midiHeaderSize + eventSize;
+
+            if (midiWritePosition + requiredSpace > midiData.size()) {
+                // Move the unread events to the front, to make room at the end
+                auto const numUnread = midiWritePosition - midiReadPosition;
+                std::memmove(midiData.data(), midiData.data() + midiReadPosition, numUnread);
+                midiReadPosition = 0;
+                midiWritePosition = numUnread;
+
+                if (midiWritePosition + requiredSpace > midiData.size()) {
+                    jassertfalse; // MIDI storage full, event will be dropped
+                    continue;
+                }
+            }
+
+            int64 const timestamp = samplesWritten + event.samplePosition;
+            auto const size = static_cast<int32>(eventSize);
+            auto* dest = midiData.data() + midiWritePosition;
+            std::memcpy(dest, &timestamp, sizeof(int64));
+            std::memcpy(dest + sizeof(int64), &size, sizeof(int32));
+            std::memcpy(dest + midiHeaderSize, event.data, eventSize);
+            midiWritePosition += requiredSpace;
+        }
+    }
+
+    void readMidi(MidiBuffer& midiDst, int numSamples)
+    {
+        auto const readEnd = samplesRead + numSamples;
+
+        while (midiReadPosition < midiWritePosition) {
+            int64 timestamp;
+            int32 size;
+            auto const* src = midiData.data() + midiReadPosition;
+            std::memcpy(&timestamp, src, sizeof(int64));
+
+            if (timestamp >= readEnd)
+                break;
+
+            std::memcpy(&size, src + sizeof(int64), sizeof(int32));
+            midiDst.addEvent(src + midiHeaderSize, size, static_cast<int>(std::max<int64>(0, timestamp - samplesRead)));
+            midiReadPosition += midiHeaderSize + static_cast<size_t>(size);
+        }
+
+        if (midiReadPosition == midiWritePosition) {
+            midiReadPosition = 0;
+            midiWritePosition = 0;
+        }
+    }
+
+    static constexpr size_t midiHeaderSize = sizeof(int64) + sizeof(int32);
+    static constexpr size_t minMidiStorageSize = 8192;
+
     AbstractFifo fifo { 1 };
     AudioBuffer<float> audioBuffer;
-    MidiBuffer midiBuffer;
+
+    std::vector<uint8> midiData;
+    size_t midiReadPosition = 0;
+    size_t midiWritePosition = 0;
+    int64 samplesWritten = 0;
+    int64 samplesRead = 0;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AudioMidiFifo)
 };
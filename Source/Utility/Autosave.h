@@ -7,6 +7,7 @@ class Autosave : public Timer
     , public AsyncUpdater
     , public Value::Listener {
 
+    // The index of autosaved patches, the patches themselves are in their journals
     static inline File const autoSaveFile = ProjectInfo::appDataDir.getChildFile(".autosave");
     static inline ValueTree autoSaveTree = ValueTree("Autosave");
     Value autosaveInterval;
@@ -15,6 +16,35 @@ class Autosave : public Timer
     PluginProcessor* pd;
     moodycamel::ReaderWriterQueue<std::pair<String, String>> autoSaveQueue;
 
+    // Every patch has a journal: a snapshot of the patch, followed by a record of the lines that changed for every autosave after that
+    // Journals are written on a background thread, and compacted into a single snapshot again every so often
+    // After a crash, we replay the journal up to the last record that was written completely
+    static inline File const journalDirectory = ProjectInfo::appDataDir.getChildFile("Autosave");
+    static constexpr int journalMagic = 0x504A4E4C;
+    static constexpr int maxJournalChanges = 64;
+
+    enum RecordType {
+        SnapshotRecord = 0,
+        ChangeRecord
+    };
+
+    struct JournalWrite {
+        String path;
+        String content;
+        bool remove = false;
+    };
+
+    // Only used by the writer thread
+    struct JournalState {
+        StringArray lines;
+        int64 journalSize = 0;
+        int numChanges = 0;
+    };
+
+    moodycamel::ReaderWriterQueue<JournalWrite> journalQueue;
+    std::map<String, JournalState> journalStates;
+    ThreadPool journalWriter { 1 };
+
 public:
     Autosave(PluginProcessor* procesor)
         : pd(procesor)
@@ -29,6 +59,14 @@ public:
                 autoSaveTree = ValueTree("Autosave");
         }
 
+        // Autosaves from before we had journals store the whole patch in the index
+        for (auto autoSave : autoSaveTree) {
+            if (autoSave.hasProperty("Patch")) {
+                writeJournal({ autoSave.getProperty("Path").toString(), decodePatch(autoSave.getProperty("Patch").toString()) });
+                autoSave.removeProperty("Patch", nullptr);
+            }
+        }
+
         autosaveEnabled.referTo(SettingsFile::getInstance()->getPropertyAsValue("autosave_enabled"));
 
         // autosave timer trigger
@@ -37,6 +75,13 @@ public:
         startTimer(1000 * std::max(getValue<int>(autosaveInterval), 15));
     }
 
+    ~Autosave() override
+    {
+        // Wait for the writer, and write whatever it didn't get to yet
+        journalWriter.removeAllJobs(false, -1);
+        writePendingJournals();
+    }
+
     // Call this whenever we load a file
     void checkForMoreRecentAutosave(File& patchPath, PluginEditor* editor, std::function<void()> callback)
     {
@@ -47,12 +92,11 @@ public:
             auto timeDescription = RelativeTime((autoSavedTime - fileChangedTime) / 1000.0f).getApproximateDescription();
 
             Dialogs::showOkayCancelDialog(
-                &editor->openedDialog, editor, "Restore autosave?\n (last autosave is " + timeDescription + " newer)", [lastAutoSavedPatch, patchPath, callback](bool useAutosaved) {
+                &editor->openedDialog, editor, "Restore autosave?\n (last autosave is " + timeDescription + " newer)", [patchPath, callback](bool useAutosaved) {
                     if (useAutosaved) {
-                        MemoryOutputStream ostream;
-                        Base64::convertFromBase64(ostream, lastAutoSavedPatch.getProperty("Patch").toString());
-                        auto autosavedPatch = String::fromUTF8((const char*)ostream.getData(), ostream.getDataSize());
-                        patchPath.replaceWithText(autosavedPatch);
+                        auto autosavedPatch = readJournal(getJournalFile(patchPath.getFullPathName()));
+                        if (autosavedPatch.isNotEmpty())
+                            patchPath.replaceWithText(autosavedPatch);
                         // TODO: instead of replacing, it would be better to load it as a string, (but also with the correct patch path)
                     }
 
@@ -84,6 +128,7 @@ private:
         });
     }
 
+    // Runs on the pd thread, only gets the contents of the dirty patches, everything else happens on the message and writer thread
     void save()
     {
         ScopedTryLock const stl(pd->patches.getLock());
@@ -133,12 +178,10 @@ private:
             auto existingPatch = autoSaveTree.getChildWithProperty("Path", path);
 
             if (existingPatch.isValid()) {
-                existingPatch.setProperty("Patch", Base64::toBase64(content), nullptr);
                 existingPatch.setProperty("LastModified", (int64)time, nullptr);
             } else {
                 ValueTree newAutoSave = ValueTree("Save");
                 newAutoSave.setProperty("Path", path, nullptr);
-                newAutoSave.setProperty("Patch", Base64::toBase64(content), nullptr);
                 newAutoSave.setProperty("LastModified", (int64)time, nullptr);
                 autoSaveTree.addChild(newAutoSave, 0, nullptr);
 
@@ -155,17 +198,184 @@ private:
                         currentIdx++;
                     }
                     if (oldestIdx >= 0) {
+                        journalQueue.enqueue({ autoSaveTree.getChild(oldestIdx).getProperty("Path").toString(), String(), true });
                         autoSaveTree.removeChild(oldestIdx, nullptr);
                     }
                 }
             }
+
+            journalQueue.enqueue({ path, content });
         }
 
+        // The destructor waits for the writer, so it can't outlive us
+        journalWriter.addJob([this]() {
+            writePendingJournals();
+        });
+
+        // The index only holds paths and times, so this is cheap to write
         autoSaveFile.replaceWithText("");
         FileOutputStream ostream(autoSaveFile);
         autoSaveTree.writeToStream(ostream);
     }
 
+    void writePendingJournals()
+    {
+        JournalWrite write;
+        while (journalQueue.try_dequeue(write)) {
+            writeJournal(write);
+        }
+    }
+
+    void writeJournal(JournalWrite const& write)
+    {
+        auto const journalFile = getJournalFile(write.path);
+
+        if (write.remove) {
+            journalFile.deleteFile();
+            journalStates.erase(write.path);
+            return;
+        }
+
+        auto lines = splitLines(write.content);
+        auto& state = journalStates[write.path];
+
+        // Start over with a snapshot if the journal is new to us, was changed by another plugdata window, or has grown too long
+        if (state.journalSize == 0 || journalFile.getSize() != state.journalSize || state.numChanges >= maxJournalChanges) {
+            MemoryOutputStream record;
+            record.writeByte(SnapshotRecord);
+            record.writeString(write.content);
+
+            MemoryOutputStream journal;
+            journal.writeInt(journalMagic);
+            journal.writeInt(static_cast<int>(record.getDataSize()));
+            journal << record.getMemoryBlock();
+
+            // Replaced in one go, so a crash while compacting leaves the old journal intact
+            journalDirectory.createDirectory();
+            TemporaryFile tempFile(journalFile);
+            if (!tempFile.getFile().appendData(journal.getData(), journal.getDataSize()) || !tempFile.overwriteTargetFileWithTemporary()) {
+                journalStates.erase(write.path);
+                return;
+            }
+
+            state.journalSize = static_cast<int64>(journal.getDataSize());
+            state.numChanges = 0;
+            state.lines = std::move(lines);
+            return;
+        }
+
+        // Only store the lines between the parts that stayed the same
+        auto const& oldLines = state.lines;
+        int prefix = 0;
+        while (prefix < oldLines.size() && prefix < lines.size() && oldLines[prefix] == lines[prefix])
+            prefix++;
+
+        int suffix = 0;
+        while (suffix < oldLines.size() - prefix && suffix < lines.size() - prefix && oldLines[oldLines.size() - 1 - suffix] == lines[lines.size() - 1 - suffix])
+            suffix++;
+
+        auto const numRemoved = oldLines.size() - prefix - suffix;
+        auto const numInserted = lines.size() - prefix - suffix;
+        if (numRemoved == 0 && numInserted == 0)
+            return;
+
+        String inserted;
+        for (int i = prefix; i < prefix + numInserted; i++) {
+            inserted += lines[i];
+        }
+
+        MemoryOutputStream record;
+        record.writeByte(ChangeRecord);
+        record.writeCompressedInt(prefix);
+        record.writeCompressedInt(numRemoved);
+        record.writeString(inserted);
+
+        FileOutputStream journal(journalFile);
+        if (!journal.openedOk()) {
+            journalStates.erase(write.path);
+            return;
+        }
+
+        journal.writeInt(static_cast<int>(record.getDataSize()));
+        journal << record.getMemoryBlock();
+        journal.flush();
+
+        state.journalSize += 4 + static_cast<int64>(record.getDataSize());
+        state.numChanges++;
+        state.lines = std::move(lines);
+    }
+
+    static String readJournal(File const& journalFile)
+    {
+        FileInputStream journal(journalFile);
+        if (!journal.openedOk() || journal.readInt() != journalMagic)
+            return {};
+
+        StringArray lines;
+        while (journal.getNumBytesRemaining() >= 4) {
+            auto const size = journal.readInt();
+
+            // Anything after a record that wasn't written completely is lost, but everything before it is fine
+            if (size <= 0 || size > journal.getNumBytesRemaining())
+                break;
+
+            MemoryBlock recordData;
+            journal.readIntoMemoryBlock(recordData, size);
+            MemoryInputStream record(recordData, false);
+
+            auto const type = record.readByte();
+            if (type == SnapshotRecord) {
+                lines = splitLines(record.readString());
+            } else if (type == ChangeRecord) {
+                auto const start = record.readCompressedInt();
+                auto const numRemoved = record.readCompressedInt();
+                if (start < 0 || numRemoved < 0 || start + numRemoved > lines.size())
+                    break;
+
+                lines.removeRange(start, numRemoved);
+
+                auto const inserted = splitLines(record.readString());
+                for (int i = 0; i < inserted.size(); i++) {
+                    lines.insert(start + i, inserted[i]);
+                }
+            } else {
+                break;
+            }
+        }
+
+        return lines.joinIntoString("");
+    }
+
+    // Splits after every newline, so joining the lines gives back the exact same text
+    static StringArray splitLines(String const& text)
+    {
+        StringArray lines;
+        auto lineStart = text.getCharPointer();
+        auto t = lineStart;
+        while (!t.isEmpty()) {
+            if (t.getAndAdvance() == '\n') {
+                lines.add(String(lineStart, t));
+                lineStart = t;
+            }
+        }
+        if (lineStart != t)
+            lines.add(String(lineStart, t));
+
+        return lines;
+    }
+
+    static File getJournalFile(String const& path)
+    {
+        return journalDirectory.getChildFile(String::toHexString(path.hashCode64()) + ".journal");
+    }
+
+    static String decodePatch(String const& base64)
+    {
+        MemoryOutputStream ostream;
+        Base64::convertFromBase64(ostream, base64);
+        return String::fromUTF8(static_cast<char const*>(ostream.getData()), ostream.getDataSize());
+    }
+
     friend class AutosaveHistoryComponent;
     JUCE_DECLARE_WEAK_REFERENCEABLE(Autosave);
 };
@@ -175,7 +385,6 @@ class AutosaveHistoryComponent : public Component {
         AutoSaveHistory(PluginEditor* editor, ValueTree autoSaveTree)
         {
             patchPath = autoSaveTree.getProperty("Path").toString();
-            patch = autoSaveTree.getProperty("Patch").toString();
 
             addAndMakeVisible(openPatch);
 
@@ -184,9 +393,13 @@ class AutosaveHistoryComponent : public Component {
             openPatch.setColour(TextButton::buttonOnColourId, backgroundColour.contrasting(0.1f));
             openPatch.setColour(ComboBox::outlineColourId, Colours::transparentBlack);
             openPatch.onClick = [this, editor]() {
-                MemoryOutputStream ostream;
-                Base64::convertFromBase64(ostream, patch);
-                auto patch = editor->pd->loadPatch(String::fromUTF8(static_cast<const char*>(ostream.getData()), ostream.getDataSize()));
+                auto const patchContent = Autosave::readJournal(Autosave::getJournalFile(patchPath));
+                if (patchContent.isEmpty()) {
+                    editor->pd->logError("Could not read the autosave of " + patchPath);
+                    return;
+                }
+
+                auto patch = editor->pd->loadPatch(patchContent);
                 patch->setTitle(patchPath.fromLastOccurrenceOf("/", false, false));
                 patch->setCurrentFile(URL(patchPath));
                 editor->getTabComponent().triggerAsyncUpdate();
@@ -229,7 +442,6 @@ class AutosaveHistoryComponent : public Component {
         }
 
         String patchPath;
-        String patch;
         TextButton openPatch = TextButton("Open");
     };
 
@@ -0,0 +1,184 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include "TraceRecorder.h"
+
+// One set of worker threads for the background work of every plugdata instance in this process
+// Components used to keep a thread pool each, so with many instances we'd have lots of threads that are idle most of the time
+// Jobs are submitted through a TaskGroup, which is what you cancel or wait for, much like a ThreadPool of your own
+// Higher priority jobs go first, jobs with the same priority run in the order they were added
+// Every job shows up in the trace with the name it was added with
+class BackgroundTasks {
+public:
+    enum Priority {
+        High, // The user is waiting for it, like search results
+        Normal,
+        Low // Nobody is waiting for it, like indexing or cleaning up
+    };
+
+private:
+    struct GroupState {
+        std::mutex mutex;
+        std::condition_variable finished;
+        uint64 generation = 0;
+        int numRunning = 0;
+    };
+
+public:
+    // All the jobs of one owner. Destroying the group cancels the jobs that didn't start yet, and waits for the running one
+    class TaskGroup {
+    public:
+        TaskGroup() = default;
+
+        ~TaskGroup()
+        {
+            cancelAndWait();
+        }
+
+        // The name has to be a string literal, it's used for tracing
+        void addJob(char const* name, std::function<void()> job, Priority priority = Normal)
+        {
+            uint64 generation;
+            {
+                std::lock_guard lock(state->mutex);
+                generation = state->generation;
+            }
+            tasks->submit({ name, std::move(job), state, generation }, priority);
+        }
+
+        // Jobs that didn't start yet won't run anymore, a job that is running right now finishes
+        void cancelPendingJobs()
+        {
+            std::lock_guard lock(state->mutex);
+            state->generation++;
+        }
+
+        // Like cancelPendingJobs, but also waits until the running job is done, after that no job of this group will touch its owner
+        void cancelAndWait()
+        {
+            std::unique_lock lock(state->mutex);
+            state->generation++;
+            state->finished.wait(lock, [this] { return state->numRunning == 0; });
+        }
+
+    private:
+        std::shared_ptr<GroupState> state = std::make_shared<GroupState>();
+        SharedResourcePointer<BackgroundTasks> tasks;
+
+        JUCE_DECLARE_NON_COPYABLE(TaskGroup)
+    };
+
+    BackgroundTasks()
+    {
+        // Enough to keep a slow job from holding up the rest, but few enough that background work never takes over the machine
+        auto const numWorkers = jlimit(2, 4, SystemStats::getNumCpus() / 2);
+        for (int i = 0; i < numWorkers; i++) {
+            workers.add(new Worker(*this))->startThread(Thread::Priority::low);
+        }
+    }
+
+    ~BackgroundTasks()
+    {
+        {
+            std::lock_guard lock(queueMutex);
+            shouldExit = true;
+        }
+        jobAdded.notify_all();
+
+        for (auto* worker : workers)
+            worker->stopThread(-1);
+    }
+
+    int getNumWorkers() const { return workers.size(); }
+
+private:
+    struct Job {
+        char const* name;
+        std::function<void()> function;
+        std::shared_ptr<GroupState> group;
+        uint64 generation;
+    };
+
+    struct Worker final : public Thread {
+        explicit Worker(BackgroundTasks& owner)
+            : Thread("Background Tasks")
+            , tasks(owner)
+        {
+        }
+
+        void run() override
+        {
+            while (true) {
+                Job job;
+                int numPending;
+                {
+                    std::unique_lock lock(tasks.queueMutex);
+                    tasks.jobAdded.wait(lock, [this] { return tasks.shouldExit || tasks.numQueued > 0; });
+                    if (tasks.shouldExit)
+                        return;
+
+                    for (auto& queue : tasks.queues) {
+                        if (!queue.empty()) {
+                            job = std::move(queue.front());
+                            queue.pop_front();
+                            break;
+                        }
+                    }
+                    numPending = --tasks.numQueued;
+                }
+
+                // Checked under the group's lock, so that cancelAndWait either sees this job running, or this job sees that it was cancelled
+                {
+                    std::lock_guard lock(job.group->mutex);
+                    if (job.group->generation != job.generation)
+                        continue;
+                    job.group->numRunning++;
+                }
+
+                {
+                    TraceRecorder::Scope trace(job.name);
+                    trace.setCount(numPending);
+                    job.function();
+                }
+
+                // Let go of whatever the job captured before its owner hears that it's done
+                job.function = nullptr;
+
+                {
+                    std::lock_guard lock(job.group->mutex);
+                    job.group->numRunning--;
+                }
+                job.group->finished.notify_all();
+            }
+        }
+
+        BackgroundTasks& tasks;
+    };
+
+    void submit(Job job, Priority priority)
+    {
+        {
+            std::lock_guard lock(queueMutex);
+            queues[priority].push_back(std::move(job));
+            numQueued++;
+        }
+        jobAdded.notify_one();
+    }
+
+    std::mutex queueMutex;
+    std::condition_variable jobAdded;
+    std::array<std::deque<Job>, 3> queues;
+    int numQueued = 0;
+    bool shouldExit = false;
+
+    OwnedArray<Worker> workers;
+};
@@ -0,0 +1,131 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <atomic>
+
+// Records how long each audio block took compared to its deadline, and which stage of processBlock took the most time
+// Written by the audio thread, read by the GUI: everything that's shared is a relaxed atomic, so neither side ever waits
+class BlockTimingMonitor {
+public:
+    enum Stage {
+        Playhead = 0,
+        Parameters,
+        DSP,
+        Messages,
+        NumStages
+    };
+
+    // Histogram bins, as fraction of the block deadline
+    static constexpr int numBins = 8;
+    static constexpr float binLimits[numBins - 1] = { 0.25f, 0.5f, 0.75f, 0.9f, 1.0f, 1.5f, 2.0f };
+
+    static constexpr char const* stageNames[NumStages] = { "Playhead", "Parameters", "DSP", "Messages" };
+
+    struct ScopedStage {
+        ScopedStage(BlockTimingMonitor& monitor, Stage stageToMeasure)
+            : owner(monitor)
+            , stage(stageToMeasure)
+            , start(Time::getHighResolutionTicks())
+        {
+        }
+
+        ~ScopedStage()
+        {
+            owner.stageTicks[stage] += Time::getHighResolutionTicks() - start;
+        }
+
+        BlockTimingMonitor& owner;
+        Stage stage;
+        int64 start;
+    };
+
+    void prepare(double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        reset();
+    }
+
+    // Clears the statistics, can be called from any thread
+    void reset()
+    {
+        for (auto& bin : histogram)
+            bin.store(0, std::memory_order_relaxed);
+        for (auto& count : overrunsByStage)
+            count.store(0, std::memory_order_relaxed);
+        for (auto& worst : worstStageMs)
+            worst.store(0.0f, std::memory_order_relaxed);
+
+        numBlocks.store(0, std::memory_order_relaxed);
+        numOverruns.store(0, std::memory_order_relaxed);
+        worstBlockLoad.store(0.0f, std::memory_order_relaxed);
+    }
+
+    void beginBlock(int numSamples)
+    {
+        blockStart = Time::getHighResolutionTicks();
+        blockSamples = numSamples;
+        std::fill(std::begin(stageTicks), std::end(stageTicks), 0);
+    }
+
+    void endBlock()
+    {
+        if (blockSamples <= 0 || sampleRate <= 0.0)
+            return;
+
+        auto const elapsedMs = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - blockStart) * 1000.0;
+        auto const deadlineMs = 1000.0 * blockSamples / sampleRate;
+        auto const load = static_cast<float>(elapsedMs / deadlineMs);
+
+        int bin = 0;
+        while (bin < numBins - 1 && load >= binLimits[bin])
+            bin++;
+        histogram[bin].fetch_add(1, std::memory_order_relaxed);
+        numBlocks.fetch_add(1, std::memory_order_relaxed);
+
+        lastBlockLoad.store(load, std::memory_order_relaxed);
+        if (load > worstBlockLoad.load(std::memory_order_relaxed))
+            worstBlockLoad.store(load, std::memory_order_relaxed);
+
+        int slowestStage = 0;
+        for (int i = 0; i < NumStages; i++) {
+            auto const stageMs = static_cast<float>(Time::highResolutionTicksToSeconds(stageTicks[i]) * 1000.0);
+            if (stageMs > worstStageMs[i].load(std::memory_order_relaxed))
+                worstStageMs[i].store(stageMs, std::memory_order_relaxed);
+            if (stageTicks[i] > stageTicks[slowestStage])
+                slowestStage = i;
+        }
+
+        if (load >= 1.0f) {
+            numOverruns.fetch_add(1, std::memory_order_relaxed);
+            overrunsByStage[slowestStage].fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    uint32 getHistogramBin(int bin) const { return histogram[bin].load(std::memory_order_relaxed); }
+    uint32 getNumBlocks() const { return numBlocks.load(std::memory_order_relaxed); }
+    uint32 getNumOverruns() const { return numOverruns.load(std::memory_order_relaxed); }
+    uint32 getNumOverruns(Stage stage) const { return overrunsByStage[stage].load(std::memory_order_relaxed); }
+    float getWorstStageMs(Stage stage) const { return worstStageMs[stage].load(std::memory_order_relaxed); }
+    float getWorstBlockLoad() const { return worstBlockLoad.load(std::memory_order_relaxed); }
+    float getLastBlockLoad() const { return lastBlockLoad.load(std::memory_order_relaxed); }
+
+private:
+    // Audio thread only
+    double sampleRate = 44100.0;
+    int64 blockStart = 0;
+    int blockSamples = 0;
+    int64 stageTicks[NumStages] = {};
+
+    std::atomic<uint32> histogram[numBins] = {};
+    std::atomic<uint32> overrunsByStage[NumStages] = {};
+    std::atomic<float> worstStageMs[NumStages] = {};
+    std::atomic<uint32> numBlocks = 0;
+    std::atomic<uint32> numOverruns = 0;
+    std::atomic<float> worstBlockLoad = 0.0f;
+    std::atomic<float> lastBlockLoad = 0.0f;
+};
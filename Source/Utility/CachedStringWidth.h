@@ -6,21 +6,76 @@
 
 #pragma once
 
-template<int FontSize>
-struct CachedStringWidth {
+// Fixed-size least-recently-used cache of string widths
+// Split into shards that each have their own lock, so threads measuring different strings rarely wait for each other
+template<typename ValueType>
+class StringWidthCache {
+public:
+    explicit StringWidthCache(size_t maxEntries)
+        : shardCapacity(std::max<size_t>(1, maxEntries / numShards))
+    {
+    }
 
-    static int calculateSingleLineWidth(String const& singleLine)
+    template<typename Calculate>
+    ValueType get(uint64 key, Calculate const& calculate)
     {
-        auto stringHash = hash(singleLine);
+        auto& shard = shards[key % numShards];
+
+        {
+            std::lock_guard<std::mutex> lock(shard.lock);
+            if (auto cacheHit = shard.entries.find(key); cacheHit != shard.entries.end()) {
+                shard.order.splice(shard.order.begin(), shard.order, cacheHit->second);
+                hits.fetch_add(1, std::memory_order_relaxed);
+                return cacheHit->second->second;
+            }
+        }
+
+        // Measure without holding the lock, measuring text is the slow part
+        misses.fetch_add(1, std::memory_order_relaxed);
+        auto const value = calculate();
 
-        auto cacheHit = stringWidthCache.find(stringHash);
-        if (cacheHit != stringWidthCache.end())
-            return cacheHit->second;
+        std::lock_guard<std::mutex> lock(shard.lock);
+        if (shard.entries.count(key))
+            return value;
 
-        auto stringWidth = Font(FontSize).getStringWidth(singleLine);
-        stringWidthCache[stringHash] = stringWidth;
+        shard.order.emplace_front(key, value);
+        shard.entries[key] = shard.order.begin();
 
-        return stringWidth;
+        if (shard.order.size() > shardCapacity) {
+            shard.entries.erase(shard.order.back().first);
+            shard.order.pop_back();
+        }
+
+        return value;
+    }
+
+    uint64 getNumHits() const { return hits.load(std::memory_order_relaxed); }
+    uint64 getNumMisses() const { return misses.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t numShards = 16;
+
+    struct Shard {
+        std::mutex lock;
+        std::list<std::pair<uint64, ValueType>> order; // Most recently used first
+        std::unordered_map<uint64, typename std::list<std::pair<uint64, ValueType>>::iterator> entries;
+    };
+
+    size_t const shardCapacity;
+    std::array<Shard, numShards> shards;
+    std::atomic<uint64> hits = 0;
+    std::atomic<uint64> misses = 0;
+};
+
+template<int FontSize>
+struct CachedStringWidth {
+
+    // Can be called from any thread, the console measures its messages while they come in
+    static int calculateSingleLineWidth(String const& singleLine)
+    {
+        return stringWidthCache.get(hash(singleLine), [&singleLine]() {
+            return Font(FontSize).getStringWidth(singleLine);
+        });
     }
 
     static int calculateStringWidth(String const& string)
@@ -33,7 +88,7 @@ struct CachedStringWidth {
         return maximumLineWidth;
     }
 
-    static inline std::unordered_map<hash32, int> stringWidthCache = std::unordered_map<hash32, int>();
+    static inline StringWidthCache<int> stringWidthCache = StringWidthCache<int>(4096);
 };
 
 struct CachedFontStringWidth : public DeletedAtShutdown {
@@ -44,24 +99,11 @@ struct CachedFontStringWidth : public DeletedAtShutdown {
 
     float calculateSingleLineWidth(Font const& font, String const& singleLine)
     {
-        auto stringHash = hash(singleLine);
-
-        for (auto& [cachedFont, cache] : stringWidthCache) {
-            if (cachedFont == font) {
-                auto cacheHit = cache.find(stringHash);
-                if (cacheHit != cache.end())
-                    return cacheHit->second;
-
-                auto stringWidth = font.getStringWidthFloat(singleLine);
-                cache[stringHash] = stringWidth;
-
-                return stringWidth;
-            }
-        }
-
-        auto stringWidth = font.getStringWidth(singleLine);
-        stringWidthCache.push_back({ font, { { stringHash, stringWidth } } });
-        return stringWidth;
+        // The font goes in the upper half of the key, so the same string in another font gets its own entry
+        auto const key = (static_cast<uint64>(getFontIndex(font)) << 32) | hash(singleLine);
+        return stringWidthCache.get(key, [&font, &singleLine]() {
+            return font.getStringWidthFloat(singleLine);
+        });
     }
 
     int calculateStringWidth(Font const& font, String const& string)
@@ -74,7 +116,30 @@ struct CachedFontStringWidth : public DeletedAtShutdown {
         return maximumLineWidth;
     }
 
-    std::vector<std::pair<Font, std::unordered_map<hash32, float>>> stringWidthCache = std::vector<std::pair<Font, std::unordered_map<hash32, float>>>();
+    // Adds up the widths of the characters, which we only measure once per font
+    // Numbers change all the time, this measures them without a glyph layout and without filling the string cache with every value
+    // Only meant for fonts without kerning between the characters of a number, like the tabular numbers font
+    // letterSpacing is added after every character, like nanovg does when the text is drawn with a letter spacing
+    float calculateNumberWidth(Font const& font, String const& number, float letterSpacing = 0.0f)
+    {
+        auto const fontIndex = getFontIndex(font);
+
+        std::lock_guard<std::mutex> lock(fontsLock);
+        auto& widths = characterWidths[fontIndex];
+        if (widths.empty()) {
+            widths.resize(numCharacterWidths);
+            for (int i = 0; i < numCharacterWidths; i++) {
+                widths[i] = font.getStringWidthFloat(String::charToString(static_cast<juce_wchar>(firstCharacterWidth + i)));
+            }
+        }
+
+        float width = 0.0f;
+        for (auto character : number) {
+            if (isPositiveAndBelow(static_cast<int>(character) - firstCharacterWidth, numCharacterWidths))
+                width += widths[static_cast<int>(character) - firstCharacterWidth] + letterSpacing;
+        }
+        return width;
+    }
 
     static CachedFontStringWidth* get()
     {
@@ -85,4 +150,26 @@ struct CachedFontStringWidth : public DeletedAtShutdown {
     }
 
     static inline CachedFontStringWidth* instance = nullptr;
+
+private:
+    // Only a handful of fonts are ever measured, so a list is fine
+    uint32 getFontIndex(Font const& font)
+    {
+        std::lock_guard<std::mutex> lock(fontsLock);
+        for (uint32 i = 0; i < fonts.size(); i++) {
+            if (fonts[i] == font)
+                return i;
+        }
+
+        fonts.push_back(font);
+        return static_cast<uint32>(fonts.size() - 1);
+    }
+
+    static constexpr int firstCharacterWidth = 32; // Printable ASCII, that's all a formatted number can contain
+    static constexpr int numCharacterWidths = 95;
+
+    std::mutex fontsLock;
+    std::vector<Font> fonts;
+    std::unordered_map<uint32, std::vector<float>> characterWidths;
+    StringWidthCache<float> stringWidthCache = StringWidthCache<float>(4096);
 };
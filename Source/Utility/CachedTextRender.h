@@ -1,11 +1,192 @@
 #pragma once
 
+#include <deque>
+#include "BackgroundTasks.h"
+
+// A finished text layout, along with what we need to draw it with nanovg
+// Once created it's never changed, so the same layout can be drawn by any number of objects
+struct CachedTextLayout {
+    struct Line {
+        std::string text;
+        Point<float> origin; // Baseline of the first glyph, relative to the layout
+    };
+
+    TextLayout textLayout;
+    std::vector<Line> lines;
+    String fontFace;
+    float fontHeight = 0.0f;
+    int height = 0;
+
+    // Doesn't touch anything but its arguments, so this can also run on a background thread
+    static std::shared_ptr<CachedTextLayout const> create(String const& text, Font const& font, Colour const& colour, int const width)
+    {
+        auto attributedText = AttributedString(text);
+        attributedText.setColour(colour);
+        attributedText.setJustification(Justification::centredLeft);
+        attributedText.setFont(font);
+
+        auto layout = std::make_shared<CachedTextLayout>();
+        layout->textLayout.createLayout(attributedText, width);
+        layout->height = layout->textLayout.getHeight();
+        layout->fontFace = getFontFace(font);
+        layout->fontHeight = font.getHeight();
+        layout->updateLines(text);
+        return layout;
+    }
+
+private:
+    // Same naming as the fonts we register with nanovg, see NanoVGGraphicsContext::setFont
+    static String getFontFace(Font const& font)
+    {
+        auto typefaceName = font.getTypefaceName();
+        if (typefaceName.contains(" "))
+            return typefaceName.replace(" ", "-");
+
+        return typefaceName + "-" + font.getTypefaceStyle();
+    }
+
+    // Keep the line breaks that JUCE found, so the text wraps exactly like it does when we measure it
+    void updateLines(String const& text)
+    {
+        lines.clear();
+        for (auto const& line : textLayout) {
+            auto lineText = text.substring(line.stringRange.getStart(), line.stringRange.getEnd()).trimEnd();
+            if (lineText.isEmpty())
+                continue;
+
+            auto origin = line.lineOrigin;
+            if (!line.runs.isEmpty() && !line.runs.getFirst()->glyphs.isEmpty())
+                origin.x += line.runs.getFirst()->glyphs.getReference(0).anchor.x;
+
+            lines.push_back({ lineText.toStdString(), origin });
+        }
+    }
+};
+
+// Layouts of long texts, shared by every object that shows the same text with the same font, colour and width
+// Help files and documentation patches tend to repeat the same comments, and reopening them shouldn't lay them out again
+// Only used from the message thread, layouts are created on a background thread when asked for
+class SharedTextLayouts {
+public:
+    using Layout = std::shared_ptr<CachedTextLayout const>;
+
+    static hash32 getKey(String const& text, Font const& font, Colour const& colour, int const width)
+    {
+        return hash(text + "\n" + String(width) + font.toString() + colour.toString());
+    }
+
+    Layout find(hash32 const key)
+    {
+        if (auto const it = layouts.find(key); it != layouts.end())
+            return it->second.lock();
+
+        return nullptr;
+    }
+
+    // For the renders that asked for a layout in the background: until one of them takes it, we hold on to it here
+    Layout claim(hash32 const key)
+    {
+        if (auto const it = pending.find(key); it != pending.end() && it->second.layout) {
+            auto layout = std::move(it->second.layout);
+            pending.erase(it);
+            return layout;
+        }
+
+        return find(key);
+    }
+
+    // Whether the layout is still being created, or was created but not claimed yet
+    bool isPending(hash32 const key) const
+    {
+        return pending.contains(key);
+    }
+
+    // Calls onCreated on the message thread once the layout can be claimed
+    // Asking for a layout that's already being created only adds the callback
+    void createInBackground(hash32 const key, String const& text, Font const& font, Colour const& colour, int const width, std::function<void()> onCreated)
+    {
+        auto& request = pending[key];
+        if (request.layout) {
+            // Created, but nobody took it yet
+            if (onCreated)
+                onCreated();
+            return;
+        }
+
+        request.callbacks.push_back(std::move(onCreated));
+        if (request.callbacks.size() > 1)
+            return;
+
+        tasks.addJob("SharedTextLayouts::createInBackground", [this, key, text, font, colour, width] {
+            auto layout = CachedTextLayout::create(text, font, colour, width);
+            MessageManager::callAsync([_this = WeakReference(this), key, layout] {
+                if (_this)
+                    _this->add(key, layout);
+            });
+        },
+            BackgroundTasks::Normal);
+    }
+
+    void add(hash32 const key, Layout const& layout)
+    {
+        layouts[key] = layout;
+
+        // Keep the last few alive, so closing and reopening a patch doesn't lay everything out again
+        recentlyUsed.push_back(layout);
+        if (recentlyUsed.size() > maxRecentlyUsed)
+            recentlyUsed.pop_front();
+
+        if (layouts.size() > maxRecentlyUsed * 4)
+            std::erase_if(layouts, [](auto const& entry) { return entry.second.expired(); });
+
+        if (auto const it = pending.find(key); it != pending.end()) {
+            auto callbacks = std::move(it->second.callbacks);
+            it->second.callbacks.clear();
+            it->second.layout = layout;
+            for (auto& callback : callbacks) {
+                if (callback)
+                    callback();
+            }
+        }
+    }
+
+private:
+    static constexpr size_t maxRecentlyUsed = 256;
+
+    // A layout that's being created in the background, and once it's done, the layout until a render claims it
+    struct Request {
+        std::vector<std::function<void()>> callbacks;
+        Layout layout;
+    };
+
+    std::unordered_map<hash32, std::weak_ptr<CachedTextLayout const>> layouts;
+    std::unordered_map<hash32, Request> pending;
+    std::deque<Layout> recentlyUsed;
+
+    BackgroundTasks::TaskGroup tasks;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(SharedTextLayouts)
+};
+
 class CachedTextRender {
 public:
     CachedTextRender() = default;
 
     void renderText(NVGcontext* nvg, Rectangle<int> const& bounds, float scale)
     {
+        if (!layout) {
+            if (pendingKey)
+                renderPlaceholder(nvg, bounds);
+            return;
+        }
+
+        // Fonts that nanovg knows about are drawn from its glyph atlas, which is shared by everything on the same surface
+        // That way, changing the zoom or colour doesn't need a new image for every object
+        if (nvgFindFont(nvg, layout->fontFace.toRawUTF8()) >= 0) {
+            renderTextAsGlyphs(nvg, bounds);
+            return;
+        }
+
         if (updateImage || !image.isValid() || lastRenderBounds != bounds || lastScale != scale) {
             renderTextToImage(nvg, Rectangle<int>(bounds.getX(), bounds.getY(), bounds.getWidth() + 3, bounds.getHeight()), scale);
             lastRenderBounds = bounds;
@@ -20,39 +201,79 @@ public:
     }
 
     // If you want to use this for text measuring as well, you might want the measuring to be ready before
-    bool prepareLayout(String const& text, Font const& font, Colour const& colour, int const width, int const cachedWidth)
+    // With sharedLayouts, identical texts share one layout. If onCreatedInBackground is also set and we don't have a
+    // layout yet, it's created on a background thread and we draw a placeholder until onCreatedInBackground is called
+    bool prepareLayout(String const& text, Font const& font, Colour const& colour, int const width, int const cachedWidth, SharedTextLayouts* sharedLayouts = nullptr, std::function<void()> onCreatedInBackground = nullptr)
     {
         auto textHash = hash(text);
         bool needsUpdate = lastTextHash != textHash || colour != lastColour || cachedWidth != lastWidth;
-        if (needsUpdate) {
-            auto attributedText = AttributedString(text);
-            attributedText.setColour(colour);
-            attributedText.setJustification(Justification::centredLeft);
-            attributedText.setFont(font);
 
-            layout = TextLayout();
-            layout.createLayout(attributedText, width);
+        // Still waiting for the background thread, see if it has finished
+        if (!needsUpdate && !layout && sharedLayouts && pendingKey) {
+            if (auto found = sharedLayouts->claim(pendingKey))
+                return setLayout(found);
 
-            idealHeight = layout.getHeight();
-            lastWidth = cachedWidth;
+            // Someone else claimed it, and it's gone since, so we ask for it again
+            if (sharedLayouts->isPending(pendingKey))
+                return false;
 
+            needsUpdate = true;
+        }
+
+        if (needsUpdate) {
+            lastWidth = cachedWidth;
             lastTextHash = textHash;
             lastColour = colour;
-            updateImage = true;
+            pendingKey = 0;
+
+            if (!sharedLayouts) {
+                setLayout(CachedTextLayout::create(text, font, colour, width));
+                return true;
+            }
+
+            auto const key = SharedTextLayouts::getKey(text, font, colour, width);
+            if (auto found = sharedLayouts->claim(key)) {
+                setLayout(found);
+            } else if (onCreatedInBackground && !layout) {
+                pendingKey = key;
+                idealHeight = estimateHeight(text, font, width);
+                sharedLayouts->createInBackground(key, text, font, colour, width, std::move(onCreatedInBackground));
+            } else {
+                auto created = CachedTextLayout::create(text, font, colour, width);
+                sharedLayouts->add(key, created);
+                setLayout(created);
+            }
         }
 
         return needsUpdate;
     }
 
+    void renderTextAsGlyphs(NVGcontext* nvg, Rectangle<int> const& bounds)
+    {
+        auto const origin = Justification(Justification::centredLeft).appliedToRectangle(Rectangle<float>(layout->textLayout.getWidth(), layout->textLayout.getHeight()), bounds.toFloat()).getPosition();
+
+        NVGScopedState scopedState(nvg);
+        nvgIntersectScissor(nvg, bounds.getX(), bounds.getY(), bounds.getWidth(), bounds.getHeight());
+        nvgFontFace(nvg, layout->fontFace.toRawUTF8());
+        nvgFontSize(nvg, layout->fontHeight * 0.862f);
+        nvgTextLetterSpacing(nvg, -0.275f);
+        nvgTextAlign(nvg, NVG_ALIGN_LEFT | NVG_ALIGN_BASELINE);
+        nvgFillColor(nvg, nvgRGBA(lastColour.getRed(), lastColour.getGreen(), lastColour.getBlue(), lastColour.getAlpha()));
+
+        for (auto const& line : layout->lines) {
+            nvgText(nvg, origin.x + line.origin.x, origin.y + line.origin.y, line.text.data(), line.text.data() + line.text.size());
+        }
+    }
+
     void renderTextToImage(NVGcontext* nvg, Rectangle<int> const& bounds, float scale)
     {
         int width = std::floor(bounds.getWidth() * scale);
         int height = std::floor(bounds.getHeight() * scale);
 
-        image = NVGImage(nvg, width, height, [this, bounds, scale](Graphics& g) {
+        image = NVGImage(nvg, width, height, [layout = layout, bounds, scale](Graphics& g) {
             g.addTransform(AffineTransform::scale(scale, scale));
             g.reduceClipRegion(bounds.withTrimmedRight(4)); // If it touches the edges of the image, it'll look bad
-            layout.draw(g, bounds.toFloat());
+            layout->textLayout.draw(g, bounds.toFloat());
         });
     }
 
@@ -62,6 +283,44 @@ public:
     }
 
 private:
+    bool setLayout(std::shared_ptr<CachedTextLayout const> newLayout)
+    {
+        layout = std::move(newLayout);
+        idealHeight = layout->height;
+        updateImage = true;
+        pendingKey = 0;
+        return true;
+    }
+
+    // Roughly how high the text will be, so the object has about the right size while the layout is being created
+    static int estimateHeight(String const& text, Font const& font, int const width)
+    {
+        auto const charsPerLine = std::max(1, static_cast<int>(width / (font.getHeight() * 0.5f)));
+        int numLines = 0;
+        for (auto const& line : StringArray::fromLines(text))
+            numLines += std::max(1, (line.length() + charsPerLine - 1) / charsPerLine);
+
+        return static_cast<int>(std::ceil(numLines * font.getHeight()));
+    }
+
+    // Faint bars where the lines will be
+    void renderPlaceholder(NVGcontext* nvg, Rectangle<int> const& bounds) const
+    {
+        auto const lineHeight = 15.0f;
+        auto const numLines = std::max(1, static_cast<int>(idealHeight / lineHeight));
+        auto const top = bounds.getCentreY() - numLines * lineHeight * 0.5f;
+
+        NVGScopedState scopedState(nvg);
+        nvgIntersectScissor(nvg, bounds.getX(), bounds.getY(), bounds.getWidth(), bounds.getHeight());
+        nvgFillColor(nvg, nvgRGBA(lastColour.getRed(), lastColour.getGreen(), lastColour.getBlue(), lastColour.getAlpha() / 6));
+        nvgBeginPath(nvg);
+        for (int i = 0; i < numLines; i++) {
+            auto const width = i == numLines - 1 && numLines > 1 ? bounds.getWidth() * 0.6f : bounds.getWidth() - 4.0f;
+            nvgRoundedRect(nvg, bounds.getX(), top + i * lineHeight + lineHeight * 0.3f, width, lineHeight * 0.4f, 2.0f);
+        }
+        nvgFill(nvg);
+    }
+
     NVGImage image;
     hash32 lastTextHash = 0;
     float lastScale = 1.0f;
@@ -70,6 +329,7 @@ private:
     int idealWidth = 0, idealHeight = 0;
     Rectangle<int> lastRenderBounds;
 
-    TextLayout layout;
+    std::shared_ptr<CachedTextLayout const> layout;
+    hash32 pendingKey = 0;
     bool updateImage = false;
 };
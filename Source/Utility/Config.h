@@ -27,6 +27,16 @@ struct ProjectInfo {
     static bool isStandalone;
     static bool isFx;
 
+    // Set when the standalone runs without any GUI, there won't ever be an editor
+    static inline bool isHeadless = false;
+
+    // iOS kills AUv3 extensions that go over a small memory limit, so there we decode resources when they're first needed
+#if JUCE_IOS
+    static constexpr bool isLowMemory = true;
+#else
+    static constexpr bool isLowMemory = false;
+#endif
+
     static inline char const* companyName = "plugdata";
     static inline char const* versionString = PLUGDATA_VERSION;
 
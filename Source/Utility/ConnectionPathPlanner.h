@@ -0,0 +1,222 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <bit>
+#include <queue>
+
+#include "BackgroundTasks.h"
+
+// Finds paths for segmented connections that go around objects
+// The area between the two iolets is divided into a grid of cells, cells that are covered by an object are blocked
+// An A* search then finds the path through the grid with the fewest steps, where every bend counts as a few extra steps
+// Plans are cached per pair of endpoints and set of obstacles, and can be computed on a background thread
+class ConnectionPathPlanner {
+public:
+    using Plan = std::vector<Point<float>>;
+
+    struct Request {
+        Point<float> start, end;
+        std::vector<Rectangle<float>> obstacles;
+    };
+
+    // Returns the cached plan for this request, or finds it right away
+    Plan getPlan(Request const& request)
+    {
+        auto const key = getKey(request);
+        if (auto it = cache.find(key); it != cache.end())
+            return it->second;
+
+        return addToCache(key, findPath(request));
+    }
+
+    // Finds the plan on the worker thread, and calls onPlanned on the message thread once it's done
+    // If the plan was cached, onPlanned gets called right away
+    void planAsync(Request request, std::function<void(Plan const&)> onPlanned)
+    {
+        auto const key = getKey(request);
+        if (auto it = cache.find(key); it != cache.end()) {
+            onPlanned(it->second);
+            return;
+        }
+
+        tasks.addJob("ConnectionPathPlanner::findPath", [planner = WeakReference<ConnectionPathPlanner>(this), request = std::move(request), onPlanned = std::move(onPlanned), key]() mutable {
+            auto plan = findPath(request);
+            MessageManager::callAsync([planner, plan = std::move(plan), onPlanned = std::move(onPlanned), key]() mutable {
+                if (planner)
+                    onPlanned(planner->addToCache(key, std::move(plan)));
+            });
+        }, BackgroundTasks::High);
+    }
+
+    // Path from the end to the start, through the centres of the cells it passes, or an empty plan if none was found
+    static Plan findPath(Request const& request)
+    {
+        auto const start = request.start;
+        auto const end = request.end;
+        auto const area = Rectangle<float>(start, end).expanded(searchMargin);
+        auto const cellSize = std::max(minCellSize, std::max(area.getWidth(), area.getHeight()) / maxCellsPerSide);
+
+        // Align the grid so the start point is in the centre of a cell, so the path leaves the outlet in a straight line
+        auto const startColumn = static_cast<int>(std::ceil((start.x - area.getX()) / cellSize));
+        auto const startRow = static_cast<int>(std::ceil((start.y - area.getY()) / cellSize));
+        auto const origin = start - Point<float>((startColumn + 0.5f) * cellSize, (startRow + 0.5f) * cellSize);
+        auto const columns = static_cast<int>(std::ceil((area.getRight() - origin.x) / cellSize)) + 1;
+        auto const rows = static_cast<int>(std::ceil((area.getBottom() - origin.y) / cellSize)) + 1;
+
+        auto getCentre = [origin, cellSize](int column, int row) {
+            return origin + Point<float>((column + 0.5f) * cellSize, (row + 0.5f) * cellSize);
+        };
+
+        std::vector<uint8> blocked(static_cast<size_t>(columns * rows), 0);
+        for (auto const& obstacle : request.obstacles) {
+            // Expanding by half a cell makes sure that objects smaller than a cell still block the cells they touch
+            auto const expanded = obstacle.expanded(cellSize * 0.5f);
+            auto const firstColumn = std::max(0, static_cast<int>((expanded.getX() - origin.x) / cellSize));
+            auto const lastColumn = std::min(columns - 1, static_cast<int>((expanded.getRight() - origin.x) / cellSize));
+            auto const firstRow = std::max(0, static_cast<int>((expanded.getY() - origin.y) / cellSize));
+            auto const lastRow = std::min(rows - 1, static_cast<int>((expanded.getBottom() - origin.y) / cellSize));
+
+            for (int row = firstRow; row <= lastRow; row++) {
+                for (int column = firstColumn; column <= lastColumn; column++) {
+                    if (expanded.contains(getCentre(column, row)))
+                        blocked[row * columns + column] = 1;
+                }
+            }
+        }
+
+        auto const endColumn = std::clamp(static_cast<int>((end.x - origin.x) / cellSize), 0, columns - 1);
+        auto const endRow = std::clamp(static_cast<int>((end.y - origin.y) / cellSize), 0, rows - 1);
+        auto const startCell = startRow * columns + startColumn;
+        auto const endCell = endRow * columns + endColumn;
+        blocked[startCell] = 0;
+        blocked[endCell] = 0;
+
+        // A node is a cell together with the direction we entered it from, so we can tell when the path bends
+        enum Direction { Down, Up, Right, Left };
+        static constexpr int dx[4] = { 0, 0, 1, -1 };
+        static constexpr int dy[4] = { 1, -1, 0, 0 };
+
+        auto const numNodes = columns * rows * 4;
+        std::vector<float> cost(static_cast<size_t>(numNodes), std::numeric_limits<float>::max());
+        std::vector<int> cameFrom(static_cast<size_t>(numNodes), -1);
+
+        auto heuristic = [endColumn, endRow, columns](int cell) {
+            return static_cast<float>(std::abs(cell % columns - endColumn) + std::abs(cell / columns - endRow));
+        };
+
+        using QueueEntry = std::pair<float, int>;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<>> open;
+
+        // Connections always leave the outlet going down
+        auto const startNode = startCell * 4 + Down;
+        cost[startNode] = 0.0f;
+        open.emplace(heuristic(startCell), startNode);
+
+        int goalNode = -1;
+        while (!open.empty()) {
+            auto const [estimate, node] = open.top();
+            open.pop();
+
+            auto const cell = node / 4;
+            auto const direction = node % 4;
+            if (estimate - heuristic(cell) > cost[node])
+                continue;
+
+            // And arrive at the inlet vertically
+            if (cell == endCell && (direction == Down || direction == Up)) {
+                goalNode = node;
+                break;
+            }
+
+            auto const column = cell % columns;
+            auto const row = cell / columns;
+            for (int next = 0; next < 4; next++) {
+                auto const nextColumn = column + dx[next];
+                auto const nextRow = row + dy[next];
+                if (nextColumn < 0 || nextRow < 0 || nextColumn >= columns || nextRow >= rows)
+                    continue;
+
+                auto const nextCell = nextRow * columns + nextColumn;
+                if (blocked[nextCell])
+                    continue;
+
+                auto const nextNode = nextCell * 4 + next;
+                auto const nextCost = cost[node] + 1.0f + (next != direction ? bendCost : 0.0f);
+                if (nextCost < cost[nextNode]) {
+                    cost[nextNode] = nextCost;
+                    cameFrom[nextNode] = node;
+                    open.emplace(nextCost + heuristic(nextCell), nextNode);
+                }
+            }
+        }
+
+        if (goalNode < 0 || goalNode == startNode)
+            return {};
+
+        Plan plan;
+        for (int node = goalNode; node >= 0; node = cameFrom[node]) {
+            auto const cell = node / 4;
+            plan.push_back(getCentre(cell % columns, cell / columns));
+        }
+
+        // The end point usually isn't in the centre of its cell, move the last vertical stretch over so it ends exactly at the inlet
+        auto const endCentreX = plan.front().x;
+        for (auto& point : plan) {
+            if (!approximatelyEqual(point.x, endCentreX))
+                break;
+            point.x = end.x;
+        }
+        plan.front() = end;
+        plan.back() = start;
+
+        return plan;
+    }
+
+private:
+    static uint64 getKey(Request const& request)
+    {
+        uint64 hash = 14695981039346656037ull;
+        auto add = [&hash](float value) {
+            hash = (hash ^ static_cast<uint64>(std::bit_cast<uint32>(value))) * 1099511628211ull;
+        };
+
+        add(request.start.x);
+        add(request.start.y);
+        add(request.end.x);
+        add(request.end.y);
+        for (auto const& obstacle : request.obstacles) {
+            add(obstacle.getX());
+            add(obstacle.getY());
+            add(obstacle.getWidth());
+            add(obstacle.getHeight());
+        }
+
+        return hash;
+    }
+
+    Plan const& addToCache(uint64 key, Plan plan)
+    {
+        if (cache.size() >= maxCacheSize)
+            cache.clear();
+
+        return cache[key] = std::move(plan);
+    }
+
+    static constexpr float searchMargin = 40.0f;
+    static constexpr float minCellSize = 8.0f;
+    static constexpr float maxCellsPerSide = 128.0f;
+    static constexpr float bendCost = 4.0f;
+    static constexpr size_t maxCacheSize = 2048;
+
+    // Message thread only
+    std::unordered_map<uint64, Plan> cache;
+
+    BackgroundTasks::TaskGroup tasks;
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE(ConnectionPathPlanner)
+};
@@ -0,0 +1,97 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Edits that touch signal objects make pd rebuild its DSP chain while holding pd's lock, which can take longer than a block in big patches
+// When enabled, the audio thread doesn't wait for that: it plays the last block it had fading out, and fades pd back in once it gets the lock again
+// This only happens while a ScopedRebuild exists, for anything else that holds pd's lock the audio thread waits like it always did
+// pd keeps the state of signal objects inside the objects, so everything that wasn't edited continues where it was in the new chain
+class DSPRebuildSmoother {
+public:
+    void prepare(int numChannels, int blockSize)
+    {
+        lastOutputChannels = numChannels;
+        lastOutputSize = blockSize;
+        lastOutput.allocate(numChannels * blockSize, true);
+        concealing = false;
+    }
+
+    // The number of output channels it was prepared for
+    int getNumChannels() const { return lastOutputChannels; }
+
+    void setEnabled(bool shouldBeEnabled) { enabled.store(shouldBeEnabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    // Marks the DSP chain as being rebuilt for as long as it exists, create it before taking pd's lock where possible
+    class ScopedRebuild {
+    public:
+        explicit ScopedRebuild(DSPRebuildSmoother& rebuildSmoother)
+            : smoother(rebuildSmoother)
+        {
+            smoother.numRebuilds.fetch_add(1, std::memory_order_release);
+        }
+
+        ~ScopedRebuild()
+        {
+            smoother.numRebuilds.fetch_sub(1, std::memory_order_release);
+        }
+
+    private:
+        DSPRebuildSmoother& smoother;
+    };
+
+    bool isRebuilding() const { return numRebuilds.load(std::memory_order_acquire) > 0; }
+
+    // Fills a block that pd couldn't process, getChannel returns the samples for a channel
+    template<typename GetChannel>
+    void conceal(int numChannels, int numSamples, GetChannel getChannel)
+    {
+        auto const fadeLength = std::min(numSamples, lastOutputSize);
+        for (int ch = 0; ch < numChannels; ch++) {
+            auto* channel = getChannel(ch);
+            FloatVectorOperations::clear(channel, numSamples);
+
+            // Only the first missed block fades out, after that it stays silent until pd is back
+            if (concealing || ch >= lastOutputChannels)
+                continue;
+
+            auto const* last = lastOutput.get() + ch * lastOutputSize;
+            for (int i = 0; i < fadeLength; i++) {
+                channel[i] = last[i] * (1.0f - static_cast<float>(i) / fadeLength);
+            }
+        }
+        concealing = true;
+    }
+
+    // Call after pd processed a block, fades pd back in after a missed block, and remembers the end of the block for the next fade out
+    template<typename GetChannel>
+    void processed(int numChannels, int numSamples, GetChannel getChannel)
+    {
+        auto const fadeLength = std::min(numSamples, lastOutputSize);
+        for (int ch = 0; ch < numChannels; ch++) {
+            auto* channel = getChannel(ch);
+            if (concealing) {
+                for (int i = 0; i < fadeLength; i++) {
+                    channel[i] *= static_cast<float>(i) / fadeLength;
+                }
+            }
+
+            if (ch < lastOutputChannels && numSamples >= lastOutputSize)
+                FloatVectorOperations::copy(lastOutput.get() + ch * lastOutputSize, channel + numSamples - lastOutputSize, lastOutputSize);
+        }
+        concealing = false;
+    }
+
+private:
+    std::atomic<bool> enabled = false;
+    std::atomic<int> numRebuilds = 0;
+    bool concealing = false;
+
+    HeapBlock<float> lastOutput;
+    int lastOutputChannels = 0;
+    int lastOutputSize = 0;
+};
@@ -0,0 +1,187 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <atomic>
+
+// Small pool of worker threads that the audio callback can fan work out to
+// The calling thread always participates, and always runs task 0 itself, so work that has to stay on the audio thread can go there
+// parallelFor doesn't allocate or lock: workers are woken with an event and completion is tracked with atomics
+// Workers are real-time threads that join the host's audio workgroup, so the OS schedules them like the audio thread itself
+// Otherwise they can end up on efficiency cores on Apple Silicon, or get preempted by background work, and miss the deadline
+class DSPThreadPool {
+public:
+    DSPThreadPool(int numThreads, Thread::RealtimeOptions const& options)
+    {
+        for (int i = 0; i < numThreads; i++) {
+            auto* worker = workers.add(new Worker(*this, i));
+            if (!worker->startRealtimeThread(options))
+                worker->startThread(Thread::Priority::highest);
+        }
+    }
+
+    ~DSPThreadPool()
+    {
+        for (auto* worker : workers) {
+            worker->signalThreadShouldExit();
+            worker->wakeUp.signal();
+        }
+        for (auto* worker : workers) {
+            worker->stopThread(500);
+        }
+    }
+
+    int getNumThreads() const
+    {
+        return workers.size();
+    }
+
+    // Workers join the new workgroup the next time they're woken, since a thread can only join a workgroup by itself
+    void setWorkgroup(AudioWorkgroup const& newWorkgroup)
+    {
+        SpinLock::ScopedLockType lock(workgroupLock);
+        workgroup = newWorkgroup;
+        workgroupGeneration.fetch_add(1, std::memory_order_release);
+    }
+
+    // Runs callback(i) for every i in [0, numTasks), and returns once all tasks have finished
+    template<typename Callback>
+    void parallelFor(int numTasks, Callback& callback)
+    {
+        if (numTasks <= 0)
+            return;
+
+        if (workers.isEmpty() || numTasks == 1) {
+            for (int i = 0; i < numTasks; i++)
+                callback(i);
+            return;
+        }
+
+        context = &callback;
+        task = [](void* ctx, int index) {
+            (*static_cast<Callback*>(ctx))(index);
+        };
+        totalTasks.store(numTasks, std::memory_order_relaxed);
+        nextTask.store(1, std::memory_order_relaxed);
+
+        // Only wake as many workers as we have tasks for
+        auto const numWorkersToWake = std::min(workers.size(), numTasks - 1);
+        busyWorkers.store(numWorkersToWake, std::memory_order_release);
+
+        for (int i = 0; i < numWorkersToWake; i++) {
+            workers.getUnchecked(i)->wakeUp.signal();
+        }
+
+        callback(0);
+        runPendingTasks();
+
+        // Wait until every woken worker has left runPendingTasks, so the next job can't be picked up by a late worker
+        while (busyWorkers.load(std::memory_order_acquire) > 0) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    void runPendingTasks()
+    {
+        int index;
+        while ((index = nextTask.fetch_add(1, std::memory_order_acq_rel)) < totalTasks.load(std::memory_order_relaxed)) {
+            task(context, index);
+        }
+    }
+
+    struct Worker : public Thread {
+        Worker(DSPThreadPool& threadPool, int index)
+            : Thread("DSP Worker " + String(index + 1))
+            , pool(threadPool)
+        {
+        }
+
+        void run() override
+        {
+            auto* mmcssHandle = setProAudioCharacteristics();
+
+            while (!threadShouldExit()) {
+                wakeUp.wait(-1);
+
+                if (threadShouldExit())
+                    break;
+
+                joinWorkgroupIfChanged();
+
+                pool.runPendingTasks();
+                pool.busyWorkers.fetch_sub(1, std::memory_order_acq_rel);
+            }
+
+            workgroupToken.reset();
+            revertProAudioCharacteristics(mmcssHandle);
+        }
+
+        void joinWorkgroupIfChanged()
+        {
+            auto const generation = pool.workgroupGeneration.load(std::memory_order_acquire);
+            if (generation == joinedGeneration)
+                return;
+
+            SpinLock::ScopedLockType lock(pool.workgroupLock);
+            workgroupToken.reset();
+            if (pool.workgroup)
+                pool.workgroup.join(workgroupToken);
+            joinedGeneration = generation;
+        }
+
+#if JUCE_WINDOWS
+        // MMCSS gives us the same scheduling class that hosts use for their audio threads
+        // avrt is loaded at runtime, so we don't have to link to it
+        static DynamicLibrary& getAvrt()
+        {
+            static DynamicLibrary avrt("avrt.dll");
+            return avrt;
+        }
+
+        static void* setProAudioCharacteristics()
+        {
+            using SetCharacteristics = void*(__stdcall*)(wchar_t const*, unsigned long*);
+            if (auto* set = reinterpret_cast<SetCharacteristics>(getAvrt().getFunction("AvSetMmThreadCharacteristicsW"))) {
+                unsigned long taskIndex = 0;
+                return set(L"Pro Audio", &taskIndex);
+            }
+            return nullptr;
+        }
+
+        static void revertProAudioCharacteristics(void* handle)
+        {
+            using RevertCharacteristics = int(__stdcall*)(void*);
+            if (auto* revert = reinterpret_cast<RevertCharacteristics>(getAvrt().getFunction("AvRevertMmThreadCharacteristics")); revert && handle)
+                revert(handle);
+        }
+#else
+        static void* setProAudioCharacteristics() { return nullptr; }
+        static void revertProAudioCharacteristics(void*) { }
+#endif
+
+        DSPThreadPool& pool;
+        WaitableEvent wakeUp;
+        WorkgroupToken workgroupToken;
+        int joinedGeneration = 0;
+    };
+
+    void (*task)(void*, int) = nullptr;
+    void* context = nullptr;
+
+    std::atomic<int> totalTasks = 0;
+    std::atomic<int> nextTask = 0;
+    std::atomic<int> busyWorkers = 0;
+
+    SpinLock workgroupLock;
+    AudioWorkgroup workgroup;
+    std::atomic<int> workgroupGeneration = 0;
+
+    OwnedArray<Worker> workers;
+
+    JUCE_DECLARE_NON_COPYABLE(DSPThreadPool)
+};
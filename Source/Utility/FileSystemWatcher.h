@@ -51,30 +51,98 @@ public:
         fileRenamedNewName
     };
 
+    /** The last event for every file that changed since the previous batch */
+    using ChangeSet = std::map<File, FileSystemEvent>;
+
     /** Receives callbacks from the FileSystemWatcher when a file changes */
-    class Listener : public AsyncUpdater {
+    class Listener {
     public:
-        virtual ~Listener() = default;
-
-        // group changes together
-        void handleAsyncUpdate() override
+        Listener()
+            : debounceTimer(*this)
         {
-            filesystemChanged();
         }
 
+        virtual ~Listener() = default;
+
         /* Called for each file that has changed and how it has changed. Use this callback
            if you need to reload a file when it's contents change */
-        virtual void fileChanged(File const f, FileSystemEvent)
+        virtual void fileChanged(File const f, FileSystemEvent fsEvent)
         {
             // By default, don't respond to hidden files (which would be .settings and .autosave)
             // If you want that to respond to hidden file changes, override this
             if (f.isHidden() || f.getFileName().startsWith("."))
                 return;
 
-            triggerAsyncUpdate();
+            addToBatch(f, fsEvent);
+        }
+
+        /* Called once changes stop coming in for the debounce time, with everything that changed since the last call.
+           A git checkout or package install touches hundreds of files, this makes sure you only hear about it once */
+        virtual void filesystemChanged(ChangeSet const& changes)
+        {
+            filesystemChanged();
         }
 
         virtual void filesystemChanged() {};
+
+        /* How long to wait for more changes before delivering a batch. While changes keep coming in,
+           a batch is delivered at least every 10 times this interval, so a long operation still shows progress */
+        void setDebounceTime(int milliseconds)
+        {
+            debounceTime = std::max(1, milliseconds);
+        }
+
+    protected:
+        void addToBatch(File const& file, FileSystemEvent fsEvent)
+        {
+            if (auto it = pendingChanges.find(file); it != pendingChanges.end()) {
+                // Something that was created and removed within one batch never existed for the listener
+                if (it->second == fileCreated && (fsEvent == fileDeleted || fsEvent == fileRenamedOldName))
+                    pendingChanges.erase(it);
+                // It's still new to the listener, no matter how often it was written to after that
+                else if (it->second != fileCreated || fsEvent != fileUpdated)
+                    it->second = fsEvent;
+            } else {
+                pendingChanges.emplace(file, fsEvent);
+            }
+
+            if (!debounceTimer.isTimerRunning())
+                batchStart = Time::getMillisecondCounter();
+
+            if (Time::getMillisecondCounter() - batchStart >= static_cast<uint32>(debounceTime * 10))
+                deliverBatch();
+            else
+                debounceTimer.startTimer(debounceTime);
+        }
+
+    private:
+        void deliverBatch()
+        {
+            debounceTimer.stopTimer();
+
+            ChangeSet changes;
+            changes.swap(pendingChanges);
+            filesystemChanged(changes);
+        }
+
+        struct DebounceTimer : public Timer {
+            explicit DebounceTimer(Listener& l)
+                : listener(l)
+            {
+            }
+
+            void timerCallback() override
+            {
+                listener.deliverBatch();
+            }
+
+            Listener& listener;
+        };
+
+        ChangeSet pendingChanges;
+        DebounceTimer debounceTimer;
+        int debounceTime = 250;
+        uint32 batchStart = 0;
     };
 
     /** Registers a listener to be told when things happen to the text.
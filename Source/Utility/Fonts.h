@@ -40,13 +40,9 @@ struct Fonts {
         defaultTypeface = Typeface::createSystemTypefaceFor(interUnicode.data(), interUnicode.size());
         currentTypeface = defaultTypeface;
 
-        thinTypeface = Typeface::createSystemTypefaceFor(BinaryData::InterThin_ttf, BinaryData::InterThin_ttfSize);
         boldTypeface = Typeface::createSystemTypefaceFor(BinaryData::InterBold_ttf, BinaryData::InterBold_ttfSize);
         semiBoldTypeface = Typeface::createSystemTypefaceFor(BinaryData::InterSemiBold_ttf, BinaryData::InterSemiBold_ttfSize);
         iconTypeface = Typeface::createSystemTypefaceFor(BinaryData::IconFont_ttf, BinaryData::IconFont_ttfSize);
-        monoTypeface = Typeface::createSystemTypefaceFor(BinaryData::RobotoMonoRegular_ttf, BinaryData::RobotoMonoRegular_ttfSize);
-        variableTypeface = Typeface::createSystemTypefaceFor(BinaryData::InterVariable_ttf, BinaryData::InterVariable_ttfSize);
-        tabularTypeface = Typeface::createSystemTypefaceFor(BinaryData::InterTabular_ttf, BinaryData::InterTabular_ttfSize);
 
         instance = this;
     }
@@ -55,11 +51,11 @@ struct Fonts {
     static Font getDefaultFont() { return Font(instance->defaultTypeface); }
     static Font getBoldFont() { return Font(instance->boldTypeface); }
     static Font getSemiBoldFont() { return Font(instance->semiBoldTypeface); }
-    static Font getThinFont() { return Font(instance->thinTypeface); }
+    static Font getThinFont() { return Font(instance->getLazyTypeface(instance->thinTypeface, BinaryData::InterThin_ttf, BinaryData::InterThin_ttfSize)); }
     static Font getIconFont() { return Font(instance->iconTypeface); }
-    static Font getMonospaceFont() { return Font(instance->monoTypeface); }
-    static Font getVariableFont() { return Font(instance->variableTypeface); }
-    static Font getTabularNumbersFont() { return Font(instance->tabularTypeface); }
+    static Font getMonospaceFont() { return Font(instance->getLazyTypeface(instance->monoTypeface, BinaryData::RobotoMonoRegular_ttf, BinaryData::RobotoMonoRegular_ttfSize)); }
+    static Font getVariableFont() { return Font(instance->getLazyTypeface(instance->variableTypeface, BinaryData::InterVariable_ttf, BinaryData::InterVariable_ttfSize)); }
+    static Font getTabularNumbersFont() { return Font(instance->getLazyTypeface(instance->tabularTypeface, BinaryData::InterTabular_ttf, BinaryData::InterTabular_ttfSize)); }
 
     static Font setCurrentFont(Font const& font) { return instance->currentTypeface = font.getTypefacePtr(); }
 
@@ -171,8 +167,19 @@ struct Fonts {
     }
 
 private:
+    // Typefaces that only some parts of the GUI use are decoded the first time somebody asks for them
+    Typeface::Ptr getLazyTypeface(Typeface::Ptr& typeface, char const* data, int size)
+    {
+        ScopedLock lock(lazyTypefaceLock);
+        if (!typeface)
+            typeface = Typeface::createSystemTypefaceFor(data, size);
+
+        return typeface;
+    }
+
     // This is effectively a singleton because it's loaded through SharedResourcePointer
     static inline Fonts* instance = nullptr;
+    CriticalSection lazyTypefaceLock;
 
     // Default typeface is Inter combined with Unicode symbols from GoNotoUniversal and emojis from NotoEmoji
     Typeface::Ptr defaultTypeface;
@@ -0,0 +1,238 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Developer overlay that shows where the time of each frame goes
+// Every frame is split into phases, the last frames are drawn as a stacked graph, with the most expensive objects of the last second next to it
+// Toggled with the "Toggle Frame Profiler" command, while it's hidden, nothing is timed
+class FrameProfiler {
+public:
+    enum Phase {
+        FlushMessages,
+        UpdateFramebuffers,
+        RenderObjects,
+        RenderConnections,
+        Present,
+        NumPhases
+    };
+
+    // Adds the time between construction and destruction to a phase
+    // Only the outermost scope counts, so the objects and connections inside a graph are part of the time of that graph
+    // That way the phases never overlap, so we can stack them in the graph
+    class Scope {
+    public:
+        Scope(FrameProfiler* p, Phase ph)
+            : profiler(p && p->isEnabled() ? p : nullptr)
+            , phase(ph)
+        {
+            if (profiler) {
+                counted = profiler->depth++ == 0;
+                start = Time::getHighResolutionTicks();
+            }
+        }
+
+        ~Scope()
+        {
+            if (profiler) {
+                profiler->depth--;
+                if (counted)
+                    profiler->addTime(phase, getElapsed());
+            }
+        }
+
+        double getElapsed() const
+        {
+            return Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - start) * 1000.0;
+        }
+
+        // True for the outermost scope
+        bool isCounted() const { return counted; }
+
+    private:
+        FrameProfiler* profiler;
+        Phase phase;
+        bool counted = false;
+        int64 start = 0;
+    };
+
+    bool isEnabled() const { return enabled; }
+
+    void setEnabled(bool shouldBeEnabled)
+    {
+        enabled = shouldBeEnabled;
+        frames.fill({});
+        currentFrame = {};
+        objectTimes.clear();
+        topObjects.clear();
+        depth = 0;
+        windowStart = Time::getMillisecondCounter();
+    }
+
+    void addTime(Phase phase, double ms)
+    {
+        currentFrame.phases[phase] += ms;
+    }
+
+    // Only called for objects that aren't inside another object that's being timed
+    template<typename NameGetter>
+    void addObjectTime(void const* object, double ms, NameGetter getName)
+    {
+        auto& entry = objectTimes[object];
+        if (entry.name.isEmpty())
+            entry.name = getName();
+        entry.ms += ms;
+    }
+
+    void startFrame()
+    {
+        auto const now = Time::getMillisecondCounterHiRes();
+        currentFrame.interval = lastFrameStart > 0.0 ? now - lastFrameStart : 0.0;
+        lastFrameStart = now;
+    }
+
+    void endFrame()
+    {
+        head = (head + 1) % numFrames;
+        frames[head] = currentFrame;
+        currentFrame = {};
+
+        // Once a second, sort out which objects took the longest
+        if (Time::getMillisecondCounter() - windowStart >= 1000) {
+            windowStart = Time::getMillisecondCounter();
+            topObjects.clear();
+            for (auto const& [object, entry] : objectTimes)
+                topObjects.push_back(entry);
+
+            auto const numTop = std::min<size_t>(topObjects.size(), maxTopObjects);
+            std::partial_sort(topObjects.begin(), topObjects.begin() + numTop, topObjects.end(), [](auto const& a, auto const& b) {
+                return a.ms > b.ms;
+            });
+            topObjects.resize(numTop);
+            objectTimes.clear();
+        }
+    }
+
+    void render(NVGcontext* nvg, float x, float y)
+    {
+        static constexpr float graphWidth = numFrames * 2.0f;
+        static constexpr float graphHeight = 80.0f;
+        static constexpr float msPerFrameAtTop = 33.3f;
+        static constexpr float lineHeight = 14.0f;
+        static constexpr float legendWidth = 150.0f;
+        static NVGcolor const colours[NumPhases] = {
+            nvgRGB(240, 180, 60), nvgRGB(90, 160, 240), nvgRGB(100, 200, 120), nvgRGB(200, 110, 220), nvgRGB(230, 90, 80)
+        };
+        static char const* const names[NumPhases] = { "Messages", "Framebuffers", "Objects", "Connections", "Present" };
+
+        auto const width = graphWidth + legendWidth + 24.0f;
+        auto const height = graphHeight + lineHeight * (maxTopObjects + 2) + 24.0f;
+
+        nvgBeginPath(nvg);
+        nvgFillColor(nvg, nvgRGBA(30, 30, 30, 230));
+        nvgRoundedRect(nvg, x, y, width, height, 4.0f);
+        nvgFill(nvg);
+
+        // Stacked graph, one bar per frame, newest on the right
+        auto const graphX = x + 8.0f;
+        auto const graphY = y + 8.0f;
+        for (int i = 0; i < numFrames; i++) {
+            auto const& frame = frames[(head + 1 + i) % numFrames];
+            auto barY = graphY + graphHeight;
+            for (int phase = 0; phase < NumPhases; phase++) {
+                auto const barHeight = std::min(static_cast<float>(frame.phases[phase]) / msPerFrameAtTop * graphHeight, barY - graphY);
+                if (barHeight <= 0.0f)
+                    continue;
+
+                barY -= barHeight;
+                nvgBeginPath(nvg);
+                nvgRect(nvg, graphX + i * 2.0f, barY, 2.0f, barHeight);
+                nvgFillColor(nvg, colours[phase]);
+                nvgFill(nvg);
+            }
+        }
+
+        // Line at 16.7 ms, if bars go over it, we're missing frames at 60 fps
+        auto const budgetY = graphY + graphHeight * (1.0f - 16.7f / msPerFrameAtTop);
+        nvgBeginPath(nvg);
+        nvgMoveTo(nvg, graphX, budgetY);
+        nvgLineTo(nvg, graphX + graphWidth, budgetY);
+        nvgStrokeColor(nvg, nvgRGBA(255, 255, 255, 90));
+        nvgStrokeWidth(nvg, 1.0f);
+        nvgStroke(nvg);
+
+        // Legend with averages over the graph
+        double averages[NumPhases] = {};
+        double averageInterval = 0.0;
+        for (auto const& frame : frames) {
+            for (int phase = 0; phase < NumPhases; phase++)
+                averages[phase] += frame.phases[phase] / numFrames;
+            averageInterval += frame.interval / numFrames;
+        }
+
+        char text[128];
+        nvgFontFace(nvg, "Inter-Regular");
+        nvgFontSize(nvg, 11.0f);
+        nvgTextAlign(nvg, NVG_ALIGN_LEFT | NVG_ALIGN_TOP);
+
+        auto const legendX = graphX + graphWidth + 12.0f;
+        auto textY = graphY;
+        nvgFillColor(nvg, nvgRGB(240, 240, 240));
+        snprintf(text, sizeof(text), "%d fps", averageInterval > 0.0 ? static_cast<int>(std::round(1000.0 / averageInterval)) : 0);
+        nvgText(nvg, legendX, textY, text, nullptr);
+        textY += lineHeight;
+
+        for (int phase = 0; phase < NumPhases; phase++) {
+            nvgBeginPath(nvg);
+            nvgRect(nvg, legendX, textY + 3.0f, 8.0f, 8.0f);
+            nvgFillColor(nvg, colours[phase]);
+            nvgFill(nvg);
+
+            nvgFillColor(nvg, nvgRGB(240, 240, 240));
+            snprintf(text, sizeof(text), "%s: %.2f ms", names[phase], averages[phase]);
+            nvgText(nvg, legendX + 12.0f, textY, text, nullptr);
+            textY += lineHeight;
+        }
+
+        textY = graphY + graphHeight + 12.0f;
+        nvgFillColor(nvg, nvgRGB(240, 240, 240));
+        nvgText(nvg, graphX, textY, "Most expensive objects (last second):", nullptr);
+        textY += lineHeight;
+
+        nvgFillColor(nvg, nvgRGB(200, 200, 200));
+        for (auto const& entry : topObjects) {
+            snprintf(text, sizeof(text), "%.2f ms  %s", entry.ms, entry.name.toRawUTF8());
+            nvgText(nvg, graphX, textY, text, nullptr);
+            textY += lineHeight;
+        }
+    }
+
+private:
+    static constexpr int numFrames = 120;
+    static constexpr size_t maxTopObjects = 5;
+
+    struct Frame {
+        double phases[NumPhases] = {};
+        double interval = 0.0;
+    };
+
+    struct ObjectTime {
+        String name;
+        double ms = 0.0;
+    };
+
+    bool enabled = false;
+    int depth = 0;
+
+    std::array<Frame, numFrames> frames = {};
+    Frame currentFrame;
+    int head = 0;
+    double lastFrameStart = 0.0;
+
+    std::unordered_map<void const*, ObjectTime> objectTimes;
+    std::vector<ObjectTime> topObjects;
+    uint32 windowStart = 0;
+};
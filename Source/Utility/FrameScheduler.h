@@ -0,0 +1,93 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Ticks object GUIs that need to poll pd, from the editor's vblank callback
+// Instead of every object running its own timer, they all update right before a frame is rendered
+class FrameScheduler {
+public:
+    class Poller {
+    public:
+        virtual ~Poller()
+        {
+            if (scheduler)
+                scheduler->removePoller(this);
+        }
+
+        virtual void pollFrame() = 0;
+
+        // Pollers that only update what's on screen can return false to skip frames while they can't be seen
+        virtual bool shouldPoll() { return true; }
+
+    private:
+        friend class FrameScheduler;
+        FrameScheduler* scheduler = nullptr;
+        uint32 interval = 0;
+        uint32 lastPoll = 0;
+    };
+
+    ~FrameScheduler()
+    {
+        for (auto* poller : pollers) {
+            if (poller)
+                poller->scheduler = nullptr;
+        }
+    }
+
+    // Polls at most once every intervalMs, 0 means every frame
+    void addPoller(Poller* poller, uint32 intervalMs)
+    {
+        if (poller->scheduler)
+            poller->scheduler->removePoller(poller);
+
+        poller->scheduler = this;
+        poller->interval = intervalMs;
+        pollers.push_back(poller);
+    }
+
+    void setPollInterval(Poller* poller, uint32 intervalMs)
+    {
+        poller->interval = intervalMs;
+    }
+
+    void removePoller(Poller* poller)
+    {
+        auto it = std::find(pollers.begin(), pollers.end(), poller);
+        if (it == pollers.end())
+            return;
+
+        // Pollers can be removed from inside a poll, so only clear the entry while we're iterating
+        if (isTicking)
+            *it = nullptr;
+        else
+            pollers.erase(it);
+
+        poller->scheduler = nullptr;
+    }
+
+    void tick()
+    {
+        auto const now = Time::getMillisecondCounter();
+
+        isTicking = true;
+        for (size_t i = 0; i < pollers.size(); i++) {
+            auto* poller = pollers[i];
+            if (!poller || now - poller->lastPoll < poller->interval || !poller->shouldPoll())
+                continue;
+
+            poller->lastPoll = now;
+            poller->pollFrame();
+        }
+        isTicking = false;
+
+        pollers.erase(std::remove(pollers.begin(), pollers.end(), nullptr), pollers.end());
+    }
+
+private:
+    std::vector<Poller*> pollers;
+    bool isTicking = false;
+};
@@ -22,6 +22,46 @@ public:
         }
     }
 
+    // Protected mode output stage: removes NaN/Inf, applies the gain ramp, and runs the limiter, chunk by chunk while the samples are still in cache
+    // The non-finite check is done on the float bits, so the compiler can vectorise it
+    // Returns the number of non-finite samples that were scrubbed
+    int sanitiseAndProcess(dsp::AudioBlock<float>& block, float const* gainRamp) noexcept
+    {
+        static constexpr size_t chunkSize = 64;
+        static constexpr uint32 exponentMask = 0x7f800000;
+        auto const clipLevel = std::sqrt(2.0f);
+
+        int numScrubbed = 0;
+        auto const numSamples = block.getNumSamples();
+
+        for (size_t channel = 0; channel < block.getNumChannels(); ++channel) {
+            auto* samples = block.getChannelPointer(channel);
+
+            for (size_t start = 0; start < numSamples; start += chunkSize) {
+                auto const chunkEnd = std::min(numSamples, start + chunkSize);
+
+                for (size_t n = start; n < chunkEnd; n++) {
+                    uint32 bits;
+                    std::memcpy(&bits, samples + n, sizeof(float));
+                    auto const isFinite = (bits & exponentMask) != exponentMask;
+                    numScrubbed += !isFinite;
+                    bits &= static_cast<uint32>(-static_cast<int32>(isFinite));
+                    float value;
+                    std::memcpy(&value, &bits, sizeof(float));
+                    samples[n] = value * gainRamp[n];
+                }
+
+                // The compressor envelope is recursive, so this part stays per-sample
+                for (size_t n = start; n < chunkEnd; n++) {
+                    auto const firstStage = firstStageCompressor.processSample(static_cast<int>(channel), samples[n]);
+                    samples[n] = std::clamp(secondStageCompressor.processSample(static_cast<int>(channel), firstStage), -clipLevel, clipLevel);
+                }
+            }
+        }
+
+        return numScrubbed;
+    }
+
     void prepare(dsp::ProcessSpec const& spec)
     {
         jassert(spec.sampleRate > 0);
@@ -0,0 +1,252 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+#include <source_location>
+#include "TraceRecorder.h"
+
+// Measures how long threads wait for pd's lock and the patch list lock, and who holds them for how long
+// Every place that takes a lock is counted separately, by the function and line it was taken from
+// Measuring is on while recording a trace, or when turned on in the diagnostics settings. Holds that take longer than
+// a millisecond also end up in the trace, under the name of the function that held the lock
+// While nothing is measured, taking a lock only costs a relaxed atomic load and a thread_local lookup
+class LockProfiler {
+public:
+    enum Lock {
+        PdLock,
+        PatchesLock,
+        NumLocks
+    };
+
+    // Takes a lock for the scope it's created in, and measures it
+    template<typename LockType>
+    class ScopedLock {
+    public:
+        ScopedLock(LockType& lockToTake, Lock which, std::source_location const& location = std::source_location::current())
+            : lock(lockToTake)
+            , type(which)
+        {
+            enter(lock, type, location);
+        }
+
+        ~ScopedLock()
+        {
+            exit(lock, type);
+        }
+
+    private:
+        LockType& lock;
+        Lock type;
+    };
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed) || TraceRecorder::isRecording(); }
+
+    static void setEnabled(bool shouldBeEnabled)
+    {
+        // Start counting from zero every time we're turned on
+        if (shouldBeEnabled && !enabled.load())
+            reset();
+
+        enabled.store(shouldBeEnabled, std::memory_order_relaxed);
+    }
+
+    template<typename LockType>
+    static void enter(LockType& lock, Lock which, std::source_location const& location = std::source_location::current())
+    {
+        enter(lock, which, location.function_name(), static_cast<int>(location.line()));
+    }
+
+    template<typename LockType>
+    static void enter(LockType& lock, Lock which, char const* function, int line)
+    {
+        if (!isEnabled() || getThreadState().depth[which] > 0) {
+            lock.enter();
+            acquired(which, function, line);
+            return;
+        }
+
+        // Only look at the clock if we actually have to wait
+        int64 waitTicks = 0;
+        if (!lock.tryEnter()) {
+            auto const start = Time::getHighResolutionTicks();
+            lock.enter();
+            waitTicks = Time::getHighResolutionTicks() - start;
+        }
+
+        acquired(which, function, line, waitTicks, waitTicks > 0);
+    }
+
+    template<typename LockType>
+    static void exit(LockType& lock, Lock which)
+    {
+        released(which);
+        lock.exit();
+    }
+
+    // For locks that were taken without going through enter(), like after a successful tryEnter()
+    static void acquired(Lock which, char const* function, int line, int64 waitTicks = 0, bool contended = false)
+    {
+        auto& state = getThreadState();
+        if (state.depth[which]++ > 0)
+            return;
+
+        // Locks taken while we weren't measuring are still counted, so we know when they're released
+        if (!isEnabled()) {
+            state.site[which] = nullptr;
+            return;
+        }
+
+        auto* site = findSite(which, function, line);
+        state.site[which] = site;
+        state.since[which] = Time::getHighResolutionTicks();
+
+        if (!site)
+            return;
+
+        site->numTaken.fetch_add(1, std::memory_order_relaxed);
+        if (contended) {
+            site->numContended.fetch_add(1, std::memory_order_relaxed);
+            site->waitTicks.fetch_add(waitTicks, std::memory_order_relaxed);
+            storeMax(site->maxWaitTicks, waitTicks);
+        }
+    }
+
+    static void released(Lock which)
+    {
+        auto& state = getThreadState();
+        if (state.depth[which] == 0 || --state.depth[which] > 0)
+            return;
+
+        auto* site = state.site[which];
+        if (!site)
+            return;
+
+        auto const now = Time::getHighResolutionTicks();
+        auto const holdTicks = now - state.since[which];
+        site->holdTicks.fetch_add(holdTicks, std::memory_order_relaxed);
+        storeMax(site->maxHoldTicks, holdTicks);
+
+        if (holdTicks >= Time::getHighResolutionTicksPerSecond() / 1000)
+            TraceRecorder::recordSince(site->function.load(std::memory_order_relaxed), state.since[which]);
+
+        state.site[which] = nullptr;
+    }
+
+    // The places that held each lock the longest in total, to print in the console
+    static StringArray getReport(int maxSitesPerLock = 8)
+    {
+        auto const ticksToMs = 1000.0 / static_cast<double>(Time::getHighResolutionTicksPerSecond());
+        auto formatMs = [ticksToMs](int64 ticks) { return String(static_cast<double>(ticks) * ticksToMs, 2) + "ms"; };
+
+        StringArray lines;
+        for (int lock = 0; lock < NumLocks; lock++) {
+            std::vector<Site const*> used;
+            for (auto const& site : sites[lock]) {
+                if (site.function.load(std::memory_order_relaxed) && site.numTaken.load(std::memory_order_relaxed) > 0)
+                    used.push_back(&site);
+            }
+
+            std::sort(used.begin(), used.end(), [](auto const* a, auto const* b) {
+                return a->holdTicks.load(std::memory_order_relaxed) > b->holdTicks.load(std::memory_order_relaxed);
+            });
+
+            lines.add(String(lock == PdLock ? "pd lock" : "Patch list lock") + ": taken from " + String(static_cast<int>(used.size())) + " places");
+            for (size_t i = 0; i < used.size() && i < static_cast<size_t>(maxSitesPerLock); i++) {
+                auto const& site = *used[i];
+                auto const numTaken = site.numTaken.load(std::memory_order_relaxed);
+                auto const numContended = site.numContended.load(std::memory_order_relaxed);
+                lines.add("  " + String(site.function.load(std::memory_order_relaxed)) + ":" + String(site.line.load(std::memory_order_relaxed))
+                    + ": taken " + String(numTaken) + "x, held " + formatMs(site.holdTicks.load(std::memory_order_relaxed)) + " (max " + formatMs(site.maxHoldTicks.load(std::memory_order_relaxed)) + ")"
+                    + ", waited " + String(numContended) + "x for " + formatMs(site.waitTicks.load(std::memory_order_relaxed)) + " (max " + formatMs(site.maxWaitTicks.load(std::memory_order_relaxed)) + ")");
+            }
+
+            if (auto const dropped = numDroppedSites[lock].load(std::memory_order_relaxed))
+                lines.add("  " + String(dropped) + " more places weren't measured");
+        }
+
+        return lines;
+    }
+
+private:
+    struct Site {
+        std::atomic<uint64> key = 0;
+        std::atomic<char const*> function = nullptr;
+        std::atomic<int> line = 0;
+
+        std::atomic<int64> numTaken = 0;
+        std::atomic<int64> numContended = 0;
+        std::atomic<int64> waitTicks = 0;
+        std::atomic<int64> maxWaitTicks = 0;
+        std::atomic<int64> holdTicks = 0;
+        std::atomic<int64> maxHoldTicks = 0;
+    };
+
+    struct ThreadState {
+        int depth[NumLocks] = {};
+        int64 since[NumLocks] = {};
+        Site* site[NumLocks] = {};
+    };
+
+    static constexpr int maxSites = 256;
+
+    static ThreadState& getThreadState()
+    {
+        static thread_local ThreadState state;
+        return state;
+    }
+
+    // Open addressing on the address of the function name and the line, so finding a site never allocates or locks
+    static Site* findSite(Lock which, char const* function, int line)
+    {
+        auto const key = (static_cast<uint64>(reinterpret_cast<pointer_sized_int>(function)) * 31 + static_cast<uint64>(line)) | 1;
+        auto index = static_cast<int>((key >> 4) % maxSites);
+
+        for (int probe = 0; probe < maxSites; probe++) {
+            auto& site = sites[which][index];
+            auto existing = site.key.load(std::memory_order_acquire);
+            if (existing == 0 && site.key.compare_exchange_strong(existing, key, std::memory_order_acq_rel)) {
+                site.line.store(line, std::memory_order_relaxed);
+                site.function.store(function, std::memory_order_release);
+                return &site;
+            }
+            if (existing == key)
+                return &site;
+
+            index = (index + 1) % maxSites;
+        }
+
+        numDroppedSites[which].fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // Sites keep their place in the table, so threads that hold a lock right now can still write to them
+    static void reset()
+    {
+        for (auto& lockSites : sites) {
+            for (auto& site : lockSites) {
+                site.numTaken = 0;
+                site.numContended = 0;
+                site.waitTicks = 0;
+                site.maxWaitTicks = 0;
+                site.holdTicks = 0;
+                site.maxHoldTicks = 0;
+            }
+        }
+        for (auto& dropped : numDroppedSites)
+            dropped = 0;
+    }
+
+    static void storeMax(std::atomic<int64>& target, int64 value)
+    {
+        auto current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) { }
+    }
+
+    static inline std::atomic<bool> enabled = false;
+    static inline Site sites[NumLocks][maxSites];
+    static inline std::atomic<int64> numDroppedSites[NumLocks] = {};
+};
@@ -0,0 +1,101 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Preallocated single-producer single-consumer byte ring for console output
+// Each record is a fixed header followed by the raw text, so writing a line from the audio thread is just a couple of memcpys
+class LogRing {
+public:
+    enum RecordType : uint32 {
+        Line,      // A line of text
+        Repeat,    // The previous line was printed again this many times
+        Suppressed // This many lines from the object were dropped by the rate limiter
+    };
+
+    struct Header {
+        void* object;
+        RecordType type;
+        uint32 size; // Text length for lines, count for the other types
+    };
+
+    explicit LogRing(int capacity)
+        : fifo(capacity)
+        , buffer(static_cast<size_t>(capacity))
+    {
+    }
+
+    // Returns false if there was no room, in which case nothing was written
+    bool write(void* object, RecordType type, uint32 size, char const* text = nullptr)
+    {
+        auto const textLength = type == Line ? static_cast<int>(size) : 0;
+        auto const recordSize = static_cast<int>(sizeof(Header)) + textLength;
+
+        if (fifo.getFreeSpace() < recordSize)
+            return false;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(recordSize, start1, size1, start2, size2);
+
+        Header const header { object, type, size };
+        int written = 0;
+        copyIn(reinterpret_cast<char const*>(&header), sizeof(Header), start1, size1, start2, written);
+        if (textLength > 0)
+            copyIn(text, textLength, start1, size1, start2, written);
+
+        fifo.finishedWrite(recordSize);
+        return true;
+    }
+
+    // Calls callback(header, text) for every complete record, text is only valid for the duration of the call
+    template<typename Callback>
+    void read(Callback const& callback)
+    {
+        while (fifo.getNumReady() >= static_cast<int>(sizeof(Header))) {
+            Header header;
+            readBytes(reinterpret_cast<char*>(&header), sizeof(Header));
+
+            auto const textLength = header.type == Line ? static_cast<int>(header.size) : 0;
+            if (textLength > 0)
+                readBytes(text.data(), textLength);
+
+            callback(header, text.data());
+        }
+    }
+
+    static constexpr int maxLineLength = 2048;
+
+private:
+    void copyIn(char const* source, int numBytes, int start1, int size1, int start2, int& written)
+    {
+        auto const firstPart = std::min(numBytes, std::max(0, size1 - written));
+        if (firstPart > 0)
+            std::memcpy(buffer.data() + start1 + written, source, static_cast<size_t>(firstPart));
+        if (numBytes > firstPart)
+            std::memcpy(buffer.data() + start2 + (written + firstPart - size1), source + firstPart, static_cast<size_t>(numBytes - firstPart));
+
+        written += numBytes;
+    }
+
+    void readBytes(char* destination, int numBytes)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numBytes, start1, size1, start2, size2);
+
+        if (size1 > 0)
+            std::memcpy(destination, buffer.data() + start1, static_cast<size_t>(size1));
+        if (size2 > 0)
+            std::memcpy(destination + size1, buffer.data() + start2, static_cast<size_t>(size2));
+
+        fifo.finishedRead(size1 + size2);
+    }
+
+    AbstractFifo fifo;
+    std::vector<char> buffer;
+    std::array<char, maxLineLength> text;
+
+    JUCE_DECLARE_NON_COPYABLE(LogRing)
+};
@@ -6,78 +6,86 @@
 
 #pragma once
 #include <juce_audio_utils/juce_audio_utils.h>
+#include <readerwriterqueue.h>
 #include "Standalone/InternalSynth.h"
 
 class MidiDeviceManager : public ChangeListener
     , public AsyncUpdater {
 
 public:
-    // Helper functions to encode/decode regular MIDI events into a sysex event
-    // The reason we do this, is that we want to append extra information to the MIDI event when it comes in from pd or the device, but JUCE won't allow this
-    // We still want to be able to use handy JUCE stuff for MIDI timing, so we treat every MIDI event as sysex
-    static std::vector<uint16_t> encodeSysExData(std::vector<uint8_t> const& data)
+    // In the standalone, every MIDI event carries the index of the device it came from or goes to
+    // JUCE won't let us attach anything to a MIDI event, but we still want its buffers and timing, so we wrap every event in sysex:
+    // F0, device index as two 7-bit bytes, the original bytes with F7 and the escape byte escaped, F7
+    // A channel message wrapped like this is 7 bytes, which fits inside a MidiMessage without allocating
+    static constexpr uint8 escapeByte = 0xFD;
+
+    static MidiMessage convertToSysExFormat(MidiMessage const& m, int device)
     {
-        std::vector<uint16_t> encodedData;
-        for (auto& value : data) {
-            if (value == 0xF0 || value == 0xF7) {
-                // If the value is 0xF0 or 0xF7, encode them in the higher 8 bits. 0xF0 and 0xF8 are already at the top end, so we only need to shift them by 1 position to put it outside of MIDI range. We can't shift by 8, the sysex bytes could still be recognised as sysex bytes!
-                encodedData.push_back(static_cast<uint16_t>(value) << 1);
-            } else {
-                // Otherwise, just cast the 8-bit value to a 16-bit value
-                encodedData.push_back(static_cast<uint16_t>(value));
-            }
+        if (!ProjectInfo::isStandalone)
+            return m;
+
+        auto const* data = m.getRawData();
+        auto const size = m.getRawDataSize();
+
+        uint8 stackBuffer[64];
+        HeapBlock<uint8> heapBuffer;
+        auto* encoded = stackBuffer;
+        if (size * 2 + 4 > static_cast<int>(sizeof(stackBuffer))) {
+            heapBuffer.malloc(size * 2 + 4);
+            encoded = heapBuffer.get();
         }
-        return encodedData;
-    }
 
-    static std::vector<uint8_t> decodeSysExData(std::vector<uint16_t> const& encodedData)
-    {
-        std::vector<uint8_t> decodeData;
-        for (auto& value : encodedData) {
-            auto upperByte = value >> 1;
-            if (upperByte == 0xF0 || upperByte == 0xF7) {
-                decodeData.push_back(upperByte);
+        int length = 0;
+        encoded[length++] = 0xF0;
+        encoded[length++] = static_cast<uint8>(device & 0x7F);
+        encoded[length++] = static_cast<uint8>((device >> 7) & 0x7F);
+        for (int i = 0; i < size; i++) {
+            if (data[i] == 0xF7 || data[i] == escapeByte) {
+                encoded[length++] = escapeByte;
+                encoded[length++] = data[i] == 0xF7 ? 1 : 2;
             } else {
-                // Extract the lower 8 bits to obtain the original 8-bit data
-                decodeData.push_back(static_cast<uint8_t>(value));
+                encoded[length++] = data[i];
             }
         }
-        return decodeData;
-    }
+        encoded[length++] = 0xF7;
 
-    static MidiMessage convertToSysExFormat(MidiMessage m, int device)
-    {
-        if (ProjectInfo::isStandalone) {
-            // We append the device index so we can use it as a selector later
-            auto const* data = static_cast<uint8 const*>(m.getRawData());
-            auto message = std::vector<uint8>(data, data + m.getRawDataSize());
-            message.push_back(device);
-            auto encodedMessage = encodeSysExData(message);
-
-            // Temporarily convert all messages to sysex so we can add as much data as we want
-            return MidiMessage::createSysExMessage(static_cast<void*>(encodedMessage.data()), encodedMessage.size() * sizeof(uint16_t)).withTimeStamp(m.getTimeStamp());
-        }
-
-        return m;
+        return MidiMessage(encoded, length, m.getTimeStamp());
     }
 
-    static MidiMessage convertFromSysExFormat(MidiMessage m, int& device)
+    static MidiMessage convertFromSysExFormat(MidiMessage const& m, int& device)
     {
-        if (ProjectInfo::isStandalone) {
-            auto const* sysexData = reinterpret_cast<uint16_t const*>(m.getSysExData());
-            auto sysexDataSize = m.getSysExDataSize() / sizeof(uint16_t);
-            auto midiMessage = decodeSysExData(std::vector<uint16_t>(sysexData, sysexData + sysexDataSize));
-            if (!sysexData)
-                return m;
-
-            device = midiMessage.back();
-            midiMessage.pop_back();
+        device = 0;
+        if (!ProjectInfo::isStandalone)
+            return m;
+
+        auto const* data = m.getRawData();
+        auto const size = m.getRawDataSize();
+        if (size < 4 || data[0] != 0xF0)
+            return m;
+
+        device = data[1] | (data[2] << 7);
+
+        uint8 stackBuffer[64];
+        HeapBlock<uint8> heapBuffer;
+        auto* decoded = stackBuffer;
+        if (size > static_cast<int>(sizeof(stackBuffer))) {
+            heapBuffer.malloc(size);
+            decoded = heapBuffer.get();
+        }
 
-            return MidiMessage(midiMessage.data(), midiMessage.size());
+        int length = 0;
+        for (int i = 3; i < size - 1; i++) {
+            if (data[i] == escapeByte && i + 1 < size - 1) {
+                decoded[length++] = data[++i] == 1 ? 0xF7 : escapeByte;
+            } else {
+                decoded[length++] = data[i];
+            }
         }
 
-        device = 0;
-        return m;
+        if (length == 0)
+            return m;
+
+        return MidiMessage(decoded, length, m.getTimeStamp());
     }
 
     MidiDeviceManager(MidiInputCallback* inputCallback)
@@ -96,10 +104,13 @@ public:
 
         filteredMidiInputs = filteredMidiOutputs = 0;
         updateMidiDevices();
+
+        midiOutputThread.startThread(Thread::Priority::highest);
     }
 
     ~MidiDeviceManager()
     {
+        midiOutputThread.stopThread(1000);
         saveMidiOutputSettings();
         clearInputFilter();
         clearOutputFilter();
@@ -329,6 +340,9 @@ public:
             }
         } else if (shouldBeEnabled != isMidiDeviceEnabled(false, identifier)) {
             clearOutputFilter();
+
+            // The MIDI output thread might be sending to this list
+            std::lock_guard<std::mutex> lock(midiOutputMutex);
             if (shouldBeEnabled) {
                 auto* device = midiOutputs.add(MidiOutput::openDevice(identifier));
                 if (device)
@@ -346,8 +360,18 @@ public:
         }
     }
 
+    // Audio thread: queues a message for the MIDI output thread, which sends it once Time::getMillisecondCounterHiRes() reaches timeToSend
+    // This never blocks, so the OS MIDI APIs can't hold up the audio callback
+    void queueMidiOutputMessage(int device, MidiMessage&& message, double timeToSend)
+    {
+        midiOutputThread.queue.try_enqueue({ device, std::move(message), timeToSend });
+    }
+
+    // Sends a message right away, from the MIDI output thread
     void sendMidiOutputMessage(int device, MidiMessage& message)
     {
+        std::lock_guard<std::mutex> lock(midiOutputMutex);
+
         // Device ID 0 means all devices
         if (device == 0) {
             for (auto* midiOutput : midiOutputs) {
@@ -388,6 +412,55 @@ public:
     }
 
 private:
+    // Sends queued MIDI output at the time it's due, on a high priority thread
+    // Messages come from the audio thread in order, so we only ever have to look at the first one
+    class MidiOutputThread final : public Thread {
+    public:
+        struct PendingMessage {
+            int device = 0;
+            MidiMessage message;
+            double timeToSend = 0.0;
+        };
+
+        explicit MidiOutputThread(MidiDeviceManager& deviceManager)
+            : Thread("MIDI Output")
+            , manager(deviceManager)
+        {
+        }
+
+        void run() override
+        {
+            while (!threadShouldExit()) {
+                auto* next = queue.peek();
+                if (!next) {
+                    Thread::sleep(1);
+                    continue;
+                }
+
+                auto const timeLeft = next->timeToSend - Time::getMillisecondCounterHiRes();
+                if (timeLeft > 1.5) {
+                    Thread::sleep(static_cast<int>(timeLeft - 1.0));
+                    continue;
+                }
+
+                // The last stretch is too short to sleep through accurately
+                while (next->timeToSend > Time::getMillisecondCounterHiRes() && !threadShouldExit())
+                    Thread::yield();
+
+                manager.sendMidiOutputMessage(next->device, next->message);
+                queue.pop();
+            }
+        }
+
+        moodycamel::ReaderWriterQueue<PendingMessage> queue { 4096 };
+
+    private:
+        MidiDeviceManager& manager;
+    };
+
+    MidiOutputThread midiOutputThread { *this };
+    std::mutex midiOutputMutex;
+
     bool internalOutputEnabled = false;
     bool internalInputEnabled = false;
 
@@ -0,0 +1,111 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Min/max summary of a buffer, so we can find the peaks of any range without looking at every sample
+// The first level holds the range of every block of samples, each level above it combines two blocks of the level below
+// Finding the range of a span only reads the raw samples at its edges, and then takes the coarsest blocks that fit inside
+class MinMaxPyramid {
+public:
+    // Recalculates the blocks that cover samples [start, end)
+    // If the number of samples changed, everything gets recalculated
+    void update(float const* samples, int numSamples, int start, int end)
+    {
+        if (numSamples != size) {
+            size = numSamples;
+            start = 0;
+            end = numSamples;
+
+            levels.clear();
+            auto numBlocks = (numSamples + blockSize - 1) / blockSize;
+            while (numBlocks > 0) {
+                levels.emplace_back(static_cast<size_t>(numBlocks));
+                if (numBlocks == 1)
+                    break;
+                numBlocks = (numBlocks + 1) / 2;
+            }
+        }
+
+        start = std::clamp(start, 0, size);
+        end = std::clamp(end, start, size);
+        if (levels.empty() || start == end)
+            return;
+
+        auto firstBlock = start / blockSize;
+        auto lastBlock = (end - 1) / blockSize;
+
+        auto& base = levels[0];
+        for (int block = firstBlock; block <= lastBlock; block++) {
+            auto const blockStart = block * blockSize;
+            base[block] = FloatVectorOperations::findMinAndMax(samples + blockStart, std::min(blockSize, size - blockStart));
+        }
+
+        for (size_t level = 1; level < levels.size(); level++) {
+            firstBlock /= 2;
+            lastBlock /= 2;
+
+            auto const& below = levels[level - 1];
+            auto& current = levels[level];
+            for (int block = firstBlock; block <= lastBlock; block++) {
+                auto range = below[block * 2];
+                if (block * 2 + 1 < static_cast<int>(below.size()))
+                    range = range.getUnionWith(below[block * 2 + 1]);
+                current[block] = range;
+            }
+        }
+    }
+
+    // Lowest and highest sample in [start, end)
+    Range<float> getRange(float const* samples, int start, int end) const
+    {
+        start = std::clamp(start, 0, size);
+        end = std::clamp(end, start, size);
+
+        Range<float> result;
+        bool hasResult = false;
+        auto add = [&result, &hasResult](Range<float> range) {
+            result = hasResult ? result.getUnionWith(range) : range;
+            hasResult = true;
+        };
+
+        // Blocks that are completely inside the span
+        auto firstBlock = (start + blockSize - 1) / blockSize;
+        auto lastBlock = end / blockSize;
+
+        if (levels.empty() || firstBlock >= lastBlock) {
+            if (end > start)
+                add(FloatVectorOperations::findMinAndMax(samples + start, end - start));
+            return result;
+        }
+
+        if (auto const leading = firstBlock * blockSize - start; leading > 0)
+            add(FloatVectorOperations::findMinAndMax(samples + start, leading));
+        if (auto const trailing = end - lastBlock * blockSize; trailing > 0)
+            add(FloatVectorOperations::findMinAndMax(samples + lastBlock * blockSize, trailing));
+
+        // Walk up the levels, taking the blocks at the edges that don't combine into a block of the next level
+        for (size_t level = 0; level < levels.size() && firstBlock < lastBlock; level++) {
+            if (firstBlock & 1)
+                add(levels[level][firstBlock++]);
+            if (lastBlock & 1)
+                add(levels[level][--lastBlock]);
+
+            firstBlock /= 2;
+            lastBlock /= 2;
+        }
+
+        return result;
+    }
+
+    int getNumSamples() const { return size; }
+
+private:
+    static constexpr int blockSize = 16;
+
+    std::vector<std::vector<Range<float>>> levels;
+    int size = 0;
+};
@@ -18,6 +18,75 @@
 #include "PluginProcessor.h"
 #include "Objects/IEMHelper.h"
 #include "Objects/CanvasObject.h"
+#include "Utility/SettingsFile.h"
+#include "Utility/BackgroundTasks.h"
+
+// Object bounds of every patch we've drawn, by the hash of the patch content
+// They're also written to appDataDir, so palettes and recently opened patches don't need to be parsed again after a restart
+struct ThumbnailCache : public DeletedAtShutdown {
+    ~ThumbnailCache() override
+    {
+        tasks.cancelAndWait();
+        clearSingletonInstance();
+    }
+
+    std::optional<Array<Rectangle<int>>> get(String const& hash)
+    {
+        {
+            ScopedLock lock(cacheLock);
+            if (auto it = cache.find(hash); it != cache.end())
+                return it->second;
+        }
+
+        MemoryBlock data;
+        if (!directory.getChildFile(hash).loadFileAsData(data))
+            return std::nullopt;
+
+        Array<Rectangle<int>> bounds;
+        MemoryInputStream istream(data, false);
+        while (!istream.isExhausted()) {
+            int const x = istream.readCompressedInt();
+            int const y = istream.readCompressedInt();
+            int const w = istream.readCompressedInt();
+            int const h = istream.readCompressedInt();
+            bounds.add({ x, y, w, h });
+        }
+
+        ScopedLock lock(cacheLock);
+        cache[hash] = bounds;
+        return bounds;
+    }
+
+    void set(String const& hash, Array<Rectangle<int>> const& bounds)
+    {
+        {
+            ScopedLock lock(cacheLock);
+            cache[hash] = bounds;
+        }
+
+        MemoryOutputStream ostream;
+        for (auto& b : bounds) {
+            ostream.writeCompressedInt(b.getX());
+            ostream.writeCompressedInt(b.getY());
+            ostream.writeCompressedInt(b.getWidth());
+            ostream.writeCompressedInt(b.getHeight());
+        }
+
+        directory.createDirectory();
+        directory.getChildFile(hash).replaceWithData(ostream.getData(), ostream.getDataSize());
+    }
+
+    CriticalSection cacheLock;
+    std::unordered_map<String, Array<Rectangle<int>>> cache;
+    File const directory = ProjectInfo::appDataDir.getChildFile(".thumbnails");
+
+    // Generates thumbnails in the background
+    BackgroundTasks::TaskGroup tasks;
+
+    JUCE_DECLARE_SINGLETON(ThumbnailCache, false)
+};
+
+JUCE_IMPLEMENT_SINGLETON(ThumbnailCache)
 
 
 ImageWithOffset OfflineObjectRenderer::patchToMaskedImage(String const& patch, float scale, bool makeInvalidImage)
@@ -48,9 +117,30 @@ ImageWithOffset OfflineObjectRenderer::patchToMaskedImage(String const& patch, f
     return ImageWithOffset(output, image.offset);
 }
 
-bool OfflineObjectRenderer::parseGraphSize(String const& objectText, Rectangle<int>& bounds)
+Array<File> OfflineObjectRenderer::getSearchPaths()
 {
-    auto patchFile = pd::Library::findPatch(objectText.upToFirstOccurrenceOf(" ", false, false));
+    // The settings tree can only be read from the message thread, so background jobs get a copy of the paths
+    Array<File> searchPaths;
+    auto pathTree = SettingsFile::getInstance()->getValueTree().getChildWithName("Paths");
+    for (auto path : pathTree) {
+        auto searchPath = File(path.getProperty("Path").toString());
+        if (searchPath.isDirectory())
+            searchPaths.add(searchPath);
+    }
+    return searchPaths;
+}
+
+bool OfflineObjectRenderer::parseGraphSize(String const& objectText, Rectangle<int>& bounds, Array<File> const& searchPaths)
+{
+    auto patchName = objectText.upToFirstOccurrenceOf(" ", false, false) + ".pd";
+    File patchFile;
+    for (auto& searchPath : searchPaths) {
+        auto childFile = searchPath.getChildFile(patchName);
+        if (childFile.existsAsFile()) {
+            patchFile = childFile;
+            break;
+        }
+    }
     if(!patchFile.existsAsFile()) return false;
     
     auto patchAsString = patchFile.loadFileAsString();
@@ -148,11 +238,11 @@ void OfflineObjectRenderer::parsePatch(String const& patch, std::function<void(P
     }
 }
 
-Array<Rectangle<int>> OfflineObjectRenderer::getObjectBoundsForPatch(String const& patch)
+Array<Rectangle<int>> OfflineObjectRenderer::getObjectBoundsForPatch(String const& patch, Array<File> const& searchPaths)
 {
     Array<Rectangle<int>> objectBounds;
     
-    parsePatch(patch, [&objectBounds](PatchItemType type, int depth, String const& text){
+    parsePatch(patch, [&objectBounds, &searchPaths](PatchItemType type, int depth, String const& text){
         if((type != PatchItemType::Object &&  type != PatchItemType::Message && type != PatchItemType::Comment) || depth != 0) return;
         
         auto tokens = StringArray::fromTokens(text, true);
@@ -278,7 +368,7 @@ Array<Rectangle<int>> OfflineObjectRenderer::getObjectBoundsForPatch(String cons
             
             tokens.removeRange(0, 4);
             auto text = tokens.joinIntoString(" ");
-            auto wasGraph = parseGraphSize(text, bounds);
+            auto wasGraph = parseGraphSize(text, bounds, searchPaths);
             
             if(!wasGraph)
             {
@@ -301,10 +391,43 @@ Array<Rectangle<int>> OfflineObjectRenderer::getObjectBoundsForPatch(String cons
 }
 
 
+Array<Rectangle<int>> OfflineObjectRenderer::getCachedObjectBounds(String const& patch, Array<File> const& searchPaths)
+{
+    auto* cache = ThumbnailCache::getInstance();
+    auto const patchSHA256 = SHA256(patch.getCharPointer()).toHexString();
+    if (auto cached = cache->get(patchSHA256)) {
+        return *cached;
+    }
+
+    auto objectRects = getObjectBoundsForPatch(patch, searchPaths);
+    cache->set(patchSHA256, objectRects);
+    return objectRects;
+}
+
+void OfflineObjectRenderer::prepareThumbnail(String const& patch)
+{
+    ThumbnailCache::getInstance()->tasks.addJob("OfflineObjectRenderer::prepareThumbnail", [patch, searchPaths = getSearchPaths()]() {
+        getCachedObjectBounds(patch, searchPaths);
+    }, BackgroundTasks::Low);
+}
+
+void OfflineObjectRenderer::patchFileToSVGAsync(File const& patchFile, std::function<void(String const&)> callback)
+{
+    ThumbnailCache::getInstance()->tasks.addJob("OfflineObjectRenderer::patchFileToSVG", [patchFile, callback, searchPaths = getSearchPaths()]() {
+        auto svg = boundsToSVG(getCachedObjectBounds(patchFile.loadFileAsString(), searchPaths));
+        MessageManager::callAsync([callback, svg]() {
+            callback(svg);
+        });
+    });
+}
+
 String OfflineObjectRenderer::patchToSVG(String const& patch)
 {
-    auto objectRects = getObjectBoundsForPatch(patch);
-    
+    return boundsToSVG(getCachedObjectBounds(patch, getSearchPaths()));
+}
+
+String OfflineObjectRenderer::boundsToSVG(Array<Rectangle<int>> const& objectRects)
+{
     String svgContent;
     auto regionOfInterest = Rectangle<int>();
     for (auto& b : objectRects) {
@@ -325,12 +448,12 @@ ImageWithOffset OfflineObjectRenderer::patchToTempImage(String const& patch, flo
 {
     static std::unordered_map<String, ImageWithOffset> patchImageCache;
 
-    auto const patchSHA256 = SHA256(patch.getCharPointer()).toHexString();
-    if (patchImageCache.contains(patchSHA256)) {
-        return patchImageCache[patchSHA256];
+    auto const imageKey = SHA256(patch.getCharPointer()).toHexString() + String(scale);
+    if (patchImageCache.contains(imageKey)) {
+        return patchImageCache[imageKey];
     }
     
-    auto objectRects = getObjectBoundsForPatch(patch);
+    auto objectRects = getCachedObjectBounds(patch, getSearchPaths());
     Rectangle<int> totalSize;
     
     for (auto& rect : objectRects) {
@@ -355,7 +478,7 @@ ImageWithOffset OfflineObjectRenderer::patchToTempImage(String const& patch, flo
     }
 
     auto output = ImageWithOffset(image, size);
-    patchImageCache.emplace(patchSHA256, output);
+    patchImageCache.emplace(imageKey, output);
     return output;
 }
 
@@ -26,14 +26,25 @@ public:
     
     static String patchToSVG(String const& patch);
     static ImageWithOffset patchToMaskedImage(String const& patch, float scale, bool makeInvalidImage = false);
+
+    // Reads and draws a patch file in the background, and calls back on the message thread when the svg is ready
+    static void patchFileToSVGAsync(File const& patchFile, std::function<void(String const&)> callback);
+
+    // Works out the object bounds for a patch in the background, so drawing it later is quick
+    static void prepareThumbnail(String const& patch);
     
     static std::pair<std::vector<bool>, std::vector<bool>> countIolets(String const& patch);
     static bool checkIfPatchIsValid(String const& patch);
 
 private:
     
-    static Array<Rectangle<int>> getObjectBoundsForPatch(String const& patch);
-    static bool parseGraphSize(String const& objectText, Rectangle<int>& bounds);
+    static Array<Rectangle<int>> getObjectBoundsForPatch(String const& patch, Array<File> const& searchPaths);
+    static bool parseGraphSize(String const& objectText, Rectangle<int>& bounds, Array<File> const& searchPaths);
+
+    // Object bounds are cached by the hash of the patch content, in memory and in appDataDir
+    static Array<Rectangle<int>> getCachedObjectBounds(String const& patch, Array<File> const& searchPaths);
+    static Array<File> getSearchPaths();
+    static String boundsToSVG(Array<Rectangle<int>> const& objectRects);
 
     static ImageWithOffset patchToTempImage(String const& patch, float scale);
     
@@ -0,0 +1,152 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Sends the host playhead to [playhead] objects through the "_playhead" receiver
+// Only the fields that changed since the last successful send are sent, using symbols that were interned up front
+// Nothing in here allocates, so it's safe to use from the audio callback
+class PlayheadInjector {
+    enum FieldType {
+        Playing = 0,
+        Recording,
+        Looping,
+        EditTime,
+        FrameRate,
+        Bpm,
+        LastBar,
+        TimeSignature,
+        Position,
+        NumFields
+    };
+
+    struct Field {
+        t_symbol* selector = nullptr;
+        float values[3] = { 0.0f, 0.0f, 0.0f };
+        float lastSent[3] = { 0.0f, 0.0f, 0.0f };
+        int numValues = 0;
+        bool hasValue = false;
+        bool wasSent = false;
+
+        void set(float a, float b = 0.0f, float c = 0.0f)
+        {
+            values[0] = a;
+            values[1] = b;
+            values[2] = c;
+            hasValue = true;
+        }
+
+        bool needsSending() const
+        {
+            if (!hasValue)
+                return false;
+            if (!wasSent)
+                return true;
+
+            for (int i = 0; i < numValues; i++) {
+                if (values[i] != lastSent[i])
+                    return true;
+            }
+            return false;
+        }
+    };
+
+public:
+    void initialise(pd::Instance& instance)
+    {
+        receiver = instance.generateSymbol("_playhead");
+
+        static char const* const selectorNames[NumFields] = { "playing", "recording", "looping", "edittime", "framerate", "bpm", "lastbar", "timesig", "position" };
+        static int const numValues[NumFields] = { 1, 1, 3, 1, 1, 1, 1, 2, 3 };
+
+        for (int i = 0; i < NumFields; i++) {
+            fields[i].selector = instance.generateSymbol(selectorNames[i]);
+            fields[i].numValues = numValues[i];
+        }
+
+        reset();
+    }
+
+    // Forget what we sent, so the next send contains the complete state
+    void reset()
+    {
+        for (auto& field : fields) {
+            field.wasSent = false;
+        }
+    }
+
+    // Returns true if there is anything to send
+    bool update(AudioPlayHead::PositionInfo const& info)
+    {
+        // If no [playhead] object exists, skip all work, and make sure the first one to show up gets the full state
+        if (!receiver || !receiver->s_thing) {
+            reset();
+            return false;
+        }
+
+        fields[Playing].set(static_cast<float>(info.getIsPlaying()));
+        fields[Recording].set(static_cast<float>(info.getIsRecording()));
+
+        if (auto loopPoints = info.getLoopPoints(); loopPoints.hasValue()) {
+            fields[Looping].set(static_cast<float>(info.getIsLooping()), static_cast<float>(loopPoints->ppqStart), static_cast<float>(loopPoints->ppqEnd));
+        } else {
+            fields[Looping].set(static_cast<float>(info.getIsLooping()));
+        }
+
+        if (auto editTime = info.getEditOriginTime(); editTime.hasValue())
+            fields[EditTime].set(static_cast<float>(*editTime));
+
+        if (auto frameRate = info.getFrameRate(); frameRate.hasValue())
+            fields[FrameRate].set(static_cast<float>(frameRate->getEffectiveRate()));
+
+        if (auto bpm = info.getBpm(); bpm.hasValue())
+            fields[Bpm].set(static_cast<float>(*bpm));
+
+        if (auto lastBar = info.getPpqPositionOfLastBarStart(); lastBar.hasValue())
+            fields[LastBar].set(static_cast<float>(*lastBar));
+
+        if (auto timeSignature = info.getTimeSignature(); timeSignature.hasValue())
+            fields[TimeSignature].set(static_cast<float>(timeSignature->numerator), static_cast<float>(timeSignature->denominator));
+
+        auto ppq = info.getPpqPosition();
+        auto samplesTime = info.getTimeInSamples();
+        auto secondsTime = info.getTimeInSeconds();
+        if (ppq.hasValue() || samplesTime.hasValue() || secondsTime.hasValue()) {
+            fields[Position].set(ppq.hasValue() ? static_cast<float>(*ppq) : 0.0f,
+                samplesTime.hasValue() ? static_cast<float>(*samplesTime) : 0.0f,
+                secondsTime.hasValue() ? static_cast<float>(*secondsTime) : 0.0f);
+        }
+
+        return std::any_of(std::begin(fields), std::end(fields), [](Field const& field) { return field.needsSending(); });
+    }
+
+    // Needs to be called while holding the pd lock, with the correct pd instance set
+    void send()
+    {
+        t_atom atoms[3];
+
+        for (auto& field : fields) {
+            if (!field.needsSending())
+                continue;
+
+            auto* target = receiver->s_thing;
+            if (!target)
+                return;
+
+            for (int i = 0; i < field.numValues; i++) {
+                SETFLOAT(atoms + i, field.values[i]);
+                field.lastSent[i] = field.values[i];
+            }
+            field.wasSent = true;
+
+            pd_typedmess(target, field.selector, field.numValues, atoms);
+        }
+    }
+
+private:
+    t_symbol* receiver = nullptr;
+    Field fields[NumFields];
+};
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <juce_audio_processors/juce_audio_processors.h>
+#include "Pd/ParameterRamp.h"
 
 class PlugDataParameter : public RangedAudioParameter {
 public:
@@ -84,6 +85,16 @@ public:
     {
         ScopedLock lock(nameLock);
         parameterName = newName;
+        internReceiverSymbol();
+    }
+
+    // Intern the receiver symbol when the name changes, so the audio thread never has to look it up
+    void internReceiverSymbol()
+    {
+        if (processor.instance) {
+            receiverSymbol = processor.generateSymbol(getTitle());
+            rampReceiverSymbol = processor.generateSymbol(pd::ParameterRamp::receiverPrefix + getTitle());
+        }
     }
 
     String getName(int maximumStringLength) const override
@@ -105,6 +116,8 @@ public:
     void setEnabled(bool shouldBeEnabled)
     {
         enabled = shouldBeEnabled;
+        if (shouldBeEnabled)
+            markDirty();
     }
 
     NormalisableRange<float> const& getNormalisableRange() const override
@@ -129,6 +142,7 @@ public:
     {
         auto range = getNormalisableRange();
         value = std::clamp(newValue, range.start, range.end);
+        markDirty();
         sendValueChangedMessageToListeners(getValue());
     }
 
@@ -142,6 +156,7 @@ public:
     {
         auto range = getNormalisableRange();
         value = range.convertFrom0to1(newValue);
+        markDirty();
     }
 
     float getDefaultValue() const override
@@ -277,6 +292,36 @@ public:
         }
     }
 
+    t_symbol* getReceiverSymbol() const
+    {
+        return receiverSymbol;
+    }
+
+    // Where [param~] objects for this parameter listen
+    t_symbol* getRampReceiverSymbol() const
+    {
+        return rampReceiverSymbol;
+    }
+
+    // A [param~] was created and wants to know the current value, even if it didn't change
+    void requestResend()
+    {
+        resendPending = true;
+        markDirty();
+    }
+
+    bool takeResendRequest()
+    {
+        return resendPending.exchange(false, std::memory_order_relaxed);
+    }
+
+    // Tells the processor that this parameter needs to be sent to pd on the next block
+    void markDirty()
+    {
+        if (auto parameterIndex = getParameterIndex(); parameterIndex >= 0)
+            processor.markParameterDirty(parameterIndex);
+    }
+
     void setLastValue(float v)
     {
         lastValue = v;
@@ -328,6 +373,9 @@ private:
 
     CriticalSection nameLock;
     String parameterName;
+    std::atomic<t_symbol*> receiverSymbol = nullptr;
+    std::atomic<t_symbol*> rampReceiverSymbol = nullptr;
+    std::atomic<bool> resendPending = false;
 
     CriticalSection rangeLock;
     NormalisableRange<float> normalisableRange;
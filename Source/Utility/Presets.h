@@ -18,6 +18,23 @@ struct Presets {
         { "Pong", "AQAAAAAke1BSRVNFVF9ESVJ9LwBAAAAAAAAAAAAAAAAxAQAAVkMyISgBAAA8P3htbCB2ZXJzaW9uPSIxLjAiIGVuY29kaW5nPSJVVEYtOCI/PiA8cGx1Z2RhdGFfc2F2ZSBWZXJzaW9uPSIwLjcuMSIgU3BsaXRJbmRleD0iMSIgT3ZlcnNhbXBsaW5nPSIwIiBMYXRlbmN5PSI2NCIgVGFpbExlbmd0aD0iMC4wIiBMZWdhY3k9IjAiIFdpZHRoPSI1MDAiIEhlaWdodD0iNTIwIiBQbHVnaW5Nb2RlPSJQb25nLnBkIj48UGF0Y2hlcz48UGF0Y2ggQ29udGVudD0iIiBMb2NhdGlvbj0iJHtQUkVTRVRfRElSfS9Qb25nL1BvbmcucGQiIFBsdWdpbk1vZGU9IjEiLz48L1BhdGNoZXM+PC9wbHVnZGF0YV9zYXZlPgA=" }
     };
 
+    // Presets are decoded once per process, instead of on every program change
+    static MemoryBlock const& getPresetData(int index)
+    {
+        static auto const decodedPresets = []() {
+            std::vector<MemoryBlock> decoded;
+            decoded.reserve(presets.size());
+            for (auto const& [name, data] : presets) {
+                MemoryOutputStream stream;
+                Base64::convertFromBase64(stream, data);
+                decoded.push_back(stream.getMemoryBlock());
+            }
+            return decoded;
+        }();
+
+        return decodedPresets[index];
+    }
+
     /* Helper function for creating presets
     static void createPreset(AudioProcessor* processor)
     {
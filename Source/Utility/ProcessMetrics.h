@@ -0,0 +1,174 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Telemetry of every plugdata instance in this process, so one editor can show which instance uses the most time
+// Every processor registers itself as a source. Snapshots are taken on the message thread, from what the audio thread
+// already measures, so measuring costs nothing while nobody looks
+// Shared by all instances through a SharedResourcePointer, like the instance pool
+class ProcessMetrics {
+public:
+    struct Snapshot {
+        int id = 0;
+        String name;
+        float cpuLoad = 0.0f;        // Percentage of the time available for a block
+        float worstBlockLoad = 0.0f; // Since the block timing was reset, 1.0 is the deadline
+        uint32 numBlocks = 0;
+        uint32 numOverruns = 0;
+        size_t functionQueueDepth = 0;
+        size_t guiQueueDepth = 0;
+        size_t dispatcherQueueDepth = 0;
+        uint64 numDroppedMessages = 0;
+        size_t pdMemory = 0; // Measured every few seconds, 0 until then
+        int numPatches = 0;
+        uint32 numStolenSynthVoices = 0; // Internal GM synth, standalone only
+        int synthVoiceBudget = 0;        // 0 when the internal synth may use all its voices
+    };
+
+    class Source {
+    public:
+        virtual ~Source() = default;
+
+        // Called on the message thread
+        virtual Snapshot getMetrics() = 0;
+    };
+
+    void addSource(Source* source)
+    {
+        ScopedLock lock(sourcesLock);
+        sources.add({ source, nextId++ });
+    }
+
+    void removeSource(Source* source)
+    {
+        ScopedLock lock(sourcesLock);
+        sources.removeIf([source](auto const& entry) { return entry.source == source; });
+    }
+
+    std::vector<Snapshot> getSnapshots()
+    {
+        ScopedLock lock(sourcesLock);
+        std::vector<Snapshot> snapshots;
+        snapshots.reserve(sources.size());
+        for (auto const& entry : sources) {
+            auto snapshot = entry.source->getMetrics();
+            snapshot.id = entry.id;
+            snapshots.push_back(snapshot);
+        }
+        return snapshots;
+    }
+
+    // Prometheus' text format, so a scraper can keep a history of every instance
+    static String toPrometheusText(std::vector<Snapshot> const& snapshots)
+    {
+        auto escape = [](String const& text) {
+            return text.replace("\\", "\\\\").replace("\"", "\\\"").replace("\n", "\\n");
+        };
+
+        String text;
+        auto addMetric = [&](char const* name, char const* type, char const* help, auto getValue) {
+            text << "# HELP plugdata_" << name << " " << help << "\n";
+            text << "# TYPE plugdata_" << name << " " << type << "\n";
+            for (auto const& snapshot : snapshots) {
+                text << "plugdata_" << name << "{instance=\"" << snapshot.id << "\",name=\"" << escape(snapshot.name) << "\"} " << String(getValue(snapshot)) << "\n";
+            }
+        };
+
+        addMetric("cpu_load_percent", "gauge", "DSP time as percentage of the time available for a block", [](auto const& s) { return static_cast<double>(s.cpuLoad); });
+        addMetric("worst_block_load", "gauge", "Slowest block since the block timing was reset, 1 is the deadline", [](auto const& s) { return static_cast<double>(s.worstBlockLoad); });
+        addMetric("blocks_total", "counter", "Blocks processed since the block timing was reset", [](auto const& s) { return static_cast<int64>(s.numBlocks); });
+        addMetric("block_overruns_total", "counter", "Blocks that took longer than their deadline", [](auto const& s) { return static_cast<int64>(s.numOverruns); });
+        addMetric("function_queue_depth", "gauge", "Functions waiting to run on the audio thread", [](auto const& s) { return static_cast<int64>(s.functionQueueDepth); });
+        addMetric("gui_queue_depth", "gauge", "Messages from pd waiting for the GUI", [](auto const& s) { return static_cast<int64>(s.guiQueueDepth); });
+        addMetric("dispatcher_queue_depth", "gauge", "Ordered messages waiting in the message dispatcher", [](auto const& s) { return static_cast<int64>(s.dispatcherQueueDepth); });
+        addMetric("dropped_messages_total", "counter", "Messages the dispatcher had no room for", [](auto const& s) { return static_cast<int64>(s.numDroppedMessages); });
+        addMetric("pd_memory_bytes", "gauge", "Memory used by the open patches in pd", [](auto const& s) { return static_cast<int64>(s.pdMemory); });
+        addMetric("open_patches", "gauge", "Number of open patches", [](auto const& s) { return s.numPatches; });
+        addMetric("synth_stolen_voices_total", "counter", "Internal synth voices that were stopped early to stay within the polyphony or the voice budget", [](auto const& s) { return static_cast<int64>(s.numStolenSynthVoices); });
+        addMetric("synth_voice_budget", "gauge", "Voices the internal synth may play while the CPU is busy, 0 for no limit", [](auto const& s) { return s.synthVoiceBudget; });
+
+        return text;
+    }
+
+    // Serves the metrics of every instance over HTTP, for the headless mode: plugdata --headless --metrics-port 9100
+    // Snapshots are taken on the message thread once per second, the socket thread only hands out the last text
+    class Exporter : private Thread
+        , private Timer {
+    public:
+        explicit Exporter(int portToListenOn)
+            : Thread("Metrics exporter")
+            , port(portToListenOn)
+        {
+            timerCallback();
+            startTimer(1000);
+
+            if (socket.createListener(port, "127.0.0.1"))
+                startThread();
+            else
+                Logger::writeToLog("Can't serve metrics on port " + String(port));
+        }
+
+        ~Exporter() override
+        {
+            stopTimer();
+            signalThreadShouldExit();
+            socket.close(); // Wakes up the thread if it's waiting for a connection
+            stopThread(2000);
+        }
+
+    private:
+        void timerCallback() override
+        {
+            auto text = toPrometheusText(metrics->getSnapshots());
+            ScopedLock lock(textLock);
+            lastText = std::move(text);
+        }
+
+        void run() override
+        {
+            while (!threadShouldExit()) {
+                std::unique_ptr<StreamingSocket> connection(socket.waitForNextConnection());
+                if (!connection) {
+                    wait(100);
+                    continue;
+                }
+
+                // We answer every request the same way, but the request has to be read before we reply
+                char request[4096];
+                if (connection->waitUntilReady(true, 500) == 1)
+                    connection->read(request, sizeof(request), false);
+
+                String body;
+                {
+                    ScopedLock lock(textLock);
+                    body = lastText;
+                }
+
+                auto const response = String("HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: ")
+                    + String(body.getNumBytesAsUTF8()) + "\r\nConnection: close\r\n\r\n" + body;
+                connection->write(response.toRawUTF8(), static_cast<int>(response.getNumBytesAsUTF8()));
+            }
+        }
+
+        int port;
+        StreamingSocket socket;
+        SharedResourcePointer<ProcessMetrics> metrics;
+
+        CriticalSection textLock;
+        String lastText;
+    };
+
+private:
+    struct Entry {
+        Source* source;
+        int id;
+    };
+
+    CriticalSection sourcesLock;
+    Array<Entry> sources;
+    int nextId = 1;
+};
@@ -0,0 +1,237 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Extracts the filesystem that we ship zipped inside BinaryData
+// Every file we extract is listed in a manifest, together with the checksum that the zip has for it.
+// Next time, only files that are missing or have a different checksum are extracted again,
+// and files that didn't change since the previous plugdata version are copied from there instead of decompressed
+class ResourceExtractor {
+public:
+    // Reads the zip straight from the BinaryData chunks, so we don't need to put them back together in memory first
+    class ChunkedInputStream : public InputStream {
+    public:
+        explicit ChunkedInputStream(std::vector<std::pair<char const*, int64>> chunksToRead)
+            : chunks(std::move(chunksToRead))
+        {
+            for (auto const& [data, size] : chunks)
+                totalLength += size;
+        }
+
+        int64 getTotalLength() override { return totalLength; }
+        bool isExhausted() override { return position >= totalLength; }
+        int64 getPosition() override { return position; }
+
+        bool setPosition(int64 newPosition) override
+        {
+            position = jlimit<int64>(0, totalLength, newPosition);
+            return true;
+        }
+
+        int read(void* destBuffer, int maxBytesToRead) override
+        {
+            auto* dest = static_cast<char*>(destBuffer);
+            int numRead = 0;
+            int64 chunkStart = 0;
+
+            for (auto const& [data, size] : chunks) {
+                if (numRead >= maxBytesToRead)
+                    break;
+
+                auto const chunkEnd = chunkStart + size;
+                if (position < chunkEnd) {
+                    auto const numToCopy = static_cast<int>(std::min<int64>(chunkEnd - position, maxBytesToRead - numRead));
+                    memcpy(dest + numRead, data + (position - chunkStart), numToCopy);
+                    numRead += numToCopy;
+                    position += numToCopy;
+                }
+                chunkStart = chunkEnd;
+            }
+
+            return numRead;
+        }
+
+    private:
+        std::vector<std::pair<char const*, int64>> chunks;
+        int64 totalLength = 0;
+        int64 position = 0;
+    };
+
+    // Returns true if any file was extracted or copied
+    static bool extract(InputStream& zipStream, File const& targetDirectory)
+    {
+        auto const checksums = readChecksums(zipStream);
+        ZipFile zip(zipStream);
+
+        auto const manifestFile = targetDirectory.getChildFile(".manifest");
+        auto const manifest = readManifest(manifestFile);
+
+        auto const previousVersion = findPreviousVersion(targetDirectory);
+        auto const previousManifest = previousVersion.isDirectory() ? readManifest(previousVersion.getChildFile(".manifest")) : std::unordered_map<String, String>();
+
+        std::map<String, String> newManifest;
+        bool changed = false;
+
+        for (int i = 0; i < zip.getNumEntries(); i++) {
+            auto const* entry = zip.getEntry(i);
+
+            // Everything is zipped inside a "plugdata_version" folder
+            auto const path = entry->filename.fromFirstOccurrenceOf("/", false, false);
+            if (path.isEmpty())
+                continue;
+
+            auto const target = targetDirectory.getChildFile(path);
+            if (path.endsWithChar('/')) {
+                target.createDirectory();
+                continue;
+            }
+
+            auto const it = checksums.find(entry->filename);
+            auto const checksum = it != checksums.end() ? it->second : String(entry->uncompressedSize) + ":" + String(entry->fileTime.toMilliseconds());
+            newManifest[path] = checksum;
+
+            if (target.existsAsFile() && isListedWith(manifest, path, checksum))
+                continue;
+
+            changed = true;
+            target.getParentDirectory().createDirectory();
+
+            auto const previous = previousVersion.getChildFile(path);
+            if (!entry->isSymbolicLink && isListedWith(previousManifest, path, checksum) && previous.existsAsFile() && previous.copyFileTo(target))
+                continue;
+
+            extractEntry(zip, i, target);
+        }
+
+        // Written last, so if we get interrupted, the next run extracts whatever we didn't get to
+        if (changed || !manifestFile.existsAsFile()) {
+            String manifestText;
+            for (auto const& [path, checksum] : newManifest)
+                manifestText << path << "\t" << checksum << "\n";
+
+            manifestFile.replaceWithText(manifestText);
+        }
+
+        return changed;
+    }
+
+private:
+    static void extractEntry(ZipFile& zip, int index, File const& target)
+    {
+        auto const* entry = zip.getEntry(index);
+        std::unique_ptr<InputStream> stream(zip.createStreamForEntry(index));
+        if (!stream)
+            return;
+
+        if (entry->isSymbolicLink) {
+            File::createSymbolicLink(target, stream->readEntireStreamAsString(), true);
+            return;
+        }
+
+        // Never leave a half written file behind, it would look like it was extracted already
+        TemporaryFile tempFile(target);
+        {
+            FileOutputStream output(tempFile.getFile());
+            if (!output.openedOk())
+                return;
+
+            output.writeFromInputStream(*stream, -1);
+        }
+
+        if (!tempFile.overwriteTargetFileWithTemporary())
+            return;
+
+        target.setLastModificationTime(entry->fileTime);
+#if !JUCE_WINDOWS
+        if ((entry->externalFileAttributes >> 16) & 0111)
+            target.setExecutePermission(true);
+#endif
+    }
+
+    // Reads the CRC32 and size that the zip's central directory has for every file, without decompressing anything
+    static std::unordered_map<String, String> readChecksums(InputStream& zip)
+    {
+        std::unordered_map<String, String> checksums;
+
+        // The end of central directory record is at the very end, followed by a comment of at most 64kb
+        auto const totalLength = zip.getTotalLength();
+        auto const tailStart = jmax<int64>(0, totalLength - 65557);
+        MemoryBlock tail;
+        zip.setPosition(tailStart);
+        zip.readIntoMemoryBlock(tail, static_cast<ssize_t>(totalLength - tailStart));
+
+        auto const* bytes = static_cast<char const*>(tail.getData());
+        for (auto i = static_cast<int64>(tail.getSize()) - 22; i >= 0; i--) {
+            if (ByteOrder::littleEndianInt(bytes + i) != 0x06054b50)
+                continue;
+
+            auto const numEntries = ByteOrder::littleEndianShort(bytes + i + 10);
+            zip.setPosition(ByteOrder::littleEndianInt(bytes + i + 16));
+
+            for (int n = 0; n < numEntries; n++) {
+                char header[46];
+                if (zip.read(header, 46) != 46 || ByteOrder::littleEndianInt(header) != 0x02014b50)
+                    break;
+
+                auto const crc = ByteOrder::littleEndianInt(header + 16);
+                auto const size = ByteOrder::littleEndianInt(header + 24);
+                auto const nameLength = ByteOrder::littleEndianShort(header + 28);
+                auto const extraLength = ByteOrder::littleEndianShort(header + 30);
+                auto const commentLength = ByteOrder::littleEndianShort(header + 32);
+
+                MemoryBlock name;
+                zip.readIntoMemoryBlock(name, nameLength);
+                zip.skipNextBytes(extraLength + commentLength);
+
+                checksums[String::fromUTF8(static_cast<char const*>(name.getData()), static_cast<int>(name.getSize()))] = String::toHexString(static_cast<int>(crc)) + ":" + String(size);
+            }
+            break;
+        }
+
+        zip.setPosition(0);
+        return checksums;
+    }
+
+    static std::unordered_map<String, String> readManifest(File const& manifestFile)
+    {
+        std::unordered_map<String, String> manifest;
+        if (!manifestFile.existsAsFile())
+            return manifest;
+
+        StringArray lines;
+        manifestFile.readLines(lines);
+        for (auto const& line : lines) {
+            if (line.containsChar('\t'))
+                manifest[line.upToFirstOccurrenceOf("\t", false, false)] = line.fromFirstOccurrenceOf("\t", false, false);
+        }
+        return manifest;
+    }
+
+    static bool isListedWith(std::unordered_map<String, String> const& manifest, String const& path, String const& checksum)
+    {
+        auto const it = manifest.find(path);
+        return it != manifest.end() && it->second == checksum;
+    }
+
+    // The most recently extracted version other than this one, most files are usually the same
+    static File findPreviousVersion(File const& targetDirectory)
+    {
+        File previousVersion;
+        Time mostRecent;
+        for (auto const& version : targetDirectory.getParentDirectory().findChildFiles(File::findDirectories, false)) {
+            auto const manifestFile = version.getChildFile(".manifest");
+            if (version == targetDirectory || !manifestFile.existsAsFile())
+                continue;
+
+            if (manifestFile.getLastModificationTime() > mostRecent) {
+                mostRecent = manifestFile.getLastModificationTime();
+                previousVersion = version;
+            }
+        }
+        return previousVersion;
+    }
+};
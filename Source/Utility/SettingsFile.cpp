@@ -27,8 +27,9 @@ JUCE_IMPLEMENT_SINGLETON(SettingsFile)
 
 SettingsFile::~SettingsFile()
 {
-    // Save current settings before quitting
-    saveSettings();
+    // Save current settings before quitting, after the writer is done with what it was writing
+    writerThread.removeAllJobs(false, -1);
+    writeSettings(settingsTree.createCopy());
 
     clearSingletonInstance();
 }
@@ -47,6 +48,7 @@ SettingsFile* SettingsFile::initialise()
     } else {
         // Or load the settings when they exist already
         settingsTree = ValueTree::fromXml(settingsFile.loadFileAsString());
+        loadLargeProperties(settingsTree);
     }
 
     // Make sure all the properties exist
@@ -345,6 +347,7 @@ void SettingsFile::reloadSettings()
     jassert(isInitialised);
 
     auto newTree = ValueTree::fromXml(settingsFile.loadFileAsString());
+    loadLargeProperties(newTree);
 
     // Children shouldn't be overwritten as that would break some valueTree links
     for (auto child : settingsTree) {
@@ -416,9 +419,88 @@ void SettingsFile::setGlobalScale(float newScale)
 void SettingsFile::saveSettings()
 {
     jassert(isInitialised);
-    // Save settings to file
-    auto xml = settingsTree.toXmlString();
-    settingsFile.replaceWithText(xml);
+
+    // Copying the tree is all we do on the message thread, the writer turns it into xml
+    ScopedLock scopedLock(snapshotLock);
+    auto const writerIsIdle = !pendingSnapshot.isValid();
+    pendingSnapshot = settingsTree.createCopy();
+
+    // If there's a job waiting already, it will pick up this snapshot
+    if (writerIsIdle) {
+        writerThread.addJob([this]() {
+            ValueTree snapshot;
+            {
+                ScopedLock scopedLock(snapshotLock);
+                std::swap(snapshot, pendingSnapshot);
+            }
+            writeSettings(snapshot);
+        });
+    }
+}
+
+void SettingsFile::writeSettings(ValueTree snapshot)
+{
+    StringArray blobNames;
+    storeLargeProperties(snapshot, blobNames);
+
+    // Write to a temporary file and move it in place, so we never leave a half written settings file behind
+    TemporaryFile tempFile(settingsFile);
+    if (tempFile.getFile().appendText(snapshot.toXmlString()))
+        tempFile.overwriteTargetFileWithTemporary();
+
+    // Clean up the properties that are gone or changed
+    for (auto const& blobFile : blobDirectory.findChildFiles(File::findFiles, false)) {
+        if (!blobNames.contains(blobFile.getFileName()))
+            blobFile.deleteFile();
+    }
+}
+
+void SettingsFile::storeLargeProperties(ValueTree tree, StringArray& blobNames)
+{
+    for (int i = 0; i < tree.getNumProperties(); i++) {
+        auto const name = tree.getPropertyName(i);
+        auto const& value = tree.getProperty(name);
+        if (!value.isString() || value.toString().length() < largePropertySize)
+            continue;
+
+        auto const contents = value.toString();
+        auto const blobName = String::toHexString(contents.hashCode64());
+        auto const blobFile = blobDirectory.getChildFile(blobName);
+
+        if (!blobFile.existsAsFile()) {
+            blobDirectory.createDirectory();
+            TemporaryFile tempFile(blobFile);
+            if (tempFile.getFile().appendText(contents))
+                tempFile.overwriteTargetFileWithTemporary();
+        }
+
+        tree.setProperty(name, blobPrefix + blobName, nullptr);
+        blobNames.add(blobName);
+    }
+
+    for (auto child : tree) {
+        storeLargeProperties(child, blobNames);
+    }
+}
+
+void SettingsFile::loadLargeProperties(ValueTree tree)
+{
+    for (int i = tree.getNumProperties() - 1; i >= 0; i--) {
+        auto const name = tree.getPropertyName(i);
+        auto const value = tree.getProperty(name).toString();
+        if (!value.startsWith(blobPrefix))
+            continue;
+
+        auto const blobFile = blobDirectory.getChildFile(value.fromFirstOccurrenceOf(blobPrefix, false, false));
+        if (blobFile.existsAsFile())
+            tree.setProperty(name, blobFile.loadFileAsString(), nullptr);
+        else
+            tree.removeProperty(name, nullptr);
+    }
+
+    for (auto child : tree) {
+        loadLargeProperties(child);
+    }
 }
 
 void SettingsFile::setProperty(String const& name, var const& value)
@@ -58,6 +58,7 @@ public:
 
     void timerCallback() override;
 
+    // Writes a snapshot of the settings on a background thread
     void saveSettings();
 
     void setProperty(String const& name, var const& value);
@@ -87,6 +88,15 @@ public:
     void setGlobalScale(float newScale);
 
 private:
+    void writeSettings(ValueTree snapshot);
+
+    // Properties bigger than this are stored in their own file, named after a hash of the contents
+    // Unchanged ones don't have to be written again, so saving a single flag stays cheap
+    void storeLargeProperties(ValueTree tree, StringArray& blobNames);
+    void loadLargeProperties(ValueTree tree);
+    static constexpr int largePropertySize = 1024;
+    static inline String const blobPrefix = "settings_blob:";
+
     bool isInitialised = false;
 
     FileSystemWatcher settingsFileWatcher;
@@ -94,7 +104,13 @@ private:
     Array<SettingsFileListener*> listeners;
 
     File settingsFile = ProjectInfo::appDataDir.getChildFile(".settings");
+    File blobDirectory = ProjectInfo::appDataDir.getChildFile(".settings_blobs");
     ValueTree settingsTree = ValueTree("SettingsTree");
+
+    // Only the latest snapshot gets written, older ones that the writer didn't get to yet are skipped
+    CriticalSection snapshotLock;
+    ValueTree pendingSnapshot;
+    ThreadPool writerThread { 1 };
     bool settingsChangedInternally = false;
     bool settingsChangedExternally = false;
 
@@ -102,8 +118,17 @@ private:
         { "browser_path", var(ProjectInfo::appDataDir.getFullPathName()) },
         { "theme", var("light") },
         { "oversampling", var(0) },
+        { "oversampling_quality", var(0) },
+        { "engine_block_size", var(64) },
         { "limiter_threshold", var(1) },
         { "protected", var(1) },
+        { "multicore_dsp", var(0) },
+        { "sleep_when_silent", var(0) },
+        { "smooth_dsp_rebuild", var(0) },
+        { "compile_expr", var(1) },
+        { "fixed_parameter_count", var(1) },
+        { "parameter_blocks", var(1) },
+        { "legacy_daw_state", var(false) },
         { "debug_connections", var(1) },
         { "internal_synth", var(0) },
         { "grid_enabled", var(1) },
@@ -0,0 +1,141 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Uniform grid of item bounds, so we can find what's inside an area without checking every item
+// Items that cover too many cells are kept in a separate list that is always checked
+template<typename ItemType>
+class SpatialIndex {
+public:
+    void update(ItemType* item, Rectangle<int> bounds)
+    {
+        if (auto existing = items.find(item); existing != items.end()) {
+            if (existing->second == bounds)
+                return;
+
+            removeFromCells(item, existing->second);
+        }
+
+        items[item] = bounds;
+        addToCells(item, bounds);
+    }
+
+    void remove(ItemType* item)
+    {
+        if (auto existing = items.find(item); existing != items.end()) {
+            removeFromCells(item, existing->second);
+            items.erase(existing);
+        }
+    }
+
+    void clear()
+    {
+        items.clear();
+        cells.clear();
+        oversizedItems.clear();
+    }
+
+    // Adds every item whose bounds intersect the area to result, each item only once
+    void query(Rectangle<int> area, std::vector<ItemType*>& result) const
+    {
+        auto const range = getCellRange(area);
+
+        for (int x = range.getX(); x <= range.getRight(); x++) {
+            for (int y = range.getY(); y <= range.getBottom(); y++) {
+                auto cell = cells.find(getCellKey(x, y));
+                if (cell == cells.end())
+                    continue;
+
+                for (auto* item : cell->second) {
+                    auto const& bounds = items.at(item);
+                    if (!bounds.intersects(area))
+                        continue;
+
+                    // Items are in multiple cells, only report them from the first cell that's in both ranges
+                    auto const itemRange = getCellRange(bounds);
+                    if (x == jmax(itemRange.getX(), range.getX()) && y == jmax(itemRange.getY(), range.getY()))
+                        result.push_back(item);
+                }
+            }
+        }
+
+        for (auto* item : oversizedItems) {
+            if (items.at(item).intersects(area))
+                result.push_back(item);
+        }
+    }
+
+private:
+    static constexpr int cellSize = 256;
+    static constexpr int maxCellsPerItem = 256;
+
+    // Inclusive range of cells, stored as a rectangle where right and bottom are the last cells
+    static Rectangle<int> getCellRange(Rectangle<int> bounds)
+    {
+        auto const startX = floorDiv(bounds.getX());
+        auto const startY = floorDiv(bounds.getY());
+        auto const endX = floorDiv(bounds.getRight());
+        auto const endY = floorDiv(bounds.getBottom());
+        return { startX, startY, endX - startX, endY - startY };
+    }
+
+    static int floorDiv(int value)
+    {
+        return value >= 0 ? value / cellSize : (value - cellSize + 1) / cellSize;
+    }
+
+    static int64 getCellKey(int x, int y)
+    {
+        return (static_cast<int64>(x) << 32) | static_cast<uint32>(y);
+    }
+
+    static bool isOversized(Rectangle<int> range)
+    {
+        return static_cast<int64>(range.getWidth() + 1) * (range.getHeight() + 1) > maxCellsPerItem;
+    }
+
+    void addToCells(ItemType* item, Rectangle<int> bounds)
+    {
+        auto const range = getCellRange(bounds);
+        if (isOversized(range)) {
+            oversizedItems.push_back(item);
+            return;
+        }
+
+        for (int x = range.getX(); x <= range.getRight(); x++) {
+            for (int y = range.getY(); y <= range.getBottom(); y++) {
+                cells[getCellKey(x, y)].push_back(item);
+            }
+        }
+    }
+
+    void removeFromCells(ItemType* item, Rectangle<int> bounds)
+    {
+        auto const range = getCellRange(bounds);
+        if (isOversized(range)) {
+            oversizedItems.erase(std::remove(oversizedItems.begin(), oversizedItems.end(), item), oversizedItems.end());
+            return;
+        }
+
+        for (int x = range.getX(); x <= range.getRight(); x++) {
+            for (int y = range.getY(); y <= range.getBottom(); y++) {
+                auto cell = cells.find(getCellKey(x, y));
+                if (cell == cells.end())
+                    continue;
+
+                auto& cellItems = cell->second;
+                cellItems.erase(std::remove(cellItems.begin(), cellItems.end(), item), cellItems.end());
+                if (cellItems.empty())
+                    cells.erase(cell);
+            }
+        }
+    }
+
+    std::unordered_map<ItemType*, Rectangle<int>> items;
+    std::unordered_map<int64, std::vector<ItemType*>> cells;
+    std::vector<ItemType*> oversizedItems;
+};
@@ -223,15 +223,10 @@ private:
         void paint(Graphics& g) override
         {
             if (auto* c = dynamic_cast<TopLevelWindow*>(target.get())) {
-                auto shadowPath = Path();
-                shadowPath.addRoundedRectangle(getLocalArea(c, c->getLocalBounds().reduced(shadow.radius * 0.9f)).toFloat(), windowCornerRadius);
-
                 auto radius = c->isActiveWindow() ? shadow.radius * 2.0f : shadow.radius * 1.5f;
-                StackShadow::renderDropShadow(g, shadowPath, shadow.colour, radius, shadow.offset);
+                StackShadow::renderDropShadow(g, getLocalArea(c, c->getLocalBounds().reduced(shadow.radius * 0.9f)).toFloat(), windowCornerRadius, shadow.colour, radius, shadow.offset);
             } else {
-                auto shadowPath = Path();
-                shadowPath.addRoundedRectangle(getLocalArea(target, target->getLocalBounds()).toFloat(), shadowCornerRadius);
-                StackShadow::renderDropShadow(g, shadowPath, shadow.colour, shadow.radius, shadow.offset);
+                StackShadow::renderDropShadow(g, getLocalArea(target, target->getLocalBounds()).toFloat(), shadowCornerRadius, shadow.colour, shadow.radius, shadow.offset);
             }
         }
 
@@ -13,14 +13,128 @@ StackShadow::~StackShadow()
     clearSingletonInstance();
 }
 
+namespace {
+// FNV-1a over everything that changes what a shadow looks like
+struct ShadowKey {
+    juce::uint64 value = 14695981039346656037ull;
+
+    template<typename T>
+    ShadowKey& add(T const& data)
+    {
+        auto const* bytes = reinterpret_cast<unsigned char const*>(&data);
+        for (size_t i = 0; i < sizeof(T); i++) {
+            value ^= bytes[i];
+            value *= 1099511628211ull;
+        }
+        return *this;
+    }
+
+    ShadowKey& add(juce::Path const& path)
+    {
+        juce::Path::Iterator it(path);
+        while (it.next()) {
+            add(static_cast<int>(it.elementType)).add(it.x1).add(it.y1);
+            if (it.elementType == juce::Path::Iterator::quadraticTo || it.elementType == juce::Path::Iterator::cubicTo)
+                add(it.x2).add(it.y2);
+            if (it.elementType == juce::Path::Iterator::cubicTo)
+                add(it.x3).add(it.y3);
+        }
+        return *this;
+    }
+};
+}
+
+StackShadow::CachedShadow const& StackShadow::getCachedShadow(juce::uint64 const key, juce::Path const& path, juce::Colour color, int const radius, juce::Point<int> const offset, int const spread, float const scale)
+{
+    if (auto const cacheHit = cachedShadowsByKey.find(key); cacheHit != cachedShadowsByKey.end()) {
+        cachedShadows.splice(cachedShadows.begin(), cachedShadows, cacheHit->second);
+        return cacheHit->second->second;
+    }
+
+    auto const margin = radius + spread + std::max(std::abs(offset.x), std::abs(offset.y)) + 2;
+    auto const area = path.getBounds().getSmallestIntegerContainer().expanded(margin);
+    auto const width = std::max(1, juce::roundToInt(area.getWidth() * scale));
+    auto const height = std::max(1, juce::roundToInt(area.getHeight() * scale));
+
+    juce::Image image(juce::Image::ARGB, width, height, true);
+    {
+        juce::Graphics g(image);
+        g.addTransform(juce::AffineTransform::translation(-area.getX(), -area.getY()).scaled(static_cast<float>(width) / area.getWidth(), static_cast<float>(height) / area.getHeight()));
+
+        dropShadow->setColor(color);
+        dropShadow->setOffset(offset);
+        dropShadow->setRadius(radius);
+        dropShadow->setSpread(spread);
+        dropShadow->render(g, path);
+    }
+
+    cachedShadows.emplace_front(key, CachedShadow { image, area });
+    cachedShadowsByKey[key] = cachedShadows.begin();
+
+    if (cachedShadows.size() > maxCachedShadows) {
+        cachedShadowsByKey.erase(cachedShadows.back().first);
+        cachedShadows.pop_back();
+    }
+
+    return cachedShadows.front().second;
+}
+
 void StackShadow::renderDropShadow(juce::Graphics& g, juce::Path const& path, juce::Colour color, int const radius, juce::Point<int> const offset, int spread)
 {
-    auto dropShadow = StackShadow::getInstance()->dropShadow;
-    dropShadow->setColor(color);
-    dropShadow->setOffset(offset);
-    dropShadow->setRadius(radius);
-    dropShadow->setSpread(spread);
-    dropShadow->render(g, path);
+    auto* instance = StackShadow::getInstance();
+    auto const scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    // Shapes that only moved can use the same shadow, so we cache them relative to their position
+    auto const bounds = path.getBounds();
+    auto const origin = juce::Point<float>(std::floor(bounds.getX()), std::floor(bounds.getY()));
+    auto shape = path;
+    shape.applyTransform(juce::AffineTransform::translation(-origin));
+
+    auto const key = ShadowKey().add(shape).add(color.getARGB()).add(radius).add(offset.x).add(offset.y).add(spread).add(scale).value;
+    auto const& cached = instance->getCachedShadow(key, shape, color, radius, offset, spread, scale);
+
+    auto const area = cached.area.toFloat() + origin;
+    g.drawImageTransformed(cached.image, juce::AffineTransform::scale(area.getWidth() / cached.image.getWidth(), area.getHeight() / cached.image.getHeight()).translated(area.getPosition()));
+}
+
+void StackShadow::renderDropShadow(juce::Graphics& g, juce::Rectangle<float> area, float const cornerSize, juce::Colour color, int const radius, juce::Point<int> const offset, int const spread)
+{
+    // Everything closer than this to an edge is affected by the corners, the rest of the shadow is the same along the edge
+    auto const cornerArea = static_cast<int>(std::ceil(cornerSize)) + radius + spread + std::max(std::abs(offset.x), std::abs(offset.y)) + 1;
+    auto const shapeSize = cornerArea * 2 + 1;
+
+    if (area.getWidth() < shapeSize || area.getHeight() < shapeSize) {
+        juce::Path path;
+        path.addRoundedRectangle(area, cornerSize);
+        renderDropShadow(g, path, color, radius, offset, spread);
+        return;
+    }
+
+    juce::Path shape;
+    shape.addRoundedRectangle(0.0f, 0.0f, shapeSize, shapeSize, cornerSize);
+
+    auto* instance = StackShadow::getInstance();
+    auto const scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    auto const key = ShadowKey().add(shape).add(color.getARGB()).add(radius).add(offset.x).add(offset.y).add(spread).add(scale).value;
+    auto const& cached = instance->getCachedShadow(key, shape, color, radius, offset, spread, scale);
+
+    // Corners are drawn as they are, the single row and column in the middle are stretched to fill the rest
+    auto const pixelsPerUnitX = static_cast<float>(cached.image.getWidth()) / cached.area.getWidth();
+    auto const pixelsPerUnitY = static_cast<float>(cached.image.getHeight()) / cached.area.getHeight();
+
+    int const sourceX[4] = { 0, juce::roundToInt((cornerArea - cached.area.getX()) * pixelsPerUnitX), juce::roundToInt((cornerArea + 1 - cached.area.getX()) * pixelsPerUnitX), cached.image.getWidth() };
+    int const sourceY[4] = { 0, juce::roundToInt((cornerArea - cached.area.getY()) * pixelsPerUnitY), juce::roundToInt((cornerArea + 1 - cached.area.getY()) * pixelsPerUnitY), cached.image.getHeight() };
+    int const destX[4] = { juce::roundToInt(area.getX() + cached.area.getX()), juce::roundToInt(area.getX() + cornerArea), juce::roundToInt(area.getRight() - cornerArea), juce::roundToInt(area.getRight() + cached.area.getRight() - shapeSize) };
+    int const destY[4] = { juce::roundToInt(area.getY() + cached.area.getY()), juce::roundToInt(area.getY() + cornerArea), juce::roundToInt(area.getBottom() - cornerArea), juce::roundToInt(area.getBottom() + cached.area.getBottom() - shapeSize) };
+
+    for (int x = 0; x < 3; x++) {
+        for (int y = 0; y < 3; y++) {
+            if (destX[x + 1] <= destX[x] || destY[y + 1] <= destY[y] || sourceX[x + 1] <= sourceX[x] || sourceY[y + 1] <= sourceY[y])
+                continue;
+
+            g.drawImage(cached.image, destX[x], destY[y], destX[x + 1] - destX[x], destY[y + 1] - destY[y], sourceX[x], sourceY[y], sourceX[x + 1] - sourceX[x], sourceY[y + 1] - sourceY[y]);
+        }
+    }
 }
 
 JUCE_IMPLEMENT_SINGLETON(StackShadow)
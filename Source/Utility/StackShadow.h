@@ -1,5 +1,7 @@
 #pragma once
 
+#include <list>
+#include <unordered_map>
 #include <juce_gui_basics/juce_gui_basics.h>
 #include "NVGSurface.h"
 
@@ -13,9 +15,28 @@ struct StackShadow : public juce::DeletedAtShutdown {
 
     ~StackShadow() override;
 
+    // Shadows are cached as images, keyed by the shape, radius, colour and scale, so repainting the same shadow doesn't blur it again
     static void renderDropShadow(juce::Graphics& g, juce::Path const& path, juce::Colour color, int radius = 1, juce::Point<int> offset = { 0, 0 }, int spread = 0);
 
+    // For rounded rectangles, the shadow is cached as a nine-slice image that gets stretched to any size
+    // That way, components that resize or animate don't need a new blur for every frame
+    static void renderDropShadow(juce::Graphics& g, juce::Rectangle<float> area, float cornerSize, juce::Colour color, int radius = 1, juce::Point<int> offset = { 0, 0 }, int spread = 0);
+
     melatonin::DropShadow* dropShadow;
 
+private:
+    struct CachedShadow {
+        juce::Image image;
+        juce::Rectangle<int> area; // Relative to the shape, in logical pixels
+    };
+
+    CachedShadow const& getCachedShadow(juce::uint64 key, juce::Path const& path, juce::Colour color, int radius, juce::Point<int> offset, int spread, float scale);
+
+    static constexpr size_t maxCachedShadows = 64;
+
+    // Most recently used first
+    std::list<std::pair<juce::uint64, CachedShadow>> cachedShadows;
+    std::unordered_map<juce::uint64, std::list<std::pair<juce::uint64, CachedShadow>>::iterator> cachedShadowsByKey;
+
     JUCE_DECLARE_SINGLETON(StackShadow, false)
 };
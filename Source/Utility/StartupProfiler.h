@@ -0,0 +1,152 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// How long each part of starting plugdata took, from loading the binary until the first frame was drawn
+// Everything until then is measured, later instances in the same process reuse what the first one set up
+// When the first frame is drawn, the timeline is added to the last few launches in the app data directory,
+// so a slow startup can be compared with earlier ones, and attached to a bug report
+class StartupProfiler {
+public:
+    // Measures the scope it's created in
+    class Phase {
+    public:
+        explicit Phase(char const* phaseName)
+            : name(phaseName)
+            , start(now())
+        {
+        }
+
+        ~Phase()
+        {
+            record(name, start, now());
+        }
+
+    private:
+        char const* name;
+        double start;
+    };
+
+    // For moments rather than phases, like the editor being opened
+    static void mark(char const* name)
+    {
+        auto const time = now();
+        record(name, time, time);
+    }
+
+    // Called when a frame was drawn, only the first call does anything
+    static void finish()
+    {
+        ScopedLock lock(phasesLock);
+        if (finished)
+            return;
+
+        finished = true;
+
+        auto* launch = new DynamicObject();
+        launch->setProperty("date", Time::getCurrentTime().toISO8601(true));
+        launch->setProperty("version", ProjectInfo::versionString);
+        launch->setProperty("format", ProjectInfo::isStandalone ? "Standalone" : "Plugin");
+
+        Array<var> phaseList;
+        for (auto const& phase : phases) {
+            auto* entry = new DynamicObject();
+            entry->setProperty("name", phase.name);
+            entry->setProperty("start", std::round(phase.start * 10.0) / 10.0);
+            entry->setProperty("duration", std::round((phase.end - phase.start) * 10.0) / 10.0);
+            phaseList.add(var(entry));
+        }
+        launch->setProperty("phases", phaseList);
+
+        auto launches = loadLaunches();
+        launches.insert(0, var(launch));
+        launches.removeRange(maxLaunches, launches.size());
+
+        auto const file = getFile();
+        file.getParentDirectory().createDirectory();
+        file.replaceWithText(JSON::toString(var(launches)));
+    }
+
+    // The most recent launch first, one line per phase
+    static StringArray getReport()
+    {
+        StringArray report;
+        for (auto const& launch : loadLaunches()) {
+            report.add(launch["date"].toString() + ", plugdata " + launch["version"].toString() + " " + launch["format"].toString() + ":");
+
+            if (auto const* phaseList = launch["phases"].getArray()) {
+                for (auto const& phase : *phaseList) {
+                    auto const start = static_cast<double>(phase["start"]);
+                    auto const duration = static_cast<double>(phase["duration"]);
+                    auto line = "    " + String(start, 1).paddedLeft(' ', 8) + " ms  " + phase["name"].toString();
+                    if (duration > 0.0)
+                        line << " (" << String(duration, 1) << " ms)";
+                    report.add(line);
+                }
+            }
+        }
+
+        if (report.isEmpty())
+            report.add("No startup times recorded yet");
+
+        return report;
+    }
+
+    // Every recorded launch, in the same format as the file in the app data directory
+    static bool exportTo(File const& file)
+    {
+        return file.replaceWithText(JSON::toString(var(loadLaunches())));
+    }
+
+private:
+    struct RecordedPhase {
+        String name;
+        double start, end;
+    };
+
+    // Relative to when this was first used, which is when the binary's static data is initialised
+    static double now()
+    {
+        static double const processStart = Time::getMillisecondCounterHiRes();
+        return Time::getMillisecondCounterHiRes() - processStart;
+    }
+
+    static void record(char const* name, double start, double end)
+    {
+        ScopedLock lock(phasesLock);
+        if (finished || phases.size() >= maxPhases)
+            return; // Hosts can create lots of instances before any of them draws a frame
+
+        // Sorted by when they started, so phases inside other phases show up right after them
+        auto const it = std::upper_bound(phases.begin(), phases.end(), start, [](double time, RecordedPhase const& phase) { return time < phase.start; });
+        phases.insert(it, { name, start, end });
+    }
+
+    static File getFile()
+    {
+        return ProjectInfo::appDataDir.getChildFile("StartupTimes.json");
+    }
+
+    static Array<var> loadLaunches()
+    {
+        auto const launches = JSON::parse(getFile());
+        if (auto const* array = launches.getArray())
+            return *array;
+
+        return {};
+    }
+
+    static constexpr int maxLaunches = 10;
+    static constexpr size_t maxPhases = 256;
+
+    // Make sure the clock starts while the binary loads, not when the first phase ends
+    static inline double const clockStarted = now();
+
+    static inline CriticalSection phasesLock;
+    static inline std::vector<RecordedPhase> phases;
+    static inline bool finished = false;
+};
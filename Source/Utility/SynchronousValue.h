@@ -31,3 +31,93 @@ private:
 };
 
 #define SynchronousValue(x) Value(new SynchronousValueSource(x))
+
+// Keeps the value as T as well, converted once when it changes instead of every time it's read
+// For properties that are read while rendering: the Value is still what the inspector, listeners and
+// undo bind to, but reading it doesn't convert a var or parse a colour string
+template<typename T>
+class TypedValueSource : public Value::ValueSource {
+public:
+    TypedValueSource(var const& initialValue, bool synchronous)
+        : value(initialValue)
+        , typedValue(convert(initialValue))
+        , notifySynchronously(synchronous)
+    {
+    }
+
+    var getValue() const override
+    {
+        return value;
+    }
+
+    void setValue(var const& newValue) override
+    {
+        if (!newValue.equalsWithSameType(value)) {
+            value = newValue;
+            typedValue = convert(newValue);
+            sendChangeMessage(notifySynchronously);
+        }
+    }
+
+    T const& get() const
+    {
+        return typedValue;
+    }
+
+private:
+    // Same conversions as getValue<T>()
+    static T convert(var const& v)
+    {
+        if constexpr (std::is_same_v<T, String>) {
+            return v.toString();
+        } else if constexpr (std::is_same_v<T, Colour>) {
+            return Colour::fromString(v.toString());
+        } else {
+            return static_cast<T>(v);
+        }
+    }
+
+    var value;
+    T typedValue;
+    bool notifySynchronously;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TypedValueSource)
+};
+
+// A Value with a TypedValueSource, get() reads the cached T
+// Listeners are notified synchronously, like SynchronousValue, unless asked otherwise
+// It can't be made to refer to another Value, because get() would keep reading the old source. Other Values can refer to it
+template<typename T>
+class TypedValue : public Value {
+public:
+    explicit TypedValue(var const& initialValue = var(), bool synchronous = true)
+        : TypedValue(new TypedValueSource<T>(initialValue, synchronous))
+    {
+    }
+
+    TypedValue& operator=(var const& newValue)
+    {
+        setValue(newValue);
+        return *this;
+    }
+
+    T const& get() const
+    {
+        // Something pointed this at another source through a Value reference
+        jassert(&const_cast<TypedValue*>(this)->getValueSource() == source);
+        return source->get();
+    }
+
+private:
+    using Value::referTo;
+
+    explicit TypedValue(TypedValueSource<T>* newSource)
+        : Value(newSource)
+        , source(newSource)
+    {
+    }
+
+    TypedValueSource<T>* source;
+
+    JUCE_DECLARE_NON_COPYABLE(TypedValue)
+};
@@ -2,64 +2,94 @@
 // For information on usage and redistribution, and for a DISCLAIMER OF ALL
 // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
 
-// Lock-free multithread (single consumer/single producer) stack implementation
+// Lock-free single producer/single consumer stack implementation
 // Before you start popping values, you need to call swapBuffers(). Other than that, push/pop like a regular stack implementation
+// The producer never waits: it writes into one of two preallocated buffers, and the consumer swaps them with an atomic flip
+// If the producer fills up its buffer before the consumer swaps, new values are dropped and counted
 
 #pragma once
 #include <atomic>
-#include <iostream>
-#include <string>
-#include <mutex>
-#include <plf_stack/plf_stack.h>
+#include <cstdint>
+#include <vector>
 
 template<typename T, int stackSize>
 class ThreadSafeStack {
 
-    using StackBuffer = plf::stack<T>;
-    StackBuffer buffers[2];
-    StackBuffer* frontBuffer;
-    StackBuffer* backBuffer;
-    std::mutex swapLock;
+    struct Buffer {
+        std::vector<T> values = std::vector<T>(stackSize);
+        std::atomic<int> size = 0;
+    };
 
-public:
-    ThreadSafeStack()
-    {
-        frontBuffer = &buffers[0];
-        backBuffer = &buffers[1];
-        frontBuffer->reserve(stackSize);
-        backBuffer->reserve(stackSize);
-    }
+    Buffer buffers[2];
+
+    // Bit 0 is the buffer the producer writes to, bit 1 is set while the producer is writing
+    static constexpr uint32_t writingFlag = 2;
+    std::atomic<uint32_t> state = 0;
 
+    int frontSize = 0; // Consumer only
+    std::atomic<uint64_t> numDropped = 0;
+
+public:
     bool isEmpty()
     {
-        std::lock_guard<std::mutex> lock(swapLock);
-        return backBuffer->empty();
+        return buffers[state.load(std::memory_order_acquire) & 1].size.load(std::memory_order_acquire) == 0;
     }
 
-    // Swap front and back buffers
+    // Consumer only: makes everything that was pushed so far available to pop()
+    // Values that weren't popped from the previous front buffer are discarded
     void swapBuffers()
     {
-        std::lock_guard<std::mutex> lock(swapLock);
-        backBuffer = std::exchange(frontBuffer, backBuffer);
-#if JUCE_DEBUG
-        jassert(backBuffer->empty());
-#endif
+        auto const front = (state.load(std::memory_order_relaxed) & 1) ^ 1;
+        buffers[front].size.store(0, std::memory_order_relaxed);
+
+        // Only flip while the producer isn't in the middle of a push, pushes are short so this doesn't spin for long
+        auto expected = state.load(std::memory_order_relaxed) & ~writingFlag;
+        while (!state.compare_exchange_weak(expected, expected ^ 1, std::memory_order_acq_rel)) {
+            expected &= ~writingFlag;
+        }
+
+        frontSize = buffers[expected & 1].size.load(std::memory_order_acquire);
     }
 
-    void push(T const& value)
+    // Producer only, returns false if the value was dropped because the buffer was full
+    bool push(T const& value)
     {
-        std::lock_guard<std::mutex> lock(swapLock);
-        backBuffer->push(value);
+        auto const current = state.fetch_or(writingFlag, std::memory_order_acquire);
+        auto& buffer = buffers[current & 1];
+
+        auto const size = buffer.size.load(std::memory_order_relaxed);
+        bool const hasRoom = size < stackSize;
+        if (hasRoom) {
+            buffer.values[size] = value;
+            buffer.size.store(size + 1, std::memory_order_release);
+        } else {
+            numDropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        state.fetch_and(~writingFlag, std::memory_order_release);
+        return hasRoom;
     }
 
+    // Consumer only
     bool pop(T& result)
     {
-        if (frontBuffer->empty())
+        if (frontSize == 0)
             return false;
 
-        // no need for mutex because this is called from the same thread as swapBuffers()
-        result = frontBuffer->top();
-        frontBuffer->pop();
+        auto& front = buffers[(state.load(std::memory_order_relaxed) & 1) ^ 1];
+        result = front.values[--frontSize];
         return true;
     }
+
+    // Number of values pushed since the consumer last swapped, safe to call from any thread
+    int getNumPending() const
+    {
+        return buffers[state.load(std::memory_order_relaxed) & 1].size.load(std::memory_order_relaxed);
+    }
+
+    // Number of values that didn't fit since the stack was created
+    uint64_t getNumDropped() const
+    {
+        return numDropped.load(std::memory_order_relaxed);
+    }
 };
@@ -0,0 +1,182 @@
+/*
+ // Copyright (c) 2024 Timothy Schoen
+ // For information on usage and redistribution, and for a DISCLAIMER OF ALL
+ // WARRANTIES, see the file, "LICENSE.txt," in this distribution.
+ */
+
+#pragma once
+
+// Records what the audio, message and render threads are doing, and writes it out as a Chrome trace
+// The json file can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing to see how the threads line up
+// Every thread writes into its own preallocated buffer, so recording an event never takes a lock
+// While nothing is being recorded, a trace scope only costs a relaxed atomic load
+class TraceRecorder {
+public:
+    // Times the scope it's created in. The name has to be a string literal, we only keep the pointer
+    class Scope {
+    public:
+        explicit Scope(char const* eventName)
+            : name(isRecording() ? eventName : nullptr)
+            , start(name ? Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~Scope()
+        {
+            if (name)
+                record(name, start, Time::getHighResolutionTicks(), count);
+        }
+
+        // Shown with the event, for example how many messages were handled
+        void setCount(int64 newCount) { count = newCount; }
+
+    private:
+        char const* name;
+        int64 start;
+        int64 count = -1;
+    };
+
+    static bool isRecording() { return recording.load(std::memory_order_relaxed); }
+
+    // Records an event that started earlier than the current scope, like the time it took a patch to load
+    static void recordSince(char const* name, int64 start, int64 count = -1)
+    {
+        if (isRecording())
+            record(name, start, Time::getHighResolutionTicks(), count);
+    }
+
+    static void startRecording()
+    {
+        generation.fetch_add(1, std::memory_order_relaxed);
+        recording.store(true, std::memory_order_release);
+    }
+
+    static void stopRecording()
+    {
+        recording.store(false, std::memory_order_release);
+    }
+
+    // Names the calling thread in the trace. Threads that don't call this get the name of their JUCE thread
+    static void setThreadName(char const* threadName)
+    {
+        if (isRecording())
+            getThreadBuffer().fixedName.store(threadName, std::memory_order_relaxed);
+    }
+
+    // Only call this after stopRecording(), threads can still be finishing their last event while we read it
+    static bool writeTo(File const& file)
+    {
+        FileOutputStream stream(file);
+        if (!stream.openedOk())
+            return false;
+
+        stream.setPosition(0);
+        stream.truncate();
+
+        auto const currentGeneration = generation.load(std::memory_order_relaxed);
+        auto const ticksToMicroseconds = 1e6 / static_cast<double>(Time::getHighResolutionTicksPerSecond());
+
+        stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        bool first = true;
+        ScopedLock lock(buffersLock);
+        for (int threadIndex = 0; threadIndex < buffers.size(); threadIndex++) {
+            auto* buffer = buffers[threadIndex];
+            if (buffer->generation.load(std::memory_order_relaxed) != currentGeneration)
+                continue;
+
+            auto const* fixedName = buffer->fixedName.load(std::memory_order_relaxed);
+            auto const threadName = fixedName ? String(fixedName) : buffer->name;
+            stream << (first ? "" : ",") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadIndex
+                   << ",\"args\":{\"name\":" << JSON::toString(threadName) << "}}";
+            first = false;
+
+            auto const numEvents = buffer->numEvents.load(std::memory_order_acquire);
+            for (size_t i = 0; i < numEvents; i++) {
+                auto const& event = buffer->events[i];
+                stream << ",{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadIndex
+                       << ",\"ts\":" << String(static_cast<double>(event.start) * ticksToMicroseconds, 3)
+                       << ",\"dur\":" << String(static_cast<double>(event.end - event.start) * ticksToMicroseconds, 3);
+                if (event.count >= 0)
+                    stream << ",\"args\":{\"count\":" << String(event.count) << "}";
+                stream << "}";
+            }
+
+            if (auto const dropped = buffer->numDropped.load(std::memory_order_relaxed)) {
+                stream << ",{\"name\":\"Dropped events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":" << threadIndex
+                       << ",\"ts\":0,\"args\":{\"count\":" << String(static_cast<int64>(dropped)) << "}}";
+            }
+        }
+
+        stream << "]}";
+        return true;
+    }
+
+private:
+    struct Event {
+        char const* name;
+        int64 start, end;
+        int64 count;
+    };
+
+    struct ThreadBuffer {
+        static constexpr size_t capacity = 1 << 17;
+
+        std::vector<Event> events = std::vector<Event>(capacity);
+        std::atomic<size_t> numEvents = 0;
+        std::atomic<size_t> numDropped = 0;
+        std::atomic<uint32> generation = 0;
+        String name; // Set when the buffer is created
+        std::atomic<char const*> fixedName = nullptr;
+    };
+
+    static void record(char const* name, int64 start, int64 end, int64 count)
+    {
+        auto& buffer = getThreadBuffer();
+
+        // A new recording started, only the owning thread resets its buffer, so there's never more than one writer
+        auto const currentGeneration = generation.load(std::memory_order_relaxed);
+        if (buffer.generation.load(std::memory_order_relaxed) != currentGeneration) {
+            buffer.generation.store(currentGeneration, std::memory_order_relaxed);
+            buffer.numEvents.store(0, std::memory_order_relaxed);
+            buffer.numDropped.store(0, std::memory_order_relaxed);
+        }
+
+        auto const index = buffer.numEvents.load(std::memory_order_relaxed);
+        if (index >= ThreadBuffer::capacity) {
+            buffer.numDropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        buffer.events[index] = { name, start, end, count };
+        buffer.numEvents.store(index + 1, std::memory_order_release);
+    }
+
+    // The first event on a thread allocates its buffer, after that a thread never allocates or locks again
+    // Buffers are kept until we quit, so the events of threads that already ended still end up in the trace
+    static ThreadBuffer& getThreadBuffer()
+    {
+        static thread_local ThreadBuffer* threadBuffer = nullptr;
+        if (!threadBuffer) {
+            auto* buffer = new ThreadBuffer();
+            if (MessageManager::existsAndIsCurrentThread())
+                buffer->name = "Message thread";
+            else if (auto* thread = Thread::getCurrentThread())
+                buffer->name = thread->getThreadName();
+            else
+                buffer->name = "Thread " + String(static_cast<int64>(reinterpret_cast<pointer_sized_int>(Thread::getCurrentThreadId())));
+
+            ScopedLock lock(buffersLock);
+            buffers.add(buffer);
+            threadBuffer = buffer;
+        }
+
+        return *threadBuffer;
+    }
+
+    static inline std::atomic<bool> recording = false;
+    static inline std::atomic<uint32> generation = 0;
+
+    static inline CriticalSection buffersLock;
+    static inline OwnedArray<ThreadBuffer> buffers;
+};
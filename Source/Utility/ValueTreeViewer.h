@@ -635,6 +635,14 @@ public:
             return;
         }
 
+        // Split the filter once, instead of for every node
+        searchTokens.clearQuick();
+        searchTokens.addTokens(filterString, " ", "");
+        lowercaseSearchTokens.clearQuick();
+        for (auto const& token : searchTokens) {
+            lowercaseSearchTokens.add(token.toLowerCase());
+        }
+
         for (auto* topLevelNode : nodes) {
             searchInNode(topLevelNode);
         }
@@ -668,10 +676,15 @@ private:
     {
         // Check if the current node matches the filterString
         int found = 0;
-        StringArray searchTokens;
-        searchTokens.addTokens(filterString, " ", "");
-        for (auto& token : searchTokens) {
-            if (token.isEmpty() || node->valueTreeNode.getProperty("Name").toString().containsIgnoreCase(token) ||
+
+        // Trees can store a lowercase version of the name as "SearchText", so it doesn't have to be converted for every search
+        auto const& searchText = node->valueTreeNode.getProperty("SearchText");
+        auto const hasSearchText = !searchText.isVoid();
+
+        for (int i = 0; i < searchTokens.size(); i++) {
+            auto const& token = searchTokens[i];
+            auto const nameMatches = hasSearchText ? searchText.toString().contains(lowercaseSearchTokens[i]) : node->valueTreeNode.getProperty("Name").toString().containsIgnoreCase(token);
+            if (token.isEmpty() || nameMatches ||
                 // search over the send/receive tags
                 node->valueTreeNode.getProperty("SendSymbol").toString().containsIgnoreCase(token) || node->valueTreeNode.getProperty("ReceiveSymbol").toString().containsIgnoreCase(token) ||
                 // return all nodes that have send/receive for the patch with the keywords: "send" "receive"
@@ -734,6 +747,8 @@ private:
     }
 
     String filterString;
+    StringArray searchTokens;
+    StringArray lowercaseSearchTokens;
     String tooltipPrepend;
     ValueTreeOwnerView contentComponent;
     OwnedArray<ValueTreeNodeComponent> nodes;
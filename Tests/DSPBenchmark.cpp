@@ -0,0 +1,207 @@
+#include <juce_gui_basics/juce_gui_basics.h>
+#include <juce_audio_processors/juce_audio_processors.h>
+
+#include <iostream>
+#include <thread>
+
+#include "Utility/Config.h"
+#include "PluginProcessor.h"
+
+// Offline DSP benchmark, runs patches faster than real time without any GUI or audio device
+// Start it with: plugdata --headless --benchmark-dsp [--seconds 10] [--instances 4] [--block-size 64] patch.pd ...
+// Every patch is measured once in a single instance, and once in several instances running in parallel, to see how it scales
+
+// Counts C++ allocations made while processing, pd's own getbytes() goes through malloc and isn't counted
+static thread_local bool countAllocations = false;
+static thread_local int64 numAllocations = 0;
+
+void* operator new(std::size_t size)
+{
+    if (countAllocations)
+        numAllocations++;
+
+    if (auto* ptr = std::malloc(size ? size : 1))
+        return ptr;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+struct DSPBenchmarkRun {
+    std::unique_ptr<PluginProcessor> processor;
+    std::vector<double> blockTimes; // In nanoseconds
+    double totalTime = 0.0;
+    int64 allocations = 0;
+};
+
+static void processOffline(DSPBenchmarkRun& run, AudioBuffer<float> const& input, int blockSize, int numBlocks)
+{
+    auto& processor = *run.processor;
+    auto const numChannels = std::max(processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+
+    AudioBuffer<float> buffer(numChannels, blockSize);
+    MidiBuffer midi;
+
+    run.blockTimes.reserve(static_cast<size_t>(numBlocks));
+    auto const ticksToNanoseconds = 1e9 / static_cast<double>(Time::getHighResolutionTicksPerSecond());
+
+    // The input is always at least two blocks long
+    auto const numOffsets = std::max(1, input.getNumSamples() - blockSize);
+
+    for (int block = 0; block < numBlocks; block++) {
+        // The same input every time, so runs are comparable
+        auto const offset = (block * blockSize) % numOffsets;
+        for (int ch = 0; ch < numChannels; ch++) {
+            buffer.copyFrom(ch, 0, input, ch % input.getNumChannels(), offset, blockSize);
+        }
+        midi.clear();
+
+        auto const start = Time::getHighResolutionTicks();
+        countAllocations = true;
+        processor.processBlock(buffer, midi);
+        countAllocations = false;
+        auto const elapsed = static_cast<double>(Time::getHighResolutionTicks() - start) * ticksToNanoseconds;
+
+        run.blockTimes.push_back(elapsed);
+        run.totalTime += elapsed;
+    }
+
+    run.allocations = numAllocations;
+    numAllocations = 0;
+}
+
+static double getPercentile(std::vector<double> sorted, double percentile)
+{
+    if (sorted.empty())
+        return 0.0;
+
+    std::sort(sorted.begin(), sorted.end());
+    auto const index = static_cast<size_t>(std::round(percentile * static_cast<double>(sorted.size() - 1)));
+    return sorted[index];
+}
+
+// Runs the patch in numInstances instances at the same time, and returns the results as a JSON object
+static var benchmarkPatch(File const& patchFile, int numInstances, double seconds, double sampleRate, int blockSize)
+{
+    std::vector<DSPBenchmarkRun> runs(static_cast<size_t>(numInstances));
+    for (auto& run : runs) {
+        run.processor.reset(dynamic_cast<PluginProcessor*>(createPluginFilterOfType(AudioProcessor::wrapperType_Standalone)));
+        run.processor->loadPatch(URL(patchFile));
+        run.processor->prepareToPlay(sampleRate, blockSize);
+    }
+
+    // Deterministic noise, a few seconds long
+    AudioBuffer<float> input(2, std::max(static_cast<int>(sampleRate) * 4, blockSize * 2));
+    Random random(1234);
+    for (int ch = 0; ch < input.getNumChannels(); ch++) {
+        for (int i = 0; i < input.getNumSamples(); i++) {
+            input.setSample(ch, i, random.nextFloat() * 2.0f - 1.0f);
+        }
+    }
+
+    auto const numBlocks = std::max(1, static_cast<int>(seconds * sampleRate / blockSize));
+
+    std::vector<std::thread> threads;
+    for (auto& run : runs) {
+        threads.emplace_back([&run, &input, blockSize, numBlocks]() {
+            processOffline(run, input, blockSize, numBlocks);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<double> allBlockTimes;
+    double totalTime = 0.0;
+    int64 allocations = 0;
+    for (auto& run : runs) {
+        allBlockTimes.insert(allBlockTimes.end(), run.blockTimes.begin(), run.blockTimes.end());
+        totalTime += run.totalTime;
+        allocations += run.allocations;
+        run.processor->releaseResources();
+    }
+
+    auto const numSamples = static_cast<double>(numBlocks) * blockSize * numInstances;
+    auto const nsPerSample = totalTime / numSamples;
+
+    auto* result = new DynamicObject();
+    result->setProperty("instances", numInstances);
+    result->setProperty("ns_per_sample", nsPerSample);
+    result->setProperty("realtime_factor", 1e9 / (sampleRate * nsPerSample));
+    result->setProperty("block_us_p50", getPercentile(allBlockTimes, 0.5) / 1000.0);
+    result->setProperty("block_us_p90", getPercentile(allBlockTimes, 0.9) / 1000.0);
+    result->setProperty("block_us_p99", getPercentile(allBlockTimes, 0.99) / 1000.0);
+    result->setProperty("block_us_max", getPercentile(allBlockTimes, 1.0) / 1000.0);
+    result->setProperty("allocations", allocations);
+    return var(result);
+}
+
+void runDSPBenchmark(StringArray const& args)
+{
+    auto getArgument = [&args](String const& name, double defaultValue) {
+        auto const index = args.indexOf(name);
+        return index >= 0 && index + 1 < args.size() ? args[index + 1].getDoubleValue() : defaultValue;
+    };
+
+    auto const seconds = getArgument("--seconds", 10.0);
+    // Without multi-instance support, all instances share pd's global state, so they can't run at the same time
+    auto const maxInstances = pd::Instance::hasMultipleInstances() ? static_cast<int>(getArgument("--instances", SystemStats::getNumPhysicalCpus())) : 1;
+    auto const numInstances = std::max(1, maxInstances);
+    auto const blockSize = std::max(1, static_cast<int>(getArgument("--block-size", 64)));
+    auto const sampleRate = 48000.0;
+
+    Array<var> patchResults;
+    for (auto arg : args) {
+        auto const patchFile = File(arg.trim().unquoted().trim());
+        if (!patchFile.existsAsFile() || !patchFile.hasFileExtension("pd"))
+            continue;
+
+        std::cout << "BENCHMARKING: " << patchFile.getFullPathName() << std::endl;
+
+        Array<var> runs;
+        runs.add(benchmarkPatch(patchFile, 1, seconds, sampleRate, blockSize));
+        if (numInstances > 1)
+            runs.add(benchmarkPatch(patchFile, numInstances, seconds, sampleRate, blockSize));
+
+        auto* patchResult = new DynamicObject();
+        patchResult->setProperty("file", patchFile.getFullPathName());
+        patchResult->setProperty("runs", runs);
+        patchResults.add(var(patchResult));
+    }
+
+    auto* results = new DynamicObject();
+    results->setProperty("version", PLUGDATA_VERSION);
+    results->setProperty("git_hash", PLUGDATA_GIT_HASH);
+    results->setProperty("sample_rate", sampleRate);
+    results->setProperty("block_size", blockSize);
+    results->setProperty("seconds", seconds);
+    results->setProperty("patches", patchResults);
+
+    auto const json = JSON::toString(var(results));
+    std::cout << json << std::endl;
+    ProjectInfo::appDataDir.getChildFile("dsp-benchmark-results.json").replaceWithText(json);
+}
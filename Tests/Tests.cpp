@@ -6,9 +6,58 @@
 #include "Objects/ObjectBase.h" // So we can interact with object GUIs
 #include "PluginEditor.h"
 
+#if ENABLE_BENCHMARK
+#    if JUCE_MAC
+#        include <mach/mach.h>
+#    elif JUCE_WINDOWS
+#        include <windows.h>
+#        include <psapi.h>
+#    endif
+#endif
+
 String loggedErrors;
 
-void openHelpfilesRecursively(TabComponent& tabbar, std::vector<File>& helpFiles)
+#if ENABLE_BENCHMARK
+// Timings for every help file, written to benchmark-results.json once all of them are done, so we can compare releases
+Array<var> benchmarkResults;
+
+// Resident memory of the whole process in bytes, or 0 if we can't tell on this platform
+static int64 getResidentMemory()
+{
+#    if JUCE_LINUX || JUCE_BSD
+    auto const statm = File("/proc/self/statm").loadFileAsString();
+    return StringArray::fromTokens(statm, false)[1].getLargeIntValue() * static_cast<int64>(sysconf(_SC_PAGESIZE));
+#    elif JUCE_MAC
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+        return static_cast<int64>(info.resident_size);
+    return 0;
+#    elif JUCE_WINDOWS
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+        return static_cast<int64>(counters.WorkingSetSize);
+    return 0;
+#    else
+    return 0;
+#    endif
+}
+
+// Calls onFrame once the surface has rendered a frame after startFrame, or after timeoutMs if that never happens
+static void waitForFrame(uint32 startFrame, double startTime, double timeoutMs, std::function<void()> onFrame)
+{
+    if (NVGResourceUsage::currentFrame != startFrame || Time::getMillisecondCounterHiRes() - startTime > timeoutMs) {
+        onFrame();
+        return;
+    }
+
+    Timer::callAfterDelay(1, [startFrame, startTime, timeoutMs, onFrame = std::move(onFrame)]() mutable {
+        waitForFrame(startFrame, startTime, timeoutMs, std::move(onFrame));
+    });
+}
+#endif
+
+void openHelpfilesRecursively(PluginEditor* editor, std::vector<File>& helpFiles)
 {
     static int numProcessed = 0;
     
@@ -16,6 +65,15 @@ void openHelpfilesRecursively(TabComponent& tabbar, std::vector<File>& helpFiles
     {
         std::cout << "TEST COMPLETED SUCCESFULLY" << std::endl;
         ProjectInfo::appDataDir.getChildFile("console-errors.md").replaceWithText(loggedErrors);
+
+#if ENABLE_BENCHMARK
+        auto* results = new DynamicObject();
+        results->setProperty("version", PLUGDATA_VERSION);
+        results->setProperty("git_hash", PLUGDATA_GIT_HASH);
+        results->setProperty("patches", benchmarkResults);
+        ProjectInfo::appDataDir.getChildFile("benchmark-results.json").replaceWithText(JSON::toString(var(results)));
+        std::cout << "BENCHMARK RESULTS WRITTEN TO: " << ProjectInfo::appDataDir.getChildFile("benchmark-results.json").getFullPathName() << std::endl;
+#endif
         return;
     }
 
@@ -24,10 +82,40 @@ void openHelpfilesRecursively(TabComponent& tabbar, std::vector<File>& helpFiles
 
     std::cout << "STARTED PROCESSING: " << numProcessed++ << " " << helpFile.getFullPathName() << std::endl;
 
-    auto* cnv = tabbar.openPatch(URL(helpFile));
+    auto* pd = editor->pd;
+    auto& tabbar = editor->getTabComponent();
 
-    auto* pd = cnv->pd;
-    auto* editor = cnv->editor;
+#if ENABLE_BENCHMARK
+    auto const memoryBefore = getResidentMemory();
+    auto const loadStart = Time::getMillisecondCounterHiRes();
+#endif
+
+    auto patch = pd->loadPatch(URL(helpFile));
+
+#if ENABLE_BENCHMARK
+    auto const openStart = Time::getMillisecondCounterHiRes();
+#endif
+
+    auto* cnv = tabbar.openPatch(patch);
+    if (!cnv) {
+        loggedErrors += "\n\n\n" + helpFile.getFullPathName() + "\n--------------------------------------------------------------------------\nCouldn't open patch\n";
+        openHelpfilesRecursively(editor, helpFiles);
+        return;
+    }
+
+#if ENABLE_BENCHMARK
+    // Opening already synchronised once, this is what every following synchronise costs
+    auto const synchroniseStart = Time::getMillisecondCounterHiRes();
+    cnv->performSynchronise();
+    auto const synchroniseEnd = Time::getMillisecondCounterHiRes();
+
+    DynamicObject::Ptr result = new DynamicObject();
+    result->setProperty("file", helpFile.getRelativePathFrom(ProjectInfo::appDataDir.getChildFile("Documentation")));
+    result->setProperty("objects", cnv->objects.size());
+    result->setProperty("load_ms", openStart - loadStart);
+    result->setProperty("open_ms", synchroniseStart - openStart);
+    result->setProperty("synchronise_ms", synchroniseEnd - synchroniseStart);
+#endif
 
     // Evil test that deletes the patch instantly after being created, leaving dangling pointers everywhere
     // plugdata should be able to handle that!
@@ -78,14 +166,19 @@ void openHelpfilesRecursively(TabComponent& tabbar, std::vector<File>& helpFiles
         }
     } */
 
-    Timer::callAfterDelay(30, [pd, editor, helpFile, &helpFiles, tabbar = &tabbar]() mutable {
+    auto closePatch = [pd, editor, helpFile, &helpFiles, tabbar = &tabbar
+#if ENABLE_BENCHMARK
+        , result, memoryBefore
+#endif
+    ]() mutable {
         StringArray errors;
-        auto messages = pd->getConsoleMessages();
-        for(auto& [ptr, message, type, length, repeats] : messages)
+        auto& messages = pd->getConsoleMessages();
+        for(auto sequence = messages.getFirstShown(); sequence < messages.getEnd(); sequence++)
         {
-            if(type == 1)
+            auto const& entry = messages.get(sequence);
+            if(entry.type == 1)
             {
-                errors.add(message);
+                errors.add(messages.getMessage(entry));
             }
         }
 
@@ -99,11 +192,31 @@ void openHelpfilesRecursively(TabComponent& tabbar, std::vector<File>& helpFiles
         }
         editor->sidebar->clearConsole();
 
+#if ENABLE_BENCHMARK
+        auto const closeStart = Time::getMillisecondCounterHiRes();
+#endif
         while(auto* cnv = tabbar->getCurrentCanvas()) { // TODO: why is this faster than closeAllTabs?()
             tabbar->closeTab(cnv);
         }
-        openHelpfilesRecursively(*tabbar, helpFiles);
+#if ENABLE_BENCHMARK
+        result->setProperty("close_ms", Time::getMillisecondCounterHiRes() - closeStart);
+
+        // Whatever is still allocated after closing, ideally this stays close to 0
+        result->setProperty("memory_after_close_bytes", getResidentMemory() - memoryBefore);
+        benchmarkResults.add(var(result.get()));
+#endif
+        openHelpfilesRecursively(editor, helpFiles);
+    };
+
+#if ENABLE_BENCHMARK
+    waitForFrame(NVGResourceUsage::currentFrame, Time::getMillisecondCounterHiRes(), 2000.0, [result, loadStart, memoryBefore, closePatch]() mutable {
+        result->setProperty("first_frame_ms", Time::getMillisecondCounterHiRes() - loadStart);
+        result->setProperty("memory_open_bytes", getResidentMemory() - memoryBefore);
+        Timer::callAfterDelay(30, closePatch);
     });
+#else
+    Timer::callAfterDelay(30, closePatch);
+#endif
 }
 
 void runTests(PluginEditor* editor)
@@ -119,9 +232,7 @@ void runTests(PluginEditor* editor)
         }
     }
 
-    auto& tabbar = editor->getTabComponent();
-
     //allHelpfiles.erase(allHelpfiles.end() - 662, allHelpfiles.end());
 
-    openHelpfilesRecursively(tabbar, allHelpfiles);
+    openHelpfilesRecursively(editor, allHelpfiles);
 }